@@ -21,6 +21,7 @@
 
 #include <vnet/l2/l2_classify.h>
 #include <vnet/classify/in_out_acl.h>
+#include <vnet/snapshot/snapshot.h>
 #include <vpp/app/version.h>
 
 #include <vlibapi/api.h>
@@ -52,6 +53,7 @@
 
 #include "fa_node.h"
 #include "public_inlines.h"
+#include "hash_lookup.h"
 
 acl_main_t acl_main;
 acl_main_t *p_acl_main = &acl_main;
@@ -3257,6 +3259,21 @@ acl_set_aclplugin_fn (vlib_main_t * vm,
       am->use_hash_acl_matching = (val != 0);
       goto done;
     }
+  if (unformat (input, "use-tuple-merge %u", &val))
+    {
+      am->use_tuple_merge = (val != 0);
+      goto done;
+    }
+  if (unformat (input, "tuple-merge-split-threshold %u", &val))
+    {
+      if (val == 0)
+	{
+	  error = clib_error_return (0, "expecting threshold > 0");
+	}
+      else
+	am->tuple_merge_split_threshold = val;
+      goto done;
+    }
   if (unformat (input, "l4-match-nonfirst-fragment %u", &val))
     {
       am->l4_match_nonfirst_fragment = (val != 0);
@@ -3815,6 +3832,7 @@ acl_plugin_show_sessions (acl_main_t * am,
 	  vlib_cli_output (vm, "    link prev index: %u",
 			   sess->link_prev_idx);
 	  vlib_cli_output (vm, "    link list id: %u", sess->link_list_id);
+	  vlib_cli_output (vm, "    timer handle: %u", sess->timer_handle);
 	}
       vlib_cli_output (vm, "  connection add/del stats:", wk);
       pool_foreach (swif, im->sw_interfaces, (
@@ -3870,19 +3888,22 @@ acl_plugin_show_sessions (acl_main_t * am,
 	    }
 	}
 
-      vlib_cli_output (vm, "  Next expiry time: %lu", pw->next_expiry_time);
-      vlib_cli_output (vm, "  Requeue until time: %lu",
-		       pw->requeue_until_time);
-      vlib_cli_output (vm, "  Current time wait interval: %lu",
-		       pw->current_time_wait_interval);
       vlib_cli_output (vm, "  Count of deleted sessions: %lu",
 		       pw->cnt_deleted_sessions);
       vlib_cli_output (vm, "  Delete already deleted: %lu",
 		       pw->cnt_already_deleted_sessions);
       vlib_cli_output (vm, "  Session timers restarted: %lu",
 		       pw->cnt_session_timer_restarted);
-      vlib_cli_output (vm, "  Swipe until this time: %lu",
-		       pw->swipe_end_time);
+      vlib_cli_output (vm, "  Sessions aged: %lu (%.2f/sec)",
+		       pw->cnt_aged_sessions, pw->aged_sessions_per_sec);
+      vlib_cli_output (vm, "  Cleaner runs: %lu, CPU time: %.6f sec",
+		       pw->cnt_cleaner_runs,
+		       (f64) pw->cleaner_cpu_clocks /
+		       vm->clib_time.clocks_per_second);
+      if (pw->cnt_deleted_sessions)
+	vlib_cli_output (vm, "  Cleaner clocks per deleted session: %.2f",
+			 (f64) pw->cleaner_cpu_clocks /
+			 (f64) pw->cnt_deleted_sessions);
       vlib_cli_output (vm, "  sw_if_index serviced bitmap: %U",
 		       format_bitmap_hex, pw->serviced_sw_if_index_bitmap);
       vlib_cli_output (vm, "  pending clear intfc bitmap : %U",
@@ -3891,26 +3912,16 @@ acl_plugin_show_sessions (acl_main_t * am,
       vlib_cli_output (vm, "  clear in progress: %u", pw->clear_in_process);
       vlib_cli_output (vm, "  interrupt is pending: %d",
 		       pw->interrupt_is_pending);
-      vlib_cli_output (vm, "  interrupt is needed: %d",
-		       pw->interrupt_is_needed);
-      vlib_cli_output (vm, "  interrupt is unwanted: %d",
-		       pw->interrupt_is_unwanted);
-      vlib_cli_output (vm, "  interrupt generation: %d",
-		       pw->interrupt_generation);
+      vlib_cli_output (vm, "  cleaner is polling: %d",
+		       pw->cleaner_is_polling);
     }
   vlib_cli_output (vm, "\n\nConn cleaner thread counters:");
 #define _(cnt, desc) vlib_cli_output(vm, "             %20lu: %s", am->cnt, desc);
   foreach_fa_cleaner_counter;
 #undef _
-  vlib_cli_output (vm, "Interrupt generation: %d",
-		   am->fa_interrupt_generation);
   vlib_cli_output (vm,
-		   "Sessions per interval: min %lu max %lu increment: %f ms current: %f ms",
-		   am->fa_min_deleted_sessions_per_interval,
-		   am->fa_max_deleted_sessions_per_interval,
-		   am->fa_cleaner_wait_time_increment * 1000.0,
-		   ((f64) am->fa_current_cleaner_timer_wait_interval) *
-		   1000.0 / (f64) vm->clib_time.clocks_per_second);
+		   "Session timer wheel tick: %.2f sec, max expired sessions per run: %u",
+		   ACL_FA_TW_TICK, am->fa_max_expired_sessions_per_run);
   vlib_cli_output (vm, "Reclassify sessions: %d", am->reclassify_sessions);
 }
 
@@ -3994,6 +4005,596 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
   return error;
 }
 
+/*
+ * A synthetic rule set loosely following the ClassBench ACL seeds:
+ * the addresses are drawn from a small number of /16 networks
+ * so that the rules overlap, the prefix lengths are biased towards
+ * /32, /24 and /16, the ports are a mix of wildcard, exact,
+ * well-known/ephemeral halves and arbitrary ranges.
+ */
+static u8
+acl_perf_random_prefix_len (u32 * seed)
+{
+  u32 r = random_u32 (seed) % 100;
+  if (r < 10)
+    return 0;
+  if (r < 20)
+    return 8 + random_u32 (seed) % 8;
+  if (r < 30)
+    return 16;
+  if (r < 40)
+    return 17 + random_u32 (seed) % 7;
+  if (r < 60)
+    return 24;
+  if (r < 70)
+    return 25 + random_u32 (seed) % 7;
+  return 32;
+}
+
+static void
+acl_perf_random_port_range (u32 * seed, int is_dst, u16 * first, u16 * last)
+{
+  static u16 well_known_ports[] =
+    { 20, 21, 22, 23, 25, 53, 80, 110, 123, 143, 161, 389, 443, 445, 993,
+    1433, 3306, 3389, 5060, 8080
+  };
+  u32 r = random_u32 (seed) % 100;
+  u16 port;
+
+  if (!is_dst)
+    /* source ports are mostly wildcard */
+    r = (r < 80) ? 99 : (r < 95) ? 45 : 0;
+
+  if (r < 40)
+    {
+      port = (random_u32 (seed) % 4) ?
+	well_known_ports[random_u32 (seed) % ARRAY_LEN (well_known_ports)] :
+	1 + random_u32 (seed) % 65535;
+      *first = *last = port;
+    }
+  else if (r < 50)
+    {
+      *first = 1024;
+      *last = 65535;
+    }
+  else if (r < 60)
+    {
+      *first = 0;
+      *last = 1023;
+    }
+  else if (r < 75)
+    {
+      port = random_u32 (seed) % 60000;
+      *first = port;
+      *last = port + 1 + random_u32 (seed) % 5000;
+    }
+  else
+    {
+      *first = 0;
+      *last = 65535;
+    }
+}
+
+static void
+acl_perf_make_rules (u32 n_rules, u32 * seed, vl_api_acl_rule_t ** rules)
+{
+  u32 networks[64];
+  u32 i, j;
+
+  for (i = 0; i < ARRAY_LEN (networks); i++)
+    networks[i] = (10 << 24) | ((random_u32 (seed) & 0xffff) << 8);
+
+  vec_validate (*rules, n_rules - 1);
+  for (i = 0; i < n_rules; i++)
+    {
+      vl_api_acl_rule_t *r = vec_elt_at_index (*rules, i);
+      u16 first, last;
+      u32 r_proto = random_u32 (seed) % 10;
+
+      memset (r, 0, sizeof (*r));
+      r->is_permit = random_u32 (seed) & 1;
+      for (j = 0; j < 2; j++)
+	{
+	  u8 plen = acl_perf_random_prefix_len (seed);
+	  u32 addr = networks[random_u32 (seed) % ARRAY_LEN (networks)] |
+	    (random_u32 (seed) & 0xff);
+	  if (plen < 16)
+	    addr = random_u32 (seed);
+	  addr &= plen ? ~0 << (32 - plen) : 0;
+	  addr = clib_host_to_net_u32 (addr);
+	  if (j == 0)
+	    {
+	      memcpy (r->src_ip_addr, &addr, sizeof (addr));
+	      r->src_ip_prefix_len = plen;
+	    }
+	  else
+	    {
+	      memcpy (r->dst_ip_addr, &addr, sizeof (addr));
+	      r->dst_ip_prefix_len = plen;
+	    }
+	}
+      r->proto = (r_proto < 5) ? IP_PROTOCOL_TCP :
+	(r_proto < 8) ? IP_PROTOCOL_UDP : 0;
+      if (r->proto)
+	{
+	  acl_perf_random_port_range (seed, 0, &first, &last);
+	  r->srcport_or_icmptype_first = clib_host_to_net_u16 (first);
+	  r->srcport_or_icmptype_last = clib_host_to_net_u16 (last);
+	  acl_perf_random_port_range (seed, 1, &first, &last);
+	  r->dstport_or_icmpcode_first = clib_host_to_net_u16 (first);
+	  r->dstport_or_icmpcode_last = clib_host_to_net_u16 (last);
+	}
+      else
+	{
+	  r->dstport_or_icmpcode_last = r->srcport_or_icmptype_last = ~0;
+	}
+    }
+}
+
+/*
+ * Packet headers: most are derived from a random rule, with the
+ * wildcarded bits and the ports randomized within the rule,
+ * the rest is random traffic within the same networks.
+ */
+static void
+acl_perf_make_packets (u32 n_packets, u32 * seed, vl_api_acl_rule_t * rules,
+		       fa_5tuple_t ** packets)
+{
+  u32 i, j;
+
+  vec_validate (*packets, n_packets - 1);
+  for (i = 0; i < n_packets; i++)
+    {
+      fa_5tuple_t *pkt = vec_elt_at_index (*packets, i);
+      vl_api_acl_rule_t *r =
+	vec_elt_at_index (rules, random_u32 (seed) % vec_len (rules));
+      int from_rule = (random_u32 (seed) % 10) != 0;
+      u16 sport_first = 0, sport_last = 65535;
+      u16 dport_first = 0, dport_last = 65535;
+
+      memset (pkt, 0, sizeof (*pkt));
+      for (j = 0; j < 2; j++)
+	{
+	  u8 *rule_addr = j ? r->dst_ip_addr : r->src_ip_addr;
+	  u8 plen = j ? r->dst_ip_prefix_len : r->src_ip_prefix_len;
+	  u32 addr = clib_net_to_host_u32 (*(u32 *) rule_addr);
+	  u32 mask = plen ? ~0 << (32 - plen) : 0;
+	  if (!from_rule)
+	    mask = 0xffff0000;
+	  addr = (addr & mask) | (random_u32 (seed) & ~mask);
+	  pkt->addr[j].ip4.as_u32 = clib_host_to_net_u32 (addr);
+	}
+      pkt->l4.proto = (from_rule && r->proto) ? r->proto :
+	((random_u32 (seed) & 1) ? IP_PROTOCOL_TCP : IP_PROTOCOL_UDP);
+      if (from_rule && r->proto)
+	{
+	  sport_first = clib_net_to_host_u16 (r->srcport_or_icmptype_first);
+	  sport_last = clib_net_to_host_u16 (r->srcport_or_icmptype_last);
+	  dport_first = clib_net_to_host_u16 (r->dstport_or_icmpcode_first);
+	  dport_last = clib_net_to_host_u16 (r->dstport_or_icmpcode_last);
+	}
+      pkt->l4.port[0] =
+	sport_first + random_u32 (seed) % (sport_last - sport_first + 1);
+      pkt->l4.port[1] =
+	dport_first + random_u32 (seed) % (dport_last - dport_first + 1);
+      pkt->pkt.l4_valid = 1;
+      if (pkt->l4.proto == IP_PROTOCOL_TCP)
+	{
+	  pkt->pkt.tcp_flags_valid = 1;
+	  pkt->pkt.tcp_flags = 0x10;
+	}
+    }
+}
+
+static clib_error_t *
+acl_test_aclplugin_lookup_perf_fn (vlib_main_t * vm,
+				   unformat_input_t * input,
+				   vlib_cli_command_t * cmd)
+{
+  acl_main_t *am = &acl_main;
+  clib_error_t *error = 0;
+  u32 n_rules = 1000;
+  u32 n_packets = 100000;
+  u32 n_iterations = 10;
+  u32 n_linear_check = 1000;
+  u32 seed = 0xdeadbeef;
+  u32 initial_seed;
+  vl_api_acl_rule_t *rules = 0;
+  fa_5tuple_t *packets = 0;
+  u32 *results[2] = { 0, 0 };
+  u32 *acl_vec = 0;
+  u32 acl_index = ~0;
+  u32 user_id;
+  int lc_index;
+  int saved_use_tuple_merge = am->use_tuple_merge;
+  int tm, rv;
+  u32 i, it, n_mismatches, n_linear_mismatches = 0;
+  u8 tag[64] = "ACL plugin lookup benchmark";
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "rules %u", &n_rules))
+	;
+      else if (unformat (input, "packets %u", &n_packets))
+	;
+      else if (unformat (input, "iterations %u", &n_iterations))
+	;
+      else if (unformat (input, "linear-check %u", &n_linear_check))
+	;
+      else if (unformat (input, "seed %u", &seed))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+  if (n_rules == 0 || n_packets == 0 || n_iterations == 0)
+    return clib_error_return (0, "rules, packets and iterations must be > 0");
+
+  initial_seed = seed;
+  acl_perf_make_rules (n_rules, &seed, &rules);
+  rv = acl_add_list (n_rules, rules, &acl_index, tag);
+  if (rv)
+    {
+      error = clib_error_return (0, "acl_add_list returned %d", rv);
+      goto done;
+    }
+  acl_perf_make_packets (n_packets, &seed, rules, &packets);
+  vec_add1 (acl_vec, acl_index);
+
+  user_id = acl_plugin_register_user_module ("ACL plugin lookup benchmark",
+					     "iteration", 0);
+  lc_index = acl_plugin_get_lookup_context_index (user_id, 0, 0);
+  if (lc_index < 0)
+    {
+      error = clib_error_return (0, "lookup context allocation failed");
+      goto done;
+    }
+
+  vlib_cli_output (vm, "%d rules, %d packets x %d iterations, seed 0x%x",
+		   n_rules, n_packets, n_iterations, initial_seed);
+  vlib_cli_output (vm, "%-12s %8s %10s %12s %10s %10s", "scheme", "tables",
+		   "max coll.", "probes/pkt", "Mpps", "apply s");
+
+  for (tm = 0; tm < 2; tm++)
+    {
+      u64 n_probes = 0;
+      u32 n_matched = 0;
+      u32 max_collisions = 0;
+      f64 t0, apply_time, lookup_time;
+      applied_hash_acl_info_t *pal;
+      hash_applied_mask_info_t *minfo;
+
+      am->use_tuple_merge = tm;
+      t0 = vlib_time_now (vm);
+      acl_plugin_set_acl_vec_for_context (lc_index, acl_vec);
+      apply_time = vlib_time_now (vm) - t0;
+
+      pal = vec_elt_at_index (am->applied_hash_acl_info_by_lc_index, lc_index);
+      vec_foreach (minfo, pal->mask_info_vec)
+	max_collisions = clib_max (max_collisions, minfo->max_collisions);
+
+      vec_validate (results[tm], n_packets - 1);
+      for (i = 0; i < n_packets; i++)
+	{
+	  u32 probes = 0;
+	  fa_5tuple_t *pkt = &packets[i];
+	  pkt->pkt.lc_index = lc_index;
+	  results[tm][i] =
+	    multi_acl_match_get_applied_ace_index (am, pkt, &probes);
+	  n_probes += probes;
+	}
+
+      t0 = vlib_time_now (vm);
+      for (it = 0; it < n_iterations; it++)
+	for (i = 0; i < n_packets; i++)
+	  {
+	    u8 action;
+	    u32 acl_pos, acl_match, rule_match, trace_bitmap;
+	    n_matched += acl_plugin_match_5tuple_inline (lc_index,
+							 (fa_5tuple_opaque_t
+							  *) & packets[i], 0,
+							 &action, &acl_pos,
+							 &acl_match,
+							 &rule_match,
+							 &trace_bitmap);
+	  }
+      lookup_time = vlib_time_now (vm) - t0;
+
+      vlib_cli_output (vm, "%-12s %8d %10d %12.2f %10.2f %10.3f",
+		       tm ? "tuple-merge" : "mask-type",
+		       vec_len (pal->mask_info_vec), max_collisions,
+		       (f64) n_probes / n_packets,
+		       lookup_time > 0 ?
+		       1e-6 * n_packets * n_iterations / lookup_time : 0.0,
+		       apply_time);
+      if (tm)
+	{
+	  /* compare the first packets against the linear search */
+	  for (i = 0; i < clib_min (n_linear_check, n_packets); i++)
+	    {
+	      u8 action;
+	      u32 acl_pos, acl_match, rule_match = ~0, trace_bitmap;
+	      applied_hash_ace_entry_t *pae;
+	      u32 hash_rule_match = ~0;
+	      if (results[tm][i] != ~0)
+		{
+		  pae = vec_elt_at_index (am->hash_entry_vec_by_lc_index
+					  [lc_index], results[tm][i]);
+		  hash_rule_match = pae->ace_index;
+		}
+	      if (!linear_multi_acl_match_5tuple
+		  (lc_index, &packets[i], 0, &action, &acl_pos, &acl_match,
+		   &rule_match, &trace_bitmap))
+		rule_match = ~0;
+	      n_linear_mismatches += (rule_match != hash_rule_match);
+	    }
+	}
+      acl_plugin_set_acl_vec_for_context (lc_index, 0);
+    }
+
+  n_mismatches = 0;
+  for (i = 0; i < n_packets; i++)
+    n_mismatches += (results[0][i] != results[1][i]);
+  vlib_cli_output (vm, "result mismatches: %d between the schemes, "
+		   "%d of %d vs. linear search", n_mismatches,
+		   n_linear_mismatches, clib_min (n_linear_check, n_packets));
+
+  acl_plugin_put_lookup_context_index (lc_index);
+
+done:
+  am->use_tuple_merge = saved_use_tuple_merge;
+  if (acl_index != ~0)
+    acl_del_list (acl_index);
+  vec_free (rules);
+  vec_free (packets);
+  vec_free (results[0]);
+  vec_free (results[1]);
+  vec_free (acl_vec);
+  return error;
+}
+
+static clib_error_t *
+acl_test_aclplugin_session_perf_fn (vlib_main_t * vm,
+				    unformat_input_t * input,
+				    vlib_cli_command_t * cmd)
+{
+  u32 n_sessions = 100000;
+  u32 idle_timeout = 1;
+  u32 seed = 0xdeadbeef;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "sessions %u", &n_sessions))
+	;
+      else if (unformat (input, "timeout %u", &idle_timeout))
+	;
+      else if (unformat (input, "seed %u", &seed))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+  if (n_sessions == 0 || idle_timeout == 0)
+    return clib_error_return (0, "need at least 1 session and 1 second "
+			      "timeout");
+
+  return acl_fa_session_aging_perf (vm, n_sessions, idle_timeout, seed);
+}
+
+static clib_error_t *
+acl_test_aclplugin_update_perf_fn (vlib_main_t * vm,
+				   unformat_input_t * input,
+				   vlib_cli_command_t * cmd)
+{
+  acl_main_t *am = &acl_main;
+  clib_error_t *error = 0;
+  u32 n_rules = 1000;
+  u32 n_contexts = 10;
+  u32 n_updates = 100;
+  u32 n_linear_check = 1000;
+  u32 seed = 0xdeadbeef;
+  u32 initial_seed;
+  vl_api_acl_rule_t *rules = 0;
+  vl_api_acl_rule_t *tail_rules = 0;
+  vl_api_acl_rule_t *new_rule = 0;
+  fa_5tuple_t *packets = 0;
+  u32 *lc_indices = 0;
+  u32 *acl_vec = 0;
+  u32 acl_index = ~0;
+  u32 tail_acl_index = ~0;
+  u32 user_id;
+  u32 n_mask_types;
+  u32 i, u, n_linear_mismatches = 0, n_hash_mismatches = 0;
+  int is_full, rv;
+  f64 t0, dt, total[2] = { 0, 0 }, max[2] = { 0, 0};
+  u8 tag[64] = "ACL plugin update benchmark";
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "rules %u", &n_rules))
+	;
+      else if (unformat (input, "contexts %u", &n_contexts))
+	;
+      else if (unformat (input, "updates %u", &n_updates))
+	;
+      else if (unformat (input, "linear-check %u", &n_linear_check))
+	;
+      else if (unformat (input, "seed %u", &seed))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+  if (n_rules < 2 || n_contexts == 0 || n_updates == 0)
+    return clib_error_return (0, "need at least 2 rules, 1 context and "
+			      "1 update");
+
+  initial_seed = seed;
+  n_mask_types = pool_elts (am->ace_mask_type_pool);
+  acl_perf_make_rules (n_rules, &seed, &rules);
+  acl_perf_make_rules (100, &seed, &tail_rules);
+  acl_perf_make_rules (n_updates, &seed, &new_rule);
+  if ((rv = acl_add_list (vec_len (rules), rules, &acl_index, tag)) ||
+      (rv = acl_add_list (vec_len (tail_rules), tail_rules, &tail_acl_index,
+			  tag)))
+    {
+      error = clib_error_return (0, "acl_add_list returned %d", rv);
+      goto done;
+    }
+  vec_add1 (acl_vec, acl_index);
+  vec_add1 (acl_vec, tail_acl_index);
+
+  user_id = acl_plugin_register_user_module ("ACL plugin update benchmark",
+					     "context", 0);
+  for (i = 0; i < n_contexts; i++)
+    {
+      int lc_index = acl_plugin_get_lookup_context_index (user_id, i, 0);
+      if (lc_index < 0)
+	{
+	  error = clib_error_return (0, "lookup context allocation failed");
+	  goto done;
+	}
+      vec_add1 (lc_indices, lc_index);
+      acl_plugin_set_acl_vec_for_context (lc_index, acl_vec);
+    }
+
+  vlib_cli_output (vm, "%d+%d rules applied to %d lookup contexts, "
+		   "%d single rule updates, seed 0x%x", n_rules,
+		   vec_len (tail_rules), n_contexts, n_updates,
+		   initial_seed);
+
+  /*
+   * Each update replaces, inserts or deletes one random rule.
+   * The incremental path is the one taken by acl_add_list, the full
+   * path is the one taken before: delete and re-add the hash ACL,
+   * reapplying it to all the lookup contexts.
+   */
+  for (is_full = 0; is_full < 2; is_full++)
+    {
+      for (u = 0; u < n_updates; u++)
+	{
+	  u32 k = random_u32 (&seed) % vec_len (rules);
+	  u32 op = random_u32 (&seed) % 4;
+	  if (op < 2)
+	    rules[k] = new_rule[u];
+	  else if (op == 2)
+	    vec_insert_elts (rules, &new_rule[u], 1, k);
+	  else if (vec_len (rules) > 1)
+	    vec_delete (rules, 1, k);
+
+	  t0 = vlib_time_now (vm);
+	  if (is_full)
+	    {
+	      acl_list_t *a = pool_elt_at_index (am->acls, acl_index);
+	      /* replace the rules without the notification... */
+	      void *oldheap = acl_set_heap (am);
+	      vec_free (a->rules);
+	      vec_validate (a->rules, vec_len (rules) - 1);
+	      clib_mem_set_heap (oldheap);
+	      a->count = vec_len (rules);
+	      for (i = 0; i < vec_len (rules); i++)
+		{
+		  acl_rule_t *r = &a->rules[i];
+		  memset (r, 0, sizeof (*r));
+		  r->is_permit = rules[i].is_permit;
+		  memcpy (&r->src.ip4, rules[i].src_ip_addr,
+			  sizeof (r->src.ip4));
+		  memcpy (&r->dst.ip4, rules[i].dst_ip_addr,
+			  sizeof (r->dst.ip4));
+		  r->src_prefixlen = rules[i].src_ip_prefix_len;
+		  r->dst_prefixlen = rules[i].dst_ip_prefix_len;
+		  r->proto = rules[i].proto;
+		  r->src_port_or_type_first =
+		    ntohs (rules[i].srcport_or_icmptype_first);
+		  r->src_port_or_type_last =
+		    ntohs (rules[i].srcport_or_icmptype_last);
+		  r->dst_port_or_code_first =
+		    ntohs (rules[i].dstport_or_icmpcode_first);
+		  r->dst_port_or_code_last =
+		    ntohs (rules[i].dstport_or_icmpcode_last);
+		}
+	      t0 = vlib_time_now (vm);
+	      /* ... and take the path the notification used to take */
+	      hash_acl_delete (am, acl_index);
+	      hash_acl_add (am, acl_index);
+	    }
+	  else
+	    {
+	      rv = acl_add_list (vec_len (rules), rules, &acl_index, tag);
+	      if (rv)
+		{
+		  error = clib_error_return (0, "acl_add_list returned %d",
+					     rv);
+		  goto done;
+		}
+	    }
+	  dt = vlib_time_now (vm) - t0;
+	  total[is_full] += dt;
+	  max[is_full] = clib_max (max[is_full], dt);
+	}
+
+      /* check the lookups in the first and the last context */
+      vec_free (packets);
+      acl_perf_make_packets (clib_max (n_linear_check, 1), &seed, rules,
+			     &packets);
+      for (i = 0; i < vec_len (packets); i++)
+	{
+	  u8 action;
+	  u32 acl_pos, rule_match[2], trace_bitmap;
+	  u32 hash_acl_match[2];
+	  int j;
+	  for (j = 0; j < 2; j++)
+	    {
+	      u32 lc_index = j ? lc_indices[vec_len (lc_indices) - 1] :
+		lc_indices[0];
+	      packets[i].pkt.lc_index = lc_index;
+	      if (!hash_multi_acl_match_5tuple
+		  (lc_index, &packets[i], 0, &action, &acl_pos,
+		   &hash_acl_match[j], &rule_match[j], &trace_bitmap))
+		hash_acl_match[j] = rule_match[j] = ~0;
+	    }
+	  n_hash_mismatches += (rule_match[0] != rule_match[1]) ||
+	    (hash_acl_match[0] != hash_acl_match[1]);
+	  if (i < n_linear_check)
+	    {
+	      u32 linear_acl_match, linear_rule_match;
+	      if (!linear_multi_acl_match_5tuple
+		  (lc_indices[0], &packets[i], 0, &action, &acl_pos,
+		   &linear_acl_match, &linear_rule_match, &trace_bitmap))
+		linear_acl_match = linear_rule_match = ~0;
+	      n_linear_mismatches += (linear_rule_match != rule_match[0]) ||
+		(linear_acl_match != hash_acl_match[0]);
+	    }
+	}
+
+      vlib_cli_output (vm, "%-12s avg %10.3f ms  max %10.3f ms",
+		       is_full ? "full" : "incremental",
+		       1e3 * total[is_full] / n_updates,
+		       1e3 * max[is_full]);
+    }
+  vlib_cli_output (vm, "result mismatches: %d between the contexts, "
+		   "%d of %d vs. linear search", n_hash_mismatches,
+		   n_linear_mismatches, 2 * n_linear_check);
+
+done:
+  for (i = 0; i < vec_len (lc_indices); i++)
+    acl_plugin_put_lookup_context_index (lc_indices[i]);
+  if (acl_index != ~0)
+    acl_del_list (acl_index);
+  if (tail_acl_index != ~0)
+    acl_del_list (tail_acl_index);
+  if (pool_elts (am->ace_mask_type_pool) != n_mask_types)
+    vlib_cli_output (vm, "mask types leaked: %d before, %d after",
+		     n_mask_types, pool_elts (am->ace_mask_type_pool));
+  vec_free (rules);
+  vec_free (tail_rules);
+  vec_free (new_rule);
+  vec_free (packets);
+  vec_free (lc_indices);
+  vec_free (acl_vec);
+  return error;
+}
+
 static clib_error_t *
 acl_clear_aclplugin_fn (vlib_main_t * vm,
 			unformat_input_t * input, vlib_cli_command_t * cmd)
@@ -4008,7 +4609,7 @@ acl_clear_aclplugin_fn (vlib_main_t * vm,
  /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (aclplugin_set_command, static) = {
     .path = "set acl-plugin",
-    .short_help = "set acl-plugin session timeout {{udp idle}|tcp {idle|transient}} <seconds>",
+    .short_help = "set acl-plugin {use-tuple-merge <0|1>|tuple-merge-split-threshold <n>|session timeout {{udp idle}|tcp {idle|transient}} <seconds>}",
     .function = acl_set_aclplugin_fn,
 };
 
@@ -4077,6 +4678,223 @@ VLIB_CLI_COMMAND (aclplugin_clear_command, static) = {
     .short_help = "clear acl-plugin sessions",
     .function = acl_clear_aclplugin_fn,
 };
+
+/*?
+ * Benchmark the hash-based ACL lookup with a synthetic ClassBench-style
+ * rule set, once with one lookup table per distinct mask type and once
+ * with the compatible mask types merged (tuple merge). Reports the number
+ * of lookup tables, the longest collision chain, the hash probes per packet,
+ * the lookup rate and the time to apply the ACL, and checks that both schemes
+ * and the linear search return the same rule.
+ *
+ * @cliexpar
+ * @cliexstart{test acl-plugin lookup-perf rules 10000 packets 100000}
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (aclplugin_test_lookup_perf_command, static) = {
+    .path = "test acl-plugin lookup-perf",
+    .short_help = "test acl-plugin lookup-perf [rules <n>] [packets <n>] [iterations <n>] [linear-check <n>] [seed <n>]",
+    .function = acl_test_aclplugin_lookup_perf_fn,
+};
+
+/*?
+ * Measure the latency of the single rule updates (replace, insert or
+ * delete one rule) of an ACL applied to a number of lookup contexts,
+ * for the incremental update path used by the ACL replace API and for
+ * the full delete and re-apply of the hash ACL, then check the lookups
+ * against the linear search.
+ *
+ * @cliexpar
+ * @cliexstart{test acl-plugin update-perf rules 10000 contexts 100}
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (aclplugin_test_update_perf_command, static) = {
+    .path = "test acl-plugin update-perf",
+    .short_help = "test acl-plugin update-perf [rules <n>] [contexts <n>] [updates <n>] [linear-check <n>] [seed <n>]",
+    .function = acl_test_aclplugin_update_perf_fn,
+};
+
+/*?
+ * Create a number of UDP sessions on local0, owned by the main thread,
+ * and wait for them to be aged out by the session timer wheel. Reports
+ * the session creation rate, the aging delay and the CPU time spent
+ * in the cleaner per aged session.
+ *
+ * @cliexpar
+ * @cliexstart{test acl-plugin session-perf sessions 1000000 timeout 2}
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (aclplugin_test_session_perf_command, static) = {
+    .path = "test acl-plugin session-perf",
+    .short_help = "test acl-plugin session-perf [sessions <n>] [timeout <sec>] [seed <n>]",
+    .function = acl_test_aclplugin_session_perf_fn,
+};
+/* *INDENT-ON* */
+
+static void
+acl_snapshot_save (serialize_main_t * m, va_list * va)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  acl_main_t *am = &acl_main;
+  acl_list_t *a;
+  acl_rule_t *r;
+  u32 ***pvecs, **pv, *acls, sw_if_index, n;
+  int is_input;
+
+  serialize_integer (m, pool_elts (am->acls), sizeof (u32));
+  /* *INDENT-OFF* */
+  pool_foreach (a, am->acls,
+  ({
+    serialize_integer (m, a - am->acls, sizeof (u32));
+    serialize_multiple (m, a->tag, sizeof (u8), sizeof (u8),
+			sizeof (a->tag));
+    serialize_integer (m, vec_len (a->rules), sizeof (u32));
+    vec_foreach (r, a->rules)
+      {
+	serialize_integer (m, r->is_permit, sizeof (u8));
+	serialize_integer (m, r->is_ipv6, sizeof (u8));
+	vnet_snapshot_serialize_ip46_address (m, &r->src);
+	serialize_integer (m, r->src_prefixlen, sizeof (u8));
+	vnet_snapshot_serialize_ip46_address (m, &r->dst);
+	serialize_integer (m, r->dst_prefixlen, sizeof (u8));
+	serialize_integer (m, r->proto, sizeof (u8));
+	serialize_integer (m, r->src_port_or_type_first, sizeof (u16));
+	serialize_integer (m, r->src_port_or_type_last, sizeof (u16));
+	serialize_integer (m, r->dst_port_or_code_first, sizeof (u16));
+	serialize_integer (m, r->dst_port_or_code_last, sizeof (u16));
+	serialize_integer (m, r->tcp_flags_value, sizeof (u8));
+	serialize_integer (m, r->tcp_flags_mask, sizeof (u8));
+      }
+    snm->n_objects++;
+  }));
+  /* *INDENT-ON* */
+
+  for (is_input = 0; is_input < 2; is_input++)
+    {
+      pvecs = is_input ? &am->input_acl_vec_by_sw_if_index :
+	&am->output_acl_vec_by_sw_if_index;
+      n = 0;
+      vec_foreach (pv, *pvecs) n += vec_len (*pv) > 0;
+
+      serialize_integer (m, n, sizeof (u32));
+      for (sw_if_index = 0; sw_if_index < vec_len (*pvecs); sw_if_index++)
+	{
+	  acls = (*pvecs)[sw_if_index];
+	  if (vec_len (acls) == 0)
+	    continue;
+	  vnet_snapshot_serialize_sw_if_index (m, sw_if_index);
+	  vec_serialize (m, acls, serialize_vec_32);
+	  snm->n_objects++;
+	}
+    }
+}
+
+static void
+acl_snapshot_restore (serialize_main_t * m, va_list * va)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  acl_main_t *am = &acl_main;
+  vl_api_acl_rule_t *api_rules = 0, *api_rule;
+  acl_rule_t r;
+  uword *acl_index_by_saved_index = 0, *p;
+  u32 i, j, n, n_rules, saved_index, acl_index, sw_if_index;
+  u32 *acls, *new_acls = 0;
+  u8 tag[64];
+  int is_input, may_clear_sessions = 1, missing;
+  void *oldheap;
+
+  unserialize_integer (m, &n, sizeof (u32));
+  for (i = 0; i < n; i++)
+    {
+      unserialize_integer (m, &saved_index, sizeof (u32));
+      unserialize_multiple (m, tag, sizeof (u8), sizeof (u8), sizeof (tag));
+      unserialize_integer (m, &n_rules, sizeof (u32));
+      vec_reset_length (api_rules);
+      for (j = 0; j < n_rules; j++)
+	{
+	  memset (&r, 0, sizeof (r));
+	  unserialize_integer (m, &r.is_permit, sizeof (u8));
+	  unserialize_integer (m, &r.is_ipv6, sizeof (u8));
+	  vnet_snapshot_unserialize_ip46_address (m, &r.src);
+	  unserialize_integer (m, &r.src_prefixlen, sizeof (u8));
+	  vnet_snapshot_unserialize_ip46_address (m, &r.dst);
+	  unserialize_integer (m, &r.dst_prefixlen, sizeof (u8));
+	  unserialize_integer (m, &r.proto, sizeof (u8));
+	  unserialize_integer (m, &r.src_port_or_type_first, sizeof (u16));
+	  unserialize_integer (m, &r.src_port_or_type_last, sizeof (u16));
+	  unserialize_integer (m, &r.dst_port_or_code_first, sizeof (u16));
+	  unserialize_integer (m, &r.dst_port_or_code_last, sizeof (u16));
+	  unserialize_integer (m, &r.tcp_flags_value, sizeof (u8));
+	  unserialize_integer (m, &r.tcp_flags_mask, sizeof (u8));
+	  vec_add2 (api_rules, api_rule, 1);
+	  copy_acl_rule_to_api_rule (api_rule, &r);
+	}
+
+      acl_index = ~0;
+      if (acl_add_list (n_rules, api_rules, &acl_index, tag))
+	{
+	  snm->n_skipped++;
+	  continue;
+	}
+      hash_set (acl_index_by_saved_index, saved_index, acl_index);
+      snm->n_objects++;
+    }
+
+  for (is_input = 0; is_input < 2; is_input++)
+    {
+      unserialize_integer (m, &n, sizeof (u32));
+      for (i = 0; i < n; i++)
+	{
+	  missing = vnet_snapshot_unserialize_sw_if_index (m, &sw_if_index);
+	  vec_unserialize (m, &acls, unserialize_vec_32);
+
+	  vec_reset_length (new_acls);
+	  for (j = 0; j < vec_len (acls); j++)
+	    {
+	      p = hash_get (acl_index_by_saved_index, acls[j]);
+	      if (!p)
+		{
+		  missing = 1;
+		  break;
+		}
+	      vec_add1 (new_acls, p[0]);
+	    }
+	  vec_free (acls);
+
+	  if (missing || sw_if_index == ~0)
+	    {
+	      snm->n_skipped++;
+	      continue;
+	    }
+
+	  oldheap = acl_set_heap (am);
+	  if (acl_interface_set_inout_acl_list (am, sw_if_index, is_input,
+						new_acls,
+						&may_clear_sessions))
+	    snm->n_skipped++;
+	  else
+	    snm->n_objects++;
+	  clib_mem_set_heap (oldheap);
+	}
+    }
+
+  hash_free (acl_index_by_saved_index);
+  vec_free (new_acls);
+  vec_free (api_rules);
+}
+
+/*
+ * ACLs are recreated in their saved order, so they normally get their
+ * saved indices back, and interface bindings are remapped otherwise.
+ * MACIP ACLs are not saved.
+ */
+/* *INDENT-OFF* */
+VNET_SNAPSHOT_SECTION (acl) = {
+  .name = "acl",
+  .order = VNET_SNAPSHOT_ORDER_FEATURE,
+  .save = acl_snapshot_save,
+  .restore = acl_snapshot_restore,
+};
 /* *INDENT-ON* */
 
 static clib_error_t *
@@ -4091,6 +4909,8 @@ acl_plugin_config (vlib_main_t * vm, unformat_input_t * input)
   u32 hash_lookup_hash_buckets;
   u32 hash_lookup_hash_memory;
   u32 reclassify_sessions;
+  u32 use_tuple_merge;
+  u32 tuple_merge_split_threshold;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
@@ -4122,6 +4942,11 @@ acl_plugin_config (vlib_main_t * vm, unformat_input_t * input)
       else if (unformat (input, "reclassify sessions %d",
 			 &reclassify_sessions))
 	am->reclassify_sessions = reclassify_sessions;
+      else if (unformat (input, "use tuple merge %d", &use_tuple_merge))
+	am->use_tuple_merge = use_tuple_merge;
+      else if (unformat (input, "tuple merge split threshold %d",
+			 &tuple_merge_split_threshold))
+	am->tuple_merge_split_threshold = tuple_merge_split_threshold;
 
       else
 	return clib_error_return (0, "unknown input '%U'",
@@ -4161,6 +4986,8 @@ acl_init (vlib_main_t * vm)
 
   am->hash_lookup_hash_buckets = ACL_PLUGIN_HASH_LOOKUP_HASH_BUCKETS;
   am->hash_lookup_hash_memory = ACL_PLUGIN_HASH_LOOKUP_HASH_MEMORY;
+  am->use_tuple_merge = 1;
+  am->tuple_merge_split_threshold = ACL_PLUGIN_TUPLE_MERGE_SPLIT_THRESHOLD;
 
   am->session_timeout_sec[ACL_TIMEOUT_TCP_TRANSIENT] =
     TCP_SESSION_TRANSIENT_TIMEOUT_SEC;
@@ -4190,15 +5017,12 @@ acl_init (vlib_main_t * vm)
 	    pw->fa_conn_list_head[tt] = ~0;
 	    pw->fa_conn_list_tail[tt] = ~0;
 	  }
+	pw->clear_session_index = ~0;
       }
   }
 
-  am->fa_min_deleted_sessions_per_interval =
-    ACL_FA_DEFAULT_MIN_DELETED_SESSIONS_PER_INTERVAL;
-  am->fa_max_deleted_sessions_per_interval =
-    ACL_FA_DEFAULT_MAX_DELETED_SESSIONS_PER_INTERVAL;
-  am->fa_cleaner_wait_time_increment =
-    ACL_FA_DEFAULT_CLEANER_WAIT_TIME_INCREMENT;
+  am->fa_max_expired_sessions_per_run =
+    ACL_FA_DEFAULT_MAX_EXPIRED_SESSIONS_PER_RUN;
 
   am->fa_cleaner_cnt_delete_by_sw_index = 0;
   am->fa_cleaner_cnt_delete_by_sw_index_ok = 0;
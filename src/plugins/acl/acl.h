@@ -21,6 +21,7 @@
 
 
 #include <vppinfra/hash.h>
+#include <vppinfra/mhash.h>
 #include <vppinfra/error.h>
 #include <vppinfra/bitmap.h>
 #include <vppinfra/elog.h>
@@ -41,6 +42,8 @@
 #define ACL_PLUGIN_HASH_LOOKUP_HEAP_SIZE (2 << 25)
 #define ACL_PLUGIN_HASH_LOOKUP_HASH_BUCKETS 65536
 #define ACL_PLUGIN_HASH_LOOKUP_HASH_MEMORY (2 << 25)
+/* max. number of rules sharing one key in a merged (relaxed) lookup table */
+#define ACL_PLUGIN_TUPLE_MERGE_SPLIT_THRESHOLD 39
 
 extern vlib_node_registration_t acl_in_node;
 extern vlib_node_registration_t acl_out_node;
@@ -207,8 +210,15 @@ typedef struct {
   /* Do we use hash-based ACL matching or linear */
   int use_hash_acl_matching;
 
+  /* Do we merge the compatible mask types into fewer lookup tables */
+  int use_tuple_merge;
+  /* Collision chain length at which a merged table is not used anymore */
+  u32 tuple_merge_split_threshold;
+
   /* a pool of all mask types present in all ACEs */
   ace_mask_type_entry_t *ace_mask_type_pool;
+  /* mask type index by the mask, to find the existing mask types quickly */
+  mhash_t ace_mask_type_index_by_mask;
 
   /*
    * Classify tables used to grab the packets for the ACL check,
@@ -278,27 +288,19 @@ typedef struct {
   int trace_acl;
 
   /*
-   * If the cleaner has to delete more than this number
-   * of connections, it halves the sleep time.
+   * The sessions are aged by the per-worker timer wheels, which tick
+   * every ACL_FA_TW_TICK seconds and expire at most
+   * fa_max_expired_sessions_per_run timers in one run of the cleaner.
    */
+#define ACL_FA_TW_TICK 0.01
+#define ACL_FA_DEFAULT_MAX_EXPIRED_SESSIONS_PER_RUN 4096
+  u32 fa_max_expired_sessions_per_run;
 
-#define ACL_FA_DEFAULT_MAX_DELETED_SESSIONS_PER_INTERVAL 100
-  u64 fa_max_deleted_sessions_per_interval;
-
-  /*
-   * If the cleaner deletes less than these connections,
-   * it increases the wait time by the "increment"
-   */
-
-#define ACL_FA_DEFAULT_MIN_DELETED_SESSIONS_PER_INTERVAL 1
-  u64 fa_min_deleted_sessions_per_interval;
-
-#define ACL_FA_DEFAULT_CLEANER_WAIT_TIME_INCREMENT 0.1
-  f64 fa_cleaner_wait_time_increment;
-
-  u64 fa_current_cleaner_timer_wait_interval;
+  /* How often the aged sessions per second rate is recalculated */
+#define ACL_FA_AGING_RATE_INTERVAL 1.0
 
-  int fa_interrupt_generation;
+  /* The per-worker cleaner input node */
+  u32 fa_worker_cleaner_node_index;
 
   /* per-worker data related t conn management */
   acl_fa_per_worker_data_t *per_worker_data;
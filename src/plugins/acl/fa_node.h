@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <vppinfra/bihash_40_8.h>
+#include <vppinfra/tw_timer_1t_3w_1024sl_ov.h>
 
 // #define FA_NODE_VERBOSE_DEBUG 3
 
@@ -72,7 +73,8 @@ typedef struct {
   u32 link_prev_idx;      /* +4 bytes = 12 */
   u32 link_next_idx;      /* +4 bytes = 16 */
   u8 link_list_id;        /* +1 bytes = 17 */
-  u8 reserved1[7];        /* +7 bytes = 24 */
+  u8 reserved1[3];        /* +3 bytes = 20 */
+  u32 timer_handle;       /* +4 bytes = 24 */
   u64 reserved2[5];       /* +5*8 bytes = 64 */
 } fa_session_t;
 
@@ -115,7 +117,7 @@ CT_ASSERT_EQUAL(fa_full_session_id_size_is_64, sizeof(fa_full_session_id_t), siz
 typedef struct {
   /* The pool of sessions managed by this worker */
   fa_session_t *fa_sessions_pool;
-  /* per-worker ACL_N_TIMEOUTS of conn lists */
+  /* per-worker ACL_N_TIMEOUTS of conn lists, oldest session at the head */
   u32 *fa_conn_list_head;
   u32 *fa_conn_list_tail;
   /* adds and deletes per-worker-per-interface */
@@ -123,45 +125,39 @@ typedef struct {
   u64 *fa_session_adds_by_sw_if_index;
   /* sessions deleted due to epoch change */
   u64 *fa_session_epoch_change_by_sw_if_index;
-  /* Vector of expired connections retrieved from lists */
+  /* Idle timers of the sessions owned by this worker */
+  tw_timer_wheel_1t_3w_1024sl_ov_t session_timer_wheel;
+  /* Vector of expired session timers retrieved from the wheel */
   u32 *expired;
-  /* the earliest next expiry time */
-  u64 next_expiry_time;
-  /* if not zero, look at all the elements until their enqueue timestamp is after below one */
-  u64 requeue_until_time;
-  /* Current time between the checks */
-  u64 current_time_wait_interval;
+  /* Vector of session indices to delete in one batch */
+  u32 *to_delete;
   /* Counter of how many sessions we did delete */
   u64 cnt_deleted_sessions;
   /* Counter of already deleted sessions being deleted - should not increment unless a bug */
   u64 cnt_already_deleted_sessions;
-  /* Number of times we requeued a session to a head of the list */
+  /* Number of times a session timer was restarted */
   u64 cnt_session_timer_restarted;
-  /* swipe up to this enqueue time, rather than following the timeouts */
-  u64 swipe_end_time;
+  /* Sessions deleted because their idle timeout has passed */
+  u64 cnt_aged_sessions;
+  /* Aged sessions per second, recalculated every ACL_FA_AGING_RATE_INTERVAL */
+  u64 cnt_aged_sessions_last;
+  f64 aged_sessions_rate_time;
+  f64 aged_sessions_per_sec;
+  /* Runs of the cleaner which had work to do, and the CPU clocks spent there */
+  u64 cnt_cleaner_runs;
+  u64 cleaner_cpu_clocks;
   /* bitmap of sw_if_index serviced by this worker */
   uword *serviced_sw_if_index_bitmap;
   /* bitmap of sw_if_indices to clear. set by main thread, cleared by worker */
   uword *pending_clear_sw_if_index_bitmap;
-  /* atomic, indicates that the swipe-deletion of connections is in progress */
+  /* atomic, indicates that the deletion of connections by sw_if_index is in progress */
   u32 clear_in_process;
-  /* Interrupt is pending from main thread */
+  /* session pool index to continue the clearing from */
+  u32 clear_session_index;
+  /* The cleaner node of this worker is scheduled to run */
   int interrupt_is_pending;
-  /*
-   * Interrupt node on the worker thread sets this if it knows there is
-   * more work to do, but it has to finish to avoid hogging the
-   * core for too long.
-   */
-  int interrupt_is_needed;
-  /*
-   * Set to indicate that the interrupt node wants to get less interrupts
-   * because there is not enough work for the current rate.
-   */
-  int interrupt_is_unwanted;
-  /*
-   * Set to copy of a "generation" counter in main thread so we can sync the interrupts.
-   */
-  int interrupt_generation;
+  /* The cleaner node of this worker polls its timer wheel */
+  int cleaner_is_polling;
 } acl_fa_per_worker_data_t;
 
 
@@ -181,6 +177,9 @@ void acl_fa_enable_disable(u32 sw_if_index, int is_input, int enable_disable);
 
 void show_fa_sessions_hash(vlib_main_t * vm, u32 verbose);
 
+clib_error_t *acl_fa_session_aging_perf (vlib_main_t * vm, u32 n_sessions,
+                                         u32 idle_timeout, u32 seed);
+
 u8 *format_acl_plugin_5tuple (u8 * s, va_list * args);
 
 /* use like: elog_acl_maybe_trace_X1(am, "foobar: %d", "i4", int32_value); */
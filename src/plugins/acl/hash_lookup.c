@@ -63,14 +63,25 @@ fill_applied_hash_ace_kv(acl_main_t *am,
   hash_acl_lookup_value_t *kv_val = (hash_acl_lookup_value_t *)&kv->value;
   applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), new_index);
   hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, pae->acl_index);
+  hash_ace_info_t *hi = vec_elt_at_index(ha->rules, pae->hash_ace_info_index);
+  ace_mask_type_entry_t *mte = pool_elt_at_index(am->ace_mask_type_pool, pae->mask_type_index);
+  u64 *pmatch = (u64 *)&hi->match;
+  u64 *pmask = (u64 *)&mte->mask;
+  u64 *pkey = (u64 *)kv_key;
+  int j;
 
-  memcpy(kv_key, &(vec_elt_at_index(ha->rules, pae->hash_ace_info_index)->match), sizeof(*kv_key));
+  /* the rule may be hashed into a table with a less specific mask */
+  for(j=0; j<6; j++) {
+    pkey[j] = pmatch[j] & pmask[j];
+  }
+  kv_key->pkt.mask_type_index_lsb = pae->mask_type_index;
   /* initialize the sw_if_index and direction */
   kv_key->pkt.lc_index = lc_index;
   kv_val->as_u64 = 0;
   kv_val->applied_entry_index = new_index;
-  kv_val->need_portrange_check = vec_elt_at_index(ha->rules, pae->hash_ace_info_index)->src_portrange_not_powerof2 ||
-				   vec_elt_at_index(ha->rules, pae->hash_ace_info_index)->dst_portrange_not_powerof2;
+  kv_val->need_exact_check = hi->src_portrange_not_powerof2 ||
+			     hi->dst_portrange_not_powerof2 ||
+			     (pae->mask_type_index != hi->mask_type_index);
   /* by default assume all values are shadowed -> check all mask types */
   kv_val->shadowed = 1;
 }
@@ -112,7 +123,12 @@ activate_applied_ace_hash_entry(acl_main_t *am,
   ASSERT(new_index != ~0);
   ASSERT(new_index < vec_len((*applied_hash_aces)));
   if (res == 0) {
-    /* There already exists an entry or more. Append at the end. */
+    /*
+     * There already exists an entry or more. The chain is kept in
+     * the ascending order of the applied entry index, so normally
+     * we append at the end, but an incremental ACL update may insert
+     * entries in front of the existing ones.
+     */
     u32 first_index = result_val->applied_entry_index;
     ASSERT(first_index != ~0);
     DBG("A key already exists, with applied entry index: %d", first_index);
@@ -120,12 +136,35 @@ activate_applied_ace_hash_entry(acl_main_t *am,
     u32 last_index = first_pae->tail_applied_entry_index;
     ASSERT(last_index != ~0);
     applied_hash_ace_entry_t *last_pae = vec_elt_at_index((*applied_hash_aces), last_index);
-    DBG("...advance to chained entry index: %d", last_index);
-    /* link ourseves in */
-    last_pae->next_applied_entry_index = new_index;
-    pae->prev_applied_entry_index = last_index;
-    /* adjust the pointer to the new tail */
-    first_pae->tail_applied_entry_index = new_index;
+    if (last_index < new_index) {
+      DBG("...advance to chained entry index: %d", last_index);
+      /* link ourseves in */
+      last_pae->next_applied_entry_index = new_index;
+      pae->prev_applied_entry_index = last_index;
+      /* adjust the pointer to the new tail */
+      first_pae->tail_applied_entry_index = new_index;
+    } else if (new_index < first_index) {
+      DBG("...insert in front of the chain head %d", first_index);
+      pae->next_applied_entry_index = first_index;
+      pae->tail_applied_entry_index = last_index;
+      first_pae->prev_applied_entry_index = new_index;
+      first_pae->tail_applied_entry_index = ~0;
+      /* the hash now needs to point to the new head */
+      hashtable_add_del(am, &kv, 1);
+    } else {
+      u32 prev_index = first_index;
+      applied_hash_ace_entry_t *prev_pae = first_pae;
+      while (prev_pae->next_applied_entry_index < new_index) {
+        prev_index = prev_pae->next_applied_entry_index;
+        prev_pae = vec_elt_at_index((*applied_hash_aces), prev_index);
+      }
+      DBG("...insert after the chained entry index: %d", prev_index);
+      applied_hash_ace_entry_t *next_pae = vec_elt_at_index((*applied_hash_aces), prev_pae->next_applied_entry_index);
+      pae->next_applied_entry_index = prev_pae->next_applied_entry_index;
+      pae->prev_applied_entry_index = prev_index;
+      next_pae->prev_applied_entry_index = new_index;
+      prev_pae->next_applied_entry_index = new_index;
+    }
   } else {
     /* It's the very first entry */
     hashtable_add_del(am, &kv, 1);
@@ -193,6 +232,15 @@ acl_plugin_hash_acl_set_trace_heap(int on)
   }
 }
 
+static u32
+assign_applied_mask_type_index(acl_main_t *am, u32 lc_index,
+                               applied_hash_ace_entry_t **applied_hash_aces,
+                               u32 index);
+static void
+release_mask_type_index(acl_main_t *am, u32 mask_type_index);
+static void
+hash_acl_build_applied_mask_info(acl_main_t *am, u32 lc_index);
+
 void
 hash_acl_apply(acl_main_t *am, u32 lc_index, int acl_index, u32 acl_position)
 {
@@ -237,8 +285,6 @@ hash_acl_apply(acl_main_t *am, u32 lc_index, int acl_index, u32 acl_position)
   }
   vec_add1((*hash_acl_applied_lc_index), lc_index);
 
-  pal->mask_type_index_bitmap = clib_bitmap_or(pal->mask_type_index_bitmap,
-                                     ha->mask_type_index_bitmap);
   /*
    * if the applied ACL is empty, the current code will cause a
    * different behavior compared to current linear search: an empty ACL will
@@ -266,9 +312,14 @@ hash_acl_apply(acl_main_t *am, u32 lc_index, int acl_index, u32 acl_position)
     pae->next_applied_entry_index = ~0;
     pae->prev_applied_entry_index = ~0;
     pae->tail_applied_entry_index = ~0;
+    pae->mask_type_index = assign_applied_mask_type_index(am, lc_index, applied_hash_aces, new_index);
     activate_applied_ace_hash_entry(am, lc_index, applied_hash_aces, new_index);
   }
   applied_hash_entries_analyze(am, applied_hash_aces);
+
+  /* Update the lookup tables with which the lookup needs
+     to happen for the ACLs applied to this lc_index */
+  hash_acl_build_applied_mask_info(am, lc_index);
 done:
   clib_mem_set_heap (oldheap);
 }
@@ -325,6 +376,10 @@ move_applied_ace_hash_entry(acl_main_t *am,
      */
     u32 head_index = find_head_applied_ace_index(applied_hash_aces, old_index);
     ASSERT(head_index != ~0);
+    if (head_index == old_index) {
+      /* the only entry in the chain, which has already been copied */
+      head_index = new_index;
+    }
     applied_hash_ace_entry_t *head_pae = vec_elt_at_index((*applied_hash_aces), head_index);
 
     ASSERT(head_pae->tail_applied_entry_index == old_index);
@@ -388,29 +443,6 @@ deactivate_applied_ace_hash_entry(acl_main_t *am,
 }
 
 
-static void
-hash_acl_build_applied_lookup_bitmap(acl_main_t *am, u32 lc_index)
-{
-  int i;
-  uword *new_lookup_bitmap = 0;
-
-  applied_hash_acl_info_t **applied_hash_acls = &am->applied_hash_acl_info_by_lc_index;
-  vec_validate((*applied_hash_acls), lc_index);
-  applied_hash_acl_info_t *pal = vec_elt_at_index((*applied_hash_acls), lc_index);
-
-  for(i=0; i < vec_len(pal->applied_acls); i++) {
-    u32 a_acl_index = *vec_elt_at_index((pal->applied_acls), i);
-    hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, a_acl_index);
-    DBG("Update bitmask = %U or %U (acl_index %d)\n", format_bitmap_hex, new_lookup_bitmap,
-          format_bitmap_hex, ha->mask_type_index_bitmap, a_acl_index);
-    new_lookup_bitmap = clib_bitmap_or(new_lookup_bitmap,
-                                       ha->mask_type_index_bitmap);
-  }
-  uword *old_lookup_bitmap = pal->mask_type_index_bitmap;
-  pal->mask_type_index_bitmap = new_lookup_bitmap;
-  clib_bitmap_free(old_lookup_bitmap);
-}
-
 void
 hash_acl_unapply(acl_main_t *am, u32 lc_index, int acl_index)
 {
@@ -463,6 +495,7 @@ hash_acl_unapply(acl_main_t *am, u32 lc_index, int acl_index)
   for(i=0; i < vec_len(ha->rules); i ++) {
     deactivate_applied_ace_hash_entry(am, lc_index,
                                       applied_hash_aces, base_offset + i);
+    release_mask_type_index(am, vec_elt_at_index((*applied_hash_aces), base_offset + i)->mask_type_index);
   }
   for(i=0; i < tail_len; i ++) {
     /* move the entry at tail offset to base offset */
@@ -476,7 +509,7 @@ hash_acl_unapply(acl_main_t *am, u32 lc_index, int acl_index)
   applied_hash_entries_analyze(am, applied_hash_aces);
 
   /* After deletion we might not need some of the mask-types anymore... */
-  hash_acl_build_applied_lookup_bitmap(am, lc_index);
+  hash_acl_build_applied_mask_info(am, lc_index);
   clib_mem_set_heap (oldheap);
 }
 
@@ -558,6 +591,10 @@ make_mask_and_match_from_rule(fa_5tuple_t *mask, acl_rule_t *r, hash_ace_info_t
   memset(mask, 0, sizeof(*mask));
   memset(&hi->match, 0, sizeof(hi->match));
   hi->action = r->is_permit;
+  hi->src_portrange_not_powerof2 = 0;
+  hi->dst_portrange_not_powerof2 = 0;
+  hi->src_port_or_type_first = hi->src_port_or_type_last = 0;
+  hi->dst_port_or_code_first = hi->dst_port_or_code_last = 0;
 
   /* we will need to be matching based on lc_index and mask_type_index when applied */
   mask->pkt.lc_index = ~0;
@@ -585,6 +622,14 @@ make_mask_and_match_from_rule(fa_5tuple_t *mask, acl_rule_t *r, hash_ace_info_t
       hi->match.l4.port[0] = r->src_port_or_type_first & mask->l4.port[0];
       hi->dst_portrange_not_powerof2 = make_port_mask(&mask->l4.port[1], r->dst_port_or_code_first, r->dst_port_or_code_last);
       hi->match.l4.port[1] = r->dst_port_or_code_first & mask->l4.port[1];
+      if (hi->src_portrange_not_powerof2) {
+        hi->src_port_or_type_first = r->src_port_or_type_first;
+        hi->src_port_or_type_last = r->src_port_or_type_last;
+      }
+      if (hi->dst_portrange_not_powerof2) {
+        hi->dst_port_or_code_first = r->dst_port_or_code_first;
+        hi->dst_port_or_code_last = r->dst_port_or_code_last;
+      }
       /* L4 info must be valid in order to match */
       mask->pkt.l4_valid = 1;
       hi->match.pkt.l4_valid = 1;
@@ -613,15 +658,11 @@ make_mask_and_match_from_rule(fa_5tuple_t *mask, acl_rule_t *r, hash_ace_info_t
 static u32
 find_mask_type_index(acl_main_t *am, fa_5tuple_t *mask)
 {
-  ace_mask_type_entry_t *mte;
-  /* *INDENT-OFF* */
-  pool_foreach(mte, am->ace_mask_type_pool,
-  ({
-    if(memcmp(&mte->mask, mask, sizeof(*mask)) == 0)
-      return (mte - am->ace_mask_type_pool);
-  }));
-  /* *INDENT-ON* */
-  return ~0;
+  uword *p;
+  if (!am->ace_mask_type_index_by_mask.hash)
+    return ~0;
+  p = mhash_get(&am->ace_mask_type_index_by_mask, mask);
+  return p ? p[0] : ~0;
 }
 
 static u32
@@ -640,6 +681,9 @@ assign_mask_type_index(acl_main_t *am, fa_5tuple_t *mask)
      * problem anyway, so we might as well stop half way.
      */
     ASSERT(mask_type_index < 32768);
+    if (!am->ace_mask_type_index_by_mask.hash)
+      mhash_init(&am->ace_mask_type_index_by_mask, sizeof(uword), sizeof(fa_5tuple_t));
+    mhash_set(&am->ace_mask_type_index_by_mask, &mte->mask, mask_type_index, 0);
   }
   mte = am->ace_mask_type_pool + mask_type_index;
   mte->refcount++;
@@ -653,10 +697,249 @@ release_mask_type_index(acl_main_t *am, u32 mask_type_index)
   mte->refcount--;
   if (mte->refcount == 0) {
     /* we are not using this entry anymore */
+    mhash_unset(&am->ace_mask_type_index_by_mask, &mte->mask, 0);
     pool_put(am->ace_mask_type_pool, mte);
   }
 }
 
+static int
+first_mask_contains_second_mask(fa_5tuple_t *mask1, fa_5tuple_t *mask2)
+{
+  /* true if every bit set in mask2 is also set in mask1 */
+  u64 *pmask1 = (u64 *)mask1;
+  u64 *pmask2 = (u64 *)mask2;
+  int j;
+  for(j=0; j<6; j++) {
+    if (pmask2[j] & ~pmask1[j])
+      return 0;
+  }
+  return 1;
+}
+
+static int
+count_mask_bits(fa_5tuple_t *mask)
+{
+  u64 *pmask = (u64 *)mask;
+  int j, n = 0;
+  for(j=0; j<6; j++) {
+    n += count_set_bits(pmask[j]);
+  }
+  return n;
+}
+
+static u8
+address_mask_prefix_len(ip46_address_t *addr, u8 is_ipv6)
+{
+  if (is_ipv6)
+    return count_set_bits(addr->as_u64[0]) + count_set_bits(addr->as_u64[1]);
+  else
+    return count_set_bits(addr->ip4.as_u32);
+}
+
+/*
+ * Make a less specific version of the rule mask, such that
+ * the rules with "similar" masks end up in the same lookup table:
+ * the prefix lengths are rounded down to the octet (IPv4)
+ * or to the 16-bit group (IPv6) boundary, and the ports and TCP flags
+ * are wildcarded. The address family, the protocol and the fragment
+ * bits are kept, so the tables stay reasonably selective.
+ */
+static void
+relax_mask(fa_5tuple_t *relaxed, fa_5tuple_t *mask, u8 is_ipv6)
+{
+  u8 granularity = is_ipv6 ? 16 : 8;
+  int i;
+
+  clib_memcpy(relaxed, mask, sizeof(*relaxed));
+  for(i=0; i<2; i++) {
+    u8 prefix_len = address_mask_prefix_len(&mask->addr[i], is_ipv6);
+    if (prefix_len == 0)
+      continue;
+    prefix_len -= prefix_len % granularity;
+    make_address_mask(&relaxed->addr[i], is_ipv6, prefix_len);
+  }
+  relaxed->l4.port[0] = 0;
+  relaxed->l4.port[1] = 0;
+  relaxed->pkt.tcp_flags = 0;
+  relaxed->pkt.tcp_flags_valid = 0;
+}
+
+static hash_applied_mask_info_t *
+find_applied_mask_info(applied_hash_acl_info_t *pal, u32 mask_type_index)
+{
+  hash_applied_mask_info_t *minfo;
+  vec_foreach(minfo, pal->mask_info_vec) {
+    if (minfo->mask_type_index == mask_type_index)
+      return minfo;
+  }
+  return 0;
+}
+
+/*
+ * Count the entries which would share the key with a given applied entry,
+ * if it were hashed using a given mask type. Stop counting at the limit.
+ */
+static u32
+count_colliding_entries(acl_main_t *am, u32 lc_index,
+                        applied_hash_ace_entry_t **applied_hash_aces,
+                        u32 index, u32 mask_type_index, u32 limit)
+{
+  clib_bihash_kv_48_8_t kv;
+  clib_bihash_kv_48_8_t result;
+  hash_acl_lookup_value_t *result_val = (hash_acl_lookup_value_t *)&result.value;
+  applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), index);
+  u32 saved_mask_type_index = pae->mask_type_index;
+  u32 count = 0;
+
+  pae->mask_type_index = mask_type_index;
+  fill_applied_hash_ace_kv(am, applied_hash_aces, lc_index, index, &kv);
+  pae->mask_type_index = saved_mask_type_index;
+
+  if (BV (clib_bihash_search) (&am->acl_lookup_hash, &kv, &result) == 0) {
+    u32 curr_index = result_val->applied_entry_index;
+    while ((curr_index != ~0) && (count < limit)) {
+      count++;
+      curr_index = vec_elt_at_index((*applied_hash_aces), curr_index)->next_applied_entry_index;
+    }
+  }
+  return count;
+}
+
+/*
+ * Pick the lookup table for an applied entry within a lookup context.
+ *
+ * Without tuple merge, it is the table of the exact mask type of the rule.
+ * With tuple merge, it is the most specific existing table whose mask
+ * is contained in the rule mask and where the key of the rule has fewer
+ * than tuple_merge_split_threshold entries. If there is none, a new table
+ * with a relaxed mask is created, unless that one exists already and is
+ * full for this key - then the exact mask type of the rule is used.
+ *
+ * Returns the mask type index with a reference held.
+ */
+static u32
+assign_applied_mask_type_index(acl_main_t *am, u32 lc_index,
+                               applied_hash_ace_entry_t **applied_hash_aces,
+                               u32 index)
+{
+  applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), index);
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, pae->acl_index);
+  hash_ace_info_t *hi = vec_elt_at_index(ha->rules, pae->hash_ace_info_index);
+  applied_hash_acl_info_t *pal = vec_elt_at_index(am->applied_hash_acl_info_by_lc_index, lc_index);
+  fa_5tuple_t mask;
+  u32 mask_type_index = hi->mask_type_index;
+
+  clib_memcpy(&mask, &pool_elt_at_index(am->ace_mask_type_pool, hi->mask_type_index)->mask, sizeof(mask));
+
+  if (am->use_tuple_merge) {
+    hash_applied_mask_info_t *minfo;
+    u32 best_mask_type_index = ~0;
+    int best_mask_bits = -1;
+    vec_foreach(minfo, pal->mask_info_vec) {
+      fa_5tuple_t *table_mask = &pool_elt_at_index(am->ace_mask_type_pool, minfo->mask_type_index)->mask;
+      int mask_bits;
+      if (!first_mask_contains_second_mask(&mask, table_mask))
+        continue;
+      mask_bits = count_mask_bits(table_mask);
+      if (mask_bits <= best_mask_bits)
+        continue;
+      if ((minfo->mask_type_index != hi->mask_type_index) &&
+          count_colliding_entries(am, lc_index, applied_hash_aces, index, minfo->mask_type_index,
+                                  am->tuple_merge_split_threshold) >= am->tuple_merge_split_threshold)
+        continue;
+      best_mask_type_index = minfo->mask_type_index;
+      best_mask_bits = mask_bits;
+    }
+    if (~0 != best_mask_type_index) {
+      mask_type_index = best_mask_type_index;
+      clib_memcpy(&mask, &pool_elt_at_index(am->ace_mask_type_pool, mask_type_index)->mask, sizeof(mask));
+    } else {
+      fa_5tuple_t relaxed_mask;
+      relax_mask(&relaxed_mask, &mask, hi->match.pkt.is_ip6);
+      u32 relaxed_mask_type_index = find_mask_type_index(am, &relaxed_mask);
+      if ((~0 == relaxed_mask_type_index) || !find_applied_mask_info(pal, relaxed_mask_type_index))
+        clib_memcpy(&mask, &relaxed_mask, sizeof(mask));
+    }
+  }
+  mask_type_index = assign_mask_type_index(am, &mask);
+  if (!find_applied_mask_info(pal, mask_type_index)) {
+    hash_applied_mask_info_t *minfo;
+    vec_add2(pal->mask_info_vec, minfo, 1);
+    minfo->mask_type_index = mask_type_index;
+    minfo->num_entries = 0;
+    minfo->max_collisions = 0;
+    minfo->first_rule_index = ~0;
+  }
+  return mask_type_index;
+}
+
+static int
+applied_mask_info_compare(void *a1, void *a2)
+{
+  hash_applied_mask_info_t *m1 = a1;
+  hash_applied_mask_info_t *m2 = a2;
+  if (m1->first_rule_index < m2->first_rule_index)
+    return -1;
+  return (m1->first_rule_index > m2->first_rule_index);
+}
+
+/*
+ * Recalculate the lookup tables of a lookup context from its applied entries:
+ * drop the unused ones, refresh the statistics and sort them by the lowest
+ * applied entry index, which the lookup uses to stop early.
+ */
+static void
+hash_acl_build_applied_mask_info(acl_main_t *am, u32 lc_index)
+{
+  applied_hash_ace_entry_t **applied_hash_aces = get_applied_hash_aces(am, lc_index);
+  applied_hash_acl_info_t *pal = vec_elt_at_index(am->applied_hash_acl_info_by_lc_index, lc_index);
+  hash_applied_mask_info_t *minfo;
+  u32 *minfo_index_by_mask_type = 0;
+  uword *new_lookup_bitmap = 0;
+  u32 i;
+
+  vec_validate_init_empty(minfo_index_by_mask_type, pool_len(am->ace_mask_type_pool), ~0);
+  vec_foreach(minfo, pal->mask_info_vec) {
+    minfo->num_entries = 0;
+    minfo->max_collisions = 0;
+    minfo->first_rule_index = ~0;
+    minfo_index_by_mask_type[minfo->mask_type_index] = minfo - pal->mask_info_vec;
+  }
+  for(i=0; i < vec_len((*applied_hash_aces)); i++) {
+    applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), i);
+    u32 minfo_index = minfo_index_by_mask_type[pae->mask_type_index];
+    ASSERT(minfo_index != ~0);
+    minfo = vec_elt_at_index(pal->mask_info_vec, minfo_index);
+    minfo->num_entries++;
+    if (i < minfo->first_rule_index)
+      minfo->first_rule_index = i;
+    if (pae->prev_applied_entry_index == ~0) {
+      /* chain head - count the colliding entries */
+      u32 n_collisions = 0;
+      u32 curr_index = i;
+      while (curr_index != ~0) {
+        n_collisions++;
+        curr_index = vec_elt_at_index((*applied_hash_aces), curr_index)->next_applied_entry_index;
+      }
+      if (n_collisions > minfo->max_collisions)
+        minfo->max_collisions = n_collisions;
+    }
+  }
+  for(i=0; i < vec_len(pal->mask_info_vec); ) {
+    minfo = vec_elt_at_index(pal->mask_info_vec, i);
+    if (minfo->num_entries == 0) {
+      vec_del1(pal->mask_info_vec, i);
+      continue;
+    }
+    new_lookup_bitmap = clib_bitmap_set(new_lookup_bitmap, minfo->mask_type_index, 1);
+    i++;
+  }
+  vec_sort_with_function(pal->mask_info_vec, applied_mask_info_compare);
+  clib_bitmap_free(pal->mask_type_index_bitmap);
+  pal->mask_type_index_bitmap = new_lookup_bitmap;
+  vec_free(minfo_index_by_mask_type);
+}
+
 int hash_acl_exists(acl_main_t *am, int acl_index)
 {
   if (acl_index >= vec_len(am->hash_acl_infos))
@@ -666,16 +949,11 @@ int hash_acl_exists(acl_main_t *am, int acl_index)
   return ha->hash_acl_exists;
 }
 
-void hash_acl_add(acl_main_t *am, int acl_index)
+static void
+hash_acl_build_rules(acl_main_t *am, int acl_index, hash_acl_info_t *ha)
 {
-  void *oldheap = hash_acl_set_heap(am);
-  DBG("HASH ACL add : %d", acl_index);
   int i;
   acl_list_t *a = &am->acls[acl_index];
-  vec_validate(am->hash_acl_infos, acl_index);
-  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
-  memset(ha, 0, sizeof(*ha));
-  ha->hash_acl_exists = 1;
 
   /* walk the newly added ACL entries and ensure that for each of them there
      is a mask type, increment a reference count for that mask type */
@@ -705,6 +983,18 @@ void hash_acl_add(acl_main_t *am, int acl_index)
       vec_add1(ha->rules, ace_info);
     }
   }
+}
+
+void hash_acl_add(acl_main_t *am, int acl_index)
+{
+  void *oldheap = hash_acl_set_heap(am);
+  DBG("HASH ACL add : %d", acl_index);
+  vec_validate(am->hash_acl_infos, acl_index);
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
+  memset(ha, 0, sizeof(*ha));
+  ha->hash_acl_exists = 1;
+
+  hash_acl_build_rules(am, acl_index, ha);
   /*
    * if an ACL is applied somewhere, fill the corresponding lookup data structures.
    * We need to take care if the ACL is not the last one in the vector of ACLs applied to the interface.
@@ -718,6 +1008,146 @@ void hash_acl_add(acl_main_t *am, int acl_index)
   clib_mem_set_heap (oldheap);
 }
 
+/*
+ * Two hash ACEs are equivalent if they would result in the same
+ * lookup entries, regardless of their position within the ACL.
+ */
+static int
+hash_ace_info_equal(hash_ace_info_t *hi1, hash_ace_info_t *hi2)
+{
+  return (hi1->mask_type_index == hi2->mask_type_index) &&
+         (hi1->action == hi2->action) &&
+         (hi1->src_portrange_not_powerof2 == hi2->src_portrange_not_powerof2) &&
+         (hi1->dst_portrange_not_powerof2 == hi2->dst_portrange_not_powerof2) &&
+         (hi1->src_port_or_type_first == hi2->src_port_or_type_first) &&
+         (hi1->src_port_or_type_last == hi2->src_port_or_type_last) &&
+         (hi1->dst_port_or_code_first == hi2->dst_port_or_code_first) &&
+         (hi1->dst_port_or_code_last == hi2->dst_port_or_code_last) &&
+         (0 == memcmp(&hi1->match, &hi2->match, sizeof(hi1->match)));
+}
+
+/*
+ * Update the applied entries of an ACL within one lookup context after
+ * the ACL has changed. The first n_same_head and the last n_same_tail
+ * hash ACEs are the same in the old and the new version, so only
+ * the ones in between are deactivated and activated, the rest of the
+ * applied entries past them are shifted if the length has changed.
+ */
+static void
+hash_acl_update_applied(acl_main_t *am, u32 lc_index, int acl_index,
+                        hash_ace_info_t *old_rules, u32 n_same_head, u32 n_same_tail)
+{
+  applied_hash_ace_entry_t **applied_hash_aces = get_applied_hash_aces(am, lc_index);
+  acl_lookup_context_t *acontext = pool_elt_at_index(am->acl_lookup_contexts, lc_index);
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
+  hash_ace_info_t *new_rules = ha->rules;
+  u32 acl_position = vec_search(acontext->acl_indices, acl_index);
+  u32 old_n_changed = vec_len(old_rules) - n_same_head - n_same_tail;
+  u32 new_n_changed = vec_len(new_rules) - n_same_head - n_same_tail;
+  i32 delta = (i32) new_n_changed - (i32) old_n_changed;
+  u32 base_offset = 0;
+  u32 tail_offset, total_len;
+  u32 i;
+
+  ASSERT(acl_position != ~0);
+  /* the applied entries of the ACLs are laid out in the order of the ACLs */
+  for(i=0; i < acl_position; i++) {
+    base_offset += vec_len(vec_elt_at_index(am->hash_acl_infos, acontext->acl_indices[i])->rules);
+  }
+  tail_offset = base_offset + n_same_head + old_n_changed;
+  total_len = vec_len((*applied_hash_aces));
+  DBG0("HASH ACL update: lc_index %d acl %d base %d head %d tail %d old %d new %d",
+       lc_index, acl_index, base_offset, n_same_head, n_same_tail, old_n_changed, new_n_changed);
+
+  /* the entries being removed need the old rules to find their hash keys */
+  ha->rules = old_rules;
+  for(i = base_offset + n_same_head; i < tail_offset; i++) {
+    deactivate_applied_ace_hash_entry(am, lc_index, applied_hash_aces, i);
+    release_mask_type_index(am, vec_elt_at_index((*applied_hash_aces), i)->mask_type_index);
+  }
+  ha->rules = new_rules;
+
+  /* the unchanged tail of this ACL now refers to different hash ACEs and rules */
+  for(i = 0; i < n_same_tail; i++) {
+    applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), tail_offset + i);
+    pae->hash_ace_info_index += delta;
+    pae->ace_index = vec_elt_at_index(new_rules, pae->hash_ace_info_index)->ace_index;
+  }
+
+  if (delta > 0) {
+    vec_resize((*applied_hash_aces), delta);
+    for(i = total_len; i > tail_offset; i--) {
+      move_applied_ace_hash_entry(am, lc_index, applied_hash_aces, i - 1, i - 1 + delta);
+    }
+  } else if (delta < 0) {
+    for(i = tail_offset; i < total_len; i++) {
+      move_applied_ace_hash_entry(am, lc_index, applied_hash_aces, i, i + delta);
+    }
+    _vec_len((*applied_hash_aces)) += delta;
+  }
+
+  for(i = 0; i < new_n_changed; i++) {
+    u32 new_index = base_offset + n_same_head + i;
+    u32 hash_ace_info_index = n_same_head + i;
+    applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), new_index);
+    pae->acl_index = acl_index;
+    pae->ace_index = new_rules[hash_ace_info_index].ace_index;
+    pae->acl_position = acl_position;
+    pae->action = new_rules[hash_ace_info_index].action;
+    pae->hitcount = 0;
+    pae->hash_ace_info_index = hash_ace_info_index;
+    pae->next_applied_entry_index = ~0;
+    pae->prev_applied_entry_index = ~0;
+    pae->tail_applied_entry_index = ~0;
+    pae->mask_type_index = assign_applied_mask_type_index(am, lc_index, applied_hash_aces, new_index);
+    activate_applied_ace_hash_entry(am, lc_index, applied_hash_aces, new_index);
+  }
+  applied_hash_entries_analyze(am, applied_hash_aces);
+  hash_acl_build_applied_mask_info(am, lc_index);
+}
+
+void hash_acl_update(acl_main_t *am, int acl_index)
+{
+  void *oldheap = hash_acl_set_heap(am);
+  DBG0("HASH ACL update : %d", acl_index);
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
+  hash_ace_info_t *old_rules = ha->rules;
+  uword *old_mask_type_index_bitmap = ha->mask_type_index_bitmap;
+  u32 n_same_head = 0;
+  u32 n_same_tail = 0;
+  u32 n_max_same;
+  u32 *lc_list_copy;
+  u32 *lc_index;
+  int i;
+
+  ha->rules = 0;
+  ha->mask_type_index_bitmap = 0;
+  /* the mask types are refcounted, so the unchanged rules get the same ones */
+  hash_acl_build_rules(am, acl_index, ha);
+
+  n_max_same = clib_min(vec_len(old_rules), vec_len(ha->rules));
+  while ((n_same_head < n_max_same) &&
+         hash_ace_info_equal(&old_rules[n_same_head], &ha->rules[n_same_head]))
+    n_same_head++;
+  while ((n_same_head + n_same_tail < n_max_same) &&
+         hash_ace_info_equal(&old_rules[vec_len(old_rules) - 1 - n_same_tail],
+                             &ha->rules[vec_len(ha->rules) - 1 - n_same_tail]))
+    n_same_tail++;
+
+  lc_list_copy = vec_dup(ha->lc_index_list);
+  vec_foreach(lc_index, lc_list_copy) {
+    hash_acl_update_applied(am, *lc_index, acl_index, old_rules, n_same_head, n_same_tail);
+  }
+  vec_free(lc_list_copy);
+
+  for(i=0; i < vec_len(old_rules); i++) {
+    release_mask_type_index(am, old_rules[i].mask_type_index);
+  }
+  clib_bitmap_free(old_mask_type_index_bitmap);
+  vec_free(old_rules);
+  clib_mem_set_heap (oldheap);
+}
+
 void hash_acl_delete(acl_main_t *am, int acl_index)
 {
   void *oldheap = hash_acl_set_heap(am);
@@ -823,9 +1253,10 @@ void
 acl_plugin_print_pae (vlib_main_t * vm, int j, applied_hash_ace_entry_t * pae)
 {
   vlib_cli_output (vm,
-		   "    %4d: acl %d rule %d action %d bitmask-ready rule %d next %d prev %d tail %d hitcount %lld",
+		   "    %4d: acl %d rule %d action %d bitmask-ready rule %d mask type %d next %d prev %d tail %d hitcount %lld",
 		   j, pae->acl_index, pae->ace_index, pae->action,
-		   pae->hash_ace_info_index, pae->next_applied_entry_index,
+		   pae->hash_ace_info_index, pae->mask_type_index,
+		   pae->next_applied_entry_index,
 		   pae->prev_applied_entry_index,
 		   pae->tail_applied_entry_index, pae->hitcount);
 }
@@ -854,6 +1285,16 @@ acl_plugin_show_tables_applied_info (u32 lc_index)
 			   format_bitmap_hex, pal->mask_type_index_bitmap);
 	  vlib_cli_output (vm, "  applied acls: %U", format_vec32,
 			   pal->applied_acls, "%d");
+	  vlib_cli_output (vm, "  lookup tables (tuple merge %s):",
+			   am->use_tuple_merge ? "on" : "off");
+	  for (j = 0; j < vec_len (pal->mask_info_vec); j++)
+	    {
+	      hash_applied_mask_info_t *minfo = &pal->mask_info_vec[j];
+	      vlib_cli_output (vm,
+			       "    %4d: mask type %d entries %d max collisions %d first rule %d",
+			       j, minfo->mask_type_index, minfo->num_entries,
+			       minfo->max_collisions, minfo->first_rule_index);
+	    }
 	}
       if (lci < vec_len (am->hash_entry_vec_by_lc_index))
 	{
@@ -41,6 +41,13 @@ void hash_acl_unapply(acl_main_t *am, u32 lc_index, int acl_index);
 void hash_acl_add(acl_main_t *am, int acl_index);
 void hash_acl_delete(acl_main_t *am, int acl_index);
 
+/*
+ * Update the hash ACL after the rules of an existing ACL have been replaced,
+ * touching only the applied entries of the rules that have changed.
+ */
+
+void hash_acl_update(acl_main_t *am, int acl_index);
+
 /* return if there is already a filled-in hash acl info */
 int hash_acl_exists(acl_main_t *am, int acl_index);
 
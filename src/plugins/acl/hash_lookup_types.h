@@ -27,6 +27,11 @@ typedef struct {
   u32 mask_type_index;
   u8 src_portrange_not_powerof2;
   u8 dst_portrange_not_powerof2;
+  /* the port ranges not representable by the mask, to compare the rules on ACL update */
+  u16 src_port_or_type_first;
+  u16 src_port_or_type_last;
+  u16 dst_port_or_code_first;
+  u16 dst_port_or_code_last;
 
   fa_5tuple_t match;
   u8 action;
@@ -51,6 +56,12 @@ typedef struct {
   u32 ace_index;
   /* the index of the hash_ace_info_t */
   u32 hash_ace_info_index;
+  /*
+   * the mask type of the lookup table this entry is hashed into.
+   * With tuple merge this may be less specific than the mask type
+   * of the rule itself, in which case the match is verified exactly.
+   */
+  u32 mask_type_index;
   /*
    * in case of the same key having multiple entries,
    * this holds the index of the next entry.
@@ -79,14 +90,31 @@ typedef struct {
   u8 action;
 } applied_hash_ace_entry_t;
 
+/*
+ * The lookup table (partition) within a lookup context, keyed
+ * by a single mask type. The packet lookup probes these in order.
+ */
+typedef struct {
+  /* index into ace_mask_type_pool */
+  u32 mask_type_index;
+  /* number of applied entries hashed with this mask type */
+  u32 num_entries;
+  /* the longest chain of entries sharing a single key */
+  u32 max_collisions;
+  /* the lowest applied entry index within this table */
+  u32 first_rule_index;
+} hash_applied_mask_info_t;
+
 typedef struct {
    /*
     * A logical OR of all the applied_ace_hash_entry_t=>
-    *                            hash_ace_info_t=>mask_type_index bits set
+    *                            mask_type_index bits set
     */
    uword *mask_type_index_bitmap;
    /* applied ACLs so we can track them independently from main ACL module */
    u32 *applied_acls;
+   /* lookup tables, sorted by first_rule_index for early termination */
+   hash_applied_mask_info_t *mask_info_vec;
 } applied_hash_acl_info_t;
 
 
@@ -98,7 +126,8 @@ typedef union {
     u8 reserved_u8;
     /* means there is some other entry in front intersecting with this one */
     u8 shadowed:1;
-    u8 need_portrange_check:1;
+    /* the chain needs to be verified against the exact rule (portrange or relaxed mask) */
+    u8 need_exact_check:1;
     u8 reserved_flags:6;
   };
 } hash_acl_lookup_value_t;
@@ -261,10 +261,11 @@ void acl_plugin_lookup_context_notify_acl_change(u32 acl_num)
   acl_main_t *am = &acl_main;
   if (acl_plugin_acl_exists(acl_num)) {
     if (hash_acl_exists(am, acl_num)) {
-        /* this is a modification, clean up the older entries */
-        hash_acl_delete(am, acl_num);
+        /* this is a modification, update only the changed entries */
+        hash_acl_update(am, acl_num);
+    } else {
+        hash_acl_add(am, acl_num);
     }
-    hash_acl_add(am, acl_num);
   } else {
     /* this is a deletion notification */
     hash_acl_delete(am, acl_num);
@@ -613,8 +613,51 @@ match_portranges(acl_main_t *am, fa_5tuple_t *match, u32 index)
            ((r->dst_port_or_code_first <= match->l4.port[1]) && r->dst_port_or_code_last >= match->l4.port[1]) );
 }
 
+/*
+ * This returns true if the rule of the applied entry matches the packet exactly.
+ * It is needed when the entry was found in a lookup table with a less
+ * specific mask than the rule itself (tuple merge), or when the portrange
+ * of the rule could not be represented by a mask.
+ */
+always_inline int
+match_applied_ace_exact(acl_main_t *am, fa_5tuple_t *match, u32 index)
+{
+  applied_hash_ace_entry_t **applied_hash_aces = vec_elt_at_index(am->hash_entry_vec_by_lc_index, match->pkt.lc_index);
+  applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), index);
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, pae->acl_index);
+  hash_ace_info_t *hi = vec_elt_at_index(ha->rules, pae->hash_ace_info_index);
+
+  if (pae->mask_type_index != hi->mask_type_index) {
+    ace_mask_type_entry_t *mte = vec_elt_at_index(am->ace_mask_type_pool, hi->mask_type_index);
+    u64 *pmatch = (u64 *)match;
+    u64 *pmask = (u64 *)&mte->mask;
+    u64 *prule = (u64 *)&hi->match;
+    fa_packet_info_t pkt_mask;
+
+    /* the lc_index and the mask type are not a part of the rule */
+    pkt_mask.as_u64 = mte->mask.pkt.as_u64;
+    pkt_mask.lc_index = 0;
+    pkt_mask.mask_type_index_lsb = 0;
+
+    if (((pmatch[0] & pmask[0]) != prule[0]) ||
+        ((pmatch[1] & pmask[1]) != prule[1]) ||
+        ((pmatch[2] & pmask[2]) != prule[2]) ||
+        ((pmatch[3] & pmask[3]) != prule[3]) ||
+        ((pmatch[4] & pmask[4]) != prule[4]) ||
+        ((match->pkt.as_u64 ^ hi->match.pkt.as_u64) & pkt_mask.as_u64))
+      return 0;
+  }
+  if (hi->src_portrange_not_powerof2 || hi->dst_portrange_not_powerof2)
+    return match_portranges(am, match, index);
+  return 1;
+}
+
+/*
+ * Find the lowest applied entry index matching the packet.
+ * If n_probes is not zero, the number of hash lookups done is added to it.
+ */
 always_inline u32
-multi_acl_match_get_applied_ace_index(acl_main_t *am, fa_5tuple_t *match)
+multi_acl_match_get_applied_ace_index(acl_main_t *am, fa_5tuple_t *match, u32 *n_probes)
 {
   clib_bihash_kv_48_8_t kv;
   clib_bihash_kv_48_8_t result;
@@ -623,22 +666,22 @@ multi_acl_match_get_applied_ace_index(acl_main_t *am, fa_5tuple_t *match)
   u64 *pmatch = (u64 *)match;
   u64 *pmask;
   u64 *pkey;
-  int mask_type_index;
+  hash_applied_mask_info_t *minfo;
   u32 curr_match_index = ~0;
 
   u32 lc_index = match->pkt.lc_index;
   applied_hash_ace_entry_t **applied_hash_aces = vec_elt_at_index(am->hash_entry_vec_by_lc_index, match->pkt.lc_index);
-  applied_hash_acl_info_t **applied_hash_acls = &am->applied_hash_acl_info_by_lc_index;
+  applied_hash_acl_info_t *pal = vec_elt_at_index(am->applied_hash_acl_info_by_lc_index, lc_index);
 
   DBG("TRYING TO MATCH: %016llx %016llx %016llx %016llx %016llx %016llx",
 	       pmatch[0], pmatch[1], pmatch[2], pmatch[3], pmatch[4], pmatch[5]);
 
-  for(mask_type_index=0; mask_type_index < pool_len(am->ace_mask_type_pool); mask_type_index++) {
-    if (!clib_bitmap_get(vec_elt_at_index((*applied_hash_acls), lc_index)->mask_type_index_bitmap, mask_type_index)) {
-      /* This bit is not set. Avoid trying to match */
-      continue;
+  vec_foreach(minfo, pal->mask_info_vec) {
+    if (minfo->first_rule_index > curr_match_index) {
+      /* the tables are sorted by their first entry, none of the rest can give a better match */
+      break;
     }
-    ace_mask_type_entry_t *mte = vec_elt_at_index(am->ace_mask_type_pool, mask_type_index);
+    ace_mask_type_entry_t *mte = vec_elt_at_index(am->ace_mask_type_pool, minfo->mask_type_index);
     pmatch = (u64 *)match;
     pmask = (u64 *)&mte->mask;
     pkey = (u64 *)kv.key;
@@ -657,33 +700,37 @@ multi_acl_match_get_applied_ace_index(acl_main_t *am, fa_5tuple_t *match)
     *pkey++ = *pmatch++ & *pmask++;
     *pkey++ = *pmatch++ & *pmask++;
 
-    kv_key->pkt.mask_type_index_lsb = mask_type_index;
-    DBG("        KEY %3d: %016llx %016llx %016llx %016llx %016llx %016llx", mask_type_index,
+    kv_key->pkt.mask_type_index_lsb = minfo->mask_type_index;
+    DBG("        KEY %3d: %016llx %016llx %016llx %016llx %016llx %016llx", minfo->mask_type_index,
 		kv.key[0], kv.key[1], kv.key[2], kv.key[3], kv.key[4], kv.key[5]);
+    if (n_probes)
+      (*n_probes)++;
     int res = clib_bihash_search_48_8 (&am->acl_lookup_hash, &kv, &result);
     if (res == 0) {
       DBG("ACL-MATCH! result_val: %016llx", result_val->as_u64);
       if (result_val->applied_entry_index < curr_match_index) {
-	if (PREDICT_FALSE(result_val->need_portrange_check)) {
+	if (PREDICT_FALSE(result_val->need_exact_check)) {
           /*
-           * This is going to be slow, since we can have multiple superset
-           * entries for narrow-ish portranges, e.g.:
+           * The entries sharing the key may be from the rules with
+           * more specific masks or with narrow-ish portranges, e.g.:
            * 0..42 100..400, 230..60000,
            * so we need to walk linearly and check if they match.
+           * The chain is in the ascending order of the applied entry index,
+           * so the walk can stop on the first match or past the current candidate.
            */
 
           u32 curr_index = result_val->applied_entry_index;
-          while ((curr_index != ~0) && !match_portranges(am, match, curr_index)) {
+          while ((curr_index < curr_match_index) && !match_applied_ace_exact(am, match, curr_index)) {
             /* while no match and there are more entries, walk... */
             applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces),curr_index);
-            DBG("entry %d did not portmatch, advancing to %d", curr_index, pae->next_applied_entry_index);
+            DBG("entry %d did not match exactly, advancing to %d", curr_index, pae->next_applied_entry_index);
             curr_index = pae->next_applied_entry_index;
           }
           if (curr_index < curr_match_index) {
-            DBG("The index %d is the new candidate in portrange matches.", curr_index);
+            DBG("The index %d is the new candidate in exact matches.", curr_index);
             curr_match_index = curr_index;
           } else {
-            DBG("Curr portmatch index %d is too big vs. current matched one %d", curr_index, curr_match_index);
+            DBG("Curr exact match index %d is too big vs. current matched one %d", curr_index, curr_match_index);
           }
         } else {
           /* The usual path is here. Found an entry in front of the current candiate - so it's a new one */
@@ -708,7 +755,7 @@ hash_multi_acl_match_5tuple (u32 lc_index, fa_5tuple_t * pkt_5tuple,
 {
   acl_main_t *am = p_acl_main;
   applied_hash_ace_entry_t **applied_hash_aces = vec_elt_at_index(am->hash_entry_vec_by_lc_index, lc_index);
-  u32 match_index = multi_acl_match_get_applied_ace_index(am, pkt_5tuple);
+  u32 match_index = multi_acl_match_get_applied_ace_index(am, pkt_5tuple, 0);
   if (match_index < vec_len((*applied_hash_aces))) {
     applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), match_index);
     pae->hitcount++;
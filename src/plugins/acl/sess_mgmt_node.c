@@ -48,13 +48,19 @@ fa_session_get_shortest_timeout (acl_main_t * am)
   return timeout;
 }
 
+static vlib_node_registration_t acl_fa_session_cleaner_process_node;
+static vlib_node_registration_t acl_fa_worker_session_cleaner_process_node;
+
 static void
 acl_fa_verify_init_sessions (acl_main_t * am)
 {
   if (!am->fa_sessions_hash_is_initialized)
     {
       u16 wk;
-      /* Allocate the per-worker sessions pools */
+      void *oldheap = acl_plugin_set_heap ();
+      am->fa_worker_cleaner_node_index =
+	acl_fa_worker_session_cleaner_process_node.index;
+      /* Allocate the per-worker sessions pools and timer wheels */
       for (wk = 0; wk < vec_len (am->per_worker_data); wk++)
 	{
 	  acl_fa_per_worker_data_t *pw = &am->per_worker_data[wk];
@@ -66,7 +72,16 @@ acl_fa_verify_init_sessions (acl_main_t * am)
 	   */
 	  pool_init_fixed (pw->fa_sessions_pool,
 			   am->fa_conn_table_max_entries);
+	  /*
+	   * The wheel is started on the first run of the worker cleaner,
+	   * the time of the worker is not known here.
+	   */
+	  tw_timer_wheel_init_1t_3w_1024sl_ov (&pw->session_timer_wheel, 0,
+					       ACL_FA_TW_TICK,
+					       am->fa_max_expired_sessions_per_run);
+	  pw->cleaner_is_polling = 0;
 	}
+      clib_mem_set_heap (oldheap);
 
       /* ... and the interface session hash table */
       clib_bihash_init_40_8 (&am->fa_sessions_hash,
@@ -77,151 +92,191 @@ acl_fa_verify_init_sessions (acl_main_t * am)
     }
 }
 
-
 /*
- * Get the timeout of the session in a list since its enqueue time.
+ * Delete a batch of sessions owned by this thread, with the ACL heap set
+ * by the caller. The bihash buckets
+ * are prefetched a few sessions ahead, and the global delete counter
+ * is updated once per batch rather than once per session.
  */
+#define ACL_FA_DELETE_PREFETCH_STRIDE 2
 
-static u64
-fa_session_get_list_timeout (acl_main_t * am, fa_session_t * sess)
+static void
+acl_fa_delete_session_batch (acl_main_t * am, u16 thread_index,
+			     u32 * session_indices)
 {
-  u64 timeout = am->vlib_main->clib_time.clocks_per_second;
-  /*
-   * we have the shortest possible timeout type in all the lists
-   * (see README-multicore for the rationale)
-   */
-  timeout *= fa_session_get_shortest_timeout (am);
-  return timeout;
-}
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+  u32 n_sessions = vec_len (session_indices);
+  fa_full_session_id_t fsid;
+  fa_session_t *sess;
+  u32 i;
 
-static u64
-acl_fa_get_list_head_expiry_time (acl_main_t * am,
-				  acl_fa_per_worker_data_t * pw, u64 now,
-				  u16 thread_index, int timeout_type)
-{
-  fa_session_t *sess =
-    get_session_ptr (am, thread_index, pw->fa_conn_list_head[timeout_type]);
-  /*
-   * We can not check just the index here because inbetween the worker thread might
-   * dequeue the connection from the head just as we are about to check it.
-   */
-  if (!is_valid_session_ptr (am, thread_index, sess))
-    {
-      return ~0LL;		// infinity.
-    }
-  else
+  fsid.as_u64 = 0;
+  fsid.thread_index = thread_index;
+  for (i = 0; i < n_sessions; i++)
     {
-      u64 timeout_time =
-	sess->link_enqueue_time + fa_session_get_list_timeout (am, sess);
-      return timeout_time;
+      if (i + ACL_FA_DELETE_PREFETCH_STRIDE < n_sessions)
+	{
+	  fa_session_t *next_sess =
+	    pool_elt_at_index (pw->fa_sessions_pool,
+			       session_indices[i +
+					       ACL_FA_DELETE_PREFETCH_STRIDE]);
+	  clib_bihash_prefetch_bucket_40_8 (&am->fa_sessions_hash,
+					    clib_bihash_hash_40_8
+					    (&next_sess->info.kv));
+	}
+      fsid.session_index = session_indices[i];
+      sess = pool_elt_at_index (pw->fa_sessions_pool, fsid.session_index);
+      acl_fa_conn_list_delete_session (am, fsid);
+      clib_bihash_add_del_40_8 (&am->fa_sessions_hash, &sess->info.kv, 0);
+      acl_fa_session_timer_stop (pw, sess);
+      vec_validate (pw->fa_session_dels_by_sw_if_index, sess->sw_if_index);
+      pw->fa_session_dels_by_sw_if_index[sess->sw_if_index]++;
+      pool_put_index (pw->fa_sessions_pool, fsid.session_index);
     }
-}
-
-static int
-acl_fa_conn_time_to_check (acl_main_t * am, acl_fa_per_worker_data_t * pw,
-			   u64 now, u16 thread_index, u32 session_index)
-{
-  fa_session_t *sess = get_session_ptr (am, thread_index, session_index);
-  u64 timeout_time =
-    sess->link_enqueue_time + fa_session_get_list_timeout (am, sess);
-  return (timeout_time < now)
-    || (sess->link_enqueue_time <= pw->swipe_end_time);
+  pw->cnt_deleted_sessions += n_sessions;
+  clib_smp_atomic_add (&am->fa_session_total_dels, n_sessions);
 }
 
 /*
- * see if there are sessions ready to be checked,
- * do the maintenance (requeue or delete), and
- * return the total number of sessions reclaimed.
+ * Expire the session timers on the wheel of this thread. The data plane
+ * only updates the last active time of the sessions, so the expired
+ * timer is either restarted for the rest of the idle timeout, or
+ * the session is deleted. The timers are restarted for at most
+ * the shortest of the timeouts, so the timeout type changes made
+ * by the other threads are noticed in time.
  */
-static int
-acl_fa_check_idle_sessions (acl_main_t * am, u16 thread_index, u64 now)
+static void
+acl_fa_age_sessions (acl_main_t * am, u16 thread_index, f64 now,
+		     u64 now_clocks)
 {
   acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  fa_full_session_id_t fsid;
-  fsid.thread_index = thread_index;
-  int total_expired = 0;
-
+  u64 max_restart_timeout =
+    am->vlib_main->clib_time.clocks_per_second *
+    fa_session_get_shortest_timeout (am);
+  u32 *psid;
+  void *oldheap = clib_mem_set_heap (am->acl_mheap);
+
+  vec_reset_length (pw->expired);
+  vec_reset_length (pw->to_delete);
+  pw->expired =
+    tw_timer_expire_timers_vec_1t_3w_1024sl_ov (&pw->session_timer_wheel,
+						now, pw->expired);
+  vec_foreach (psid, pw->expired)
   {
-    u8 tt = 0;
-    for (tt = 0; tt < ACL_N_TIMEOUTS; tt++)
+    if (pool_is_free_index (pw->fa_sessions_pool, *psid))
       {
-	while ((vec_len (pw->expired) <
-		am->fa_max_deleted_sessions_per_interval)
-	       && (~0 != pw->fa_conn_list_head[tt])
-	       &&
-	       (acl_fa_conn_time_to_check
-		(am, pw, now, thread_index, pw->fa_conn_list_head[tt])))
-	  {
-	    fsid.session_index = pw->fa_conn_list_head[tt];
-	    elog_acl_maybe_trace_X2 (am,
-				     "acl_fa_check_idle_sessions: expire session %d on thread %d",
-				     "i4i4", (u32) fsid.session_index,
-				     (u32) thread_index);
-	    vec_add1 (pw->expired, fsid.session_index);
-	    acl_fa_conn_list_delete_session (am, fsid);
-	  }
+	pw->cnt_already_deleted_sessions++;
+	continue;
       }
-  }
-
-  u32 *psid = NULL;
-  vec_foreach (psid, pw->expired)
-  {
-    fsid.session_index = *psid;
-    if (!pool_is_free_index (pw->fa_sessions_pool, fsid.session_index))
+    fa_session_t *sess = pool_elt_at_index (pw->fa_sessions_pool, *psid);
+    u64 sess_timeout_time =
+      sess->last_active_time + fa_session_get_timeout (am, sess);
+    sess->timer_handle = ~0;
+    if (now_clocks < sess_timeout_time)
       {
-	fa_session_t *sess =
-	  get_session_ptr (am, thread_index, fsid.session_index);
-	u32 sw_if_index = sess->sw_if_index;
-	u64 sess_timeout_time =
-	  sess->last_active_time + fa_session_get_timeout (am, sess);
-	if ((now < sess_timeout_time)
-	    && (0 ==
-		clib_bitmap_get (pw->pending_clear_sw_if_index_bitmap,
-				 sw_if_index)))
-	  {
-#ifdef FA_NODE_VERBOSE_DEBUG
-	    clib_warning
-	      ("ACL_FA_NODE_CLEAN: Restarting timer for session %d, sw_if_index %d",
-	       (int) fsid.session_index, sess->sw_if_index);
-#endif
-	    /* There was activity on the session, so the idle timeout
-	       has not passed. Enqueue for another time period. */
-
-	    acl_fa_conn_list_add_session (am, fsid, now);
-	    pw->cnt_session_timer_restarted++;
-	  }
-	else
-	  {
-#ifdef FA_NODE_VERBOSE_DEBUG
-	    clib_warning
-	      ("ACL_FA_NODE_CLEAN: Deleting session %d, sw_if_index %d",
-	       (int) fsid.session_index, sess->sw_if_index);
-#endif
-	    acl_fa_delete_session (am, sw_if_index, fsid);
-	    pw->cnt_deleted_sessions++;
-	  }
+	/* There was activity on the session, so the idle timeout
+	   has not passed yet. Wait for the rest of it. */
+	acl_fa_session_timer_start (am, pw, *psid, sess,
+				    clib_min (sess_timeout_time - now_clocks,
+					      max_restart_timeout));
+	pw->cnt_session_timer_restarted++;
       }
     else
       {
-	pw->cnt_already_deleted_sessions++;
+	elog_acl_maybe_trace_X2 (am,
+				 "acl_fa_age_sessions: expire session %d on thread %d",
+				 "i4i4", *psid, (u32) thread_index);
+	vec_add1 (pw->to_delete, *psid);
       }
   }
-  total_expired = vec_len (pw->expired);
-  /* zero out the vector which we have acted on */
-  if (pw->expired)
-    _vec_len (pw->expired) = 0;
-  /* if we were advancing and reached the end
-   * (no more sessions to recycle), reset the fast-forward timestamp */
-
-  if (pw->swipe_end_time && 0 == total_expired)
-    pw->swipe_end_time = 0;
-  return (total_expired);
+  acl_fa_delete_session_batch (am, thread_index, pw->to_delete);
+  clib_mem_set_heap (oldheap);
+  pw->cnt_aged_sessions += vec_len (pw->to_delete);
+
+  /*
+   * The wheel stops at the expiration limit and would only
+   * continue after a full tick, come back on the next loop instead.
+   */
+  if (vec_len (pw->expired) >= am->fa_max_expired_sessions_per_run)
+    pw->session_timer_wheel.next_run_time = now;
+
+  if (now >= pw->aged_sessions_rate_time + ACL_FA_AGING_RATE_INTERVAL)
+    {
+      pw->aged_sessions_per_sec =
+	(f64) (pw->cnt_aged_sessions - pw->cnt_aged_sessions_last) /
+	(now - pw->aged_sessions_rate_time);
+      pw->cnt_aged_sessions_last = pw->cnt_aged_sessions;
+      pw->aged_sessions_rate_time = now;
+    }
+}
+
+/*
+ * Delete the sessions on the interfaces the main thread asked to clear,
+ * walking at most fa_max_expired_sessions_per_run sessions of the pool
+ * per call. Returns 1 once the whole pool has been walked.
+ */
+static int
+acl_fa_clear_sessions_by_sw_if_index (acl_main_t * am, u16 thread_index)
+{
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+  u32 budget = am->fa_max_expired_sessions_per_run;
+  u32 session_index = pw->clear_session_index;
+  void *oldheap;
+
+  if (~0 == session_index)
+    {
+      /*
+       * Starting the clearing. First filter the sw_if_index bitmap that
+       * they want from us, by a bitmap of sw_if_index for which we
+       * actually have connections.
+       */
+      pw->pending_clear_sw_if_index_bitmap =
+	clib_bitmap_and (pw->pending_clear_sw_if_index_bitmap,
+			 pw->serviced_sw_if_index_bitmap);
+#ifdef FA_NODE_VERBOSE_DEBUG
+      clib_warning
+	("WORKER-CLEAR: clearing sw-if-index bitmap: %U, my serviced bitmap %U",
+	 format_bitmap_hex, pw->pending_clear_sw_if_index_bitmap,
+	 format_bitmap_hex, pw->serviced_sw_if_index_bitmap);
+#endif
+      if (clib_bitmap_is_zero (pw->pending_clear_sw_if_index_bitmap))
+	return 1;
+    }
+
+  oldheap = clib_mem_set_heap (am->acl_mheap);
+  vec_reset_length (pw->to_delete);
+  while (budget-- > 0)
+    {
+      session_index = pool_next_index (pw->fa_sessions_pool, session_index);
+      /*
+       * pool_next_index() returns the start index if there are no used
+       * elements after it, which is free in that case.
+       */
+      if ((~0 == session_index)
+	  || pool_is_free_index (pw->fa_sessions_pool, session_index))
+	{
+	  session_index = ~0;
+	  break;
+	}
+      fa_session_t *sess =
+	pool_elt_at_index (pw->fa_sessions_pool, session_index);
+      if (clib_bitmap_get (pw->pending_clear_sw_if_index_bitmap,
+			   sess->sw_if_index))
+	vec_add1 (pw->to_delete, session_index);
+    }
+  acl_fa_delete_session_batch (am, thread_index, pw->to_delete);
+  clib_mem_set_heap (oldheap);
+  elog_acl_maybe_trace_X2 (am,
+			   "acl_fa_clear_sessions_by_sw_if_index: deleted %d sessions, next index %d",
+			   "i4i4", vec_len (pw->to_delete), session_index);
+  pw->clear_session_index = session_index;
+  return (~0 == session_index);
 }
 
 /*
- * This process ensures the connection cleanup happens every so often
- * even in absence of traffic, as well as provides general orchestration
- * for requests like connection deletion on a given sw_if_index.
+ * This process provides general orchestration for requests
+ * like connection deletion on a given sw_if_index.
+ * The sessions are aged by the workers on their own.
  */
 
 
@@ -246,12 +301,12 @@ static char *acl_fa_cleaner_error_strings[] = {
 
 /* *INDENT-ON* */
 
-static vlib_node_registration_t acl_fa_session_cleaner_process_node;
-static vlib_node_registration_t acl_fa_worker_session_cleaner_process_node;
-
 /*
- * Per-worker thread interrupt-driven cleaner thread
- * to clean idle connections if there are no packets
+ * Per-worker thread cleaner. Polls the timer wheel of the worker while
+ * it has sessions, at the cost of a time check on the loops between the
+ * wheel ticks, and ages them once per tick. Switched to polling by the
+ * first session added, and interrupted to delete the sessions by
+ * sw_if_index.
  */
 static uword
 acl_fa_worker_conn_cleaner_process (vlib_main_t * vm,
@@ -259,249 +314,70 @@ acl_fa_worker_conn_cleaner_process (vlib_main_t * vm,
 				    vlib_frame_t * f)
 {
   acl_main_t *am = &acl_main;
-  u64 now = clib_cpu_time_now ();
   u16 thread_index = os_get_thread_index ();
   acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  int num_expired;
-  elog_acl_maybe_trace_X1 (am,
-			   "acl_fa_worker_conn_cleaner interrupt: now %lu",
-			   "i8", now);
+  f64 now = vlib_time_now (vm);
+
   /* allow another interrupt to be queued */
   pw->interrupt_is_pending = 0;
-  if (pw->clear_in_process)
+  if (PREDICT_FALSE (!am->fa_sessions_hash_is_initialized))
     {
-      if (0 == pw->swipe_end_time)
-	{
-	  /*
-	   * Someone has just set the flag to start clearing.
-	   * we do this by combing through the connections up to a "time T"
-	   * which is now, and requeueing everything except the expired
-	   * connections and those matching the interface(s) being cleared.
-	   */
+      /* no sessions, so nothing to clear either */
+      clib_bitmap_zero (pw->pending_clear_sw_if_index_bitmap);
+      pw->clear_in_process = 0;
+      return 0;
+    }
+  if (PREDICT_FALSE (0 == pw->session_timer_wheel.last_run_time))
+    {
+      pw->session_timer_wheel.last_run_time = now;
+      pw->aged_sessions_rate_time = now;
+    }
 
-	  /*
-	   * first filter the sw_if_index bitmap that they want from us, by
-	   * a bitmap of sw_if_index for which we actually have connections.
-	   */
-	  if ((pw->pending_clear_sw_if_index_bitmap == 0)
-	      || (pw->serviced_sw_if_index_bitmap == 0))
+  if (pw->clear_in_process || (now >= pw->session_timer_wheel.next_run_time))
+    {
+      u64 t0 = clib_cpu_time_now ();
+      if (pw->clear_in_process)
+	{
+	  if (acl_fa_clear_sessions_by_sw_if_index (am, thread_index))
 	    {
 	      elog_acl_maybe_trace_X1 (am,
-				       "acl_fa_worker_conn_cleaner: now %lu, someone tried to call clear but one of the bitmaps are empty",
-				       "i8", now);
+				       "acl_fa_worker_conn_cleaner: now %lu, clearing done",
+				       "i8", t0);
 	      clib_bitmap_zero (pw->pending_clear_sw_if_index_bitmap);
-	    }
-	  else
-	    {
-#ifdef FA_NODE_VERBOSE_DEBUG
-	      clib_warning
-		("WORKER-CLEAR: (before and) swiping sw-if-index bitmap: %U, my serviced bitmap %U",
-		 format_bitmap_hex, pw->pending_clear_sw_if_index_bitmap,
-		 format_bitmap_hex, pw->serviced_sw_if_index_bitmap);
-#endif
-	      pw->pending_clear_sw_if_index_bitmap =
-		clib_bitmap_and (pw->pending_clear_sw_if_index_bitmap,
-				 pw->serviced_sw_if_index_bitmap);
-	    }
-
-	  if (clib_bitmap_is_zero (pw->pending_clear_sw_if_index_bitmap))
-	    {
-	      /* if the cross-section is a zero vector, no need to do anything. */
-	      elog_acl_maybe_trace_X1 (am,
-				       "acl_fa_worker_conn_cleaner: now %lu, clearing done, nothing to do",
-				       "i8", now);
+	      pw->clear_session_index = ~0;
+	      CLIB_MEMORY_BARRIER ();
 	      pw->clear_in_process = 0;
 	    }
-	  else
-	    {
-#ifdef FA_NODE_VERBOSE_DEBUG
-	      clib_warning
-		("WORKER-CLEAR: swiping sw-if-index bitmap: %U, my serviced bitmap %U",
-		 format_bitmap_hex, pw->pending_clear_sw_if_index_bitmap,
-		 format_bitmap_hex, pw->serviced_sw_if_index_bitmap);
-#endif
-	      elog_acl_maybe_trace_X1 (am,
-				       "acl_fa_worker_conn_cleaner: swiping until %lu",
-				       "i8", now);
-	      /* swipe through the connection lists until enqueue timestamps become above "now" */
-	      pw->swipe_end_time = now;
-	    }
-	}
-    }
-  num_expired = acl_fa_check_idle_sessions (am, thread_index, now);
-  // clib_warning("WORKER-CLEAR: checked %d sessions (clear_in_progress: %d)", num_expired, pw->clear_in_process);
-  elog_acl_maybe_trace_X2 (am,
-			   "acl_fa_worker_conn_cleaner: checked %d sessions (clear_in_process: %d)",
-			   "i4i4", (u32) num_expired,
-			   (u32) pw->clear_in_process);
-  if (pw->clear_in_process)
-    {
-      if (0 == num_expired)
-	{
-	  /* we were clearing but we could not process any more connections. time to stop. */
-	  clib_bitmap_zero (pw->pending_clear_sw_if_index_bitmap);
-	  pw->clear_in_process = 0;
-	  elog_acl_maybe_trace_X1 (am,
-				   "acl_fa_worker_conn_cleaner: now %lu, clearing done - all done",
-				   "i8", now);
-	}
-      else
-	{
-	  elog_acl_maybe_trace_X1 (am,
-				   "acl_fa_worker_conn_cleaner: now %lu, more work to do - requesting interrupt",
-				   "i8", now);
-	  /* should continue clearing.. So could they please sent an interrupt again? */
-	  pw->interrupt_is_needed = 1;
 	}
+      acl_fa_age_sessions (am, thread_index, now, t0);
+      pw->cnt_cleaner_runs++;
+      pw->cleaner_cpu_clocks += clib_cpu_time_now () - t0;
     }
-  else
-    {
-      if (num_expired >= am->fa_max_deleted_sessions_per_interval)
-	{
-	  /* there was too much work, we should get an interrupt ASAP */
-	  pw->interrupt_is_needed = 1;
-	  pw->interrupt_is_unwanted = 0;
-	}
-      else if (num_expired <= am->fa_min_deleted_sessions_per_interval)
-	{
-	  /* signal that they should trigger us less */
-	  pw->interrupt_is_needed = 0;
-	  pw->interrupt_is_unwanted = 1;
-	}
-      else
-	{
-	  /* the current rate of interrupts is ok */
-	  pw->interrupt_is_needed = 0;
-	  pw->interrupt_is_unwanted = 0;
-	}
-      elog_acl_maybe_trace_X3 (am,
-			       "acl_fa_worker_conn_cleaner: now %lu, interrupt needed: %u, interrupt unwanted: %u",
-			       "i8i4i4", now, ((u32) pw->interrupt_is_needed),
-			       ((u32) pw->interrupt_is_unwanted));
-    }
-  pw->interrupt_generation = am->fa_interrupt_generation;
-  return 0;
-}
 
-static void
-send_one_worker_interrupt (vlib_main_t * vm, acl_main_t * am,
-			   int thread_index)
-{
-  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  if (!pw->interrupt_is_pending)
-    {
-      pw->interrupt_is_pending = 1;
-      vlib_node_set_interrupt_pending (vlib_mains[thread_index],
-				       acl_fa_worker_session_cleaner_process_node.index);
-      elog_acl_maybe_trace_X1 (am,
-			       "send_one_worker_interrupt: send interrupt to worker %d",
-			       "i4", ((u32) thread_index));
-      /* if the interrupt was requested, mark that done. */
-      /* pw->interrupt_is_needed = 0; */
-    }
-}
-
-static void
-send_interrupts_to_workers (vlib_main_t * vm, acl_main_t * am)
-{
-  int i;
-  /* Can't use vec_len(am->per_worker_data) since the threads might not have come up yet; */
-  int n_threads = vec_len (vlib_mains);
-  for (i = 0; i < n_threads; i++)
-    {
-      send_one_worker_interrupt (vm, am, i);
-    }
+  if ((pool_elts (pw->fa_sessions_pool) != 0) != pw->cleaner_is_polling)
+    acl_fa_worker_cleaner_set_polling (am, pw, thread_index,
+				       !pw->cleaner_is_polling);
+  if (pw->clear_in_process && !pw->cleaner_is_polling)
+    acl_fa_schedule_worker_cleaner (am, pw, thread_index);
+  return 0;
 }
 
-/* centralized process to drive per-worker cleaners */
+/* centralized process to hand the session clearing requests to workers */
 static uword
 acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 				vlib_frame_t * f)
 {
   acl_main_t *am = &acl_main;
   u64 now;
-  f64 cpu_cps = vm->clib_time.clocks_per_second;
-  u64 next_expire;
-  /* We should check if there are connections to clean up - at least twice a second */
-  u64 max_timer_wait_interval = cpu_cps / 2;
   uword event_type, *event_data = 0;
   acl_fa_per_worker_data_t *pw0;
 
-  am->fa_current_cleaner_timer_wait_interval = max_timer_wait_interval;
   am->fa_cleaner_node_index = acl_fa_session_cleaner_process_node.index;
-  am->fa_interrupt_generation = 1;
   while (1)
     {
-      now = clib_cpu_time_now ();
-      next_expire = now + am->fa_current_cleaner_timer_wait_interval;
-      int has_pending_conns = 0;
-      u16 ti;
-      u8 tt;
-
-      /*
-       * walk over all per-thread list heads of different timeouts,
-       * and see if there are any connections pending.
-       * If there aren't - we do not need to wake up until the
-       * worker code signals that it has added a connection.
-       *
-       * Also, while we are at it, calculate the earliest we need to wake up.
-       */
-      for (ti = 0; ti < vec_len (vlib_mains); ti++)
-	{
-	  if (ti >= vec_len (am->per_worker_data))
-	    {
-	      continue;
-	    }
-	  acl_fa_per_worker_data_t *pw = &am->per_worker_data[ti];
-	  for (tt = 0; tt < vec_len (pw->fa_conn_list_head); tt++)
-	    {
-	      u64 head_expiry =
-		acl_fa_get_list_head_expiry_time (am, pw, now, ti, tt);
-	      if ((head_expiry < next_expire) && !pw->interrupt_is_pending)
-		{
-		  elog_acl_maybe_trace_X3 (am,
-					   "acl_fa_session_cleaner_process: now %lu, worker: %d tt: %d",
-					   "i8i2i2", now, ti, tt);
-		  elog_acl_maybe_trace_X2 (am,
-					   "acl_fa_session_cleaner_process: head expiry: %lu, is earlier than curr next expire: %lu",
-					   "i8i8", head_expiry, next_expire);
-		  next_expire = head_expiry;
-		}
-	      if (~0 != pw->fa_conn_list_head[tt])
-		{
-		  has_pending_conns = 1;
-		}
-	    }
-	}
-
-      /* If no pending connections and no ACL applied then no point in timing out */
-      if (!has_pending_conns && (0 == am->fa_total_enabled_count))
-	{
-	  am->fa_cleaner_cnt_wait_without_timeout++;
-	  elog_acl_maybe_trace_X1 (am,
-				   "acl_conn_cleaner: now %lu entering wait without timeout",
-				   "i8", now);
-	  (void) vlib_process_wait_for_event (vm);
-	  event_type = vlib_process_get_events (vm, &event_data);
-	}
-      else
-	{
-	  f64 timeout = ((i64) next_expire - (i64) now) / cpu_cps;
-	  if (timeout <= 0)
-	    {
-	      /* skip waiting altogether */
-	      event_type = ~0;
-	    }
-	  else
-	    {
-	      am->fa_cleaner_cnt_wait_with_timeout++;
-	      elog_acl_maybe_trace_X2 (am,
-				       "acl_conn_cleaner: now %lu entering wait with timeout %.6f sec",
-				       "i8f8", now, timeout);
-	      (void) vlib_process_wait_for_event_or_clock (vm, timeout);
-	      event_type = vlib_process_get_events (vm, &event_data);
-	    }
-	}
+      am->fa_cleaner_cnt_wait_without_timeout++;
+      (void) vlib_process_wait_for_event (vm);
+      event_type = vlib_process_get_events (vm, &event_data);
 
       switch (event_type)
 	{
@@ -557,35 +433,29 @@ acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 					   "i4",
 					   (u32) (pw0 - am->per_worker_data));
 		  vlib_process_suspend (vm, 0.0001);
-		  if (pw0->interrupt_is_needed)
-		    {
-		      send_one_worker_interrupt (vm, am,
-						 (pw0 - am->per_worker_data));
-		    }
 		}
-	      if (pw0->clear_in_process)
+	      if (clear_all)
 		{
-		  clib_warning
-		    ("ERROR-BUG! Could not initiate cleaning on worker because another cleanup in progress");
+		  /* if we need to clear all, then just clear the interfaces that we are servicing */
+		  pw0->pending_clear_sw_if_index_bitmap =
+		    clib_bitmap_dup (pw0->serviced_sw_if_index_bitmap);
 		}
 	      else
 		{
-		  if (clear_all)
-		    {
-		      /* if we need to clear all, then just clear the interfaces that we are servicing */
-		      pw0->pending_clear_sw_if_index_bitmap =
-			clib_bitmap_dup (pw0->serviced_sw_if_index_bitmap);
-		    }
-		  else
-		    {
-		      pw0->pending_clear_sw_if_index_bitmap =
-			clib_bitmap_dup (clear_sw_if_index_bitmap);
-		    }
-		  pw0->clear_in_process = 1;
+		  pw0->pending_clear_sw_if_index_bitmap =
+		    clib_bitmap_dup (clear_sw_if_index_bitmap);
 		}
+	      pw0->clear_session_index = ~0;
+	      CLIB_MEMORY_BARRIER ();
+	      pw0->clear_in_process = 1;
+	      /*
+	       * The worker cleaner might be idle if the worker has
+	       * no sessions, so always kick it here.
+	       */
+	      vlib_node_set_interrupt_pending (vlib_mains
+					       [pw0 - am->per_worker_data],
+					       acl_fa_worker_session_cleaner_process_node.index);
 	    }
-	    /* send some interrupts so they can start working */
-	    send_interrupts_to_workers (vm, am);
 
 	    /* now wait till they all complete */
 #ifdef FA_NODE_VERBOSE_DEBUG
@@ -604,17 +474,13 @@ acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 					   "i4",
 					   (u32) (pw0 - am->per_worker_data));
 		  vlib_process_suspend (vm, 0.0001);
-		  if (pw0->interrupt_is_needed)
-		    {
-		      send_one_worker_interrupt (vm, am,
-						 (pw0 - am->per_worker_data));
-		    }
 		}
 	    }
 #ifdef FA_NODE_VERBOSE_DEBUG
 	    clib_warning ("ACL_FA_NODE_CLEAN: cleaning done");
 #endif
 	    clib_bitmap_free (clear_sw_if_index_bitmap);
+	    am->fa_cleaner_cnt_delete_by_sw_index_ok++;
 	  }
 	  break;
 	default:
@@ -630,67 +496,9 @@ acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 	  break;
 	}
 
-      send_interrupts_to_workers (vm, am);
-
       if (event_data)
 	_vec_len (event_data) = 0;
-
-      /*
-       * If the interrupts were not processed yet, ensure we wait a bit,
-       * but up to a point.
-       */
-      int need_more_wait = 0;
-      int max_wait_cycles = 100;
-      do
-	{
-	  need_more_wait = 0;
-	  vec_foreach (pw0, am->per_worker_data)
-	  {
-	    if (pw0->interrupt_generation != am->fa_interrupt_generation)
-	      {
-		need_more_wait = 1;
-	      }
-	  }
-	  if (need_more_wait)
-	    {
-	      vlib_process_suspend (vm, 0.0001);
-	    }
-	}
-      while (need_more_wait && (--max_wait_cycles > 0));
-
-      int interrupts_needed = 0;
-      int interrupts_unwanted = 0;
-
-      vec_foreach (pw0, am->per_worker_data)
-      {
-	if (pw0->interrupt_is_needed)
-	  {
-	    interrupts_needed++;
-	    /* the per-worker value is reset when sending the interrupt */
-	  }
-	if (pw0->interrupt_is_unwanted)
-	  {
-	    interrupts_unwanted++;
-	    pw0->interrupt_is_unwanted = 0;
-	  }
-      }
-      if (interrupts_needed)
-	{
-	  /* they need more interrupts, do less waiting around next time */
-	  am->fa_current_cleaner_timer_wait_interval /= 2;
-	  /* never go into zero-wait either though - we need to give the space to others */
-	  am->fa_current_cleaner_timer_wait_interval += 1;
-	}
-      else if (interrupts_unwanted)
-	{
-	  /* slowly increase the amount of sleep up to a limit */
-	  if (am->fa_current_cleaner_timer_wait_interval <
-	      max_timer_wait_interval)
-	    am->fa_current_cleaner_timer_wait_interval +=
-	      cpu_cps * am->fa_cleaner_wait_time_increment;
-	}
       am->fa_cleaner_cnt_event_cycles++;
-      am->fa_interrupt_generation++;
     }
   /* NOT REACHED */
   return 0;
@@ -758,6 +566,82 @@ acl_fa_enable_disable (u32 sw_if_index, int is_input, int enable_disable)
     }
 }
 
+/*
+ * Create a number of UDP sessions on local0 owned by the calling thread
+ * and measure how long the cleaner takes to age them out.
+ */
+clib_error_t *
+acl_fa_session_aging_perf (vlib_main_t * vm, u32 n_sessions,
+			   u32 idle_timeout, u32 seed)
+{
+  acl_main_t *am = &acl_main;
+  u16 thread_index = os_get_thread_index ();
+  acl_fa_per_worker_data_t *pw;
+  u32 saved_timeout = am->session_timeout_sec[ACL_TIMEOUT_UDP_IDLE];
+  u32 sw_if_index = 0;
+  u32 initial_seed = seed;
+  u64 aged0, clocks0, runs0, restarted0, n_aged, n_clocks;
+  u32 i, n_added = 0;
+  f64 t0, t_added, t_done, deadline;
+
+  acl_fa_verify_init_sessions (am);
+  pw = &am->per_worker_data[thread_index];
+  am->session_timeout_sec[ACL_TIMEOUT_UDP_IDLE] = idle_timeout;
+  aged0 = pw->cnt_aged_sessions;
+  clocks0 = pw->cleaner_cpu_clocks;
+  runs0 = pw->cnt_cleaner_runs;
+  restarted0 = pw->cnt_session_timer_restarted;
+
+  t0 = vlib_time_now (vm);
+  for (i = 0; i < n_sessions; i++)
+    {
+      clib_bihash_kv_40_8_t value_sess;
+      fa_5tuple_t key;
+
+      if (!acl_fa_can_add_session (am, 1, sw_if_index))
+	break;
+      memset (&key, 0, sizeof (key));
+      key.addr[0].ip4.as_u32 = random_u32 (&seed);
+      key.addr[1].ip4.as_u32 = random_u32 (&seed);
+      key.l4.port[0] = random_u32 (&seed);
+      key.l4.port[1] = random_u32 (&seed);
+      key.l4.proto = IP_PROTOCOL_UDP;
+      key.l4.lsb_of_sw_if_index = sw_if_index & 0xffff;
+      key.pkt.l4_valid = 1;
+      if (acl_fa_find_session (am, sw_if_index, &key, &value_sess))
+	continue;
+      acl_fa_add_session (am, 1, sw_if_index, clib_cpu_time_now (), &key,
+			  0);
+      n_added++;
+    }
+  t_added = vlib_time_now (vm);
+  vlib_cli_output (vm, "%u sessions added in %.3f sec (%.2f Msessions/s), "
+		   "idle timeout %u sec, seed 0x%x", n_added, t_added - t0,
+		   t_added > t0 ? 1e-6 * n_added / (t_added - t0) : 0.0,
+		   idle_timeout, initial_seed);
+
+  deadline = t_added + idle_timeout + 10.0;
+  while ((pw->cnt_aged_sessions - aged0 < n_added)
+	 && (vlib_time_now (vm) < deadline))
+    vlib_process_suspend (vm, 0.01);
+  t_done = vlib_time_now (vm);
+  am->session_timeout_sec[ACL_TIMEOUT_UDP_IDLE] = saved_timeout;
+
+  n_aged = pw->cnt_aged_sessions - aged0;
+  n_clocks = pw->cleaner_cpu_clocks - clocks0;
+  vlib_cli_output (vm, "%lu sessions aged %.3f sec after the last add, "
+		   "%lu timers restarted", n_aged, t_done - t_added,
+		   pw->cnt_session_timer_restarted - restarted0);
+  vlib_cli_output (vm, "cleaner: %lu runs, %.6f sec CPU, %.2f clocks per "
+		   "aged session", pw->cnt_cleaner_runs - runs0,
+		   (f64) n_clocks / vm->clib_time.clocks_per_second,
+		   n_aged ? (f64) n_clocks / n_aged : 0.0);
+  if (n_aged < n_added)
+    return clib_error_return (0, "%lu sessions were not aged in time",
+			      n_added - n_aged);
+  return 0;
+}
+
 void
 show_fa_sessions_hash (vlib_main_t * vm, u32 verbose)
 {
@@ -195,6 +195,83 @@ is_valid_session_ptr (acl_main_t * am, u16 thread_index, fa_session_t * sess)
 	      pool_len (pw->fa_sessions_pool)));
 }
 
+/*
+ * Convert a session timeout in CPU clocks into the timer wheel ticks,
+ * rounding up so the timer never fires before the timeout has passed.
+ */
+always_inline u64
+acl_fa_clocks_to_timer_ticks (acl_main_t * am, u64 clocks)
+{
+  f64 clocks_per_tick =
+    am->vlib_main->clib_time.clocks_per_second * ACL_FA_TW_TICK;
+  return 1 + (u64) (clocks / clocks_per_tick);
+}
+
+always_inline void
+acl_fa_session_timer_start (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+			    u32 session_index, fa_session_t * sess,
+			    u64 timeout)
+{
+  sess->timer_handle =
+    tw_timer_start_1t_3w_1024sl_ov (&pw->session_timer_wheel, session_index,
+				    0, acl_fa_clocks_to_timer_ticks (am,
+								     timeout));
+}
+
+always_inline void
+acl_fa_session_timer_stop (acl_fa_per_worker_data_t * pw,
+			   fa_session_t * sess)
+{
+  if (~0 != sess->timer_handle)
+    {
+      tw_timer_stop_1t_3w_1024sl_ov (&pw->session_timer_wheel,
+				     sess->timer_handle);
+      sess->timer_handle = ~0;
+    }
+}
+
+/*
+ * Interrupt the cleaner node of a worker, e.g. to clear the sessions
+ * of some interfaces.
+ */
+always_inline void
+acl_fa_schedule_worker_cleaner (acl_main_t * am,
+				acl_fa_per_worker_data_t * pw,
+				u16 thread_index)
+{
+  if (PREDICT_FALSE (!pw->interrupt_is_pending))
+    {
+      pw->interrupt_is_pending = 1;
+      vlib_node_set_interrupt_pending (vlib_mains[thread_index],
+				       am->fa_worker_cleaner_node_index);
+    }
+}
+
+/*
+ * The cleaner node of a worker polls its own timer wheel while the
+ * worker has sessions, and only runs when interrupted otherwise.
+ * Called on the worker itself.
+ */
+always_inline void
+acl_fa_worker_cleaner_set_polling (acl_main_t * am,
+				   acl_fa_per_worker_data_t * pw,
+				   u16 thread_index, int is_polling)
+{
+  tw_timer_wheel_1t_3w_1024sl_ov_t *tw = &pw->session_timer_wheel;
+
+  if (is_polling)
+    {
+      /* the wheel did not turn while idle, restart it from now */
+      tw->last_run_time = vlib_time_now (vlib_mains[thread_index]);
+      tw->next_run_time = tw->last_run_time + ACL_FA_TW_TICK;
+    }
+  pw->cleaner_is_polling = is_polling;
+  vlib_node_set_state (vlib_mains[thread_index],
+		       am->fa_worker_cleaner_node_index,
+		       is_polling ? VLIB_NODE_STATE_POLLING :
+		       VLIB_NODE_STATE_INTERRUPT);
+}
+
 always_inline void
 acl_fa_conn_list_add_session (acl_main_t * am, fa_full_session_id_t sess_id,
 			      u64 now)
@@ -287,17 +364,25 @@ acl_fa_restart_timer_for_session (acl_main_t * am, u64 now,
 {
   if (acl_fa_conn_list_delete_session (am, sess_id))
     {
+      acl_fa_per_worker_data_t *pw =
+	&am->per_worker_data[sess_id.thread_index];
+      fa_session_t *sess =
+	get_session_ptr (am, sess_id.thread_index, sess_id.session_index);
+      void *oldheap = clib_mem_set_heap (am->acl_mheap);
       acl_fa_conn_list_add_session (am, sess_id, now);
+      acl_fa_session_timer_stop (pw, sess);
+      acl_fa_session_timer_start (am, pw, sess_id.session_index, sess,
+				  fa_session_get_timeout (am, sess));
+      clib_mem_set_heap (oldheap);
       return 1;
     }
   else
     {
       /*
-       * Our thread does not own this connection, so we can not delete
-       * The session. To avoid the complicated signaling, we simply
-       * pick the list waiting time to be the shortest of the timeouts.
-       * This way we do not have to do anything special, and let
-       * the regular requeue check take care of everything.
+       * Our thread does not own this connection, so we can not touch
+       * its timer. To avoid the complicated signaling, the owner
+       * restarts the timers for at most the shortest of the timeouts,
+       * so the new timeout type is picked up on the next expiry.
        */
       return 0;
     }
@@ -327,9 +412,10 @@ acl_fa_delete_session (acl_main_t * am, u32 sw_if_index,
   ASSERT (sess->thread_index == os_get_thread_index ());
   clib_bihash_add_del_40_8 (&am->fa_sessions_hash, &sess->info.kv, 0);
   acl_fa_per_worker_data_t *pw = &am->per_worker_data[sess_id.thread_index];
+  acl_fa_session_timer_stop (pw, sess);
   pool_put_index (pw->fa_sessions_pool, sess_id.session_index);
-  /* Deleting from timer structures not needed,
-     as the caller must have dealt with the timers. */
+  /* Unlinking from the conn lists is not done here,
+     as the caller must have dealt with them. */
   vec_validate (pw->fa_session_dels_by_sw_if_index, sw_if_index);
   clib_mem_set_heap (oldheap);
   pw->fa_session_dels_by_sw_if_index[sw_if_index]++;
@@ -395,17 +481,20 @@ acl_fa_add_session (acl_main_t * am, int is_input, u32 sw_if_index, u64 now,
   sess->link_list_id = ~0;
   sess->link_prev_idx = ~0;
   sess->link_next_idx = ~0;
-
-
+  sess->timer_handle = ~0;
 
   ASSERT (am->fa_sessions_hash_is_initialized == 1);
   clib_bihash_add_del_40_8 (&am->fa_sessions_hash, &kv, 1);
   acl_fa_conn_list_add_session (am, f_sess_id, now);
+  acl_fa_session_timer_start (am, pw, f_sess_id.session_index, sess,
+			      fa_session_get_timeout (am, sess));
 
   vec_validate (pw->fa_session_adds_by_sw_if_index, sw_if_index);
   clib_mem_set_heap (oldheap);
   pw->fa_session_adds_by_sw_if_index[sw_if_index]++;
   clib_smp_atomic_add (&am->fa_session_total_adds, 1);
+  if (PREDICT_FALSE (!pw->cleaner_is_polling))
+    acl_fa_worker_cleaner_set_polling (am, pw, thread_index, 1);
   return sess;
 }
 
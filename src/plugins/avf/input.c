@@ -164,10 +164,10 @@ avf_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   u16 n_rxv = 0;
   u8 maybe_error = 0;
 
-  /* fetch up to AVF_RX_VECTOR_SZ from the rx ring, unflatten them and
+  /* fetch up to one frame from the rx ring, unflatten them and
      copy needed data from descriptor to rx vector */
   d = rxq->descs + rxq->next;
-  while ((d->qword[1] & AVF_RX_DESC_STATUS_DD) && n_rxv < AVF_RX_VECTOR_SZ)
+  while ((d->qword[1] & AVF_RX_DESC_STATUS_DD) && n_rxv < vm->frame_size)
     {
       u16 next_pf = (rxq->next + 8) & mask;
       CLIB_PREFETCH (rxq->descs + next_pf, CLIB_CACHE_LINE_BYTES, LOAD);
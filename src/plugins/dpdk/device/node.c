@@ -471,12 +471,12 @@ dpdk_device_input (vlib_main_t * vm, dpdk_main_t * dm, dpdk_device_t * xd,
   if ((xd->flags & DPDK_DEVICE_FLAG_ADMIN_UP) == 0)
     return 0;
 
-  /* get up to DPDK_RX_BURST_SZ buffers from PMD */
-  while (n_rx_packets < DPDK_RX_BURST_SZ)
+  /* get up to one frame of buffers from PMD */
+  while (n_rx_packets < vm->frame_size)
     {
       n = rte_eth_rx_burst (xd->device_index, queue_id,
 			    ptd->mbufs + n_rx_packets,
-			    DPDK_RX_BURST_SZ - n_rx_packets);
+			    vm->frame_size - n_rx_packets);
       n_rx_packets += n;
 
       if (n < 32)
@@ -460,13 +460,28 @@ flowprobe_expired_timer_callback (u32 * expired_timers)
   vlib_main_t *vm = vlib_get_main ();
   flowprobe_main_t *fm = &flowprobe_main;
   u32 my_cpu_number = vm->thread_index;
+  flowprobe_entry_t *e;
   int i;
-  u32 poolindex;
+  u32 poolindex, timer_id;
 
   for (i = 0; i < vec_len (expired_timers); i++)
     {
       poolindex = expired_timers[i] & 0x7FFFFFFF;
-      vec_add1 (fm->expired_passive_per_worker[my_cpu_number], poolindex);
+      timer_id = expired_timers[i] >> 31;
+      e = pool_elt_at_index (fm->pool_per_worker[my_cpu_number], poolindex);
+
+      /* The timer is gone, the walker rearms it if the flow lives on */
+      if (timer_id == FLOWPROBE_TIMER_ID_ACTIVE)
+	{
+	  e->active_timer_handle = ~0;
+	  vec_add1 (fm->expired_active_per_worker[my_cpu_number], poolindex);
+	}
+      else
+	{
+	  e->passive_timer_handle = ~0;
+	  vec_add1 (fm->expired_passive_per_worker[my_cpu_number],
+		    poolindex);
+	}
     }
 }
 
@@ -486,21 +501,27 @@ flowprobe_create_state_tables (u32 active_timer)
   /* Hash table per worker */
   fm->ht_log2len = FLOWPROBE_LOG2_HASHSIZE;
 
+  /* Per worker packet scratch space and export flush schedule */
+  vec_validate (fm->pkts_per_worker, num_threads - 1);
+  vec_validate (fm->next_flush_per_worker, num_threads - 1);
+  for (i = 0; i < num_threads; i++)
+    vec_validate (fm->pkts_per_worker[i], VLIB_FRAME_SIZE - 1);
+
   /* Init per worker flow state and timer wheels */
   if (active_timer)
     {
       vec_validate (fm->timers_per_worker, num_threads - 1);
       vec_validate (fm->expired_passive_per_worker, num_threads - 1);
-      vec_validate (fm->hash_per_worker, num_threads - 1);
+      vec_validate (fm->expired_active_per_worker, num_threads - 1);
+      vec_validate (fm->flow_table_per_worker, num_threads - 1);
       vec_validate (fm->pool_per_worker, num_threads - 1);
 
       for (i = 0; i < num_threads; i++)
 	{
-	  int j;
 	  pool_alloc (fm->pool_per_worker[i], 1 << fm->ht_log2len);
-	  vec_resize (fm->hash_per_worker[i], 1 << fm->ht_log2len);
-	  for (j = 0; j < (1 << fm->ht_log2len); j++)
-	    fm->hash_per_worker[i][j] = ~0;
+	  clib_bihash_init_8_8 (&fm->flow_table_per_worker[i],
+				"flowprobe flow table", 1 << fm->ht_log2len,
+				FLOWPROBE_HT_MEMORY_SIZE);
 	  fm->timers_per_worker[i] =
 	    clib_mem_alloc (sizeof (TWT (tw_timer_wheel)));
 	  tw_timer_wheel_init_2t_1w_2048sl (fm->timers_per_worker[i],
@@ -825,9 +846,16 @@ flowprobe_show_stats_fn (vlib_main_t * vm,
 		   0x1 << FLOWPROBE_LOG2_HASHSIZE);
 
   for (i = 0; i < vec_len (fm->pool_per_worker); i++)
-    vlib_cli_output (vm, "Pool utilisation thread %d is %d%%\n", i,
-		     (100 * pool_elts (fm->pool_per_worker[i])) /
-		     (0x1 << FLOWPROBE_LOG2_HASHSIZE));
+    {
+      vlib_cli_output (vm, "Pool utilisation thread %d is %d%%\n", i,
+		       (100 * pool_elts (fm->pool_per_worker[i])) /
+		       (0x1 << FLOWPROBE_LOG2_HASHSIZE));
+      vlib_cli_output (vm, "Thread %d: %d flows, %d active and %d passive "
+		       "expiries pending\n", i,
+		       pool_elts (fm->pool_per_worker[i]),
+		       vec_len (fm->expired_active_per_worker[i]),
+		       vec_len (fm->expired_passive_per_worker[i]));
+    }
   return 0;
 }
 
@@ -1058,10 +1086,13 @@ timer_process (vlib_main_t * vm, vlib_node_runtime_t * rt, vlib_frame_t * f)
 	  worker_vm = worker_vms[i];
 	  if (worker_vm)
 	    {
+	      u32 ti = worker_vm->thread_index;
 	      vlib_node_set_interrupt_pending (worker_vm,
 					       flowprobe_walker_node.index);
-	      sleep_duration =
-		(fm->expired_passive_per_worker[i] > 0) ? 1e-4 : 0.1;
+	      /* Come back soon while any walker has a backlog */
+	      if (vec_len (fm->expired_passive_per_worker[ti])
+		  || vec_len (fm->expired_active_per_worker[ti]))
+		sleep_duration = 1e-4;
 	    }
 	}
       vlib_process_suspend (vm, sleep_duration);
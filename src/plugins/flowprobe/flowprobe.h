@@ -26,11 +26,17 @@
 #include <vnet/ipfix-export/flow_report.h>
 #include <vnet/ipfix-export/flow_report_classify.h>
 #include <vppinfra/tw_timer_2t_1w_2048sl.h>
+#include <vppinfra/bihash_8_8.h>
 
 /* Default timers in seconds */
 #define FLOWPROBE_TIMER_ACTIVE   (15)
 #define FLOWPROBE_TIMER_PASSIVE  120	// XXXX: FOR TESTING (30*60)
 #define FLOWPROBE_LOG2_HASHSIZE  (18)
+#define FLOWPROBE_HT_MEMORY_SIZE (128 << 20)
+
+/* Per flow timer ids in the 2 timer per object wheel */
+#define FLOWPROBE_TIMER_ID_PASSIVE	0
+#define FLOWPROBE_TIMER_ID_ACTIVE	1
 
 typedef enum
 {
@@ -104,6 +110,7 @@ typedef struct
   f64 last_updated;
   f64 last_exported;
   u32 passive_timer_handle;
+  u32 active_timer_handle;
   union
   {
     struct
@@ -113,6 +120,21 @@ typedef struct
   } prot;
 } flowprobe_entry_t;
 
+/**
+ * Per packet scratch state, filled in while the frame is walked and
+ * consumed by the flow table update once all bucket prefetches are out.
+ */
+typedef struct
+{
+  flowprobe_key_t key;
+  /** flow table key, a 64 bit hash of the flow key */
+  u64 hash;
+  /** bihash bucket hash of the above */
+  u64 bucket_hash;
+  u16 octets;
+  u8 tcp_flags;
+} flowprobe_pkt_t;
+
 /**
  * @file
  * @brief flow-per-packet plugin header file
@@ -131,13 +153,17 @@ typedef struct
   f64 vlib_time_0;
 
   /** Per CPU flow-state */
-  u8 ht_log2len;		/* Hash table size is 2^log2len */
-  u32 **hash_per_worker;
+  u8 ht_log2len;		/* Hash table has 2^log2len buckets */
+  clib_bihash_8_8_t *flow_table_per_worker;
   flowprobe_entry_t **pool_per_worker;
   /* *INDENT-OFF* */
   TWT (tw_timer_wheel) ** timers_per_worker;
   /* *INDENT-ON* */
   u32 **expired_passive_per_worker;
+  u32 **expired_active_per_worker;
+  flowprobe_pkt_t **pkts_per_worker;
+  /** next flush of partially filled export buffers, per worker */
+  f64 *next_flush_per_worker;
 
   flowprobe_record_t record;
   u32 active_timer;
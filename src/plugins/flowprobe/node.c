@@ -17,7 +17,6 @@
 #include <vlib/vlib.h>
 #include <vnet/vnet.h>
 #include <vnet/pg/pg.h>
-#include <vppinfra/crc32.h>
 #include <vppinfra/error.h>
 #include <flowprobe/flowprobe.h>
 #include <vnet/ip/ip6_packet.h>
@@ -101,11 +100,13 @@ vlib_node_registration_t flowprobe_ip4_node;
 vlib_node_registration_t flowprobe_ip6_node;
 vlib_node_registration_t flowprobe_l2_node;
 
-/* No counters at the moment */
 #define foreach_flowprobe_error			\
 _(COLLISION, "Hash table collisions")		\
 _(BUFFER, "Buffer allocation error")		\
 _(EXPORTED_PACKETS, "Exported packets")		\
+_(EXPORTED_RECORDS, "Exported flow records")	\
+_(CREATED, "Flows created")			\
+_(EXPIRED, "Flows expired")			\
 _(INPATH, "Exported packets in path")
 
 typedef enum
@@ -282,104 +283,84 @@ flowprobe_l4_add (vlib_buffer_t * to_b, flowprobe_entry_t * e, u16 offset)
   return offset - start;
 }
 
-static inline u32
+static inline u64
 flowprobe_hash (flowprobe_key_t * k)
 {
-  flowprobe_main_t *fm = &flowprobe_main;
-  u32 h = 0;
-
-#ifdef clib_crc32c_uses_intrinsics
-  h = clib_crc32c ((u8 *) k, sizeof (*k));
-#else
+  u64 h = 0;
   int i;
-  u64 tmp = 0;
-  for (i = 0; i < sizeof (*k) / 8; i++)
-    tmp ^= ((u64 *) k)[i];
 
-  h = clib_xxhash (tmp);
-#endif
+  for (i = 0; i < sizeof (*k) / sizeof (u64); i++)
+    h = clib_xxhash (h ^ ((u64 *) k)[i]);
 
-  return h >> (32 - fm->ht_log2len);
+  return h;
 }
 
-flowprobe_entry_t *
-flowprobe_lookup (u32 my_cpu_number, flowprobe_key_t * k, u32 * poolindex,
-		  bool * collision)
+/*
+ * Compute the flow table key and bucket hash of a parsed packet and
+ * prefetch its bucket, the lookup happens once the whole frame is parsed.
+ */
+static inline void
+flowprobe_pkt_hash (clib_bihash_8_8_t * h, flowprobe_pkt_t * p)
 {
-  flowprobe_main_t *fm = &flowprobe_main;
-  flowprobe_entry_t *e;
-  u32 h;
-
-  h = (fm->active_timer) ? flowprobe_hash (k) : 0;
-
-  /* Lookup in the flow state pool */
-  *poolindex = fm->hash_per_worker[my_cpu_number][h];
-  if (*poolindex != ~0)
-    {
-      e = pool_elt_at_index (fm->pool_per_worker[my_cpu_number], *poolindex);
-      if (e)
-	{
-	  /* Verify key or report collision */
-	  if (memcmp (k, &e->key, sizeof (flowprobe_key_t)))
-	    *collision = true;
-	  return e;
-	}
-    }
+  clib_bihash_kv_8_8_t kv;
 
-  return 0;
+  p->hash = flowprobe_hash (&p->key);
+  kv.key = p->hash;
+  p->bucket_hash = clib_bihash_hash_8_8 (&kv);
+  clib_bihash_prefetch_bucket_8_8 (h, p->bucket_hash);
 }
 
-flowprobe_entry_t *
-flowprobe_create (u32 my_cpu_number, flowprobe_key_t * k, u32 * poolindex)
+static flowprobe_entry_t *
+flowprobe_create (u32 my_cpu_number, flowprobe_key_t * k, u64 hash,
+		  u32 * poolindex)
 {
   flowprobe_main_t *fm = &flowprobe_main;
-  u32 h;
-
+  TWT (tw_timer_wheel) * tw = fm->timers_per_worker[my_cpu_number];
+  clib_bihash_kv_8_8_t kv;
   flowprobe_entry_t *e;
 
-  /* Get my index */
-  h = (fm->active_timer) ? flowprobe_hash (k) : 0;
-
   pool_get (fm->pool_per_worker[my_cpu_number], e);
+  memset (e, 0, sizeof (*e));
   *poolindex = e - fm->pool_per_worker[my_cpu_number];
-  fm->hash_per_worker[my_cpu_number][h] = *poolindex;
+
+  kv.key = hash;
+  kv.value = *poolindex;
+  clib_bihash_add_del_8_8 (&fm->flow_table_per_worker[my_cpu_number], &kv,
+			   1 /* is_add */ );
 
   e->key = *k;
+  e->passive_timer_handle = ~0;
+  e->active_timer_handle = ~0;
 
   if (fm->passive_timer > 0)
-    {
-      e->passive_timer_handle = tw_timer_start_2t_1w_2048sl
-	(fm->timers_per_worker[my_cpu_number], *poolindex, 0,
-	 fm->passive_timer);
-    }
+    e->passive_timer_handle = tw_timer_start_2t_1w_2048sl
+      (tw, *poolindex, FLOWPROBE_TIMER_ID_PASSIVE, fm->passive_timer);
+  e->active_timer_handle = tw_timer_start_2t_1w_2048sl
+    (tw, *poolindex, FLOWPROBE_TIMER_ID_ACTIVE, fm->active_timer);
+
   return e;
 }
 
 static inline void
-add_to_flow_record_state (vlib_main_t * vm, vlib_node_runtime_t * node,
-			  flowprobe_main_t * fm, vlib_buffer_t * b,
-			  timestamp_nsec_t timestamp, u16 length,
-			  flowprobe_variant_t which, flowprobe_trace_t * t)
+flowprobe_parse (vlib_main_t * vm, flowprobe_main_t * fm, vlib_buffer_t * b,
+		 flowprobe_variant_t which, flowprobe_pkt_t * p,
+		 flowprobe_trace_t * t)
 {
-  if (fm->disabled)
-    return;
-
-  u32 my_cpu_number = vm->thread_index;
-  u16 octets = 0;
-
   flowprobe_record_t flags = fm->context[which].flags;
   bool collect_ip4 = false, collect_ip6 = false;
   ASSERT (b);
   ethernet_header_t *eth = vlib_buffer_get_current (b);
   u16 ethertype = clib_net_to_host_u16 (eth->type);
-  /* *INDENT-OFF* */
-  flowprobe_key_t k = {};
-  /* *INDENT-ON* */
+  flowprobe_key_t *k = &p->key;
   ip4_header_t *ip4 = 0;
   ip6_header_t *ip6 = 0;
   udp_header_t *udp = 0;
   tcp_header_t *tcp = 0;
-  u8 tcp_flags = 0;
+
+  /* The key is compared and hashed as a whole, padding included */
+  memset (k, 0, sizeof (*k));
+  p->octets = 0;
+  p->tcp_flags = 0;
 
   if (flags & FLOW_RECORD_L3 || flags & FLOW_RECORD_L4)
     {
@@ -387,34 +368,34 @@ add_to_flow_record_state (vlib_main_t * vm, vlib_node_runtime_t * node,
       collect_ip6 = which == FLOW_VARIANT_L2_IP6 || which == FLOW_VARIANT_IP6;
     }
 
-  k.rx_sw_if_index = vnet_buffer (b)->sw_if_index[VLIB_RX];
-  k.tx_sw_if_index = vnet_buffer (b)->sw_if_index[VLIB_TX];
+  k->rx_sw_if_index = vnet_buffer (b)->sw_if_index[VLIB_RX];
+  k->tx_sw_if_index = vnet_buffer (b)->sw_if_index[VLIB_TX];
 
-  k.which = which;
+  k->which = which;
 
   if (flags & FLOW_RECORD_L2)
     {
-      clib_memcpy (k.src_mac, eth->src_address, 6);
-      clib_memcpy (k.dst_mac, eth->dst_address, 6);
-      k.ethertype = ethertype;
+      clib_memcpy (k->src_mac, eth->src_address, 6);
+      clib_memcpy (k->dst_mac, eth->dst_address, 6);
+      k->ethertype = ethertype;
     }
   if (collect_ip6 && ethertype == ETHERNET_TYPE_IP6)
     {
       ip6 = (ip6_header_t *) (eth + 1);
       if (flags & FLOW_RECORD_L3)
 	{
-	  k.src_address.as_u64[0] = ip6->src_address.as_u64[0];
-	  k.src_address.as_u64[1] = ip6->src_address.as_u64[1];
-	  k.dst_address.as_u64[0] = ip6->dst_address.as_u64[0];
-	  k.dst_address.as_u64[1] = ip6->dst_address.as_u64[1];
+	  k->src_address.as_u64[0] = ip6->src_address.as_u64[0];
+	  k->src_address.as_u64[1] = ip6->src_address.as_u64[1];
+	  k->dst_address.as_u64[0] = ip6->dst_address.as_u64[0];
+	  k->dst_address.as_u64[1] = ip6->dst_address.as_u64[1];
 	}
-      k.protocol = ip6->protocol;
-      if (k.protocol == IP_PROTOCOL_UDP)
+      k->protocol = ip6->protocol;
+      if (k->protocol == IP_PROTOCOL_UDP)
 	udp = (udp_header_t *) (ip6 + 1);
-      else if (k.protocol == IP_PROTOCOL_TCP)
+      else if (k->protocol == IP_PROTOCOL_TCP)
 	tcp = (tcp_header_t *) (ip6 + 1);
 
-      octets = clib_net_to_host_u16 (ip6->payload_length)
+      p->octets = clib_net_to_host_u16 (ip6->payload_length)
 	+ sizeof (ip6_header_t);
     }
   if (collect_ip4 && ethertype == ETHERNET_TYPE_IP4)
@@ -422,88 +403,136 @@ add_to_flow_record_state (vlib_main_t * vm, vlib_node_runtime_t * node,
       ip4 = (ip4_header_t *) (eth + 1);
       if (flags & FLOW_RECORD_L3)
 	{
-	  k.src_address.ip4.as_u32 = ip4->src_address.as_u32;
-	  k.dst_address.ip4.as_u32 = ip4->dst_address.as_u32;
+	  k->src_address.ip4.as_u32 = ip4->src_address.as_u32;
+	  k->dst_address.ip4.as_u32 = ip4->dst_address.as_u32;
 	}
-      k.protocol = ip4->protocol;
-      if ((flags & FLOW_RECORD_L4) && k.protocol == IP_PROTOCOL_UDP)
+      k->protocol = ip4->protocol;
+      if ((flags & FLOW_RECORD_L4) && k->protocol == IP_PROTOCOL_UDP)
 	udp = (udp_header_t *) (ip4 + 1);
-      else if ((flags & FLOW_RECORD_L4) && k.protocol == IP_PROTOCOL_TCP)
+      else if ((flags & FLOW_RECORD_L4) && k->protocol == IP_PROTOCOL_TCP)
 	tcp = (tcp_header_t *) (ip4 + 1);
 
-      octets = clib_net_to_host_u16 (ip4->length);
+      p->octets = clib_net_to_host_u16 (ip4->length);
     }
 
   if (udp)
     {
-      k.src_port = udp->src_port;
-      k.dst_port = udp->dst_port;
+      k->src_port = udp->src_port;
+      k->dst_port = udp->dst_port;
     }
   else if (tcp)
     {
-      k.src_port = tcp->src_port;
-      k.dst_port = tcp->dst_port;
-      tcp_flags = tcp->flags;
+      k->src_port = tcp->src_port;
+      k->dst_port = tcp->dst_port;
+      p->tcp_flags = tcp->flags;
     }
 
   if (t)
     {
-      t->rx_sw_if_index = k.rx_sw_if_index;
-      t->tx_sw_if_index = k.tx_sw_if_index;
-      clib_memcpy (t->src_mac, k.src_mac, 6);
-      clib_memcpy (t->dst_mac, k.dst_mac, 6);
-      t->ethertype = k.ethertype;
-      t->src_address.ip4.as_u32 = k.src_address.ip4.as_u32;
-      t->dst_address.ip4.as_u32 = k.dst_address.ip4.as_u32;
-      t->protocol = k.protocol;
-      t->src_port = k.src_port;
-      t->dst_port = k.dst_port;
-      t->which = k.which;
+      t->rx_sw_if_index = k->rx_sw_if_index;
+      t->tx_sw_if_index = k->tx_sw_if_index;
+      clib_memcpy (t->src_mac, k->src_mac, 6);
+      clib_memcpy (t->dst_mac, k->dst_mac, 6);
+      t->ethertype = k->ethertype;
+      t->src_address.ip4.as_u32 = k->src_address.ip4.as_u32;
+      t->dst_address.ip4.as_u32 = k->dst_address.ip4.as_u32;
+      t->protocol = k->protocol;
+      t->src_port = k->src_port;
+      t->dst_port = k->dst_port;
+      t->which = k->which;
     }
 
-  flowprobe_entry_t *e = 0;
-  f64 now = vlib_time_now (vm);
   if (fm->active_timer > 0)
+    flowprobe_pkt_hash (&fm->flow_table_per_worker[vm->thread_index], p);
+}
+
+static inline void
+flowprobe_entry_update (flowprobe_entry_t * e, flowprobe_pkt_t * p,
+			timestamp_nsec_t timestamp, f64 now)
+{
+  e->packetcount++;
+  e->octetcount += p->octets;
+  e->last_updated = now;
+  e->flow_end = timestamp;
+  e->prot.tcp.flags |= p->tcp_flags;
+}
+
+/*
+ * Account a vector of parsed packets to their flows. Bucket prefetches
+ * were issued by flowprobe_parse, the bucket data is prefetched two
+ * packets ahead of the lookup. Active and passive expiry are left to the
+ * timer wheel.
+ */
+static void
+flowprobe_update_pkts (vlib_main_t * vm, u32 node_index,
+		       flowprobe_pkt_t * pkts, u32 n_pkts,
+		       timestamp_nsec_t timestamp)
+{
+  flowprobe_main_t *fm = &flowprobe_main;
+  u32 my_cpu_number = vm->thread_index;
+  u32 n_created = 0, n_collisions = 0;
+  f64 now = vlib_time_now (vm);
+  clib_bihash_8_8_t *h;
+  flowprobe_entry_t *e;
+  u32 i;
+
+  if (fm->active_timer == 0)
     {
-      u32 poolindex = ~0;
-      bool collision = false;
+      e = &fm->stateless_entry[my_cpu_number];
+      for (i = 0; i < n_pkts; i++)
+	{
+	  e->key = pkts[i].key;
+	  flowprobe_entry_update (e, pkts + i, timestamp, now);
+	  flowprobe_export_entry (vm, e);
+	}
+      return;
+    }
+
+  h = &fm->flow_table_per_worker[my_cpu_number];
 
-      e = flowprobe_lookup (my_cpu_number, &k, &poolindex, &collision);
-      if (collision)
+  for (i = 0; i < n_pkts; i++)
+    {
+      flowprobe_pkt_t *p = pkts + i;
+      clib_bihash_kv_8_8_t kv;
+      u32 poolindex;
+
+      if (i + 2 < n_pkts)
+	clib_bihash_prefetch_data_8_8 (h, pkts[i + 2].bucket_hash);
+
+      kv.key = p->hash;
+      if (clib_bihash_search_inline_with_hash_8_8 (h, p->bucket_hash, &kv)
+	  == 0)
 	{
-	  /* Flush data and clean up entry for reuse. */
-	  if (e->packetcount)
-	    flowprobe_export_entry (vm, e);
-	  e->key = k;
-	  e->flow_start = timestamp;
-	  vlib_node_increment_counter (vm, node->node_index,
-				       FLOWPROBE_ERROR_COLLISION, 1);
+	  e = pool_elt_at_index (fm->pool_per_worker[my_cpu_number],
+				 kv.value);
+	  if (PREDICT_FALSE (memcmp (&p->key, &e->key, sizeof (p->key))))
+	    {
+	      /* Flush data and clean up entry for reuse. */
+	      if (e->packetcount)
+		flowprobe_export_entry (vm, e);
+	      e->key = p->key;
+	      e->flow_start = timestamp;
+	      e->prot.tcp.flags = 0;
+	      n_collisions++;
+	    }
 	}
-      if (!e)			/* Create new entry */
+      else
 	{
-	  e = flowprobe_create (my_cpu_number, &k, &poolindex);
+	  e = flowprobe_create (my_cpu_number, &p->key, p->hash, &poolindex);
 	  e->last_exported = now;
 	  e->flow_start = timestamp;
+	  n_created++;
 	}
-    }
-  else
-    {
-      e = &fm->stateless_entry[my_cpu_number];
-      e->key = k;
-    }
 
-  if (e)
-    {
-      /* Updating entry */
-      e->packetcount++;
-      e->octetcount += octets;
-      e->last_updated = now;
-      e->flow_end = timestamp;
-      e->prot.tcp.flags |= tcp_flags;
-      if (fm->active_timer == 0
-	  || (now > e->last_exported + fm->active_timer))
-	flowprobe_export_entry (vm, e);
+      flowprobe_entry_update (e, p, timestamp, now);
     }
+
+  if (n_created)
+    vlib_node_increment_counter (vm, node_index, FLOWPROBE_ERROR_CREATED,
+				 n_created);
+  if (n_collisions)
+    vlib_node_increment_counter (vm, node_index, FLOWPROBE_ERROR_COLLISION,
+				 n_collisions);
 }
 
 static u16
@@ -527,6 +556,7 @@ flowprobe_export_send (vlib_main_t * vm, vlib_buffer_t * b0,
   udp_header_t *udp;
   flowprobe_record_t flags = fm->context[which].flags;
   u32 my_cpu_number = vm->thread_index;
+  u32 *to_next;
 
   /* Fill in header */
   flow_report_stream_t *stream;
@@ -573,8 +603,9 @@ flowprobe_export_send (vlib_main_t * vm, vlib_buffer_t * b0,
   h->export_time = clib_host_to_net_u32 (h->export_time);
   h->domain_id = clib_host_to_net_u32 (stream->domain_id);
 
-  /* FIXUP: message header sequence_number */
-  h->sequence_number = stream->sequence_number++;
+  /* FIXUP: message header sequence_number, the stream is shared by workers */
+  h->sequence_number =
+    __sync_fetch_and_add (&stream->sequence_number, 1);
   h->sequence_number = clib_host_to_net_u32 (h->sequence_number);
 
   s->set_id_length = ipfix_set_id_length (fm->template_reports[flags],
@@ -603,27 +634,53 @@ flowprobe_export_send (vlib_main_t * vm, vlib_buffer_t * b0,
   f = fm->context[which].frames_per_worker[my_cpu_number];
   if (PREDICT_FALSE (f == 0))
     {
-      u32 *to_next;
       f = vlib_get_frame_to_node (vm, ip4_lookup_node.index);
       fm->context[which].frames_per_worker[my_cpu_number] = f;
-      u32 bi0 = vlib_get_buffer_index (vm, b0);
+    }
 
-      /* Enqueue the buffer */
-      to_next = vlib_frame_vector_args (f);
-      to_next[0] = bi0;
-      f->n_vectors = 1;
+  /*
+   * Enqueue the buffer. The frame goes out once full, or from
+   * flowprobe_export_put_frames at the end of the dispatch.
+   */
+  to_next = vlib_frame_vector_args (f);
+  to_next[f->n_vectors++] = vlib_get_buffer_index (vm, b0);
+  if (f->n_vectors == VLIB_FRAME_SIZE)
+    {
+      vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
+      fm->context[which].frames_per_worker[my_cpu_number] = 0;
     }
 
-  vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
   vlib_node_increment_counter (vm, flowprobe_l2_node.index,
 			       FLOWPROBE_ERROR_EXPORTED_PACKETS, 1);
 
-  fm->context[which].frames_per_worker[my_cpu_number] = 0;
   fm->context[which].buffers_per_worker[my_cpu_number] = 0;
   fm->context[which].next_record_offset_per_worker[my_cpu_number] =
     flowprobe_get_headersize ();
 }
 
+/**
+ * @brief Hand the partially filled export frames of this thread to
+ * ip4-lookup
+ */
+static void
+flowprobe_export_put_frames (vlib_main_t * vm)
+{
+  flowprobe_main_t *fm = &flowprobe_main;
+  u32 my_cpu_number = vm->thread_index;
+  flowprobe_variant_t which;
+  vlib_frame_t *f;
+
+  for (which = 0; which < FLOW_N_VARIANTS; which++)
+    {
+      f = fm->context[which].frames_per_worker[my_cpu_number];
+      if (f)
+	{
+	  vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
+	  fm->context[which].frames_per_worker[my_cpu_number] = 0;
+	}
+    }
+}
+
 static vlib_buffer_t *
 flowprobe_get_buffer (vlib_main_t * vm, flowprobe_variant_t which)
 {
@@ -712,6 +769,8 @@ flowprobe_export_entry (vlib_main_t * vm, flowprobe_entry_t * e)
   e->last_exported = vlib_time_now (vm);
 
   b0->current_length = offset;
+  vlib_node_increment_counter (vm, flowprobe_l2_node.index,
+			       FLOWPROBE_ERROR_EXPORTED_RECORDS, 1);
 
   fm->context[which].next_record_offset_per_worker[my_cpu_number] = offset;
   /* Time to flush the buffer? */
@@ -727,10 +786,15 @@ flowprobe_node_fn (vlib_main_t * vm,
   u32 n_left_from, *from, *to_next;
   flowprobe_next_t next_index;
   flowprobe_main_t *fm = &flowprobe_main;
+  flowprobe_pkt_t *pkts = 0;
   timestamp_nsec_t timestamp;
+  u32 n_pkts = 0;
 
   unix_time_now_nsec_fraction (&timestamp.sec, &timestamp.nsec);
 
+  if (PREDICT_TRUE (!fm->disabled))
+    pkts = fm->pkts_per_worker[vm->thread_index];
+
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
   next_index = node->cached_next_index;
@@ -745,7 +809,6 @@ flowprobe_node_fn (vlib_main_t * vm,
 	{
 	  u32 next0 = FLOWPROBE_NEXT_DROP;
 	  u32 next1 = FLOWPROBE_NEXT_DROP;
-	  u16 len0, len1;
 	  u32 bi0, bi1;
 	  vlib_buffer_t *b0, *b1;
 
@@ -779,25 +842,25 @@ flowprobe_node_fn (vlib_main_t * vm,
 	  vnet_feature_next (vnet_buffer (b1)->sw_if_index[VLIB_TX],
 			     &next1, b1);
 
-	  len0 = vlib_buffer_length_in_chain (vm, b0);
 	  ethernet_header_t *eh0 = vlib_buffer_get_current (b0);
 	  u16 ethertype0 = clib_net_to_host_u16 (eh0->type);
 
-	  if (PREDICT_TRUE ((b0->flags & VNET_BUFFER_F_FLOW_REPORT) == 0))
-	    add_to_flow_record_state (vm, node, fm, b0, timestamp, len0,
-				      flowprobe_get_variant
-				      (which, fm->context[which].flags,
-				       ethertype0), 0);
+	  if (PREDICT_TRUE (pkts
+			    && (b0->flags & VNET_BUFFER_F_FLOW_REPORT) == 0))
+	    flowprobe_parse (vm, fm, b0,
+			     flowprobe_get_variant
+			     (which, fm->context[which].flags, ethertype0),
+			     pkts + n_pkts++, 0);
 
-	  len1 = vlib_buffer_length_in_chain (vm, b1);
 	  ethernet_header_t *eh1 = vlib_buffer_get_current (b1);
 	  u16 ethertype1 = clib_net_to_host_u16 (eh1->type);
 
-	  if (PREDICT_TRUE ((b1->flags & VNET_BUFFER_F_FLOW_REPORT) == 0))
-	    add_to_flow_record_state (vm, node, fm, b1, timestamp, len1,
-				      flowprobe_get_variant
-				      (which, fm->context[which].flags,
-				       ethertype1), 0);
+	  if (PREDICT_TRUE (pkts
+			    && (b1->flags & VNET_BUFFER_F_FLOW_REPORT) == 0))
+	    flowprobe_parse (vm, fm, b1,
+			     flowprobe_get_variant
+			     (which, fm->context[which].flags, ethertype1),
+			     pkts + n_pkts++, 0);
 
 	  /* verify speculative enqueues, maybe switch current next frame */
 	  vlib_validate_buffer_enqueue_x2 (vm, node, next_index,
@@ -810,7 +873,6 @@ flowprobe_node_fn (vlib_main_t * vm,
 	  u32 bi0;
 	  vlib_buffer_t *b0;
 	  u32 next0 = FLOWPROBE_NEXT_DROP;
-	  u16 len0;
 
 	  /* speculatively enqueue b0 to the current next frame */
 	  bi0 = from[0];
@@ -825,21 +887,25 @@ flowprobe_node_fn (vlib_main_t * vm,
 	  vnet_feature_next (vnet_buffer (b0)->sw_if_index[VLIB_TX],
 			     &next0, b0);
 
-	  len0 = vlib_buffer_length_in_chain (vm, b0);
 	  ethernet_header_t *eh0 = vlib_buffer_get_current (b0);
 	  u16 ethertype0 = clib_net_to_host_u16 (eh0->type);
 
-	  if (PREDICT_TRUE ((b0->flags & VNET_BUFFER_F_FLOW_REPORT) == 0))
+	  if (PREDICT_TRUE (pkts
+			    && (b0->flags & VNET_BUFFER_F_FLOW_REPORT) == 0))
 	    {
 	      flowprobe_trace_t *t = 0;
 	      if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)
 				 && (b0->flags & VLIB_BUFFER_IS_TRACED)))
-		t = vlib_add_trace (vm, node, b0, sizeof (*t));
-
-	      add_to_flow_record_state (vm, node, fm, b0, timestamp, len0,
-					flowprobe_get_variant
-					(which, fm->context[which].flags,
-					 ethertype0), t);
+		{
+		  t = vlib_add_trace (vm, node, b0, sizeof (*t));
+		  t->timestamp = timestamp.sec;
+		  t->buffer_size = vlib_buffer_length_in_chain (vm, b0);
+		}
+
+	      flowprobe_parse (vm, fm, b0,
+			       flowprobe_get_variant
+			       (which, fm->context[which].flags, ethertype0),
+			       pkts + n_pkts++, t);
 	    }
 
 	  /* verify speculative enqueue, maybe switch current next frame */
@@ -850,6 +916,12 @@ flowprobe_node_fn (vlib_main_t * vm,
 
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
+
+  /* All buckets are in flight, now account the packets to their flows */
+  if (n_pkts)
+    flowprobe_update_pkts (vm, node->node_index, pkts, n_pkts, timestamp);
+  flowprobe_export_put_frames (vm);
+
   return frame->n_vectors;
 }
 
@@ -881,6 +953,7 @@ flush_record (flowprobe_variant_t which)
   vlib_buffer_t *b = flowprobe_get_buffer (vm, which);
   if (b)
     flowprobe_export_send (vm, b, which);
+  flowprobe_export_put_frames (vm);
 }
 
 void
@@ -908,20 +981,26 @@ static void
 flowprobe_delete_by_index (u32 my_cpu_number, u32 poolindex)
 {
   flowprobe_main_t *fm = &flowprobe_main;
+  TWT (tw_timer_wheel) * tw = fm->timers_per_worker[my_cpu_number];
+  clib_bihash_kv_8_8_t kv;
   flowprobe_entry_t *e;
-  u32 h;
 
   e = pool_elt_at_index (fm->pool_per_worker[my_cpu_number], poolindex);
 
-  /* Get my index */
-  h = flowprobe_hash (&e->key);
+  if (e->passive_timer_handle != ~0)
+    tw_timer_stop_2t_1w_2048sl (tw, e->passive_timer_handle);
+  if (e->active_timer_handle != ~0)
+    tw_timer_stop_2t_1w_2048sl (tw, e->active_timer_handle);
 
-  /* Reset hash */
-  fm->hash_per_worker[my_cpu_number][h] = ~0;
+  kv.key = flowprobe_hash (&e->key);
+  clib_bihash_add_del_8_8 (&fm->flow_table_per_worker[my_cpu_number], &kv,
+			   0 /* is_add */ );
 
   pool_put_index (fm->pool_per_worker[my_cpu_number], poolindex);
 }
 
+/* Partially filled export buffers are sent at least this often */
+#define FLOWPROBE_EXPORT_FLUSH_INTERVAL 1.0
 
 /* Per worker process processing the active/passive expired entries */
 static uword
@@ -943,26 +1022,57 @@ flowprobe_walker_process (vlib_main_t * vm,
     }
   fm->disabled = false;
 
-  u32 cpu_index = os_get_thread_index ();
+  u32 cpu_index = vm->thread_index;
+  TWT (tw_timer_wheel) * tw = fm->timers_per_worker[cpu_index];
   u32 *to_be_removed = 0, *i;
+  u32 exported = 0;
 
   /*
-   * Tick the timer when required and process the vector of expired
-   * timers
+   * Tick the timer when required and process the vectors of expired
+   * timers, within a time and export budget. What is left over is
+   * picked up by the next run.
    */
   f64 start_time = vlib_time_now (vm);
+  f64 now;
   u32 count = 0;
 
-  tw_timer_expire_timers_2t_1w_2048sl (fm->timers_per_worker[cpu_index],
-				       start_time);
+  tw_timer_expire_timers_2t_1w_2048sl (tw, start_time);
 
+  /* Active timeout: export what was counted since and rearm */
+  vec_foreach (i, fm->expired_active_per_worker[cpu_index])
+  {
+    if (vlib_time_now (vm) > start_time + 100e-6
+	|| exported > FLOW_MAXIMUM_EXPORT_ENTRIES - 1)
+      break;
+    count++;
+
+    if (pool_is_free_index (fm->pool_per_worker[cpu_index], *i))
+      continue;
+    e = pool_elt_at_index (fm->pool_per_worker[cpu_index], *i);
+
+    /* Flow deleted and the entry reused since the timer fired */
+    if (e->active_timer_handle != ~0)
+      continue;
+
+    if (e->packetcount)
+      {
+	exported++;
+	flowprobe_export_entry (vm, e);
+      }
+    e->active_timer_handle = tw_timer_start_2t_1w_2048sl
+      (tw, *i, FLOWPROBE_TIMER_ID_ACTIVE, fm->active_timer);
+  }
+  if (count)
+    vec_delete (fm->expired_active_per_worker[cpu_index], count, 0);
+
+  count = 0;
   vec_foreach (i, fm->expired_passive_per_worker[cpu_index])
   {
-    u32 exported = 0;
-    f64 now = vlib_time_now (vm);
+    now = vlib_time_now (vm);
     if (now > start_time + 100e-6
 	|| exported > FLOW_MAXIMUM_EXPORT_ENTRIES - 1)
       break;
+    count++;
 
     if (pool_is_free_index (fm->pool_per_worker[cpu_index], *i))
       {
@@ -972,6 +1082,9 @@ flowprobe_walker_process (vlib_main_t * vm,
     else
       e = pool_elt_at_index (fm->pool_per_worker[cpu_index], *i);
 
+    if (e->passive_timer_handle != ~0)
+      continue;
+
     /* Check last update timestamp. If it is longer than passive time nuke
      * entry. Otherwise restart timer with what's left
      * Premature passive timer by more than 10%
@@ -980,26 +1093,46 @@ flowprobe_walker_process (vlib_main_t * vm,
       {
 	u64 delta = fm->passive_timer - (now - e->last_updated);
 	e->passive_timer_handle = tw_timer_start_2t_1w_2048sl
-	  (fm->timers_per_worker[cpu_index], *i, 0, delta);
+	  (tw, *i, FLOWPROBE_TIMER_ID_PASSIVE, clib_max (delta, 1));
       }
-    else			/* Nuke entry */
+    else			/* Nuke entry, reporting what is left */
       {
+	if (e->packetcount)
+	  {
+	    exported++;
+	    flowprobe_export_entry (vm, e);
+	  }
 	vec_add1 (to_be_removed, *i);
       }
-    /* If anything to report send it to the exporter */
-    if (e->packetcount && now > e->last_exported + fm->active_timer)
-      {
-	exported++;
-	flowprobe_export_entry (vm, e);
-      }
-    count++;
   }
   if (count)
     vec_delete (fm->expired_passive_per_worker[cpu_index], count, 0);
 
+  if (vec_len (to_be_removed))
+    vlib_node_increment_counter (vm, flowprobe_l2_node.index,
+				 FLOWPROBE_ERROR_EXPIRED,
+				 vec_len (to_be_removed));
   vec_foreach (i, to_be_removed) flowprobe_delete_by_index (cpu_index, *i);
   vec_free (to_be_removed);
 
+  /* Don't let records sit in a partially filled buffer for too long */
+  now = vlib_time_now (vm);
+  if (now > fm->next_flush_per_worker[cpu_index])
+    {
+      flowprobe_variant_t which;
+      vlib_buffer_t *b;
+
+      for (which = 0; which < FLOW_N_VARIANTS; which++)
+	{
+	  b = fm->context[which].buffers_per_worker[cpu_index];
+	  if (b)
+	    flowprobe_export_send (vm, b, which);
+	}
+      fm->next_flush_per_worker[cpu_index] =
+	now + FLOWPROBE_EXPORT_FLUSH_INTERVAL;
+    }
+  flowprobe_export_put_frames (vm);
+
   return 0;
 }
 
@@ -1045,6 +1178,175 @@ VLIB_REGISTER_NODE (flowprobe_walker_node) = {
 };
 /* *INDENT-ON* */
 
+/* Synthetic flows of the perf test are keyed on this interface index */
+#define FLOWPROBE_PERF_SW_IF_INDEX ((u32) ~0 - 1)
+
+static inline int
+flowprobe_perf_entry_is_valid (u32 my_cpu_number, u32 poolindex)
+{
+  flowprobe_main_t *fm = &flowprobe_main;
+  flowprobe_entry_t *e;
+
+  if (pool_is_free_index (fm->pool_per_worker[my_cpu_number], poolindex))
+    return 0;
+  e = pool_elt_at_index (fm->pool_per_worker[my_cpu_number], poolindex);
+  return e->key.rx_sw_if_index == FLOWPROBE_PERF_SW_IF_INDEX;
+}
+
+static clib_error_t *
+flowprobe_perf_command_fn (vlib_main_t * vm,
+			   unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  flowprobe_main_t *fm = &flowprobe_main;
+  u32 my_cpu_number = vm->thread_index;
+  u32 n_flows = 100000, n_packets = 10000000;
+  u32 n_elts, n_created, n_exported = 0;
+  flowprobe_pkt_t *flows = 0, *pkts = 0, *p;
+  timestamp_nsec_t timestamp;
+  clib_bihash_8_8_t *h;
+  u32 *indices = 0, *ip;
+  flowprobe_entry_t *e;
+  f64 t0, t_track, t_export = 0;
+  int export = 0;
+  u32 i, j, n;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "flows %u", &n_flows))
+	;
+      else if (unformat (input, "packets %u", &n_packets))
+	;
+      else if (unformat (input, "export"))
+	export = 1;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (!fm->initialized || fm->active_timer == 0)
+    return clib_error_return (0, "flowprobe needs to be enabled on an "
+			      "interface with a non-zero active timer");
+  if (n_flows == 0 || n_packets == 0)
+    return clib_error_return (0, "flows and packets must be non-zero");
+
+  /* Pre-build one key per flow, only copying it is left to the loop */
+  vec_validate (flows, n_flows - 1);
+  for (i = 0; i < n_flows; i++)
+    {
+      p = flows + i;
+      memset (p, 0, sizeof (*p));
+      p->key.rx_sw_if_index = FLOWPROBE_PERF_SW_IF_INDEX;
+      p->key.tx_sw_if_index = FLOWPROBE_PERF_SW_IF_INDEX;
+      p->key.which = FLOW_VARIANT_IP4;
+      p->key.src_address.ip4.as_u32 = clib_host_to_net_u32 (0x0a000000 + i);
+      p->key.dst_address.ip4.as_u32 = clib_host_to_net_u32 (0xc0a80001);
+      p->key.protocol = IP_PROTOCOL_UDP;
+      p->key.src_port = clib_host_to_net_u16 (1024 + (i & 0x7fff));
+      p->key.dst_port = clib_host_to_net_u16 (UDP_DST_PORT_ipfix);
+      p->octets = 64;
+    }
+  vec_validate (pkts, VLIB_FRAME_SIZE - 1);
+
+  h = &fm->flow_table_per_worker[my_cpu_number];
+  n_elts = pool_elts (fm->pool_per_worker[my_cpu_number]);
+  unix_time_now_nsec_fraction (&timestamp.sec, &timestamp.nsec);
+
+  /* Track: frame sized batches through the same path as the nodes */
+  t0 = vlib_time_now (vm);
+  for (i = 0; i < n_packets; i += n)
+    {
+      n = clib_min (VLIB_FRAME_SIZE, n_packets - i);
+      for (j = 0; j < n; j++)
+	{
+	  pkts[j] = flows[(i + j) % n_flows];
+	  flowprobe_pkt_hash (h, pkts + j);
+	}
+      flowprobe_update_pkts (vm, flowprobe_ip4_node.index, pkts, n,
+			     timestamp);
+    }
+  t_track = vlib_time_now (vm) - t0;
+  n_created = pool_elts (fm->pool_per_worker[my_cpu_number]) - n_elts;
+
+  /* *INDENT-OFF* */
+  pool_foreach (e, fm->pool_per_worker[my_cpu_number],
+  ({
+    if (e->key.rx_sw_if_index == FLOWPROBE_PERF_SW_IF_INDEX)
+      vec_add1 (indices, e - fm->pool_per_worker[my_cpu_number]);
+  }));
+  /* *INDENT-ON* */
+
+  /*
+   * Export: build and send one record per flow to the collector. The
+   * graph gets to run between batches to give the buffers back, only the
+   * time spent building records is accounted.
+   */
+  if (export)
+    {
+      for (i = 0; i < vec_len (indices); i += n)
+	{
+	  n = clib_min (FLOW_MAXIMUM_EXPORT_ENTRIES, vec_len (indices) - i);
+	  t0 = vlib_time_now (vm);
+	  for (j = 0; j < n; j++)
+	    {
+	      if (!flowprobe_perf_entry_is_valid (my_cpu_number,
+						  indices[i + j]))
+		continue;
+	      e = pool_elt_at_index (fm->pool_per_worker[my_cpu_number],
+				     indices[i + j]);
+	      flowprobe_export_entry (vm, e);
+	      n_exported++;
+	    }
+	  flush_record (FLOW_VARIANT_IP4);
+	  t_export += vlib_time_now (vm) - t0;
+	  vlib_process_suspend (vm, 1e-3);
+	}
+    }
+
+  /* Entries may have expired while the graph was running */
+  vec_foreach (ip, indices)
+  {
+    if (flowprobe_perf_entry_is_valid (my_cpu_number, *ip))
+      flowprobe_delete_by_index (my_cpu_number, *ip);
+  }
+
+  vlib_cli_output (vm, "%u packets over %u flows in %.3f sec: %.2f Mpps",
+		   n_packets, n_flows, t_track,
+		   (f64) n_packets / t_track * 1e-6);
+  vlib_cli_output (vm, "%u flows created, %.0f flows/sec", n_created,
+		   (f64) n_created / t_track);
+  if (export)
+    vlib_cli_output (vm, "%u records exported in %.3f sec, "
+		     "%.0f records/sec", n_exported, t_export,
+		     t_export > 0 ? (f64) n_exported / t_export : 0);
+
+  vec_free (flows);
+  vec_free (pkts);
+  vec_free (indices);
+  return 0;
+}
+
+/*?
+ * Measure flow tracking and export throughput of the calling thread.
+ * Synthetic IPv4 flows are fed through the flow table update used by
+ * the flowprobe nodes in frame sized batches, then optionally exported
+ * to the configured collector, and finally deleted. The flows are
+ * recorded against interface index 0xfffffffe.
+ *
+ * @cliexpar
+ * @cliexstart{test flowprobe perf flows 1000000 packets 5000000 export}
+ * 5000000 packets over 1000000 flows in .952 sec: 5.25 Mpps
+ * 1000000 flows created, 1050776 flows/sec
+ * 1000000 records exported in .077 sec, 12951334 records/sec
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (flowprobe_perf_command, static) = {
+    .path = "test flowprobe perf",
+    .short_help = "test flowprobe perf [flows <n>] [packets <n>] [export]",
+    .function = flowprobe_perf_command_fn,
+};
+/* *INDENT-ON* */
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -277,6 +277,10 @@ lb_conf_command_fn (vlib_main_t * vm,
       per_cpu_sticky_buckets = 1 << per_cpu_sticky_buckets_log2;
     } else if (unformat(line_input, "timeout %d", &flow_timeout))
       ;
+    else if (unformat(line_input, "rebuild incremental"))
+      lbm->maglev_incremental = 1;
+    else if (unformat(line_input, "rebuild full"))
+      lbm->maglev_incremental = 0;
     else {
       error = clib_error_return (0, "parse error: '%U'",
                                  format_unformat_error, line_input);
@@ -300,7 +304,7 @@ done:
 VLIB_CLI_COMMAND (lb_conf_command, static) =
 {
   .path = "lb conf",
-  .short_help = "lb conf [ip4-src-address <addr>] [ip6-src-address <addr>] [buckets <n>] [timeout <s>]",
+  .short_help = "lb conf [ip4-src-address <addr>] [ip6-src-address <addr>] [buckets <n>] [timeout <s>] [rebuild (incremental|full)]",
   .function = lb_conf_command_fn,
 };
 
@@ -480,3 +484,41 @@ VLIB_CLI_COMMAND (lb_flowtable_flush_command, static) =
   .short_help = "test lb flowtable flush",
   .function = lb_flowtable_flush_command_fn,
 };
+
+static clib_error_t *
+lb_maglev_perf_command_fn (vlib_main_t * vm,
+              unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  u32 n_ass = 100;
+  u32 table_size = 1 << 16;
+  u32 n_changes = 100;
+  u32 seed = 0xdeadbeef;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+  {
+    if (unformat(input, "ass %u", &n_ass))
+      ;
+    else if (unformat(input, "size %u", &table_size))
+      ;
+    else if (unformat(input, "changes %u", &n_changes))
+      ;
+    else if (unformat(input, "seed %u", &seed))
+      ;
+    else
+      return clib_error_return (0, "parse error: '%U'",
+                                format_unformat_error, input);
+  }
+
+  return lb_maglev_rebuild_perf (vm, n_ass, table_size, n_changes, seed);
+}
+
+/*
+ * Benchmark new flow table rebuilds on a synthetic set of ASs.
+ * This is intended for debug and performance evaluation purposes only
+ */
+VLIB_CLI_COMMAND (lb_maglev_perf_command, static) =
+{
+  .path = "test lb maglev-perf",
+  .short_help = "test lb maglev-perf [ass <n>] [size <n>] [changes <n>] [seed <n>]",
+  .function = lb_maglev_perf_command_fn,
+};
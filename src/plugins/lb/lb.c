@@ -81,6 +81,8 @@ u8 *format_lb_main (u8 * s, va_list * args)
   s = format(s, " ip6-src-address: %U \n", format_ip6_address, &lbm->ip6_src_address);
   s = format(s, " #vips: %u\n", pool_elts(lbm->vips));
   s = format(s, " #ass: %u\n", pool_elts(lbm->ass) - 1);
+  s = format(s, " new flow table rebuild: %s\n",
+             lbm->maglev_incremental ? "incremental" : "full");
 
   u32 thread_index;
   for(thread_index = 0; thread_index < tm->n_vlib_mains; thread_index++ ) {
@@ -89,6 +91,9 @@ u8 *format_lb_main (u8 * s, va_list * args)
       s = format(s, "core %d\n", thread_index);
       s = format(s, "  timeout: %ds\n", h->timeout);
       s = format(s, "  usage: %d / %d\n", lb_hash_elts(h, lb_hash_time_now(vlib_get_main())),  lb_hash_size(h));
+      s = format(s, "  aged: %lu entries in %lu sweeps\n",
+                 lbm->per_cpu[thread_index].sticky_aged_entries,
+                 lbm->per_cpu[thread_index].sticky_aging_sweeps);
     }
   }
 
@@ -216,6 +221,12 @@ u8 *format_lb_vip_detailed (u8 * s, va_list * args)
              format_white_space, indent,
              pool_elts(vip->as_indexes));
 
+  s = format(s, "%U  last rebuild: %u buckets changed in %.2fus\n",
+             format_white_space, indent,
+             vip->last_rebuild_changed,
+             vip->last_rebuild_clocks *
+             vlib_get_main()->clib_time.seconds_per_clock * 1e6);
+
   //Let's count the buckets for each AS
   u32 *count = 0;
   vec_validate(count, pool_len(lbm->ass)); //Possibly big alloc for not much...
@@ -357,6 +368,98 @@ void lb_garbage_collection()
   lb_put_writer_lock();
 }
 
+/**
+ * Populate new_flow_table from the sorted permutations in sort_arr.
+ *
+ * Each AS gets a fair share of the table: size / n buckets, plus one
+ * for the first size % n ASs (which is what the plain MagLev fill ends up
+ * doing). When old_table is given, buckets owned by an AS still in sort_arr
+ * are kept, and ASs under their share walk their permutation taking
+ * buckets that are either orphaned or owned by an AS over its share.
+ * Only the buckets of removed ASs and the buckets needed to rebalance
+ * change owner. With no old_table, this is the plain MagLev fill.
+ */
+static void lb_maglev_populate(lb_pseudorand_t *sort_arr,
+                               lb_new_flow_entry_t *old_table,
+                               u32 mask, lb_new_flow_entry_t *new_flow_table)
+{
+  lb_main_t *lbm = &lb_main;
+  u32 n = vec_len(sort_arr), size = mask + 1;
+  u32 base = size / n, extra = size % n;
+  u32 *position = lbm->maglev_position;
+  u32 *owned = 0;
+  u32 i, p, as_index, last, missing;
+  lb_pseudorand_t *pr;
+
+#define lb_maglev_share(p) (base + ((p) < extra))
+
+  vec_validate(owned, n - 1);
+  vec_foreach(pr, sort_arr) {
+    vec_validate_init_empty(position, pr->as_index, ~0);
+    position[pr->as_index] = pr - sort_arr;
+  }
+
+  //Keep the buckets of the ASs which are still there
+  for (i = 0; i < size; i++) {
+    as_index = old_table ? old_table[i].as_index : ~0;
+    p = (as_index < vec_len(position)) ? position[as_index] : ~0;
+    new_flow_table[i].as_index = (p == ~0) ? ~0 : as_index;
+    if (p != ~0)
+      owned[p]++;
+  }
+
+  missing = 0;
+  for (p = 0; p < n; p++)
+    if (owned[p] < lb_maglev_share(p))
+      missing += lb_maglev_share(p) - owned[p];
+
+  //Round-robin over the ASs under their share
+  while (missing) {
+    vec_foreach(pr, sort_arr) {
+      p = pr - sort_arr;
+      if (owned[p] >= lb_maglev_share(p))
+        continue;
+
+      while (1) {
+        last = pr->last;
+        pr->last = (pr->last + pr->skip) & mask;
+        as_index = new_flow_table[last].as_index;
+        if (as_index == ~0)
+          break;
+        if (owned[position[as_index]] > lb_maglev_share(position[as_index])) {
+          owned[position[as_index]]--;
+          break;
+        }
+      }
+
+      new_flow_table[last].as_index = pr->as_index;
+      owned[p]++;
+      if (--missing == 0)
+        break;
+    }
+  }
+
+#undef lb_maglev_share
+
+  vec_foreach(pr, sort_arr)
+    position[pr->as_index] = ~0;
+  lbm->maglev_position = position;
+  vec_free(owned);
+}
+
+static void lb_maglev_init_permutation(lb_pseudorand_t *pr, u64 seed, u32 mask)
+{
+  /* We have 2^n buckets.
+   * skip must be prime with 2^n.
+   * So skip must be odd.
+   * MagLev actually state that M should be prime,
+   * but this has a big computation cost (% operation).
+   * Using 2^n is more better (& operation).
+   */
+  pr->skip = ((seed & 0xffffffff) | 1) & mask;
+  pr->last = (seed >> 32) & mask;
+}
+
 static void lb_vip_update_new_flow_table(lb_vip_t *vip)
 {
   lb_main_t *lbm = &lb_main;
@@ -366,23 +469,28 @@ static void lb_vip_update_new_flow_table(lb_vip_t *vip)
   lb_as_t *as;
   lb_pseudorand_t *pr, *sort_arr = 0;
   u32 count;
+  u64 start = clib_cpu_time_now();
 
   ASSERT (lbm->writer_lock[0]); //We must have the lock
 
-  //Check if some AS is configured or not
+  //Collect the ASs which are still in use
+  vec_alloc(sort_arr, pool_elts(vip->as_indexes));
+
   i = 0;
   pool_foreach(as_index, vip->as_indexes, {
       as = &lbm->ass[*as_index];
-      if (as->flags & LB_AS_FLAGS_USED) { //Not used anymore
-        i = 1;
-        goto out; //Not sure 'break' works in this macro-loop
-      }
+      if (!(as->flags & LB_AS_FLAGS_USED)) //Not used anymore
+        continue;
+
+      sort_arr[i].as_index = as - lbm->ass;
+      i++;
   });
+  _vec_len(sort_arr) = i;
+
+  vec_validate(new_flow_table, vip->new_flow_table_mask);
 
-out:
   if (i == 0) {
     //Only the default. i.e. no AS
-    vec_validate(new_flow_table, vip->new_flow_table_mask);
     for (i=0; i<vec_len(new_flow_table); i++)
       new_flow_table[i].as_index = 0;
 
@@ -390,20 +498,6 @@ out:
   }
 
   //First, let's sort the ASs
-  sort_arr = 0;
-  vec_alloc(sort_arr, pool_elts(vip->as_indexes));
-
-  i = 0;
-  pool_foreach(as_index, vip->as_indexes, {
-      as = &lbm->ass[*as_index];
-      if (!(as->flags & LB_AS_FLAGS_USED)) //Not used anymore
-        continue;
-
-      sort_arr[i].as_index = as - lbm->ass;
-      i++;
-  });
-  _vec_len(sort_arr) = i;
-
   vec_sort_with_function(sort_arr, lb_pseudorand_compare);
 
   //Now let's pseudo-randomly generate permutations
@@ -412,42 +506,20 @@ out:
 
     u64 seed = clib_xxhash(as->address.as_u64[0] ^
                            as->address.as_u64[1]);
-    /* We have 2^n buckets.
-     * skip must be prime with 2^n.
-     * So skip must be odd.
-     * MagLev actually state that M should be prime,
-     * but this has a big computation cost (% operation).
-     * Using 2^n is more better (& operation).
-     */
-    pr->skip = ((seed & 0xffffffff) | 1) & vip->new_flow_table_mask;
-    pr->last = (seed >> 32) & vip->new_flow_table_mask;
+    lb_maglev_init_permutation(pr, seed, vip->new_flow_table_mask);
   }
 
   //Let's create a new flow table
-  vec_validate(new_flow_table, vip->new_flow_table_mask);
-  for (i=0; i<vec_len(new_flow_table); i++)
-    new_flow_table[i].as_index = ~0;
-
-  u32 done = 0;
-  while (1) {
-    vec_foreach(pr, sort_arr) {
-      while (1) {
-        u32 last = pr->last;
-        pr->last = (pr->last + pr->skip) & vip->new_flow_table_mask;
-        if (new_flow_table[last].as_index == ~0) {
-          new_flow_table[last].as_index = pr->as_index;
-          break;
-        }
-      }
-      done++;
-      if (done == vec_len(new_flow_table))
-        goto finished;
-    }
-  }
+  old_table = vip->new_flow_table;
+  if (!lbm->maglev_incremental ||
+      vec_len(old_table) != vec_len(new_flow_table))
+    old_table = 0;
 
-  vec_free(sort_arr);
+  lb_maglev_populate(sort_arr, old_table, vip->new_flow_table_mask,
+                     new_flow_table);
 
 finished:
+  vec_free(sort_arr);
 
 //Count number of changed entries
   count = 0;
@@ -459,6 +531,113 @@ finished:
   old_table = vip->new_flow_table;
   vip->new_flow_table = new_flow_table;
   vec_free(old_table);
+
+  vip->last_rebuild_changed = count;
+  vip->last_rebuild_clocks = clib_cpu_time_now() - start;
+}
+
+static u32 lb_maglev_count_changes(lb_new_flow_entry_t *a,
+                                   lb_new_flow_entry_t *b)
+{
+  u32 i, count = 0;
+  for (i = 0; i < vec_len(a); i++)
+    count += (a[i].as_index != b[i].as_index);
+  return count;
+}
+
+static void lb_maglev_perf_rebuild(lb_pseudorand_t *ass, u32 seed, u32 mask,
+                                   lb_new_flow_entry_t **table,
+                                   lb_new_flow_entry_t **scratch,
+                                   u8 incremental, u64 *clocks, u64 *changed)
+{
+  lb_pseudorand_t *pr, *perms = vec_dup(ass);
+  lb_new_flow_entry_t *tmp;
+  u64 t0;
+
+  vec_foreach(pr, perms)
+    lb_maglev_init_permutation(pr, clib_xxhash(pr->as_index ^ seed), mask);
+
+  t0 = clib_cpu_time_now();
+  lb_maglev_populate(perms, incremental ? *table : 0, mask, *scratch);
+  *clocks += clib_cpu_time_now() - t0;
+
+  *changed += lb_maglev_count_changes(*table, *scratch);
+  tmp = *table;
+  *table = *scratch;
+  *scratch = tmp;
+  vec_free(perms);
+}
+
+clib_error_t *
+lb_maglev_rebuild_perf (vlib_main_t * vm, u32 n_ass, u32 table_size,
+                        u32 n_changes, u32 seed)
+{
+  lb_pseudorand_t *ass = 0, *pr;
+  lb_new_flow_entry_t *full = 0, *incr = 0, *scratch = 0;
+  u32 mask = table_size - 1;
+  u32 next_as_index = 1;
+  u32 rnd = seed;
+  u32 i, k;
+  u64 full_clocks = 0, incr_clocks = 0;
+  u64 full_changed = 0, incr_changed = 0;
+  f64 ideal = 0;
+
+  if (!is_pow2(table_size))
+    return clib_error_return (0, "table size must be a power of 2");
+  if (n_ass < 2 || n_ass > table_size)
+    return clib_error_return (0, "need between 2 and %u ASs", table_size);
+
+  //Synthetic ASs, kept sorted by as_index
+  for (i = 0; i < n_ass; i++) {
+    vec_add2(ass, pr, 1);
+    pr->as_index = next_as_index++;
+  }
+
+  vec_validate(full, mask);
+  vec_validate(incr, mask);
+  vec_validate(scratch, mask);
+
+  lb_maglev_perf_rebuild(ass, seed, mask, &full, &scratch, 0,
+                         &full_clocks, &full_changed);
+  clib_memcpy(incr, full, vec_len(full) * sizeof(full[0]));
+  full_clocks = full_changed = 0;
+
+  for (k = 0; k < n_changes; k++) {
+    //Alternate between removing a random AS and adding a new one
+    if (k & 1) {
+      vec_add2(ass, pr, 1);
+      pr->as_index = next_as_index++;
+      ideal += 1.0 / vec_len(ass);
+    } else {
+      ideal += 1.0 / vec_len(ass);
+      vec_delete(ass, 1, random_u32(&rnd) % vec_len(ass));
+    }
+
+    lb_maglev_perf_rebuild(ass, seed, mask, &full, &scratch, 0,
+                           &full_clocks, &full_changed);
+    lb_maglev_perf_rebuild(ass, seed, mask, &incr, &scratch, 1,
+                           &incr_clocks, &incr_changed);
+  }
+
+  if (n_changes) {
+    f64 us_per_clock = vm->clib_time.seconds_per_clock * 1e6;
+    vlib_cli_output (vm, "%u changes, %u ASs, %u buckets", n_changes,
+                     n_ass, table_size);
+    vlib_cli_output (vm, "  full rebuild:        %.2f us, %.3f%% buckets changed",
+                     us_per_clock * full_clocks / n_changes,
+                     100.0 * full_changed / n_changes / table_size);
+    vlib_cli_output (vm, "  incremental rebuild: %.2f us, %.3f%% buckets changed",
+                     us_per_clock * incr_clocks / n_changes,
+                     100.0 * incr_changed / n_changes / table_size);
+    vlib_cli_output (vm, "  ideal:               %.3f%% buckets changed",
+                     100.0 * ideal / n_changes);
+  }
+
+  vec_free(ass);
+  vec_free(full);
+  vec_free(incr);
+  vec_free(scratch);
+  return 0;
 }
 
 int lb_conf(ip4_address_t *ip4_address, ip6_address_t *ip6_address,
@@ -1091,11 +1270,13 @@ lb_init (vlib_main_t * vm)
 
   lbm->vips = 0;
   lbm->per_cpu = 0;
-  vec_validate(lbm->per_cpu, tm->n_vlib_mains - 1);
+  vec_validate_aligned(lbm->per_cpu, tm->n_vlib_mains - 1,
+                       CLIB_CACHE_LINE_BYTES);
   lbm->writer_lock = clib_mem_alloc_aligned (CLIB_CACHE_LINE_BYTES,  CLIB_CACHE_LINE_BYTES);
   lbm->writer_lock[0] = 0;
   lbm->per_cpu_sticky_buckets = LB_DEFAULT_PER_CPU_STICKY_BUCKETS;
   lbm->flow_timeout = LB_DEFAULT_FLOW_TIMEOUT;
+  lbm->maglev_incremental = 1;
   lbm->ip4_src_address.as_u32 = 0xffffffff;
   lbm->ip6_src_address.as_u64[0] = 0xffffffffffffffffL;
   lbm->ip6_src_address.as_u64[1] = 0xffffffffffffffffL;
@@ -47,6 +47,15 @@
 #define LB_MAPPING_BUCKETS  1024
 #define LB_MAPPING_MEMORY_SIZE  64<<20
 
+/**
+ * The sticky aging process wakes the workers every so many seconds.
+ * Each wake-up, a worker visits enough buckets to sweep its whole
+ * sticky table once per flow timeout, in chunks of
+ * LB_STICKY_AGING_BUCKETS_PER_RUN buckets per node dispatch.
+ */
+#define LB_STICKY_AGING_INTERVAL 1.0
+#define LB_STICKY_AGING_BUCKETS_PER_RUN 256
+
 typedef enum {
   LB_NEXT_DROP,
   LB_N_NEXT,
@@ -299,6 +308,17 @@ typedef struct {
    * This also includes ASs that have been removed (but are still referenced).
    */
   u32 *as_indexes;
+
+  /**
+   * Number of new_flow_table entries which changed owner
+   * during the last rebuild.
+   */
+  u32 last_rebuild_changed;
+
+  /**
+   * CPU clocks spent in the last new_flow_table rebuild.
+   */
+  u64 last_rebuild_clocks;
 } lb_vip_t;
 
 #define lb_vip_is_ip4(vip) ((vip)->type == LB_VIP_TYPE_IP4_GRE6 \
@@ -398,11 +418,34 @@ typedef struct {
 } lb_snat_mapping_t;
 
 typedef struct {
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
   /**
    * Each CPU has its own sticky flow hash table.
    * One single table is used for all VIPs.
    */
   lb_hash_t *sticky_ht;
+
+  /**
+   * Next sticky bucket to be visited by the aging node.
+   */
+  u32 sticky_aging_cursor;
+
+  /**
+   * Buckets left to visit before the next aging wake-up.
+   */
+  u32 sticky_aging_budget;
+
+  /**
+   * Expired sticky entries whose AS reference was released
+   * by the aging node.
+   */
+  u64 sticky_aged_entries;
+
+  /**
+   * Number of complete sweeps over the sticky table.
+   */
+  u64 sticky_aging_sweeps;
 } lb_per_cpu_t;
 
 typedef struct {
@@ -492,6 +535,19 @@ typedef struct {
 
   volatile u32 *writer_lock;
 
+  /**
+   * When set, new_flow_table rebuilds only reassign the buckets of
+   * removed ASs and the buckets exceeding each AS fair share.
+   * When not set, the table is recomputed from scratch.
+   */
+  u8 maglev_incremental;
+
+  /**
+   * Scratch vector mapping AS index to its rank in the sorted
+   * AS list during a rebuild. Entries are ~0 outside of rebuilds.
+   */
+  u32 *maglev_position;
+
   /* convenience */
   vlib_main_t *vlib_main;
   vnet_main_t *vnet_main;
@@ -538,6 +594,15 @@ u32 lb_hash_time_now(vlib_main_t * vm);
 
 void lb_garbage_collection();
 
+/**
+ * Benchmark new_flow_table rebuilds on a synthetic AS set.
+ * Compares full and incremental rebuild time and the ratio of
+ * buckets changing owner on each AS addition or removal.
+ */
+clib_error_t *lb_maglev_rebuild_perf (vlib_main_t * vm, u32 n_ass,
+                                      u32 table_size, u32 n_changes,
+                                      u32 seed);
+
 int lb_nat4_interface_add_del (u32 sw_if_index, int is_del);
 int lb_nat6_interface_add_del (u32 sw_if_index, int is_del);
 
@@ -1125,3 +1125,115 @@ VLIB_REGISTER_NODE (lb_nat6_in2out_node) =
       },
   };
 
+
+/**
+ * Release the AS reference held by expired sticky entries.
+ *
+ * Entries are otherwise only recycled when a new flow hashes to the same
+ * bucket, which keeps removed ASs referenced (and not garbage collected)
+ * for as long as their buckets stay quiet.
+ * Expired entries are pointed to the default AS, just like the data-plane
+ * does when it reuses an entry.
+ */
+static uword
+lb_sticky_aging_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
+                         vlib_frame_t * frame)
+{
+  lb_main_t *lbm = &lb_main;
+  u32 thread_index = vm->thread_index;
+  lb_per_cpu_t *pc = &lbm->per_cpu[thread_index];
+  lb_hash_t *sticky_ht = pc->sticky_ht;
+  u32 now = lb_hash_time_now (vm);
+  u32 n_buckets, n_aged = 0;
+  lb_hash_bucket_t *b;
+  u32 i;
+
+  //The data-plane dereferences and reallocates tables which changed size
+  if (!sticky_ht
+      || lb_hash_nbuckets (sticky_ht) != lbm->per_cpu_sticky_buckets)
+    {
+      pc->sticky_aging_budget = 0;
+      return 0;
+    }
+
+  //Spread a sweep of the whole table over one flow timeout
+  if (pc->sticky_aging_budget == 0)
+    {
+      u64 budget = lb_hash_nbuckets (sticky_ht) * LB_STICKY_AGING_INTERVAL
+          / clib_max (lbm->flow_timeout, 1);
+      budget = clib_max (budget, LB_STICKY_AGING_BUCKETS_PER_RUN);
+      pc->sticky_aging_budget = clib_min (budget,
+                                          lb_hash_nbuckets (sticky_ht));
+    }
+
+  n_buckets = clib_min (pc->sticky_aging_budget,
+                        LB_STICKY_AGING_BUCKETS_PER_RUN);
+  pc->sticky_aging_budget -= n_buckets;
+  pc->sticky_aging_cursor &= sticky_ht->buckets_mask;
+
+  while (n_buckets--)
+    {
+      b = &sticky_ht->buckets[pc->sticky_aging_cursor];
+      //The table has one spare bucket for prefetch
+      CLIB_PREFETCH (b + 1, sizeof (*b), STORE);
+
+      for (i = 0; i < LBHASH_ENTRY_PER_BUCKET; i++)
+        {
+          if (b->value[i] == 0 || !clib_u32_loop_gt (now, b->timeout[i]))
+            continue;
+
+          vlib_refcount_add (&lbm->as_refcount, thread_index, b->value[i], -1);
+          vlib_refcount_add (&lbm->as_refcount, thread_index, 0, 1);
+          b->value[i] = 0;
+          n_aged++;
+        }
+
+      pc->sticky_aging_cursor =
+          (pc->sticky_aging_cursor + 1) & sticky_ht->buckets_mask;
+      if (pc->sticky_aging_cursor == 0)
+        pc->sticky_aging_sweeps++;
+    }
+
+  pc->sticky_aged_entries += n_aged;
+
+  if (pc->sticky_aging_budget)
+    vlib_node_set_interrupt_pending (vm, node->node_index);
+
+  return 0;
+}
+
+VLIB_REGISTER_NODE (lb_sticky_aging_node, static) =
+  {
+    .function = lb_sticky_aging_node_fn,
+    .name = "lb-sticky-aging",
+    .type = VLIB_NODE_TYPE_INPUT,
+    .state = VLIB_NODE_STATE_INTERRUPT,
+  };
+
+static uword
+lb_sticky_aging_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+                         vlib_frame_t * f)
+{
+  lb_main_t *lbm = &lb_main;
+  u32 thread_index;
+
+  while (1)
+    {
+      vlib_process_suspend (vm, LB_STICKY_AGING_INTERVAL);
+
+      for (thread_index = 0; thread_index < vec_len (lbm->per_cpu);
+           thread_index++)
+        if (lbm->per_cpu[thread_index].sticky_ht)
+          vlib_node_set_interrupt_pending (vlib_mains[thread_index],
+                                           lb_sticky_aging_node.index);
+    }
+
+  return 0;
+}
+
+VLIB_REGISTER_NODE (lb_sticky_aging_process_node, static) =
+  {
+    .function = lb_sticky_aging_process,
+    .type = VLIB_NODE_TYPE_PROCESS,
+    .name = "lb-sticky-aging-process",
+  };
@@ -173,7 +173,7 @@ mrvl_pp2_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   u32 n_rx_bytes = 0;
   u32 *to_next = 0;
   struct pp2_ppio_desc *d;
-  u16 n_desc = VLIB_FRAME_SIZE;
+  u16 n_desc = vm->frame_size;
   u32 n_bufs;
   u32 *buffers;
   int i;
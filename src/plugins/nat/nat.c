@@ -29,6 +29,7 @@
 #include <nat/nat_reass.h>
 #include <vnet/fib/fib_table.h>
 #include <vnet/fib/ip4_fib.h>
+#include <vnet/snapshot/snapshot.h>
 
 #include <vpp/app/version.h>
 
@@ -152,6 +153,8 @@ nat_free_session_data (snat_main_t * sm, snat_session_t * s, u32 thread_index)
   snat_main_per_thread_data_t *tsm =
     vec_elt_at_index (sm->per_thread_data, thread_index);
 
+  nat44_session_timer_stop (tsm, s);
+
   if (is_fwd_bypass_session (s))
     {
       ed_key.l_addr = s->in2out.addr;
@@ -296,6 +299,26 @@ nat_user_get_or_create (snat_main_t *sm, ip4_address_t *addr, u32 fib_index,
   return u;
 }
 
+static void
+nat44_session_timer_start (snat_main_t * sm, snat_session_t * s,
+                           u32 thread_index)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  u32 timeout;
+
+  /*
+   * Protocol and state are not known yet, start with the shortest timeout,
+   * the expiry reschedules the timer for the rest of the session lifetime.
+   */
+  timeout = clib_min (sm->icmp_timeout, sm->udp_timeout);
+  timeout = clib_min (timeout, sm->tcp_transitory_timeout);
+
+  s->timer_handle =
+    tw_timer_start_1t_3w_1024sl_ov (&tsm->session_timer_wheel,
+                                    s - tsm->sessions, 0,
+                                    clib_max (timeout, 1));
+}
+
 snat_session_t *
 nat_session_alloc_or_recycle (snat_main_t *sm, snat_user_t *u, u32 thread_index)
 {
@@ -348,6 +371,7 @@ nat_session_alloc_or_recycle (snat_main_t *sm, snat_user_t *u, u32 thread_index)
       pool_get (tsm->sessions, s);
       memset (s, 0, sizeof (*s));
       s->outside_address_index = ~0;
+      s->timer_handle = ~0;
 
       /* Create list elts */
       pool_get (tsm->list_pool, per_user_translation_list_elt);
@@ -363,9 +387,161 @@ nat_session_alloc_or_recycle (snat_main_t *sm, snat_user_t *u, u32 thread_index)
                           per_user_translation_list_elt - tsm->list_pool);
     }
 
+  nat44_session_timer_start (sm, s, thread_index);
+
   return s;
 }
 
+static void
+nat44_delete_user_with_no_session (snat_main_t * sm, snat_user_key_t * u_key,
+                                   u32 thread_index)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  clib_bihash_kv_8_8_t kv, value;
+  dlist_elt_t *head;
+  snat_user_t *u;
+
+  kv.key = u_key->as_u64;
+  if (clib_bihash_search_8_8 (&tsm->user_hash, &kv, &value))
+    return;
+
+  u = pool_elt_at_index (tsm->users, value.value);
+  head = pool_elt_at_index (tsm->list_pool,
+                            u->sessions_per_user_list_head_index);
+  if (head->next != u->sessions_per_user_list_head_index)
+    return;
+
+  pool_put_index (tsm->list_pool, u->sessions_per_user_list_head_index);
+  pool_put (tsm->users, u);
+  clib_bihash_add_del_8_8 (&tsm->user_hash, &kv, 0);
+}
+
+/**
+ * @brief Expire idle NAT44 sessions of the calling thread.
+ *
+ * Session timers are started with the shortest timeout when the session is
+ * created and are not touched by the data plane. When a timer expires the
+ * session timeout is checked against the last heard time and the timer is
+ * restarted for the rest of the lifetime, or the session is deleted.
+ */
+static void
+nat44_session_expire (snat_main_t * sm, u32 thread_index, f64 now)
+{
+  snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
+  snat_session_t *s;
+  snat_user_key_t u_key;
+  u32 *si;
+  f64 expire;
+
+  vec_reset_length (tsm->expired_sessions);
+  tsm->expired_sessions =
+    tw_timer_expire_timers_vec_1t_3w_1024sl_ov (&tsm->session_timer_wheel,
+                                                now, tsm->expired_sessions);
+
+  vec_foreach (si, tsm->expired_sessions)
+    {
+      s = pool_elt_at_index (tsm->sessions, si[0]);
+      s->timer_handle = ~0;
+
+      expire = s->last_heard + (f64) nat44_session_get_timeout (sm, s);
+      if (expire > now)
+        {
+          s->timer_handle =
+            tw_timer_start_1t_3w_1024sl_ov (&tsm->session_timer_wheel,
+                                            si[0], 0,
+                                            (u64) (expire - now) + 1);
+          continue;
+        }
+
+      u_key.addr = s->in2out.addr;
+      u_key.fib_index = s->in2out.fib_index;
+      nat_free_session_data (sm, s, thread_index);
+      nat44_delete_session (sm, s, thread_index);
+      nat44_delete_user_with_no_session (sm, &u_key, thread_index);
+      tsm->sessions_expired++;
+    }
+
+  if (now >= tsm->sessions_expired_time + 1.0)
+    {
+      tsm->sessions_expired_per_sec =
+        (f64) (tsm->sessions_expired - tsm->sessions_expired_last) /
+        (now - tsm->sessions_expired_time);
+      tsm->sessions_expired_last = tsm->sessions_expired;
+      tsm->sessions_expired_time = now;
+    }
+}
+
+static_always_inline int
+nat44_session_timers_enabled (snat_main_t * sm)
+{
+  return !sm->deterministic &&
+    (!sm->static_mapping_only || sm->static_mapping_connection_tracking);
+}
+
+/**
+ * @brief Per worker input node expiring NAT44 sessions.
+ */
+static uword
+nat44_expire_worker_walk_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
+                             vlib_frame_t * f)
+{
+  snat_main_t *sm = &snat_main;
+
+  nat44_session_expire (sm, vm->thread_index, vlib_time_now (vm));
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (nat44_expire_worker_walk_node, static) = {
+    .function = nat44_expire_worker_walk_fn,
+    .type = VLIB_NODE_TYPE_INPUT,
+    .state = VLIB_NODE_STATE_INTERRUPT,
+    .name = "nat44-expire-worker-walk",
+};
+/* *INDENT-ON* */
+
+/**
+ * @brief Centralized process to drive per worker session expiry every timer
+ * wheel tick.
+ */
+static uword
+nat44_expire_walk_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
+                      vlib_frame_t * f)
+{
+  snat_main_t *sm = &snat_main;
+  int i;
+
+  if (!nat44_session_timers_enabled (sm))
+    return 0;
+
+  while (1)
+    {
+      vlib_process_suspend (vm, NAT44_SES_TIMER_TICK);
+
+      if (vec_len (vlib_mains) == 0)
+        vlib_node_set_interrupt_pending (vm,
+                                         nat44_expire_worker_walk_node.index);
+
+      for (i = 0; i < vec_len (vlib_mains); i++)
+        {
+          if (vlib_mains[i])
+            vlib_node_set_interrupt_pending (vlib_mains[i],
+                                             nat44_expire_worker_walk_node.index);
+        }
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (nat44_expire_walk_node, static) = {
+    .function = nat44_expire_walk_fn,
+    .type = VLIB_NODE_TYPE_PROCESS,
+    .name = "nat44-expire-walk",
+};
+/* *INDENT-ON* */
+
 static inline uword
 nat44_classify_node_fn_inline (vlib_main_t * vm,
                                vlib_node_runtime_t * node,
@@ -1854,6 +2030,218 @@ int snat_set_workers (uword * bitmap)
   return 0;
 }
 
+static int
+nat_snapshot_is_interface_address (snat_main_t * sm, u32 * sw_if_indices,
+                                   ip4_address_t * addr)
+{
+  ip4_address_t *first;
+  u32 *sw_if_index;
+
+  vec_foreach (sw_if_index, sw_if_indices)
+    {
+      first = ip4_interface_first_address (sm->ip4_main, *sw_if_index, 0);
+      if (first && first->as_u32 == addr->as_u32)
+        return 1;
+    }
+  return 0;
+}
+
+static void
+nat_snapshot_save (serialize_main_t * m, va_list * va)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  snat_main_t *sm = &snat_main;
+  snat_address_t *addresses, *ap, *saved = 0;
+  snat_static_mapping_t *mp, **mps = 0;
+  snat_interface_t *interfaces, *i;
+  u32 *auto_add, *sw_if_index, k;
+  u8 twice_nat, is_output;
+
+  /* Deterministic mappings are derived from the configuration */
+  serialize_integer (m, !sm->deterministic, sizeof (u8));
+  if (sm->deterministic)
+    return;
+
+  for (twice_nat = 0; twice_nat < 2; twice_nat++)
+    {
+      addresses = twice_nat ? sm->twice_nat_addresses : sm->addresses;
+      auto_add = twice_nat ? sm->auto_add_sw_if_indices_twice_nat :
+        sm->auto_add_sw_if_indices;
+
+      /* Addresses of interfaces added with "nat44 add interface address"
+         follow the interface, only the interface is saved */
+      vec_reset_length (saved);
+      vec_foreach (ap, addresses)
+        if (!nat_snapshot_is_interface_address (sm, auto_add, &ap->addr))
+          vec_add1 (saved, *ap);
+
+      serialize_integer (m, vec_len (saved), sizeof (u32));
+      vec_foreach (ap, saved)
+        {
+          vnet_snapshot_serialize_ip4_address (m, &ap->addr);
+          vnet_snapshot_serialize_fib_index (m, FIB_PROTOCOL_IP4,
+                                             ap->fib_index);
+          snm->n_objects++;
+        }
+
+      serialize_integer (m, vec_len (auto_add), sizeof (u32));
+      vec_foreach (sw_if_index, auto_add)
+        {
+          vnet_snapshot_serialize_sw_if_index (m, *sw_if_index);
+          snm->n_objects++;
+        }
+    }
+  vec_free (saved);
+
+  /* Load balancing mappings are not saved */
+  pool_foreach (mp, sm->static_mappings,
+  ({
+    if (vec_len (mp->locals))
+      snm->n_skipped++;
+    else
+      vec_add1 (mps, mp);
+  }));
+
+  serialize_integer (m, vec_len (mps), sizeof (u32));
+  for (k = 0; k < vec_len (mps); k++)
+    {
+      mp = mps[k];
+      vnet_snapshot_serialize_ip4_address (m, &mp->local_addr);
+      vnet_snapshot_serialize_ip4_address (m, &mp->external_addr);
+      serialize_integer (m, mp->local_port, sizeof (u16));
+      serialize_integer (m, mp->external_port, sizeof (u16));
+      serialize_integer (m, mp->vrf_id, sizeof (u32));
+      serialize_integer (m, mp->addr_only, sizeof (u8));
+      serialize_integer (m, mp->proto, sizeof (u8));
+      serialize_integer (m, mp->twice_nat, sizeof (u8));
+      serialize_integer (m, mp->out2in_only, sizeof (u8));
+      serialize_cstring (m, (char *) mp->tag);
+      snm->n_objects++;
+    }
+  vec_free (mps);
+
+  for (is_output = 0; is_output < 2; is_output++)
+    {
+      interfaces = is_output ? sm->output_feature_interfaces :
+        sm->interfaces;
+      serialize_integer (m, pool_elts (interfaces), sizeof (u32));
+      pool_foreach (i, interfaces,
+      ({
+        vnet_snapshot_serialize_sw_if_index (m, i->sw_if_index);
+        serialize_integer (m, i->flags, sizeof (u8));
+        snm->n_objects++;
+      }));
+    }
+}
+
+static void
+nat_snapshot_restore (serialize_main_t * m, va_list * va)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  snat_main_t *sm = &snat_main;
+  ip4_address_t l_addr, e_addr;
+  u16 l_port, e_port;
+  u32 j, n, vrf_id, sw_if_index, fib_index;
+  u8 twice_nat, is_output, addr_only, proto, sm_twice_nat, out2in_only;
+  u8 flags, *tag;
+  int rv;
+
+  unserialize_integer (m, &flags, sizeof (u8));
+  if (!flags || sm->deterministic)
+    return;
+
+  for (twice_nat = 0; twice_nat < 2; twice_nat++)
+    {
+      unserialize_integer (m, &n, sizeof (u32));
+      for (j = 0; j < n; j++)
+        {
+          vnet_snapshot_unserialize_ip4_address (m, &l_addr);
+          fib_index = vnet_snapshot_unserialize_fib_index (m,
+                                                           FIB_PROTOCOL_IP4);
+          vrf_id = fib_index == ~0 ? ~0 :
+            fib_table_get_table_id (fib_index, FIB_PROTOCOL_IP4);
+          snat_add_address (sm, &l_addr, vrf_id, twice_nat);
+          snm->n_objects++;
+        }
+
+      unserialize_integer (m, &n, sizeof (u32));
+      for (j = 0; j < n; j++)
+        {
+          if (vnet_snapshot_unserialize_sw_if_index (m, &sw_if_index)
+              || snat_add_interface_address (sm, sw_if_index, 0, twice_nat))
+            snm->n_skipped++;
+          else
+            snm->n_objects++;
+        }
+    }
+
+  unserialize_integer (m, &n, sizeof (u32));
+  for (j = 0; j < n; j++)
+    {
+      vnet_snapshot_unserialize_ip4_address (m, &l_addr);
+      vnet_snapshot_unserialize_ip4_address (m, &e_addr);
+      unserialize_integer (m, &l_port, sizeof (u16));
+      unserialize_integer (m, &e_port, sizeof (u16));
+      unserialize_integer (m, &vrf_id, sizeof (u32));
+      unserialize_integer (m, &addr_only, sizeof (u8));
+      unserialize_integer (m, &proto, sizeof (u8));
+      unserialize_integer (m, &sm_twice_nat, sizeof (u8));
+      unserialize_integer (m, &out2in_only, sizeof (u8));
+      unserialize_cstring (m, (char **) &tag);
+      vec_add1 (tag, 0);
+
+      rv = snat_add_static_mapping (l_addr, e_addr, l_port, e_port, vrf_id,
+                                    addr_only, ~0, proto, 1 /* is_add */,
+                                    sm_twice_nat, out2in_only, tag);
+      if (rv)
+        snm->n_skipped++;
+      else
+        snm->n_objects++;
+      vec_free (tag);
+    }
+
+  for (is_output = 0; is_output < 2; is_output++)
+    {
+      unserialize_integer (m, &n, sizeof (u32));
+      for (j = 0; j < n; j++)
+        {
+          rv = vnet_snapshot_unserialize_sw_if_index (m, &sw_if_index);
+          unserialize_integer (m, &flags, sizeof (u8));
+          if (rv || sw_if_index == ~0)
+            {
+              snm->n_skipped++;
+              continue;
+            }
+
+          if (flags & NAT_INTERFACE_FLAG_IS_INSIDE)
+            rv |= is_output ?
+              snat_interface_add_del_output_feature (sw_if_index, 1, 0) :
+              snat_interface_add_del (sw_if_index, 1, 0);
+          if (flags & NAT_INTERFACE_FLAG_IS_OUTSIDE)
+            rv |= is_output ?
+              snat_interface_add_del_output_feature (sw_if_index, 0, 0) :
+              snat_interface_add_del (sw_if_index, 0, 0);
+          if (rv)
+            snm->n_skipped++;
+          else
+            snm->n_objects++;
+        }
+    }
+}
+
+/*
+ * NAT44 addresses, static mappings and interfaces. Deterministic NAT
+ * mappings and static mappings to interface addresses which are not yet
+ * resolved are not saved, the latter are part of the configuration which
+ * creates the interface.
+ */
+VNET_SNAPSHOT_SECTION (nat44) = {
+  .name = "nat44",
+  .order = VNET_SNAPSHOT_ORDER_FEATURE,
+  .save = nat_snapshot_save,
+  .restore = nat_snapshot_restore,
+};
+
 
 static void
 snat_ip4_add_del_interface_address_cb (ip4_main_t * im,
@@ -2620,6 +3008,11 @@ snat_config (vlib_main_t * vm, unformat_input_t * input)
 
               clib_bihash_init_8_8 (&tsm->user_hash, "users", user_buckets,
                                     user_memory_size);
+
+              tw_timer_wheel_init_1t_3w_1024sl_ov (&tsm->session_timer_wheel,
+                                                   0 /* no callback */,
+                                                   NAT44_SES_TIMER_TICK,
+                                                   NAT44_SES_EXPIRE_MAX_PER_WALK);
             }
 
           clib_bihash_init_16_8 (&sm->in2out_ed, "in2out-ed",
@@ -3130,6 +3523,7 @@ nat44_del_session (snat_main_t *sm, ip4_address_t *addr, u16 port,
           else
             u->nsessions--;
         }
+      nat44_session_timer_stop (tsm, s);
       clib_dlist_remove (tsm->list_pool, s->per_user_index);
       pool_put_index (tsm->list_pool, s->per_user_index);
       pool_put (tsm->sessions, s);
@@ -27,6 +27,7 @@
 #include <vppinfra/bihash_16_8.h>
 #include <vppinfra/dlist.h>
 #include <vppinfra/error.h>
+#include <vppinfra/tw_timer_1t_3w_1024sl_ov.h>
 #include <vlibapi/api.h>
 
 
@@ -37,6 +38,10 @@
 #define SNAT_TCP_INCOMING_SYN 6
 #define SNAT_ICMP_TIMEOUT 60
 
+/* Session expire timer wheel tick (seconds) and per walk budget */
+#define NAT44_SES_TIMER_TICK 1.0
+#define NAT44_SES_EXPIRE_MAX_PER_WALK 16384
+
 #define SNAT_FLAG_HAIRPINNING (1 << 0)
 
 /* Key */
@@ -130,6 +135,7 @@ typedef enum {
 #define NAT44_SES_O2I_FIN 2
 #define NAT44_SES_I2O_FIN_ACK 4
 #define NAT44_SES_O2I_FIN_ACK 8
+#define NAT44_SES_RST 16
 
 #define nat44_is_ses_closed(s) (s->state == 0xf)
 
@@ -177,6 +183,9 @@ typedef CLIB_PACKED(struct {
   u8 state;
   u32 i2o_fin_seq;
   u32 o2i_fin_seq;
+
+  /* Expire timer handle */
+  u32 timer_handle;
 }) snat_session_t;
 
 
@@ -282,6 +291,16 @@ typedef struct {
   /* Pool of doubly-linked list elements */
   dlist_elt_t * list_pool;
 
+  /* Session expire timers */
+  tw_timer_wheel_1t_3w_1024sl_ov_t session_timer_wheel;
+  u32 * expired_sessions;
+
+  /* Expired sessions counter and rate */
+  u64 sessions_expired;
+  u64 sessions_expired_last;
+  f64 sessions_expired_time;
+  f64 sessions_expired_per_sec;
+
   u32 snat_thread_index;
 } snat_main_per_thread_data_t;
 
@@ -697,6 +716,40 @@ user_session_increment(snat_main_t *sm, snat_user_t *u, u8 is_static)
     }
 }
 
+/** \brief Get NAT44 session idle timeout.
+    @return timeout in seconds, TCP sessions after FIN or RST use transitory
+*/
+always_inline u32
+nat44_session_get_timeout (snat_main_t * sm, snat_session_t * s)
+{
+  switch (s->in2out.protocol)
+    {
+    case SNAT_PROTOCOL_ICMP:
+      return sm->icmp_timeout;
+    case SNAT_PROTOCOL_UDP:
+      return sm->udp_timeout;
+    case SNAT_PROTOCOL_TCP:
+      if (s->state)
+        return sm->tcp_transitory_timeout;
+      else
+        return sm->tcp_established_timeout;
+    default:
+      return sm->udp_timeout;
+    }
+}
+
+always_inline void
+nat44_session_timer_stop (snat_main_per_thread_data_t * tsm,
+                          snat_session_t * s)
+{
+  if (s->timer_handle != ~0)
+    {
+      tw_timer_stop_1t_3w_1024sl_ov (&tsm->session_timer_wheel,
+                                     s->timer_handle);
+      s->timer_handle = ~0;
+    }
+}
+
 always_inline void
 nat44_delete_session(snat_main_t * sm, snat_session_t * ses, u32 thread_index)
 {
@@ -705,6 +758,8 @@ nat44_delete_session(snat_main_t * sm, snat_session_t * ses, u32 thread_index)
   clib_bihash_kv_8_8_t kv, value;
   snat_user_key_t u_key;
   snat_user_t *u;
+
+  nat44_session_timer_stop (tsm, ses);
   u_key.addr = ses->in2out.addr;
   u_key.fib_index = ses->in2out.fib_index;
   kv.key = u_key.as_u64;
@@ -721,6 +776,22 @@ nat44_delete_session(snat_main_t * sm, snat_session_t * ses, u32 thread_index)
   pool_put (tsm->sessions, ses);
 }
 
+/** \brief Track FIN and RST of TCP session, which is then expired with
+    transitory timeout.
+*/
+always_inline void
+nat44_set_tcp_session_transitory (snat_session_t * ses, tcp_header_t * tcp,
+                                  u8 is_i2o)
+{
+  if (PREDICT_FALSE (tcp->flags & (TCP_FLAG_FIN | TCP_FLAG_RST)))
+    {
+      if (tcp->flags & TCP_FLAG_RST)
+        ses->state |= NAT44_SES_RST;
+      else
+        ses->state |= is_i2o ? NAT44_SES_I2O_FIN : NAT44_SES_O2I_FIN;
+    }
+}
+
 /** \brief Set TCP session state.
     @return 1 if session was closed, otherwise 0
 */
@@ -119,7 +119,9 @@ snat_ipfix_logging_enable_disable_command_fn (vlib_main_t * vm,
   unformat_input_t _line_input, *line_input = &_line_input;
   u32 domain_id = 0;
   u32 src_port = 0;
-  u8 enable = 1;
+  u32 syslog_port = snat_ipfix_logging_main.syslog_port;
+  u8 enable = 1, set_format = 0;
+  nat_log_format_t format = snat_ipfix_logging_main.session_format;
   int rv = 0;
   clib_error_t *error = 0;
 
@@ -133,6 +135,18 @@ snat_ipfix_logging_enable_disable_command_fn (vlib_main_t * vm,
 	;
       else if (unformat (line_input, "src-port %d", &src_port))
 	;
+      else if (unformat (line_input, "session-format ipfix"))
+	{
+	  format = NAT_LOG_FORMAT_IPFIX;
+	  set_format = 1;
+	}
+      else if (unformat (line_input, "session-format syslog"))
+	{
+	  format = NAT_LOG_FORMAT_SYSLOG;
+	  set_format = 1;
+	}
+      else if (unformat (line_input, "syslog-port %d", &syslog_port))
+	set_format = 1;
       else if (unformat (line_input, "disable"))
 	enable = 0;
       else
@@ -143,6 +157,8 @@ snat_ipfix_logging_enable_disable_command_fn (vlib_main_t * vm,
 	}
     }
 
+  if (enable && set_format)
+    nat_ipfix_logging_set_session_format (format, (u16) syslog_port);
   rv = snat_ipfix_logging_enable_disable (enable, domain_id, (u16) src_port);
 
   if (rv)
@@ -157,6 +173,67 @@ done:
   return error;
 }
 
+static clib_error_t *
+nat_show_ipfix_logging_command_fn (vlib_main_t * vm, unformat_input_t * input,
+				   vlib_cli_command_t * cmd)
+{
+  vlib_cli_output (vm, "%U", format_nat_ipfix_logging);
+  return 0;
+}
+
+static clib_error_t *
+nat_test_ipfix_logging_perf_command_fn (vlib_main_t * vm,
+					unformat_input_t * input,
+					vlib_cli_command_t * cmd)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  u32 n_events = 1000000, i, j, n;
+  u32 src_ip, nat_src_ip;
+  f64 t0, elapsed = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "events %u", &n_events))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (!silm->enabled)
+    return clib_error_return (0, "NAT IPFIX logging is not enabled");
+
+  nat_src_ip = clib_host_to_net_u32 (0xc6336401);
+
+  /*
+   * Log in batches and let the graph send them in between, only the
+   * time spent logging is accounted.
+   */
+  for (i = 0; i < n_events; i += n)
+    {
+      n = clib_min (10000, n_events - i);
+      t0 = vlib_time_now (vm);
+      for (j = 0; j < n; j++)
+	{
+	  src_ip = clib_host_to_net_u32 (0x0a000000 + ((i + j) >> 10));
+	  snat_ipfix_logging_nat44_ses_create (src_ip, nat_src_ip,
+					       SNAT_PROTOCOL_UDP,
+					       clib_host_to_net_u16 (1024 +
+								     (j &
+								      1023)),
+					       clib_host_to_net_u16 (1024 +
+								     j), 0);
+	}
+      elapsed += vlib_time_now (vm) - t0;
+      vlib_process_suspend (vm, 1e-3);
+    }
+
+  vlib_cli_output (vm, "%u session events logged in %.3f sec, "
+		   "%.0f events/sec", n_events, elapsed,
+		   elapsed > 0 ? (f64) n_events / elapsed : 0);
+  return 0;
+}
+
 static clib_error_t *
 nat44_show_hash_commnad_fn (vlib_main_t * vm, unformat_input_t * input,
 			    vlib_cli_command_t * cmd)
@@ -942,6 +1019,10 @@ nat44_show_sessions_command_fn (vlib_main_t * vm, unformat_input_t * input,
     {
       tsm = vec_elt_at_index (sm->per_thread_data, i);
 
+      vlib_cli_output (vm, "  thread %d: %d sessions, %lld expired "
+                       "(%.2f/sec)", i, pool_elts (tsm->sessions),
+                       tsm->sessions_expired, tsm->sessions_expired_per_sec);
+
       pool_foreach (u, tsm->users,
       ({
         vlib_cli_output (vm, "  %U", format_snat_user, tsm, u, verbose);
@@ -1269,9 +1350,6 @@ set_timeout_command_fn (vlib_main_t * vm,
   unformat_input_t _line_input, *line_input = &_line_input;
   clib_error_t *error = 0;
 
-  if (!sm->deterministic)
-    return clib_error_return (0, SUPPORTED_ONLY_IN_DET_MODE_STR);
-
   /* Get a line of input. */
   if (!unformat_user (input, unformat_line_input, line_input))
     return 0;
@@ -1316,9 +1394,6 @@ nat44_det_show_timeouts_command_fn (vlib_main_t * vm,
 {
   snat_main_t *sm = &snat_main;
 
-  if (!sm->deterministic)
-    return clib_error_return (0, SUPPORTED_ONLY_IN_DET_MODE_STR);
-
   vlib_cli_output (vm, "udp timeout: %dsec", sm->udp_timeout);
   vlib_cli_output (vm, "tcp-established timeout: %dsec",
 		   sm->tcp_established_timeout);
@@ -1509,6 +1584,9 @@ VLIB_CLI_COMMAND (nat_show_workers_command, static) = {
  * @cliexstart{snat ipfix logging}
  * To enable NAT IPFIX logging use:
  *  vpp# nat ipfix logging
+ * To log NAT44 session events as bulk syslog messages instead use:
+ *  vpp# nat ipfix logging session-format syslog syslog-port 514
+ * The session format is kept until changed by another enable.
  * To set IPFIX exporter use:
  *  vpp# set ipfix exporter collector 10.10.10.3 src 10.10.10.1
  * @cliexend
@@ -1516,7 +1594,40 @@ VLIB_CLI_COMMAND (nat_show_workers_command, static) = {
 VLIB_CLI_COMMAND (snat_ipfix_logging_enable_disable_command, static) = {
   .path = "nat ipfix logging",
   .function = snat_ipfix_logging_enable_disable_command_fn,
-  .short_help = "nat ipfix logging [domain <domain-id>] [src-port <port>] [disable]",
+  .short_help = "nat ipfix logging [domain <domain-id>] [src-port <port>] "
+                "[session-format ipfix|syslog] [syslog-port <port>] [disable]",
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{show nat ipfix logging}
+ * Show NAT event logging configuration and per thread counters of session
+ * events logged, packets sent and events dropped for lack of buffers.
+ *  vpp# show nat ipfix logging
+ *  NAT IPFIX logging enabled, session events as ipfix
+ *    thread 0: 1000000 events, 58824 packets, 0 dropped
+ *    total: 1000000 events, 58824 packets, 0 dropped
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_show_ipfix_logging_command, static) = {
+  .path = "show nat ipfix logging",
+  .function = nat_show_ipfix_logging_command_fn,
+  .short_help = "show nat ipfix logging",
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{test nat ipfix logging perf}
+ * Measure the NAT44 session event logging rate of the calling thread by
+ * logging synthetic session create events, which are sent to the
+ * configured collector.
+ *  vpp# test nat ipfix logging perf events 1000000
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_test_ipfix_logging_perf_command, static) = {
+  .path = "test nat ipfix logging perf",
+  .function = nat_test_ipfix_logging_perf_command_fn,
+  .short_help = "test nat ipfix logging perf [events <n>]",
 };
 
 /*?
@@ -1871,6 +1982,43 @@ VLIB_CLI_COMMAND (set_timeout_command, static) = {
     "tcp-transitory <sec> | icmp <sec> | reset]",
 };
 
+/*?
+ * @cliexpar
+ * @cliexstart{set nat timeout}
+ * Set values of NAT44 session timeouts (in seconds). Idle sessions are
+ * deleted when their timeout expires, TCP sessions use the transitory
+ * timeout after FIN or RST was seen, use:
+ *  vpp# set nat timeout udp 120 tcp-established 7500 tcp-transitory 250
+ *  icmp 90
+ * To reset default values use:
+ *  vpp# set nat timeout reset
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (set_nat_timeout_command, static) = {
+  .path = "set nat timeout",
+  .function = set_timeout_command_fn,
+  .short_help =
+    "set nat timeout [udp <sec> | tcp-established <sec> "
+    "tcp-transitory <sec> | icmp <sec> | reset]",
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{show nat timeouts}
+ * Show values of NAT44 session timeouts.
+ * vpp# show nat timeouts
+ * udp timeout: 300sec
+ * tcp-established timeout: 7440sec
+ * tcp-transitory timeout: 240sec
+ * icmp timeout: 60sec
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_show_timeouts_command, static) = {
+  .path = "show nat timeouts",
+  .short_help = "show nat timeouts",
+  .function = nat44_det_show_timeouts_command_fn,
+};
+
 /*?
  * @cliexpar
  * @cliexstart{show nat44 deterministic timeouts}
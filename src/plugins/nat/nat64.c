@@ -214,8 +214,6 @@ nat64_init (vlib_main_t * vm)
   vlib_thread_main_t *tm = vlib_get_thread_main ();
   ip4_add_del_interface_address_callback_t cb4;
   ip4_main_t *im = &ip4_main;
-  vlib_node_t *error_drop_node =
-    vlib_get_node_by_name (vm, (u8 *) "error-drop");
 
   vec_validate (nm->db, tm->n_vlib_mains - 1);
 
@@ -223,7 +221,6 @@ nat64_init (vlib_main_t * vm)
 
   nm->fq_in2out_index = ~0;
   nm->fq_out2in_index = ~0;
-  nm->error_node_index = error_drop_node->index;
 
   /* set session timeouts to default values */
   nm->udp_timeout = SNAT_UDP_TIMEOUT;
@@ -468,11 +465,21 @@ nat64_add_del_interface (u32 sw_if_index, u8 is_inside, u8 is_add)
       feature_name =
 	is_inside ? "nat64-in2out-handoff" : "nat64-out2in-handoff";
       if (nm->fq_in2out_index == ~0)
-	nm->fq_in2out_index =
-	  vlib_frame_queue_main_init (nat64_in2out_node.index, 0);
+	{
+	  nm->fq_in2out_index =
+	    vlib_frame_queue_main_init (nat64_in2out_node.index, 0);
+	  vlib_frame_queue_set_congestion (nm->fq_in2out_index,
+					   VLIB_FRAME_QUEUE_CONGESTION_TAIL_DROP,
+					   NAT64_FQ_CONGESTION_THRESHOLD);
+	}
       if (nm->fq_out2in_index == ~0)
-	nm->fq_out2in_index =
-	  vlib_frame_queue_main_init (nat64_out2in_node.index, 0);
+	{
+	  nm->fq_out2in_index =
+	    vlib_frame_queue_main_init (nat64_out2in_node.index, 0);
+	  vlib_frame_queue_set_congestion (nm->fq_out2in_index,
+					   VLIB_FRAME_QUEUE_CONGESTION_TAIL_DROP,
+					   NAT64_FQ_CONGESTION_THRESHOLD);
+	}
     }
   else
     feature_name = is_inside ? "nat64-in2out" : "nat64-out2in";
@@ -550,7 +557,8 @@ nat64_free_out_addr_and_port (struct nat64_db_s *db, ip4_address_t * addr,
         case SNAT_PROTOCOL_##N: \
           ASSERT (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, \
                   port_host_byte_order) == 1); \
-          clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, port, 0); \
+          clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, \
+                                    port_host_byte_order, 0); \
           a->busy_##n##_ports--; \
           a->busy_##n##_ports_per_thread[thread_index]--; \
           break;
@@ -1156,9 +1164,8 @@ nat64_expire_worker_walk_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
   nat64_main_t *nm = &nat64_main;
   u32 thread_index = vlib_get_thread_index ();
   nat64_db_t *db = &nm->db[thread_index];
-  u32 now = (u32) vlib_time_now (vm);
 
-  nad64_db_st_free_expired (db, now);
+  nad64_db_st_free_expired (db, vlib_time_now (vm));
 
   return 0;
 }
@@ -1206,7 +1213,7 @@ nat64_expire_walk_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
     {
       if (nm->total_enabled_count)
 	{
-	  vlib_process_wait_for_event_or_clock (vm, 10.0);
+	  vlib_process_wait_for_event_or_clock (vm, NAT64_DB_ST_TIMER_TICK);
 	  event_type = vlib_process_get_events (vm, &event_data);
 	}
       else
@@ -22,6 +22,9 @@
 #include <nat/nat.h>
 #include <nat/nat64_db.h>
 
+/* Handoff ring occupancy above which NAT64 handoff drops packets */
+#define NAT64_FQ_CONGESTION_THRESHOLD 30
+
 #define foreach_nat64_tcp_ses_state            \
   _(0, CLOSED, "closed")                       \
   _(1, V4_INIT, "v4-init")                     \
@@ -89,8 +92,6 @@ typedef struct
   /** Pool of static BIB entries to be added/deleted in worker threads */
   nat64_static_bib_to_update_t *static_bibs;
 
-  u32 error_node_index;
-
   /** config parameters */
   u32 bib_buckets;
   u32 bib_memory_size;
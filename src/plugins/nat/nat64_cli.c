@@ -645,6 +645,9 @@ nat64_show_st_command_fn (vlib_main_t * vm,
   /* *INDENT-OFF* */
   vec_foreach (db, nm->db)
     {
+      vlib_cli_output (vm, " thread %d: %d sessions, %lld expired (%.2f/sec)",
+                       db - nm->db, db->st.st_entries_num, db->st.expired_num,
+                       db->st.expired_per_sec);
       ctx.db = db;
       nat64_db_st_walk (db, p, nat64_cli_st_walk, &ctx);
     }
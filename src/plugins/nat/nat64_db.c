@@ -37,6 +37,10 @@ nat64_db_init (nat64_db_t * db, u32 bib_buckets, u32 bib_memory_size,
   clib_bihash_init_48_8 (&db->st.out2in, "st-out2in", st_buckets,
 			 st_memory_size);
 
+  tw_timer_wheel_init_1t_3w_1024sl_ov (&db->st.timer_wheel, 0,
+				       NAT64_DB_ST_TIMER_TICK,
+				       NAT64_DB_ST_EXPIRE_MAX_PER_WALK);
+
   db->free_addr_port_cb = free_addr_port_cb;
   db->bib.limit = 10 * bib_buckets;
   db->bib.bib_entries_num = 0;
@@ -377,6 +381,7 @@ nat64_db_st_entry_create (nat64_db_t * db, nat64_db_bib_entry_t * bibe,
   nat64_db_st_entry_key_t ste_key;
   clib_bihash_kv_48_8_t kv;
   fib_table_t *fib;
+  u32 snat_proto;
 
   if (db->st.st_entries_num >= db->st.limit)
     {
@@ -385,7 +390,8 @@ nat64_db_st_entry_create (nat64_db_t * db, nat64_db_bib_entry_t * bibe,
     }
 
   /* create pool entry */
-  switch (ip_proto_to_snat_proto (bibe->proto))
+  snat_proto = ip_proto_to_snat_proto (bibe->proto);
+  switch (snat_proto)
     {
 /* *INDENT-OFF* */
 #define _(N, i, n, s) \
@@ -401,6 +407,7 @@ nat64_db_st_entry_create (nat64_db_t * db, nat64_db_bib_entry_t * bibe,
       pool_get (db->st._unk_proto_st, ste);
       kv.value = ste - db->st._unk_proto_st;
       bib = db->bib._unk_proto_bib;
+      snat_proto = ~0;
       break;
     }
 
@@ -414,6 +421,13 @@ nat64_db_st_entry_create (nat64_db_t * db, nat64_db_bib_entry_t * bibe,
   ste->bibe_index = bibe - bib;
   ste->proto = bibe->proto;
 
+  /* expire time is set by the caller, check it on the next tick */
+  ste->timer_handle =
+    tw_timer_start_1t_3w_1024sl_ov (&db->st.timer_wheel,
+				    ((snat_proto & 3) <<
+				     NAT64_DB_ST_TIMER_PROTO_SHIFT) |
+				    kv.value, 0, 1);
+
   /* increment session number for BIB entry */
   bibe->ses_num++;
 
@@ -489,6 +503,9 @@ nat64_db_st_entry_free (nat64_db_t * db, nat64_db_st_entry_t * ste)
 
   db->st.st_entries_num--;
 
+  if (ste->timer_handle != ~0)
+    tw_timer_stop_1t_3w_1024sl_ov (&db->st.timer_wheel, ste->timer_handle);
+
   /* delete hash lookup */
   memset (&ste_key, 0, sizeof (ste_key));
   ste_key.l_addr.as_u64[0] = bibe->in_addr.as_u64[0];
@@ -634,35 +651,64 @@ nat64_db_st_entry_by_index (nat64_db_t * db, u8 proto, u32 ste_index)
 }
 
 void
-nad64_db_st_free_expired (nat64_db_t * db, u32 now)
+nad64_db_st_free_expired (nat64_db_t * db, f64 now)
 {
-  u32 *ste_to_be_free = 0, *ste_index;
   nat64_db_st_entry_t *st, *ste;
+  u32 *handle, index;
+  u64 ticks;
 
+  vec_reset_length (db->st.expired);
+  db->st.expired =
+    tw_timer_expire_timers_vec_1t_3w_1024sl_ov (&db->st.timer_wheel, now,
+						db->st.expired);
+
+  vec_foreach (handle, db->st.expired)
+    {
+      index = handle[0] & NAT64_DB_ST_TIMER_INDEX_MASK;
+      switch (handle[0] >> NAT64_DB_ST_TIMER_PROTO_SHIFT)
+	{
 /* *INDENT-OFF* */
 #define _(N, i, n, s) \
-  st = db->st._##n##_st; \
-  pool_foreach (ste, st, ({\
-    if (i == SNAT_PROTOCOL_TCP && !ste->tcp_state) \
-      continue; \
-    if (ste->expire < now) \
-      vec_add1 (ste_to_be_free, ste - st); \
-  })); \
-  vec_foreach (ste_index, ste_to_be_free) \
-    nat64_db_st_entry_free (db, pool_elt_at_index(st, ste_index[0])); \
-  vec_free (ste_to_be_free); \
-  ste_to_be_free = 0;
-  foreach_snat_protocol
+	case SNAT_PROTOCOL_##N: \
+	  st = db->st._##n##_st; \
+	  break;
+	  foreach_snat_protocol
 #undef _
-  st = db->st._unk_proto_st;
-  pool_foreach (ste, st, ({
-    if (ste->expire < now)
-      vec_add1 (ste_to_be_free, ste - st);
-  }));
-  vec_foreach (ste_index, ste_to_be_free)
-    nat64_db_st_entry_free (db, pool_elt_at_index(st, ste_index[0]));
-  vec_free (ste_to_be_free);
 /* *INDENT-ON* */
+	default:
+	  st = db->st._unk_proto_st;
+	  break;
+	}
+
+      ste = pool_elt_at_index (st, index);
+      ste->timer_handle = ~0;
+
+      /* TCP sessions in CLOSED state do not expire */
+      if (ip_proto_to_snat_proto (ste->proto) == SNAT_PROTOCOL_TCP
+	  && !ste->tcp_state)
+	ticks = NAT64_DB_ST_CLOSED_RECHECK;
+      else if ((f64) ste->expire > now)
+	ticks = (u64) ((f64) ste->expire - now) + 1;
+      else
+	{
+	  nat64_db_st_entry_free (db, ste);
+	  db->st.expired_num++;
+	  continue;
+	}
+
+      ste->timer_handle =
+	tw_timer_start_1t_3w_1024sl_ov (&db->st.timer_wheel, handle[0], 0,
+					ticks);
+    }
+
+  if (now >= db->st.expired_time + 1.0)
+    {
+      db->st.expired_per_sec =
+	(f64) (db->st.expired_num - db->st.expired_num_last) /
+	(now - db->st.expired_time);
+      db->st.expired_num_last = db->st.expired_num;
+      db->st.expired_time = now;
+    }
 }
 
 void
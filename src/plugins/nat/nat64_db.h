@@ -23,6 +23,14 @@
 #include <vppinfra/bihash_48_8.h>
 #include <nat/nat.h>
 
+/* Session expire timer wheel tick (seconds) and per walk budget */
+#define NAT64_DB_ST_TIMER_TICK 1.0
+#define NAT64_DB_ST_EXPIRE_MAX_PER_WALK 16384
+/* Recheck interval (ticks) of TCP sessions in CLOSED state */
+#define NAT64_DB_ST_CLOSED_RECHECK 10
+/* Session timer user handle is protocol and index in per protocol table */
+#define NAT64_DB_ST_TIMER_PROTO_SHIFT 30
+#define NAT64_DB_ST_TIMER_INDEX_MASK ((1 << NAT64_DB_ST_TIMER_PROTO_SHIFT) - 1)
 
 typedef struct
 {
@@ -101,6 +109,7 @@ typedef CLIB_PACKED(struct
   u32 expire;
   u8 proto;
   u8 tcp_state;
+  u32 timer_handle;
 }) nat64_db_st_entry_t;
 /* *INDENT-ON* */
 
@@ -119,6 +128,16 @@ typedef struct
   clib_bihash_48_8_t in2out;
   clib_bihash_48_8_t out2in;
 
+  /* session expire timers */
+  tw_timer_wheel_1t_3w_1024sl_ov_t timer_wheel;
+  u32 *expired;
+
+  /* expired sessions counter and rate */
+  u64 expired_num;
+  u64 expired_num_last;
+  f64 expired_time;
+  f64 expired_per_sec;
+
   u32 limit;
   u32 st_entries_num;
 } nat64_db_st_t;
@@ -308,10 +327,14 @@ void nat64_db_st_walk (nat64_db_t * db, u8 proto,
 /**
  * @brief Free expired session entries in session tables.
  *
+ * Session entries are checked when their timer expires, the timer is started
+ * one tick after entry creation and then rescheduled to the expire time of
+ * the entry until it is reached.
+ *
  * @param db NAT64 DB.
  * @param now Current time.
  */
-void nad64_db_st_free_expired (nat64_db_t * db, u32 now);
+void nad64_db_st_free_expired (nat64_db_t * db, f64 now);
 
 /**
  * @brief Free sessions using specific outside address.
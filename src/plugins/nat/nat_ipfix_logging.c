@@ -40,17 +40,6 @@ snat_ipfix_logging_main_t snat_ipfix_logging_main;
 #define NAT64_BIB_FIELD_COUNT 8
 #define NAT64_SES_FIELD_COUNT 12
 
-typedef struct
-{
-  u8 nat_event;
-  u32 src_ip;
-  u32 nat_src_ip;
-  snat_protocol_t snat_proto;
-  u16 src_port;
-  u16 nat_src_port;
-  u32 vrf_id;
-} snat_ipfix_logging_nat44_ses_args_t;
-
 typedef struct
 {
   u32 pool_id;
@@ -84,32 +73,6 @@ typedef struct
   u64 src[2];
 } nat_ipfix_logging_max_frags_ip6_args_t;
 
-typedef struct
-{
-  u8 nat_event;
-  u64 src_ip[2];
-  u32 nat_src_ip;
-  u8 proto;
-  u16 src_port;
-  u16 nat_src_port;
-  u64 dst_ip[2];
-  u32 nat_dst_ip;
-  u32 vrf_id;
-  u16 dst_port;
-  u16 nat_dst_port;
-} nat_ipfix_logging_nat64_ses_args_t;
-
-typedef struct
-{
-  u8 nat_event;
-  u64 src_ip[2];
-  u32 nat_src_ip;
-  u8 proto;
-  u16 src_port;
-  u16 nat_src_port;
-  u32 vrf_id;
-} nat_ipfix_logging_nat64_bib_args_t;
-
 #define skip_if_disabled()                                    \
 do {                                                          \
   snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main; \
@@ -521,7 +484,7 @@ nat_template_rewrite_nat64_session (flow_report_main_t * frm,
 }
 
 static inline void
-snat_ipfix_header_create (flow_report_main_t * frm,
+snat_ipfix_header_create (vlib_main_t * vm, flow_report_main_t * frm,
 			  vlib_buffer_t * b0, u32 * offset)
 {
   snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
@@ -558,24 +521,26 @@ snat_ipfix_header_create (flow_report_main_t * frm,
 
   h->export_time = clib_host_to_net_u32 ((u32)
 					 (((f64) frm->unix_time_0) +
-					  (vlib_time_now (frm->vlib_main) -
+					  (vlib_time_now (vm) -
 					   frm->vlib_time_0)));
-  h->sequence_number = clib_host_to_net_u32 (stream->sequence_number++);
+  /* Session events are logged by all threads into the same stream */
+  h->sequence_number =
+    clib_host_to_net_u32 (__sync_fetch_and_add
+			  (&stream->sequence_number, 1));
   h->domain_id = clib_host_to_net_u32 (stream->domain_id);
 
   *offset = (u32) (((u8 *) (s + 1)) - (u8 *) tp);
 }
 
 static inline void
-snat_ipfix_send (flow_report_main_t * frm,
-		 vlib_frame_t * f, vlib_buffer_t * b0, u16 template_id)
+snat_ipfix_fixup (vlib_main_t * vm, flow_report_main_t * frm,
+		  vlib_buffer_t * b0, u16 template_id)
 {
   ip4_ipfix_template_packet_t *tp;
   ipfix_message_header_t *h = 0;
   ipfix_set_header_t *s = 0;
   ip4_header_t *ip;
   udp_header_t *udp;
-  vlib_main_t *vm = frm->vlib_main;
 
   tp = vlib_buffer_get_current (b0);
   ip = (ip4_header_t *) & tp->ip4;
@@ -602,73 +567,261 @@ snat_ipfix_send (flow_report_main_t * frm,
     }
 
   ASSERT (ip->checksum == ip4_header_checksum (ip));
+}
 
+static inline void
+snat_ipfix_send (vlib_main_t * vm, flow_report_main_t * frm,
+		 vlib_frame_t * f, vlib_buffer_t * b0, u16 template_id)
+{
+  snat_ipfix_fixup (vm, frm, b0, template_id);
   vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
 }
 
+/**
+ * @brief Add a finished session event packet to the calling thread's
+ * frame, the frame is put once full or by the periodic flush
+ */
+static inline void
+nat_ipfix_enqueue (vlib_main_t * vm, nat_ipfix_per_thread_data_t * ptd,
+		   vlib_buffer_t * b0)
+{
+  vlib_frame_t *f = ptd->frame;
+  u32 *to_next;
+
+  if (PREDICT_FALSE (f == 0))
+    f = ptd->frame = vlib_get_frame_to_node (vm, ip4_lookup_node.index);
+
+  to_next = vlib_frame_vector_args (f);
+  to_next[f->n_vectors++] = vlib_get_buffer_index (vm, b0);
+  ptd->n_packets++;
+
+  if (f->n_vectors == VLIB_FRAME_SIZE)
+    {
+      vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
+      ptd->frame = 0;
+    }
+}
+
+static inline void
+nat_ipfix_put_frame (vlib_main_t * vm, nat_ipfix_per_thread_data_t * ptd)
+{
+  if (ptd->frame)
+    {
+      vlib_put_frame_to_node (vm, ip4_lookup_node.index, ptd->frame);
+      ptd->frame = 0;
+    }
+}
+
+/**
+ * @brief Get the calling thread's session event buffer, allocating one
+ *
+ * @param vm     vlib main of the calling thread
+ * @param ptd    per thread data of the calling thread
+ * @param bp     buffer under construction
+ * @param offset set to 0 if a new buffer was allocated
+ *
+ * @returns buffer or 0 if none could be allocated
+ */
+static inline vlib_buffer_t *
+nat_ipfix_get_buffer (vlib_main_t * vm, nat_ipfix_per_thread_data_t * ptd,
+		      vlib_buffer_t ** bp, u32 * offset)
+{
+  vlib_buffer_free_list_t *fl;
+  vlib_buffer_t *b0;
+  u32 bi0;
+
+  if (PREDICT_TRUE (*bp != 0))
+    return *bp;
+
+  if (vlib_buffer_alloc (vm, &bi0, 1) != 1)
+    {
+      ptd->n_drops++;
+      return 0;
+    }
+
+  b0 = *bp = vlib_get_buffer (vm, bi0);
+  fl = vlib_buffer_get_free_list (vm, VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
+  vlib_buffer_init_for_free_list (b0, fl);
+  VLIB_BUFFER_TRACE_TRAJECTORY_INIT (b0);
+  *offset = 0;
+
+  return b0;
+}
+
+static inline void
+nat_syslog_header_create (vlib_main_t * vm, flow_report_main_t * frm,
+			  vlib_buffer_t * b0, u32 * offset)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  flow_report_stream_t *stream;
+  ip4_header_t *ip;
+  udp_header_t *udp;
+
+  stream = &frm->streams[silm->stream_index];
+
+  b0->current_data = 0;
+  b0->current_length = sizeof (*ip) + sizeof (*udp);
+  b0->flags |= (VLIB_BUFFER_TOTAL_LENGTH_VALID | VNET_BUFFER_F_FLOW_REPORT);
+  vnet_buffer (b0)->sw_if_index[VLIB_RX] = 0;
+  vnet_buffer (b0)->sw_if_index[VLIB_TX] = frm->fib_index;
+  ip = vlib_buffer_get_current (b0);
+  udp = (udp_header_t *) (ip + 1);
+
+  memset (ip, 0, sizeof (*ip));
+  ip->ip_version_and_header_length = 0x45;
+  ip->ttl = 254;
+  ip->protocol = IP_PROTOCOL_UDP;
+  ip->src_address.as_u32 = frm->src_address.as_u32;
+  ip->dst_address.as_u32 = frm->ipfix_collector.as_u32;
+  udp->src_port = clib_host_to_net_u16 (stream->src_port);
+  udp->dst_port = clib_host_to_net_u16 (silm->syslog_port);
+  udp->checksum = 0;
+
+  *offset = b0->current_length;
+}
+
+static inline void
+nat_syslog_fixup (vlib_main_t * vm, flow_report_main_t * frm,
+		  vlib_buffer_t * b0)
+{
+  ip4_header_t *ip;
+  udp_header_t *udp;
+
+  ip = vlib_buffer_get_current (b0);
+  udp = (udp_header_t *) (ip + 1);
+
+  ip->length = clib_host_to_net_u16 (b0->current_length);
+  ip->checksum = ip4_header_checksum (ip);
+  udp->length = clib_host_to_net_u16 (b0->current_length - sizeof (*ip));
+
+  if (frm->udp_checksum)
+    {
+      udp->checksum = ip4_tcp_udp_compute_checksum (vm, b0, ip);
+      if (udp->checksum == 0)
+	udp->checksum = 0xffff;
+    }
+}
+
+/**
+ * @brief Log a NAT44 session event as a syslog style message
+ *
+ * Messages are RFC 5424 formatted, several of them newline separated per
+ * datagram, sent to the IPFIX collector on the syslog port.
+ */
 static void
-snat_ipfix_logging_nat44_ses (u8 nat_event, u32 src_ip, u32 nat_src_ip,
-			      snat_protocol_t snat_proto, u16 src_port,
-			      u16 nat_src_port, u32 vrf_id, int do_flush)
+nat_syslog_nat44_ses (vlib_main_t * vm, u8 nat_event, u32 src_ip,
+		      u32 nat_src_ip, u8 proto, u16 src_port,
+		      u16 nat_src_port, u32 vrf_id, u64 now, int do_flush)
 {
   snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
   flow_report_main_t *frm = &flow_report_main;
-  vlib_frame_t *f;
+  nat_ipfix_per_thread_data_t *ptd;
+  vlib_buffer_t *b0;
+  u32 offset, len;
+
+  ptd = vec_elt_at_index (silm->per_thread_data, vm->thread_index);
+  offset = ptd->syslog_next_record_offset;
+
+  if (PREDICT_TRUE (do_flush == 0))
+    {
+      /* local0.info */
+      vec_reset_length (ptd->syslog_msg);
+      ptd->syslog_msg =
+	format (ptd->syslog_msg,
+		"<134>1 - - vpp - %s - ts=%llu proto=%u src=%U:%u "
+		"nat=%U:%u vrf=%u\n",
+		nat_event == NAT44_SESSION_CREATE ? "SADD" : "SDEL", now,
+		proto, format_ip4_address, &src_ip,
+		clib_net_to_host_u16 (src_port), format_ip4_address,
+		&nat_src_ip, clib_net_to_host_u16 (nat_src_port), vrf_id);
+    }
+  len = vec_len (ptd->syslog_msg);
+
+  b0 = ptd->syslog_buffer;
+  if (PREDICT_FALSE (b0 == 0))
+    {
+      if (do_flush)
+	return;
+      b0 = nat_ipfix_get_buffer (vm, ptd, &ptd->syslog_buffer, &offset);
+      if (!b0)
+	return;
+    }
+
+  if (PREDICT_FALSE (offset == 0))
+    nat_syslog_header_create (vm, frm, b0, &offset);
+
+  /* Send what is there if this message doesn't fit */
+  if (PREDICT_FALSE (do_flush || (offset + len) > frm->path_mtu))
+    {
+      nat_syslog_fixup (vm, frm, b0);
+      nat_ipfix_enqueue (vm, ptd, b0);
+      ptd->syslog_buffer = 0;
+      ptd->syslog_next_record_offset = 0;
+      if (do_flush)
+	return;
+      b0 = nat_ipfix_get_buffer (vm, ptd, &ptd->syslog_buffer, &offset);
+      if (!b0)
+	return;
+      nat_syslog_header_create (vm, frm, b0, &offset);
+    }
+
+  clib_memcpy (b0->data + offset, ptd->syslog_msg, len);
+  offset += len;
+  b0->current_length += len;
+  ptd->n_events++;
+
+  ptd->syslog_next_record_offset = offset;
+}
+
+static void
+snat_ipfix_logging_nat44_ses (vlib_main_t * vm, u8 nat_event, u32 src_ip,
+			      u32 nat_src_ip, snat_protocol_t snat_proto,
+			      u16 src_port, u16 nat_src_port, u32 vrf_id,
+			      int do_flush)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  flow_report_main_t *frm = &flow_report_main;
+  nat_ipfix_per_thread_data_t *ptd;
   vlib_buffer_t *b0 = 0;
-  u32 bi0 = ~0;
   u32 offset;
-  vlib_main_t *vm = frm->vlib_main;
   u64 now;
-  vlib_buffer_free_list_t *fl;
   u8 proto = ~0;
 
   if (!silm->enabled)
     return;
 
+  ptd = vec_elt_at_index (silm->per_thread_data, vm->thread_index);
+
   proto = snat_proto_to_ip_proto (snat_proto);
 
   now = (u64) ((vlib_time_now (vm) - silm->vlib_time_0) * 1e3);
   now += silm->milisecond_time_0;
 
-  b0 = silm->nat44_session_buffer;
-
-  if (PREDICT_FALSE (b0 == 0))
+  /* a flush also sends what is left of the other format */
+  if (do_flush || silm->session_format == NAT_LOG_FORMAT_SYSLOG)
     {
-      if (do_flush)
+      nat_syslog_nat44_ses (vm, nat_event, src_ip, nat_src_ip, proto,
+			    src_port, nat_src_port, vrf_id, now, do_flush);
+      if (!do_flush)
 	return;
+    }
 
-      if (vlib_buffer_alloc (vm, &bi0, 1) != 1)
-	{
-	  clib_warning ("can't allocate buffer for NAT IPFIX event");
-	  return;
-	}
+  b0 = ptd->nat44_session_buffer;
+  offset = ptd->nat44_session_next_record_offset;
 
-      b0 = silm->nat44_session_buffer = vlib_get_buffer (vm, bi0);
-      fl =
-	vlib_buffer_get_free_list (vm, VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
-      vlib_buffer_init_for_free_list (b0, fl);
-      VLIB_BUFFER_TRACE_TRAJECTORY_INIT (b0);
-      offset = 0;
-    }
-  else
+  if (PREDICT_FALSE (b0 == 0))
     {
-      bi0 = vlib_get_buffer_index (vm, b0);
-      offset = silm->nat44_session_next_record_offset;
-    }
+      if (do_flush)
+	return;
 
-  f = silm->nat44_session_frame;
-  if (PREDICT_FALSE (f == 0))
-    {
-      u32 *to_next;
-      f = vlib_get_frame_to_node (vm, ip4_lookup_node.index);
-      silm->nat44_session_frame = f;
-      to_next = vlib_frame_vector_args (f);
-      to_next[0] = bi0;
-      f->n_vectors = 1;
+      b0 = nat_ipfix_get_buffer (vm, ptd, &ptd->nat44_session_buffer,
+				 &offset);
+      if (!b0)
+	return;
     }
 
   if (PREDICT_FALSE (offset == 0))
-    snat_ipfix_header_create (frm, b0, &offset);
+    snat_ipfix_header_create (vm, frm, b0, &offset);
 
   if (PREDICT_TRUE (do_flush == 0))
     {
@@ -698,17 +851,18 @@ snat_ipfix_logging_nat44_ses (u8 nat_event, u32 src_ip, u32 nat_src_ip,
       offset += sizeof (vrf_id);
 
       b0->current_length += NAT44_SESSION_CREATE_LEN;
+      ptd->n_events++;
     }
 
   if (PREDICT_FALSE
       (do_flush || (offset + NAT44_SESSION_CREATE_LEN) > frm->path_mtu))
     {
-      snat_ipfix_send (frm, f, b0, silm->nat44_session_template_id);
-      silm->nat44_session_frame = 0;
-      silm->nat44_session_buffer = 0;
+      snat_ipfix_fixup (vm, frm, b0, silm->nat44_session_template_id);
+      nat_ipfix_enqueue (vm, ptd, b0);
+      ptd->nat44_session_buffer = 0;
       offset = 0;
     }
-  silm->nat44_session_next_record_offset = offset;
+  ptd->nat44_session_next_record_offset = offset;
 }
 
 static void
@@ -769,7 +923,7 @@ snat_ipfix_logging_addr_exhausted (u32 pool_id, int do_flush)
     }
 
   if (PREDICT_FALSE (offset == 0))
-    snat_ipfix_header_create (frm, b0, &offset);
+    snat_ipfix_header_create (vm, frm, b0, &offset);
 
   if (PREDICT_TRUE (do_flush == 0))
     {
@@ -789,7 +943,7 @@ snat_ipfix_logging_addr_exhausted (u32 pool_id, int do_flush)
   if (PREDICT_FALSE
       (do_flush || (offset + NAT_ADDRESSES_EXHAUTED_LEN) > frm->path_mtu))
     {
-      snat_ipfix_send (frm, f, b0, silm->addr_exhausted_template_id);
+      snat_ipfix_send (vm, frm, f, b0, silm->addr_exhausted_template_id);
       silm->addr_exhausted_frame = 0;
       silm->addr_exhausted_buffer = 0;
       offset = 0;
@@ -856,7 +1010,7 @@ snat_ipfix_logging_max_entries_per_usr (u32 limit, u32 src_ip, int do_flush)
     }
 
   if (PREDICT_FALSE (offset == 0))
-    snat_ipfix_header_create (frm, b0, &offset);
+    snat_ipfix_header_create (vm, frm, b0, &offset);
 
   if (PREDICT_TRUE (do_flush == 0))
     {
@@ -882,7 +1036,7 @@ snat_ipfix_logging_max_entries_per_usr (u32 limit, u32 src_ip, int do_flush)
   if (PREDICT_FALSE
       (do_flush || (offset + MAX_ENTRIES_PER_USER_LEN) > frm->path_mtu))
     {
-      snat_ipfix_send (frm, f, b0, silm->max_entries_per_user_template_id);
+      snat_ipfix_send (vm, frm, f, b0, silm->max_entries_per_user_template_id);
       silm->max_entries_per_user_frame = 0;
       silm->max_entries_per_user_buffer = 0;
       offset = 0;
@@ -949,7 +1103,7 @@ nat_ipfix_logging_max_ses (u32 limit, int do_flush)
     }
 
   if (PREDICT_FALSE (offset == 0))
-    snat_ipfix_header_create (frm, b0, &offset);
+    snat_ipfix_header_create (vm, frm, b0, &offset);
 
   if (PREDICT_TRUE (do_flush == 0))
     {
@@ -972,7 +1126,7 @@ nat_ipfix_logging_max_ses (u32 limit, int do_flush)
   if (PREDICT_FALSE
       (do_flush || (offset + MAX_SESSIONS_LEN) > frm->path_mtu))
     {
-      snat_ipfix_send (frm, f, b0, silm->max_sessions_template_id);
+      snat_ipfix_send (vm, frm, f, b0, silm->max_sessions_template_id);
       silm->max_sessions_frame = 0;
       silm->max_sessions_buffer = 0;
       offset = 0;
@@ -1039,7 +1193,7 @@ nat_ipfix_logging_max_bib (u32 limit, int do_flush)
     }
 
   if (PREDICT_FALSE (offset == 0))
-    snat_ipfix_header_create (frm, b0, &offset);
+    snat_ipfix_header_create (vm, frm, b0, &offset);
 
   if (PREDICT_TRUE (do_flush == 0))
     {
@@ -1062,7 +1216,7 @@ nat_ipfix_logging_max_bib (u32 limit, int do_flush)
   if (PREDICT_FALSE
       (do_flush || (offset + MAX_BIBS_LEN) > frm->path_mtu))
     {
-      snat_ipfix_send (frm, f, b0, silm->max_bibs_template_id);
+      snat_ipfix_send (vm, frm, f, b0, silm->max_bibs_template_id);
       silm->max_bibs_frame = 0;
       silm->max_bibs_buffer = 0;
       offset = 0;
@@ -1129,7 +1283,7 @@ nat_ipfix_logging_max_frag_ip4 (u32 limit, u32 src, int do_flush)
     }
 
   if (PREDICT_FALSE (offset == 0))
-    snat_ipfix_header_create (frm, b0, &offset);
+    snat_ipfix_header_create (vm, frm, b0, &offset);
 
   if (PREDICT_TRUE (do_flush == 0))
     {
@@ -1155,7 +1309,7 @@ nat_ipfix_logging_max_frag_ip4 (u32 limit, u32 src, int do_flush)
   if (PREDICT_FALSE
       (do_flush || (offset + MAX_BIBS_LEN) > frm->path_mtu))
     {
-      snat_ipfix_send (frm, f, b0, silm->max_frags_ip4_template_id);
+      snat_ipfix_send (vm, frm, f, b0, silm->max_frags_ip4_template_id);
       silm->max_frags_ip4_frame = 0;
       silm->max_frags_ip4_buffer = 0;
       offset = 0;
@@ -1222,7 +1376,7 @@ nat_ipfix_logging_max_frag_ip6 (u32 limit, ip6_address_t * src, int do_flush)
     }
 
   if (PREDICT_FALSE (offset == 0))
-    snat_ipfix_header_create (frm, b0, &offset);
+    snat_ipfix_header_create (vm, frm, b0, &offset);
 
   if (PREDICT_TRUE (do_flush == 0))
     {
@@ -1248,7 +1402,7 @@ nat_ipfix_logging_max_frag_ip6 (u32 limit, ip6_address_t * src, int do_flush)
   if (PREDICT_FALSE
       (do_flush || (offset + MAX_BIBS_LEN) > frm->path_mtu))
     {
-      snat_ipfix_send (frm, f, b0, silm->max_frags_ip6_template_id);
+      snat_ipfix_send (vm, frm, f, b0, silm->max_frags_ip6_template_id);
       silm->max_frags_ip6_frame = 0;
       silm->max_frags_ip6_buffer = 0;
       offset = 0;
@@ -1257,65 +1411,41 @@ nat_ipfix_logging_max_frag_ip6 (u32 limit, ip6_address_t * src, int do_flush)
 }
 
 static void
-nat_ipfix_logging_nat64_bibe (u8 nat_event, ip6_address_t * src_ip,
-                              u32 nat_src_ip, u8 proto, u16 src_port,
-                              u16 nat_src_port, u32 vrf_id, int do_flush)
+nat_ipfix_logging_nat64_bibe (vlib_main_t * vm, u8 nat_event,
+                              ip6_address_t * src_ip, u32 nat_src_ip,
+                              u8 proto, u16 src_port, u16 nat_src_port,
+                              u32 vrf_id, int do_flush)
 {
   snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
   flow_report_main_t *frm = &flow_report_main;
-  vlib_frame_t *f;
+  nat_ipfix_per_thread_data_t *ptd;
   vlib_buffer_t *b0 = 0;
-  u32 bi0 = ~0;
   u32 offset;
-  vlib_main_t *vm = frm->vlib_main;
   u64 now;
-  vlib_buffer_free_list_t *fl;
 
   if (!silm->enabled)
     return;
 
+  ptd = vec_elt_at_index (silm->per_thread_data, vm->thread_index);
+
   now = (u64) ((vlib_time_now (vm) - silm->vlib_time_0) * 1e3);
   now += silm->milisecond_time_0;
 
-  b0 = silm->nat64_bib_buffer;
+  b0 = ptd->nat64_bib_buffer;
+  offset = ptd->nat64_bib_next_record_offset;
 
   if (PREDICT_FALSE (b0 == 0))
     {
       if (do_flush)
 	return;
 
-      if (vlib_buffer_alloc (vm, &bi0, 1) != 1)
-	{
-	  clib_warning ("can't allocate buffer for NAT IPFIX event");
-	  return;
-	}
-
-      b0 = silm->nat64_bib_buffer = vlib_get_buffer (vm, bi0);
-      fl =
-	vlib_buffer_get_free_list (vm, VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
-      vlib_buffer_init_for_free_list (b0, fl);
-      VLIB_BUFFER_TRACE_TRAJECTORY_INIT (b0);
-      offset = 0;
-    }
-  else
-    {
-      bi0 = vlib_get_buffer_index (vm, b0);
-      offset = silm->nat64_bib_next_record_offset;
-    }
-
-  f = silm->nat64_bib_frame;
-  if (PREDICT_FALSE (f == 0))
-    {
-      u32 *to_next;
-      f = vlib_get_frame_to_node (vm, ip4_lookup_node.index);
-      silm->nat64_bib_frame = f;
-      to_next = vlib_frame_vector_args (f);
-      to_next[0] = bi0;
-      f->n_vectors = 1;
+      b0 = nat_ipfix_get_buffer (vm, ptd, &ptd->nat64_bib_buffer, &offset);
+      if (!b0)
+	return;
     }
 
   if (PREDICT_FALSE (offset == 0))
-    snat_ipfix_header_create (frm, b0, &offset);
+    snat_ipfix_header_create (vm, frm, b0, &offset);
 
   if (PREDICT_TRUE (do_flush == 0))
     {
@@ -1345,81 +1475,58 @@ nat_ipfix_logging_nat64_bibe (u8 nat_event, ip6_address_t * src_ip,
       offset += sizeof (vrf_id);
 
       b0->current_length += NAT64_BIB_LEN;
+      ptd->n_events++;
     }
 
   if (PREDICT_FALSE
       (do_flush || (offset + NAT64_BIB_LEN) > frm->path_mtu))
     {
-      snat_ipfix_send (frm, f, b0, silm->nat64_bib_template_id);
-      silm->nat64_bib_frame = 0;
-      silm->nat64_bib_buffer = 0;
+      snat_ipfix_fixup (vm, frm, b0, silm->nat64_bib_template_id);
+      nat_ipfix_enqueue (vm, ptd, b0);
+      ptd->nat64_bib_buffer = 0;
       offset = 0;
     }
-  silm->nat64_bib_next_record_offset = offset;
+  ptd->nat64_bib_next_record_offset = offset;
 }
 
 static void
-nat_ipfix_logging_nat64_ses (u8 nat_event, ip6_address_t * src_ip,
-                             u32 nat_src_ip, u8 proto, u16 src_port,
-                             u16 nat_src_port, ip6_address_t * dst_ip,
+nat_ipfix_logging_nat64_ses (vlib_main_t * vm, u8 nat_event,
+                             ip6_address_t * src_ip, u32 nat_src_ip,
+                             u8 proto, u16 src_port, u16 nat_src_port,
+                             ip6_address_t * dst_ip,
                              u32 nat_dst_ip, u16 dst_port, u16 nat_dst_port,
                              u32 vrf_id, int do_flush)
 {
   snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
   flow_report_main_t *frm = &flow_report_main;
-  vlib_frame_t *f;
+  nat_ipfix_per_thread_data_t *ptd;
   vlib_buffer_t *b0 = 0;
-  u32 bi0 = ~0;
   u32 offset;
-  vlib_main_t *vm = frm->vlib_main;
   u64 now;
-  vlib_buffer_free_list_t *fl;
 
   if (!silm->enabled)
     return;
 
+  ptd = vec_elt_at_index (silm->per_thread_data, vm->thread_index);
+
   now = (u64) ((vlib_time_now (vm) - silm->vlib_time_0) * 1e3);
   now += silm->milisecond_time_0;
 
-  b0 = silm->nat64_ses_buffer;
+  b0 = ptd->nat64_ses_buffer;
+  offset = ptd->nat64_ses_next_record_offset;
 
   if (PREDICT_FALSE (b0 == 0))
     {
       if (do_flush)
 	return;
 
-      if (vlib_buffer_alloc (vm, &bi0, 1) != 1)
-	{
-	  clib_warning ("can't allocate buffer for NAT IPFIX event");
-	  return;
-	}
-
-      b0 = silm->nat64_ses_buffer = vlib_get_buffer (vm, bi0);
-      fl =
-	vlib_buffer_get_free_list (vm, VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
-      vlib_buffer_init_for_free_list (b0, fl);
-      VLIB_BUFFER_TRACE_TRAJECTORY_INIT (b0);
-      offset = 0;
-    }
-  else
-    {
-      bi0 = vlib_get_buffer_index (vm, b0);
-      offset = silm->nat64_ses_next_record_offset;
-    }
-
-  f = silm->nat64_ses_frame;
-  if (PREDICT_FALSE (f == 0))
-    {
-      u32 *to_next;
-      f = vlib_get_frame_to_node (vm, ip4_lookup_node.index);
-      silm->nat64_ses_frame = f;
-      to_next = vlib_frame_vector_args (f);
-      to_next[0] = bi0;
-      f->n_vectors = 1;
+      b0 = nat_ipfix_get_buffer (vm, ptd, &ptd->nat64_ses_buffer, &offset);
+      if (!b0)
+	return;
     }
 
   if (PREDICT_FALSE (offset == 0))
-    snat_ipfix_header_create (frm, b0, &offset);
+    snat_ipfix_header_create (vm, frm, b0, &offset);
 
   if (PREDICT_TRUE (do_flush == 0))
     {
@@ -1461,25 +1568,18 @@ nat_ipfix_logging_nat64_ses (u8 nat_event, ip6_address_t * src_ip,
       offset += sizeof (vrf_id);
 
       b0->current_length += NAT64_SES_LEN;
+      ptd->n_events++;
     }
 
   if (PREDICT_FALSE
       (do_flush || (offset + NAT64_SES_LEN) > frm->path_mtu))
     {
-      snat_ipfix_send (frm, f, b0, silm->nat64_ses_template_id);
-      silm->nat64_ses_frame = 0;
-      silm->nat64_ses_buffer = 0;
+      snat_ipfix_fixup (vm, frm, b0, silm->nat64_ses_template_id);
+      nat_ipfix_enqueue (vm, ptd, b0);
+      ptd->nat64_ses_buffer = 0;
       offset = 0;
     }
-  silm->nat64_ses_next_record_offset = offset;
-}
-
-static void
-snat_ipfix_logging_nat44_ses_rpc_cb (snat_ipfix_logging_nat44_ses_args_t * a)
-{
-  snat_ipfix_logging_nat44_ses (a->nat_event, a->src_ip, a->nat_src_ip,
-				a->snat_proto, a->src_port, a->nat_src_port,
-				a->vrf_id, 0);
+  ptd->nat64_ses_next_record_offset = offset;
 }
 
 /**
@@ -1499,20 +1599,11 @@ snat_ipfix_logging_nat44_ses_create (u32 src_ip,
 				     u16 src_port,
 				     u16 nat_src_port, u32 vrf_id)
 {
-  snat_ipfix_logging_nat44_ses_args_t a;
-
   skip_if_disabled ();
 
-  a.nat_event = NAT44_SESSION_CREATE;
-  a.src_ip = src_ip;
-  a.nat_src_ip = nat_src_ip;
-  a.snat_proto = snat_proto;
-  a.src_port = src_port;
-  a.nat_src_port = nat_src_port;
-  a.vrf_id = vrf_id;
-
-  vl_api_rpc_call_main_thread (snat_ipfix_logging_nat44_ses_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  snat_ipfix_logging_nat44_ses (vlib_get_main (), NAT44_SESSION_CREATE,
+				src_ip, nat_src_ip, snat_proto, src_port,
+				nat_src_port, vrf_id, 0);
 }
 
 /**
@@ -1532,20 +1623,11 @@ snat_ipfix_logging_nat44_ses_delete (u32 src_ip,
 				     u16 src_port,
 				     u16 nat_src_port, u32 vrf_id)
 {
-  snat_ipfix_logging_nat44_ses_args_t a;
-
   skip_if_disabled ();
 
-  a.nat_event = NAT44_SESSION_DELETE;
-  a.src_ip = src_ip;
-  a.nat_src_ip = nat_src_ip;
-  a.snat_proto = snat_proto;
-  a.src_port = src_port;
-  a.nat_src_port = nat_src_port;
-  a.vrf_id = vrf_id;
-
-  vl_api_rpc_call_main_thread (snat_ipfix_logging_nat44_ses_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  snat_ipfix_logging_nat44_ses (vlib_get_main (), NAT44_SESSION_DELETE,
+				src_ip, nat_src_ip, snat_proto, src_port,
+				nat_src_port, vrf_id, 0);
 }
 
 vlib_frame_t *
@@ -1554,7 +1636,7 @@ snat_data_callback_nat44_session (flow_report_main_t * frm,
 				  vlib_frame_t * f,
 				  u32 * to_next, u32 node_index)
 {
-  snat_ipfix_logging_nat44_ses (0, 0, 0, 0, 0, 0, 0, 1);
+  snat_ipfix_logging_nat44_ses (vlib_get_main (), 0, 0, 0, 0, 0, 0, 0, 1);
   return f;
 }
 
@@ -1780,17 +1862,6 @@ nat_data_callback_max_frags_ip6 (flow_report_main_t * frm,
   return f;
 }
 
-static void
-nat_ipfix_logging_nat64_bib_rpc_cb (nat_ipfix_logging_nat64_bib_args_t * a)
-{
-  ip6_address_t src_ip;
-  src_ip.as_u64[0] = a->src_ip[0];
-  src_ip.as_u64[1] = a->src_ip[1];
-  nat_ipfix_logging_nat64_bibe (a->nat_event, &src_ip, a->nat_src_ip,
-                                a->proto, a->src_port, a->nat_src_port,
-                                a->vrf_id, 0);
-}
-
 /**
  * @brief Generate NAT64 BIB create and delete events
  *
@@ -1808,21 +1879,12 @@ nat_ipfix_logging_nat64_bib (ip6_address_t * src_ip,
                              u16 src_port, u16 nat_src_port, u32 vrf_id,
                              u8 is_create)
 {
-  nat_ipfix_logging_nat64_bib_args_t a;
-
   skip_if_disabled ();
 
-  a.src_ip[0] = src_ip->as_u64[0];
-  a.src_ip[1] = src_ip->as_u64[1];
-  a.nat_src_ip = nat_src_ip->as_u32;
-  a.proto = proto;
-  a.src_port = src_port;
-  a.nat_src_port = nat_src_port;
-  a.vrf_id = vrf_id;
-  a.nat_event = is_create ? NAT64_BIB_CREATE : NAT64_BIB_DELETE;
-
-  vl_api_rpc_call_main_thread (nat_ipfix_logging_nat64_bib_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_logging_nat64_bibe (vlib_get_main (), is_create ?
+				NAT64_BIB_CREATE : NAT64_BIB_DELETE, src_ip,
+				nat_src_ip->as_u32, proto, src_port,
+				nat_src_port, vrf_id, 0);
 }
 
 vlib_frame_t *
@@ -1831,24 +1893,10 @@ nat_data_callback_nat64_bib (flow_report_main_t * frm,
 			     vlib_frame_t * f,
 			     u32 * to_next, u32 node_index)
 {
-  nat_ipfix_logging_nat64_bibe (0, 0, 0, 0, 0, 0, 0, 1);
+  nat_ipfix_logging_nat64_bibe (vlib_get_main (), 0, 0, 0, 0, 0, 0, 0, 1);
   return f;
 }
 
-static void
-nat_ipfix_logging_nat64_ses_rpc_cb (nat_ipfix_logging_nat64_ses_args_t * a)
-{
-  ip6_address_t src_ip, dst_ip;
-  src_ip.as_u64[0] = a->src_ip[0];
-  src_ip.as_u64[1] = a->src_ip[1];
-  dst_ip.as_u64[0] = a->dst_ip[0];
-  dst_ip.as_u64[1] = a->dst_ip[1];
-  nat_ipfix_logging_nat64_ses (a->nat_event, &src_ip, a->nat_src_ip,
-                               a->proto, a->src_port, a->nat_src_port,
-                               &dst_ip, a->nat_dst_ip, a->dst_port,
-                               a->nat_dst_port, a->vrf_id, 0);
-}
-
 /**
  * @brief Generate NAT64 session create and delete events
  *
@@ -1872,26 +1920,14 @@ nat_ipfix_logging_nat64_session (ip6_address_t * src_ip,
                                  ip4_address_t * nat_dst_ip, u16 dst_port,
                                  u16 nat_dst_port, u32 vrf_id, u8 is_create)
 {
-  nat_ipfix_logging_nat64_ses_args_t a;
-
   skip_if_disabled ();
 
-  a.src_ip[0] = src_ip->as_u64[0];
-  a.src_ip[1] = src_ip->as_u64[1];
-  a.nat_src_ip = nat_src_ip->as_u32;
-  a.proto = proto;
-  a.src_port = src_port;
-  a.nat_src_port = nat_src_port;
-  a.dst_ip[0] = dst_ip->as_u64[0];
-  a.dst_ip[1] = dst_ip->as_u64[1];
-  a.nat_dst_ip = nat_dst_ip->as_u32;
-  a.dst_port = dst_port;
-  a.nat_dst_port = nat_dst_port;
-  a.vrf_id = vrf_id;
-  a.nat_event = is_create ? NAT64_SESSION_CREATE : NAT64_SESSION_DELETE;
-
-  vl_api_rpc_call_main_thread (nat_ipfix_logging_nat64_ses_rpc_cb,
-			       (u8 *) & a, sizeof (a));
+  nat_ipfix_logging_nat64_ses (vlib_get_main (), is_create ?
+			       NAT64_SESSION_CREATE : NAT64_SESSION_DELETE,
+			       src_ip,
+			       nat_src_ip->as_u32, proto, src_port,
+			       nat_src_port, dst_ip, nat_dst_ip->as_u32,
+			       dst_port, nat_dst_port, vrf_id, 0);
 }
 
 vlib_frame_t *
@@ -1900,10 +1936,206 @@ nat_data_callback_nat64_session (flow_report_main_t * frm,
 			         vlib_frame_t * f,
 			         u32 * to_next, u32 node_index)
 {
-  nat_ipfix_logging_nat64_ses (0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1);
+  nat_ipfix_logging_nat64_ses (vlib_get_main (), 0, 0, 0, 0, 0, 0, 0, 0, 0,
+			       0, 0, 1);
   return f;
 }
 
+/**
+ * @brief Send the session events a thread has batched so far
+ *
+ * @param vm vlib main of the thread, the calling one unless the workers
+ *           are stopped at the barrier
+ */
+static void
+nat_ipfix_logging_flush_thread (vlib_main_t * vm)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  nat_ipfix_per_thread_data_t *ptd;
+
+  snat_ipfix_logging_nat44_ses (vm, 0, 0, 0, 0, 0, 0, 0, 1);
+  nat_ipfix_logging_nat64_bibe (vm, 0, 0, 0, 0, 0, 0, 0, 1);
+  nat_ipfix_logging_nat64_ses (vm, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1);
+
+  ptd = vec_elt_at_index (silm->per_thread_data, vm->thread_index);
+  nat_ipfix_put_frame (vm, ptd);
+}
+
+/**
+ * @brief Send the session events all threads have batched so far
+ *
+ * Called from the CLI or API with the workers stopped at the barrier.
+ */
+static void
+nat_ipfix_logging_flush_all (void)
+{
+  void *oldheap;
+
+  /* *INDENT-OFF* */
+  foreach_vlib_main (({
+    oldheap = clib_mem_set_heap (this_vlib_main->heap_base);
+    nat_ipfix_logging_flush_thread (this_vlib_main);
+    clib_mem_set_heap (oldheap);
+  }));
+  /* *INDENT-ON* */
+}
+
+/**
+ * @brief Per thread session event flush, interrupted by the flush process
+ */
+static uword
+nat_ipfix_logging_flush_worker_fn (vlib_main_t * vm,
+				   vlib_node_runtime_t * rt,
+				   vlib_frame_t * f)
+{
+  nat_ipfix_logging_flush_thread (vm);
+  return 0;
+}
+
+static vlib_node_registration_t nat_ipfix_logging_flush_worker_node;
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (nat_ipfix_logging_flush_worker_node, static) = {
+    .function = nat_ipfix_logging_flush_worker_fn,
+    .type = VLIB_NODE_TYPE_INPUT,
+    .state = VLIB_NODE_STATE_INTERRUPT,
+    .name = "nat-ipfix-logging-flush-worker",
+};
+/* *INDENT-ON* */
+
+/* Partially filled session event packets are sent at least this often */
+#define NAT_IPFIX_LOGGING_FLUSH_INTERVAL 1.0
+
+static vlib_node_registration_t nat_ipfix_logging_flush_node;
+
+/**
+ * @brief Centralized process to drive the per thread session event flush
+ */
+static uword
+nat_ipfix_logging_flush_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
+			    vlib_frame_t * f)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  vlib_main_t **worker_vms = 0, *worker_vm;
+  uword *event_data = 0;
+  int i;
+
+  if (vec_len (vlib_mains) == 0)
+    vec_add1 (worker_vms, vm);
+  else
+    {
+      for (i = 0; i < vec_len (vlib_mains); i++)
+	{
+	  worker_vm = vlib_mains[i];
+	  if (worker_vm)
+	    vec_add1 (worker_vms, worker_vm);
+	}
+    }
+
+  while (1)
+    {
+      if (silm->enabled)
+	vlib_process_wait_for_event_or_clock
+	  (vm, NAT_IPFIX_LOGGING_FLUSH_INTERVAL);
+      else
+	vlib_process_wait_for_event (vm);
+      vlib_process_get_events (vm, &event_data);
+      vec_reset_length (event_data);
+
+      for (i = 0; i < vec_len (worker_vms); i++)
+	{
+	  worker_vm = worker_vms[i];
+	  vlib_node_set_interrupt_pending (worker_vm,
+					   nat_ipfix_logging_flush_worker_node.
+					   index);
+	}
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (nat_ipfix_logging_flush_node, static) = {
+    .function = nat_ipfix_logging_flush_fn,
+    .type = VLIB_NODE_TYPE_PROCESS,
+    .name = "nat-ipfix-logging-flush",
+};
+/* *INDENT-ON* */
+
+/**
+ * @brief Set NAT44 session event logging format
+ *
+ * The events batched in the old format are sent first. Called with the
+ * workers stopped at the barrier.
+ *
+ * @param format      IPFIX records or syslog style messages
+ * @param syslog_port syslog collector port, 0 for the default
+ */
+void
+nat_ipfix_logging_set_session_format (nat_log_format_t format,
+				      u16 syslog_port)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  nat_ipfix_per_thread_data_t *ptd;
+  void *oldheap;
+  u32 bi;
+
+  if (format != silm->session_format)
+    {
+      if (silm->enabled)
+	nat_ipfix_logging_flush_all ();
+
+      /* *INDENT-OFF* */
+      foreach_vlib_main (({
+	ptd = vec_elt_at_index (silm->per_thread_data,
+				this_vlib_main->thread_index);
+	oldheap = clib_mem_set_heap (this_vlib_main->heap_base);
+	if (ptd->syslog_buffer)
+	  {
+	    bi = vlib_get_buffer_index (this_vlib_main, ptd->syslog_buffer);
+	    vlib_buffer_free (this_vlib_main, &bi, 1);
+	    ptd->syslog_buffer = 0;
+	    ptd->syslog_next_record_offset = 0;
+	  }
+	vec_free (ptd->syslog_msg);
+	clib_mem_set_heap (oldheap);
+      }));
+      /* *INDENT-ON* */
+    }
+
+  silm->session_format = format;
+  silm->syslog_port = syslog_port ? syslog_port : NAT_SYSLOG_PORT_DEFAULT;
+}
+
+u8 *
+format_nat_ipfix_logging (u8 * s, va_list * args)
+{
+  snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
+  nat_ipfix_per_thread_data_t *ptd;
+  u64 n_events = 0, n_packets = 0, n_drops = 0;
+
+  s = format (s, "NAT IPFIX logging %s, session events as %s",
+	      silm->enabled ? "enabled" : "disabled",
+	      silm->session_format == NAT_LOG_FORMAT_SYSLOG ?
+	      "syslog" : "ipfix");
+  if (silm->session_format == NAT_LOG_FORMAT_SYSLOG)
+    s = format (s, " to port %u", silm->syslog_port);
+
+  vec_foreach (ptd, silm->per_thread_data)
+  {
+    s = format (s, "\n  thread %u: %llu events, %llu packets, "
+		"%llu dropped", ptd - silm->per_thread_data, ptd->n_events,
+		ptd->n_packets, ptd->n_drops);
+    n_events += ptd->n_events;
+    n_packets += ptd->n_packets;
+    n_drops += ptd->n_drops;
+  }
+  s = format (s, "\n  total: %llu events, %llu packets, %llu dropped",
+	      n_events, n_packets, n_drops);
+
+  return s;
+}
+
 /**
  * @brief Enable/disable NAT plugin IPFIX logging
  *
@@ -1926,8 +2158,16 @@ snat_ipfix_logging_enable_disable (int enable, u32 domain_id, u16 src_port)
   if (silm->enabled == e)
     return 0;
 
+  /* Send the events batched so far, the flush skips them once disabled */
+  if (!e)
+    nat_ipfix_logging_flush_all ();
+
   silm->enabled = e;
 
+  /* Start or stop the periodic flush of per thread session events */
+  vlib_process_signal_event (sm->vlib_main,
+			     nat_ipfix_logging_flush_node.index, 0, 0);
+
   memset (&a, 0, sizeof (a));
   a.is_add = enable;
   a.domain_id = domain_id ? domain_id : 1;
@@ -2042,6 +2282,11 @@ snat_ipfix_logging_init (vlib_main_t * vm)
   snat_ipfix_logging_main_t *silm = &snat_ipfix_logging_main;
 
   silm->enabled = 0;
+  silm->session_format = NAT_LOG_FORMAT_IPFIX;
+  silm->syslog_port = NAT_SYSLOG_PORT_DEFAULT;
+  vec_validate_aligned (silm->per_thread_data,
+			vlib_get_thread_main ()->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
 
   /* Set up time reference pair */
   silm->vlib_time_0 = vlib_time_now (vm);
@@ -39,42 +39,77 @@ typedef enum {
   MAX_FRAGMENTS_PENDING_REASSEMBLY_IP6,
 } quota_exceed_event_t;
 
+typedef enum {
+  NAT_LOG_FORMAT_IPFIX = 0,
+  NAT_LOG_FORMAT_SYSLOG,
+} nat_log_format_t;
+
+#define NAT_SYSLOG_PORT_DEFAULT 514
+
+/** Session event logging state, per thread */
+typedef struct {
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /** ipfix buffers under construction */
+  vlib_buffer_t *nat44_session_buffer;
+  vlib_buffer_t *nat64_bib_buffer;
+  vlib_buffer_t *nat64_ses_buffer;
+  /** syslog buffer under construction */
+  vlib_buffer_t *syslog_buffer;
+
+  /** next record offset */
+  u32 nat44_session_next_record_offset;
+  u32 nat64_bib_next_record_offset;
+  u32 nat64_ses_next_record_offset;
+  u32 syslog_next_record_offset;
+
+  /** frame collecting finished buffers, put when full or flushed */
+  vlib_frame_t *frame;
+
+  /** syslog message scratch space */
+  u8 *syslog_msg;
+
+  /** counters */
+  u64 n_events;
+  u64 n_packets;
+  u64 n_drops;
+} nat_ipfix_per_thread_data_t;
+
 typedef struct {
   /** NAT plugin IPFIX logging enabled */
   u8 enabled;
 
+  /** NAT44 session event format, IPFIX or syslog */
+  u8 session_format;
+  /** syslog collector port, host byte order */
+  u16 syslog_port;
+
+  /** per thread session event logging */
+  nat_ipfix_per_thread_data_t *per_thread_data;
+
   /** ipfix buffers under construction */
-  vlib_buffer_t *nat44_session_buffer;
   vlib_buffer_t *addr_exhausted_buffer;
   vlib_buffer_t *max_entries_per_user_buffer;
   vlib_buffer_t *max_sessions_buffer;
   vlib_buffer_t *max_bibs_buffer;
   vlib_buffer_t *max_frags_ip4_buffer;
   vlib_buffer_t *max_frags_ip6_buffer;
-  vlib_buffer_t *nat64_bib_buffer;
-  vlib_buffer_t *nat64_ses_buffer;
 
   /** frames containing ipfix buffers */
-  vlib_frame_t *nat44_session_frame;
   vlib_frame_t *addr_exhausted_frame;
   vlib_frame_t *max_entries_per_user_frame;
   vlib_frame_t *max_sessions_frame;
   vlib_frame_t *max_bibs_frame;
   vlib_frame_t *max_frags_ip4_frame;
   vlib_frame_t *max_frags_ip6_frame;
-  vlib_frame_t *nat64_bib_frame;
-  vlib_frame_t *nat64_ses_frame;
 
   /** next record offset */
-  u32 nat44_session_next_record_offset;
   u32 addr_exhausted_next_record_offset;
   u32 max_entries_per_user_next_record_offset;
   u32 max_sessions_next_record_offset;
   u32 max_bibs_next_record_offset;
   u32 max_frags_ip4_next_record_offset;
   u32 max_frags_ip6_next_record_offset;
-  u32 nat64_bib_next_record_offset;
-  u32 nat64_ses_next_record_offset;
 
   /** Time reference pair */
   u64 milisecond_time_0;
@@ -99,6 +134,9 @@ extern snat_ipfix_logging_main_t snat_ipfix_logging_main;
 
 void snat_ipfix_logging_init (vlib_main_t * vm);
 int snat_ipfix_logging_enable_disable (int enable, u32 domain_id, u16 src_port);
+void nat_ipfix_logging_set_session_format (nat_log_format_t format,
+                                           u16 syslog_port);
+format_function_t format_nat_ipfix_logging;
 void snat_ipfix_logging_nat44_ses_create (u32 src_ip, u32 nat_src_ip,
                                           snat_protocol_t snat_proto,
                                           u16 src_port, u16 nat_src_port,
@@ -1312,6 +1312,7 @@ snat_out2in_node_fn (vlib_main_t * vm,
                                      ip4_header_t /* cheat */,
                                      length /* changed member */);
               tcp0->checksum = ip_csum_fold(sum0);
+              nat44_set_tcp_session_transitory (s0, tcp0, 0);
             }
           else
             {
@@ -1490,6 +1491,7 @@ snat_out2in_node_fn (vlib_main_t * vm,
                                      ip4_header_t /* cheat */,
                                      length /* changed member */);
               tcp1->checksum = ip_csum_fold(sum1);
+              nat44_set_tcp_session_transitory (s1, tcp1, 0);
             }
           else
             {
@@ -1704,6 +1706,7 @@ snat_out2in_node_fn (vlib_main_t * vm,
                                      ip4_header_t /* cheat */,
                                      length /* changed member */);
               tcp0->checksum = ip_csum_fold(sum0);
+              nat44_set_tcp_session_transitory (s0, tcp0, 0);
             }
           else
             {
@@ -2710,38 +2713,37 @@ out:
 /**********************/
 /*** worker handoff ***/
 /**********************/
+#define foreach_snat_out2in_worker_handoff_error   \
+_(CONGESTION_DROP, "congestion drop")
+
+typedef enum {
+#define _(sym,str) SNAT_OUT2IN_WORKER_HANDOFF_ERROR_##sym,
+  foreach_snat_out2in_worker_handoff_error
+#undef _
+  SNAT_OUT2IN_WORKER_HANDOFF_N_ERROR,
+} snat_out2in_worker_handoff_error_t;
+
+static char * snat_out2in_worker_handoff_error_strings[] = {
+#define _(sym,string) string,
+  foreach_snat_out2in_worker_handoff_error
+#undef _
+};
+
 static uword
 snat_out2in_worker_handoff_fn (vlib_main_t * vm,
                                vlib_node_runtime_t * node,
                                vlib_frame_t * frame)
 {
   snat_main_t *sm = &snat_main;
-  vlib_thread_main_t *tm = vlib_get_thread_main ();
-  u32 n_left_from, *from, *to_next = 0;
-  static __thread vlib_frame_queue_elt_t **handoff_queue_elt_by_worker_index;
-  static __thread vlib_frame_queue_t **congested_handoff_queue_by_worker_index
-    = 0;
-  vlib_frame_queue_elt_t *hf = 0;
-  vlib_frame_t *f = 0;
-  int i;
-  u32 n_left_to_next_worker = 0, *to_next_worker = 0;
-  u32 next_worker_index = 0;
-  u32 current_worker_index = ~0;
+  u32 n_left_from, *from, n_enq;
+  u16 thread_indices[VLIB_FRAME_SIZE], *ti;
   u32 thread_index = vlib_get_thread_index ();
 
   ASSERT (vec_len (sm->workers));
 
-  if (PREDICT_FALSE (handoff_queue_elt_by_worker_index == 0))
-    {
-      vec_validate (handoff_queue_elt_by_worker_index, tm->n_vlib_mains - 1);
-
-      vec_validate_init_empty (congested_handoff_queue_by_worker_index,
-			       sm->first_worker_index + sm->num_workers - 1,
-			       (vlib_frame_queue_t *) (~0));
-    }
-
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
+  ti = thread_indices;
 
   while (n_left_from > 0)
     {
@@ -2750,7 +2752,6 @@ snat_out2in_worker_handoff_fn (vlib_main_t * vm,
       u32 sw_if_index0;
       u32 rx_fib_index0;
       ip4_header_t * ip0;
-      u8 do_handoff;
 
       bi0 = from[0];
       from += 1;
@@ -2763,94 +2764,32 @@ snat_out2in_worker_handoff_fn (vlib_main_t * vm,
 
       ip0 = vlib_buffer_get_current (b0);
 
-      next_worker_index = sm->worker_out2in_cb(ip0, rx_fib_index0);
-
-      if (PREDICT_FALSE (next_worker_index != thread_index))
-        {
-          do_handoff = 1;
-
-          if (next_worker_index != current_worker_index)
-            {
-              if (hf)
-                hf->n_vectors = VLIB_FRAME_SIZE - n_left_to_next_worker;
-
-              hf = vlib_get_worker_handoff_queue_elt (sm->fq_out2in_index,
-                                                      next_worker_index,
-                                                      handoff_queue_elt_by_worker_index);
-
-              n_left_to_next_worker = VLIB_FRAME_SIZE - hf->n_vectors;
-              to_next_worker = &hf->buffer_index[hf->n_vectors];
-              current_worker_index = next_worker_index;
-            }
-
-          /* enqueue to correct worker thread */
-          to_next_worker[0] = bi0;
-          to_next_worker++;
-          n_left_to_next_worker--;
-
-          if (n_left_to_next_worker == 0)
-            {
-              hf->n_vectors = VLIB_FRAME_SIZE;
-              vlib_put_frame_queue_elt (hf);
-              current_worker_index = ~0;
-              handoff_queue_elt_by_worker_index[next_worker_index] = 0;
-              hf = 0;
-            }
-        }
-      else
-        {
-          do_handoff = 0;
-          /* if this is 1st frame */
-          if (!f)
-            {
-              f = vlib_get_frame_to_node (vm, sm->out2in_node_index);
-              to_next = vlib_frame_vector_args (f);
-            }
-
-          to_next[0] = bi0;
-          to_next += 1;
-          f->n_vectors++;
-        }
+      ti[0] = sm->worker_out2in_cb(ip0, rx_fib_index0);
 
       if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)
 			 && (b0->flags & VLIB_BUFFER_IS_TRACED)))
 	{
           snat_out2in_worker_handoff_trace_t *t =
             vlib_add_trace (vm, node, b0, sizeof (*t));
-          t->next_worker_index = next_worker_index;
-          t->do_handoff = do_handoff;
+          t->next_worker_index = ti[0];
+          t->do_handoff = ti[0] != thread_index;
         }
+
+      ti += 1;
     }
 
-  if (f)
-    vlib_put_frame_to_node (vm, sm->out2in_node_index, f);
+  n_enq = vlib_buffer_enqueue_to_thread (vm, sm->fq_out2in_index,
+                                         vlib_frame_vector_args (frame),
+                                         thread_indices, frame->n_vectors);
 
-  if (hf)
-    hf->n_vectors = VLIB_FRAME_SIZE - n_left_to_next_worker;
+  /* the congestion drops are left at the start of the frame */
+  if (n_enq < frame->n_vectors)
+    vlib_error_drop_buffers (vm, node, vlib_frame_vector_args (frame),
+                             /* buffer stride */ 1,
+                             frame->n_vectors - n_enq,
+                             /* next index */ 0, node->node_index,
+                             SNAT_OUT2IN_WORKER_HANDOFF_ERROR_CONGESTION_DROP);
 
-  /* Ship frames to the worker nodes */
-  for (i = 0; i < vec_len (handoff_queue_elt_by_worker_index); i++)
-    {
-      if (handoff_queue_elt_by_worker_index[i])
-	{
-	  hf = handoff_queue_elt_by_worker_index[i];
-	  /*
-	   * It works better to let the handoff node
-	   * rate-adapt, always ship the handoff queue element.
-	   */
-	  if (1 || hf->n_vectors == hf->last_n_vectors)
-	    {
-	      vlib_put_frame_queue_elt (hf);
-	      handoff_queue_elt_by_worker_index[i] = 0;
-	    }
-	  else
-	    hf->last_n_vectors = hf->n_vectors;
-	}
-      congested_handoff_queue_by_worker_index[i] =
-	(vlib_frame_queue_t *) (~0);
-    }
-  hf = 0;
-  current_worker_index = ~0;
   return frame->n_vectors;
 }
 
@@ -2861,6 +2800,9 @@ VLIB_REGISTER_NODE (snat_out2in_worker_handoff_node) = {
   .format_trace = format_snat_out2in_worker_handoff_trace,
   .type = VLIB_NODE_TYPE_INTERNAL,
 
+  .n_errors = ARRAY_LEN (snat_out2in_worker_handoff_error_strings),
+  .error_strings = snat_out2in_worker_handoff_error_strings,
+
   .n_next_nodes = 1,
 
   .next_nodes = {
@@ -43,6 +43,8 @@
  * Allocate/free network buffers.
  */
 
+#include <pthread.h>
+
 #include <vlib/vlib.h>
 #include <vlib/unix/unix.h>
 
@@ -381,7 +383,7 @@ vlib_buffer_create_free_list_helper (vlib_main_t * vm,
   f->index = f - vm->buffer_free_list_pool;
   f->n_data_bytes = vlib_buffer_round_size (n_data_bytes);
   f->min_n_buffers_each_alloc = VLIB_FRAME_SIZE;
-  f->buffer_pool_index = 0;
+  f->buffer_pool_index = vm->buffer_pool_index;
   f->name = clib_mem_is_vec (name) ? name : format (0, "%s", name);
 
   /* Setup free buffer template. */
@@ -405,7 +407,9 @@ vlib_buffer_create_free_list_helper (vlib_main_t * vm,
 	      wf - wvm->buffer_free_list_pool);
       wf[0] = f[0];
       wf->buffers = 0;
+      wf->remote_buffers = 0;
       wf->n_alloc = 0;
+      wf->buffer_pool_index = wvm->buffer_pool_index;
     }
 
   return f->index;
@@ -428,13 +432,142 @@ vlib_buffer_create_free_list (vlib_main_t * vm, u32 n_data_bytes,
 					      name);
 }
 
+int
+vlib_buffer_pool_put_partial (vlib_buffer_pool_t * bp, u32 * buffers,
+			      u32 n_buffers)
+{
+  vlib_buffer_magazine_t *m, *e;
+  u32 mi, ei, n_room;
+
+  mi = vlib_buffer_magazine_pop (bp, &bp->full);
+  if (mi == ~0)
+    {
+      ei = vlib_buffer_magazine_pop (bp, &bp->empty);
+      if (ei == ~0)
+	return 0;
+      e = bp->magazines + ei;
+      clib_memcpy (e->buffers, buffers, n_buffers * sizeof (u32));
+      e->n_buffers = n_buffers;
+      vlib_buffer_magazine_push (bp, &bp->full, ei);
+      return 1;
+    }
+
+  m = bp->magazines + mi;
+  n_room = VLIB_BUFFER_MAGAZINE_SIZE - m->n_buffers;
+  if (n_buffers <= n_room)
+    {
+      clib_memcpy (m->buffers + m->n_buffers, buffers,
+		   n_buffers * sizeof (u32));
+      m->n_buffers += n_buffers;
+      vlib_buffer_magazine_push (bp, &bp->full, mi);
+      return 1;
+    }
+
+  ei = vlib_buffer_magazine_pop (bp, &bp->empty);
+  if (ei == ~0)
+    {
+      vlib_buffer_magazine_push (bp, &bp->full, mi);
+      return 0;
+    }
+
+  /* top up the magazine, the rest goes on top in a new one */
+  clib_memcpy (m->buffers + m->n_buffers, buffers, n_room * sizeof (u32));
+  m->n_buffers = VLIB_BUFFER_MAGAZINE_SIZE;
+  e = bp->magazines + ei;
+  clib_memcpy (e->buffers, buffers + n_room,
+	       (n_buffers - n_room) * sizeof (u32));
+  e->n_buffers = n_buffers - n_room;
+  vlib_buffer_magazine_push (bp, &bp->full, mi);
+  vlib_buffer_magazine_push (bp, &bp->full, ei);
+  return 1;
+}
+
+/* Hand a vector of buffers back to their pool, returns the number of
+   buffers handed back. The ones the pool had no room for are left at
+   the start of the vector. */
+static u32
+vlib_buffer_pool_put_vector (vlib_buffer_pool_t * bp, u32 * buffers)
+{
+  u32 n_buffers = vec_len (buffers), n_left = n_buffers;
+
+  while (n_left)
+    {
+      u32 n = clib_min (n_left, VLIB_BUFFER_MAGAZINE_SIZE);
+      if (!vlib_buffer_pool_put_buffers (bp, buffers + n_left - n, n))
+	break;
+      n_left -= n;
+    }
+
+  if (buffers)
+    _vec_len (buffers) = n_left;
+  return n_buffers - n_left;
+}
+
+/* Hand back the buffers of other pools staged on the free lists of this
+   thread, which did not fill a magazine yet. */
+void
+vlib_buffer_flush_remote_buffers (vlib_main_t * vm)
+{
+  vlib_buffer_free_list_t *f;
+  u32 i;
+
+  /* *INDENT-OFF* */
+  pool_foreach (f, vm->buffer_free_list_pool, ({
+    vec_foreach_index (i, f->remote_buffers)
+      if (vec_len (f->remote_buffers[i]))
+	f->n_alloc -=
+	  vlib_buffer_pool_put_vector (vlib_buffer_pool_get (i),
+				       f->remote_buffers[i]);
+  }));
+  /* *INDENT-ON* */
+}
+
 static void
 del_free_list (vlib_main_t * vm, vlib_buffer_free_list_t * f)
 {
   vlib_buffer_pool_t *bp = vlib_buffer_pool_get (f->buffer_pool_index);
-
-  vec_add_aligned (bp->buffers, f->buffers, vec_len (f->buffers),
-		   CLIB_CACHE_LINE_BYTES);
+  vlib_buffer_free_list_t *df = 0;
+  u32 i, n_lost = 0;
+
+  if (f->index != VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX)
+    df = vlib_buffer_get_free_list (vm, VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
+
+  /*
+   * Whatever the pools have no room for is left to the default free list
+   * of the thread, so no buffer is lost.
+   */
+  vlib_buffer_pool_put_vector (bp, f->buffers);
+  if (vec_len (f->buffers) && df)
+    {
+      for (i = 0; i < vec_len (f->buffers); i++)
+	vlib_buffer_init_for_free_list (vlib_get_buffer (vm, f->buffers[i]),
+					df);
+      vec_append_aligned (df->buffers, f->buffers, CLIB_CACHE_LINE_BYTES);
+      df->n_alloc += vec_len (f->buffers);
+    }
+  else
+    n_lost += vec_len (f->buffers);
+
+  vec_foreach_index (i, f->remote_buffers)
+  {
+    vlib_buffer_pool_put_vector (vlib_buffer_pool_get (i),
+				 f->remote_buffers[i]);
+    if (vec_len (f->remote_buffers[i]) && df)
+      {
+	vec_validate (df->remote_buffers, i);
+	vec_append_aligned (df->remote_buffers[i], f->remote_buffers[i],
+			    CLIB_CACHE_LINE_BYTES);
+      }
+    else
+      n_lost += vec_len (f->remote_buffers[i]);
+    vec_free (f->remote_buffers[i]);
+  }
+
+  if (n_lost)
+    clib_warning ("buffer free list %v deleted with %u buffers the pools "
+		  "had no room for", f->name, n_lost);
+
+  vec_free (f->remote_buffers);
   vec_free (f->name);
   vec_free (f->buffers);
 
@@ -469,20 +602,28 @@ vlib_buffer_delete_free_list_internal (vlib_main_t * vm,
     }
 }
 
-static_always_inline void *
-vlib_buffer_pool_get_buffer (vlib_buffer_pool_t * bp)
+/* Reserve up to n_buffers never used buffers, returns the first slot. */
+static_always_inline uword
+vlib_buffer_pool_reserve (vlib_buffer_pool_t * bp, uword n_buffers,
+			  uword * n_reserved)
 {
-  uword slot, page, addr;
+  uword old, new;
 
-  if (PREDICT_FALSE (bp->n_elts == bp->n_used))
+  do
     {
-      clib_spinlock_unlock (&bp->lock);
-      return 0;
+      old = bp->n_used;
+      new = clib_min (old + n_buffers, bp->n_elts);
     }
-  slot = bp->next_clear;
-  bp->bitmap = clib_bitmap_set (bp->bitmap, slot, 1);
-  bp->next_clear = clib_bitmap_next_clear (bp->bitmap, slot + 1);
-  bp->n_used++;
+  while (!__sync_bool_compare_and_swap (&bp->n_used, old, new));
+
+  *n_reserved = new - old;
+  return old;
+}
+
+static_always_inline void *
+vlib_buffer_pool_slot_to_buffer (vlib_buffer_pool_t * bp, uword slot)
+{
+  uword page, addr;
 
   page = slot / bp->buffers_per_page;
   slot -= page * bp->buffers_per_page;
@@ -502,41 +643,43 @@ vlib_buffer_fill_free_list_internal (vlib_main_t * vm,
   vlib_buffer_pool_t *bp = vlib_buffer_pool_get (fl->buffer_pool_index);
   int n;
   u32 *bi;
-  u32 n_alloc = 0;
+  uword slot, n_alloc, i;
 
   /* Already have enough free buffers on free list? */
   n = min_free_buffers - vec_len (fl->buffers);
   if (n <= 0)
     return min_free_buffers;
 
-  if (vec_len (bp->buffers) > 0)
+  /* Buffers handed back to the pool first, whole magazines at a time */
+  while (n > 0)
     {
-      int n_copy, n_left;
-      clib_spinlock_lock (&bp->lock);
-      n_copy = clib_min (vec_len (bp->buffers), n);
-      n_left = vec_len (bp->buffers) - n_copy;
-      vec_add_aligned (fl->buffers, bp->buffers + n_left, n_copy,
-		       CLIB_CACHE_LINE_BYTES);
-      _vec_len (bp->buffers) = n_left;
-      clib_spinlock_unlock (&bp->lock);
-      n = min_free_buffers - vec_len (fl->buffers);
-      if (n <= 0)
-	return min_free_buffers;
+      u32 len = vec_len (fl->buffers);
+      u32 n_got;
+
+      vec_validate_aligned (fl->buffers, len + VLIB_BUFFER_MAGAZINE_SIZE - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      n_got = vlib_buffer_pool_get_buffers (bp, fl->buffers + len);
+      _vec_len (fl->buffers) = len + n_got;
+      if (n_got == 0)
+	break;
+      fl->n_alloc += n_got;
+      n -= n_got;
     }
 
+  if (n <= 0)
+    return min_free_buffers;
+
   /* Always allocate round number of buffers. */
   n = round_pow2 (n, CLIB_CACHE_LINE_BYTES / sizeof (u32));
 
   /* Always allocate new buffers in reasonably large sized chunks. */
   n = clib_max (n, fl->min_n_buffers_each_alloc);
 
-  clib_spinlock_lock (&bp->lock);
-  while (n_alloc < n)
-    {
-      if ((b = vlib_buffer_pool_get_buffer (bp)) == 0)
-	goto done;
+  slot = vlib_buffer_pool_reserve (bp, n, &n_alloc);
 
-      n_alloc += 1;
+  for (i = 0; i < n_alloc; i++)
+    {
+      b = vlib_buffer_pool_slot_to_buffer (bp, slot + i);
 
       vec_add2_aligned (fl->buffers, bi, 1, CLIB_CACHE_LINE_BYTES);
       bi[0] = vlib_get_buffer_index (vm, b);
@@ -546,13 +689,12 @@ vlib_buffer_fill_free_list_internal (vlib_main_t * vm,
 
       memset (b, 0, sizeof (vlib_buffer_t));
       vlib_buffer_init_for_free_list (b, fl);
+      b->buffer_pool_index = fl->buffer_pool_index;
 
       if (fl->buffer_init_function)
 	fl->buffer_init_function (vm, fl, bi, 1);
     }
 
-done:
-  clib_spinlock_unlock (&bp->lock);
   fl->n_alloc += n_alloc;
   return n_alloc;
 }
@@ -909,6 +1051,7 @@ vlib_buffer_pool_create (vlib_main_t * vm, vlib_physmem_region_index_t pri,
   vlib_buffer_pool_t *p;
   uword start = pointer_to_uword (pr->mem);
   uword size = pr->size;
+  u32 i, n_magazines;
 
   if (bm->buffer_mem_size == 0)
     {
@@ -935,10 +1078,12 @@ vlib_buffer_pool_create (vlib_main_t * vm, vlib_physmem_region_index_t pri,
       clib_panic ("buffer memory size out of range!");
     }
 
-  vec_add2 (bm->buffer_pools, p, 1);
+  vec_add2_aligned (bm->buffer_pools, p, 1, CLIB_CACHE_LINE_BYTES);
   p->start = start;
   p->size = size;
   p->physmem_region = pri;
+  p->numa_node = pr->numa_node;
+  p->full.index = p->empty.index = ~0;
 
   if (buffer_size == 0)
     goto done;
@@ -948,12 +1093,89 @@ vlib_buffer_pool_create (vlib_main_t * vm, vlib_physmem_region_index_t pri,
   p->buffers_per_page = (1 << pr->log2_page_size) / p->buffer_size;
   p->n_elts = p->buffers_per_page * pr->n_pages;
   p->n_used = 0;
-  clib_spinlock_init (&p->lock);
+
+  /* enough magazines for all buffers, plus partially filled ones */
+  n_magazines = p->n_elts / VLIB_BUFFER_MAGAZINE_SIZE + 64;
+  p->magazines = clib_mem_alloc_aligned (n_magazines *
+					 sizeof (vlib_buffer_magazine_t),
+					 CLIB_CACHE_LINE_BYTES);
+  for (i = n_magazines; i > 0; i--)
+    vlib_buffer_magazine_push (p, &p->empty, i - 1);
 done:
   ASSERT (p - bm->buffer_pools < 256);
   return p - bm->buffer_pools;
 }
 
+static clib_error_t *
+vlib_buffer_region_alloc (vlib_main_t * vm, char *name, u8 numa_node,
+			  vlib_physmem_region_index_t * pri)
+{
+  clib_error_t *error;
+
+  error = vlib_physmem_region_alloc (vm, name, vlib_buffer_physmem_sz,
+				     numa_node, VLIB_PHYSMEM_F_SHARED |
+				     VLIB_PHYSMEM_F_HUGETLB, pri);
+  if (error == 0)
+    return 0;
+
+  clib_error_free (error);
+
+  return vlib_physmem_region_alloc (vm, name, vlib_buffer_physmem_sz,
+				    numa_node, VLIB_PHYSMEM_F_SHARED, pri);
+}
+
+/* Buffer pool for threads running on the given numa node, created on
+   first use. Falls back to the default pool. */
+u8
+vlib_buffer_pool_for_numa_node (vlib_main_t * vm, u8 numa_node)
+{
+  vlib_buffer_main_t *bm = &buffer_main;
+  vlib_physmem_region_index_t pri;
+  clib_error_t *error;
+  u8 *name;
+
+  if (bm->callbacks_registered || bm->numa_local_pools_disabled ||
+      vec_len (bm->buffer_pools) == 0 ||
+      numa_node == vlib_buffer_pool_get (0)->numa_node)
+    return 0;
+
+  vec_validate_init_empty (bm->buffer_pool_index_by_numa_node, numa_node,
+			   (u8) ~ 0);
+  if (bm->buffer_pool_index_by_numa_node[numa_node] != (u8) ~ 0)
+    return bm->buffer_pool_index_by_numa_node[numa_node];
+
+  name = format (0, "buffers-numa-%u%c", numa_node, 0);
+  error = vlib_buffer_region_alloc (vm, (char *) name, numa_node, &pri);
+  vec_free (name);
+
+  if (error)
+    {
+      clib_error_report (error);
+      bm->buffer_pool_index_by_numa_node[numa_node] = 0;
+      return 0;
+    }
+
+  bm->buffer_pool_index_by_numa_node[numa_node] =
+    vlib_buffer_pool_create (vm, pri, sizeof (vlib_buffer_t) +
+			     VLIB_BUFFER_DEFAULT_FREE_LIST_BYTES);
+  return bm->buffer_pool_index_by_numa_node[numa_node];
+}
+
+static u8 *
+format_vlib_buffer_pool (u8 * s, va_list * va)
+{
+  vlib_buffer_pool_t *bp = va_arg (*va, vlib_buffer_pool_t *);
+  vlib_buffer_main_t *bm = &buffer_main;
+
+  if (!bp)
+    return format (s, "%=7s%=7s%=12s%=12s%=12s",
+		   "Pool", "NUMA", "Size", "Buffers", "Untouched");
+
+  return format (s, "%7u%7u%12u%12u%12u", bp - bm->buffer_pools,
+		 bp->numa_node, bp->buffer_size, bp->n_elts,
+		 bp->n_elts - bp->n_used);
+}
+
 static u8 *
 format_vlib_buffer_free_list (u8 * s, va_list * va)
 {
@@ -983,10 +1205,20 @@ static clib_error_t *
 show_buffers (vlib_main_t * vm,
 	      unformat_input_t * input, vlib_cli_command_t * cmd)
 {
+  vlib_buffer_main_t *bm = &buffer_main;
   vlib_buffer_free_list_t *f;
+  vlib_buffer_pool_t *bp;
   vlib_main_t *curr_vm;
   u32 vm_index = 0;
 
+  if (!bm->callbacks_registered)
+    {
+      vlib_cli_output (vm, "%U", format_vlib_buffer_pool, 0);
+      vec_foreach (bp, bm->buffer_pools)
+	vlib_cli_output (vm, "%U", format_vlib_buffer_pool, bp);
+      vlib_cli_output (vm, "");
+    }
+
   vlib_cli_output (vm, "%U", format_vlib_buffer_free_list, 0, 0);
 
   do
@@ -1014,6 +1246,188 @@ VLIB_CLI_COMMAND (show_buffers_command, static) = {
 };
 /* *INDENT-ON* */
 
+typedef struct
+{
+  vlib_buffer_pool_t *bp;
+  u32 n_iterations;
+  volatile u32 *go;
+  u64 n_buffers;
+  u64 n_misses;
+  u64 n_put_retries;
+  f64 seconds;
+  pthread_t thread;
+} vlib_buffer_pool_test_thread_t;
+
+static void *
+vlib_buffer_pool_test_thread_fn (void *arg)
+{
+  vlib_buffer_pool_test_thread_t *t = arg;
+  u32 buffers[VLIB_BUFFER_MAGAZINE_SIZE];
+  u32 i, n;
+  f64 t0;
+
+  while (*t->go == 0)
+    CLIB_PAUSE ();
+
+  t0 = unix_time_now ();
+  for (i = 0; i < t->n_iterations; i++)
+    {
+      n = vlib_buffer_pool_get_buffers (t->bp, buffers);
+      if (n == 0)
+	{
+	  t->n_misses++;
+	  continue;
+	}
+      /* the magazine just emptied is there for them, unless another
+         thread raced for it, never drop the buffers */
+      while (!vlib_buffer_pool_put_buffers (t->bp, buffers, n))
+	{
+	  t->n_put_retries++;
+	  CLIB_PAUSE ();
+	}
+      t->n_buffers += n;
+    }
+  t->seconds = unix_time_now () - t0;
+  return 0;
+}
+
+static clib_error_t *
+test_buffer_pool (vlib_main_t * vm, unformat_input_t * input,
+		  vlib_cli_command_t * cmd)
+{
+  vlib_buffer_main_t *bm = &buffer_main;
+  vlib_buffer_pool_test_thread_t *threads = 0, *t;
+  vlib_buffer_free_list_t *fl;
+  vlib_buffer_pool_t *bp;
+  u32 max_threads = 4, n_iterations = 100000, pool_index = 0;
+  u32 *buffers = 0, n_buffers, n_threads, i;
+  volatile u32 go;
+  clib_error_t *error = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "threads %u", &max_threads))
+	;
+      else if (unformat (input, "iterations %u", &n_iterations))
+	;
+      else if (unformat (input, "pool %u", &pool_index))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (bm->callbacks_registered)
+    return clib_error_return (0, "buffers are managed externally");
+  if (pool_index >= vec_len (bm->buffer_pools))
+    return clib_error_return (0, "no such buffer pool");
+  if (max_threads == 0 || max_threads > 256)
+    return clib_error_return (0, "1 to 256 threads");
+
+  bp = vlib_buffer_pool_get (pool_index);
+  fl = vlib_buffer_get_free_list (vm, VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
+  if (fl->buffer_pool_index != pool_index)
+    return clib_error_return (0, "pool %u is not used by this thread",
+			      pool_index);
+
+  /* one magazine in flight per thread, handed to the pool up front */
+  n_buffers = max_threads * VLIB_BUFFER_MAGAZINE_SIZE;
+  vec_validate (buffers, n_buffers - 1);
+  if (vlib_buffer_alloc (vm, buffers, n_buffers) != n_buffers)
+    {
+      error = clib_error_return (0, "failed to allocate %u buffers",
+				 n_buffers);
+      goto done;
+    }
+  vlib_buffer_validate_alloc_free (vm, buffers, n_buffers,
+				   VLIB_BUFFER_KNOWN_ALLOCATED);
+  for (i = 0; i < n_buffers; i += VLIB_BUFFER_MAGAZINE_SIZE)
+    if (!vlib_buffer_pool_put_buffers (bp, buffers + i,
+				       VLIB_BUFFER_MAGAZINE_SIZE))
+      {
+	vlib_buffer_free (vm, buffers + i, n_buffers - i);
+	error = clib_error_return (0, "buffer pool out of magazines");
+	break;
+      }
+  fl->n_alloc -= i;
+  if (error)
+    goto done;
+
+  vlib_cli_output (vm, "%=10s%=16s%=16s%=12s", "threads", "Mbuffers/s",
+		   "per thread", "misses");
+
+  n_threads = 1;
+  while (1)
+    {
+      f64 seconds = 0;
+      u64 n_total = 0, n_misses = 0;
+
+      vec_validate (threads, n_threads - 1);
+      go = 0;
+      vec_foreach (t, threads)
+      {
+	memset (t, 0, sizeof (*t));
+	t->bp = bp;
+	t->n_iterations = n_iterations;
+	t->go = &go;
+	if (pthread_create (&t->thread, NULL,
+			    vlib_buffer_pool_test_thread_fn, t))
+	  {
+	    _vec_len (threads) = t - threads;
+	    error = clib_error_return_unix (0, "pthread_create");
+	    break;
+	  }
+      }
+
+      go = 1;
+      vec_foreach (t, threads)
+      {
+	pthread_join (t->thread, NULL);
+	seconds = clib_max (seconds, t->seconds);
+	n_total += t->n_buffers;
+	n_misses += t->n_misses + t->n_put_retries;
+      }
+
+      if (error)
+	goto done;
+
+      /* each buffer counts once for the alloc and once for the free */
+      vlib_cli_output (vm, "%10u%16.2f%16.2f%12llu", n_threads,
+		       2 * n_total / seconds * 1e-6,
+		       2 * n_total / seconds * 1e-6 / n_threads, n_misses);
+
+      if (n_threads == max_threads)
+	break;
+      n_threads = clib_min (n_threads << 1, max_threads);
+    }
+
+done:
+  vec_free (threads);
+  vec_free (buffers);
+  return error;
+}
+
+/*?
+ * Measure the rate at which threads exchange magazines of buffers with a
+ * buffer pool, for 1, 2, 4, ... up to the given number of threads, all
+ * hitting the same pool. Each iteration takes a magazine of buffers from
+ * the pool and hands it back. The benchmark threads are plain pthreads,
+ * running concurrently with the (stopped) vlib threads, so use at most as
+ * many threads as there are free cores for meaningful numbers. The misses
+ * count the gets which found no full magazine and the puts which had to
+ * wait for an empty one.
+ *
+ * @cliexpar
+ * @cliexcmd{test buffer-pool threads 8 iterations 1000000}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_buffer_pool_command, static) = {
+  .path = "test buffer-pool",
+  .short_help = "test buffer-pool [threads <n>] [iterations <n>] [pool <n>]",
+  .function = test_buffer_pool,
+};
+/* *INDENT-ON* */
+
 clib_error_t *
 vlib_buffer_main_init (struct vlib_main_t * vm)
 {
@@ -1039,20 +1453,8 @@ vlib_buffer_main_init (struct vlib_main_t * vm)
   clib_spinlock_init (&bm->buffer_known_hash_lockp);
 
   /* allocate default region */
-  error = vlib_physmem_region_alloc (vm, "buffers",
-				     vlib_buffer_physmem_sz, 0,
-				     VLIB_PHYSMEM_F_SHARED |
-				     VLIB_PHYSMEM_F_HUGETLB, &pri);
-
-  if (error == 0)
-    goto done;
-
-  clib_error_free (error);
+  error = vlib_buffer_region_alloc (vm, "buffers", 0, &pri);
 
-  error = vlib_physmem_region_alloc (vm, "buffers",
-				     vlib_buffer_physmem_sz, 0,
-				     VLIB_PHYSMEM_F_SHARED, &pri);
-done:
   if (error == 0)
     vlib_buffer_pool_create (vm, pri, sizeof (vlib_buffer_t) +
 			     VLIB_BUFFER_DEFAULT_FREE_LIST_BYTES);
@@ -1068,6 +1470,8 @@ vlib_buffers_configure (vlib_main_t * vm, unformat_input_t * input)
     {
       if (unformat (input, "memory-size-in-mb %d", &size_in_mb))
 	vlib_buffer_physmem_sz = size_in_mb << 20;
+      else if (unformat (input, "no-numa-local-pools"))
+	buffer_main.numa_local_pools_disabled = 1;
       else
 	return unformat_parse_error (input);
     }
@@ -361,6 +361,10 @@ typedef struct vlib_buffer_free_list_t
   /* index of buffer pool used to get / put buffers */
   u8 buffer_pool_index;
 
+  /* Per buffer pool vectors of freed buffers which belong to another
+     pool, handed back one magazine at a time. */
+  u32 **remote_buffers;
+
   /* Free list name. */
   u8 *name;
 
@@ -404,6 +408,30 @@ typedef struct
 
 extern vlib_buffer_callbacks_t *vlib_buffer_callbacks;
 
+/* Number of buffer indices in a magazine, one frame worth. Magazines are
+   the unit of exchange between per-thread free lists and buffer pools. */
+#define VLIB_BUFFER_MAGAZINE_SIZE 256
+
+typedef struct
+{
+  u32 next;
+  u32 n_buffers;
+  u32 buffers[VLIB_BUFFER_MAGAZINE_SIZE];
+} vlib_buffer_magazine_t;
+
+/* Head of a lock-free stack of magazines. The tag is bumped on every
+   update so that a compare and swap can't be fooled by a magazine which
+   was popped and pushed back in the meantime (ABA). */
+typedef union
+{
+  struct
+  {
+    u32 index;
+    u32 tag;
+  };
+  u64 as_u64;
+} vlib_buffer_magazine_stack_t;
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -411,16 +439,25 @@ typedef struct
   uword size;
   uword log2_page_size;
   vlib_physmem_region_index_t physmem_region;
-
-  u32 *buffers;
+  u8 numa_node;
 
   u16 buffer_size;
   uword buffers_per_page;
   uword n_elts;
-  uword n_used;
-  uword next_clear;
-  uword *bitmap;
-  clib_spinlock_t lock;
+
+  /* Fixed set of magazines, each on either the full or the empty stack,
+     or owned by a thread while it moves buffers in or out. */
+  vlib_buffer_magazine_t *magazines;
+
+  /* Buffers at index n_used and above were never handed out. */
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  volatile uword n_used;
+
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline2);
+  volatile vlib_buffer_magazine_stack_t full;
+
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline3);
+  volatile vlib_buffer_magazine_stack_t empty;
 } vlib_buffer_pool_t;
 
 typedef struct
@@ -453,6 +490,10 @@ typedef struct
   /* Callbacks */
   vlib_buffer_callbacks_t cb;
   int callbacks_registered;
+
+  /* Buffer pool local to each numa node, ~0 if not created yet. */
+  u8 *buffer_pool_index_by_numa_node;
+  u8 numa_local_pools_disabled;
 } vlib_buffer_main_t;
 
 extern vlib_buffer_main_t buffer_main;
@@ -468,6 +509,8 @@ u8 vlib_buffer_pool_create (struct vlib_main_t * vm,
 			    vlib_physmem_region_index_t region,
 			    u16 buffer_size);
 
+u8 vlib_buffer_pool_for_numa_node (struct vlib_main_t *vm, u8 numa_node);
+
 clib_error_t *vlib_buffer_main_init (struct vlib_main_t *vm);
 
 typedef struct
@@ -1094,27 +1094,170 @@ vlib_buffer_init_for_free_list (vlib_buffer_t * dst,
   ASSERT (dst->n_add_refs == 0);
 }
 
+always_inline void
+vlib_buffer_magazine_push (vlib_buffer_pool_t * bp,
+			   volatile vlib_buffer_magazine_stack_t * s, u32 mi)
+{
+  vlib_buffer_magazine_stack_t old, new;
+
+  do
+    {
+      old.as_u64 = s->as_u64;
+      bp->magazines[mi].next = old.index;
+      new.index = mi;
+      new.tag = old.tag + 1;
+    }
+  while (!__sync_bool_compare_and_swap (&s->as_u64, old.as_u64, new.as_u64));
+}
+
+/* Returns ~0 if the stack is empty. Magazines are never freed, so reading
+   the next index of a magazine another thread just popped is harmless,
+   the tag makes the compare and swap fail. */
+always_inline u32
+vlib_buffer_magazine_pop (vlib_buffer_pool_t * bp,
+			  volatile vlib_buffer_magazine_stack_t * s)
+{
+  vlib_buffer_magazine_stack_t old, new;
+
+  do
+    {
+      old.as_u64 = s->as_u64;
+      if (old.index == ~0)
+	return ~0;
+      new.index = bp->magazines[old.index].next;
+      new.tag = old.tag + 1;
+    }
+  while (!__sync_bool_compare_and_swap (&s->as_u64, old.as_u64, new.as_u64));
+
+  return old.index;
+}
+
+int vlib_buffer_pool_put_partial (vlib_buffer_pool_t * bp, u32 * buffers,
+				  u32 n_buffers);
+
+/** \brief Hand free buffers back to a buffer pool
+
+    Less than a magazine worth of buffers is merged into the magazine on
+    top of the full stack, so that small puts don't use up the magazines.
+
+    @param bp - (vlib_buffer_pool_t *) buffer pool
+    @param buffers - (u32 * ) buffer indices
+    @param n_buffers - (u32) at most VLIB_BUFFER_MAGAZINE_SIZE
+    @return - (int) 0 if the pool has no magazine left for them, the
+    buffers then stay with the caller
+*/
+always_inline int
+vlib_buffer_pool_put_buffers (vlib_buffer_pool_t * bp, u32 * buffers,
+			      u32 n_buffers)
+{
+  vlib_buffer_magazine_t *m;
+  u32 mi;
+
+  ASSERT (n_buffers <= VLIB_BUFFER_MAGAZINE_SIZE);
+
+  if (PREDICT_FALSE (bp->magazines == 0))
+    return 0;
+
+  if (PREDICT_FALSE (n_buffers < VLIB_BUFFER_MAGAZINE_SIZE))
+    return vlib_buffer_pool_put_partial (bp, buffers, n_buffers);
+
+  mi = vlib_buffer_magazine_pop (bp, &bp->empty);
+  if (PREDICT_FALSE (mi == ~0))
+    return 0;
+
+  m = bp->magazines + mi;
+  clib_memcpy (m->buffers, buffers, n_buffers * sizeof (u32));
+  m->n_buffers = n_buffers;
+  vlib_buffer_magazine_push (bp, &bp->full, mi);
+  return 1;
+}
+
+/** \brief Take free buffers from a buffer pool
+
+    @param bp - (vlib_buffer_pool_t *) buffer pool
+    @param buffers - (u32 * ) room for VLIB_BUFFER_MAGAZINE_SIZE indices
+    @return - (u32) number of buffers taken, 0 if the pool has none
+*/
+always_inline u32
+vlib_buffer_pool_get_buffers (vlib_buffer_pool_t * bp, u32 * buffers)
+{
+  vlib_buffer_magazine_t *m;
+  u32 mi, n_buffers;
+
+  if (PREDICT_FALSE (bp->magazines == 0))
+    return 0;
+
+  mi = vlib_buffer_magazine_pop (bp, &bp->full);
+  if (mi == ~0)
+    return 0;
+
+  m = bp->magazines + mi;
+  n_buffers = m->n_buffers;
+  clib_memcpy (buffers, m->buffers, n_buffers * sizeof (u32));
+  vlib_buffer_magazine_push (bp, &bp->empty, mi);
+  return n_buffers;
+}
+
+/* Stage a buffer freed on a thread which uses another buffer pool, so
+   it returns to its own pool and numa node. The buffers handed back
+   are taken off n_alloc like the local ones, the free list which
+   allocated them counted them. Partial magazines are handed back by
+   vlib_buffer_flush_remote_buffers. */
+always_inline int
+vlib_buffer_add_to_remote_pool (vlib_buffer_free_list_t * f,
+				vlib_buffer_t * b, u32 buffer_index)
+{
+  vlib_buffer_pool_t *bp = vlib_buffer_pool_get (b->buffer_pool_index);
+  u32 *v;
+
+  /* not a pool of ours, e.g. an external buffer manager's */
+  if (bp->magazines == 0)
+    return 0;
+
+  vec_validate (f->remote_buffers, b->buffer_pool_index);
+  v = f->remote_buffers[b->buffer_pool_index];
+  vec_add1_aligned (v, buffer_index, CLIB_CACHE_LINE_BYTES);
+
+  if (vec_len (v) >= VLIB_BUFFER_MAGAZINE_SIZE
+      && vlib_buffer_pool_put_buffers (bp, v, VLIB_BUFFER_MAGAZINE_SIZE))
+    {
+      vec_delete (v, VLIB_BUFFER_MAGAZINE_SIZE, 0);
+      f->n_alloc -= VLIB_BUFFER_MAGAZINE_SIZE;
+    }
+
+  f->remote_buffers[b->buffer_pool_index] = v;
+  return 1;
+}
+
+void vlib_buffer_flush_remote_buffers (vlib_main_t * vm);
+
 always_inline void
 vlib_buffer_add_to_free_list (vlib_main_t * vm,
 			      vlib_buffer_free_list_t * f,
 			      u32 buffer_index, u8 do_init)
 {
-  vlib_buffer_pool_t *bp = vlib_buffer_pool_get (f->buffer_pool_index);
+  vlib_buffer_pool_t *bp;
   vlib_buffer_t *b;
   b = vlib_get_buffer (vm, buffer_index);
   if (PREDICT_TRUE (do_init))
     vlib_buffer_init_for_free_list (b, f);
+
+  if (PREDICT_FALSE (b->buffer_pool_index != f->buffer_pool_index)
+      && vlib_buffer_add_to_remote_pool (f, b, buffer_index))
+    return;
+
   vec_add1_aligned (f->buffers, buffer_index, CLIB_CACHE_LINE_BYTES);
 
   if (vec_len (f->buffers) > 4 * VLIB_FRAME_SIZE)
     {
-      clib_spinlock_lock (&bp->lock);
+      bp = vlib_buffer_pool_get (f->buffer_pool_index);
       /* keep last stored buffers, as they are more likely hot in the cache */
-      vec_add_aligned (bp->buffers, f->buffers, VLIB_FRAME_SIZE,
-		       CLIB_CACHE_LINE_BYTES);
-      vec_delete (f->buffers, VLIB_FRAME_SIZE, 0);
-      f->n_alloc -= VLIB_FRAME_SIZE;
-      clib_spinlock_unlock (&bp->lock);
+      if (vlib_buffer_pool_put_buffers (bp, f->buffers,
+					VLIB_BUFFER_MAGAZINE_SIZE))
+	{
+	  vec_delete (f->buffers, VLIB_BUFFER_MAGAZINE_SIZE, 0);
+	  f->n_alloc -= VLIB_BUFFER_MAGAZINE_SIZE;
+	}
     }
 }
 
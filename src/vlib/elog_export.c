@@ -0,0 +1,760 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Streaming event log export. While an export runs, threads log their
+ * events to per-thread rings (see elog_thread_rings_enable) instead of
+ * the shared event ring, and a background pthread drains the rings into
+ * files in the JSON trace event format, which Perfetto and
+ * chrome://tracing load. Each event log track, e.g. one per thread,
+ * becomes a named track, and node dispatch events, when compiled in with
+ * VLIB_ELOG_MAIN_LOOP, become slices named after the node.
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <vlib/vlib.h>
+#include <vlib/threads.h>
+
+#define ELOG_EXPORT_DEFAULT_RING_SIZE (64 << 10)
+#define ELOG_EXPORT_WRITE_BUFFER_SIZE (256 << 10)
+#define ELOG_EXPORT_READ_BATCH 256
+/* longest formatted event, strings are cut at ELOG_EXPORT_MAX_STRING */
+#define ELOG_EXPORT_MAX_EVENT_BYTES (16 << 10)
+#define ELOG_EXPORT_MAX_STRING 256
+
+typedef struct
+{
+  /* configuration, fixed while an export runs */
+  u8 *file_name;
+  u32 ring_size;
+  u64 max_file_size;
+  u32 max_files;
+
+  u8 is_running;
+
+  /* node index << 1 | is_return by event type, ~0 for other events */
+  u32 *node_by_event_type;
+  /* names, formatted up front for the writer thread */
+  u8 **node_names;
+  char process_name[64];
+  /* track of each thread, for reporting lost events */
+  u32 *track_by_thread;
+  int pid;
+  /* event time stamp to unix time in usec */
+  f64 usec_per_clock;
+  f64 usec_offset;
+
+  elog_main_t *elog_main;
+
+  /* writer thread state */
+  pthread_t writer_thread;
+  volatile u8 writer_stop;
+  int fd;
+  u32 file_index;
+  u64 file_bytes;
+  u32 n_file_events;
+  u32 n_tracks_named;
+  u64 *n_read_by_thread;
+  u64 *n_lost_by_thread;
+  u64 n_files;
+  u64 n_written;
+  u64 n_bytes_written;
+  u64 n_write_errors;
+  elog_event_t *read_buffer;
+  u8 *write_buffer;
+  u32 write_buffer_len;
+  char path[512];
+} elog_export_main_t;
+
+static elog_export_main_t elog_export_main = {.fd = -1 };
+
+/*
+ * Writer thread. It runs outside of vlib, so it must not touch the vlib
+ * heap: everything it needs is allocated by elog_export_start, and it
+ * formats with snprintf.
+ */
+
+static void
+elog_export_flush (elog_export_main_t * xm)
+{
+  u8 *p = xm->write_buffer;
+  u32 n_left = xm->write_buffer_len;
+
+  while (n_left && xm->fd >= 0)
+    {
+      ssize_t n = write (xm->fd, p, n_left);
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  xm->n_write_errors++;
+	  break;
+	}
+      p += n;
+      n_left -= n;
+      xm->n_bytes_written += n;
+    }
+  xm->write_buffer_len = 0;
+}
+
+/* an event is formatted in place, so all of it must fit before it starts */
+static void
+elog_export_reserve (elog_export_main_t * xm, u32 n_bytes)
+{
+  if (xm->write_buffer_len + n_bytes > ELOG_EXPORT_WRITE_BUFFER_SIZE)
+    elog_export_flush (xm);
+}
+
+static void
+elog_export_printf (elog_export_main_t * xm, char *fmt, ...)
+{
+  u32 n_left = ELOG_EXPORT_WRITE_BUFFER_SIZE - xm->write_buffer_len;
+  va_list va;
+  int n;
+
+  va_start (va, fmt);
+  n = vsnprintf ((char *) xm->write_buffer + xm->write_buffer_len, n_left,
+		 fmt, va);
+  va_end (va);
+
+  if (n < 0)
+    return;
+  n = clib_min (n, n_left - 1);
+  xm->write_buffer_len += n;
+  xm->file_bytes += n;
+}
+
+/* JSON string of at most n_max characters of s */
+static void
+elog_export_put_string (elog_export_main_t * xm, char *s, uword n_max)
+{
+  u8 *p = xm->write_buffer + xm->write_buffer_len, *start = p;
+  uword i;
+
+  n_max = clib_min (n_max, ELOG_EXPORT_MAX_STRING);
+  *p++ = '"';
+  for (i = 0; i < n_max && s[i]; i++)
+    {
+      u8 c = s[i];
+      if (c == '"' || c == '\\')
+	{
+	  *p++ = '\\';
+	  *p++ = c;
+	}
+      else if (c < 0x20)
+	p += sprintf ((char *) p, "\\u%04x", c);
+      else
+	*p++ = c;
+    }
+  *p++ = '"';
+
+  xm->write_buffer_len += p - start;
+  xm->file_bytes += p - start;
+}
+
+/* name the tracks up to n_tracks, the elog lock guards the track names */
+static void
+elog_export_put_tracks (elog_export_main_t * xm, u32 n_tracks)
+{
+  elog_main_t *em = xm->elog_main;
+  u32 i;
+
+  while (xm->n_tracks_named < n_tracks)
+    {
+      i = xm->n_tracks_named++;
+      elog_export_reserve (xm, ELOG_EXPORT_MAX_EVENT_BYTES);
+      elog_export_printf (xm, ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+			  "\"pid\":%d,\"tid\":%u,\"args\":{\"name\":",
+			  xm->pid, i);
+      elog_lock (em);
+      elog_export_put_string (xm, i < vec_len (em->tracks) ?
+			      em->tracks[i].name : "", ~0);
+      elog_unlock (em);
+      elog_export_printf (xm, "}}");
+    }
+}
+
+static void
+elog_export_open (elog_export_main_t * xm)
+{
+  elog_main_t *em = xm->elog_main;
+  u32 n_tracks;
+
+  if (xm->max_file_size)
+    snprintf (xm->path, sizeof (xm->path), "%s.%u",
+	      (char *) xm->file_name, xm->file_index);
+  else
+    snprintf (xm->path, sizeof (xm->path), "%s", (char *) xm->file_name);
+
+  xm->fd = open (xm->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (xm->fd < 0)
+    {
+      xm->n_write_errors++;
+      return;
+    }
+  xm->n_files++;
+  xm->file_bytes = 0;
+  xm->n_file_events = 0;
+  xm->n_tracks_named = 0;
+
+  /* each file is complete on its own, with all the track names */
+  elog_export_reserve (xm, ELOG_EXPORT_MAX_EVENT_BYTES);
+  elog_export_printf (xm, "[\n{\"name\":\"process_name\",\"ph\":\"M\","
+		      "\"pid\":%d,\"args\":{\"name\":", xm->pid);
+  elog_export_put_string (xm, xm->process_name, ~0);
+  elog_export_printf (xm, "}}");
+
+  elog_lock (em);
+  n_tracks = vec_len (em->tracks);
+  elog_unlock (em);
+  elog_export_put_tracks (xm, n_tracks);
+}
+
+/* the closing bracket is optional in the JSON array trace format, so a
+   file cut short by a crash still loads */
+static void
+elog_export_close (elog_export_main_t * xm)
+{
+  if (xm->fd >= 0)
+    {
+      elog_export_reserve (xm, 8);
+      elog_export_printf (xm, "\n]\n");
+    }
+  elog_export_flush (xm);
+  if (xm->fd >= 0)
+    close (xm->fd);
+  xm->fd = -1;
+}
+
+static void
+elog_export_put_args (elog_export_main_t * xm, elog_main_t * em,
+		      elog_event_type_t * t, elog_event_t * e)
+{
+  u8 *d = e->data, *end = e->data + sizeof (e->data);
+  char *a = t->format_args;
+  uword n_bytes, n_digits, i = 0;
+  u64 v;
+  f64 x;
+
+  while (a && a[0])
+    {
+      for (n_bytes = 0, n_digits = 0;
+	   n_digits < 2 && a[1 + n_digits] >= '0' && a[1 + n_digits] <= '9';
+	   n_digits++)
+	n_bytes = 10 * n_bytes + a[1 + n_digits] - '0';
+
+      if (n_digits == 0 || d + n_bytes > end)
+	break;
+
+      elog_export_printf (xm, "%s\"arg%u\":", i ? "," : "", i);
+      switch (a[0])
+	{
+	case 'i':
+	case 't':
+	case 'T':
+	  if (n_bytes == 1)
+	    v = d[0];
+	  else if (n_bytes == 2)
+	    v = clib_mem_unaligned (d, u16);
+	  else if (n_bytes == 4)
+	    v = clib_mem_unaligned (d, u32);
+	  else if (n_bytes == 8)
+	    v = clib_mem_unaligned (d, u64);
+	  else
+	    {
+	      elog_export_printf (xm, "null");
+	      return;
+	    }
+	  if (a[0] == 't' && v < vec_len (t->enum_strings_vector))
+	    elog_export_put_string (xm, t->enum_strings_vector[v], ~0);
+	  else if (a[0] == 'T' && v < vec_len (em->string_table))
+	    elog_export_put_string (xm, em->string_table + v,
+				    vec_len (em->string_table) - v);
+	  else
+	    elog_export_printf (xm, "%llu", v);
+	  break;
+
+	case 'f':
+	  if (n_bytes == 4)
+	    x = clib_mem_unaligned (d, f32);
+	  else if (n_bytes == 8)
+	    x = clib_mem_unaligned (d, f64);
+	  else
+	    {
+	      elog_export_printf (xm, "null");
+	      return;
+	    }
+	  /* JSON has no infinities or NaNs */
+	  if (isfinite (x))
+	    elog_export_printf (xm, "%.9g", x);
+	  else
+	    elog_export_printf (xm, "null");
+	  break;
+
+	case 's':
+	  elog_export_put_string (xm, (char *) d,
+				  n_bytes ? n_bytes : end - d);
+	  if (n_bytes == 0)
+	    n_bytes = strnlen ((char *) d, end - d) + 1;
+	  break;
+
+	default:
+	  elog_export_printf (xm, "null");
+	  return;
+	}
+
+      a += 1 + n_digits;
+      d += n_bytes;
+      i++;
+    }
+}
+
+static void
+elog_export_put_event (elog_export_main_t * xm, elog_event_t * e)
+{
+  elog_main_t *em = xm->elog_main;
+  f64 ts = xm->usec_offset + e->time_cycles * xm->usec_per_clock;
+  elog_event_type_t *t;
+  u32 node = ~0;
+
+  /* rotate before the event that could make the file too big */
+  if (xm->max_file_size && xm->n_file_events
+      && xm->file_bytes + ELOG_EXPORT_MAX_EVENT_BYTES > xm->max_file_size)
+    {
+      elog_export_close (xm);
+      xm->file_index++;
+      if (xm->max_files && xm->file_index >= xm->max_files)
+	xm->file_index = 0;
+      elog_export_open (xm);
+    }
+
+  if (xm->fd < 0)
+    return;
+
+  if (e->track >= xm->n_tracks_named)
+    elog_export_put_tracks (xm, e->track + 1);
+
+  elog_export_reserve (xm, ELOG_EXPORT_MAX_EVENT_BYTES);
+  xm->n_file_events++;
+  xm->n_written++;
+
+  if (e->type < vec_len (xm->node_by_event_type))
+    node = xm->node_by_event_type[e->type];
+
+  /* node dispatch: a slice from call to return, with the vector count */
+  if (node != ~0)
+    {
+      elog_export_printf (xm, ",\n{\"name\":");
+      elog_export_put_string (xm, (char *) xm->node_names[node >> 1], ~0);
+      elog_export_printf (xm, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,"
+			  "\"tid\":%u,\"args\":{\"vectors\":%u}}",
+			  (node & 1) ? 'E' : 'B', ts, xm->pid, e->track,
+			  clib_mem_unaligned (e->data, u32));
+      return;
+    }
+
+  /* the elog lock guards the event types and the string table */
+  elog_lock (em);
+  t = vec_elt_at_index (em->event_types, e->type);
+  elog_export_printf (xm, ",\n{\"name\":");
+  elog_export_put_string (xm, t->format, ~0);
+  elog_export_printf (xm, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+		      "\"pid\":%d,\"tid\":%u,\"args\":{",
+		      ts, xm->pid, e->track);
+  elog_export_put_args (xm, em, t, e);
+  elog_unlock (em);
+  elog_export_printf (xm, "}}");
+}
+
+static void
+elog_export_put_lost (elog_export_main_t * xm, u32 thread_index, u64 n_lost)
+{
+  f64 ts = xm->usec_offset + clib_cpu_time_now () * xm->usec_per_clock;
+
+  if (xm->fd < 0)
+    return;
+
+  elog_export_reserve (xm, ELOG_EXPORT_MAX_EVENT_BYTES);
+  elog_export_printf (xm, ",\n{\"name\":\"elog events lost\",\"ph\":\"i\","
+		      "\"s\":\"t\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u,"
+		      "\"args\":{\"thread\":%u,\"events\":%llu}}",
+		      ts, xm->pid, xm->track_by_thread[thread_index],
+		      thread_index, n_lost);
+}
+
+static uword
+elog_export_drain (elog_export_main_t * xm, int flush)
+{
+  elog_main_t *em = xm->elog_main;
+  uword thread_index, i, n, n_total = 0;
+  u64 n_lost;
+
+  for (thread_index = 0; thread_index < vec_len (em->thread_rings);
+       thread_index++)
+    {
+      do
+	{
+	  n_lost = 0;
+	  n = elog_thread_ring_read (em, thread_index, xm->read_buffer,
+				     ELOG_EXPORT_READ_BATCH, &n_lost, flush);
+	  if (n_lost)
+	    {
+	      xm->n_lost_by_thread[thread_index] += n_lost;
+	      elog_export_put_lost (xm, thread_index, n_lost);
+	    }
+	  for (i = 0; i < n; i++)
+	    elog_export_put_event (xm, xm->read_buffer + i);
+	  xm->n_read_by_thread[thread_index] += n;
+	  n_total += n;
+	}
+      while (n == ELOG_EXPORT_READ_BATCH);
+    }
+
+  return n_total;
+}
+
+static void *
+elog_export_writer_thread_fn (void *arg)
+{
+  elog_export_main_t *xm = arg;
+  struct timespec ts = {.tv_sec = 0,.tv_nsec = 1000000 };
+
+  while (!xm->writer_stop)
+    {
+      if (elog_export_drain (xm, 0 /* flush */ ) == 0)
+	{
+	  /* idle, make what we have visible and back off */
+	  elog_export_flush (xm);
+	  nanosleep (&ts, 0);
+	}
+    }
+
+  /* the threads no longer log to their rings, read all of it */
+  elog_export_drain (xm, 1 /* flush */ );
+  elog_export_close (xm);
+  return 0;
+}
+
+static void
+elog_export_free (elog_export_main_t * xm)
+{
+  u8 **name;
+
+  /* the per-thread counters stay around for show event-logger export */
+  if (xm->read_buffer)
+    clib_mem_free (xm->read_buffer);
+  xm->read_buffer = 0;
+  if (xm->write_buffer)
+    clib_mem_free (xm->write_buffer);
+  xm->write_buffer = 0;
+
+  vec_foreach (name, xm->node_names) vec_free (name[0]);
+  vec_free (xm->node_names);
+  vec_free (xm->node_by_event_type);
+  vec_free (xm->track_by_thread);
+}
+
+/* the event types of node dispatch events, when they are compiled in */
+static void
+elog_export_add_node_event_types (elog_export_main_t * xm, vlib_main_t * vm)
+{
+  elog_main_t *em = xm->elog_main;
+  elog_event_type_t *t;
+  u32 i, is_return;
+  word type_index;
+
+  for (i = 0; i < vec_len (vm->node_main.nodes); i++)
+    for (is_return = 0; is_return < 2; is_return++)
+      {
+	t = vec_elt_at_index (is_return ? vm->node_return_elog_event_types
+			      : vm->node_call_elog_event_types, i);
+	type_index = elog_event_type_register (em, t);
+	vec_validate_init_empty (xm->node_by_event_type, type_index, ~0);
+	xm->node_by_event_type[type_index] = i << 1 | is_return;
+      }
+}
+
+/*
+ * Start exporting to file_name, or to file_name.0, file_name.1, ... when
+ * max_file_size is set. The export owns file_name from here on, also when
+ * the start fails.
+ */
+static clib_error_t *
+elog_export_start (vlib_main_t * vm, u8 * file_name, u32 ring_size,
+		   u64 max_file_size, u32 max_files)
+{
+  elog_export_main_t *xm = &elog_export_main;
+  elog_main_t *em = &vm->elog_main;
+  vlib_worker_thread_t *w;
+  clib_error_t *error = 0;
+  u32 i, n_threads;
+  int rv;
+
+  if (xm->is_running)
+    {
+      vec_free (file_name);
+      return clib_error_return (0, "export already running");
+    }
+
+  vec_free (xm->file_name);
+  xm->file_name = file_name;
+  xm->ring_size = ring_size ? ring_size : ELOG_EXPORT_DEFAULT_RING_SIZE;
+  xm->max_file_size = max_file_size;
+  xm->max_files = max_files;
+  xm->elog_main = em;
+
+  if (vec_len (xm->file_name) == 0)
+    return clib_error_return (0, "file name required");
+  if (!is_pow2 (xm->ring_size))
+    return clib_error_return (0, "ring size must be a power of 2");
+  if (max_file_size && max_file_size < 2 * ELOG_EXPORT_MAX_EVENT_BYTES)
+    return clib_error_return (0, "max-file-size must be at least %uK",
+			      2 * ELOG_EXPORT_MAX_EVENT_BYTES >> 10);
+
+  /* names and tracks, the writer can't format */
+  for (i = 0; i < vec_len (vm->node_main.nodes); i++)
+    vec_add1 (xm->node_names, format (0, "%v%c",
+				      vm->node_main.nodes[i]->name, 0));
+  if (VLIB_ELOG_MAIN_LOOP)
+    elog_export_add_node_event_types (xm, vm);
+  snprintf (xm->process_name, sizeof (xm->process_name), "%s",
+	    vm->name ? vm->name : "vpp");
+
+  n_threads = vec_len (vlib_worker_threads);
+  vec_foreach (w, vlib_worker_threads)
+    vec_add1 (xm->track_by_thread, w->elog_track.track_index_plus_one ?
+	      w->elog_track.track_index_plus_one - 1 : 0);
+  vec_validate (xm->n_read_by_thread, n_threads - 1);
+  vec_validate (xm->n_lost_by_thread, n_threads - 1);
+  memset (xm->n_read_by_thread, 0, n_threads * sizeof (u64));
+  memset (xm->n_lost_by_thread, 0, n_threads * sizeof (u64));
+
+  xm->pid = getpid ();
+  xm->usec_per_clock = em->cpu_timer.seconds_per_clock * 1e6;
+  xm->usec_offset = unix_time_now () * 1e6
+    - clib_cpu_time_now () * xm->usec_per_clock;
+
+  xm->read_buffer = clib_mem_alloc (ELOG_EXPORT_READ_BATCH *
+				    sizeof (elog_event_t));
+  xm->write_buffer = clib_mem_alloc (ELOG_EXPORT_WRITE_BUFFER_SIZE);
+  xm->write_buffer_len = 0;
+  xm->file_index = 0;
+  xm->n_files = 0;
+  xm->n_written = 0;
+  xm->n_bytes_written = 0;
+  xm->n_write_errors = 0;
+
+  /* open the first file here, so that a bad path is reported */
+  elog_export_open (xm);
+  if (xm->fd < 0)
+    {
+      error = clib_error_return_unix (0, "open '%s'", xm->path);
+      goto done;
+    }
+
+  vlib_worker_thread_barrier_sync (vm);
+  elog_thread_rings_enable (em, n_threads, xm->ring_size);
+  vlib_worker_thread_barrier_release (vm);
+
+  xm->writer_stop = 0;
+  rv = pthread_create (&xm->writer_thread, NULL,
+		       elog_export_writer_thread_fn, xm);
+  if (rv)
+    {
+      vlib_worker_thread_barrier_sync (vm);
+      elog_thread_rings_disable (em);
+      vlib_worker_thread_barrier_release (vm);
+      elog_export_close (xm);
+      error = clib_error_return (0, "pthread_create returned %d", rv);
+      goto done;
+    }
+
+  xm->is_running = 1;
+
+done:
+  if (error)
+    elog_export_free (xm);
+  return error;
+}
+
+static clib_error_t *
+elog_export_stop (vlib_main_t * vm)
+{
+  elog_export_main_t *xm = &elog_export_main;
+
+  if (!xm->is_running)
+    return clib_error_return (0, "no export running");
+
+  /* back to the shared ring, the writer drains what is left */
+  vlib_worker_thread_barrier_sync (vm);
+  elog_thread_rings_disable (xm->elog_main);
+  vlib_worker_thread_barrier_release (vm);
+
+  xm->writer_stop = 1;
+  pthread_join (xm->writer_thread, NULL);
+
+  xm->is_running = 0;
+  elog_export_free (xm);
+  return 0;
+}
+
+static clib_error_t *
+elog_export_start_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  u32 ring_size = 0, max_files = 0, tmp;
+  u64 max_file_size = 0;
+  u8 *file_name = 0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, "file name required");
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "file %s", &file_name))
+	;
+      else if (unformat (line_input, "ring-size %u", &ring_size))
+	;
+      else if (unformat (line_input, "max-file-size %uM", &tmp))
+	max_file_size = (u64) tmp << 20;
+      else if (unformat (line_input, "max-file-size %uK", &tmp))
+	max_file_size = (u64) tmp << 10;
+      else if (unformat (line_input, "max-files %u", &max_files))
+	;
+      else
+	{
+	  clib_error_t *error = clib_error_return (0, "unknown input `%U'",
+						   format_unformat_error,
+						   line_input);
+	  vec_free (file_name);
+	  unformat_free (line_input);
+	  return error;
+	}
+    }
+  unformat_free (line_input);
+
+  if (file_name)
+    vec_add1 (file_name, 0);
+  return elog_export_start (vm, file_name, ring_size, max_file_size,
+			    max_files);
+}
+
+/*?
+ * Stream the event log to files in the JSON trace event format, which
+ * Perfetto (ui.perfetto.dev) and chrome://tracing load, for as long as
+ * the export runs. Each thread logs to its own ring of
+ * '<em>ring-size</em>' events (a power of 2, default 65536) while the
+ * export runs, and a background thread writes the rings out, so logging
+ * takes no shared lock or counter. Events a thread logs faster than the
+ * writer keeps up with are lost and reported as such in the file.
+ *
+ * Event log tracks, such as the per-thread tracks, become named tracks.
+ * Every event is an instant event named after its event type, with its
+ * data as arguments. Node dispatch events, which are only logged when
+ * built with VLIB_ELOG_MAIN_LOOP, become slices named after the node.
+ *
+ * With '<em>max-file-size</em>' the export rotates through files named
+ * <file>.0, <file>.1, ..., starting over at <file>.0 after
+ * '<em>max-files</em>' files, if set. Every file loads on its own.
+ *
+ * @cliexpar
+ * Keep the last gigabyte of events, in files of 100MB:
+ * @cliexcmd{event-logger export start file /tmp/elog.json max-file-size 100M max-files 10}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (elog_export_start_command, static) = {
+  .path = "event-logger export start",
+  .short_help = "event-logger export start file <file> [ring-size <n>] "
+    "[max-file-size <n>M|K] [max-files <n>]",
+  .function = elog_export_start_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+elog_export_stop_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  return elog_export_stop (vm);
+}
+
+/*?
+ * Stop the running event log export. The events left in the rings are
+ * written before the file is closed, and the threads log to the shared
+ * event ring again.
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (elog_export_stop_command, static) = {
+  .path = "event-logger export stop",
+  .short_help = "event-logger export stop",
+  .function = elog_export_stop_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_elog_export_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  elog_export_main_t *xm = &elog_export_main;
+  u32 i;
+
+  if (!xm->file_name)
+    {
+      vlib_cli_output (vm, "no export");
+      return 0;
+    }
+
+  vlib_cli_output (vm, "export %s, ring-size %u",
+		   xm->is_running ? "running" : "stopped", xm->ring_size);
+  vlib_cli_output (vm, "  %-10s%-20s%16s%16s", "thread", "name", "events",
+		   "lost");
+  for (i = 0; i < vec_len (xm->n_read_by_thread); i++)
+    vlib_cli_output (vm, "  %-10u%-20s%16llu%16llu", i,
+		     i < vec_len (vlib_worker_threads)
+		     && vlib_worker_threads[i].name ?
+		     (char *) vlib_worker_threads[i].name : "",
+		     xm->n_read_by_thread[i], xm->n_lost_by_thread[i]);
+
+  vlib_cli_output (vm, "  writer: %llu events, %llu bytes, %llu files, "
+		   "%llu write errors", xm->n_written, xm->n_bytes_written,
+		   xm->n_files, xm->n_write_errors);
+  vlib_cli_output (vm, "  file: %s", xm->path);
+  return 0;
+}
+
+/*?
+ * Show the state of the event log export, with the number of events
+ * read from each thread's ring and lost to ring overruns, and the writer
+ * statistics.
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_elog_export_command, static) = {
+  .path = "show event-logger export",
+  .short_help = "show event-logger export",
+  .function = show_elog_export_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
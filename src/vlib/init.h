@@ -54,8 +54,36 @@ typedef struct _vlib_init_function_list_elt
 {
   struct _vlib_init_function_list_elt *next_init_function;
   vlib_init_function_t *f;
+  char *name;
+
+  /* Explicit dependencies, by init function name. Unknown names
+     (e.g. functions in plugins which are not loaded) are ignored. */
+  char **runs_before;
+  char **runs_after;
 } _vlib_init_function_list_elt_t;
 
+#define VLIB_INITS(...)  (char*[]) { __VA_ARGS__, 0}
+
+/* Startup profile: one entry per init, config or main loop function call */
+typedef struct
+{
+  /* Function or config section name. */
+  char *name;
+
+  /* "init", "config", "main-loop-enter", ... */
+  char *kind;
+
+  /* Nesting depth of vlib_call_init_function () calls. */
+  u32 depth;
+
+  /* Longest chain of declared dependencies before this function,
+     ~0 if called from another init function. */
+  u32 dag_level;
+
+  /* Inclusive duration in seconds. */
+  f64 start, duration;
+} vlib_init_profile_t;
+
 /* Configuration functions: called with configuration input just before
    main polling loop starts. */
 typedef clib_error_t *(vlib_config_function_t) (struct vlib_main_t * vm,
@@ -113,20 +141,34 @@ typedef struct vlib_config_function_runtime_t
   _VLIB_INIT_FUNCTION_SYMBOL(x, config)
 
 /* Declaration is global (e.g. not static) so that init functions can
-   be called from other modules to resolve init function depend. */
+   be called from other modules to resolve init function depend.
+
+   The registration ends with the list element, so that dependencies
+   can be declared with an initializer:
+
+   VLIB_INIT_FUNCTION (foo_init) =
+   {
+     .runs_after = VLIB_INITS ("ip4_lookup_init"),
+   };  */
+
+#define _VLIB_INIT_FUNCTION_ELT(x, tag)				\
+  _vlib_init_function_##tag##_##x
 
 #define VLIB_DECLARE_INIT_FUNCTION(x, tag)                      \
 vlib_init_function_t * _VLIB_INIT_FUNCTION_SYMBOL (x, tag) = x; \
+static _vlib_init_function_list_elt_t				\
+  _VLIB_INIT_FUNCTION_ELT (x, tag);				\
 static void __vlib_add_##tag##_function_##x (void)              \
     __attribute__((__constructor__)) ;                          \
 static void __vlib_add_##tag##_function_##x (void)              \
 {                                                               \
  vlib_main_t * vm = vlib_get_main();                            \
- static _vlib_init_function_list_elt_t _vlib_init_function;     \
- _vlib_init_function.next_init_function                         \
+ _VLIB_INIT_FUNCTION_ELT (x, tag).next_init_function		\
     = vm->tag##_function_registrations;                         \
-  vm->tag##_function_registrations = &_vlib_init_function;      \
- _vlib_init_function.f = &x;                                    \
+  vm->tag##_function_registrations =				\
+    &_VLIB_INIT_FUNCTION_ELT (x, tag);				\
+ _VLIB_INIT_FUNCTION_ELT (x, tag).f = &x;			\
+ _VLIB_INIT_FUNCTION_ELT (x, tag).name = #x;			\
 }                                                               \
 static void __vlib_rm_##tag##_function_##x (void)               \
     __attribute__((__destructor__)) ;                           \
@@ -151,7 +193,9 @@ static void __vlib_rm_##tag##_function_##x (void)               \
         }                                                       \
       next = next->next_init_function;                          \
     }                                                           \
-}
+}                                                               \
+static __attribute__((unused)) _vlib_init_function_list_elt_t	\
+  _VLIB_INIT_FUNCTION_ELT (x, tag)
 
 #define VLIB_INIT_FUNCTION(x) VLIB_DECLARE_INIT_FUNCTION(x,init)
 #define VLIB_WORKER_INIT_FUNCTION(x) VLIB_DECLARE_INIT_FUNCTION(x,worker_init)
@@ -231,8 +275,10 @@ static void __vlib_rm_config_function_##x (void)                \
     clib_error_t * _error = 0;						\
     if (! hash_get (vm->init_functions_called, _f))			\
       {									\
+	u32 _p = vlib_init_profile_begin (vm, "init", #x);		\
 	hash_set1 (vm->init_functions_called, _f);			\
 	_error = _f (vm);						\
+	vlib_init_profile_end (vm, _p);					\
       }									\
     _error;								\
   })
@@ -268,13 +314,18 @@ static void __vlib_rm_config_function_##x (void)                \
     _r = &VLIB_CONFIG_FUNCTION_SYMBOL (x);			\
     if (! hash_get (vm->init_functions_called, _r->function))	\
       {								\
+	u32 _p = vlib_init_profile_begin (vm, "config", _r->name);	\
         hash_set1 (vm->init_functions_called, _r->function);	\
 	_error = _r->function (vm, &_r->input);			\
+	vlib_init_profile_end (vm, _p);				\
       }								\
     _error;							\
   })
 
 /* External functions. */
+u32 vlib_init_profile_begin (struct vlib_main_t *vm, char *kind, char *name);
+void vlib_init_profile_end (struct vlib_main_t *vm, u32 index);
+clib_error_t *vlib_init_profile_dump (struct vlib_main_t *vm);
 clib_error_t *vlib_call_all_init_functions (struct vlib_main_t *vm);
 clib_error_t *vlib_call_all_config_functions (struct vlib_main_t *vm,
 					      unformat_input_t * input,
@@ -386,7 +386,7 @@ vlib_get_next_frame_internal (vlib_main_t * vm,
 
   /* Allocate new frame if current one is already full. */
   n_used = f->n_vectors;
-  if (n_used >= VLIB_FRAME_SIZE || (allocate_new_next_frame && n_used > 0))
+  if (n_used >= vm->frame_size || (allocate_new_next_frame && n_used > 0))
     {
       /* Old frame may need to be freed after dispatch, since we'll have
          two redundant frames from node -> next node. */
@@ -403,7 +403,7 @@ vlib_get_next_frame_internal (vlib_main_t * vm,
     }
 
   /* Should have free vectors in frame now. */
-  ASSERT (n_used < VLIB_FRAME_SIZE);
+  ASSERT (n_used < vm->frame_size);
 
   if (CLIB_DEBUG > 0)
     {
@@ -429,8 +429,8 @@ vlib_put_next_frame_validate (vlib_main_t * vm,
   nf = vlib_node_runtime_get_next_frame (vm, rt, next_index);
   f = vlib_get_frame (vm, nf->frame_index);
 
-  ASSERT (n_vectors_left <= VLIB_FRAME_SIZE);
-  n_after = VLIB_FRAME_SIZE - n_vectors_left;
+  ASSERT (n_vectors_left <= vm->frame_size);
+  n_after = vm->frame_size - n_vectors_left;
   n_before = f->n_vectors;
 
   ASSERT (n_after >= n_before);
@@ -475,8 +475,8 @@ vlib_put_next_frame (vlib_main_t * vm,
     }
 
   /* Convert # of vectors left -> number of vectors there. */
-  ASSERT (n_vectors_left <= VLIB_FRAME_SIZE);
-  n_vectors_in_frame = VLIB_FRAME_SIZE - n_vectors_left;
+  ASSERT (n_vectors_left <= vm->frame_size);
+  n_vectors_in_frame = vm->frame_size - n_vectors_left;
 
   f->n_vectors = n_vectors_in_frame;
 
@@ -1494,6 +1494,11 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 	    vlib_frame_queue_dequeue (vm, fqm);
 	}
 
+      /* Ship handoff frames which are still waiting for more buffers. */
+      vec_foreach (fqm, tm->frame_queue_mains)
+	if (PREDICT_FALSE (fqm->per_thread_data[vm->thread_index].n_pending))
+	  vlib_frame_queue_flush (vm, fqm, cpu_time_now);
+
       /* Process pre-input nodes. */
       vec_foreach (n, nm->nodes_by_type[VLIB_NODE_TYPE_PRE_INPUT])
 	cpu_time_now = dispatch_node (vm, n,
@@ -1621,6 +1626,13 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
       if (is_main && _vec_len (nm->data_from_advancing_timing_wheel) > 0)
 	goto processes_timing_wheel_data;
 
+      /* Hand back the buffers of other pools which did not fill
+         a magazine, once per stats update. */
+      if (PREDICT_FALSE ((vm->main_loop_count &
+			  pow2_mask (VLIB_LOG2_MAIN_LOOPS_PER_STATS_UPDATE))
+			 == 0))
+	vlib_buffer_flush_remote_buffers (vm);
+
       vlib_increment_main_loop_counter (vm);
 
       /* Record time stamp in case there are no enabled nodes and above
@@ -1641,6 +1653,20 @@ vlib_worker_loop (vlib_main_t * vm)
   vlib_main_or_worker_loop (vm, /* is_main */ 0);
 }
 
+/* Wake up a thread sleeping in unix-epoll-input, see adaptive polling */
+void
+vlib_main_wakeup (vlib_main_t * vm)
+{
+  u64 one = 1;
+
+  if (vm->wakeup_fd == -1)
+    return;
+
+  vm->wakeup_cpu_time = clib_cpu_time_now ();
+  if (write (vm->wakeup_fd, &one, sizeof (one)) != sizeof (one))
+    clib_unix_warning ("wakeup write");
+}
+
 vlib_main_t vlib_global_main;
 
 static clib_error_t *
@@ -1658,6 +1684,16 @@ vlib_main_configure (vlib_main_t * vm, unformat_input_t * input)
 	;
       else if (unformat (input, "elog-post-mortem-dump"))
 	vm->elog_post_mortem_dump = 1;
+      else if (unformat (input, "startup-profile %s",
+			 &vm->init_profile_file))
+	;
+      else if (unformat (input, "frame-size %u", &vm->frame_size))
+	{
+	  if (vm->frame_size < 4 || vm->frame_size > VLIB_FRAME_SIZE)
+	    return clib_error_return (0, "frame-size must be between 4 and "
+				      "%u, the compiled in maximum",
+				      VLIB_FRAME_SIZE);
+	}
       else
 	return unformat_parse_error (input);
     }
@@ -1687,6 +1723,10 @@ vlib_main (vlib_main_t * volatile vm, unformat_input_t * input)
 
   vm->queue_signal_callback = dummy_queue_signal_callback;
 
+  if (vm->frame_size == 0)
+    vm->frame_size = VLIB_FRAME_SIZE;
+  vm->wakeup_fd = -1;
+
   clib_time_init (&vm->clib_time);
 
   /* Turn on event log. */
@@ -1784,6 +1824,9 @@ vlib_main (vlib_main_t * volatile vm, unformat_input_t * input)
     sub_error = vlib_call_all_main_loop_enter_functions (vm);
     if (sub_error)
       clib_error_report (sub_error);
+    sub_error = vlib_init_profile_dump (vm);
+    if (sub_error)
+      clib_error_report (sub_error);
   }
 
   vlib_main_loop (vm);
@@ -75,6 +75,9 @@ typedef struct vlib_main_t
   u32 main_loop_vectors_processed;
   u32 main_loop_nodes_processed;
 
+  /* Count of vectors processed by the previous main loop. */
+  u32 main_loop_vectors_last;
+
   /* Circular buffer of input node vector counts.
      Indexed by low bits of
      (main_loop_count >> VLIB_LOG2_INPUT_VECTORS_PER_MAIN_LOOP). */
@@ -104,9 +107,22 @@ typedef struct vlib_main_t
   void *heap_base;
   uword heap_size;
 
+  /* Max number of vectors per frame, at most VLIB_FRAME_SIZE. */
+  u32 frame_size;
+
+  /* Adaptive polling: set while the thread sleeps waiting for input.
+     Posting an interrupt or shipping a handoff frame to the thread
+     meanwhile writes wakeup_fd to wake it up. */
+  volatile u32 is_sleeping;
+  int wakeup_fd;
+  u64 wakeup_cpu_time;
+
   /* Pool of buffer free lists. */
   vlib_buffer_free_list_t *buffer_free_list_pool;
 
+  /* Buffer pool of this thread's free lists, local to its numa node. */
+  u8 buffer_pool_index;
+
   /* List of free-lists needing Blue Light Special announcements */
   vlib_buffer_free_list_t **buffer_announce_list;
 
@@ -172,6 +188,12 @@ typedef struct vlib_main_t
   /* Hash table to record which init functions have been called. */
   uword *init_functions_called;
 
+  /* Startup profile of init, config and main loop enter functions. */
+  vlib_init_profile_t *init_profile;
+  u32 init_profile_depth;
+  f64 init_profile_start, init_profile_main_loop;
+  u8 *init_profile_file;
+
   /* to compare with node runtime */
   u32 thread_index;
 
@@ -222,6 +244,7 @@ typedef struct vlib_main_t
 extern vlib_main_t vlib_global_main;
 
 void vlib_worker_loop (vlib_main_t * vm);
+void vlib_main_wakeup (vlib_main_t * vm);
 
 always_inline f64
 vlib_time_now (vlib_main_t * vm)
@@ -344,6 +367,7 @@ vlib_increment_main_loop_counter (vlib_main_t * vm)
 
   v += vm->main_loop_vectors_processed;
   n += vm->main_loop_nodes_processed;
+  vm->main_loop_vectors_last = vm->main_loop_vectors_processed;
   vm->main_loop_vectors_processed = 0;
   vm->main_loop_nodes_processed = 0;
   vm->vector_counts_per_main_loop[i] = v;
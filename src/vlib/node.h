@@ -43,6 +43,7 @@
 #include <vppinfra/cpu.h>
 #include <vppinfra/longjmp.h>
 #include <vppinfra/lock.h>
+#include <vlib/config.h>	/* for VLIB_FRAME_SIZE */
 #include <vlib/trace.h>		/* for vlib_trace_filter_t */
 
 /* Forward declaration. */
@@ -332,8 +333,10 @@ typedef struct vlib_node_t
 
 #define VLIB_INVALID_NODE_INDEX ((u32) ~0)
 
-/* Max number of vector elements to process at once per node. */
-#define VLIB_FRAME_SIZE 256
+/* VLIB_FRAME_SIZE, from <vlib/config.h>, is the max number of vector
+   elements to process at once per node, the capacity of frames and of
+   per-frame arrays. Set with configure --with-frame-size, the vlib
+   frame-size startup option lowers it. */
 #define VLIB_FRAME_ALIGN CLIB_CACHE_LINE_BYTES
 
 /* Calling frame (think stack frame) for a node. */
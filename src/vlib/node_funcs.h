@@ -201,6 +201,12 @@ vlib_node_set_interrupt_pending (vlib_main_t * vm, u32 node_index)
   clib_spinlock_lock_if_init (&nm->pending_interrupt_lock);
   vec_add1 (nm->pending_interrupt_node_runtime_indices, n->runtime_index);
   clib_spinlock_unlock_if_init (&nm->pending_interrupt_lock);
+
+  /* order the interrupt before the is_sleeping check, the sleeping
+     thread does the opposite before it goes to sleep */
+  CLIB_MEMORY_BARRIER ();
+  if (PREDICT_FALSE (vm->is_sleeping))
+    vlib_main_wakeup (vm);
 }
 
 always_inline vlib_process_t *
@@ -345,7 +351,7 @@ do {									\
 				    (alloc_new_frame));			\
   u32 _n = _f->n_vectors;						\
   (vectors) = vlib_frame_vector_args (_f) + _n * sizeof ((vectors)[0]); \
-  (n_vectors_left) = VLIB_FRAME_SIZE - _n;				\
+  (n_vectors_left) = (vm)->frame_size - _n;				\
 } while (0)
 
 
@@ -17,6 +17,7 @@
 #include <signal.h>
 #include <math.h>
 #include <vppinfra/format.h>
+#include <vppinfra/linux/sysfs.h>
 #include <vlib/vlib.h>
 
 #include <vlib/threads.h>
@@ -25,6 +26,7 @@
 DECLARE_CJ_GLOBAL_LOG;
 
 #define FRAME_QUEUE_NELTS 32
+#define FRAME_QUEUE_FLUSH_DEADLINE 10e-6
 
 u32
 vl (void *p)
@@ -710,6 +712,26 @@ vlib_launch_thread_int (void *fp, vlib_worker_thread_t * w, unsigned lcore_id)
     }
 }
 
+/* socket of a cpu, the numa node used for its buffers */
+static u8
+vlib_thread_lcore_socket (uword lcore)
+{
+  clib_error_t *error;
+  int socket_id = 0;
+  u8 *p;
+
+  p = format (0, "/sys/devices/system/cpu/cpu%u/topology/"
+	      "physical_package_id%c", lcore, 0);
+  error = clib_sysfs_read ((char *) p, "%d", &socket_id);
+  vec_free (p);
+  if (error)
+    {
+      clib_error_free (error);
+      return 0;
+    }
+  return socket_id < 0 ? 0 : socket_id;
+}
+
 static clib_error_t *
 start_workers (vlib_main_t * vm)
 {
@@ -785,6 +807,7 @@ start_workers (vlib_main_t * vm)
 	  vlib_node_main_t *nm, *nm_clone;
 	  vlib_buffer_free_list_t *fl_clone, *fl_orig;
 	  vlib_buffer_free_list_t *orig_freelist_pool;
+	  uword lcore;
 	  int k;
 
 	  tr = tm->registrations[i];
@@ -792,6 +815,10 @@ start_workers (vlib_main_t * vm)
 	  if (tr->count == 0)
 	    continue;
 
+	  /* workers are pinned to the cores of the coremask, in order */
+	  lcore = (tr->use_pthreads || tm->use_pthreads) ?
+	    ~0 : clib_bitmap_first_set (tr->coremask);
+
 	  for (k = 0; k < tr->count; k++)
 	    {
 	      vlib_node_t *n;
@@ -927,6 +954,16 @@ start_workers (vlib_main_t * vm)
 	      orig_freelist_pool = vm_clone->buffer_free_list_pool;
 	      vm_clone->buffer_free_list_pool = 0;
 
+	      /* Buffers come from the pool of the worker's numa node */
+	      vm_clone->buffer_pool_index = 0;
+	      if (lcore != ~0)
+		{
+		  vm_clone->buffer_pool_index =
+		    vlib_buffer_pool_for_numa_node
+		    (vm, vlib_thread_lcore_socket (lcore));
+		  lcore = clib_bitmap_next_set (tr->coremask, lcore + 1);
+		}
+
             /* *INDENT-OFF* */
             pool_foreach (fl_orig, orig_freelist_pool,
                           ({
@@ -937,7 +974,10 @@ start_workers (vlib_main_t * vm)
 
                             fl_clone[0] = fl_orig[0];
                             fl_clone->buffers = 0;
+                            fl_clone->remote_buffers = 0;
                             fl_clone->n_alloc = 0;
+                            fl_clone->buffer_pool_index =
+                              vm_clone->buffer_pool_index;
                           }));
 /* *INDENT-ON* */
 
@@ -1755,6 +1795,7 @@ vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts)
 {
   vlib_thread_main_t *tm = vlib_get_thread_main ();
   vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_per_thread_data_t *ptd;
   vlib_frame_queue_t *fq;
   int i;
 
@@ -1773,9 +1814,283 @@ vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts)
       vec_add1 (fqm->vlib_frame_queues, fq);
     }
 
+  vec_validate_aligned (fqm->per_thread_data, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vec_foreach (ptd, fqm->per_thread_data)
+  {
+    vec_validate (ptd->pending_by_thread_index, tm->n_vlib_mains - 1);
+    for (i = 0; i < tm->n_vlib_mains; i++)
+      {
+	vec_validate (ptd->pending_by_thread_index[i], VLIB_FRAME_SIZE - 1);
+	vec_reset_length (ptd->pending_by_thread_index[i]);
+      }
+    vec_validate (ptd->pending_since_by_thread_index, tm->n_vlib_mains - 1);
+    vec_validate (ptd->stats_by_thread_index, tm->n_vlib_mains - 1);
+  }
+
+  fqm->congestion = VLIB_FRAME_QUEUE_CONGESTION_BACKPRESSURE;
+  fqm->congestion_threshold = frame_queue_nelts - 1;
+  vlib_frame_queue_set_flush_deadline (fqm - tm->frame_queue_mains,
+				       FRAME_QUEUE_FLUSH_DEADLINE);
+
   return (fqm - tm->frame_queue_mains);
 }
 
+void
+vlib_frame_queue_set_congestion (u32 frame_queue_index,
+				 vlib_frame_queue_congestion_t congestion,
+				 u32 threshold)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+
+  fqm = vec_elt_at_index (tm->frame_queue_mains, frame_queue_index);
+  fqm->congestion = congestion;
+  if (threshold)
+    fqm->congestion_threshold = threshold;
+}
+
+/*
+ * How long a partially filled frame may wait for more buffers to the
+ * same thread before it is shipped anyway. Zero ships every frame at the
+ * end of each vlib_buffer_enqueue_to_thread call.
+ */
+void
+vlib_frame_queue_set_flush_deadline (u32 frame_queue_index, f64 deadline)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_main_t *vm = vlib_get_main ();
+  vlib_frame_queue_main_t *fqm;
+
+  fqm = vec_elt_at_index (tm->frame_queue_mains, frame_queue_index);
+  fqm->flush_deadline_clocks = deadline * vm->clib_time.clocks_per_second;
+}
+
+/*
+ * Ship the buffers pending for a thread in one frame queue element.
+ * With the tail drop congestion policy a full ring is never waited for,
+ * the buffers then stay pending and 0 is returned. They were counted as
+ * enqueued already, so they are never dropped here: the enqueue drops
+ * the new buffers for the thread while its pending frame is full.
+ */
+static int
+vlib_frame_queue_ship (vlib_main_t * vm, vlib_frame_queue_main_t * fqm,
+		       vlib_frame_queue_per_thread_data_t * ptd,
+		       u32 thread_index, int is_deadline)
+{
+  vlib_frame_queue_t *fq = fqm->vlib_frame_queues[thread_index];
+  vlib_frame_queue_stats_t *st = ptd->stats_by_thread_index + thread_index;
+  u32 *pending = ptd->pending_by_thread_index[thread_index];
+  u32 n_pending = vec_len (pending);
+  vlib_frame_queue_elt_t *elt;
+  u64 tail, occupancy;
+
+  tail = fq->tail;
+  occupancy = tail - fq->head_hint;
+
+  if (fqm->congestion == VLIB_FRAME_QUEUE_CONGESTION_TAIL_DROP)
+    {
+      /*
+       * Reserve a slot without ever waiting for the consumer. A slot
+       * still valid has not been dequeued yet, the ring is full then.
+       */
+      do
+	{
+	  tail = fq->tail;
+	  elt = fq->elts + ((tail + 1) & (fq->nelts - 1));
+	  if (tail + 1 >= fq->head_hint + fq->nelts || elt->valid)
+	    {
+	      fq->enqueue_full_events++;
+	      return 0;
+	    }
+	}
+      while (!__sync_bool_compare_and_swap (&fq->tail, tail, tail + 1));
+
+      elt->msg_type = VLIB_FRAME_QUEUE_ELT_DISPATCH_FRAME;
+    }
+  else
+    elt = vlib_get_frame_queue_elt (fqm - vlib_thread_main.frame_queue_mains,
+				    thread_index);
+
+  clib_memcpy (elt->buffer_index, pending, n_pending * sizeof (u32));
+  elt->n_vectors = elt->last_n_vectors = n_pending;
+  vlib_put_frame_queue_elt (elt);
+
+  /* order the frame before the is_sleeping check, the sleeping thread
+     does the opposite before it goes to sleep */
+  CLIB_MEMORY_BARRIER ();
+  if (PREDICT_FALSE (vlib_mains[thread_index]->is_sleeping))
+    vlib_main_wakeup (vlib_mains[thread_index]);
+
+  st->occupancy[clib_min (occupancy, FRAME_QUEUE_MAX_NELTS - 1)]++;
+  st->frames++;
+  st->deadline_flushes += is_deadline;
+
+  vec_reset_length (ptd->pending_by_thread_index[thread_index]);
+  ptd->n_pending--;
+  return 1;
+}
+
+/* Ship partially filled frames which waited past the flush deadline */
+void
+vlib_frame_queue_flush (vlib_main_t * vm, vlib_frame_queue_main_t * fqm,
+			u64 now)
+{
+  vlib_frame_queue_per_thread_data_t *ptd;
+  u32 i;
+
+  ptd = vec_elt_at_index (fqm->per_thread_data, vm->thread_index);
+
+  for (i = 0; ptd->n_pending && i < vec_len (ptd->pending_by_thread_index);
+       i++)
+    if (vec_len (ptd->pending_by_thread_index[i]) &&
+	now - ptd->pending_since_by_thread_index[i] >=
+	fqm->flush_deadline_clocks)
+      vlib_frame_queue_ship (vm, fqm, ptd, i, 1 /* is_deadline */ );
+}
+
+/*
+ * Ship all the partially filled frames of the calling thread, before it
+ * sleeps and the main loop no longer flushes them in time. Returns the
+ * number of target threads whose frames could not be shipped.
+ */
+u32
+vlib_frame_queue_flush_all (vlib_main_t * vm)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_per_thread_data_t *ptd;
+  u32 i, n_left = 0;
+
+  vec_foreach (fqm, tm->frame_queue_mains)
+  {
+    ptd = vec_elt_at_index (fqm->per_thread_data, vm->thread_index);
+    for (i = 0; ptd->n_pending && i < vec_len (ptd->pending_by_thread_index);
+	 i++)
+      if (vec_len (ptd->pending_by_thread_index[i]))
+	vlib_frame_queue_ship (vm, fqm, ptd, i, 1 /* is_deadline */ );
+    n_left += ptd->n_pending;
+  }
+  return n_left;
+}
+
+/* Whether a handoff frame waits to be dequeued by the calling thread */
+int
+vlib_frame_queue_is_pending (vlib_main_t * vm)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_t *fq;
+
+  vec_foreach (fqm, tm->frame_queue_mains)
+  {
+    fq = fqm->vlib_frame_queues[vm->thread_index];
+    if (fq->elts[(fq->head + 1) & (fq->nelts - 1)].valid)
+      return 1;
+  }
+  return 0;
+}
+
+/*
+ * Hand off buffers to the threads given in thread_indices. Buffers for
+ * the calling thread go straight to the frame queue's node, the others
+ * are coalesced into frames per target thread which are shipped once full
+ * or once the flush deadline passes. With the tail drop congestion policy
+ * the buffers to a congested thread are dropped: they are moved to the
+ * start of buffer_indices, for the caller to send to error-drop. Returns
+ * the number of buffers enqueued, buffer_indices[0 .. n_packets - n_enq)
+ * are the dropped ones.
+ */
+u32
+vlib_buffer_enqueue_to_thread (vlib_main_t * vm, u32 frame_queue_index,
+			       u32 * buffer_indices, u16 * thread_indices,
+			       u32 n_packets)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_per_thread_data_t *ptd;
+  vlib_frame_queue_stats_t *st = 0;
+  vlib_frame_t *f = 0;
+  u32 *to_local = 0, **pending;
+  u32 *drop = buffer_indices;
+  u32 current_thread_index = ~0;
+  u32 n_enqueued = 0, n_drop = 0;
+  int congested = 0;
+  u64 now = clib_cpu_time_now ();
+
+  fqm = vec_elt_at_index (tm->frame_queue_mains, frame_queue_index);
+  ptd = vec_elt_at_index (fqm->per_thread_data, vm->thread_index);
+
+  while (n_packets > 0)
+    {
+      u32 bi = buffer_indices[0];
+      u32 ti = thread_indices[0];
+
+      buffer_indices++;
+      thread_indices++;
+      n_packets--;
+
+      if (ti == vm->thread_index)
+	{
+	  if (f == 0 || f->n_vectors == vm->frame_size)
+	    {
+	      if (f)
+		vlib_put_frame_to_node (vm, fqm->node_index, f);
+	      f = vlib_get_frame_to_node (vm, fqm->node_index);
+	      to_local = vlib_frame_vector_args (f);
+	    }
+	  to_local[f->n_vectors++] = bi;
+	  n_enqueued++;
+	  continue;
+	}
+
+      if (ti != current_thread_index)
+	{
+	  vlib_frame_queue_t *fq = fqm->vlib_frame_queues[ti];
+
+	  current_thread_index = ti;
+	  st = ptd->stats_by_thread_index + ti;
+	  congested = (fqm->congestion ==
+		       VLIB_FRAME_QUEUE_CONGESTION_TAIL_DROP) &&
+	    (fq->tail >= fq->head_hint + fqm->congestion_threshold);
+	  if (PREDICT_FALSE (congested))
+	    fq->enqueue_full_events++;
+	}
+
+      pending = ptd->pending_by_thread_index + ti;
+
+      /* a full pending frame is one the ring had no room for */
+      if (PREDICT_FALSE (congested ||
+			 vec_len (pending[0]) >= vm->frame_size))
+	{
+	  /* never overwrites a buffer index not read yet */
+	  drop[n_drop++] = bi;
+	  st->congestion_drops++;
+	  continue;
+	}
+
+      if (vec_len (pending[0]) == 0)
+	{
+	  ptd->pending_since_by_thread_index[ti] = now;
+	  ptd->n_pending++;
+	}
+      vec_add1 (pending[0], bi);
+      st->buffers++;
+      n_enqueued++;
+
+      if (vec_len (pending[0]) >= vm->frame_size)
+	vlib_frame_queue_ship (vm, fqm, ptd, ti, 0 /* is_deadline */ );
+    }
+
+  if (f)
+    vlib_put_frame_to_node (vm, fqm->node_index, f);
+
+  if (ptd->n_pending)
+    vlib_frame_queue_flush (vm, fqm, now);
+
+  return n_enqueued;
+}
+
 int
 vlib_thread_cb_register (struct vlib_main_t *vm, vlib_thread_callbacks_t * cb)
 {
@@ -161,11 +161,53 @@ typedef struct
 }
 vlib_frame_queue_t;
 
+typedef enum
+{
+  /* Wait for the consumer to free a ring slot */
+  VLIB_FRAME_QUEUE_CONGESTION_BACKPRESSURE,
+  /* Drop buffers while the ring is above the congestion threshold */
+  VLIB_FRAME_QUEUE_CONGESTION_TAIL_DROP,
+} vlib_frame_queue_congestion_t;
+
+/* Handoff statistics of one producer thread towards one target thread */
+typedef struct
+{
+  u64 buffers;
+  u64 frames;
+  u64 deadline_flushes;
+  u64 congestion_drops;
+  /* ring occupancy seen when shipping a frame */
+  u64 occupancy[FRAME_QUEUE_MAX_NELTS];
+} vlib_frame_queue_stats_t;
+
+/* Producer side state, private to the handing off thread */
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /* Buffers not yet shipped, by target thread */
+  u32 **pending_by_thread_index;
+
+  /* cpu time the oldest pending buffer was queued, by target thread */
+  u64 *pending_since_by_thread_index;
+
+  /* Number of target threads with pending buffers */
+  u32 n_pending;
+
+  vlib_frame_queue_stats_t *stats_by_thread_index;
+} vlib_frame_queue_per_thread_data_t;
+
 typedef struct
 {
   u32 node_index;
   vlib_frame_queue_t **vlib_frame_queues;
 
+  /* for vlib_buffer_enqueue_to_thread */
+  vlib_frame_queue_per_thread_data_t *per_thread_data;
+  vlib_frame_queue_congestion_t congestion;
+  u32 congestion_threshold;
+  u64 flush_deadline_clocks;
+
   /* for frame queue tracing */
   frame_queue_trace_t *frame_queue_traces;
   frame_queue_nelt_counter_t *frame_queue_histogram;
@@ -195,6 +237,18 @@ void vlib_create_worker_threads (vlib_main_t * vm, int n,
 
 void vlib_worker_thread_init (vlib_worker_thread_t * w);
 u32 vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts);
+void vlib_frame_queue_set_congestion (u32 frame_queue_index,
+				      vlib_frame_queue_congestion_t
+				      congestion, u32 threshold);
+void vlib_frame_queue_set_flush_deadline (u32 frame_queue_index,
+					  f64 deadline);
+u32 vlib_buffer_enqueue_to_thread (vlib_main_t * vm, u32 frame_queue_index,
+				   u32 * buffer_indices, u16 * thread_indices,
+				   u32 n_packets);
+void vlib_frame_queue_flush (vlib_main_t * vm, vlib_frame_queue_main_t * fqm,
+			     u64 now);
+u32 vlib_frame_queue_flush_all (vlib_main_t * vm);
+int vlib_frame_queue_is_pending (vlib_main_t * vm);
 
 /* Check for a barrier sync request every 30ms */
 #define BARRIER_SYNC_DELAY (0.030000)
@@ -481,6 +481,9 @@ test_frame_queue_nelts (vlib_main_t * vm, unformat_input_t * input,
       fqm->vlib_frame_queues[fqix]->nelts = nelts;
     }
 
+  if (fqm->congestion_threshold >= nelts)
+    fqm->congestion_threshold = nelts - 1;
+
 done:
   unformat_free (line_input);
 
@@ -574,6 +577,214 @@ VLIB_CLI_COMMAND (cmd_test_frame_queue_threshold,static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+show_frame_queue_stats (vlib_main_t * vm, unformat_input_t * input,
+			vlib_cli_command_t * cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_per_thread_data_t *ptd;
+  vlib_frame_queue_stats_t *st, sum;
+  u32 ti, i;
+
+  vec_foreach (fqm, tm->frame_queue_mains)
+  {
+    vlib_cli_output (vm, "Worker handoff queue index %u (next node '%U'):",
+		     fqm - tm->frame_queue_mains,
+		     format_vlib_node_name, vm, fqm->node_index);
+    vlib_cli_output (vm, "  congestion %s threshold %u, flush deadline "
+		     "%.1f us",
+		     fqm->congestion == VLIB_FRAME_QUEUE_CONGESTION_TAIL_DROP ?
+		     "tail-drop" : "backpressure", fqm->congestion_threshold,
+		     fqm->flush_deadline_clocks * 1e6 /
+		     vm->clib_time.clocks_per_second);
+
+    for (ti = 0; ti < vec_len (fqm->vlib_frame_queues); ti++)
+      {
+	u64 total = 0;
+
+	memset (&sum, 0, sizeof (sum));
+	vec_foreach (ptd, fqm->per_thread_data)
+	{
+	  st = vec_elt_at_index (ptd->stats_by_thread_index, ti);
+	  sum.buffers += st->buffers;
+	  sum.frames += st->frames;
+	  sum.deadline_flushes += st->deadline_flushes;
+	  sum.congestion_drops += st->congestion_drops;
+	  for (i = 0; i < FRAME_QUEUE_MAX_NELTS; i++)
+	    sum.occupancy[i] += st->occupancy[i];
+	}
+
+	if (sum.buffers + sum.congestion_drops == 0)
+	  continue;
+
+	vlib_cli_output (vm, "  Thread %d %v", ti,
+			 vlib_worker_threads[ti].name);
+	vlib_cli_output (vm, "    buffers %llu frames %llu (%.1f vectors/frame)"
+			 " deadline-flushes %llu drops %llu full-events %u",
+			 sum.buffers, sum.frames,
+			 sum.frames ? (f64) sum.buffers / sum.frames : 0.0,
+			 sum.deadline_flushes, sum.congestion_drops,
+			 fqm->vlib_frame_queues[ti]->enqueue_full_events);
+
+	for (i = 0; i < FRAME_QUEUE_MAX_NELTS; i++)
+	  total += sum.occupancy[i];
+	vlib_cli_output (vm, "    occupancy 0-1   2-3   4-5   6-7   8-9   "
+			 "10-11 12-13 14-15 16-17 18-19 20-21 22-23 24-25 "
+			 "26-27 28-29 30-31");
+	vlib_cli_output (vm, "              %3d%%  %3d%%  %3d%%  %3d%%  %3d%%  "
+			 "%3d%%  %3d%%  %3d%%  %3d%%  %3d%%  %3d%%  %3d%%  "
+			 "%3d%%  %3d%%  %3d%%  %3d%%",
+			 compute_percent (&sum.occupancy[0], total),
+			 compute_percent (&sum.occupancy[2], total),
+			 compute_percent (&sum.occupancy[4], total),
+			 compute_percent (&sum.occupancy[6], total),
+			 compute_percent (&sum.occupancy[8], total),
+			 compute_percent (&sum.occupancy[10], total),
+			 compute_percent (&sum.occupancy[12], total),
+			 compute_percent (&sum.occupancy[14], total),
+			 compute_percent (&sum.occupancy[16], total),
+			 compute_percent (&sum.occupancy[18], total),
+			 compute_percent (&sum.occupancy[20], total),
+			 compute_percent (&sum.occupancy[22], total),
+			 compute_percent (&sum.occupancy[24], total),
+			 compute_percent (&sum.occupancy[26], total),
+			 compute_percent (&sum.occupancy[28], total),
+			 compute_percent (&sum.occupancy[30], total));
+      }
+  }
+  return 0;
+}
+
+/*?
+ * Display handoff statistics of each worker handoff queue: buffers and
+ * frames handed off to each thread, partially filled frames shipped when
+ * the flush deadline passed, congestion drops, and a histogram of the
+ * ring occupancy seen when each frame was shipped.
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_show_frame_queue_stats,static) = {
+    .path = "show frame-queue stats",
+    .short_help = "show frame-queue stats",
+    .function = show_frame_queue_stats,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+clear_frame_queue_stats (vlib_main_t * vm, unformat_input_t * input,
+			 vlib_cli_command_t * cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_frame_queue_per_thread_data_t *ptd;
+  vlib_frame_queue_t **fq;
+
+  vec_foreach (fqm, tm->frame_queue_mains)
+  {
+    vec_foreach (ptd, fqm->per_thread_data)
+      vec_zero (ptd->stats_by_thread_index);
+    vec_foreach (fq, fqm->vlib_frame_queues) fq[0]->enqueue_full_events = 0;
+  }
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_clear_frame_queue_stats,static) = {
+    .path = "clear frame-queue stats",
+    .short_help = "clear frame-queue stats",
+    .function = clear_frame_queue_stats,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_frame_queue (vlib_main_t * vm, unformat_input_t * input,
+		 vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  clib_error_t *error = NULL;
+  u32 index = 0, threshold = 0, congestion = ~0;
+  f64 flush_usec = -1;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "index %u", &index))
+	;
+      else if (unformat (line_input, "flush-usec %f", &flush_usec))
+	;
+      else if (unformat (line_input, "tail-drop"))
+	congestion = VLIB_FRAME_QUEUE_CONGESTION_TAIL_DROP;
+      else if (unformat (line_input, "backpressure"))
+	congestion = VLIB_FRAME_QUEUE_CONGESTION_BACKPRESSURE;
+      else if (unformat (line_input, "threshold %u", &threshold))
+	;
+      else
+	{
+	  error = clib_error_return (0, "parse error: '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (index >= vec_len (tm->frame_queue_mains))
+    {
+      error = clib_error_return (0,
+				 "expecting valid worker handoff queue index");
+      goto done;
+    }
+
+  fqm = vec_elt_at_index (tm->frame_queue_mains, index);
+
+  if (threshold >= fqm->vlib_frame_queues[0]->nelts)
+    {
+      error = clib_error_return (0, "threshold must be below the ring size "
+				 "%u", fqm->vlib_frame_queues[0]->nelts);
+      goto done;
+    }
+
+  /* the handoff nodes of the workers read the policy on every call */
+  vlib_worker_thread_barrier_sync (vm);
+
+  if (congestion != ~0 || threshold)
+    vlib_frame_queue_set_congestion (index, congestion != ~0 ?
+				     congestion : fqm->congestion, threshold);
+
+  if (flush_usec >= 0)
+    vlib_frame_queue_set_flush_deadline (index, flush_usec * 1e-6);
+
+  vlib_worker_thread_barrier_release (vm);
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+/*?
+ * Set the congestion policy and the flush deadline of a worker handoff
+ * queue. With '<em>backpressure</em>' a thread handing off buffers waits
+ * for the target thread to make room in its ring, with
+ * '<em>tail-drop</em>' buffers are dropped while the target ring holds
+ * '<em>threshold</em>' or more frames. Partially filled frames wait up to
+ * '<em>flush-usec</em>' microseconds for more buffers to the same thread,
+ * 0 ships them at the end of every handoff node call.
+ *
+ * @cliexpar
+ * @cliexcmd{set frame-queue index 0 tail-drop threshold 24 flush-usec 20}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_set_frame_queue,static) = {
+    .path = "set frame-queue",
+    .short_help = "set frame-queue [index <n>] [backpressure|tail-drop] "
+      "[threshold <n>] [flush-usec <n>]",
+    .function = set_frame_queue,
+};
+/* *INDENT-ON* */
+
 
 /*
  * fd.io coding-style-patch-verification: ON
@@ -107,6 +107,16 @@ vlib_trace_frame_buffers_only (vlib_main_t * vm,
     }
 }
 
+static void
+trace_sample_discard_alloc (vlib_trace_main_t * tm)
+{
+  vlib_trace_header_t **h;
+
+  pool_get (tm->trace_buffer_pool, h);
+  vec_reset_length (h[0]);
+  tm->sample_discard_index = h - tm->trace_buffer_pool;
+}
+
 /* Free up all trace buffer memory. */
 always_inline void
 clear_trace_buffer (void)
@@ -122,12 +132,21 @@ clear_trace_buffer (void)
     tm = &this_vlib_main->trace_main;
     mainheap = clib_mem_set_heap (this_vlib_main->heap_base);
 
-    tm->trace_active_hint = 0;
+    tm->trace_active_hint = tm->sample_active;
 
     for (i = 0; i < vec_len (tm->trace_buffer_pool); i++)
       if (! pool_is_free_index (tm->trace_buffer_pool, i))
         vec_free (tm->trace_buffer_pool[i]);
     pool_free (tm->trace_buffer_pool);
+    clib_bitmap_zero (tm->sample_done);
+
+    for (i = 0; i < vec_len (tm->sample_ring); i++)
+      vec_free (tm->sample_ring[i]);
+    tm->sample_ring_head = 0;
+    tm->n_sample_packets = tm->n_sample_filtered = 0;
+    tm->n_sampled = tm->n_sample_discarded = 0;
+    if (tm->sample_active)
+      trace_sample_discard_alloc (tm);
     clib_mem_set_heap (mainheap);
   }));
   /* *INDENT-ON* */
@@ -236,7 +255,8 @@ trace_apply_filter (vlib_main_t * vm)
 
   u32 accept;
 
-  if (tm->filter_flag == FILTER_FLAG_NONE)
+  /* sampling threads filter their traces when collecting them */
+  if (tm->filter_flag == FILTER_FLAG_NONE || tm->sample_active)
     return;
 
   /*
@@ -267,6 +287,89 @@ trace_apply_filter (vlib_main_t * vm)
   vec_free (traces_to_remove);
 }
 
+static int
+trace_includes_node (vlib_trace_header_t * h, u32 node_index)
+{
+  vlib_trace_header_t *e = vec_end (h);
+
+  while (h < e)
+    {
+      if (h->node_index == node_index)
+	return 1;
+      h = vlib_trace_header_next (h);
+    }
+  return 0;
+}
+
+static u64
+trace_last_time (vlib_trace_header_t * h)
+{
+  vlib_trace_header_t *e = vec_end (h);
+  u64 t = 0;
+
+  while (h < e)
+    {
+      t = h->time;
+      h = vlib_trace_header_next (h);
+    }
+  return t;
+}
+
+/*
+ * Move the completed traces of a sampling thread to its ring, or free
+ * them if they do not pass through the keep node. A trace is complete
+ * once vlib_trace_buffer_done marked it, or when it had no record added
+ * for VLIB_TRACE_SAMPLE_MAX_AGE; traces of buffers still in flight, in
+ * tx rings, frame queues or reassembly, are left alone. The ring slot's
+ * old trace vector is recycled for the next trace, so a thread which
+ * keeps sampling stops allocating once its ring is full. Called on the
+ * thread itself at the start of a main loop, or with the thread stopped
+ * at the barrier.
+ */
+void
+vlib_trace_sample_collect (vlib_main_t * vm)
+{
+  vlib_trace_main_t *tm = &vm->trace_main;
+  vlib_trace_header_t **h, *t;
+  u32 i, slot, mask = vec_len (tm->sample_ring) - 1;
+  u64 stale;
+
+  vec_reset_length (tm->trace_buffer_pool[tm->sample_discard_index]);
+  stale = clib_cpu_time_now ()
+    - VLIB_TRACE_SAMPLE_MAX_AGE * vm->clib_time.clocks_per_second;
+
+  for (i = 0; i < vec_len (tm->trace_buffer_pool); i++)
+    {
+      if (i == tm->sample_discard_index
+	  || pool_is_free_index (tm->trace_buffer_pool, i))
+	continue;
+
+      h = tm->trace_buffer_pool + i;
+      if (!clib_bitmap_get (tm->sample_done, i)
+	  && trace_last_time (h[0]) >= stale)
+	continue;
+
+      if (vec_len (h[0]) == 0 || (tm->sample_keep_node_index != ~0
+				  && !trace_includes_node
+				  (h[0], tm->sample_keep_node_index)))
+	{
+	  tm->n_sample_discarded++;
+	  vec_reset_length (h[0]);
+	}
+      else
+	{
+	  slot = tm->sample_ring_head++ & mask;
+	  t = tm->sample_ring[slot];
+	  tm->sample_ring[slot] = h[0];
+	  h[0] = t;
+	  vec_reset_length (t);
+	}
+      pool_put_index (tm->trace_buffer_pool, i);
+    }
+
+  clib_bitmap_zero (tm->sample_done);
+}
+
 static clib_error_t *
 cli_show_trace_buffer (vlib_main_t * vm,
 		       unformat_input_t * input, vlib_cli_command_t * cmd)
@@ -312,7 +415,9 @@ cli_show_trace_buffer (vlib_main_t * vm,
     traces = 0;
     pool_foreach (h, tm->trace_buffer_pool,
     ({
-      vec_add1 (traces, h[0]);
+      if (!tm->sample_active
+          || h - tm->trace_buffer_pool != tm->sample_discard_index)
+        vec_add1 (traces, h[0]);
     }));
 
     if (vec_len (traces) == 0)
@@ -521,6 +626,274 @@ VLIB_CLI_COMMAND (filter_trace_cli,static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+cli_trace_sample (vlib_main_t * vm,
+		  unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vlib_trace_main_t *tm;
+  vlib_trace_node_t *tn;
+  u32 node_index = ~0, keep_node_index = ~0, interval = 1, ring_size = 256;
+  u32 i, disable = 0;
+  clib_error_t *error = 0;
+  void *oldheap;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, "expected NODE or 'disable'");
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "disable"))
+	disable = 1;
+      else if (unformat (line_input, "interval %u", &interval))
+	;
+      else if (unformat (line_input, "ring-size %u", &ring_size))
+	;
+      else if (unformat (line_input, "drops-only"))
+	keep_node_index = vlib_get_node_by_name (vm, (u8 *) "error-drop")
+	  ->index;
+      else if (unformat (line_input, "through %U",
+			 unformat_vlib_node, vm, &keep_node_index))
+	;
+      else if (unformat (line_input, "%U", unformat_vlib_node, vm,
+			 &node_index))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (!disable && node_index == ~0)
+    {
+      error = clib_error_return (0, "expected NODE or 'disable'");
+      goto done;
+    }
+  if (interval == 0 || !is_pow2 (ring_size))
+    {
+      error = clib_error_return (0, "interval must be non-zero and "
+				 "ring-size a power of 2");
+      goto done;
+    }
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  /* *INDENT-OFF* */
+  foreach_vlib_main ((
+    {
+      tm = &this_vlib_main->trace_main;
+      oldheap = clib_mem_set_heap (this_vlib_main->heap_base);
+
+      if (disable)
+	{
+	  vec_foreach (tn, tm->nodes)
+	    if (tn->sample_interval)
+	      memset (tn, 0, sizeof (*tn));
+	  if (tm->sample_active)
+	    {
+	      /* keep the traces already sampled for show trace sample */
+	      vlib_trace_sample_collect (this_vlib_main);
+	      pool_put_index (tm->trace_buffer_pool,
+			      tm->sample_discard_index);
+	      tm->sample_active = 0;
+	    }
+	}
+      else
+	{
+	  if (vec_len (tm->sample_ring) != ring_size)
+	    {
+	      for (i = 0; i < vec_len (tm->sample_ring); i++)
+		vec_free (tm->sample_ring[i]);
+	      vec_free (tm->sample_ring);
+	      vec_validate (tm->sample_ring, ring_size - 1);
+	      tm->sample_ring_head = 0;
+	    }
+	  if (!tm->sample_active)
+	    trace_sample_discard_alloc (tm);
+
+	  tm->sample_keep_node_index = keep_node_index;
+	  tm->trace_active_hint = 1;
+	  vec_validate (tm->nodes, node_index);
+	  tn = tm->nodes + node_index;
+	  tn->limit = VLIB_TRACE_SAMPLE_LIMIT;
+	  tn->count = 0;
+	  tn->sample_interval = tn->sample_countdown = interval;
+	  tm->sample_active = 1;
+	}
+
+      clib_mem_set_heap (oldheap);
+    }));
+  /* *INDENT-ON* */
+
+  vlib_worker_thread_barrier_release (vm);
+
+done:
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Trace a sample of the packets of an input node, with bounded cost, so
+ * that tracing can be left on under load to catch rare events. One in
+ * '<em>interval</em>' packets is traced, of those which pass the sample
+ * filter when one is set, see '<em>trace sample filter</em>'. Every main
+ * loop, each thread moves its completed traces to a ring of the most
+ * recent '<em>ring-size</em>' ones. With '<em>drops-only</em>', or
+ * '<em>through <node></em>', only traces of packets which went through
+ * error-drop, or the given node, are kept and the others are freed right
+ * away. Packets which are not sampled are not traced by any node.
+ *
+ * '<em>clear trace</em>' empties the rings, sampling continues until
+ * '<em>trace sample disable</em>'.
+ *
+ * @cliexpar
+ * Keep the last 64 drops of 1 in 100 packets received by dpdk-input:
+ * @cliexcmd{trace sample dpdk-input interval 100 ring-size 64 drops-only}
+ * @cliexcmd{show trace sample max 10}
+ * @cliexcmd{trace sample disable}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (trace_sample_cli,static) = {
+  .path = "trace sample",
+  .short_help = "trace sample <node> [interval <n>] [ring-size <n>] "
+    "[drops-only | through <node>] | disable",
+  .function = cli_trace_sample,
+};
+/* *INDENT-ON* */
+
+typedef struct
+{
+  u32 thread_index;
+  u8 is_active;
+  u32 keep_node_index;
+  u8 *nodes;
+  u64 n_packets, n_filtered, n_sampled, n_discarded, n_kept;
+  u8 has_filter;
+  vlib_trace_header_t **traces;
+} trace_sample_show_t;
+
+static clib_error_t *
+cli_show_trace_sample (vlib_main_t * vm,
+		       unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  trace_sample_show_t *shows = 0, *ss;
+  vlib_trace_main_t *tm;
+  vlib_trace_node_t *tn;
+  vlib_trace_header_t *t;
+  u32 i, n, max = 50, mask;
+  u64 head;
+  void *oldheap;
+
+  while (unformat_check_input (input) != (uword) UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "max %d", &max))
+	;
+      else
+	return clib_error_create ("expected 'max COUNT', got `%U'",
+				  format_unformat_error, input);
+    }
+
+  /* The rings are written without locks, read them with the threads
+     stopped, and format the copies afterwards */
+  vlib_worker_thread_barrier_sync (vm);
+
+  /* *INDENT-OFF* */
+  foreach_vlib_main ((
+    {
+      tm = &this_vlib_main->trace_main;
+      vec_add2 (shows, ss, 1);
+      ss->thread_index = this_vlib_main->thread_index;
+      ss->is_active = tm->sample_active;
+      ss->keep_node_index = tm->sample_keep_node_index;
+      ss->has_filter = tm->sample_filter != 0;
+
+      /* The current loop's traces of the calling thread are not
+	 complete yet */
+      if (tm->sample_active
+	  && (this_vlib_main != vm
+	      || tm->last_main_loop_count != vm->main_loop_count))
+	{
+	  oldheap = clib_mem_set_heap (this_vlib_main->heap_base);
+	  vlib_trace_sample_collect (this_vlib_main);
+	  clib_mem_set_heap (oldheap);
+	}
+
+      vec_foreach (tn, tm->nodes)
+	if (tn->sample_interval)
+	  ss->nodes = format (ss->nodes, "%s%U 1/%u",
+			      vec_len (ss->nodes) ? ", " : "",
+			      format_vlib_node_name, vm, tn - tm->nodes,
+			      tn->sample_interval);
+
+      ss->n_packets = tm->n_sample_packets;
+      ss->n_filtered = tm->n_sample_filtered;
+      ss->n_sampled = tm->n_sampled;
+      ss->n_discarded = tm->n_sample_discarded;
+      ss->n_kept = tm->sample_ring_head;
+
+      mask = vec_len (tm->sample_ring) - 1;
+      n = clib_min (tm->sample_ring_head, vec_len (tm->sample_ring));
+      n = clib_min (n, max);
+      for (head = tm->sample_ring_head - n; head < tm->sample_ring_head;
+	   head++)
+	{
+	  t = vec_dup (tm->sample_ring[head & mask]);
+	  vec_add1 (ss->traces, t);
+	}
+    }));
+  /* *INDENT-ON* */
+
+  vlib_worker_thread_barrier_release (vm);
+
+  vec_foreach (ss, shows)
+  {
+    vlib_cli_output (vm, "Thread %u %s: %s%v%s", ss->thread_index,
+		     vlib_worker_threads[ss->thread_index].name,
+		     ss->is_active ? "sampling " : "not sampling",
+		     ss->nodes, ss->has_filter ? ", filtered" : "");
+    if (ss->is_active && ss->keep_node_index != ~0)
+      vlib_cli_output (vm, "  keeping traces through %U",
+		       format_vlib_node_name, vm, ss->keep_node_index);
+    vlib_cli_output (vm, "  packets %lu filtered %lu sampled %lu "
+		     "discarded %lu kept %lu", ss->n_packets, ss->n_filtered,
+		     ss->n_sampled, ss->n_discarded, ss->n_kept);
+
+    for (i = 0; i < vec_len (ss->traces); i++)
+      {
+	vlib_cli_output (vm, "Packet %lu\n%U\n", ss->n_kept -
+			 vec_len (ss->traces) + i + 1, format_vlib_trace,
+			 vm, ss->traces[i]);
+	vec_free (ss->traces[i]);
+      }
+    vec_free (ss->traces);
+    vec_free (ss->nodes);
+  }
+  vec_free (shows);
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_trace_sample_cli,static) = {
+  .path = "show trace sample",
+  .short_help = "show trace sample [max COUNT]",
+  .function = cli_show_trace_sample,
+};
+/* *INDENT-ON* */
+
+/* Set, or clear with 0, the filter of sampling nodes on all threads. */
+void
+vlib_trace_sample_set_filter (vlib_trace_sample_filter_function_t * f)
+{
+  /* *INDENT-OFF* */
+  foreach_vlib_main ((
+    {
+      this_vlib_main->trace_main.sample_filter = f;
+    }));
+  /* *INDENT-ON* */
+}
+
 static clib_error_t *
 cli_clear_trace_buffer (vlib_main_t * vm,
 			unformat_input_t * input, vlib_cli_command_t * cmd)
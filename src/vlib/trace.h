@@ -41,6 +41,9 @@
 #define included_vlib_trace_h
 
 #include <vppinfra/pool.h>
+#include <vlib/buffer.h>
+
+struct vlib_main_t;
 
 typedef struct
 {
@@ -64,8 +67,25 @@ typedef struct
 
   /* Max. number of traces to be added to buffer. */
   u32 limit;
+
+  /* Sampled tracing: trace 1 in sample_interval packets, 0 when off. */
+  u32 sample_interval;
+
+  /* Packets until the next sample. */
+  u32 sample_countdown;
 } vlib_trace_node_t;
 
+/* Trace limit of a sampling node, which never runs out. */
+#define VLIB_TRACE_SAMPLE_LIMIT (1 << 30)
+
+/* Seconds after its last record a sampled trace which was never marked
+   done, e.g. of a packet consumed by the local stack, is collected. */
+#define VLIB_TRACE_SAMPLE_MAX_AGE 1.0
+
+/* Returns non-zero if a packet seen by a sampling node may be sampled. */
+typedef int (vlib_trace_sample_filter_function_t) (struct vlib_main_t * vm,
+						   vlib_buffer_t * b);
+
 typedef struct
 {
   /* Pool of trace buffers. */
@@ -87,6 +107,36 @@ typedef struct
 
   /* verbosity */
   int verbose;
+
+  /*
+   * Sampled tracing. Each main loop, the traces completed during the
+   * previous one which pass through sample_keep_node_index (any node when
+   * ~0) are moved to a ring of the most recent ones, the others are freed.
+   * A trace is complete once its buffer was dropped or handed to a device
+   * for transmit, or when it has not been added to for
+   * VLIB_TRACE_SAMPLE_MAX_AGE. Memory stays bounded with tracing left on
+   * under load.
+   */
+  u32 sample_active;
+  u32 sample_keep_node_index;
+  vlib_trace_sample_filter_function_t *sample_filter;
+
+  /* Power of 2 ring of traces, written by this thread only. */
+  vlib_trace_header_t **sample_ring;
+  u64 sample_ring_head;
+
+  /* Trace which packets a sampling node did not select are added to. */
+  u32 sample_discard_index;
+
+  /* Bitmap of the traces completed since the last collection. */
+  uword *sample_done;
+
+  /* Packets seen by sampling nodes, rejected by the filter, sampled, and
+     traces freed for not passing through the keep node. */
+  u64 n_sample_packets;
+  u64 n_sample_filtered;
+  u64 n_sampled;
+  u64 n_sample_discarded;
 } vlib_trace_main_t;
 
 #endif /* included_vlib_trace_h */
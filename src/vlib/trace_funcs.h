@@ -59,6 +59,12 @@ vlib_add_trace (vlib_main_t * vm,
   vlib_trace_header_t *h;
   u32 n_data_words;
 
+  /* A sampled trace may have been collected as stale while its buffer
+     was still held somewhere, e.g. waiting for reassembly */
+  if (PREDICT_FALSE (tm->sample_active)
+      && pool_is_free_index (tm->trace_buffer_pool, b->trace_index))
+    b->trace_index = tm->sample_discard_index;
+
   vlib_validate_trace (tm, b);
 
   n_data_bytes = round_pow2 (n_data_bytes, sizeof (h[0]));
@@ -98,6 +104,60 @@ vlib_trace_next_frame (vlib_main_t * vm,
 }
 
 void trace_apply_filter (vlib_main_t * vm);
+void vlib_trace_sample_collect (vlib_main_t * vm);
+void vlib_trace_sample_set_filter (vlib_trace_sample_filter_function_t * f);
+
+/*
+ * Sampled tracing: select 1 in sample_interval of the packets of a
+ * sampling node which pass the filter. Packets which are not selected
+ * are not marked as traced, but still get a trace index, of a trace
+ * which is reset every main loop, for the node's own trace record.
+ */
+always_inline int
+vlib_trace_sample (vlib_main_t * vm, vlib_trace_main_t * tm,
+		   vlib_node_runtime_t * r, vlib_buffer_t * b)
+{
+  vlib_trace_node_t *tn;
+
+  if (r->node_index >= vec_len (tm->nodes))
+    return 1;
+  tn = tm->nodes + r->node_index;
+  if (!tn->sample_interval)
+    return 1;
+
+  tm->n_sample_packets++;
+  if (tm->sample_filter && !tm->sample_filter (vm, b))
+    {
+      tm->n_sample_filtered++;
+      goto discard;
+    }
+  if (--tn->sample_countdown > 0)
+    goto discard;
+
+  tn->sample_countdown = tn->sample_interval;
+  tm->n_sampled++;
+  return 1;
+
+discard:
+  b->trace_index = tm->sample_discard_index;
+  return 0;
+}
+
+/*
+ * Sampled tracing: the traced buffer was dropped or handed to a device
+ * for transmit, so its trace is complete and is collected at the start
+ * of the next main loop.
+ */
+always_inline void
+vlib_trace_buffer_done (vlib_main_t * vm, vlib_buffer_t * b)
+{
+  vlib_trace_main_t *tm = &vm->trace_main;
+
+  if (PREDICT_FALSE (tm->sample_active)
+      && b->trace_index != tm->sample_discard_index
+      && !pool_is_free_index (tm->trace_buffer_pool, b->trace_index))
+    tm->sample_done = clib_bitmap_set (tm->sample_done, b->trace_index, 1);
+}
 
 /* Mark buffer as traced and allocate trace buffer. */
 always_inline void
@@ -115,9 +175,16 @@ vlib_trace_buffer (vlib_main_t * vm,
   if (tm->last_main_loop_count != vm->main_loop_count)
     {
       tm->last_main_loop_count = vm->main_loop_count;
-      trace_apply_filter (vm);
+      if (tm->sample_active)
+	vlib_trace_sample_collect (vm);
+      else
+	trace_apply_filter (vm);
     }
 
+  if (PREDICT_FALSE (tm->sample_active)
+      && !vlib_trace_sample (vm, tm, r, b))
+    return;
+
   vlib_trace_next_frame (vm, r, next_index);
 
   pool_get (tm->trace_buffer_pool, h);
@@ -149,6 +216,9 @@ vlib_get_trace_count (vlib_main_t * vm, vlib_node_runtime_t * rt)
   if (rt->node_index >= vec_len (tm->nodes))
     return 0;
   tn = tm->nodes + rt->node_index;
+  /* sampling nodes look at every packet */
+  if (PREDICT_FALSE (tn->sample_interval))
+    tn->count = 0;
   n = tn->limit - tn->count;
   ASSERT (n >= 0);
 
@@ -596,6 +596,7 @@ vlib_unix_main (int argc, char *argv[])
   clib_error_t *e;
   int i;
 
+  vm->init_profile_start = unix_time_now ();
   vm->argv = (u8 **) argv;
   vm->name = argv[0];
   vm->heap_base = clib_mem_get_heap ();
@@ -19,6 +19,9 @@
 #include <vppinfra/elf.h>
 #include <dlfcn.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
 
 plugin_main_t vlib_plugin_main;
 
@@ -60,40 +63,198 @@ str_array_to_vec (char *array, int len)
   return r;
 }
 
+/* Section header fields used by plugin_inspect */
+static int
+plugin_section_header (u8 * base, uword file_size, int is_64, u64 sh_off,
+		       u64 sh_size, u32 index, u32 * name, u64 * offset,
+		       u64 * size)
+{
+  u64 o = sh_off + index * sh_size;
+
+  if (o + (is_64 ? sizeof (elf64_section_header_t) :
+	   sizeof (elf32_section_header_t)) > file_size)
+    return -1;
+
+  if (is_64)
+    {
+      elf64_section_header_t *sh = (void *) (base + o);
+      *name = sh->name;
+      *offset = sh->file_offset;
+      *size = sh->file_size;
+    }
+  else
+    {
+      elf32_section_header_t *sh = (void *) (base + o);
+      *name = sh->name;
+      *offset = sh->file_offset;
+      *size = sh->file_size;
+    }
+
+  return (*offset + *size > file_size) ? -1 : 0;
+}
+
+/*
+ * Read the registration section of a plugin without loading it, and
+ * have the kernel read the rest of the file ahead so that the dlopen
+ * which follows does not wait for the disk. Runs on several threads at
+ * once: nothing here may use the clib heap, which is not thread safe
+ * this early.
+ */
+static void
+plugin_inspect (plugin_info_t * pi)
+{
+  static const char section_name[] = ".vlib_plugin_registration";
+  uword file_size = pi->file_info.st_size;
+  u64 sh_off, sh_size, str_off, str_size, off, size;
+  u32 sh_count, sh_str, name, i;
+  elf_first_header_t *h;
+  u8 *base;
+  int fd, is_64;
+
+  pi->inspect_result = PLUGIN_INSPECT_UNREADABLE;
+
+  if ((fd = open ((char *) pi->filename, O_RDONLY)) < 0)
+    return;
+  posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+  base = mmap (0, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (base == MAP_FAILED)
+    return;
+
+  pi->inspect_result = PLUGIN_INSPECT_NOT_A_PLUGIN;
+
+  h = (elf_first_header_t *) base;
+  if (file_size < sizeof (h[0]) + sizeof (elf64_file_header_t)
+      || memcmp (h->magic, "\177ELF", 4))
+    goto done;
+
+  /* plugins are built for this host */
+  if (h->data_encoding != (clib_arch_is_little_endian ?
+			   ELF_TWOS_COMPLEMENT_LITTLE_ENDIAN :
+			   ELF_TWOS_COMPLEMENT_BIG_ENDIAN))
+    goto done;
+
+  is_64 = h->file_class == ELF_64BIT;
+  if (is_64)
+    {
+      elf64_file_header_t *fh = (void *) (h + 1);
+      sh_off = fh->section_header_file_offset;
+      sh_size = fh->section_header_size;
+      sh_count = fh->section_header_count;
+      sh_str = fh->section_header_string_table_index;
+    }
+  else
+    {
+      elf32_file_header_t *fh = (void *) (h + 1);
+      sh_off = fh->section_header_file_offset;
+      sh_size = fh->section_header_size;
+      sh_count = fh->section_header_count;
+      sh_str = fh->section_header_string_table_index;
+    }
+
+  if (plugin_section_header (base, file_size, is_64, sh_off, sh_size,
+			     sh_str, &name, &str_off, &str_size))
+    goto done;
+
+  for (i = 0; i < sh_count; i++)
+    {
+      if (plugin_section_header (base, file_size, is_64, sh_off, sh_size,
+				 i, &name, &off, &size))
+	goto done;
+
+      if (name + sizeof (section_name) > str_size
+	  || memcmp (base + str_off + name, section_name,
+		     sizeof (section_name)))
+	continue;
+
+      if (size != sizeof (pi->file_reg))
+	{
+	  pi->inspect_result = PLUGIN_INSPECT_SIZE_MISMATCH;
+	  goto done;
+	}
+
+      clib_memcpy (&pi->file_reg, base + off, sizeof (pi->file_reg));
+      pi->inspect_result = PLUGIN_INSPECT_OK;
+      break;
+    }
+
+done:
+  munmap (base, file_size);
+}
+
+typedef struct
+{
+  plugin_main_t *pm;
+  volatile u32 next_index;
+} plugin_inspect_ctx_t;
+
+static void *
+plugin_inspect_thread_fn (void *arg)
+{
+  plugin_inspect_ctx_t *ctx = arg;
+  u32 n = vec_len (ctx->pm->plugin_info), i;
+
+  while ((i = __sync_fetch_and_add (&ctx->next_index, 1)) < n)
+    plugin_inspect (ctx->pm->plugin_info + i);
+
+  return 0;
+}
+
+#define PLUGIN_MAX_INSPECT_THREADS 16
+
+/* Inspect all plugin files in parallel before they are loaded one by
+   one; loading itself runs plugin constructors and stays serial. */
+static void
+plugin_inspect_all (plugin_main_t * pm)
+{
+  pthread_t threads[PLUGIN_MAX_INSPECT_THREADS];
+  plugin_inspect_ctx_t ctx = {.pm = pm };
+  u32 n_threads = pm->n_inspect_threads, n_started = 0, i;
+
+  if (n_threads == 0)
+    n_threads = clib_max (1, sysconf (_SC_NPROCESSORS_ONLN));
+  n_threads = clib_min (n_threads, PLUGIN_MAX_INSPECT_THREADS);
+  n_threads = clib_min (n_threads, vec_len (pm->plugin_info));
+
+  /* the calling thread is one of them */
+  for (i = 1; i < n_threads; i++)
+    if (pthread_create (&threads[n_started], 0, plugin_inspect_thread_fn,
+			&ctx) == 0)
+      n_started++;
+
+  plugin_inspect_thread_fn (&ctx);
+
+  for (i = 0; i < n_started; i++)
+    pthread_join (threads[i], 0);
+}
+
 static int
 load_one_plugin (plugin_main_t * pm, plugin_info_t * pi, int from_early_init)
 {
   void *handle;
   clib_error_t *error;
-  elf_main_t em = { 0 };
-  elf_section_t *section;
-  u8 *data;
   char *version_required;
   vlib_plugin_registration_t *reg;
   plugin_config_t *pc = 0;
   uword *p;
 
-  if (elf_read_file (&em, (char *) pi->filename))
-    return -1;
-
-  error = elf_get_section_by_name (&em, ".vlib_plugin_registration",
-				   &section);
-  if (error)
+  switch (pi->inspect_result)
     {
+    case PLUGIN_INSPECT_OK:
+      break;
+    case PLUGIN_INSPECT_NOT_A_PLUGIN:
       clib_warning ("Not a plugin: %s\n", (char *) pi->name);
       return -1;
-    }
-
-  data = elf_get_section_contents (&em, section->index, 1);
-  reg = (vlib_plugin_registration_t *) data;
-
-  if (vec_len (data) != sizeof (*reg))
-    {
+    case PLUGIN_INSPECT_SIZE_MISMATCH:
       clib_warning ("vlib_plugin_registration size mismatch in plugin %s\n",
 		    (char *) pi->name);
-      goto error;
+      return -1;
+    default:
+      return -1;
     }
 
+  reg = &pi->file_reg;
+
   if (pm->plugins_default_disable)
     reg->default_disabled = 1;
 
@@ -135,8 +296,6 @@ load_one_plugin (plugin_main_t * pm, plugin_info_t * pi, int from_early_init)
     }
 
   vec_free (version_required);
-  vec_free (data);
-  elf_main_free (&em);
 
   handle = dlopen ((char *) pi->filename, RTLD_LAZY);
 
@@ -192,8 +351,6 @@ load_one_plugin (plugin_main_t * pm, plugin_info_t * pi, int from_early_init)
 
   return 0;
 error:
-  vec_free (data);
-  elf_main_free (&em);
   return -1;
 }
 
@@ -243,6 +400,8 @@ vlib_load_new_plugins (plugin_main_t * pm, int from_early_init)
   plugin_info_t *pi;
   u8 **plugin_path;
   u32 *load_fail_indices = 0;
+  vlib_main_t *vm = pm->vlib_main;
+  u32 profile_index;
   int i;
 
   plugin_path = split_plugin_path (pm);
@@ -314,14 +473,28 @@ vlib_load_new_plugins (plugin_main_t * pm, int from_early_init)
    */
   vec_sort_with_function (pm->plugin_info, plugin_name_sort_cmp);
 
+  profile_index = vlib_init_profile_begin (vm, "plugins", "inspect");
+  plugin_inspect_all (pm);
+  vlib_init_profile_end (vm, profile_index);
+
   /*
    * Attempt to load the plugins
    */
   for (i = 0; i < vec_len (pm->plugin_info); i++)
     {
+      int rv;
+
       pi = vec_elt_at_index (pm->plugin_info, i);
 
-      if (load_one_plugin (pm, pi, from_early_init))
+      if (pi->inspect_result == PLUGIN_INSPECT_OK)
+	profile_index = vlib_init_profile_begin
+	  (vm, "plugin", (char *) format (0, "%s%c", pi->name, 0));
+      else
+	profile_index = ~0;
+      rv = load_one_plugin (pm, pi, from_early_init);
+      vlib_init_profile_end (vm, profile_index);
+
+      if (rv)
 	{
 	  /* Make a note of any which fail to load */
 	  vec_add1 (load_fail_indices, i);
@@ -518,6 +691,9 @@ done:
 	pm->plugin_path = s;
       else if (unformat (input, "name-filter %s", &s))
 	pm->plugin_name_filter = s;
+      else if (unformat (input, "inspect-threads %u",
+			 &pm->n_inspect_threads))
+	;
       else if (unformat (input, "vat-path %s", &s))
 	pm->vat_plugin_path = s;
       else if (unformat (input, "vat-name-filter %s", &s))
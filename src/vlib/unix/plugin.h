@@ -66,6 +66,14 @@ typedef CLIB_PACKED(struct {
 }) vlib_plugin_registration_t;
 /* *INDENT-ON* */
 
+typedef enum
+{
+  PLUGIN_INSPECT_OK,
+  PLUGIN_INSPECT_UNREADABLE,
+  PLUGIN_INSPECT_NOT_A_PLUGIN,
+  PLUGIN_INSPECT_SIZE_MISMATCH,
+} plugin_inspect_result_t;
+
 typedef struct
 {
   u8 *name;
@@ -73,6 +81,10 @@ typedef struct
   struct stat file_info;
   void *handle;
 
+  /* registration section read from the file before dlopen */
+  vlib_plugin_registration_t file_reg;
+  plugin_inspect_result_t inspect_result;
+
   /* plugin registration */
   vlib_plugin_registration_t *reg;
   char *version;
@@ -99,6 +111,9 @@ typedef struct
   u8 *vat_plugin_name_filter;
   u8 plugins_default_disable;
 
+  /* threads reading plugin files before they are loaded */
+  u32 n_inspect_threads;
+
   /* plugin configs and hash by name */
   plugin_config_t *configs;
   uword *config_index_by_name;
@@ -139,8 +154,10 @@ u8 *vlib_get_vat_plugin_path (void);
     }                                                           \
   if (_fptr && ! hash_get (vm->init_functions_called, _f))      \
     {                                                           \
+      u32 _p = vlib_init_profile_begin (vm, "init", #x);	\
       hash_set1 (vm->init_functions_called, _f);                \
       _error = _f (vm);                                         \
+      vlib_init_profile_end (vm, _p);				\
     }                                                           \
   _error;                                                       \
  })
@@ -0,0 +1,742 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <time.h>
+
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+#include <vnet/feature/feature.h>
+
+#include <vnet/capture/capture.h>
+
+capture_main_t capture_main;
+
+#define CAPTURE_DEFAULT_SNAPLEN 2048
+#define CAPTURE_MAX_SNAPLEN 65535
+#define CAPTURE_DEFAULT_RING_SIZE 4096
+#define CAPTURE_WRITE_BUFFER_SIZE (256 << 10)
+
+/* pcapng block types and options */
+#define PCAPNG_BLOCK_SHB 0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB 0x00000001
+#define PCAPNG_BLOCK_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_OPT_ENDOFOPT 0
+#define PCAPNG_OPT_IF_NAME 2
+#define PCAPNG_OPT_EPB_FLAGS 2
+#define PCAPNG_EPB_FLAG_INBOUND 1
+#define PCAPNG_EPB_FLAG_OUTBOUND 2
+#define PCAPNG_LINKTYPE_ETHERNET 1
+
+/* *INDENT-OFF* */
+typedef CLIB_PACKED (struct
+{
+  u32 block_type;
+  u32 block_total_length;
+}) pcapng_block_header_t;
+
+typedef CLIB_PACKED (struct
+{
+  pcapng_block_header_t h;
+  u32 byte_order_magic;
+  u16 major_version;
+  u16 minor_version;
+  i64 section_length;
+}) pcapng_shb_t;
+
+typedef CLIB_PACKED (struct
+{
+  pcapng_block_header_t h;
+  u16 link_type;
+  u16 reserved;
+  u32 snaplen;
+}) pcapng_idb_t;
+
+typedef CLIB_PACKED (struct
+{
+  pcapng_block_header_t h;
+  u32 interface_id;
+  u32 timestamp_high;
+  u32 timestamp_low;
+  u32 captured_length;
+  u32 original_length;
+}) pcapng_epb_t;
+
+typedef CLIB_PACKED (struct
+{
+  u16 code;
+  u16 length;
+}) pcapng_option_header_t;
+/* *INDENT-ON* */
+
+/*
+ * Writer thread. It runs outside of vlib, so it must not touch the vlib
+ * heap: everything it needs is allocated by capture_start.
+ */
+
+static void
+capture_writer_flush (capture_main_t * cm)
+{
+  u8 *p = cm->write_buffer;
+  u32 n_left = cm->write_buffer_len;
+
+  while (n_left && cm->fd >= 0)
+    {
+      ssize_t n = write (cm->fd, p, n_left);
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  cm->n_write_errors++;
+	  break;
+	}
+      p += n;
+      n_left -= n;
+    }
+  cm->write_buffer_len = 0;
+}
+
+/* blocks are built in place, so a whole block must fit before it starts */
+static void
+capture_writer_reserve (capture_main_t * cm, u32 n_bytes)
+{
+  if (cm->write_buffer_len + n_bytes > CAPTURE_WRITE_BUFFER_SIZE)
+    capture_writer_flush (cm);
+}
+
+static void *
+capture_writer_put (capture_main_t * cm, u32 n_bytes)
+{
+  void *p;
+
+  p = cm->write_buffer + cm->write_buffer_len;
+  cm->write_buffer_len += n_bytes;
+  cm->file_bytes += n_bytes;
+  return p;
+}
+
+static void
+capture_writer_put_option (capture_main_t * cm, u16 code, void *data,
+			   u16 len)
+{
+  pcapng_option_header_t *o;
+  u32 padded = round_pow2 (len, 4);
+
+  o = capture_writer_put (cm, sizeof (*o) + padded);
+  o->code = code;
+  o->length = len;
+  memset (o + 1, 0, padded);
+  clib_memcpy (o + 1, data, len);
+}
+
+static void
+capture_writer_put_end (capture_main_t * cm, pcapng_block_header_t * h,
+			u32 start)
+{
+  u32 *total_length;
+
+  total_length = capture_writer_put (cm, sizeof (u32));
+  *total_length = h->block_total_length = cm->file_bytes - start;
+}
+
+static void
+capture_writer_open (capture_main_t * cm)
+{
+  pcapng_shb_t *shb;
+  pcapng_idb_t *idb;
+  u32 i, start;
+
+  if (cm->max_file_size)
+    snprintf (cm->path, sizeof (cm->path), "%s.%u",
+	      (char *) cm->file_name, cm->file_index);
+  else
+    snprintf (cm->path, sizeof (cm->path), "%s", (char *) cm->file_name);
+
+  cm->fd = open (cm->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (cm->fd < 0)
+    {
+      cm->n_write_errors++;
+      return;
+    }
+  cm->n_files++;
+  cm->file_bytes = 0;
+
+  start = cm->file_bytes;
+  capture_writer_reserve (cm, sizeof (*shb) + 2 * sizeof (u32));
+  shb = capture_writer_put (cm, sizeof (*shb));
+  shb->h.block_type = PCAPNG_BLOCK_SHB;
+  shb->byte_order_magic = PCAPNG_BYTE_ORDER_MAGIC;
+  shb->major_version = 1;
+  shb->minor_version = 0;
+  shb->section_length = -1;
+  capture_writer_put_option (cm, PCAPNG_OPT_ENDOFOPT, 0, 0);
+  capture_writer_put_end (cm, &shb->h, start);
+
+  /* pcapng interface ids are indices into sw_if_indices */
+  for (i = 0; i < vec_len (cm->sw_if_indices); i++)
+    {
+      u8 *name = cm->if_names[i];
+
+      start = cm->file_bytes;
+      capture_writer_reserve (cm, sizeof (*idb) + round_pow2 (vec_len (name),
+							     4) +
+			      3 * sizeof (u32));
+      idb = capture_writer_put (cm, sizeof (*idb));
+      idb->h.block_type = PCAPNG_BLOCK_IDB;
+      idb->link_type = PCAPNG_LINKTYPE_ETHERNET;
+      idb->reserved = 0;
+      idb->snaplen = cm->snaplen;
+      capture_writer_put_option (cm, PCAPNG_OPT_IF_NAME, name,
+				 vec_len (name));
+      capture_writer_put_option (cm, PCAPNG_OPT_ENDOFOPT, 0, 0);
+      capture_writer_put_end (cm, &idb->h, start);
+    }
+}
+
+static void
+capture_writer_close (capture_main_t * cm)
+{
+  capture_writer_flush (cm);
+  if (cm->fd >= 0)
+    close (cm->fd);
+  cm->fd = -1;
+}
+
+static void
+capture_writer_put_record (capture_main_t * cm, capture_record_t * rec)
+{
+  pcapng_epb_t *epb;
+  u32 padded = round_pow2 (rec->n_bytes_captured, 4);
+  u32 n_bytes = sizeof (*epb) + padded + sizeof (pcapng_option_header_t) +
+    sizeof (u32) + sizeof (pcapng_option_header_t) + sizeof (u32);
+  u32 flags, start;
+  u64 ts;
+
+  /* rotate before the record that would make the file too big */
+  if (cm->max_file_size && cm->file_bytes + n_bytes > cm->max_file_size &&
+      cm->n_written)
+    {
+      capture_writer_close (cm);
+      cm->file_index++;
+      if (cm->max_files && cm->file_index >= cm->max_files)
+	cm->file_index = 0;
+      capture_writer_open (cm);
+    }
+
+  if (cm->fd < 0)
+    return;
+
+  capture_writer_reserve (cm, n_bytes);
+
+  ts = (rec->timestamp + cm->time_offset) * 1e6;
+  start = cm->file_bytes;
+  epb = capture_writer_put (cm, sizeof (*epb) + padded);
+  epb->h.block_type = PCAPNG_BLOCK_EPB;
+  epb->interface_id = rec->sw_if_index < vec_len (cm->if_id_by_sw_if_index) ?
+    cm->if_id_by_sw_if_index[rec->sw_if_index] : 0;
+  epb->timestamp_high = ts >> 32;
+  epb->timestamp_low = ts;
+  epb->captured_length = rec->n_bytes_captured;
+  epb->original_length = rec->n_bytes_in_packet;
+  clib_memcpy (epb + 1, rec->data, rec->n_bytes_captured);
+  memset ((u8 *) (epb + 1) + rec->n_bytes_captured, 0,
+	  padded - rec->n_bytes_captured);
+
+  flags = rec->is_tx ? PCAPNG_EPB_FLAG_OUTBOUND : PCAPNG_EPB_FLAG_INBOUND;
+  capture_writer_put_option (cm, PCAPNG_OPT_EPB_FLAGS, &flags,
+			     sizeof (flags));
+  capture_writer_put_option (cm, PCAPNG_OPT_ENDOFOPT, 0, 0);
+  capture_writer_put_end (cm, &epb->h, start);
+
+  cm->n_written++;
+  cm->n_bytes_written += rec->n_bytes_captured;
+}
+
+static uword
+capture_writer_drain (capture_main_t * cm)
+{
+  capture_ring_t *r;
+  uword n = 0;
+
+  vec_foreach (r, cm->rings)
+  {
+    u32 head = r->head;
+    u32 tail = r->tail;
+
+    /* the records must be read after the head */
+    CLIB_MEMORY_BARRIER ();
+
+    while (tail != head)
+      {
+	capture_writer_put_record (cm, (capture_record_t *)
+				   (r->slots + (tail & (cm->ring_size - 1)) *
+				    cm->slot_size));
+	tail++;
+	n++;
+      }
+
+    /* the slots are copied out, hand them back */
+    CLIB_MEMORY_BARRIER ();
+    r->tail = tail;
+  }
+
+  return n;
+}
+
+static void *
+capture_writer_thread_fn (void *arg)
+{
+  capture_main_t *cm = arg;
+  struct timespec ts = {.tv_sec = 0,.tv_nsec = 1000000 };
+
+  while (!cm->writer_stop)
+    {
+      if (capture_writer_drain (cm) == 0)
+	{
+	  /* idle, make what we have visible and back off */
+	  capture_writer_flush (cm);
+	  nanosleep (&ts, 0);
+	}
+    }
+
+  capture_writer_drain (cm);
+  capture_writer_close (cm);
+  return 0;
+}
+
+static void
+capture_free (capture_main_t * cm)
+{
+  capture_ring_t *r;
+  u8 **name;
+
+  /* the per-thread counters stay around for show pcap capture */
+  vec_foreach (r, cm->rings)
+  {
+    if (r->slots)
+      clib_mem_free (r->slots);
+    r->slots = 0;
+  }
+
+  if (cm->write_buffer)
+    clib_mem_free (cm->write_buffer);
+  cm->write_buffer = 0;
+
+  vec_foreach (name, cm->if_names) vec_free (name[0]);
+  vec_free (cm->if_names);
+  vec_free (cm->if_id_by_sw_if_index);
+
+  if (cm->filter_table_index != ~0 && cm->filter_table_is_owned)
+    vnet_classify_add_del_table (&vnet_classify_main, 0, 0, 0, 0, 0, 0, 0,
+				 &cm->filter_table_index, 0, 0,
+				 0 /* is_add */ , 0 /* del_chain */ );
+  cm->filter_table_index = ~0;
+  cm->filter_table_is_owned = 0;
+}
+
+static void
+capture_enable_disable (capture_main_t * cm, int enable)
+{
+  u32 *sw_if_index;
+
+  vec_foreach (sw_if_index, cm->sw_if_indices)
+  {
+    if (cm->rx)
+      vnet_feature_enable_disable ("device-input", "pcap-capture-rx",
+				   sw_if_index[0], enable, 0, 0);
+    if (cm->tx)
+      vnet_feature_enable_disable ("interface-output", "pcap-capture-tx",
+				   sw_if_index[0], enable, 0, 0);
+  }
+}
+
+/*
+ * Start capturing. The capture owns a->file_name and a->sw_if_indices
+ * from here on, and a->filter_table_index when a->filter_table_is_owned
+ * is set, also when the start fails.
+ */
+clib_error_t *
+capture_start (capture_args_t * a)
+{
+  capture_main_t *cm = &capture_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_main_t *vm = cm->vlib_main;
+  clib_error_t *error = 0;
+  capture_ring_t *r;
+  u32 i;
+  int rv;
+
+  if (cm->is_running)
+    {
+      if (a->filter_table_index != ~0 && a->filter_table_is_owned)
+	vnet_classify_add_del_table (&vnet_classify_main, 0, 0, 0, 0, 0, 0, 0,
+				     &a->filter_table_index, 0, 0, 0, 0);
+      vec_free (a->file_name);
+      vec_free (a->sw_if_indices);
+      return clib_error_return (0, "capture already running");
+    }
+
+  vec_free (cm->file_name);
+  vec_free (cm->sw_if_indices);
+  cm->file_name = a->file_name;
+  cm->sw_if_indices = a->sw_if_indices;
+  cm->filter_table_index = a->filter_table_index;
+  cm->filter_table_is_owned = a->filter_table_is_owned;
+  cm->rx = a->rx;
+  cm->tx = a->tx;
+  cm->snaplen = a->snaplen ? a->snaplen : CAPTURE_DEFAULT_SNAPLEN;
+  cm->ring_size = a->ring_size ? a->ring_size : CAPTURE_DEFAULT_RING_SIZE;
+  cm->max_file_size = a->max_file_size;
+  cm->max_files = a->max_files;
+
+  if (vec_len (cm->file_name) == 0)
+    {
+      error = clib_error_return (0, "file name required");
+      goto done;
+    }
+  if (vec_len (cm->sw_if_indices) == 0)
+    {
+      error = clib_error_return (0, "at least one interface required");
+      goto done;
+    }
+  if (!cm->rx && !cm->tx)
+    {
+      error = clib_error_return (0, "nothing to capture, rx or tx required");
+      goto done;
+    }
+  if (cm->snaplen > CAPTURE_MAX_SNAPLEN)
+    {
+      error = clib_error_return (0, "snaplen must not exceed %u",
+				 CAPTURE_MAX_SNAPLEN);
+      goto done;
+    }
+  if (!is_pow2 (cm->ring_size))
+    {
+      error = clib_error_return (0, "ring size must be a power of 2");
+      goto done;
+    }
+
+  /* pcapng interface ids and names, the writer can't format */
+  vec_foreach_index (i, cm->sw_if_indices)
+  {
+    u32 sw_if_index = cm->sw_if_indices[i];
+    vec_validate_init_empty (cm->if_id_by_sw_if_index, sw_if_index, ~0);
+    cm->if_id_by_sw_if_index[sw_if_index] = i;
+    vec_add1 (cm->if_names, format (0, "%U", format_vnet_sw_if_index_name,
+				    cm->vnet_main, sw_if_index));
+  }
+
+  cm->slot_size = round_pow2 (sizeof (capture_record_t) + cm->snaplen,
+			      CLIB_CACHE_LINE_BYTES);
+  vec_validate_aligned (cm->rings, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vec_foreach (r, cm->rings)
+  {
+    r->head = r->tail = 0;
+    r->n_captured = r->n_dropped = 0;
+    r->slots = clib_mem_alloc_aligned (cm->ring_size * cm->slot_size,
+				       CLIB_CACHE_LINE_BYTES);
+  }
+
+  cm->write_buffer = clib_mem_alloc (CAPTURE_WRITE_BUFFER_SIZE);
+  cm->write_buffer_len = 0;
+  cm->file_index = 0;
+  cm->n_files = 0;
+  cm->n_written = 0;
+  cm->n_bytes_written = 0;
+  cm->n_write_errors = 0;
+  cm->time_offset = unix_time_now () - vlib_time_now (vm);
+
+  /* open the first file here, so that a bad path is reported */
+  capture_writer_open (cm);
+  if (cm->fd < 0)
+    {
+      error = clib_error_return_unix (0, "open '%s'", cm->path);
+      goto done;
+    }
+
+  cm->writer_stop = 0;
+  rv = pthread_create (&cm->writer_thread, NULL, capture_writer_thread_fn,
+		       cm);
+  if (rv)
+    {
+      capture_writer_close (cm);
+      error = clib_error_return (0, "pthread_create returned %d", rv);
+      goto done;
+    }
+
+  cm->is_running = 1;
+  capture_enable_disable (cm, 1);
+
+done:
+  if (error)
+    capture_free (cm);
+  return error;
+}
+
+clib_error_t *
+capture_stop (void)
+{
+  capture_main_t *cm = &capture_main;
+
+  if (!cm->is_running)
+    return clib_error_return (0, "no capture running");
+
+  /* nothing is added to the rings after this, the writer drains them */
+  capture_enable_disable (cm, 0);
+  cm->writer_stop = 1;
+  pthread_join (cm->writer_thread, NULL);
+
+  cm->is_running = 0;
+  capture_free (cm);
+  return 0;
+}
+
+static clib_error_t *
+pcap_capture_start_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			       vlib_cli_command_t * cmd)
+{
+  capture_main_t *cm = &capture_main;
+  vnet_classify_main_t *vcm = &vnet_classify_main;
+  unformat_input_t _line_input, *line_input = &_line_input;
+  capture_args_t _a, *a = &_a;
+  clib_error_t *error = 0;
+  u32 sw_if_index, skip = 0, match = 0, tmp;
+  u8 *mask = 0, *match_vector = 0;
+  int rv;
+
+  memset (a, 0, sizeof (*a));
+  a->filter_table_index = ~0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, "file name required");
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "file %s", &a->file_name))
+	;
+      else if (unformat (line_input, "interface %U",
+			 unformat_vnet_sw_interface, cm->vnet_main,
+			 &sw_if_index))
+	vec_add1 (a->sw_if_indices, sw_if_index);
+      else if (unformat (line_input, "rx"))
+	a->rx = 1;
+      else if (unformat (line_input, "tx"))
+	a->tx = 1;
+      else if (unformat (line_input, "snaplen %u", &a->snaplen))
+	;
+      else if (unformat (line_input, "ring-size %u", &a->ring_size))
+	;
+      else if (unformat (line_input, "max-file-size %uM", &tmp))
+	a->max_file_size = (u64) tmp << 20;
+      else if (unformat (line_input, "max-file-size %uK", &tmp))
+	a->max_file_size = (u64) tmp << 10;
+      else if (unformat (line_input, "max-files %u", &a->max_files))
+	;
+      else if (a->filter_table_index == ~0
+	       && unformat (line_input, "filter table %u",
+			    &a->filter_table_index))
+	{
+	  if (pool_is_free_index (vcm->tables, a->filter_table_index))
+	    {
+	      a->filter_table_index = ~0;
+	      error = clib_error_return (0, "no such classify table");
+	      goto done;
+	    }
+	}
+      else if (a->filter_table_index == ~0
+	       && unformat (line_input, "filter mask %U",
+			    unformat_classify_mask, &mask, &skip, &match))
+	{
+	  /* the match syntax needs the table, so create it right away */
+	  rv = vnet_classify_add_del_table (vcm, mask, 32, 2 << 20, skip,
+					    match, ~0, ~0,
+					    &a->filter_table_index, 0, 0,
+					    1 /* is_add */ , 0);
+	  vec_free (mask);
+	  if (rv)
+	    {
+	      error = clib_error_return (0, "filter table create failed, "
+					 "error %d", rv);
+	      goto done;
+	    }
+	  a->filter_table_is_owned = 1;
+	}
+      else if (a->filter_table_is_owned
+	       && unformat (line_input, "match %U", unformat_classify_match,
+			    vcm, &match_vector, a->filter_table_index))
+	{
+	  rv = vnet_classify_add_del_session (vcm, a->filter_table_index,
+					      match_vector, 0, 0, 0, 0, 0,
+					      1 /* is_add */ );
+	  vec_free (match_vector);
+	  if (rv)
+	    {
+	      error = clib_error_return (0, "filter session add failed, "
+					 "error %d", rv);
+	      goto done;
+	    }
+	}
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (!a->rx && !a->tx)
+    a->rx = a->tx = 1;
+
+  vec_add1 (a->file_name, 0);
+  error = capture_start (a);
+  unformat_free (line_input);
+  return error;
+
+done:
+  if (a->filter_table_index != ~0 && a->filter_table_is_owned)
+    vnet_classify_add_del_table (vcm, 0, 0, 0, 0, 0, 0, 0,
+				 &a->filter_table_index, 0, 0, 0, 0);
+  vec_free (a->file_name);
+  vec_free (a->sw_if_indices);
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Capture packets received and/or transmitted on one or more interfaces
+ * into a pcapng file. Packets are copied, up to the snaplen, into
+ * per-thread rings by the graph nodes and written to the file by a
+ * background thread, so capturing does not stall packet processing. When
+ * the writer can't keep up with the packet rate, packets are not captured
+ * and counted as drops; a larger '<em>ring-size</em>' (a power of 2,
+ * default 4096 packets per thread) or a smaller '<em>snaplen</em>'
+ * (default 2048) helps.
+ *
+ * Both directions are captured unless '<em>rx</em>' or '<em>tx</em>' is
+ * given. With '<em>max-file-size</em>' the capture rotates through files
+ * named <file>.0, <file>.1, ..., starting over at <file>.0 after
+ * '<em>max-files</em>' files, if set.
+ *
+ * Packets are filtered either with an existing classify table chain, or
+ * with a classify mask and one or more matches, in the syntax of the
+ * '<em>classify table</em>' and '<em>classify session</em>' commands.
+ *
+ * @cliexpar
+ * Capture ICMP traffic to or from 10.0.0.1 received on GigabitEthernet2/0/0,
+ * in files of at most 100MB:
+ * @cliexcmd{pcap capture start file /tmp/icmp.pcapng interface GigabitEthernet2/0/0 rx max-file-size 100M max-files 10 filter mask l3 ip4 proto src match l3 ip4 proto 1 src 10.0.0.1}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (pcap_capture_start_command, static) = {
+  .path = "pcap capture start",
+  .short_help = "pcap capture start file <file> interface <interface> "
+    "[interface <interface> ...] [rx] [tx] [snaplen <n>] [ring-size <n>] "
+    "[max-file-size <n>M|K] [max-files <n>] "
+    "[filter table <n> | filter mask <mask> match <match> [match <match> ...]]",
+  .function = pcap_capture_start_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+pcap_capture_stop_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  return capture_stop ();
+}
+
+/*?
+ * Stop the running capture. Packets already in the rings are written
+ * before the file is closed.
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (pcap_capture_stop_command, static) = {
+  .path = "pcap capture stop",
+  .short_help = "pcap capture stop",
+  .function = pcap_capture_stop_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_pcap_capture_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  capture_main_t *cm = &capture_main;
+  capture_ring_t *r;
+  u32 *sw_if_index;
+
+  if (!cm->file_name)
+    {
+      vlib_cli_output (vm, "no capture");
+      return 0;
+    }
+
+  vlib_cli_output (vm, "capture %s, %s%s%s, snaplen %u, ring-size %u",
+		   cm->is_running ? "running" : "stopped",
+		   cm->rx ? "rx" : "", cm->rx && cm->tx ? " and " : "",
+		   cm->tx ? "tx" : "", cm->snaplen, cm->ring_size);
+  vec_foreach (sw_if_index, cm->sw_if_indices)
+    vlib_cli_output (vm, "  interface %U", format_vnet_sw_if_index_name,
+		     cm->vnet_main, sw_if_index[0]);
+  if (cm->is_running && cm->filter_table_index != ~0)
+    vlib_cli_output (vm, "  filter classify table %u",
+		     cm->filter_table_index);
+
+  vlib_cli_output (vm, "  %-10s%16s%16s", "thread", "captured", "dropped");
+  vec_foreach (r, cm->rings)
+    vlib_cli_output (vm, "  %-10u%16llu%16llu", r - cm->rings,
+		     r->n_captured, r->n_dropped);
+
+  vlib_cli_output (vm, "  writer: %llu packets, %llu bytes, %llu files, "
+		   "%llu write errors", cm->n_written, cm->n_bytes_written,
+		   cm->n_files, cm->n_write_errors);
+  vlib_cli_output (vm, "  file: %s", cm->path);
+  return 0;
+}
+
+/*?
+ * Show the state of the packet capture, with per-thread captured and
+ * dropped packet counts and the writer statistics.
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_pcap_capture_command, static) = {
+  .path = "show pcap capture",
+  .short_help = "show pcap capture",
+  .function = show_pcap_capture_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+capture_init (vlib_main_t * vm)
+{
+  capture_main_t *cm = &capture_main;
+
+  cm->vlib_main = vm;
+  cm->vnet_main = vnet_get_main ();
+  cm->filter_table_index = ~0;
+  cm->fd = -1;
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (capture_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
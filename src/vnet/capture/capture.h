@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __capture_h__
+#define __capture_h__
+
+#include <pthread.h>
+
+#include <vnet/vnet.h>
+#include <vnet/classify/vnet_classify.h>
+
+/*
+ * Packet capture to pcapng files. The capture nodes copy packets, up to
+ * the snaplen, into per-thread single producer / single consumer rings
+ * and never block: a full ring drops the packet. A background pthread
+ * drains the rings and writes the files.
+ */
+
+/* one ring slot, followed by up to snaplen bytes of packet data */
+typedef struct
+{
+  f64 timestamp;
+  u32 sw_if_index;
+  u32 n_bytes_in_packet;
+  u16 n_bytes_captured;
+  u8 is_tx;
+  u8 data[0];
+} capture_record_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* written by the capturing thread */
+  volatile u32 head;
+  u64 n_captured;
+  u64 n_dropped;
+
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  /* written by the writer thread */
+  volatile u32 tail;
+
+  u8 *slots;
+} capture_ring_t;
+
+typedef struct
+{
+  /* configuration, fixed while a capture runs */
+  u8 *file_name;
+  u32 *sw_if_indices;
+  u32 *if_id_by_sw_if_index;
+  /* interface names, formatted up front for the writer thread */
+  u8 **if_names;
+  u8 rx, tx;
+  u32 snaplen;
+  u32 ring_size;
+  u32 slot_size;
+  u64 max_file_size;
+  u32 max_files;
+  u32 filter_table_index;
+  u8 filter_table_is_owned;
+
+  /* added to vlib time to get unix time */
+  f64 time_offset;
+
+  u8 is_running;
+
+  /* per-thread rings */
+  capture_ring_t *rings;
+
+  /* writer thread state */
+  pthread_t writer_thread;
+  volatile u8 writer_stop;
+  int fd;
+  u32 file_index;
+  u64 file_bytes;
+  u64 n_files;
+  u64 n_written;
+  u64 n_bytes_written;
+  u64 n_write_errors;
+  u8 *write_buffer;
+  u32 write_buffer_len;
+  char path[512];
+
+  /* convenience */
+  vlib_main_t *vlib_main;
+  vnet_main_t *vnet_main;
+} capture_main_t;
+
+extern capture_main_t capture_main;
+
+typedef struct
+{
+  u8 *file_name;
+  u32 *sw_if_indices;
+  u8 rx, tx;
+  u32 snaplen;
+  u32 ring_size;
+  u64 max_file_size;
+  u32 max_files;
+  /* ~0 for no filter */
+  u32 filter_table_index;
+  u8 filter_table_is_owned;
+} capture_args_t;
+
+clib_error_t *capture_start (capture_args_t * a);
+clib_error_t *capture_stop (void);
+
+#endif /* __capture_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
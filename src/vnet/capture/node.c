@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+#include <vnet/feature/feature.h>
+
+#include <vnet/capture/capture.h>
+
+typedef struct
+{
+  u32 sw_if_index;
+  u8 is_captured;
+  u8 is_dropped;
+} capture_trace_t;
+
+static u8 *
+format_capture_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  capture_trace_t *t = va_arg (*args, capture_trace_t *);
+
+  s = format (s, "pcap capture: %U %s", format_vnet_sw_if_index_name,
+	      vnet_get_main (), t->sw_if_index,
+	      t->is_dropped ? "dropped, ring full" :
+	      t->is_captured ? "captured" : "filtered out");
+  return s;
+}
+
+#define foreach_capture_error				\
+_(CAPTURED, "packets captured")				\
+_(FILTERED, "packets not matching the capture filter")	\
+_(RING_FULL, "packets not captured, writer too slow")
+
+typedef enum
+{
+#define _(sym,str) CAPTURE_ERROR_##sym,
+  foreach_capture_error
+#undef _
+    CAPTURE_N_ERROR,
+} capture_error_t;
+
+static char *capture_error_strings[] = {
+#define _(sym,string) string,
+  foreach_capture_error
+#undef _
+};
+
+static_always_inline int
+capture_filter_match (capture_main_t * cm, vlib_buffer_t * b, f64 now)
+{
+  vnet_classify_main_t *vcm = &vnet_classify_main;
+  vnet_classify_table_t *t;
+  u8 *h = vlib_buffer_get_current (b);
+  u32 table_index = cm->filter_table_index;
+
+  while (table_index != ~0)
+    {
+      t = pool_elt_at_index (vcm->tables, table_index);
+      if (vnet_classify_find_entry (t, h, vnet_classify_hash_packet (t, h),
+				    now))
+	return 1;
+      table_index = t->next_table_index;
+    }
+  return 0;
+}
+
+/* copy up to snaplen bytes into the next ring slot, 0 if it is full */
+static_always_inline int
+capture_packet (vlib_main_t * vm, capture_main_t * cm, capture_ring_t * r,
+		vlib_buffer_t * b, u32 sw_if_index, u8 is_tx, f64 now)
+{
+  capture_record_t *rec;
+  u32 head = r->head;
+  u32 n_left;
+  u8 *d;
+
+  if (PREDICT_FALSE (head - r->tail >= cm->ring_size))
+    {
+      r->n_dropped++;
+      return 0;
+    }
+
+  rec = (capture_record_t *) (r->slots + (head & (cm->ring_size - 1)) *
+			      cm->slot_size);
+  rec->timestamp = now;
+  rec->sw_if_index = sw_if_index;
+  rec->is_tx = is_tx;
+  rec->n_bytes_in_packet = vlib_buffer_length_in_chain (vm, b);
+  n_left = rec->n_bytes_captured = clib_min (rec->n_bytes_in_packet,
+					     cm->snaplen);
+  d = rec->data;
+
+  while (1)
+    {
+      u32 n = clib_min (n_left, b->current_length);
+      clib_memcpy (d, vlib_buffer_get_current (b), n);
+      n_left -= n;
+      d += n;
+      if (n_left == 0 || !(b->flags & VLIB_BUFFER_NEXT_PRESENT))
+	break;
+      b = vlib_get_buffer (vm, b->next_buffer);
+    }
+
+  /* the writer must see the record before the new head */
+  CLIB_MEMORY_STORE_BARRIER ();
+  r->head = head + 1;
+  r->n_captured++;
+  return 1;
+}
+
+static_always_inline uword
+capture_node_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+		     vlib_frame_t * frame, vlib_rx_or_tx_t rxtx)
+{
+  capture_main_t *cm = &capture_main;
+  capture_ring_t *r = vec_elt_at_index (cm->rings, vm->thread_index);
+  u32 n_left_from, *from, *to_next;
+  u32 next_index = node->cached_next_index;
+  u32 n_captured = 0, n_filtered = 0, n_dropped = 0;
+  f64 now = vlib_time_now (vm);
+
+  from = vlib_frame_vector_args (frame);
+  n_left_from = frame->n_vectors;
+
+  while (n_left_from > 0)
+    {
+      u32 n_left_to_next;
+
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+
+      while (n_left_from > 0 && n_left_to_next > 0)
+	{
+	  u32 bi0;
+	  vlib_buffer_t *b0;
+	  u32 sw_if_index0;
+	  u32 next0 = 0;
+	  u8 is_captured = 0, is_dropped = 0;
+
+	  /* speculatively enqueue b0 to the current next frame */
+	  to_next[0] = bi0 = from[0];
+	  to_next += 1;
+	  n_left_to_next -= 1;
+	  from += 1;
+	  n_left_from -= 1;
+
+	  b0 = vlib_get_buffer (vm, bi0);
+	  sw_if_index0 = vnet_buffer (b0)->sw_if_index[rxtx];
+
+	  if (n_left_from > 0)
+	    vlib_prefetch_buffer_with_index (vm, from[0], LOAD);
+
+	  if (cm->filter_table_index != ~0
+	      && !capture_filter_match (cm, b0, now))
+	    n_filtered++;
+	  else if (capture_packet (vm, cm, r, b0, sw_if_index0,
+				   rxtx == VLIB_TX, now))
+	    is_captured = 1;
+	  else
+	    is_dropped = 1;
+
+	  n_captured += is_captured;
+	  n_dropped += is_dropped;
+
+	  if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_IS_TRACED))
+	    {
+	      capture_trace_t *t = vlib_add_trace (vm, node, b0, sizeof (*t));
+	      t->sw_if_index = sw_if_index0;
+	      t->is_captured = is_captured;
+	      t->is_dropped = is_dropped;
+	    }
+
+	  vnet_feature_next (sw_if_index0, &next0, b0);
+
+	  /* verify speculative enqueue, maybe switch current next frame */
+	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index, to_next,
+					   n_left_to_next, bi0, next0);
+	}
+
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+
+  vlib_node_increment_counter (vm, node->node_index, CAPTURE_ERROR_CAPTURED,
+			       n_captured);
+  if (n_filtered)
+    vlib_node_increment_counter (vm, node->node_index,
+				 CAPTURE_ERROR_FILTERED, n_filtered);
+  if (n_dropped)
+    vlib_node_increment_counter (vm, node->node_index,
+				 CAPTURE_ERROR_RING_FULL, n_dropped);
+
+  return frame->n_vectors;
+}
+
+static uword
+capture_rx_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
+		    vlib_frame_t * frame)
+{
+  return capture_node_inline (vm, node, frame, VLIB_RX);
+}
+
+static uword
+capture_tx_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
+		    vlib_frame_t * frame)
+{
+  return capture_node_inline (vm, node, frame, VLIB_TX);
+}
+
+#define capture_node_defs                        \
+  .vector_size = sizeof (u32),                   \
+  .format_trace = format_capture_trace,          \
+  .type = VLIB_NODE_TYPE_INTERNAL,               \
+  .n_errors = ARRAY_LEN(capture_error_strings),  \
+  .error_strings = capture_error_strings,        \
+  .n_next_nodes = 0,                             \
+  .next_nodes = {                                \
+    [0] = "error-drop"                           \
+  }
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (capture_rx_node) = {
+  capture_node_defs,
+  .function = capture_rx_node_fn,
+  .name = "pcap-capture-rx",
+};
+
+VLIB_NODE_FUNCTION_MULTIARCH (capture_rx_node, capture_rx_node_fn)
+
+VLIB_REGISTER_NODE (capture_tx_node) = {
+  capture_node_defs,
+  .function = capture_tx_node_fn,
+  .name = "pcap-capture-tx",
+};
+
+VLIB_NODE_FUNCTION_MULTIARCH (capture_tx_node, capture_tx_node_fn)
+
+VNET_FEATURE_INIT (capture_rx, static) = {
+  .arc_name = "device-input",
+  .node_name = "pcap-capture-rx",
+  .runs_before = VNET_FEATURES ("ethernet-input"),
+};
+
+VNET_FEATURE_INIT (capture_tx, static) = {
+  .arc_name = "interface-output",
+  .node_name = "pcap-capture-tx",
+  .runs_before = VNET_FEATURES ("interface-tx"),
+};
+/* *INDENT-ON* */
+
+#undef capture_node_defs
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
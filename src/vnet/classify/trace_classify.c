@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Classifier filter for sampled packet tracing ("trace sample"): a packet
+ * seen by a sampling node is only considered for sampling when its first
+ * buffer matches a session of the filter's classify table chain.
+ */
+
+#include <vnet/classify/vnet_classify.h>
+
+typedef struct
+{
+  /* Head of the filter's table chain, ~0 when there is no filter */
+  u32 table_index;
+  /* The table was created by "trace sample filter mask" */
+  u8 table_is_owned;
+} trace_classify_main_t;
+
+static trace_classify_main_t trace_classify_main = {
+  .table_index = ~0,
+};
+
+static int
+trace_classify_filter (vlib_main_t * vm, vlib_buffer_t * b)
+{
+  vnet_classify_main_t *vcm = &vnet_classify_main;
+  vnet_classify_table_t *t;
+  u8 *h = vlib_buffer_get_current (b);
+  u32 table_index = trace_classify_main.table_index;
+  f64 now = vlib_time_now (vm);
+
+  while (table_index != ~0)
+    {
+      t = pool_elt_at_index (vcm->tables, table_index);
+      if (vnet_classify_find_entry (t, h, vnet_classify_hash_packet (t, h),
+				    now))
+	return 1;
+      table_index = t->next_table_index;
+    }
+  return 0;
+}
+
+/* Replace the filter, the threads must be stopped at the barrier */
+static void
+trace_classify_set (u32 table_index, u8 table_is_owned)
+{
+  trace_classify_main_t *tcm = &trace_classify_main;
+
+  if (tcm->table_index != ~0 && tcm->table_is_owned)
+    vnet_classify_add_del_table (&vnet_classify_main, 0, 0, 0, 0, 0, 0, 0,
+				 &tcm->table_index, 0, 0, 0, 0);
+  tcm->table_index = table_index;
+  tcm->table_is_owned = table_is_owned;
+  vlib_trace_sample_set_filter (table_index != ~0 ?
+				trace_classify_filter : 0);
+}
+
+static clib_error_t *
+trace_sample_filter_command_fn (vlib_main_t * vm, unformat_input_t * input,
+				vlib_cli_command_t * cmd)
+{
+  vnet_classify_main_t *vcm = &vnet_classify_main;
+  unformat_input_t _line_input, *line_input = &_line_input;
+  u32 table_index = ~0, skip = 0, match = 0;
+  u8 *mask = 0, *match_vector = 0;
+  u8 table_is_owned = 0, none = 0;
+  clib_error_t *error = 0;
+  int rv;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, "expected 'table', 'mask' or 'none'");
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "none"))
+	none = 1;
+      else if (table_index == ~0
+	       && unformat (line_input, "table %u", &table_index))
+	{
+	  if (pool_is_free_index (vcm->tables, table_index))
+	    {
+	      table_index = ~0;
+	      error = clib_error_return (0, "no such classify table");
+	      goto done;
+	    }
+	}
+      else if (table_index == ~0
+	       && unformat (line_input, "mask %U",
+			    unformat_classify_mask, &mask, &skip, &match))
+	{
+	  /* the match syntax needs the table, so create it right away */
+	  rv = vnet_classify_add_del_table (vcm, mask, 32, 2 << 20, skip,
+					    match, ~0, ~0, &table_index, 0, 0,
+					    1 /* is_add */ , 0);
+	  vec_free (mask);
+	  if (rv)
+	    {
+	      error = clib_error_return (0, "filter table create failed, "
+					 "error %d", rv);
+	      goto done;
+	    }
+	  table_is_owned = 1;
+	}
+      else if (table_is_owned
+	       && unformat (line_input, "match %U", unformat_classify_match,
+			    vcm, &match_vector, table_index))
+	{
+	  rv = vnet_classify_add_del_session (vcm, table_index,
+					      match_vector, 0, 0, 0, 0, 0,
+					      1 /* is_add */ );
+	  vec_free (match_vector);
+	  if (rv)
+	    {
+	      error = clib_error_return (0, "filter session add failed, "
+					 "error %d", rv);
+	      goto done;
+	    }
+	}
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (!none && table_index == ~0)
+    {
+      error = clib_error_return (0, "expected 'table', 'mask' or 'none'");
+      goto done;
+    }
+
+  vlib_worker_thread_barrier_sync (vm);
+  trace_classify_set (table_index, table_is_owned);
+  vlib_worker_thread_barrier_release (vm);
+  unformat_free (line_input);
+  return 0;
+
+done:
+  if (table_index != ~0 && table_is_owned)
+    vnet_classify_add_del_table (vcm, 0, 0, 0, 0, 0, 0, 0,
+				 &table_index, 0, 0, 0, 0);
+  unformat_free (line_input);
+  return error;
+}
+
+/*?
+ * Only sample packets which match a classify table chain, see
+ * '<em>trace sample</em>'. The filter is either an existing table chain,
+ * or a mask with one or more matches, in the syntax of the
+ * '<em>classify table</em>' and '<em>classify session</em>' commands,
+ * compiled into a table owned by the filter. The first buffer of each
+ * packet is matched from its current data, at the sampling node.
+ *
+ * @cliexpar
+ * Trace every ICMP packet from 10.0.0.1 which dpdk-input receives and
+ * gets dropped:
+ * @cliexcmd{trace sample filter mask l3 ip4 proto src match l3 ip4 proto 1 src 10.0.0.1}
+ * @cliexcmd{trace sample dpdk-input drops-only}
+ * Remove the filter:
+ * @cliexcmd{trace sample filter none}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (trace_sample_filter_command, static) = {
+  .path = "trace sample filter",
+  .short_help = "trace sample filter {table <n> | mask <mask> "
+    "match <match> [match <match> ...] | none}",
+  .function = trace_sample_filter_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,626 @@
+/*
+ *------------------------------------------------------------------
+ * af_xdp.c - linux kernel AF_XDP socket interface
+ *
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <net/if.h>
+#include <linux/if_link.h>
+
+#include <vppinfra/linux/sysfs.h>
+#include <vlib/vlib.h>
+#include <vlib/unix/unix.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/devices/netlink.h>
+
+#include <vnet/devices/af_xdp/af_xdp.h>
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+af_xdp_main_t af_xdp_main;
+
+#define AF_XDP_DEFAULT_QUEUE_SIZE 1024
+
+static u32
+af_xdp_eth_flag_change (vnet_main_t * vnm, vnet_hw_interface_t * hi,
+			u32 flags)
+{
+  clib_error_t *error;
+  u8 *s;
+  af_xdp_main_t *axm = &af_xdp_main;
+  af_xdp_if_t *axif = pool_elt_at_index (axm->interfaces, hi->dev_instance);
+
+  if (ETHERNET_INTERFACE_FLAG_MTU == (flags & ETHERNET_INTERFACE_FLAG_MTU))
+    {
+      s = format (0, "/sys/class/net/%s/mtu%c", axif->host_if_name, 0);
+
+      error = clib_sysfs_write ((char *) s, "%d", hi->max_packet_bytes);
+      vec_free (s);
+
+      if (error)
+	{
+	  clib_error_report (error);
+	  return VNET_API_ERROR_SYSCALL_ERROR_1;
+	}
+    }
+
+  return 0;
+}
+
+static clib_error_t *
+af_xdp_fd_read_ready (clib_file_t * uf)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  af_xdp_if_t *axif =
+    pool_elt_at_index (axm->interfaces, uf->private_data >> 16);
+
+  /* Schedule the rx node */
+  vnet_device_input_set_interrupt_pending (vnm, axif->hw_if_index,
+					   uf->private_data & 0xffff);
+
+  return 0;
+}
+
+static int
+af_xdp_bpf (int cmd, union bpf_attr *attr)
+{
+  return syscall (__NR_bpf, cmd, attr, sizeof (*attr));
+}
+
+static int
+af_xdp_bpf_map_update (int map_fd, u32 key, int value)
+{
+  union bpf_attr attr;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.map_fd = map_fd;
+  attr.key = pointer_to_uword (&key);
+  attr.value = pointer_to_uword (&value);
+  attr.flags = BPF_ANY;
+  return af_xdp_bpf (BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+/*
+ * Create the XSKMAP holding one socket per queue and the program
+ * redirecting every packet received on a host queue to its socket.
+ * Queues without a socket fall back to the kernel stack.
+ */
+static clib_error_t *
+af_xdp_load_program (af_xdp_if_t * axif, u32 n_queues)
+{
+  union bpf_attr attr;
+  static char license[] = "Apache-2.0";
+  /* *INDENT-OFF* */
+  struct bpf_insn prog[] = {
+    /* r2 = ctx->rx_queue_index */
+    { .code = BPF_LDX | BPF_MEM | BPF_W, .dst_reg = BPF_REG_2,
+      .src_reg = BPF_REG_1,
+      .off = STRUCT_OFFSET_OF (struct xdp_md, rx_queue_index) },
+    /* r1 = xsk map, a 64 bit immediate load takes two instructions */
+    { .code = BPF_LD | BPF_DW | BPF_IMM, .dst_reg = BPF_REG_1,
+      .src_reg = BPF_PSEUDO_MAP_FD, .imm = axif->xsk_map_fd },
+    { .code = 0 },
+    /* r3 = action if no socket is bound to the queue */
+    { .code = BPF_ALU64 | BPF_MOV | BPF_K, .dst_reg = BPF_REG_3,
+      .imm = XDP_PASS },
+    { .code = BPF_JMP | BPF_CALL, .imm = BPF_FUNC_redirect_map },
+    { .code = BPF_JMP | BPF_EXIT },
+  };
+  /* *INDENT-ON* */
+
+  memset (&attr, 0, sizeof (attr));
+  attr.map_type = BPF_MAP_TYPE_XSKMAP;
+  attr.key_size = sizeof (u32);
+  attr.value_size = sizeof (int);
+  attr.max_entries = n_queues;
+  if ((axif->xsk_map_fd = af_xdp_bpf (BPF_MAP_CREATE, &attr)) < 0)
+    return clib_error_return_unix (0, "bpf(BPF_MAP_CREATE)");
+
+  /* the map fd is only known now */
+  prog[1].imm = axif->xsk_map_fd;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insns = pointer_to_uword (prog);
+  attr.insn_cnt = ARRAY_LEN (prog);
+  attr.license = pointer_to_uword (license);
+  if ((axif->prog_fd = af_xdp_bpf (BPF_PROG_LOAD, &attr)) < 0)
+    return clib_error_return_unix (0, "bpf(BPF_PROG_LOAD)");
+
+  return 0;
+}
+
+/*
+ * Only native XDP can be combined with zero-copy sockets, generic XDP
+ * works with any driver.
+ */
+static clib_error_t *
+af_xdp_attach_program (af_xdp_if_t * axif, af_xdp_mode_t mode)
+{
+  clib_error_t *error;
+  u32 flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_DRV_MODE;
+
+  error = vnet_netlink_set_link_xdp_fd (axif->host_if_index, axif->prog_fd,
+					flags);
+  if (error && mode != AF_XDP_MODE_ZERO_COPY)
+    {
+      clib_error_free (error);
+      flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_SKB_MODE;
+      error = vnet_netlink_set_link_xdp_fd (axif->host_if_index,
+					    axif->prog_fd, flags);
+    }
+
+  if (error)
+    return clib_error_return (error, "cannot attach XDP program to '%s'",
+			      axif->host_if_name);
+
+  axif->xdp_flags = flags;
+  return 0;
+}
+
+static clib_error_t *
+af_xdp_ring_mmap (int fd, af_xdp_ring_t * r, struct xdp_ring_offset *off,
+		  u64 pgoff, u32 size, u32 desc_sz)
+{
+  r->map_size = off->desc + size * desc_sz;
+  r->map = mmap (0, r->map_size, PROT_READ | PROT_WRITE,
+		 MAP_SHARED | MAP_POPULATE, fd, pgoff);
+  if (r->map == MAP_FAILED)
+    {
+      r->map = 0;
+      return clib_error_return_unix (0, "mmap");
+    }
+
+  r->producer = r->map + off->producer;
+  r->consumer = r->map + off->consumer;
+  r->flags = r->map + off->flags;
+  r->desc = r->map + off->desc;
+  r->size = size;
+  return 0;
+}
+
+static clib_error_t *
+af_xdp_socket_bind (af_xdp_if_t * axif, af_xdp_queue_t * q, u16 flags)
+{
+  struct sockaddr_xdp sxdp = { 0 };
+
+  sxdp.sxdp_family = AF_XDP;
+  sxdp.sxdp_ifindex = axif->host_if_index;
+  sxdp.sxdp_queue_id = q->queue_id;
+  sxdp.sxdp_flags = flags;
+  if (bind (q->fd, (struct sockaddr *) &sxdp, sizeof (sxdp)) < 0)
+    return clib_error_return_unix (0, "bind queue %u of '%s'", q->queue_id,
+				   axif->host_if_name);
+  return 0;
+}
+
+static clib_error_t *
+af_xdp_queue_init (vlib_main_t * vm, af_xdp_if_t * axif, u16 qid,
+		   af_xdp_mode_t mode)
+{
+  vlib_buffer_main_t *bm = &buffer_main;
+  af_xdp_queue_t *q = vec_elt_at_index (axif->queues, qid);
+  struct xdp_umem_reg umem = { 0 };
+  struct xdp_mmap_offsets off;
+  socklen_t optlen = sizeof (off);
+  clib_file_t template = { 0 };
+  clib_error_t *error;
+  int rxq_size = axif->rxq_size;
+  int txq_size = axif->txq_size;
+
+  if ((q->fd = socket (AF_XDP, SOCK_RAW, 0)) < 0)
+    return clib_error_return_unix (0, "socket(AF_XDP)");
+
+  umem.addr = bm->buffer_mem_start;
+  umem.len = round_pow2 (bm->buffer_mem_size, clib_mem_get_page_size ());
+  umem.chunk_size = XDP_PACKET_HEADROOM + VLIB_BUFFER_DEFAULT_FREE_LIST_BYTES;
+  umem.headroom = 0;
+  umem.flags = XDP_UMEM_UNALIGNED_CHUNK_FLAG;
+  if (setsockopt (q->fd, SOL_XDP, XDP_UMEM_REG, &umem, sizeof (umem)) < 0)
+    return clib_error_return_unix (0, "setsockopt(XDP_UMEM_REG)");
+
+  /* the fill ring can hold every rx descriptor, the completion ring
+     every tx descriptor */
+  if (setsockopt (q->fd, SOL_XDP, XDP_UMEM_FILL_RING, &rxq_size,
+		  sizeof (int)) < 0 ||
+      setsockopt (q->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &txq_size,
+		  sizeof (int)) < 0 ||
+      setsockopt (q->fd, SOL_XDP, XDP_RX_RING, &rxq_size, sizeof (int)) < 0
+      || setsockopt (q->fd, SOL_XDP, XDP_TX_RING, &txq_size,
+		     sizeof (int)) < 0)
+    return clib_error_return_unix (0, "setsockopt(XDP rings)");
+
+  if (getsockopt (q->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0)
+    return clib_error_return_unix (0, "getsockopt(XDP_MMAP_OFFSETS)");
+
+  if ((error = af_xdp_ring_mmap (q->fd, &q->rx, &off.rx, XDP_PGOFF_RX_RING,
+				 rxq_size, sizeof (struct xdp_desc))) ||
+      (error = af_xdp_ring_mmap (q->fd, &q->tx, &off.tx, XDP_PGOFF_TX_RING,
+				 txq_size, sizeof (struct xdp_desc))) ||
+      (error = af_xdp_ring_mmap (q->fd, &q->fill, &off.fr,
+				 XDP_UMEM_PGOFF_FILL_RING, rxq_size,
+				 sizeof (u64))) ||
+      (error = af_xdp_ring_mmap (q->fd, &q->completion, &off.cr,
+				 XDP_UMEM_PGOFF_COMPLETION_RING, txq_size,
+				 sizeof (u64))))
+    return error;
+
+  /* zero-copy needs driver support, fall back to copy mode unless it
+     was explicitly requested */
+  error = 0;
+  if (mode != AF_XDP_MODE_COPY && (axif->xdp_flags & XDP_FLAGS_DRV_MODE))
+    {
+      error = af_xdp_socket_bind (axif, q, XDP_ZEROCOPY |
+				  XDP_USE_NEED_WAKEUP);
+      if (error == 0)
+	q->is_zero_copy = 1;
+      else if (mode == AF_XDP_MODE_ZERO_COPY)
+	return error;
+    }
+
+  if (!q->is_zero_copy)
+    {
+      clib_error_free (error);
+      if ((error = af_xdp_socket_bind (axif, q, XDP_COPY)))
+	return error;
+    }
+
+  if (af_xdp_bpf_map_update (axif->xsk_map_fd, q->queue_id, q->fd) < 0)
+    return clib_error_return_unix (0, "bpf(BPF_MAP_UPDATE_ELEM)");
+
+  af_xdp_refill (vm, q);
+
+  template.read_function = af_xdp_fd_read_ready;
+  template.file_descriptor = q->fd;
+  template.private_data = axif->dev_instance << 16 | qid;
+  template.flags = UNIX_FILE_EVENT_EDGE_TRIGGERED;
+  template.description = format (0, "%U queue %u",
+				 format_af_xdp_device_name,
+				 axif->dev_instance, qid);
+  q->clib_file_index = clib_file_add (&file_main, &template);
+
+  return 0;
+}
+
+static void
+af_xdp_ring_free_buffers (vlib_main_t * vm, af_xdp_ring_t * r, int is_desc)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  u32 *bufs = axm->buffers[vm->thread_index];
+  u32 cons = *r->consumer;
+  u32 n = *r->producer - cons;
+  u32 mask = r->size - 1;
+  u64 addr;
+  u32 i;
+
+  vec_reset_length (bufs);
+  for (i = 0; i < n; i++)
+    {
+      if (is_desc)
+	addr = ((struct xdp_desc *) r->desc)[(cons + i) & mask].addr;
+      else
+	addr = ((u64 *) r->desc)[(cons + i) & mask];
+      vec_add1 (bufs, af_xdp_umem_addr_to_buffer_index (addr));
+    }
+
+  vlib_buffer_free (vm, bufs, vec_len (bufs));
+  axm->buffers[vm->thread_index] = bufs;
+}
+
+static void
+af_xdp_queue_free (vlib_main_t * vm, af_xdp_queue_t * q)
+{
+  af_xdp_ring_t *r;
+
+  if (q->clib_file_index != ~0)
+    clib_file_del_by_index (&file_main, q->clib_file_index);
+  else if (q->fd != -1)
+    close (q->fd);
+
+  /* the socket is gone, take back the buffers sitting in the rings;
+     buffers a zero-copy driver had already taken are lost */
+  if (q->fill.map)
+    af_xdp_ring_free_buffers (vm, &q->fill, 0);
+  if (q->rx.map)
+    af_xdp_ring_free_buffers (vm, &q->rx, 1);
+  if (q->tx.map)
+    af_xdp_ring_free_buffers (vm, &q->tx, 1);
+  if (q->completion.map)
+    af_xdp_ring_free_buffers (vm, &q->completion, 0);
+
+  for (r = &q->rx; r <= &q->completion; r++)
+    if (r->map)
+      munmap (r->map, r->map_size);
+
+  clib_spinlock_free (&q->lockp);
+}
+
+static void
+af_xdp_if_free (vlib_main_t * vm, af_xdp_if_t * axif)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  af_xdp_queue_t *q;
+  clib_error_t *error;
+
+  if (axif->xdp_flags)
+    {
+      error = vnet_netlink_set_link_xdp_fd (axif->host_if_index, -1,
+					    axif->xdp_flags &
+					    XDP_FLAGS_MODES);
+      if (error)
+	clib_error_report (error);
+    }
+
+  vec_foreach (q, axif->queues) af_xdp_queue_free (vm, q);
+  vec_free (axif->queues);
+
+  if (axif->prog_fd != -1)
+    close (axif->prog_fd);
+  if (axif->xsk_map_fd != -1)
+    close (axif->xsk_map_fd);
+
+  if (axif->host_if_name)
+    {
+      mhash_unset (&axm->if_index_by_host_if_name, axif->host_if_name, 0);
+      vec_free (axif->host_if_name);
+    }
+
+  memset (axif, 0, sizeof (*axif));
+  pool_put (axm->interfaces, axif);
+}
+
+void
+af_xdp_create_if (vlib_main_t * vm, af_xdp_create_if_args_t * args)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u16 num_queues = args->num_queues ? args->num_queues : 1;
+  af_xdp_if_t *axif;
+  af_xdp_queue_t *q;
+  vnet_sw_interface_t *sw;
+  vnet_hw_interface_t *hw;
+  u8 hw_addr[6];
+  int host_if_index;
+  uword *p, if_index;
+  u16 qid;
+
+  if (args->rxq_size == 0)
+    args->rxq_size = AF_XDP_DEFAULT_QUEUE_SIZE;
+  if (args->txq_size == 0)
+    args->txq_size = AF_XDP_DEFAULT_QUEUE_SIZE;
+
+  if (!is_pow2 (args->rxq_size) || !is_pow2 (args->txq_size))
+    {
+      args->rv = VNET_API_ERROR_INVALID_VALUE;
+      args->error = clib_error_return (0, "queue size must be a power of 2");
+      return;
+    }
+
+  /* rx packets must land at b->data, behind the kernel headroom */
+  if (STRUCT_OFFSET_OF (vlib_buffer_t, data) < XDP_PACKET_HEADROOM)
+    {
+      args->rv = VNET_API_ERROR_UNSUPPORTED;
+      args->error = clib_error_return (0, "buffer pre-data too small for "
+				       "AF_XDP");
+      return;
+    }
+
+  p = mhash_get (&axm->if_index_by_host_if_name, args->host_if_name);
+  if (p)
+    {
+      axif = pool_elt_at_index (axm->interfaces, p[0]);
+      args->sw_if_index = axif->sw_if_index;
+      args->rv = VNET_API_ERROR_IF_ALREADY_EXISTS;
+      args->error = clib_error_return (0, "interface already exists");
+      return;
+    }
+
+  host_if_index = if_nametoindex ((char *) args->host_if_name);
+  if (!host_if_index)
+    {
+      args->rv = VNET_API_ERROR_INVALID_INTERFACE;
+      args->error = clib_error_return (0, "host interface '%s' not found",
+				       args->host_if_name);
+      return;
+    }
+
+  pool_get (axm->interfaces, axif);
+  memset (axif, 0, sizeof (*axif));
+  axif->dev_instance = axif - axm->interfaces;
+  axif->host_if_name = vec_dup (args->host_if_name);
+  axif->host_if_index = host_if_index;
+  axif->prog_fd = -1;
+  axif->xsk_map_fd = -1;
+  axif->rxq_size = args->rxq_size;
+  axif->txq_size = args->txq_size;
+  axif->per_interface_next_index = ~0;
+
+  if ((args->error = af_xdp_load_program (axif, num_queues)) ||
+      (args->error = af_xdp_attach_program (axif, args->mode)))
+    {
+      args->rv = VNET_API_ERROR_SYSCALL_ERROR_1;
+      goto error;
+    }
+
+  vec_validate_aligned (axif->queues, num_queues - 1, CLIB_CACHE_LINE_BYTES);
+  vec_foreach (q, axif->queues)
+  {
+    q->fd = -1;
+    q->clib_file_index = ~0;
+    q->queue_id = q - axif->queues;
+  }
+
+  for (qid = 0; qid < num_queues; qid++)
+    if ((args->error = af_xdp_queue_init (vm, axif, qid, args->mode)))
+      {
+	args->rv = VNET_API_ERROR_SYSCALL_ERROR_2;
+	goto error;
+      }
+
+  /* the host interface keeps receiving for our MAC address, so use it
+     unless told otherwise */
+  if (args->hw_addr_set)
+    clib_memcpy (hw_addr, args->hw_addr, 6);
+  else
+    {
+      struct ifreq ifr = { 0 };
+      int fd = socket (AF_UNIX, SOCK_DGRAM, 0);
+
+      ifr.ifr_ifindex = host_if_index;
+      strncpy (ifr.ifr_name, (char *) args->host_if_name,
+	       sizeof (ifr.ifr_name) - 1);
+      if (fd < 0 || ioctl (fd, SIOCGIFHWADDR, &ifr) < 0)
+	{
+	  args->rv = VNET_API_ERROR_SYSCALL_ERROR_3;
+	  args->error = clib_error_return_unix (0, "ioctl(SIOCGIFHWADDR)");
+	  if (fd >= 0)
+	    close (fd);
+	  goto error;
+	}
+      close (fd);
+      clib_memcpy (hw_addr, ifr.ifr_hwaddr.sa_data, 6);
+    }
+
+  args->error = ethernet_register_interface (vnm, af_xdp_device_class.index,
+					     axif->dev_instance, hw_addr,
+					     &axif->hw_if_index,
+					     af_xdp_eth_flag_change);
+  if (args->error)
+    {
+      args->rv = VNET_API_ERROR_INVALID_REGISTRATION;
+      goto error;
+    }
+
+  if_index = axif->dev_instance;
+  mhash_set_mem (&axm->if_index_by_host_if_name, axif->host_if_name,
+		 &if_index, 0);
+
+  sw = vnet_get_hw_sw_interface (vnm, axif->hw_if_index);
+  hw = vnet_get_hw_interface (vnm, axif->hw_if_index);
+  axif->sw_if_index = args->sw_if_index = sw->sw_if_index;
+  hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_INT_MODE;
+  vnet_hw_interface_set_input_node (vnm, axif->hw_if_index,
+				    af_xdp_input_node.index);
+
+  /* spread the rx queues over the workers */
+  for (qid = 0; qid < num_queues; qid++)
+    {
+      vnet_hw_interface_assign_rx_thread (vnm, axif->hw_if_index, qid, ~0);
+      vnet_hw_interface_set_rx_mode (vnm, axif->hw_if_index, qid,
+				     VNET_HW_INTERFACE_RX_MODE_DEFAULT);
+    }
+
+  /* tx queues are only shared when there are more threads than queues */
+  if (tm->n_vlib_mains > num_queues)
+    vec_foreach (q, axif->queues) clib_spinlock_init (&q->lockp);
+
+  return;
+
+error:
+  af_xdp_if_free (vm, axif);
+}
+
+int
+af_xdp_delete_if (vlib_main_t * vm, u32 sw_if_index)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  af_xdp_main_t *axm = &af_xdp_main;
+  vnet_hw_interface_t *hw;
+  af_xdp_if_t *axif;
+  u16 qid;
+
+  hw = vnet_get_sup_hw_interface (vnm, sw_if_index);
+  if (hw == NULL || af_xdp_device_class.index != hw->dev_class_index)
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  axif = pool_elt_at_index (axm->interfaces, hw->dev_instance);
+
+  /* bring down the interface */
+  vnet_hw_interface_set_flags (vnm, axif->hw_if_index, 0);
+  vnet_sw_interface_set_flags (vnm, axif->sw_if_index, 0);
+  for (qid = 0; qid < vec_len (axif->queues); qid++)
+    vnet_hw_interface_unassign_rx_thread (vnm, axif->hw_if_index, qid);
+
+  ethernet_delete_interface (vnm, axif->hw_if_index);
+
+  af_xdp_if_free (vm, axif);
+
+  return 0;
+}
+
+u8 *
+format_af_xdp_mode (u8 * s, va_list * args)
+{
+  af_xdp_mode_t mode = va_arg (*args, af_xdp_mode_t);
+  char *str = 0;
+
+  switch (mode)
+    {
+#define _(v, n, str_) case AF_XDP_MODE_##n: str = str_; break;
+      foreach_af_xdp_mode
+#undef _
+    default:
+      return format (s, "unknown");
+    }
+  return format (s, "%s", str);
+}
+
+uword
+unformat_af_xdp_mode (unformat_input_t * input, va_list * args)
+{
+  af_xdp_mode_t *mode = va_arg (*args, af_xdp_mode_t *);
+
+  if (0);
+#define _(v, n, s) else if (unformat (input, s)) *mode = AF_XDP_MODE_##n;
+  foreach_af_xdp_mode
+#undef _
+    else
+    return 0;
+  return 1;
+}
+
+static clib_error_t *
+af_xdp_init (vlib_main_t * vm)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+
+  mhash_init_vec_string (&axm->if_index_by_host_if_name, sizeof (uword));
+  vec_validate (axm->buffers, tm->n_vlib_mains - 1);
+
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (af_xdp_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
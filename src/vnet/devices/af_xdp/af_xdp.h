@@ -0,0 +1,196 @@
+/*
+ *------------------------------------------------------------------
+ * af_xdp.h - linux kernel AF_XDP socket interface header file
+ *
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _VNET_DEVICES_AF_XDP_AF_XDP_H_
+#define _VNET_DEVICES_AF_XDP_AF_XDP_H_
+
+#include <sys/socket.h>
+#include <linux/if_xdp.h>
+#include <linux/bpf.h>
+
+#include <vppinfra/lock.h>
+
+#define foreach_af_xdp_mode \
+  _(0, AUTO, "auto")	    \
+  _(1, COPY, "copy")	    \
+  _(2, ZERO_COPY, "zero-copy")
+
+typedef enum
+{
+#define _(v, n, s) AF_XDP_MODE_##n = v,
+  foreach_af_xdp_mode
+#undef _
+} af_xdp_mode_t;
+
+/* one of the four rings shared with the kernel, the descriptors are
+   struct xdp_desc for the rx and tx rings and u64 umem addresses for
+   the fill and completion rings */
+typedef struct
+{
+  volatile u32 *producer;
+  volatile u32 *consumer;
+  volatile u32 *flags;
+  void *desc;
+  u32 size;
+  void *map;
+  uword map_size;
+} af_xdp_ring_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* only initialized when more threads than queues transmit */
+  clib_spinlock_t lockp;
+  int fd;
+  u32 queue_id;
+  u32 clib_file_index;
+  u8 is_zero_copy;
+  af_xdp_ring_t rx;
+  af_xdp_ring_t tx;
+  af_xdp_ring_t fill;
+  af_xdp_ring_t completion;
+} af_xdp_queue_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  u8 *host_if_name;
+  int host_if_index;
+  u32 hw_if_index;
+  u32 sw_if_index;
+  u32 dev_instance;
+  u32 per_interface_next_index;
+  u8 is_admin_up;
+
+  /* XDP program redirecting the host queues to the sockets */
+  int prog_fd;
+  int xsk_map_fd;
+  u32 xdp_flags;
+
+  af_xdp_queue_t *queues;
+  u16 rxq_size;
+  u16 txq_size;
+} af_xdp_if_t;
+
+typedef struct
+{
+  af_xdp_if_t *interfaces;
+
+  /* hash of host interface names */
+  mhash_t if_index_by_host_if_name;
+
+  /* per-thread scratch vector of buffer indices */
+  u32 **buffers;
+} af_xdp_main_t;
+
+typedef struct
+{
+  u8 *host_if_name;
+  u8 hw_addr[6];
+  u8 hw_addr_set;
+  af_xdp_mode_t mode;
+  /* number of host queues to bind, 0 means 1 */
+  u16 num_queues;
+  u16 rxq_size;
+  u16 txq_size;
+  /* return */
+  u32 sw_if_index;
+  int rv;
+  clib_error_t *error;
+} af_xdp_create_if_args_t;
+
+extern af_xdp_main_t af_xdp_main;
+extern vnet_device_class_t af_xdp_device_class;
+extern vlib_node_registration_t af_xdp_input_node;
+
+void af_xdp_create_if (vlib_main_t * vm, af_xdp_create_if_args_t * args);
+int af_xdp_delete_if (vlib_main_t * vm, u32 sw_if_index);
+
+format_function_t format_af_xdp_device_name;
+format_function_t format_af_xdp_mode;
+unformat_function_t unformat_af_xdp_mode;
+
+/*
+ * The UMEM of every socket is the whole vlib buffer memory, so fill and
+ * tx descriptors point straight into vlib buffers. Chunks are unaligned
+ * and an umem address is the buffer start moved by the fixed headroom
+ * the kernel always leaves in front of the packet, so that packets land
+ * at b->data. The kernel reports the packet offset from that address in
+ * the upper bits of rx and completion addresses.
+ */
+#define AF_XDP_UMEM_CHUNK_OFFSET \
+  (STRUCT_OFFSET_OF (vlib_buffer_t, data) - XDP_PACKET_HEADROOM)
+
+static_always_inline u64
+af_xdp_buffer_to_umem_addr (vlib_buffer_t * b)
+{
+  return pointer_to_uword (b) - buffer_main.buffer_mem_start +
+    AF_XDP_UMEM_CHUNK_OFFSET;
+}
+
+static_always_inline u32
+af_xdp_umem_addr_to_buffer_index (u64 addr)
+{
+  addr &= XSK_UNALIGNED_BUF_ADDR_MASK;
+  return (addr - AF_XDP_UMEM_CHUNK_OFFSET) >> CLIB_LOG2_CACHE_LINE_BYTES;
+}
+
+/* hand free buffers to the kernel for the packets to come */
+static_always_inline void
+af_xdp_refill (vlib_main_t * vm, af_xdp_queue_t * q)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  af_xdp_ring_t *r = &q->fill;
+  u32 prod = *r->producer;
+  u32 n_free = r->size - (prod - *r->consumer);
+  u32 mask = r->size - 1;
+  u64 *addrs = r->desc;
+  u32 *bufs, n_alloc, i;
+
+  /* refill in batches, it is not worth allocating a few buffers */
+  if (n_free < 32)
+    return;
+
+  bufs = axm->buffers[vm->thread_index];
+  vec_validate (bufs, n_free - 1);
+  axm->buffers[vm->thread_index] = bufs;
+  n_alloc = vlib_buffer_alloc (vm, bufs, n_free);
+
+  /* a buffer index is its offset in the buffer memory in cache lines */
+  for (i = 0; i < n_alloc; i++)
+    addrs[(prod + i) & mask] =
+      ((u64) bufs[i] << CLIB_LOG2_CACHE_LINE_BYTES) +
+      AF_XDP_UMEM_CHUNK_OFFSET;
+
+  CLIB_MEMORY_STORE_BARRIER ();
+  *r->producer = prod + n_alloc;
+
+  if (q->is_zero_copy && (*r->flags & XDP_RING_NEED_WAKEUP))
+    recvfrom (q->fd, 0, 0, MSG_DONTWAIT, 0, 0);
+}
+
+#endif /* _VNET_DEVICES_AF_XDP_AF_XDP_H_ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,191 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <vlib/vlib.h>
+#include <vlib/unix/unix.h>
+#include <vnet/ethernet/ethernet.h>
+
+#include <vnet/devices/af_xdp/af_xdp.h>
+
+/**
+ * @file
+ * @brief CLI for the AF_XDP Interface Device Driver.
+ */
+
+static clib_error_t *
+af_xdp_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			  vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  af_xdp_create_if_args_t args;
+  u32 num_queues = 1, rxq_size = 0, txq_size = 0;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  memset (&args, 0, sizeof (args));
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "host-if %s", &args.host_if_name))
+	;
+      else if (unformat (line_input, "num-queues %u", &num_queues))
+	;
+      else if (unformat (line_input, "rx-queue-size %u", &rxq_size))
+	;
+      else if (unformat (line_input, "tx-queue-size %u", &txq_size))
+	;
+      else if (unformat (line_input, "mode %U", unformat_af_xdp_mode,
+			 &args.mode))
+	;
+      else if (unformat (line_input, "hw-addr %U",
+			 unformat_ethernet_address, args.hw_addr))
+	args.hw_addr_set = 1;
+      else
+	{
+	  vec_free (args.host_if_name);
+	  return clib_error_return (0, "unknown input `%U'",
+				    format_unformat_error, line_input);
+	}
+    }
+  unformat_free (line_input);
+
+  if (args.host_if_name == NULL)
+    return clib_error_return (0, "missing host interface name");
+
+  if (num_queues == 0 || num_queues > 65535 || rxq_size > 65535 ||
+      txq_size > 65535)
+    {
+      vec_free (args.host_if_name);
+      return clib_error_return (0, "value out of range");
+    }
+
+  args.num_queues = num_queues;
+  args.rxq_size = rxq_size;
+  args.txq_size = txq_size;
+
+  af_xdp_create_if (vm, &args);
+
+  if (args.rv == 0)
+    vlib_cli_output (vm, "%U\n", format_vnet_sw_if_index_name,
+		     vnet_get_main (), args.sw_if_index);
+
+  vec_free (args.host_if_name);
+
+  return args.error;
+}
+
+/*?
+ * Create an interface on top of one or more queues of a linux network
+ * interface, using AF_XDP sockets. An XDP program redirecting the
+ * selected queues to VPP is attached to the linux interface, the queues
+ * numbered from 0 up. Once created, the new interface exists in VPP with
+ * the name '<em>xdp-<ifname></em>'.
+ *
+ * This command has the following optional parameters:
+ *
+ * - <b>num-queues <n></b> - number of host queues to bind, defaults to 1.
+ *
+ * - <b>rx-queue-size <n></b>, <b>tx-queue-size <n></b> - socket ring
+ * sizes, powers of 2, default 1024.
+ *
+ * - <b>mode auto|copy|zero-copy</b> - whether the kernel copies packets
+ * into VPP buffers or the driver DMAs them there directly. Zero-copy
+ * requires native XDP support in the driver, <em>auto</em> (the default)
+ * uses it when available.
+ *
+ * - <b>hw-addr <mac-addr></b> - Optional ethernet address, can be in either
+ * X:X:X:X:X:X unix or X.X.X cisco format.
+ *
+ * @cliexpar
+ * Example of how to create an AF_XDP interface on two queues of eth1:
+ * @cliexstart{create af-xdp host-if eth1 num-queues 2}
+ * xdp-eth1
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (af_xdp_create_command, static) = {
+  .path = "create af-xdp",
+  .short_help = "create af-xdp host-if <ifname> [num-queues <n>] "
+    "[rx-queue-size <n>] [tx-queue-size <n>] [mode auto|copy|zero-copy] "
+    "[hw-addr <mac-addr>]",
+  .function = af_xdp_create_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+af_xdp_delete_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			  vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0;
+  int rv;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "sw_if_index %d", &sw_if_index))
+	;
+      else if (unformat (line_input, "%U", unformat_vnet_sw_interface,
+			 vnm, &sw_if_index))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, line_input);
+    }
+  unformat_free (line_input);
+
+  if (sw_if_index == ~0)
+    return clib_error_return (0,
+			      "please specify interface name or sw_if_index");
+
+  rv = af_xdp_delete_if (vm, sw_if_index);
+  if (rv == VNET_API_ERROR_INVALID_SW_IF_INDEX)
+    return clib_error_return (0, "not an AF_XDP interface");
+  else if (rv != 0)
+    return clib_error_return (0, "error on deleting AF_XDP interface");
+
+  return 0;
+}
+
+/*?
+ * Delete an AF_XDP interface, detaching the XDP program from the linux
+ * interface.
+ *
+ * @cliexpar
+ * Example of how to delete the AF_XDP interface named xdp-eth1:
+ * @cliexcmd{delete af-xdp xdp-eth1}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (af_xdp_delete_command, static) = {
+  .path = "delete af-xdp",
+  .short_help = "delete af-xdp {<interface> | sw_if_index <sw_idx>}",
+  .function = af_xdp_delete_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,320 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <linux/if_link.h>
+
+#include <vlib/vlib.h>
+#include <vlib/unix/unix.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/devices/netlink.h>
+
+#include <vnet/devices/af_xdp/af_xdp.h>
+
+/* copy mode sends a small batch per syscall, keep kicking until the
+   ring drains or the kernel stops making progress */
+#define AF_XDP_TX_MAX_KICKS 16
+
+#define foreach_af_xdp_tx_func_error		\
+_(NO_FREE_SLOTS, "no free tx slots")		\
+_(CHAIN_TOO_LONG, "chained packet too long")	\
+_(SENDTO, "tx sendto failure")
+
+typedef enum
+{
+#define _(f,s) AF_XDP_TX_ERROR_##f,
+  foreach_af_xdp_tx_func_error
+#undef _
+    AF_XDP_TX_N_ERROR,
+} af_xdp_tx_func_error_t;
+
+static char *af_xdp_tx_func_error_strings[] = {
+#define _(n,s) s,
+  foreach_af_xdp_tx_func_error
+#undef _
+};
+
+u8 *
+format_af_xdp_device_name (u8 * s, va_list * args)
+{
+  u32 i = va_arg (*args, u32);
+  af_xdp_main_t *axm = &af_xdp_main;
+  af_xdp_if_t *axif = pool_elt_at_index (axm->interfaces, i);
+
+  s = format (s, "xdp-%s", axif->host_if_name);
+  return s;
+}
+
+static u8 *
+format_af_xdp_device (u8 * s, va_list * args)
+{
+  u32 i = va_arg (*args, u32);
+  CLIB_UNUSED (int verbose) = va_arg (*args, int);
+  af_xdp_main_t *axm = &af_xdp_main;
+  af_xdp_if_t *axif = pool_elt_at_index (axm->interfaces, i);
+  u32 indent = format_get_indent (s);
+  af_xdp_queue_t *q;
+
+  s = format (s, "Linux AF_XDP socket interface, %s XDP",
+	      (axif->xdp_flags & XDP_FLAGS_DRV_MODE) ? "native" : "generic");
+  vec_foreach (q, axif->queues)
+  {
+    s = format (s, "\n%Uqueue %u: fd %d %s rx-size %u tx-size %u",
+		format_white_space, indent + 2, q->queue_id, q->fd,
+		q->is_zero_copy ? "zero-copy" : "copy", q->rx.size,
+		q->tx.size);
+  }
+  return s;
+}
+
+static u8 *
+format_af_xdp_tx_trace (u8 * s, va_list * args)
+{
+  s = format (s, "Unimplemented...");
+  return s;
+}
+
+/* free the buffers the kernel is done with */
+static_always_inline void
+af_xdp_tx_reap (vlib_main_t * vm, af_xdp_queue_t * q)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  af_xdp_ring_t *r = &q->completion;
+  u32 cons = *r->consumer;
+  u32 n = *r->producer - cons;
+  u32 mask = r->size - 1;
+  u64 *addrs = r->desc;
+  u32 *bufs, i;
+
+  if (n == 0)
+    return;
+
+  bufs = axm->buffers[vm->thread_index];
+  vec_validate (bufs, n - 1);
+  axm->buffers[vm->thread_index] = bufs;
+  for (i = 0; i < n; i++)
+    bufs[i] = af_xdp_umem_addr_to_buffer_index (addrs[(cons + i) & mask]);
+
+  CLIB_MEMORY_STORE_BARRIER ();
+  *r->consumer = cons + n;
+
+  vlib_buffer_free (vm, bufs, n);
+}
+
+/* a descriptor is a single buffer, so copy chains into a fresh one */
+static_always_inline u32
+af_xdp_tx_linearize (vlib_main_t * vm, u32 bi)
+{
+  vlib_buffer_t *b = vlib_get_buffer (vm, bi);
+  vlib_buffer_t *nb;
+  u32 nbi;
+
+  if (vlib_buffer_length_in_chain (vm, b) > VLIB_BUFFER_DATA_SIZE ||
+      vlib_buffer_alloc (vm, &nbi, 1) != 1)
+    {
+      vlib_buffer_free (vm, &bi, 1);
+      return ~0;
+    }
+
+  nb = vlib_get_buffer (vm, nbi);
+  nb->current_data = 0;
+  nb->current_length = vlib_buffer_contents (vm, bi, nb->data);
+  vlib_buffer_free (vm, &bi, 1);
+  return nbi;
+}
+
+static_always_inline void
+af_xdp_tx_kick (vlib_main_t * vm, vlib_node_runtime_t * node,
+		af_xdp_queue_t * q)
+{
+  af_xdp_ring_t *r = &q->tx;
+  int i;
+
+  if (q->is_zero_copy && !(*r->flags & XDP_RING_NEED_WAKEUP))
+    return;
+
+  for (i = 0; i < AF_XDP_TX_MAX_KICKS && *r->consumer != *r->producer; i++)
+    if (sendto (q->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0 &&
+	errno != EAGAIN && errno != EBUSY && errno != ENOBUFS)
+      {
+	vlib_error_count (vm, node->node_index, AF_XDP_TX_ERROR_SENDTO, 1);
+	break;
+      }
+}
+
+static uword
+af_xdp_interface_tx (vlib_main_t * vm,
+		     vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  vnet_interface_output_runtime_t *rd = (void *) node->runtime_data;
+  af_xdp_if_t *axif = pool_elt_at_index (axm->interfaces, rd->dev_instance);
+  /* with as many queues as threads every thread owns its tx ring */
+  af_xdp_queue_t *q = vec_elt_at_index (axif->queues, vm->thread_index %
+					vec_len (axif->queues));
+  af_xdp_ring_t *r = &q->tx;
+  struct xdp_desc *descs = r->desc;
+  u32 mask = r->size - 1;
+  u32 *buffers = vlib_frame_args (frame);
+  u32 n_left = frame->n_vectors;
+  u32 n_chain_drop = 0;
+  u32 prod, n_free;
+
+  clib_spinlock_lock_if_init (&q->lockp);
+
+  af_xdp_tx_reap (vm, q);
+
+  prod = *r->producer;
+  n_free = r->size - (prod - *r->consumer);
+
+  while (n_left && n_free)
+    {
+      u32 bi = buffers[0];
+      vlib_buffer_t *b = vlib_get_buffer (vm, bi);
+      struct xdp_desc *d;
+
+      buffers++;
+      n_left--;
+
+      if (PREDICT_FALSE (b->flags & VLIB_BUFFER_NEXT_PRESENT))
+	{
+	  if ((bi = af_xdp_tx_linearize (vm, bi)) == ~0)
+	    {
+	      n_chain_drop++;
+	      continue;
+	    }
+	  b = vlib_get_buffer (vm, bi);
+	}
+
+      /* the packet offset in the upper bits, so the completion ring
+         gives back an address pointing at the buffer */
+      d = &descs[prod & mask];
+      d->addr = af_xdp_buffer_to_umem_addr (b) +
+	((u64) (XDP_PACKET_HEADROOM + b->current_data) <<
+	 XSK_UNALIGNED_BUF_OFFSET_SHIFT);
+      d->len = b->current_length;
+      d->options = 0;
+      prod++;
+      n_free--;
+    }
+
+  CLIB_MEMORY_STORE_BARRIER ();
+  *r->producer = prod;
+
+  af_xdp_tx_kick (vm, node, q);
+
+  clib_spinlock_unlock_if_init (&q->lockp);
+
+  if (PREDICT_FALSE (n_chain_drop))
+    vlib_error_count (vm, node->node_index, AF_XDP_TX_ERROR_CHAIN_TOO_LONG,
+		      n_chain_drop);
+
+  if (PREDICT_FALSE (n_left))
+    {
+      vlib_error_count (vm, node->node_index, AF_XDP_TX_ERROR_NO_FREE_SLOTS,
+			n_left);
+      vlib_buffer_free (vm, buffers, n_left);
+    }
+
+  return frame->n_vectors - n_left - n_chain_drop;
+}
+
+static void
+af_xdp_set_interface_next_node (vnet_main_t * vnm, u32 hw_if_index,
+				u32 node_index)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  vnet_hw_interface_t *hw = vnet_get_hw_interface (vnm, hw_if_index);
+  af_xdp_if_t *axif = pool_elt_at_index (axm->interfaces, hw->dev_instance);
+
+  /* Shut off redirection */
+  if (node_index == ~0)
+    {
+      axif->per_interface_next_index = node_index;
+      return;
+    }
+
+  axif->per_interface_next_index =
+    vlib_node_add_next (vlib_get_main (), af_xdp_input_node.index,
+			node_index);
+}
+
+static void
+af_xdp_clear_hw_interface_counters (u32 instance)
+{
+  /* Nothing for now */
+}
+
+static clib_error_t *
+af_xdp_interface_admin_up_down (vnet_main_t * vnm, u32 hw_if_index,
+				u32 flags)
+{
+  af_xdp_main_t *axm = &af_xdp_main;
+  vnet_hw_interface_t *hw = vnet_get_hw_interface (vnm, hw_if_index);
+  af_xdp_if_t *axif = pool_elt_at_index (axm->interfaces, hw->dev_instance);
+  clib_error_t *error;
+
+  axif->is_admin_up = (flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) != 0;
+
+  if (axif->is_admin_up)
+    {
+      /* the host interface has to be up to pass packets */
+      if ((error = vnet_netlink_set_link_state (axif->host_if_index, 1)))
+	return error;
+      vnet_hw_interface_set_flags (vnm, hw_if_index,
+				   VNET_HW_INTERFACE_FLAG_LINK_UP);
+    }
+  else
+    vnet_hw_interface_set_flags (vnm, hw_if_index, 0);
+
+  return 0;
+}
+
+static clib_error_t *
+af_xdp_subif_add_del_function (vnet_main_t * vnm,
+			       u32 hw_if_index,
+			       struct vnet_sw_interface_t *st, int is_add)
+{
+  /* Nothing for now */
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VNET_DEVICE_CLASS (af_xdp_device_class) = {
+  .name = "af-xdp",
+  .tx_function = af_xdp_interface_tx,
+  .format_device_name = format_af_xdp_device_name,
+  .format_device = format_af_xdp_device,
+  .format_tx_trace = format_af_xdp_tx_trace,
+  .tx_function_n_errors = AF_XDP_TX_N_ERROR,
+  .tx_function_error_strings = af_xdp_tx_func_error_strings,
+  .rx_redirect_to_node = af_xdp_set_interface_next_node,
+  .clear_counters = af_xdp_clear_hw_interface_counters,
+  .admin_up_down_function = af_xdp_interface_admin_up_down,
+  .subif_add_del_function = af_xdp_subif_add_del_function,
+};
+
+VLIB_DEVICE_TX_FUNCTION_MULTIARCH (af_xdp_device_class,
+				   af_xdp_interface_tx)
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
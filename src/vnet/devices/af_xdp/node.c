@@ -0,0 +1,211 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <vlib/vlib.h>
+#include <vlib/unix/unix.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/devices/devices.h>
+#include <vnet/feature/feature.h>
+
+#include <vnet/devices/af_xdp/af_xdp.h>
+
+#define foreach_af_xdp_input_error \
+  _(UNKNOWN, "unknown")
+
+typedef enum
+{
+#define _(f,s) AF_XDP_INPUT_ERROR_##f,
+  foreach_af_xdp_input_error
+#undef _
+    AF_XDP_INPUT_N_ERROR,
+} af_xdp_input_error_t;
+
+static char *af_xdp_input_error_strings[] = {
+#define _(n,s) s,
+  foreach_af_xdp_input_error
+#undef _
+};
+
+typedef struct
+{
+  u32 next_index;
+  u32 hw_if_index;
+  u32 queue_id;
+  u32 len;
+  u64 addr;
+} af_xdp_input_trace_t;
+
+static u8 *
+format_af_xdp_input_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  af_xdp_input_trace_t *t = va_arg (*args, af_xdp_input_trace_t *);
+
+  s = format (s, "af_xdp: hw_if_index %d next-index %d queue %u len %u "
+	      "addr 0x%llx", t->hw_if_index, t->next_index, t->queue_id,
+	      t->len, t->addr);
+  return s;
+}
+
+static_always_inline uword
+af_xdp_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+			    af_xdp_if_t * axif, vnet_device_and_queue_t * dq)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 thread_index = vm->thread_index;
+  uword n_trace = vlib_get_trace_count (vm, node);
+  af_xdp_queue_t *q = vec_elt_at_index (axif->queues, dq->queue_id);
+  af_xdp_ring_t *r = &q->rx;
+  struct xdp_desc *descs = r->desc;
+  u32 next_index = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
+  u32 mask = r->size - 1;
+  u32 cons = *r->consumer;
+  u32 n_avail = *r->producer - cons;
+  u32 n_left = clib_min (n_avail, vm->frame_size);
+  u32 *to_next = 0;
+  u32 n_rx_packets = 0;
+  u32 n_rx_bytes = 0;
+
+  if (n_left == 0)
+    goto refill;
+
+  /* the producer index has to be read before the descriptors */
+  CLIB_MEMORY_BARRIER ();
+
+  while (n_left)
+    {
+      u32 n_left_to_next;
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+
+      while (n_left && n_left_to_next)
+	{
+	  struct xdp_desc *d = &descs[cons & mask];
+	  u32 next0 = next_index;
+	  u32 bi0 = af_xdp_umem_addr_to_buffer_index (d->addr);
+	  vlib_buffer_t *b0 = vlib_get_buffer (vm, bi0);
+
+	  b0->current_data = (d->addr >> XSK_UNALIGNED_BUF_OFFSET_SHIFT) -
+	    XDP_PACKET_HEADROOM;
+	  b0->current_length = d->len;
+	  b0->total_length_not_including_first_buffer = 0;
+	  b0->flags = VLIB_BUFFER_TOTAL_LENGTH_VALID;
+	  vnet_buffer (b0)->sw_if_index[VLIB_RX] = axif->sw_if_index;
+	  vnet_buffer (b0)->sw_if_index[VLIB_TX] = (u32) ~ 0;
+
+	  if (PREDICT_FALSE (axif->per_interface_next_index != ~0))
+	    next0 = axif->per_interface_next_index;
+	  else
+	    /* redirect if feature path enabled */
+	    vnet_feature_start_device_input_x1 (axif->sw_if_index, &next0,
+						b0);
+	  /* trace */
+	  VLIB_BUFFER_TRACE_TRAJECTORY_INIT (b0);
+
+	  if (PREDICT_FALSE (n_trace > 0))
+	    {
+	      af_xdp_input_trace_t *tr;
+	      vlib_trace_buffer (vm, node, next0, b0,
+				 /* follow_chain */ 0);
+	      vlib_set_trace_count (vm, node, --n_trace);
+	      tr = vlib_add_trace (vm, node, b0, sizeof (*tr));
+	      tr->next_index = next0;
+	      tr->hw_if_index = axif->hw_if_index;
+	      tr->queue_id = q->queue_id;
+	      tr->len = d->len;
+	      tr->addr = d->addr;
+	    }
+
+	  n_rx_bytes += d->len;
+	  n_rx_packets++;
+	  cons++;
+
+	  /* enqueue buffer */
+	  to_next[0] = bi0;
+	  to_next += 1;
+	  n_left_to_next--;
+	  n_left--;
+
+	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index, to_next,
+					   n_left_to_next, bi0, next0);
+	}
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+
+  /* the descriptors are consumed, the kernel can reuse the slots */
+  CLIB_MEMORY_BARRIER ();
+  *r->consumer = cons;
+
+  vlib_increment_combined_counter (vnm->interface_main.combined_sw_if_counters
+				   + VNET_INTERFACE_COUNTER_RX, thread_index,
+				   axif->sw_if_index, n_rx_packets,
+				   n_rx_bytes);
+  vnet_device_increment_rx_packets (thread_index, n_rx_packets);
+
+  /* the socket is edge triggered, come back for whatever is left */
+  if (n_avail > n_rx_packets && dq->mode != VNET_HW_INTERFACE_RX_MODE_POLLING)
+    vnet_device_input_set_interrupt_pending (vnm, axif->hw_if_index,
+					     dq->queue_id);
+
+refill:
+  af_xdp_refill (vm, q);
+
+  return n_rx_packets;
+}
+
+static uword
+af_xdp_input_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
+		 vlib_frame_t * frame)
+{
+  u32 n_rx = 0;
+  af_xdp_main_t *axm = &af_xdp_main;
+  vnet_device_input_runtime_t *rt = (void *) node->runtime_data;
+  vnet_device_and_queue_t *dq;
+
+  foreach_device_and_queue (dq, rt->devices_and_queues)
+  {
+    af_xdp_if_t *axif;
+    axif = vec_elt_at_index (axm->interfaces, dq->dev_instance);
+    if (axif->is_admin_up)
+      n_rx += af_xdp_device_input_inline (vm, node, axif, dq);
+  }
+
+  return n_rx;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (af_xdp_input_node) = {
+  .function = af_xdp_input_fn,
+  .name = "af-xdp-input",
+  .sibling_of = "device-input",
+  .format_trace = format_af_xdp_input_trace,
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_INTERRUPT,
+  .n_errors = AF_XDP_INPUT_N_ERROR,
+  .error_strings = af_xdp_input_error_strings,
+};
+
+VLIB_NODE_FUNCTION_MULTIARCH (af_xdp_input_node, af_xdp_input_fn)
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
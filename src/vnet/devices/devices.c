@@ -225,7 +225,11 @@ delete:
   vlib_worker_thread_barrier_release (vm0);
 
   if (vec_len (rt->devices_and_queues) == 0)
-    vlib_node_set_state (vm, hw->input_node_index, VLIB_NODE_STATE_DISABLED);
+    {
+      if (!(hw->flags & VNET_HW_INTERFACE_FLAG_INPUT_NODE_SELF_DISABLES))
+	vlib_node_set_state (vm, hw->input_node_index,
+			     VLIB_NODE_STATE_DISABLED);
+    }
   else if (mode == VNET_HW_INTERFACE_RX_MODE_POLLING)
     {
       /*
@@ -207,6 +207,34 @@ vnet_netlink_set_link_mtu (int ifindex, int mtu)
   return vnet_netlink_msg_send (&m);
 }
 
+clib_error_t *
+vnet_netlink_set_link_xdp_fd (int ifindex, int fd, u32 flags)
+{
+  vnet_netlink_msg_t m;
+  struct ifinfomsg ifmsg = { 0 };
+  u8 xdp[RTA_SPACE (sizeof (int)) + RTA_SPACE (sizeof (u32))];
+  struct rtattr *rta;
+
+  ifmsg.ifi_index = ifindex;
+
+  vnet_netlink_msg_init (&m, RTM_SETLINK, NLM_F_REQUEST,
+			 &ifmsg, sizeof (struct ifinfomsg));
+
+  /* IFLA_XDP nests the program fd and the attach flags */
+  memset (xdp, 0, sizeof (xdp));
+  rta = (struct rtattr *) xdp;
+  rta->rta_type = IFLA_XDP_FD;
+  rta->rta_len = RTA_LENGTH (sizeof (int));
+  clib_memcpy (RTA_DATA (rta), &fd, sizeof (int));
+  rta = (struct rtattr *) (xdp + RTA_SPACE (sizeof (int)));
+  rta->rta_type = IFLA_XDP_FLAGS;
+  rta->rta_len = RTA_LENGTH (sizeof (u32));
+  clib_memcpy (RTA_DATA (rta), &flags, sizeof (u32));
+  vnet_netlink_msg_add_rtattr (&m, IFLA_XDP, xdp, sizeof (xdp));
+
+  return vnet_netlink_msg_send (&m);
+}
+
 clib_error_t *
 vnet_netlink_add_ip4_addr (int ifindex, void *addr, int pfx_len)
 {
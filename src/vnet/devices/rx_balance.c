@@ -0,0 +1,621 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Load aware rx queue placement.
+ *
+ * A process on the main thread periodically samples the receive rate of
+ * every rx queue and the loop utilization (average vectors per node) of
+ * every worker. When the busiest worker carries noticeably more traffic
+ * than the least busy one, the queue which best closes the gap is moved,
+ * exactly as "set interface rx-placement" would do it, under the worker
+ * barrier. At most one queue moves per interval and a queue which moved
+ * stays put for the hold time, so the placement converges instead of
+ * oscillating. Every move is logged.
+ *
+ * Queue rates come from the per thread interface rx counters; when an
+ * interface has several queues on one thread their packets are split
+ * evenly among them.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/devices/devices.h>
+#include <vlib/log.h>
+#include <vppinfra/math.h>
+
+typedef struct
+{
+  u32 hw_if_index;
+  u16 queue_id;
+
+  /* Thread the queue was placed on at the last sample. */
+  u32 thread_index;
+
+  /* Smoothed receive rate, packets per second. */
+  f64 rate;
+
+  /* Time of the last move, 0 if never moved. */
+  f64 last_move_time;
+
+  /* Still present at the last sample. */
+  u8 seen;
+} rx_balance_queue_t;
+
+typedef struct
+{
+  /* Sum of the rates of the queues placed on this thread. */
+  f64 rate;
+
+  /* Loop utilization, average vectors per node. */
+  f64 vectors_per_node;
+
+  u32 n_queues;
+} rx_balance_worker_t;
+
+typedef struct
+{
+  /* Configuration */
+  u8 enabled;
+  f64 interval;
+  f64 threshold;
+  f64 hold_time;
+  f64 min_rate;
+  f64 min_vectors_per_node;
+  f64 smoothing;
+
+  /* Pool of tracked queues, hashed by (hw_if_index << 16) | queue_id. */
+  rx_balance_queue_t *queues;
+  uword *queue_index_by_key;
+
+  /* Rx packet counters at the last sample, per hw interface and thread. */
+  u64 **last_rx_packets;
+
+  /* Scratch: queues of one interface per thread. */
+  u32 *n_queues_by_thread;
+
+  rx_balance_worker_t *workers;
+  f64 last_sample_time;
+  u32 n_samples;
+  u32 n_moves;
+
+  vlib_log_class_t log_class;
+} rx_balance_main_t;
+
+rx_balance_main_t rx_balance_main;
+
+static vlib_node_registration_t rx_balance_process_node;
+
+typedef enum
+{
+  RX_BALANCE_EVENT_CONFIG = 1,
+} rx_balance_event_t;
+
+static void
+rx_balance_reset (rx_balance_main_t * rbm)
+{
+  u64 **v;
+
+  pool_free (rbm->queues);
+  hash_free (rbm->queue_index_by_key);
+  vec_foreach (v, rbm->last_rx_packets) vec_free (v[0]);
+  vec_free (rbm->last_rx_packets);
+  vec_reset_length (rbm->workers);
+  rbm->n_samples = 0;
+}
+
+static rx_balance_queue_t *
+rx_balance_get_queue (rx_balance_main_t * rbm, u32 hw_if_index, u16 queue_id,
+		      u32 thread_index)
+{
+  rx_balance_queue_t *rq;
+  uword key = ((uword) hw_if_index << 16) | queue_id;
+  uword *p;
+
+  p = hash_get (rbm->queue_index_by_key, key);
+  if (p)
+    return pool_elt_at_index (rbm->queues, p[0]);
+
+  pool_get (rbm->queues, rq);
+  memset (rq, 0, sizeof (*rq));
+  rq->hw_if_index = hw_if_index;
+  rq->queue_id = queue_id;
+  rq->thread_index = thread_index;
+  hash_set (rbm->queue_index_by_key, key, rq - rbm->queues);
+  return rq;
+}
+
+static void
+rx_balance_sample (vlib_main_t * vm, rx_balance_main_t * rbm, f64 now)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_interface_main_t *im = &vnm->interface_main;
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vlib_combined_counter_main_t *cm =
+    im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_RX;
+  vnet_hw_interface_t *hw;
+  rx_balance_queue_t *rq;
+  f64 dt = now - rbm->last_sample_time;
+  u32 n_threads = vec_len (vlib_mains);
+  u32 *stale = 0, *i;
+  uword t;
+
+  vec_validate (rbm->workers, n_threads - 1);
+  vec_zero (rbm->workers);
+  for (t = vdm->first_worker_thread_index;
+       t <= vdm->last_worker_thread_index; t++)
+    rbm->workers[t].vectors_per_node =
+      vlib_last_vector_length_per_node (vlib_mains[t]);
+
+  /* *INDENT-OFF* */
+  pool_foreach (rq, rbm->queues, ({ rq->seen = 0; }));
+
+  pool_foreach (hw, im->hw_interfaces,
+  ({
+    u32 hw_if_index = hw - im->hw_interfaces;
+    u64 *last;
+    u16 q;
+
+    if (hw->input_node_thread_index_by_queue == 0)
+      continue;
+
+    vec_validate (rbm->last_rx_packets, hw_if_index);
+    vec_validate (rbm->last_rx_packets[hw_if_index], n_threads - 1);
+    last = rbm->last_rx_packets[hw_if_index];
+
+    vec_validate (rbm->n_queues_by_thread, n_threads - 1);
+    vec_zero (rbm->n_queues_by_thread);
+    vec_foreach_index (q, hw->input_node_thread_index_by_queue)
+      if (q < vec_len (hw->rx_mode_by_queue) &&
+	  hw->rx_mode_by_queue[q] != VNET_HW_INTERFACE_RX_MODE_UNKNOWN)
+	rbm->n_queues_by_thread[hw->input_node_thread_index_by_queue[q]]++;
+
+    vec_foreach_index (q, hw->input_node_thread_index_by_queue)
+      {
+	u64 packets, delta;
+	f64 sample;
+
+	if (q >= vec_len (hw->rx_mode_by_queue) ||
+	    hw->rx_mode_by_queue[q] == VNET_HW_INTERFACE_RX_MODE_UNKNOWN)
+	  continue;
+
+	t = hw->input_node_thread_index_by_queue[q];
+	rq = rx_balance_get_queue (rbm, hw_if_index, q, t);
+	rq->thread_index = t;
+	rq->seen = 1;
+
+	packets = cm->counters[t][hw->sw_if_index].packets;
+	/* counters may have been cleared since the last sample */
+	delta = packets >= last[t] ? packets - last[t] : packets;
+	if (rbm->n_samples > 0 && dt > 0)
+	  {
+	    sample = (f64) delta / rbm->n_queues_by_thread[t] / dt;
+	    rq->rate += rbm->smoothing * (sample - rq->rate);
+	  }
+
+	if (t < vec_len (rbm->workers))
+	  {
+	    rbm->workers[t].rate += rq->rate;
+	    rbm->workers[t].n_queues++;
+	  }
+      }
+
+    /* snapshot every thread, a queue may move there later */
+    for (t = 0; t < n_threads; t++)
+      last[t] = cm->counters[t][hw->sw_if_index].packets;
+  }));
+
+  pool_foreach (rq, rbm->queues,
+  ({
+    if (!rq->seen)
+      vec_add1 (stale, rq - rbm->queues);
+  }));
+  /* *INDENT-ON* */
+
+  vec_foreach (i, stale)
+  {
+    rq = pool_elt_at_index (rbm->queues, i[0]);
+    hash_unset (rbm->queue_index_by_key,
+		((uword) rq->hw_if_index << 16) | rq->queue_id);
+    pool_put (rbm->queues, rq);
+  }
+  vec_free (stale);
+
+  rbm->last_sample_time = now;
+  rbm->n_samples++;
+}
+
+static int
+rx_balance_move_queue (vnet_main_t * vnm, rx_balance_queue_t * rq,
+		       u32 thread_index)
+{
+  vnet_hw_interface_rx_mode mode;
+  int rv;
+
+  rv = vnet_hw_interface_get_rx_mode (vnm, rq->hw_if_index, rq->queue_id,
+				      &mode);
+  if (rv)
+    return rv;
+
+  rv = vnet_hw_interface_unassign_rx_thread (vnm, rq->hw_if_index,
+					     rq->queue_id);
+  if (rv)
+    return rv;
+
+  vnet_hw_interface_assign_rx_thread (vnm, rq->hw_if_index, rq->queue_id,
+				      thread_index);
+  return vnet_hw_interface_set_rx_mode (vnm, rq->hw_if_index, rq->queue_id,
+					mode);
+}
+
+static void
+rx_balance_rebalance (vlib_main_t * vm, rx_balance_main_t * rbm, f64 now)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_device_main_t *vdm = &vnet_device_main;
+  rx_balance_worker_t *hot, *cold;
+  rx_balance_queue_t *rq, *best = 0;
+  u32 hot_index = ~0, cold_index = ~0;
+  f64 gap, residual, best_residual;
+  uword t;
+  int rv;
+
+  for (t = vdm->first_worker_thread_index;
+       t <= vdm->last_worker_thread_index; t++)
+    {
+      if (hot_index == ~0 ||
+	  rbm->workers[t].rate > rbm->workers[hot_index].rate)
+	hot_index = t;
+      if (cold_index == ~0 ||
+	  rbm->workers[t].rate < rbm->workers[cold_index].rate)
+	cold_index = t;
+    }
+
+  if (hot_index == cold_index)
+    return;
+
+  hot = vec_elt_at_index (rbm->workers, hot_index);
+  cold = vec_elt_at_index (rbm->workers, cold_index);
+  gap = hot->rate - cold->rate;
+
+  if (hot->rate < rbm->min_rate ||
+      hot->vectors_per_node < rbm->min_vectors_per_node ||
+      gap < rbm->threshold * hot->rate)
+    return;
+
+  /* Pick the queue which leaves the two workers closest to even. Moving
+     it must shrink the gap by at least the threshold, otherwise a lone
+     hot queue would just bounce between workers. */
+  best_residual = gap - rbm->threshold * hot->rate;
+
+  /* *INDENT-OFF* */
+  pool_foreach (rq, rbm->queues,
+  ({
+    if (rq->thread_index != hot_index || rq->rate <= 0)
+      continue;
+    if (rq->last_move_time > 0 && now - rq->last_move_time < rbm->hold_time)
+      continue;
+    residual = fabs (gap - 2 * rq->rate);
+    if (residual < best_residual)
+      {
+	best_residual = residual;
+	best = rq;
+      }
+  }));
+  /* *INDENT-ON* */
+
+  if (best == 0)
+    {
+      vlib_log_debug (rbm->log_class, "thread %u at %.0f pps, thread %u at "
+		      "%.0f pps: no queue to move", hot_index, hot->rate,
+		      cold_index, cold->rate);
+      return;
+    }
+
+  rv = rx_balance_move_queue (vnm, best, cold_index);
+  if (rv)
+    {
+      vlib_log_err (rbm->log_class, "%U queue %u: move to thread %u failed "
+		    "(%d)", format_vnet_hw_if_index_name, vnm,
+		    best->hw_if_index, best->queue_id, cold_index, rv);
+      best->last_move_time = now;
+      return;
+    }
+
+  vlib_log_notice (rbm->log_class, "%U queue %u (%.0f pps) moved from "
+		   "thread %u (%.0f pps, %.1f vectors/node) to thread %u "
+		   "(%.0f pps, %.1f vectors/node)",
+		   format_vnet_hw_if_index_name, vnm, best->hw_if_index,
+		   best->queue_id, best->rate, hot_index, hot->rate,
+		   hot->vectors_per_node, cold_index, cold->rate,
+		   cold->vectors_per_node);
+
+  {
+    /* *INDENT-OFF* */
+    ELOG_TYPE_DECLARE (e) =
+      {
+	.format = "rx-balance: hw_if_index %d queue %d thread %d -> %d",
+	.format_args = "i4i4i4i4",
+      };
+    /* *INDENT-ON* */
+    struct
+    {
+      u32 hw_if_index, queue_id, from, to;
+    } *ed;
+    ed = ELOG_DATA (&vm->elog_main, e);
+    ed->hw_if_index = best->hw_if_index;
+    ed->queue_id = best->queue_id;
+    ed->from = hot_index;
+    ed->to = cold_index;
+  }
+
+  hot->rate -= best->rate;
+  hot->n_queues--;
+  cold->rate += best->rate;
+  cold->n_queues++;
+  best->thread_index = cold_index;
+  best->last_move_time = now;
+  rbm->n_moves++;
+}
+
+static uword
+rx_balance_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+		    vlib_frame_t * f)
+{
+  rx_balance_main_t *rbm = &rx_balance_main;
+  vnet_device_main_t *vdm = &vnet_device_main;
+  uword event_type, *event_data = 0;
+  f64 now;
+
+  while (1)
+    {
+      if (rbm->enabled)
+	vlib_process_wait_for_event_or_clock (vm, rbm->interval);
+      else
+	vlib_process_wait_for_event (vm);
+
+      event_type = vlib_process_get_events (vm, &event_data);
+      vec_reset_length (event_data);
+
+      if (event_type == RX_BALANCE_EVENT_CONFIG)
+	rx_balance_reset (rbm);
+
+      /* Nothing to balance without workers. */
+      if (!rbm->enabled || vdm->first_worker_thread_index == 0)
+	continue;
+
+      now = vlib_time_now (vm);
+      rx_balance_sample (vm, rbm, now);
+      if (rbm->n_samples > 1)
+	rx_balance_rebalance (vm, rbm, now);
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (rx_balance_process_node, static) = {
+  .function = rx_balance_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "rx-balance-process",
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+rx_balance_parse_config (rx_balance_main_t * rbm, unformat_input_t * input)
+{
+  f64 threshold, smoothing;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "enable"))
+	rbm->enabled = 1;
+      else if (unformat (input, "disable"))
+	rbm->enabled = 0;
+      else if (unformat (input, "interval %f", &rbm->interval))
+	;
+      else if (unformat (input, "threshold %f", &threshold))
+	rbm->threshold = threshold / 100.0;
+      else if (unformat (input, "hold-time %f", &rbm->hold_time))
+	;
+      else if (unformat (input, "min-rate %f", &rbm->min_rate))
+	;
+      else if (unformat (input, "min-vectors-per-node %f",
+			 &rbm->min_vectors_per_node))
+	;
+      else if (unformat (input, "smoothing %f", &smoothing))
+	rbm->smoothing = smoothing / 100.0;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (rbm->interval < 0.01)
+    return clib_error_return (0, "interval must be at least 0.01 seconds");
+  if (rbm->threshold <= 0 || rbm->threshold >= 1)
+    return clib_error_return (0, "threshold must be between 0 and 100");
+  if (rbm->smoothing <= 0 || rbm->smoothing > 1)
+    return clib_error_return (0, "smoothing must be between 0 and 100");
+
+  return 0;
+}
+
+static clib_error_t *
+rx_balance_config (vlib_main_t * vm, unformat_input_t * input)
+{
+  return rx_balance_parse_config (&rx_balance_main, input);
+}
+
+VLIB_CONFIG_FUNCTION (rx_balance_config, "rx-balance");
+
+static clib_error_t *
+set_rx_balance_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			   vlib_cli_command_t * cmd)
+{
+  rx_balance_main_t *rbm = &rx_balance_main;
+  unformat_input_t _line_input, *line_input = &_line_input;
+  rx_balance_main_t saved = *rbm;
+  clib_error_t *error;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  error = rx_balance_parse_config (rbm, line_input);
+  unformat_free (line_input);
+
+  if (error)
+    {
+      *rbm = saved;
+      return error;
+    }
+
+  vlib_log_notice (rbm->log_class, "%s, interval %.2fs threshold %.0f%% "
+		   "hold-time %.1fs min-rate %.0f pps",
+		   rbm->enabled ? "enabled" : "disabled", rbm->interval,
+		   rbm->threshold * 100, rbm->hold_time, rbm->min_rate);
+
+  vlib_process_signal_event (vm, rx_balance_process_node.index,
+			     RX_BALANCE_EVENT_CONFIG, 0);
+  return 0;
+}
+
+/*?
+ * Enable or tune load aware rx queue placement. Every '<em>interval</em>'
+ * seconds the receive rate of each rx queue and the vectors per node of
+ * each worker are sampled. If the busiest worker receives more than
+ * '<em>threshold</em>' percent above the least busy one, and at least
+ * '<em>min-rate</em>' packets per second, one queue is moved from the
+ * busiest to the least busy worker. A queue which was moved is not
+ * considered again for '<em>hold-time</em>' seconds. Rates are smoothed
+ * with an exponential moving average giving '<em>smoothing</em>' percent
+ * weight to the newest sample. Moves are logged, see "show logging".
+ *
+ * @cliexpar
+ * @cliexcmd{set rx-balance enable interval 1 threshold 25 hold-time 10}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_rx_balance_command, static) = {
+  .path = "set rx-balance",
+  .short_help = "set rx-balance [enable|disable] [interval <sec>] "
+    "[threshold <percent>] [hold-time <sec>] [min-rate <pps>] "
+    "[min-vectors-per-node <n>] [smoothing <percent>]",
+  .function = set_rx_balance_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_rx_balance_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			    vlib_cli_command_t * cmd)
+{
+  rx_balance_main_t *rbm = &rx_balance_main;
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  f64 now = vlib_time_now (vm);
+  rx_balance_queue_t *rq;
+  uword t;
+
+  vlib_cli_output (vm, "rx-balance %s: interval %.2fs, threshold %.0f%%, "
+		   "hold-time %.1fs, min-rate %.0f pps, "
+		   "min-vectors-per-node %.1f, smoothing %.0f%%",
+		   rbm->enabled ? "enabled" : "disabled", rbm->interval,
+		   rbm->threshold * 100, rbm->hold_time, rbm->min_rate,
+		   rbm->min_vectors_per_node, rbm->smoothing * 100);
+  vlib_cli_output (vm, "samples %u, moves %u", rbm->n_samples, rbm->n_moves);
+
+  if (vdm->first_worker_thread_index == 0)
+    {
+      vlib_cli_output (vm, "no workers, nothing to balance");
+      return 0;
+    }
+
+  if (vec_len (rbm->workers) == 0)
+    return 0;
+
+  vlib_cli_output (vm, "%-8s%-16s%8s%14s%16s", "Thread", "Name", "Queues",
+		   "Rate (pps)", "Vectors/node");
+  for (t = vdm->first_worker_thread_index;
+       t <= vdm->last_worker_thread_index && t < vec_len (rbm->workers); t++)
+    vlib_cli_output (vm, "%-8u%-16s%8u%14.0f%16.2f", t,
+		     vlib_worker_threads[t].name, rbm->workers[t].n_queues,
+		     rbm->workers[t].rate, rbm->workers[t].vectors_per_node);
+
+  vlib_cli_output (vm, "%-32s%8s%8s%14s%14s", "Interface", "Queue",
+		   "Thread", "Rate (pps)", "Last move");
+  /* *INDENT-OFF* */
+  pool_foreach (rq, rbm->queues,
+  ({
+    u8 *s = 0;
+
+    if (rq->last_move_time > 0)
+      s = format (s, "%.1fs ago", now - rq->last_move_time);
+    else
+      s = format (s, "never");
+    vlib_cli_output (vm, "%-32U%8u%8u%14.0f%14v",
+		     format_vnet_hw_if_index_name, vnm, rq->hw_if_index,
+		     rq->queue_id, rq->thread_index, rq->rate, s);
+    vec_free (s);
+  }));
+  /* *INDENT-ON* */
+
+  return 0;
+}
+
+/*?
+ * Show the rx-balance configuration, the load of each worker and the
+ * smoothed receive rate of each rx queue as of the last sample.
+ *
+ * @cliexpar
+ * @cliexstart{show rx-balance}
+ * rx-balance enabled: interval 1.00s, threshold 25%, hold-time 10.0s, min-rate 1000 pps, min-vectors-per-node 0.0, smoothing 50%
+ * samples 42, moves 1
+ * Thread  Name              Queues    Rate (pps)    Vectors/node
+ * 1       vpp_wk_0               1       4021365           93.43
+ * 2       vpp_wk_1               1       3987112           92.87
+ * Interface                          Queue  Thread    Rate (pps)     Last move
+ * pg0                                    0       1       4021365         never
+ * pg1                                    0       2       3987112    31.0s ago
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_rx_balance_command, static) = {
+  .path = "show rx-balance",
+  .short_help = "show rx-balance",
+  .function = show_rx_balance_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+rx_balance_init (vlib_main_t * vm)
+{
+  rx_balance_main_t *rbm = &rx_balance_main;
+
+  rbm->interval = 1.0;
+  rbm->threshold = 0.25;
+  rbm->hold_time = 10.0;
+  rbm->min_rate = 1000.0;
+  rbm->smoothing = 0.5;
+  rbm->log_class = vlib_log_register_class ("rx-balance", 0);
+
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (rx_balance_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -37,6 +37,7 @@ tap_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
   unformat_input_t _line_input, *line_input = &_line_input;
   tap_create_if_args_t args = { 0 };
   int ip_addr_set = 0;
+  u32 num_queues = 1;
 
   args.id = ~0;
 
@@ -75,9 +76,15 @@ tap_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
 	    ;
 	  else if (unformat (line_input, "tx-ring-size %d", &args.tx_ring_sz))
 	    ;
+	  else if (unformat (line_input, "num-queues %u", &num_queues))
+	    ;
 	  else if (unformat (line_input, "hw-addr %U",
 			     unformat_ethernet_address, args.mac_addr))
 	    args.mac_addr_set = 1;
+	  else if (unformat (line_input, "csum-offload"))
+	    args.tap_flags |= TAP_FLAG_CSUM_OFFLOAD;
+	  else if (unformat (line_input, "gso"))
+	    args.tap_flags |= TAP_FLAG_GSO;
 	  else
 	    {
 	      unformat_free (line_input);
@@ -92,6 +99,10 @@ tap_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
     return clib_error_return (0, "Please specify either host ip address or "
 			      "host bridge");
 
+  if (num_queues == 0 || num_queues > 0xffff)
+    return clib_error_return (0, "invalid number of queues %u", num_queues);
+  args.num_queues = num_queues;
+
   tap_create_if (vm, &args);
 
   vec_free (args.host_if_name);
@@ -106,10 +117,11 @@ tap_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
 VLIB_CLI_COMMAND (tap_create_command, static) = {
   .path = "create tap",
   .short_help = "create tap {id <if-id>} [hw-addr <mac-address>] "
-    "[rx-ring-size <size>] [tx-ring-size <size>] [host-ns <netns>] "
-    "[host-bridge <bridge-name>] [host-ip4-addr <ip4addr/mask>] "
+    "[rx-ring-size <size>] [tx-ring-size <size>] [num-queues <n>] "
+    "[host-ns <netns>] [host-bridge <bridge-name>] "
+    "[host-ip4-addr <ip4addr/mask>] "
     "[host-ip6-addr <ip6-addr>] [host-ip4-gw <ip4-addr>] "
-    "[host-ip6-gw <ip6-addr>] [host-if-name <name>]",
+    "[host-ip6-gw <ip6-addr>] [host-if-name <name>] [csum-offload] [gso]",
   .function = tap_create_command_fn,
 };
 /* *INDENT-ON* */
@@ -240,8 +252,10 @@ tap_show_command_fn (vlib_main_t * vm, unformat_input_t * input,
 			     flag_entry->bit);
 	  flag_entry++;
 	}
-      vlib_cli_output (vm, "  fd %d", vif->fd);
-      vlib_cli_output (vm, "  tap-fd %d", vif->tap_fd);
+      vlib_cli_output (vm, "  num-queues %u", vif->num_queues);
+      for (i = 0; i < vif->num_queues; i++)
+	vlib_cli_output (vm, "  queue %d: fd %d, tap-fd %d", i,
+			 vif->vhost_fds[i], vif->tap_fds[i]);
       vlib_cli_output (vm, "  features 0x%lx", vif->features);
       feat_entry = (struct feat_struct *) &feat_array;
       while (feat_entry->str)
@@ -264,7 +278,8 @@ tap_show_command_fn (vlib_main_t * vm, unformat_input_t * input,
       {
 	// RX = 0, TX = 1
 	vring = vec_elt_at_index (vif->vrings, i);
-	vlib_cli_output (vm, "  Virtqueue (%s)", (i & 1) ? "TX" : "RX");
+	vlib_cli_output (vm, "  Virtqueue %d (%s)", i >> 1,
+			 (i & 1) ? "TX" : "RX");
 	vlib_cli_output (vm,
 			 "    qsz %d, last_used_idx %d, desc_next %d, desc_in_use %d",
 			 vring->size, vring->last_used_idx, vring->desc_next,
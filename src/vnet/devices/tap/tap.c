@@ -76,6 +76,7 @@ open_netns_fd (char *netns)
 }
 
 #define TAP_MAX_INSTANCE 1024
+#define TAP_MAX_QUEUES 256
 
 void
 tap_create_if (vlib_main_t * vm, tap_create_if_args_t * args)
@@ -93,6 +94,10 @@ tap_create_if (vlib_main_t * vm, tap_create_if_args_t * args)
   struct vhost_memory *vhost_mem = 0;
   virtio_if_t *vif = 0;
   clib_error_t *err = 0;
+  u16 num_queues = args->num_queues ? args->num_queues : 1;
+  unsigned int offload = 0;
+  int fd, *fdp;
+  u16 q;
 
   if (args->id != ~0)
     {
@@ -115,20 +120,34 @@ tap_create_if (vlib_main_t * vm, tap_create_if_args_t * args)
       return;
     }
 
+  if (num_queues > TAP_MAX_QUEUES)
+    {
+      args->rv = VNET_API_ERROR_INVALID_VALUE;
+      args->error = clib_error_return (0, "number of queues must be %u or "
+				       "lower", TAP_MAX_QUEUES);
+      return;
+    }
+
   memset (&ifr, 0, sizeof (ifr));
   pool_get (vim->interfaces, vif);
   vif->dev_instance = vif - vim->interfaces;
-  vif->tap_fd = -1;
   vif->id = args->id;
+  vif->num_queues = num_queues;
 
-  if ((vif->fd = open ("/dev/vhost-net", O_RDWR | O_NONBLOCK)) < 0)
+  /* vhost-net serves a single queue pair per device, so each queue gets
+     its own */
+  for (q = 0; q < num_queues; q++)
     {
-      args->rv = VNET_API_ERROR_SYSCALL_ERROR_1;
-      args->error = clib_error_return_unix (0, "open '/dev/vhost-net'");
-      goto error;
+      if ((fd = open ("/dev/vhost-net", O_RDWR | O_NONBLOCK)) < 0)
+	{
+	  args->rv = VNET_API_ERROR_SYSCALL_ERROR_1;
+	  args->error = clib_error_return_unix (0, "open '/dev/vhost-net'");
+	  goto error;
+	}
+      vec_add1 (vif->vhost_fds, fd);
     }
 
-  _IOCTL (vif->fd, VHOST_GET_FEATURES, &vif->remote_features);
+  _IOCTL (vif->vhost_fds[0], VHOST_GET_FEATURES, &vif->remote_features);
 
   if ((vif->remote_features & (1ULL << VIRTIO_NET_F_MRG_RXBUF)) == 0)
     {
@@ -158,24 +177,50 @@ tap_create_if (vlib_main_t * vm, tap_create_if_args_t * args)
   vif->features |= 1ULL << VIRTIO_F_VERSION_1;
   vif->features |= 1ULL << VIRTIO_RING_F_INDIRECT_DESC;
 
-  _IOCTL (vif->fd, VHOST_SET_FEATURES, &vif->features);
+  vec_foreach (fdp, vif->vhost_fds)
+  {
+    _IOCTL (*fdp, VHOST_SET_FEATURES, &vif->features);
+  }
 
-  if ((vif->tap_fd = open ("/dev/net/tun", O_RDWR | O_NONBLOCK)) < 0)
+  /* with IFF_MULTI_QUEUE every TUNSETIFF on the same name attaches one
+     more queue to the tap interface created by the first one */
+  ifr.ifr_flags = IFF_TAP | IFF_NO_PI | IFF_VNET_HDR;
+  ifr.ifr_flags |= num_queues > 1 ? IFF_MULTI_QUEUE : IFF_ONE_QUEUE;
+  for (q = 0; q < num_queues; q++)
     {
-      args->rv = VNET_API_ERROR_SYSCALL_ERROR_2;
-      args->error = clib_error_return_unix (0, "open '/dev/net/tun'");
-      goto error;
+      if ((fd = open ("/dev/net/tun", O_RDWR | O_NONBLOCK)) < 0)
+	{
+	  args->rv = VNET_API_ERROR_SYSCALL_ERROR_2;
+	  args->error = clib_error_return_unix (0, "open '/dev/net/tun'");
+	  goto error;
+	}
+      vec_add1 (vif->tap_fds, fd);
+      _IOCTL (fd, TUNSETIFF, (void *) &ifr);
     }
-
-  ifr.ifr_flags = IFF_TAP | IFF_NO_PI | IFF_ONE_QUEUE | IFF_VNET_HDR;
-  _IOCTL (vif->tap_fd, TUNSETIFF, (void *) &ifr);
   vif->ifindex = if_nametoindex (ifr.ifr_ifrn.ifrn_name);
 
-  unsigned int offload = 0;
+  /* Let the kernel hand us packets with partial checksums, and TCP
+     packets larger than the MTU, when we can take them */
+  if (args->tap_flags & (TAP_FLAG_CSUM_OFFLOAD | TAP_FLAG_GSO))
+    {
+      offload |= TUN_F_CSUM;
+      vif->flags |= VIRTIO_IF_FLAG_CSUM_OFFLOAD;
+    }
+  if (args->tap_flags & TAP_FLAG_GSO)
+    {
+      offload |= TUN_F_TSO4 | TUN_F_TSO6;
+      vif->flags |= VIRTIO_IF_FLAG_GSO;
+    }
   hdrsz = sizeof (struct virtio_net_hdr_v1);
-  _IOCTL (vif->tap_fd, TUNSETOFFLOAD, offload);
-  _IOCTL (vif->tap_fd, TUNSETVNETHDRSZ, &hdrsz);
-  _IOCTL (vif->fd, VHOST_SET_OWNER, 0);
+  vec_foreach (fdp, vif->tap_fds)
+  {
+    _IOCTL (*fdp, TUNSETOFFLOAD, offload);
+    _IOCTL (*fdp, TUNSETVNETHDRSZ, &hdrsz);
+  }
+  vec_foreach (fdp, vif->vhost_fds)
+  {
+    _IOCTL (*fdp, VHOST_SET_OWNER, 0);
+  }
 
   /* if namespace is specified, all further netlink messages should be excuted
      after we change our net namespace */
@@ -320,18 +365,26 @@ tap_create_if (vlib_main_t * vm, tap_create_if_args_t * args)
   memset (vhost_mem, 0, i);
   vhost_mem->nregions = 1;
   vhost_mem->regions[0].memory_size = (1ULL << 47) - 4096;
-  _IOCTL (vif->fd, VHOST_SET_MEM_TABLE, vhost_mem);
+  vec_foreach (fdp, vif->vhost_fds)
+  {
+    _IOCTL (*fdp, VHOST_SET_MEM_TABLE, vhost_mem);
+  }
 
-  if ((args->error = virtio_vring_init (vm, vif, 0, args->rx_ring_sz)))
+  for (q = 0; q < num_queues; q++)
     {
-      args->rv = VNET_API_ERROR_INIT_FAILED;
-      goto error;
-    }
+      if ((args->error = virtio_vring_init (vm, vif, 2 * q,
+					    args->rx_ring_sz)))
+	{
+	  args->rv = VNET_API_ERROR_INIT_FAILED;
+	  goto error;
+	}
 
-  if ((args->error = virtio_vring_init (vm, vif, 1, args->tx_ring_sz)))
-    {
-      args->rv = VNET_API_ERROR_INIT_FAILED;
-      goto error;
+      if ((args->error = virtio_vring_init (vm, vif, 2 * q + 1,
+					    args->tx_ring_sz)))
+	{
+	  args->rv = VNET_API_ERROR_INIT_FAILED;
+	  goto error;
+	}
     }
 
   if (!args->mac_addr_set)
@@ -378,18 +431,29 @@ tap_create_if (vlib_main_t * vm, tap_create_if_args_t * args)
   args->sw_if_index = vif->sw_if_index;
   hw = vnet_get_hw_interface (vnm, vif->hw_if_index);
   hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_INT_MODE;
+  /* The kernel completes checksums and segments what we send it */
+  if (vif->flags & VIRTIO_IF_FLAG_CSUM_OFFLOAD)
+    hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD;
+  if (vif->flags & VIRTIO_IF_FLAG_GSO)
+    hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO;
   vnet_hw_interface_set_input_node (vnm, vif->hw_if_index,
 				    virtio_input_node.index);
-  vnet_hw_interface_assign_rx_thread (vnm, vif->hw_if_index, 0, ~0);
-  vnet_hw_interface_set_rx_mode (vnm, vif->hw_if_index, 0,
-				 VNET_HW_INTERFACE_RX_MODE_DEFAULT);
+  /* spread the RX queues over the workers */
+  for (q = 0; q < num_queues; q++)
+    {
+      vnet_hw_interface_assign_rx_thread (vnm, vif->hw_if_index, q, ~0);
+      vnet_hw_interface_set_rx_mode (vnm, vif->hw_if_index, q,
+				     VNET_HW_INTERFACE_RX_MODE_DEFAULT);
+    }
   vif->per_interface_next_index = ~0;
   vif->type = VIRTIO_IF_TYPE_TAP;
   vif->flags |= VIRTIO_IF_FLAG_ADMIN_UP;
   vnet_hw_interface_set_flags (vnm, vif->hw_if_index,
 			       VNET_HW_INTERFACE_FLAG_LINK_UP);
-  if (thm->n_vlib_mains > 1)
-    clib_spinlock_init (&vif->lockp);
+  /* TX vrings are only shared when there are fewer queues than threads */
+  if (thm->n_vlib_mains > num_queues)
+    for (q = 0; q < num_queues; q++)
+      clib_spinlock_init (&vec_elt (vif->vrings, 2 * q + 1).lockp);
   goto done;
 
 error:
@@ -399,10 +463,10 @@ error:
       args->error = err;
       args->rv = VNET_API_ERROR_SYSCALL_ERROR_3;
     }
-  if (vif->tap_fd != -1)
-    close (vif->tap_fd);
-  if (vif->fd != -1)
-    close (vif->fd);
+  vec_foreach (fdp, vif->tap_fds) close (*fdp);
+  vec_free (vif->tap_fds);
+  vec_foreach (fdp, vif->vhost_fds) close (*fdp);
+  vec_free (vif->vhost_fds);
   vec_foreach_index (i, vif->vrings) virtio_vring_free (vm, vif, i);
   vec_free (vif->vrings);
   memset (vif, 0, sizeof (virtio_if_t));
@@ -421,7 +485,7 @@ tap_delete_if (vlib_main_t * vm, u32 sw_if_index)
   vnet_main_t *vnm = vnet_get_main ();
   virtio_main_t *mm = &virtio_main;
   tap_main_t *tm = &tap_main;
-  int i;
+  int i, *fdp;
   virtio_if_t *vif;
   vnet_hw_interface_t *hw;
 
@@ -434,21 +498,21 @@ tap_delete_if (vlib_main_t * vm, u32 sw_if_index)
   /* bring down the interface */
   vnet_hw_interface_set_flags (vnm, vif->hw_if_index, 0);
   vnet_sw_interface_set_flags (vnm, vif->sw_if_index, 0);
-  vnet_hw_interface_unassign_rx_thread (vnm, vif->hw_if_index, 0);
+  for (i = 0; i < vif->num_queues; i++)
+    vnet_hw_interface_unassign_rx_thread (vnm, vif->hw_if_index, i);
 
   ethernet_delete_interface (vnm, vif->hw_if_index);
   vif->hw_if_index = ~0;
 
-  if (vif->tap_fd != -1)
-    close (vif->tap_fd);
-  if (vif->fd != -1)
-    close (vif->fd);
+  vec_foreach (fdp, vif->tap_fds) close (*fdp);
+  vec_free (vif->tap_fds);
+  vec_foreach (fdp, vif->vhost_fds) close (*fdp);
+  vec_free (vif->vhost_fds);
 
   vec_foreach_index (i, vif->vrings) virtio_vring_free (vm, vif, i);
   vec_free (vif->vrings);
 
   tm->tap_ids = clib_bitmap_set (tm->tap_ids, vif->id, 0);
-  clib_spinlock_free (&vif->lockp);
   memset (vif, 0, sizeof (*vif));
   pool_put (mm->interfaces, vif);
 
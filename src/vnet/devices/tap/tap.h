@@ -22,13 +22,19 @@
 #define MIN(x,y) (((x)<(y))?(x):(y))
 #endif
 
+#define TAP_FLAG_CSUM_OFFLOAD (1 << 0)
+#define TAP_FLAG_GSO (1 << 1)
+
 typedef struct
 {
   u32 id;
+  u32 tap_flags;
   u8 mac_addr_set;
   u8 mac_addr[6];
   u16 rx_ring_sz;
   u16 tx_ring_sz;
+  /* number of RX/TX queue pairs, 0 means 1 */
+  u16 num_queues;
   u8 *host_namespace;
   u8 *host_if_name;
   u8 host_mac_addr[6];
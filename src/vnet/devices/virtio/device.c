@@ -27,6 +27,7 @@
 #include <vnet/ip/ip4_packet.h>
 #include <vnet/ip/ip6_packet.h>
 #include <vnet/devices/virtio/virtio.h>
+#include <vnet/devices/virtio/virtio_offload.h>
 
 #define foreach_virtio_tx_func_error	       \
 _(NO_FREE_SLOTS, "no free tx slots")           \
@@ -123,7 +124,7 @@ virtio_free_used_desc (vlib_main_t * vm, virtio_vring_t * vring)
 
 static_always_inline u16
 add_buffer_to_slot (vlib_main_t * vm, virtio_vring_t * vring, u32 bi,
-		    u16 avail, u16 next, u16 mask)
+		    u16 avail, u16 next, u16 mask, int do_offload)
 {
   u16 n_added = 0;
   const int hdr_sz = sizeof (struct virtio_net_hdr_v1);
@@ -133,6 +134,8 @@ add_buffer_to_slot (vlib_main_t * vm, virtio_vring_t * vring, u32 bi,
   struct virtio_net_hdr_v1 *hdr = vlib_buffer_get_current (b) - hdr_sz;
 
   memset (hdr, 0, hdr_sz);
+  if (do_offload)
+    virtio_net_hdr_from_buffer (b, (virtio_net_offload_hdr_t *) hdr);
 
   if (PREDICT_TRUE ((b->flags & VLIB_BUFFER_NEXT_PRESENT) == 0))
     {
@@ -174,15 +177,18 @@ static_always_inline uword
 virtio_interface_tx_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 			    vlib_frame_t * frame, virtio_if_t * vif)
 {
-  u8 qid = 0;
+  /* with as many queues as threads every thread owns its TX vring and
+     no lock is taken, otherwise threads share vrings under a spinlock */
+  u16 qid = vm->thread_index % vif->num_queues;
   u16 n_left = frame->n_vectors;
   virtio_vring_t *vring = vec_elt_at_index (vif->vrings, (qid << 1) + 1);
   u16 used, next, avail;
   u16 sz = vring->size;
   u16 mask = sz - 1;
   u32 *buffers = vlib_frame_args (frame);
+  int do_offload = (vif->flags & VIRTIO_IF_FLAG_CSUM_OFFLOAD) != 0;
 
-  clib_spinlock_lock_if_init (&vif->lockp);
+  clib_spinlock_lock_if_init (&vring->lockp);
 
   /* free consumed buffers */
   virtio_free_used_desc (vm, vring);
@@ -194,7 +200,8 @@ virtio_interface_tx_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   while (n_left && used < sz)
     {
       u16 n_added;
-      n_added = add_buffer_to_slot (vm, vring, buffers[0], avail, next, mask);
+      n_added = add_buffer_to_slot (vm, vring, buffers[0], avail, next, mask,
+				    do_offload);
       avail += n_added;
       next = (next + n_added) & mask;
       used += n_added;
@@ -223,7 +230,7 @@ virtio_interface_tx_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
       vlib_buffer_free (vm, buffers, n_left);
     }
 
-  clib_spinlock_unlock_if_init (&vif->lockp);
+  clib_spinlock_unlock_if_init (&vring->lockp);
 
   return frame->n_vectors - n_left;
 }
@@ -272,7 +279,7 @@ virtio_interface_rx_mode_change (vnet_main_t * vnm, u32 hw_if_index, u32 qid,
   virtio_main_t *mm = &virtio_main;
   vnet_hw_interface_t *hw = vnet_get_hw_interface (vnm, hw_if_index);
   virtio_if_t *vif = pool_elt_at_index (mm->interfaces, hw->dev_instance);
-  virtio_vring_t *vring = vec_elt_at_index (vif->vrings, qid);
+  virtio_vring_t *vring = vec_elt_at_index (vif->vrings, qid << 1);
 
   if (mode == VNET_HW_INTERFACE_RX_MODE_POLLING)
     vring->avail->flags |= VIRTIO_RING_FLAG_MASK_INT;
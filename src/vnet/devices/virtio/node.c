@@ -33,6 +33,7 @@
 #include <vnet/ip/ip4_packet.h>
 #include <vnet/ip/ip6_packet.h>
 #include <vnet/devices/virtio/virtio.h>
+#include <vnet/devices/virtio/virtio_offload.h>
 
 
 #define foreach_virtio_input_error \
@@ -130,7 +131,7 @@ virtio_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   vnet_main_t *vnm = vnet_get_main ();
   u32 thread_index = vlib_get_thread_index ();
   uword n_trace = vlib_get_trace_count (vm, node);
-  virtio_vring_t *vring = vec_elt_at_index (vif->vrings, 0);
+  virtio_vring_t *vring = vec_elt_at_index (vif->vrings, qid << 1);
   u32 next_index = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
   const int hdr_sz = sizeof (struct virtio_net_hdr_v1);
   u32 *to_next = 0;
@@ -198,6 +199,10 @@ virtio_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 		}
 	    }
 
+	  /* the header is in the headroom of the first buffer */
+	  if (PREDICT_FALSE (hdr->flags || hdr->gso_type))
+	    virtio_net_hdr_to_buffer (b0, (virtio_net_offload_hdr_t *) hdr);
+
 	  if (PREDICT_FALSE (vif->per_interface_next_index != ~0))
 	    next0 = vif->per_interface_next_index;
 	  else
@@ -107,7 +107,8 @@
   _ (SIMPLE_CHAINED, 0, "Simple descriptor chaining") \
   _ (SINGLE_DESC,  1, "Single descriptor packet") \
   _ (INDIRECT, 2, "Indirect descriptor") \
-  _ (MAP_ERROR, 4, "Memory mapping error")
+  _ (MAP_ERROR, 4, "Memory mapping error") \
+  _ (PACKED, 5, "Packed virtqueue")
 
 typedef enum
 {
@@ -621,6 +622,102 @@ vhost_user_vring_unlock (vhost_user_intf_t * vui, u32 qid)
   *vui->vring_locks[qid] = 0;
 }
 
+static_always_inline u8
+vhost_user_is_packed_ring_supported (vhost_user_intf_t * vui)
+{
+  return (vui->features & (1ULL << FEAT_VIRTIO_F_RING_PACKED)) ? 1 : 0;
+}
+
+/**
+ * @brief Tell the driver whether we want to be kicked for this vring
+ */
+static_always_inline void
+vhost_user_vring_set_notify (vhost_user_intf_t * vui,
+			     vhost_user_vring_t * vq, u8 enable)
+{
+  if (vhost_user_is_packed_ring_supported (vui))
+    vq->used_event->flags =
+      enable ? VRING_EVENT_F_ENABLE : VRING_EVENT_F_DISABLE;
+  else
+    vq->used->flags = enable ? 0 : VRING_USED_F_NO_NOTIFY;
+}
+
+/**
+ * @brief Returns whether the driver wants to be called for this vring
+ */
+static_always_inline u8
+vhost_user_vring_wants_interrupt (vhost_user_intf_t * vui,
+				  vhost_user_vring_t * vq)
+{
+  if (vhost_user_is_packed_ring_supported (vui))
+    return vq->avail_event->flags != VRING_EVENT_F_DISABLE;
+  return !(vq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT);
+}
+
+/**
+ * @brief Returns whether the packed ring descriptor at position idx was
+ * made available by the driver for the current avail wrap counter.
+ */
+static_always_inline int
+vhost_user_packed_desc_available (vhost_user_vring_t * vq, u16 idx)
+{
+  u16 flags = __atomic_load_n (&vq->packed_desc[idx].flags,
+			       __ATOMIC_ACQUIRE);
+  return (((flags & VIRTQ_DESC_F_AVAIL) != 0) == vq->avail_wrap_counter) &&
+    (((flags & VIRTQ_DESC_F_USED) != 0) != vq->avail_wrap_counter);
+}
+
+static_always_inline void
+vhost_user_packed_advance (u16 * idx, u8 * wrap_counter, u16 n,
+			   u16 qsz_mask)
+{
+  u32 next = (u32) * idx + n;
+  if (next > qsz_mask)
+    {
+      next -= qsz_mask + 1;
+      *wrap_counter ^= 1;
+    }
+  *idx = next;
+}
+
+/**
+ * @brief Queue the used descriptor of a buffer made of n_descs ring
+ * descriptors. It is written to the ring by vhost_user_packed_flush_used.
+ */
+static_always_inline void
+vhost_user_packed_put_used (vhost_user_vring_t * vq,
+			    vhost_packed_used_t * used, u16 id, u32 len,
+			    u16 n_descs)
+{
+  used->slot = vq->last_used_idx;
+  used->id = id;
+  used->len = len;
+  used->flags = vq->used_wrap_counter ?
+    (VIRTQ_DESC_F_AVAIL | VIRTQ_DESC_F_USED) : 0;
+  vhost_user_packed_advance (&vq->last_used_idx, &vq->used_wrap_counter,
+			     n_descs, vq->qsz_mask);
+}
+
+/**
+ * @brief Give the queued used descriptors back to the driver.
+ * Must be called once the memory copies for these buffers are done.
+ */
+static_always_inline void
+vhost_user_packed_flush_used (vhost_user_vring_t * vq,
+			      vhost_packed_used_t * used, u32 n_used)
+{
+  u32 i;
+
+  for (i = 0; i < n_used; i++)
+    {
+      vq->packed_desc[used[i].slot].id = used[i].id;
+      vq->packed_desc[used[i].slot].len = used[i].len;
+    }
+  CLIB_MEMORY_BARRIER ();
+  for (i = 0; i < n_used; i++)
+    vq->packed_desc[used[i].slot].flags = used[i].flags;
+}
+
 static inline void
 vhost_user_vring_init (vhost_user_intf_t * vui, u32 qid)
 {
@@ -629,6 +726,8 @@ vhost_user_vring_init (vhost_user_intf_t * vui, u32 qid)
   vring->kickfd_idx = ~0;
   vring->callfd_idx = ~0;
   vring->errfd = -1;
+  vring->avail_wrap_counter = 1;
+  vring->used_wrap_counter = 1;
 
   /*
    * We have a bug with some qemu 2.5, and this may be a fix.
@@ -841,6 +940,18 @@ vhost_user_socket_read (clib_file_t * uf)
 	(1ULL << FEAT_VIRTIO_NET_F_MQ) |
 	(1ULL << FEAT_VHOST_USER_F_PROTOCOL_FEATURES) |
 	(1ULL << FEAT_VIRTIO_F_VERSION_1);
+      if (vui->enable_csum || vui->enable_gso)
+	msg.u64 |= (1ULL << FEAT_VIRTIO_NET_F_CSUM) |
+	  (1ULL << FEAT_VIRTIO_NET_F_GUEST_CSUM);
+      if (vui->enable_gso)
+	msg.u64 |= (1ULL << FEAT_VIRTIO_NET_F_GUEST_TSO4) |
+	  (1ULL << FEAT_VIRTIO_NET_F_GUEST_TSO6) |
+	  (1ULL << FEAT_VIRTIO_NET_F_HOST_TSO4) |
+	  (1ULL << FEAT_VIRTIO_NET_F_HOST_TSO6);
+      /* Used descriptors are not logged for packed rings */
+      if (vui->enable_packed)
+	msg.u64 = (msg.u64 & ~(1ULL << FEAT_VHOST_F_LOG_ALL)) |
+	  (1ULL << FEAT_VIRTIO_F_RING_PACKED);
       msg.u64 &= vui->feature_mask;
       msg.size = sizeof (msg.u64);
       DBG_SOCK ("if %d msg VHOST_USER_GET_FEATURES - reply 0x%016llx",
@@ -864,6 +975,24 @@ vhost_user_socket_read (clib_file_t * uf)
 	(vui->features & (1 << FEAT_VIRTIO_F_ANY_LAYOUT)) ? 1 : 0;
 
       ASSERT (vui->virtio_net_hdr_sz < VLIB_BUFFER_PRE_DATA_SIZE);
+
+      /* The driver completes partial checksums and segments large TCP
+         packets we send it, so interface-output need not */
+      {
+	vnet_hw_interface_t *hw =
+	  vnet_get_hw_interface (vnm, vui->hw_if_index);
+	u64 gso_features = (1ULL << FEAT_VIRTIO_NET_F_GUEST_CSUM) |
+	  (1ULL << FEAT_VIRTIO_NET_F_GUEST_TSO4) |
+	  (1ULL << FEAT_VIRTIO_NET_F_GUEST_TSO6);
+
+	hw->flags &= ~(VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD |
+		       VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO);
+	if (vui->features & (1ULL << FEAT_VIRTIO_NET_F_GUEST_CSUM))
+	  hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD;
+	if ((vui->features & gso_features) == gso_features)
+	  hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO;
+      }
+
       vnet_hw_interface_set_flags (vnm, vui->hw_if_index, 0);
       vui->is_up = 0;
 
@@ -983,12 +1112,15 @@ vhost_user_socket_read (clib_file_t * uf)
 	  vui->vrings[msg.state.index].enabled = 1;
 	}
 
-      vui->vrings[msg.state.index].last_used_idx =
-	vui->vrings[msg.state.index].last_avail_idx =
-	vui->vrings[msg.state.index].used->idx;
+      /* Packed rings have no used index, positions come from
+         VHOST_USER_SET_VRING_BASE */
+      if (!vhost_user_is_packed_ring_supported (vui))
+	vui->vrings[msg.state.index].last_used_idx =
+	  vui->vrings[msg.state.index].last_avail_idx =
+	  vui->vrings[msg.state.index].used->idx;
 
       /* tell driver that we don't want interrupts */
-      vui->vrings[msg.state.index].used->flags = VRING_USED_F_NO_NOTIFY;
+      vhost_user_vring_set_notify (vui, &vui->vrings[msg.state.index], 0);
       break;
 
     case VHOST_USER_SET_OWNER:
@@ -1095,7 +1227,29 @@ vhost_user_socket_read (clib_file_t * uf)
       DBG_SOCK ("if %d msg VHOST_USER_SET_VRING_BASE idx %d num %d",
 		vui->hw_if_index, msg.state.index, msg.state.num);
 
-      vui->vrings[msg.state.index].last_avail_idx = msg.state.num;
+      if (msg.state.index >= VHOST_VRING_MAX_N)
+	{
+	  DBG_SOCK ("invalid vring index VHOST_USER_SET_VRING_BASE:"
+		    " %d >= %d", msg.state.index, VHOST_VRING_MAX_N);
+	  goto close_socket;
+	}
+
+      if (vhost_user_is_packed_ring_supported (vui))
+	{
+	  /*
+	   * Packed rings: bits 0-14 hold the last avail position and bit 15
+	   * the avail wrap counter. The upper 16 bits hold the same for the
+	   * used side, some drivers leave them at zero as both positions
+	   * are the same when the ring is stopped.
+	   */
+	  vhost_user_vring_t *vq = &vui->vrings[msg.state.index];
+	  vq->last_avail_idx = msg.state.num & 0x7fff;
+	  vq->avail_wrap_counter = (msg.state.num >> 15) & 1;
+	  vq->last_used_idx = vq->last_avail_idx;
+	  vq->used_wrap_counter = vq->avail_wrap_counter;
+	}
+      else
+	vui->vrings[msg.state.index].last_avail_idx = msg.state.num;
       break;
 
     case VHOST_USER_GET_VRING_BASE:
@@ -1111,6 +1265,13 @@ vhost_user_socket_read (clib_file_t * uf)
        * closing the vring also initializes the vring last_avail_idx
        */
       msg.state.num = vui->vrings[msg.state.index].last_avail_idx;
+      if (vhost_user_is_packed_ring_supported (vui))
+	{
+	  vhost_user_vring_t *vq = &vui->vrings[msg.state.index];
+	  msg.state.num |= vq->avail_wrap_counter << 15;
+	  msg.state.num |= (vq->last_used_idx |
+			    (vq->used_wrap_counter << 15)) << 16;
+	}
       msg.flags |= 4;
       msg.size = sizeof (msg.state);
 
@@ -1417,6 +1578,46 @@ vhost_user_rx_trace (vhost_trace_t * t,
     }
 }
 
+void
+vhost_user_rx_trace_packed (vhost_trace_t * t,
+			    vhost_user_intf_t * vui, u16 qid,
+			    vlib_buffer_t * b, vhost_user_vring_t * txvq)
+{
+  vhost_user_main_t *vum = &vhost_user_main;
+  vring_packed_desc_t *desc = &txvq->packed_desc[txvq->last_avail_idx];
+  vring_packed_desc_t *hdr_desc = desc;
+  virtio_net_hdr_mrg_rxbuf_t *hdr;
+  u32 hint = 0;
+
+  memset (t, 0, sizeof (*t));
+  t->device_index = vui - vum->vhost_user_interfaces;
+  t->qid = qid;
+  t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_PACKED;
+
+  if (desc->flags & VIRTQ_DESC_F_INDIRECT)
+    {
+      t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_INDIRECT;
+      /* Header is the first here */
+      hdr_desc = map_guest_mem (vui, desc->addr, &hint);
+    }
+  else if (desc->flags & VIRTQ_DESC_F_NEXT)
+    t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_SIMPLE_CHAINED;
+  else
+    t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_SINGLE_DESC;
+
+  t->first_desc_len = hdr_desc ? hdr_desc->len : 0;
+
+  if (!hdr_desc || !(hdr = map_guest_mem (vui, hdr_desc->addr, &hint)))
+    {
+      t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_MAP_ERROR;
+    }
+  else
+    {
+      u32 len = vui->virtio_net_hdr_sz;
+      memcpy (&t->hdr, hdr, len > hdr_desc->len ? hdr_desc->len : len);
+    }
+}
+
 static inline void
 vhost_user_send_call (vlib_main_t * vm, vhost_user_vring_t * vq)
 {
@@ -1514,33 +1715,406 @@ vhost_user_rx_discard_packet (vlib_main_t * vm,
       discarded_packets++;
     }
 
-out:
-  CLIB_MEMORY_BARRIER ();
-  txvq->used->idx = txvq->last_used_idx;
-  vhost_user_log_dirty_ring (vui, txvq, idx);
-  return discarded_packets;
-}
+out:
+  CLIB_MEMORY_BARRIER ();
+  txvq->used->idx = txvq->last_used_idx;
+  vhost_user_log_dirty_ring (vui, txvq, idx);
+  return discarded_packets;
+}
+
+/**
+ * Packed ring version of vhost_user_rx_discard_packet.
+ * Returns the number of discarded packets.
+ */
+u32
+vhost_user_rx_discard_packet_packed (vlib_main_t * vm,
+				     vhost_user_intf_t * vui,
+				     vhost_user_vring_t * txvq,
+				     u32 discard_max)
+{
+  u32 discarded_packets = 0;
+  vhost_packed_used_t used;
+
+  while (discarded_packets != discard_max &&
+	 vhost_user_packed_desc_available (txvq, txvq->last_avail_idx))
+    {
+      /* The buffer id is the one of the last descriptor of the chain */
+      u16 desc_index = txvq->last_avail_idx;
+      u16 n_descs = 1;
+
+      while ((txvq->packed_desc[desc_index].flags & VIRTQ_DESC_F_NEXT) &&
+	     n_descs <= txvq->qsz_mask)
+	{
+	  desc_index = (desc_index + 1) & txvq->qsz_mask;
+	  n_descs++;
+	}
+
+      vhost_user_packed_put_used (txvq, &used,
+				  txvq->packed_desc[desc_index].id, 0,
+				  n_descs);
+      vhost_user_packed_flush_used (txvq, &used, 1);
+      vhost_user_packed_advance (&txvq->last_avail_idx,
+				 &txvq->avail_wrap_counter, n_descs,
+				 txvq->qsz_mask);
+      discarded_packets++;
+    }
+
+  return discarded_packets;
+}
+
+/**
+ * Apply the offload info of the packets whose data copies are done.
+ */
+static_always_inline void
+vhost_user_input_apply_offload (vlib_main_t * vm, vhost_cpu_t * cpu)
+{
+  vhost_rx_offload_t *o;
+
+  vec_foreach (o, cpu->rx_offload)
+    virtio_net_hdr_to_buffer (vlib_get_buffer (vm, o->buffer_index),
+			      &o->hdr);
+  vec_reset_length (cpu->rx_offload);
+}
+
+/*
+ * In case of overflow, we need to rewind the array of allocated buffers.
+ */
+static void
+vhost_user_input_rewind_buffers (vlib_main_t * vm,
+				 vhost_cpu_t * cpu, vlib_buffer_t * b_head)
+{
+  u32 bi_current = cpu->rx_buffers[cpu->rx_buffers_len];
+  vlib_buffer_t *b_current = vlib_get_buffer (vm, bi_current);
+  b_current->current_length = 0;
+  b_current->flags = 0;
+  while (b_current != b_head)
+    {
+      cpu->rx_buffers_len++;
+      bi_current = cpu->rx_buffers[cpu->rx_buffers_len];
+      b_current = vlib_get_buffer (vm, bi_current);
+      b_current->current_length = 0;
+      b_current->flags = 0;
+    }
+  cpu->rx_buffers_len++;
+}
+
+/**
+ * Packed ring version of vhost_user_if_input.
+ * Descriptors are returned to the driver in place, once the memory
+ * copies for the corresponding packets are done.
+ */
+static u32
+vhost_user_if_input_packed (vlib_main_t * vm,
+			    vhost_user_main_t * vum,
+			    vhost_user_intf_t * vui,
+			    u16 qid, vlib_node_runtime_t * node)
+{
+  vhost_user_vring_t *txvq = &vui->vrings[VHOST_VRING_IDX_TX (qid)];
+  u16 n_rx_packets = 0;
+  u32 n_rx_bytes = 0;
+  u16 n_left = vm->frame_size;
+  u32 n_left_to_next, *to_next;
+  u32 next_index = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
+  u32 n_trace = vlib_get_trace_count (vm, node);
+  u32 map_hint = 0;
+  u16 thread_index = vlib_get_thread_index ();
+  vhost_cpu_t *cpu = &vum->cpus[thread_index];
+  u16 copy_len = 0;
+  u32 n_used = 0;
+  int rx_offload =
+    (vui->features & (1ULL << FEAT_VIRTIO_NET_F_CSUM)) != 0;
+
+  /* nothing to do */
+  if (!vhost_user_packed_desc_available (txvq, txvq->last_avail_idx))
+    return 0;
+
+  if (PREDICT_FALSE (!vui->admin_up || !(txvq->enabled)))
+    {
+      vhost_user_rx_discard_packet_packed (vm, vui, txvq,
+					   VHOST_USER_DOWN_DISCARD_COUNT);
+      return 0;
+    }
+
+  /* The number of available descriptors is not known, see
+     vhost_user_if_input for the buffer allocation policy */
+  if (PREDICT_FALSE (cpu->rx_buffers_len < n_left + 1 ||
+		     cpu->rx_buffers_len < 40))
+    {
+      u32 curr_len = cpu->rx_buffers_len;
+      cpu->rx_buffers_len +=
+	vlib_buffer_alloc_from_free_list (vm, cpu->rx_buffers + curr_len,
+					  VHOST_USER_RX_BUFFERS_N - curr_len,
+					  VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
+
+      if (PREDICT_FALSE
+	  (cpu->rx_buffers_len < VHOST_USER_RX_BUFFER_STARVATION))
+	{
+	  u32 flush = (n_left + 1 > cpu->rx_buffers_len) ?
+	    n_left + 1 - cpu->rx_buffers_len : 1;
+	  flush = vhost_user_rx_discard_packet_packed (vm, vui, txvq, flush);
+
+	  n_left -= flush;
+	  vlib_increment_simple_counter (vnet_main.
+					 interface_main.sw_if_counters +
+					 VNET_INTERFACE_COUNTER_DROP,
+					 thread_index, vui->sw_if_index,
+					 flush);
+
+	  vlib_error_count (vm, vhost_user_input_node.index,
+			    VHOST_USER_INPUT_FUNC_ERROR_NO_BUFFER, flush);
+	}
+    }
+
+  while (n_left > 0)
+    {
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+
+      while (n_left > 0 && n_left_to_next > 0)
+	{
+	  vlib_buffer_t *b_head, *b_current;
+	  u32 bi_current;
+	  u32 desc_data_offset;
+	  vring_packed_desc_t *desc_table = txvq->packed_desc;
+	  virtio_net_offload_hdr_t offload_hdr = { 0 };
+	  u16 desc_current = txvq->last_avail_idx;
+	  u16 buffer_id, n_descs = 1, n_ind = 0;
+
+	  if (PREDICT_FALSE (cpu->rx_buffers_len <= 1))
+	    {
+	      /* Not enough rx_buffers */
+	      n_left = 0;
+	      break;
+	    }
+
+	  if (!vhost_user_packed_desc_available (txvq, desc_current))
+	    {
+	      n_left = 0;
+	      break;
+	    }
+
+	  buffer_id = desc_table[desc_current].id;
+	  cpu->rx_buffers_len--;
+	  bi_current = cpu->rx_buffers[cpu->rx_buffers_len];
+	  b_head = b_current = vlib_get_buffer (vm, bi_current);
+	  to_next[0] = bi_current;	//We do that now so we can forget about bi_current
+	  to_next++;
+	  n_left_to_next--;
+
+	  vlib_prefetch_buffer_with_index
+	    (vm, cpu->rx_buffers[cpu->rx_buffers_len - 1], LOAD);
+
+	  /* The buffer should already be initialized */
+	  b_head->total_length_not_including_first_buffer = 0;
+	  b_head->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
+
+	  if (PREDICT_FALSE (n_trace))
+	    {
+	      //TODO: next_index is not exactly known at that point
+	      vlib_trace_buffer (vm, node, next_index, b_head,
+				 /* follow_chain */ 0);
+	      vhost_trace_t *t0 =
+		vlib_add_trace (vm, node, b_head, sizeof (t0[0]));
+	      vhost_user_rx_trace_packed (t0, vui, qid, b_head, txvq);
+	      n_trace--;
+	      vlib_set_trace_count (vm, node, n_trace);
+	    }
+
+	  if (desc_table[desc_current].flags & VIRTQ_DESC_F_INDIRECT)
+	    {
+	      n_ind = desc_table[desc_current].len /
+		sizeof (vring_packed_desc_t);
+	      desc_table = map_guest_mem (vui, desc_table[desc_current].addr,
+					  &map_hint);
+	      desc_current = 0;
+	      if (PREDICT_FALSE (desc_table == 0 || n_ind == 0))
+		{
+		  vlib_error_count (vm, node->node_index,
+				    VHOST_USER_INPUT_FUNC_ERROR_MMAP_FAIL, 1);
+		  goto out;
+		}
+	    }
+
+	  if (PREDICT_FALSE (rx_offload))
+	    {
+	      virtio_net_offload_hdr_t *h =
+		map_guest_mem (vui, desc_table[desc_current].addr,
+			       &map_hint);
+	      if (h)
+		offload_hdr = *h;
+	    }
+
+	  /* VIRTIO_F_VERSION_1 is implied, which means ANYLAYOUT */
+	  desc_data_offset = vui->virtio_net_hdr_sz;
+
+	  while (1)
+	    {
+	      /* Get more input if necessary. Or end of packet. */
+	      if (desc_data_offset == desc_table[desc_current].len)
+		{
+		  if (PREDICT_FALSE (n_ind))
+		    {
+		      if (desc_current + 1 >= n_ind)
+			goto out;
+		      desc_current++;
+		    }
+		  else if (PREDICT_FALSE (desc_table[desc_current].flags &
+					  VIRTQ_DESC_F_NEXT) &&
+			   n_descs <= txvq->qsz_mask)
+		    {
+		      desc_current = (desc_current + 1) & txvq->qsz_mask;
+		      n_descs++;
+		    }
+		  else
+		    {
+		      goto out;
+		    }
+		  desc_data_offset = 0;
+		}
+
+	      /* Get more output if necessary. Or end of packet. */
+	      if (PREDICT_FALSE
+		  (b_current->current_length == VLIB_BUFFER_DATA_SIZE))
+		{
+		  if (PREDICT_FALSE (cpu->rx_buffers_len == 0))
+		    {
+		      /* Cancel speculation */
+		      to_next--;
+		      n_left_to_next++;
+
+		      /*
+		       * The descriptors have not been consumed, the
+		       * scheduled copies are valid but useless.
+		       */
+		      vhost_user_input_rewind_buffers (vm, cpu, b_head);
+		      n_left = 0;
+		      goto stop;
+		    }
+
+		  /* Get next output */
+		  cpu->rx_buffers_len--;
+		  u32 bi_next = cpu->rx_buffers[cpu->rx_buffers_len];
+		  b_current->next_buffer = bi_next;
+		  b_current->flags |= VLIB_BUFFER_NEXT_PRESENT;
+		  bi_current = bi_next;
+		  b_current = vlib_get_buffer (vm, bi_current);
+		}
+
+	      /* Prepare a copy order executed later for the data */
+	      vhost_copy_t *cpy = &cpu->copy[copy_len];
+	      copy_len++;
+	      u32 desc_data_l =
+		desc_table[desc_current].len - desc_data_offset;
+	      cpy->len = VLIB_BUFFER_DATA_SIZE - b_current->current_length;
+	      cpy->len = (cpy->len > desc_data_l) ? desc_data_l : cpy->len;
+	      cpy->dst = (uword) (vlib_buffer_get_current (b_current) +
+				  b_current->current_length);
+	      cpy->src = desc_table[desc_current].addr + desc_data_offset;
+
+	      desc_data_offset += cpy->len;
+
+	      b_current->current_length += cpy->len;
+	      b_head->total_length_not_including_first_buffer += cpy->len;
+	    }
+
+	out:
+	  n_rx_bytes += b_head->total_length_not_including_first_buffer;
+	  n_rx_packets++;
+
+	  b_head->total_length_not_including_first_buffer -=
+	    b_head->current_length;
+
+	  if (PREDICT_FALSE (offload_hdr.flags || offload_hdr.gso_type))
+	    {
+	      vhost_rx_offload_t *o;
+	      vec_add2 (cpu->rx_offload, o, 1);
+	      o->buffer_index = to_next[-1];
+	      o->hdr = offload_hdr;
+	    }
+
+	  /* The buffer id of a chain is found in its last descriptor */
+	  if (n_descs > 1)
+	    buffer_id = txvq->packed_desc[desc_current].id;
+
+	  /* consume the descriptors and queue them as used */
+	  vhost_user_packed_put_used (txvq, &cpu->packed_used[n_used++],
+				      buffer_id, 0, n_descs);
+	  vhost_user_packed_advance (&txvq->last_avail_idx,
+				     &txvq->avail_wrap_counter, n_descs,
+				     txvq->qsz_mask);
+
+	  VLIB_BUFFER_TRACE_TRAJECTORY_INIT (b_head);
+
+	  vnet_buffer (b_head)->sw_if_index[VLIB_RX] = vui->sw_if_index;
+	  vnet_buffer (b_head)->sw_if_index[VLIB_TX] = (u32) ~ 0;
+	  b_head->error = 0;
+
+	  {
+	    u32 next0 = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
+
+	    /* redirect if feature path enabled */
+	    vnet_feature_start_device_input_x1 (vui->sw_if_index, &next0,
+						b_head);
+
+	    u32 bi = to_next[-1];	//Cannot use to_next[-1] in the macro
+	    vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
+					     to_next, n_left_to_next,
+					     bi, next0);
+	  }
+
+	  n_left--;
+
+	  if (PREDICT_FALSE (copy_len >= VHOST_USER_RX_COPY_THRESHOLD))
+	    {
+	      if (PREDICT_FALSE
+		  (vhost_user_input_copy (vui, cpu->copy, copy_len,
+					  &map_hint)))
+		{
+		  vlib_error_count (vm, node->node_index,
+				    VHOST_USER_INPUT_FUNC_ERROR_MMAP_FAIL, 1);
+		}
+	      copy_len = 0;
+	      vhost_user_input_apply_offload (vm, cpu);
+
+	      /* give buffers back to driver */
+	      vhost_user_packed_flush_used (txvq, cpu->packed_used, n_used);
+	      n_used = 0;
+	    }
+	}
+    stop:
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+
+  /* Do the memory copies */
+  if (PREDICT_FALSE
+      (vhost_user_input_copy (vui, cpu->copy, copy_len, &map_hint)))
+    {
+      vlib_error_count (vm, node->node_index,
+			VHOST_USER_INPUT_FUNC_ERROR_MMAP_FAIL, 1);
+    }
+  vhost_user_input_apply_offload (vm, cpu);
+
+  /* give buffers back to driver */
+  vhost_user_packed_flush_used (txvq, cpu->packed_used, n_used);
 
-/*
- * In case of overflow, we need to rewind the array of allocated buffers.
- */
-static void
-vhost_user_input_rewind_buffers (vlib_main_t * vm,
-				 vhost_cpu_t * cpu, vlib_buffer_t * b_head)
-{
-  u32 bi_current = cpu->rx_buffers[cpu->rx_buffers_len];
-  vlib_buffer_t *b_current = vlib_get_buffer (vm, bi_current);
-  b_current->current_length = 0;
-  b_current->flags = 0;
-  while (b_current != b_head)
+  /* interrupt (call) handling */
+  if ((txvq->callfd_idx != ~0) &&
+      vhost_user_vring_wants_interrupt (vui, txvq))
     {
-      cpu->rx_buffers_len++;
-      bi_current = cpu->rx_buffers[cpu->rx_buffers_len];
-      b_current = vlib_get_buffer (vm, bi_current);
-      b_current->current_length = 0;
-      b_current->flags = 0;
+      txvq->n_since_last_int += n_rx_packets;
+
+      if (txvq->n_since_last_int > vum->coalesce_frames)
+	vhost_user_send_call (vm, txvq);
     }
-  cpu->rx_buffers_len++;
+
+  /* increase rx counters */
+  vlib_increment_combined_counter
+    (vnet_main.interface_main.combined_sw_if_counters
+     + VNET_INTERFACE_COUNTER_RX,
+     thread_index, vui->sw_if_index, n_rx_packets, n_rx_bytes);
+
+  vnet_device_increment_rx_packets (thread_index, n_rx_packets);
+
+  return n_rx_packets;
 }
 
 static u32
@@ -1560,6 +2134,8 @@ vhost_user_if_input (vlib_main_t * vm,
   u32 map_hint = 0;
   u16 thread_index = vlib_get_thread_index ();
   u16 copy_len = 0;
+  int rx_offload =
+    (vui->features & (1ULL << FEAT_VIRTIO_NET_F_CSUM)) != 0;
 
   {
     /* do we have pending interrupts ? */
@@ -1587,12 +2163,15 @@ vhost_user_if_input (vlib_main_t * vm,
 	  !(node->flags &
 	    VLIB_NODE_FLAG_SWITCH_FROM_INTERRUPT_TO_POLLING_MODE))
 	/* Tell driver we want notification */
-	txvq->used->flags = 0;
+	vhost_user_vring_set_notify (vui, txvq, 1);
       else
 	/* Tell driver we don't want notification */
-	txvq->used->flags = VRING_USED_F_NO_NOTIFY;
+	vhost_user_vring_set_notify (vui, txvq, 0);
     }
 
+  if (vhost_user_is_packed_ring_supported (vui))
+    return vhost_user_if_input_packed (vm, vum, vui, qid, node);
+
   if (PREDICT_FALSE (txvq->avail->flags & 0xFFFE))
     return 0;
 
@@ -1626,8 +2205,8 @@ vhost_user_if_input (vlib_main_t * vm,
 			VHOST_USER_INPUT_FUNC_ERROR_FULL_RX_QUEUE, 1);
     }
 
-  if (n_left > VLIB_FRAME_SIZE)
-    n_left = VLIB_FRAME_SIZE;
+  if (n_left > vm->frame_size)
+    n_left = vm->frame_size;
 
   /*
    * For small packets (<2kB), we will not need more than one vlib buffer
@@ -1681,6 +2260,7 @@ vhost_user_if_input (vlib_main_t * vm,
 	  u16 desc_current;
 	  u32 desc_data_offset;
 	  vring_desc_t *desc_table = txvq->desc;
+	  virtio_net_offload_hdr_t offload_hdr = { 0 };
 
 	  if (PREDICT_FALSE (vum->cpus[thread_index].rx_buffers_len <= 1))
 	    {
@@ -1748,6 +2328,15 @@ vhost_user_if_input (vlib_main_t * vm,
 		}
 	    }
 
+	  if (PREDICT_FALSE (rx_offload))
+	    {
+	      virtio_net_offload_hdr_t *h =
+		map_guest_mem (vui, desc_table[desc_current].addr,
+			       &map_hint);
+	      if (h)
+		offload_hdr = *h;
+	    }
+
 	  if (PREDICT_TRUE (vui->is_any_layout) ||
 	      (!(desc_table[desc_current].flags & VIRTQ_DESC_F_NEXT)))
 	    {
@@ -1840,6 +2429,14 @@ vhost_user_if_input (vlib_main_t * vm,
 	  b_head->total_length_not_including_first_buffer -=
 	    b_head->current_length;
 
+	  if (PREDICT_FALSE (offload_hdr.flags || offload_hdr.gso_type))
+	    {
+	      vhost_rx_offload_t *o;
+	      vec_add2 (vum->cpus[thread_index].rx_offload, o, 1);
+	      o->buffer_index = to_next[-1];
+	      o->hdr = offload_hdr;
+	    }
+
 	  /* consume the descriptor and return it as used */
 	  txvq->last_avail_idx++;
 	  txvq->last_used_idx++;
@@ -1880,6 +2477,7 @@ vhost_user_if_input (vlib_main_t * vm,
 				    VHOST_USER_INPUT_FUNC_ERROR_MMAP_FAIL, 1);
 		}
 	      copy_len = 0;
+	      vhost_user_input_apply_offload (vm, &vum->cpus[thread_index]);
 
 	      /* give buffers back to driver */
 	      CLIB_MEMORY_BARRIER ();
@@ -1899,6 +2497,7 @@ vhost_user_if_input (vlib_main_t * vm,
       vlib_error_count (vm, node->node_index,
 			VHOST_USER_INPUT_FUNC_ERROR_MMAP_FAIL, 1);
     }
+  vhost_user_input_apply_offload (vm, &vum->cpus[thread_index]);
 
   /* give buffers back to driver */
   CLIB_MEMORY_BARRIER ();
@@ -1907,7 +2506,7 @@ vhost_user_if_input (vlib_main_t * vm,
 
   /* interrupt (call) handling */
   if ((txvq->callfd_idx != ~0) &&
-      !(txvq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT))
+      vhost_user_vring_wants_interrupt (vui, txvq))
     {
       txvq->n_since_last_int += n_rx_packets;
 
@@ -2008,6 +2607,35 @@ vhost_user_tx_trace (vhost_trace_t * t,
   t->first_desc_len = hdr_desc ? hdr_desc->len : 0;
 }
 
+void
+vhost_user_tx_trace_packed (vhost_trace_t * t,
+			    vhost_user_intf_t * vui, u16 qid,
+			    vlib_buffer_t * b, vhost_user_vring_t * rxvq)
+{
+  vhost_user_main_t *vum = &vhost_user_main;
+  vring_packed_desc_t *desc = &rxvq->packed_desc[rxvq->last_avail_idx];
+  vring_packed_desc_t *hdr_desc = desc;
+  u32 hint = 0;
+
+  memset (t, 0, sizeof (*t));
+  t->device_index = vui - vum->vhost_user_interfaces;
+  t->qid = qid;
+  t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_PACKED;
+
+  if (desc->flags & VIRTQ_DESC_F_INDIRECT)
+    {
+      t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_INDIRECT;
+      /* Header is the first here */
+      hdr_desc = map_guest_mem (vui, desc->addr, &hint);
+    }
+  else if (desc->flags & VIRTQ_DESC_F_NEXT)
+    t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_SIMPLE_CHAINED;
+  else
+    t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_SINGLE_DESC;
+
+  t->first_desc_len = hdr_desc ? hdr_desc->len : 0;
+}
+
 static_always_inline u32
 vhost_user_tx_copy (vhost_user_intf_t * vui, vhost_copy_t * cpy,
 		    u16 copy_len, u32 * map_hint)
@@ -2055,6 +2683,282 @@ vhost_user_tx_copy (vhost_user_intf_t * vui, vhost_copy_t * cpy,
   return 0;
 }
 
+/**
+ * @brief Get the descriptor table of the next available packed ring buffer.
+ * n_ind is set to the number of indirect descriptors, or 0 when the
+ * descriptors are taken from the ring itself.
+ */
+static_always_inline u8
+vhost_user_tx_packed_get_buffer (vhost_user_intf_t * vui,
+				 vhost_user_vring_t * rxvq,
+				 vring_packed_desc_t ** desc_table,
+				 u16 * desc_index, u16 * n_ind,
+				 u32 * map_hint)
+{
+  vring_packed_desc_t *desc = &rxvq->packed_desc[rxvq->last_avail_idx];
+
+  if (PREDICT_FALSE (!vhost_user_packed_desc_available (rxvq,
+							 rxvq->last_avail_idx)))
+    return VHOST_USER_TX_FUNC_ERROR_PKT_DROP_NOBUF;
+
+  if (PREDICT_FALSE (desc->flags & VIRTQ_DESC_F_INDIRECT))
+    {
+      *n_ind = desc->len / sizeof (vring_packed_desc_t);
+      if (PREDICT_FALSE (*n_ind == 0))
+	return VHOST_USER_TX_FUNC_ERROR_INDIRECT_OVERFLOW;
+      if (PREDICT_FALSE
+	  (!(*desc_table = map_guest_mem (vui, desc->addr, map_hint))))
+	return VHOST_USER_TX_FUNC_ERROR_MMAP_FAIL;
+      *desc_index = 0;
+    }
+  else
+    {
+      *n_ind = 0;
+      *desc_table = rxvq->packed_desc;
+      *desc_index = rxvq->last_avail_idx;
+    }
+  return VHOST_USER_TX_FUNC_ERROR_NONE;
+}
+
+/**
+ * @brief Consume the packed ring buffer starting at last_avail_idx and
+ * queue it as used with desc_len bytes written.
+ * Unused descriptors at the end of a chain are consumed too.
+ */
+static_always_inline void
+vhost_user_tx_packed_put_buffer (vhost_user_vring_t * rxvq,
+				 vhost_packed_used_t * used,
+				 vring_packed_desc_t * desc_table,
+				 u16 desc_index, u16 n_ind, u32 desc_len)
+{
+  u16 n_descs = 1;
+  u16 buffer_id;
+
+  if (n_ind)
+    buffer_id = rxvq->packed_desc[rxvq->last_avail_idx].id;
+  else
+    {
+      n_descs += (desc_index - rxvq->last_avail_idx) & rxvq->qsz_mask;
+      while ((desc_table[desc_index].flags & VIRTQ_DESC_F_NEXT) &&
+	     n_descs <= rxvq->qsz_mask)
+	{
+	  desc_index = (desc_index + 1) & rxvq->qsz_mask;
+	  n_descs++;
+	}
+      buffer_id = desc_table[desc_index].id;
+    }
+
+  vhost_user_packed_put_used (rxvq, used, buffer_id, desc_len, n_descs);
+  vhost_user_packed_advance (&rxvq->last_avail_idx,
+			     &rxvq->avail_wrap_counter, n_descs,
+			     rxvq->qsz_mask);
+}
+
+/**
+ * Packed ring version of the vhost_user_tx ring processing.
+ * Returns the number of packets which could not be sent.
+ */
+static_always_inline u32
+vhost_user_tx_packed (vlib_main_t * vm, vlib_node_runtime_t * node,
+		      vhost_user_intf_t * vui, u32 qid, u32 * buffers,
+		      u32 n_left, u8 * error_ret)
+{
+  vhost_user_main_t *vum = &vhost_user_main;
+  vhost_user_vring_t *rxvq = &vui->vrings[qid];
+  u32 thread_index = vlib_get_thread_index ();
+  vhost_cpu_t *cpu = &vum->cpus[thread_index];
+  u32 map_hint = 0;
+  u8 retry = 8;
+  u16 copy_len;
+  u32 n_used;
+  u8 error;
+  int tx_offload =
+    (vui->features & (1ULL << FEAT_VIRTIO_NET_F_GUEST_CSUM)) != 0;
+
+retry:
+  error = VHOST_USER_TX_FUNC_ERROR_NONE;
+  copy_len = 0;
+  n_used = 0;
+  while (n_left > 0)
+    {
+      vlib_buffer_t *b0, *current_b0;
+      u16 desc_index, n_ind;
+      u32 desc_len;
+      vring_packed_desc_t *desc_table;
+      virtio_net_hdr_mrg_rxbuf_t *hdr;
+      uword buffer_map_addr;
+      u32 buffer_len;
+      u16 bytes_left;
+      u16 start_avail_idx = rxvq->last_avail_idx;
+      u16 start_used_idx = rxvq->last_used_idx;
+      u8 start_avail_wrap = rxvq->avail_wrap_counter;
+      u8 start_used_wrap = rxvq->used_wrap_counter;
+      u32 start_n_used = n_used;
+
+      if (PREDICT_TRUE (n_left > 1))
+	vlib_prefetch_buffer_with_index (vm, buffers[1], LOAD);
+
+      b0 = vlib_get_buffer (vm, buffers[0]);
+
+      if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_IS_TRACED))
+	{
+	  cpu->current_trace =
+	    vlib_add_trace (vm, node, b0, sizeof (*cpu->current_trace));
+	  vhost_user_tx_trace_packed (cpu->current_trace, vui, qid / 2, b0,
+				      rxvq);
+	}
+
+      error = vhost_user_tx_packed_get_buffer (vui, rxvq, &desc_table,
+					       &desc_index, &n_ind,
+					       &map_hint);
+      if (PREDICT_FALSE (error != VHOST_USER_TX_FUNC_ERROR_NONE))
+	goto done;
+
+      desc_len = vui->virtio_net_hdr_sz;
+      buffer_map_addr = desc_table[desc_index].addr;
+      buffer_len = desc_table[desc_index].len;
+
+      /* The header is written in place, VIRTIO_F_VERSION_1 is implied */
+      if (PREDICT_FALSE
+	  (!(hdr = map_guest_mem (vui, buffer_map_addr, &map_hint))))
+	{
+	  error = VHOST_USER_TX_FUNC_ERROR_MMAP_FAIL;
+	  goto done;
+	}
+      memset (hdr, 0, vui->virtio_net_hdr_sz);
+      hdr->num_buffers = 1;
+      if (PREDICT_FALSE (tx_offload))
+	virtio_net_hdr_from_buffer (b0, (virtio_net_offload_hdr_t *)
+				    & hdr->hdr);
+
+      buffer_map_addr += vui->virtio_net_hdr_sz;
+      buffer_len -= vui->virtio_net_hdr_sz;
+      bytes_left = b0->current_length;
+      current_b0 = b0;
+      while (1)
+	{
+	  if (buffer_len == 0)
+	    {			//Get new output
+	      if (n_ind ? (desc_index + 1 < n_ind) :
+		  (desc_table[desc_index].flags & VIRTQ_DESC_F_NEXT))
+		{
+		  //Next one is chained
+		  desc_index = n_ind ? desc_index + 1 :
+		    (desc_index + 1) & rxvq->qsz_mask;
+		  buffer_map_addr = desc_table[desc_index].addr;
+		  buffer_len = desc_table[desc_index].len;
+		}
+	      else
+		{
+		  //Move from available to used buffer, then merge
+		  vhost_user_tx_packed_put_buffer (rxvq,
+						   &cpu->packed_used[n_used++],
+						   desc_table, desc_index,
+						   n_ind, desc_len);
+		  hdr->num_buffers++;
+		  desc_len = 0;
+
+		  error = vhost_user_tx_packed_get_buffer (vui, rxvq,
+							   &desc_table,
+							   &desc_index,
+							   &n_ind,
+							   &map_hint);
+		  if (PREDICT_FALSE (error != VHOST_USER_TX_FUNC_ERROR_NONE))
+		    {
+		      //Dequeue queued descriptors for this packet
+		      rxvq->last_avail_idx = start_avail_idx;
+		      rxvq->last_used_idx = start_used_idx;
+		      rxvq->avail_wrap_counter = start_avail_wrap;
+		      rxvq->used_wrap_counter = start_used_wrap;
+		      n_used = start_n_used;
+		      goto done;
+		    }
+		  buffer_map_addr = desc_table[desc_index].addr;
+		  buffer_len = desc_table[desc_index].len;
+		}
+	    }
+
+	  {
+	    vhost_copy_t *cpy = &cpu->copy[copy_len];
+	    copy_len++;
+	    cpy->len = bytes_left;
+	    cpy->len = (cpy->len > buffer_len) ? buffer_len : cpy->len;
+	    cpy->dst = buffer_map_addr;
+	    cpy->src = (uword) vlib_buffer_get_current (current_b0) +
+	      current_b0->current_length - bytes_left;
+
+	    bytes_left -= cpy->len;
+	    buffer_len -= cpy->len;
+	    buffer_map_addr += cpy->len;
+	    desc_len += cpy->len;
+	  }
+
+	  // Check if vlib buffer has more data. If not, get more or break.
+	  if (PREDICT_TRUE (!bytes_left))
+	    {
+	      if (PREDICT_FALSE
+		  (current_b0->flags & VLIB_BUFFER_NEXT_PRESENT))
+		{
+		  current_b0 = vlib_get_buffer (vm, current_b0->next_buffer);
+		  bytes_left = current_b0->current_length;
+		}
+	      else
+		{
+		  //End of packet
+		  break;
+		}
+	    }
+	}
+
+      //Move from available to used buffer
+      vhost_user_tx_packed_put_buffer (rxvq, &cpu->packed_used[n_used++],
+				       desc_table, desc_index, n_ind,
+				       desc_len);
+
+      if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_IS_TRACED))
+	clib_memcpy (&cpu->current_trace->hdr, hdr, vui->virtio_net_hdr_sz);
+
+      n_left--;			//At the end for error counting when 'goto done' is invoked
+
+      if (PREDICT_FALSE (copy_len >= VHOST_USER_TX_COPY_THRESHOLD ||
+			 n_used >= VHOST_USER_TX_COPY_THRESHOLD))
+	{
+	  if (PREDICT_FALSE
+	      (vhost_user_tx_copy (vui, cpu->copy, copy_len, &map_hint)))
+	    {
+	      vlib_error_count (vm, node->node_index,
+				VHOST_USER_TX_FUNC_ERROR_MMAP_FAIL, 1);
+	    }
+	  copy_len = 0;
+
+	  /* give buffers back to driver */
+	  vhost_user_packed_flush_used (rxvq, cpu->packed_used, n_used);
+	  n_used = 0;
+	}
+      buffers++;
+    }
+
+done:
+  //Do the memory copies
+  if (PREDICT_FALSE
+      (vhost_user_tx_copy (vui, cpu->copy, copy_len, &map_hint)))
+    {
+      vlib_error_count (vm, node->node_index,
+			VHOST_USER_TX_FUNC_ERROR_MMAP_FAIL, 1);
+    }
+
+  vhost_user_packed_flush_used (rxvq, cpu->packed_used, n_used);
+
+  /* Same retry policy as the split ring, see vhost_user_tx */
+  if (n_left && (error == VHOST_USER_TX_FUNC_ERROR_PKT_DROP_NOBUF) && retry)
+    {
+      retry--;
+      goto retry;
+    }
+
+  *error_ret = error;
+  return n_left;
+}
 
 static uword
 vhost_user_tx (vlib_main_t * vm,
@@ -2073,7 +2977,8 @@ vhost_user_tx (vlib_main_t * vm,
   u32 map_hint = 0;
   u8 retry = 8;
   u16 copy_len;
-  u16 tx_headers_len;
+  int tx_offload =
+    (vui->features & (1ULL << FEAT_VIRTIO_NET_F_GUEST_CSUM)) != 0;
 
   if (PREDICT_FALSE (!vui->admin_up))
     {
@@ -2094,16 +2999,23 @@ vhost_user_tx (vlib_main_t * vm,
   if (PREDICT_FALSE (vui->use_tx_spinlock))
     vhost_user_vring_lock (vui, qid);
 
+  if (vhost_user_is_packed_ring_supported (vui))
+    {
+      n_left = vhost_user_tx_packed (vm, node, vui, qid, buffers, n_left,
+				     &error);
+      goto done2;
+    }
+
 retry:
   error = VHOST_USER_TX_FUNC_ERROR_NONE;
-  tx_headers_len = 0;
   copy_len = 0;
   while (n_left > 0)
     {
       vlib_buffer_t *b0, *current_b0;
       u16 desc_head, desc_index, desc_len;
       vring_desc_t *desc_table;
-      uword buffer_map_addr;
+      virtio_net_hdr_mrg_rxbuf_t *hdr;
+      uword buffer_map_addr, hdr_map_addr;
       u32 buffer_len;
       u16 bytes_left;
 
@@ -2156,22 +3068,23 @@ retry:
       buffer_map_addr = desc_table[desc_index].addr;
       buffer_len = desc_table[desc_index].len;
 
-      {
-	// Get a header from the header array
-	virtio_net_hdr_mrg_rxbuf_t *hdr =
-	  &vum->cpus[thread_index].tx_headers[tx_headers_len];
-	tx_headers_len++;
-	hdr->hdr.flags = 0;
-	hdr->hdr.gso_type = 0;
-	hdr->num_buffers = 1;	//This is local, no need to check
-
-	// Prepare a copy order executed later for the header
-	vhost_copy_t *cpy = &vum->cpus[thread_index].copy[copy_len];
-	copy_len++;
-	cpy->len = vui->virtio_net_hdr_sz;
-	cpy->dst = buffer_map_addr;
-	cpy->src = (uword) hdr;
-      }
+      /*
+       * The header is written in place in the guest buffer rather than
+       * staged locally, the dirty pages are logged at the end of the packet.
+       */
+      hdr_map_addr = buffer_map_addr;
+      if (PREDICT_FALSE
+	  (!(hdr = map_guest_mem (vui, hdr_map_addr, &map_hint))))
+	{
+	  error = VHOST_USER_TX_FUNC_ERROR_MMAP_FAIL;
+	  goto done;
+	}
+      memset (hdr, 0, vui->virtio_net_hdr_sz);
+      if (vui->virtio_net_hdr_sz == 12)
+	hdr->num_buffers = 1;
+      if (PREDICT_FALSE (tx_offload))
+	virtio_net_hdr_from_buffer (b0, (virtio_net_offload_hdr_t *)
+				    & hdr->hdr);
 
       buffer_map_addr += vui->virtio_net_hdr_sz;
       buffer_len -= vui->virtio_net_hdr_sz;
@@ -2190,9 +3103,6 @@ retry:
 		}
 	      else if (vui->virtio_net_hdr_sz == 12)	//MRG is available
 		{
-		  virtio_net_hdr_mrg_rxbuf_t *hdr =
-		    &vum->cpus[thread_index].tx_headers[tx_headers_len - 1];
-
 		  //Move from available to used buffer
 		  rxvq->used->ring[rxvq->last_used_idx & rxvq->qsz_mask].id =
 		    desc_head;
@@ -2294,10 +3204,12 @@ retry:
       rxvq->last_avail_idx++;
       rxvq->last_used_idx++;
 
+      vhost_user_log_dirty_pages (vui, hdr_map_addr, vui->virtio_net_hdr_sz);
+
       if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_IS_TRACED))
 	{
-	  vum->cpus[thread_index].current_trace->hdr =
-	    vum->cpus[thread_index].tx_headers[tx_headers_len - 1];
+	  clib_memcpy (&vum->cpus[thread_index].current_trace->hdr, hdr,
+		       vui->virtio_net_hdr_sz);
 	}
 
       n_left--;			//At the end for error counting when 'goto done' is invoked
@@ -2357,9 +3269,10 @@ done:
       goto retry;
     }
 
+done2:
   /* interrupt (call) handling */
   if ((rxvq->callfd_idx != ~0) &&
-      !(rxvq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT))
+      vhost_user_vring_wants_interrupt (vui, rxvq))
     {
       rxvq->n_since_last_int += frame->n_vectors - n_left;
 
@@ -2529,10 +3442,10 @@ vhost_user_interface_rx_mode_change (vnet_main_t * vnm, u32 hw_if_index,
 
   txvq->mode = mode;
   if (mode == VNET_HW_INTERFACE_RX_MODE_POLLING)
-    txvq->used->flags = VRING_USED_F_NO_NOTIFY;
+    vhost_user_vring_set_notify (vui, txvq, 0);
   else if ((mode == VNET_HW_INTERFACE_RX_MODE_ADAPTIVE) ||
 	   (mode == VNET_HW_INTERFACE_RX_MODE_INTERRUPT))
-    txvq->used->flags = 0;
+    vhost_user_vring_set_notify (vui, txvq, 1);
   else
     {
       clib_warning ("BUG: unhandled mode %d changed for if %d queue %d", mode,
@@ -2881,7 +3794,8 @@ vhost_user_vui_init (vnet_main_t * vnm,
 		     vhost_user_intf_t * vui,
 		     int server_sock_fd,
 		     const char *sock_filename,
-		     u64 feature_mask, u32 * sw_if_index)
+		     u64 feature_mask, u32 * sw_if_index, u8 enable_packed,
+		     u8 enable_csum, u8 enable_gso)
 {
   vnet_sw_interface_t *sw;
   int q;
@@ -2909,6 +3823,9 @@ vhost_user_vui_init (vnet_main_t * vnm,
   vui->sock_errno = 0;
   vui->is_up = 0;
   vui->feature_mask = feature_mask;
+  vui->enable_packed = enable_packed;
+  vui->enable_csum = enable_csum;
+  vui->enable_gso = enable_gso;
   vui->clib_file_index = ~0;
   vui->log_base_addr = 0;
   vui->if_index = vui - vum->vhost_user_interfaces;
@@ -2942,7 +3859,8 @@ vhost_user_create_if (vnet_main_t * vnm, vlib_main_t * vm,
 		      u8 is_server,
 		      u32 * sw_if_index,
 		      u64 feature_mask,
-		      u8 renumber, u32 custom_dev_instance, u8 * hwaddr)
+		      u8 renumber, u32 custom_dev_instance, u8 * hwaddr,
+		      u8 enable_packed, u8 enable_csum, u8 enable_gso)
 {
   vhost_user_intf_t *vui = NULL;
   u32 sw_if_idx = ~0;
@@ -2980,7 +3898,8 @@ vhost_user_create_if (vnet_main_t * vnm, vlib_main_t * vm,
 
   vhost_user_create_ethernet (vnm, vm, vui, hwaddr);
   vhost_user_vui_init (vnm, vui, server_sock_fd, sock_filename,
-		       feature_mask, &sw_if_idx);
+		       feature_mask, &sw_if_idx, enable_packed, enable_csum,
+		       enable_gso);
 
   if (renumber)
     vnet_interface_name_renumber (sw_if_idx, custom_dev_instance);
@@ -2999,7 +3918,8 @@ vhost_user_modify_if (vnet_main_t * vnm, vlib_main_t * vm,
 		      const char *sock_filename,
 		      u8 is_server,
 		      u32 sw_if_index,
-		      u64 feature_mask, u8 renumber, u32 custom_dev_instance)
+		      u64 feature_mask, u8 renumber, u32 custom_dev_instance,
+		      u8 enable_packed, u8 enable_csum, u8 enable_gso)
 {
   vhost_user_main_t *vum = &vhost_user_main;
   vhost_user_intf_t *vui = NULL;
@@ -3034,7 +3954,8 @@ vhost_user_modify_if (vnet_main_t * vnm, vlib_main_t * vm,
 
   vhost_user_term_if (vui);
   vhost_user_vui_init (vnm, vui, server_sock_fd,
-		       sock_filename, feature_mask, &sw_if_idx);
+		       sock_filename, feature_mask, &sw_if_idx, enable_packed,
+		       enable_csum, enable_gso);
 
   if (renumber)
     vnet_interface_name_renumber (sw_if_idx, custom_dev_instance);
@@ -3059,6 +3980,9 @@ vhost_user_connect_command_fn (vlib_main_t * vm,
   u32 custom_dev_instance = ~0;
   u8 hwaddr[6];
   u8 *hw = NULL;
+  u8 enable_packed = 0;
+  u8 enable_csum = 0;
+  u8 enable_gso = 0;
   clib_error_t *error = NULL;
 
   /* Get a line of input. */
@@ -3081,6 +4005,12 @@ vhost_user_connect_command_fn (vlib_main_t * vm,
 	{
 	  renumber = 1;
 	}
+      else if (unformat (line_input, "packed"))
+	enable_packed = 1;
+      else if (unformat (line_input, "csum"))
+	enable_csum = 1;
+      else if (unformat (line_input, "gso"))
+	enable_gso = 1;
       else
 	{
 	  error = clib_error_return (0, "unknown input `%U'",
@@ -3094,7 +4024,8 @@ vhost_user_connect_command_fn (vlib_main_t * vm,
   int rv;
   if ((rv = vhost_user_create_if (vnm, vm, (char *) sock_filename,
 				  is_server, &sw_if_index, feature_mask,
-				  renumber, custom_dev_instance, hw)))
+				  renumber, custom_dev_instance, hw,
+				  enable_packed, enable_csum, enable_gso)))
     {
       error = clib_error_return (0, "vhost_user_create_if returned %d", rv);
       goto done;
@@ -3386,7 +4317,19 @@ show_vhost_user_command_fn (vlib_main_t * vm,
 			   vui->vrings[q].last_avail_idx,
 			   vui->vrings[q].last_used_idx);
 
-	  if (vui->vrings[q].avail && vui->vrings[q].used)
+	  if (vhost_user_is_packed_ring_supported (vui))
+	    {
+	      vlib_cli_output (vm, "  avail_wrap_counter %d "
+			       "used_wrap_counter %d\n",
+			       vui->vrings[q].avail_wrap_counter,
+			       vui->vrings[q].used_wrap_counter);
+	      if (vui->vrings[q].avail_event && vui->vrings[q].used_event)
+		vlib_cli_output (vm, "  driver_event.flags %x "
+				 "device_event.flags %x\n",
+				 vui->vrings[q].avail_event->flags,
+				 vui->vrings[q].used_event->flags);
+	    }
+	  else if (vui->vrings[q].avail && vui->vrings[q].used)
 	    vlib_cli_output (vm,
 			     "  avail.flags %x avail.idx %d used.flags %x used.idx %d\n",
 			     vui->vrings[q].avail->flags,
@@ -3399,7 +4342,26 @@ show_vhost_user_command_fn (vlib_main_t * vm,
 	  vlib_cli_output (vm, "  kickfd %d callfd %d errfd %d\n",
 			   kickfd, callfd, vui->vrings[q].errfd);
 
-	  if (show_descr)
+	  if (show_descr && vhost_user_is_packed_ring_supported (vui))
+	    {
+	      vlib_cli_output (vm, "\n  packed descriptor ring:\n");
+	      vlib_cli_output (vm,
+			       "   slot        addr         len  flags    id      user_addr\n");
+	      vlib_cli_output (vm,
+			       "  ===== ================== ===== ====== ===== ==================\n");
+	      for (j = 0; j < vui->vrings[q].qsz_mask + 1; j++)
+		{
+		  u32 mem_hint = 0;
+		  vring_packed_desc_t *d = &vui->vrings[q].packed_desc[j];
+		  vlib_cli_output (vm,
+				   "  %-5d 0x%016lx %-5d 0x%04x %-5d 0x%016lx\n",
+				   j, d->addr, d->len, d->flags, d->id,
+				   pointer_to_uword (map_guest_mem
+						     (vui, d->addr,
+						      &mem_hint)));
+		}
+	    }
+	  else if (show_descr)
 	    {
 	      vlib_cli_output (vm, "\n  descriptor table:\n");
 	      vlib_cli_output (vm,
@@ -3457,6 +4419,12 @@ done:
  * startup. <b>This is intended for degugging only.</b> It is recommended that this
  * parameter not be used except by experienced users. By default, all supported
  * features will be advertised. Otherwise, provide the set of features desired.
+ *   - 0x000000001 (0)  - VIRTIO_NET_F_CSUM
+ *   - 0x000000002 (1)  - VIRTIO_NET_F_GUEST_CSUM
+ *   - 0x000000080 (7)  - VIRTIO_NET_F_GUEST_TSO4
+ *   - 0x000000100 (8)  - VIRTIO_NET_F_GUEST_TSO6
+ *   - 0x000000800 (11) - VIRTIO_NET_F_HOST_TSO4
+ *   - 0x000001000 (12) - VIRTIO_NET_F_HOST_TSO6
  *   - 0x000008000 (15) - VIRTIO_NET_F_MRG_RXBUF
  *   - 0x000020000 (17) - VIRTIO_NET_F_CTRL_VQ
  *   - 0x000200000 (21) - VIRTIO_NET_F_GUEST_ANNOUNCE
@@ -3466,6 +4434,7 @@ done:
  *   - 0x010000000 (28) - VIRTIO_F_INDIRECT_DESC
  *   - 0x040000000 (30) - VHOST_USER_F_PROTOCOL_FEATURES
  *   - 0x100000000 (32) - VIRTIO_F_VERSION_1
+ *   - 0x400000000 (34) - VIRTIO_F_RING_PACKED
  *
  * - <b>hwaddr <mac-addr></b> - Optional ethernet address, can be in either
  * X:X:X:X:X:X unix or X.X.X cisco format.
@@ -3474,6 +4443,21 @@ done:
  * in the name to be specified. If instance already exists, name will be used
  * anyway and multiple instances will have the same name. Use with caution.
  *
+ * - <b>packed</b> - Optional flag to also offer VIRTIO_F_RING_PACKED. When the
+ * driver accepts it, the vrings use the virtio 1.1 packed layout where the
+ * descriptors are made available and returned in place. VHOST_F_LOG_ALL is
+ * not offered in that case, so live migration is not supported.
+ *
+ * - <b>csum</b> - Optional flag to also offer VIRTIO_NET_F_CSUM and
+ * VIRTIO_NET_F_GUEST_CSUM. Packets with a partial checksum are accepted from
+ * the driver and the checksum is only completed if the egress interface cannot
+ * do it; packets sent to a driver that accepted GUEST_CSUM keep their checksum
+ * partial.
+ *
+ * - <b>gso</b> - Optional flag to offer the TSO features on top of
+ * '<em>csum</em>'. Large TCP packets from the driver are segmented in
+ * interface-output only when the egress interface does not support GSO.
+ *
  * @cliexpar
  * Example of how to create a vhost interface with VPP as the client and all features enabled:
  * @cliexstart{create vhost-user socket /var/run/vpp/vhost1.sock}
@@ -3491,7 +4475,8 @@ done:
 VLIB_CLI_COMMAND (vhost_user_connect_command, static) = {
     .path = "create vhost-user",
     .short_help = "create vhost-user socket <socket-filename> [server] "
-    "[feature-mask <hex>] [hwaddr <mac-addr>] [renumber <dev_instance>] ",
+    "[feature-mask <hex>] [hwaddr <mac-addr>] [renumber <dev_instance>] "
+    "[packed] [csum] [gso] ",
     .function = vhost_user_connect_command_fn,
 };
 /* *INDENT-ON* */
@@ -14,6 +14,9 @@
  */
 #ifndef __VIRTIO_VHOST_USER_H__
 #define __VIRTIO_VHOST_USER_H__
+
+#include <vnet/devices/virtio/virtio_offload.h>
+
 /* vhost-user data structures */
 
 #define VHOST_MEMORY_MAX_NREGIONS       8
@@ -25,7 +28,10 @@
 
 #define VHOST_USER_VRING_NOFD_MASK      0x100
 #define VIRTQ_DESC_F_NEXT               1
+#define VIRTQ_DESC_F_WRITE              2
 #define VIRTQ_DESC_F_INDIRECT           4
+#define VIRTQ_DESC_F_AVAIL              (1 << 7)
+#define VIRTQ_DESC_F_USED               (1 << 15)
 #define VHOST_USER_REPLY_MASK       (0x1 << 2)
 
 #define VHOST_USER_PROTOCOL_F_MQ   0
@@ -45,7 +51,17 @@
 #define VRING_USED_F_NO_NOTIFY  1
 #define VRING_AVAIL_F_NO_INTERRUPT 1
 
+/* Packed ring event suppression flags */
+#define VRING_EVENT_F_ENABLE  0x0
+#define VRING_EVENT_F_DISABLE 0x1
+
 #define foreach_virtio_net_feature      \
+ _ (VIRTIO_NET_F_CSUM, 0)               \
+ _ (VIRTIO_NET_F_GUEST_CSUM, 1)         \
+ _ (VIRTIO_NET_F_GUEST_TSO4, 7)         \
+ _ (VIRTIO_NET_F_GUEST_TSO6, 8)         \
+ _ (VIRTIO_NET_F_HOST_TSO4, 11)         \
+ _ (VIRTIO_NET_F_HOST_TSO6, 12)         \
  _ (VIRTIO_NET_F_MRG_RXBUF, 15)         \
  _ (VIRTIO_NET_F_CTRL_VQ, 17)           \
  _ (VIRTIO_NET_F_GUEST_ANNOUNCE, 21)    \
@@ -54,7 +70,8 @@
  _ (VIRTIO_F_ANY_LAYOUT, 27)            \
  _ (VIRTIO_F_INDIRECT_DESC, 28)         \
  _ (VHOST_USER_F_PROTOCOL_FEATURES, 30) \
- _ (VIRTIO_F_VERSION_1, 32)
+ _ (VIRTIO_F_VERSION_1, 32)            \
+ _ (VIRTIO_F_RING_PACKED, 34)
 
 
 typedef enum
@@ -67,11 +84,13 @@ typedef enum
 int vhost_user_create_if (vnet_main_t * vnm, vlib_main_t * vm,
 			  const char *sock_filename, u8 is_server,
 			  u32 * sw_if_index, u64 feature_mask,
-			  u8 renumber, u32 custom_dev_instance, u8 * hwaddr);
+			  u8 renumber, u32 custom_dev_instance, u8 * hwaddr,
+			  u8 enable_packed, u8 enable_csum, u8 enable_gso);
 int vhost_user_modify_if (vnet_main_t * vnm, vlib_main_t * vm,
 			  const char *sock_filename, u8 is_server,
 			  u32 sw_if_index, u64 feature_mask,
-			  u8 renumber, u32 custom_dev_instance);
+			  u8 renumber, u32 custom_dev_instance,
+			  u8 enable_packed, u8 enable_csum, u8 enable_gso);
 int vhost_user_delete_if (vnet_main_t * vnm, vlib_main_t * vm,
 			  u32 sw_if_index);
 
@@ -148,6 +167,22 @@ typedef struct
   uint16_t ring[VHOST_VRING_MAX_SIZE];
 } __attribute ((packed)) vring_avail_t;
 
+// Packed ring descriptor. Used descriptors are written back in place.
+typedef struct
+{
+  uint64_t addr;
+  uint32_t len;
+  uint16_t id;
+  volatile uint16_t flags;
+} __attribute ((packed)) vring_packed_desc_t;
+
+// Packed ring driver and device event suppression areas
+typedef struct
+{
+  uint16_t off_wrap;
+  volatile uint16_t flags;
+} __attribute ((packed)) vring_desc_event_t;
+
 typedef struct
 {
   uint16_t flags;
@@ -196,13 +231,28 @@ typedef struct
   u16 last_avail_idx;
   u16 last_used_idx;
   u16 n_since_last_int;
-  vring_desc_t *desc;
-  vring_avail_t *avail;
-  vring_used_t *used;
+  union
+  {
+    vring_desc_t *desc;
+    vring_packed_desc_t *packed_desc;
+  };
+  union
+  {
+    vring_avail_t *avail;
+    vring_desc_event_t *avail_event;	/* packed: driver event suppression */
+  };
+  union
+  {
+    vring_used_t *used;
+    vring_desc_event_t *used_event;	/* packed: device event suppression */
+  };
   f64 int_deadline;
   u8 started;
   u8 enabled;
   u8 log_used;
+  /* Packed ring wrap counters, last_*_idx are then ring positions */
+  u8 avail_wrap_counter;
+  u8 used_wrap_counter;
   //Put non-runtime in a different cache line
     CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
   int errfd;
@@ -258,6 +308,13 @@ typedef struct
 
   /* Vector of active rx queues for this interface */
   u16 *rx_queues;
+
+  /* Whether VIRTIO_F_RING_PACKED is offered to the driver */
+  u8 enable_packed;
+
+  /* Whether checksum offload and TSO are offered to the driver */
+  u8 enable_csum;
+  u8 enable_gso;
 } vhost_user_intf_t;
 
 typedef struct
@@ -267,6 +324,15 @@ typedef struct
   u32 len;
 } vhost_copy_t;
 
+/* Packed ring used descriptor, written back once the copies are done */
+typedef struct
+{
+  u16 slot;
+  u16 id;
+  u32 len;
+  u16 flags;
+} vhost_packed_used_t;
+
 typedef struct
 {
   u16 qid; /** The interface queue index (Not the virtio vring idx) */
@@ -277,6 +343,13 @@ typedef struct
 } vhost_trace_t;
 
 
+/* Offload info of a received packet, applied once its data is copied */
+typedef struct
+{
+  u32 buffer_index;
+  virtio_net_offload_hdr_t hdr;
+} vhost_rx_offload_t;
+
 #define VHOST_USER_RX_BUFFERS_N (2 * VLIB_FRAME_SIZE + 2)
 #define VHOST_USER_COPY_ARRAY_N (4 * VLIB_FRAME_SIZE)
 
@@ -285,8 +358,9 @@ typedef struct
   u32 rx_buffers_len;
   u32 rx_buffers[VHOST_USER_RX_BUFFERS_N];
 
-  virtio_net_hdr_mrg_rxbuf_t tx_headers[VLIB_FRAME_SIZE];
   vhost_copy_t copy[VHOST_USER_COPY_ARRAY_N];
+  vhost_packed_used_t packed_used[VHOST_USER_COPY_ARRAY_N];
+  vhost_rx_offload_t *rx_offload;
 
   /* This is here so it doesn't end-up
    * using stack or registers. */
@@ -80,7 +80,9 @@ vl_api_create_vhost_user_if_t_handler (vl_api_create_vhost_user_if_t * mp)
   rv = vhost_user_create_if (vnm, vm, (char *) mp->sock_filename,
 			     mp->is_server, &sw_if_index, (u64) ~ 0,
 			     mp->renumber, ntohl (mp->custom_dev_instance),
-			     (mp->use_custom_mac) ? mp->mac_address : NULL);
+			     (mp->use_custom_mac) ? mp->mac_address : NULL,
+			     0 /* enable_packed */ , 0 /* enable_csum */ ,
+			     0 /* enable_gso */ );
 
   /* Remember an interface tag for the new interface */
   if (rv == 0)
@@ -115,7 +117,9 @@ vl_api_modify_vhost_user_if_t_handler (vl_api_modify_vhost_user_if_t * mp)
 
   rv = vhost_user_modify_if (vnm, vm, (char *) mp->sock_filename,
 			     mp->is_server, sw_if_index, (u64) ~ 0,
-			     mp->renumber, ntohl (mp->custom_dev_instance));
+			     mp->renumber, ntohl (mp->custom_dev_instance),
+			     0 /* enable_packed */ , 0 /* enable_csum */ ,
+			     0 /* enable_gso */ );
 
   REPLY_MACRO (VL_API_MODIFY_VHOST_USER_IF_REPLY);
 }
@@ -53,7 +53,8 @@ call_read_ready (clib_file_t * uf)
 
   CLIB_UNUSED (ssize_t size) = read (uf->file_descriptor, &b, sizeof (b));
   if ((qid & 1) == 0)
-    vnet_device_input_set_interrupt_pending (vnm, vif->hw_if_index, qid);
+    vnet_device_input_set_interrupt_pending (vnm, vif->hw_if_index,
+					     qid >> 1);
 
   return 0;
 }
@@ -68,6 +69,7 @@ virtio_vring_init (vlib_main_t * vm, virtio_if_t * vif, u16 idx, u16 sz)
   struct vhost_vring_addr addr = { 0 };
   struct vhost_vring_file file = { 0 };
   clib_file_t t = { 0 };
+  int vhost_fd = vec_elt (vif->vhost_fds, idx >> 1);
   int i;
 
   if (!is_pow2 (sz))
@@ -113,24 +115,26 @@ virtio_vring_init (vlib_main_t * vm, virtio_if_t * vif, u16 idx, u16 sz)
 			  vif->dev_instance, idx);
   vring->call_file_index = clib_file_add (&file_main, &t);
 
-  state.index = idx;
+  /* each queue pair has its own vhost-net device, so the vring index
+     passed to the kernel is always 0 (RX) or 1 (TX) */
+  state.index = idx & 1;
   state.num = sz;
-  _IOCTL (vif->fd, VHOST_SET_VRING_NUM, &state);
+  _IOCTL (vhost_fd, VHOST_SET_VRING_NUM, &state);
 
-  addr.index = idx;
+  addr.index = idx & 1;
   addr.flags = 0;
   addr.desc_user_addr = pointer_to_uword (vring->desc);
   addr.avail_user_addr = pointer_to_uword (vring->avail);
   addr.used_user_addr = pointer_to_uword (vring->used);
-  _IOCTL (vif->fd, VHOST_SET_VRING_ADDR, &addr);
+  _IOCTL (vhost_fd, VHOST_SET_VRING_ADDR, &addr);
 
-  file.index = idx;
+  file.index = idx & 1;
   file.fd = vring->kick_fd;
-  _IOCTL (vif->fd, VHOST_SET_VRING_KICK, &file);
+  _IOCTL (vhost_fd, VHOST_SET_VRING_KICK, &file);
   file.fd = vring->call_fd;
-  _IOCTL (vif->fd, VHOST_SET_VRING_CALL, &file);
-  file.fd = vif->tap_fd;
-  _IOCTL (vif->fd, VHOST_NET_SET_BACKEND, &file);
+  _IOCTL (vhost_fd, VHOST_SET_VRING_CALL, &file);
+  file.fd = vec_elt (vif->tap_fds, idx >> 1);
+  _IOCTL (vhost_fd, VHOST_NET_SET_BACKEND, &file);
 
 error:
   return err;
@@ -172,6 +176,7 @@ virtio_vring_free (vlib_main_t * vm, virtio_if_t * vif, u32 idx)
   if (vring->avail)
     clib_mem_free (vring->avail);
   vec_free (vring->buffers);
+  clib_spinlock_free (&vring->lockp);
   return 0;
 }
 
@@ -55,7 +55,9 @@
 
 #define foreach_virtio_if_flag		\
   _(0, ADMIN_UP, "admin-up")		\
-  _(1, DELETING, "deleting")
+  _(1, DELETING, "deleting")		\
+  _(2, CSUM_OFFLOAD, "csum-offload")	\
+  _(3, GSO, "gso")
 
 typedef enum
 {
@@ -73,6 +75,7 @@ typedef enum
 
 typedef struct
 {
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   struct vring_desc *desc;
   struct vring_used *used;
   struct vring_avail *avail;
@@ -86,20 +89,24 @@ typedef struct
   u32 call_file_index;
   u32 *buffers;
   u16 last_used_idx;
+  /* only initialized on TX vrings shared by more than one thread */
+  clib_spinlock_t lockp;
 } virtio_vring_t;
 
 typedef struct
 {
   u32 flags;
-  clib_spinlock_t lockp;
 
   u32 id;
   u32 dev_instance;
   u32 hw_if_index;
   u32 sw_if_index;
   u32 per_interface_next_index;
-  int fd;
-  int tap_fd;
+  /* one vhost-net and one tap fd per queue pair */
+  int *vhost_fds;
+  int *tap_fds;
+  u16 num_queues;
+  /* RX vring of queue q is vrings[2q], TX vring is vrings[2q + 1] */
   virtio_vring_t *vrings;
 
   u64 features, remote_features;
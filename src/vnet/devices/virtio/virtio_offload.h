@@ -0,0 +1,231 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _VNET_DEVICES_VIRTIO_VIRTIO_OFFLOAD_H_
+#define _VNET_DEVICES_VIRTIO_VIRTIO_OFFLOAD_H_
+
+#include <vlib/vlib.h>
+#include <vnet/buffer.h>
+#include <vnet/ethernet/packet.h>
+#include <vnet/ip/ip4_packet.h>
+#include <vnet/ip/ip6_packet.h>
+#include <vnet/tcp/tcp_packet.h>
+#include <vnet/udp/udp_packet.h>
+
+/*
+ * Translation between the virtio-net header, shared by vhost-user and
+ * tapv2, and the vlib buffer offload metadata (VNET_BUFFER_F_OFFLOAD_*,
+ * VNET_BUFFER_F_GSO and the l2/l3/l4 header offsets).
+ */
+
+#ifndef VIRTIO_NET_HDR_F_NEEDS_CSUM
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM	1
+#define VIRTIO_NET_HDR_F_DATA_VALID	2
+#define VIRTIO_NET_HDR_GSO_NONE		0
+#define VIRTIO_NET_HDR_GSO_TCPV4	1
+#define VIRTIO_NET_HDR_GSO_UDP		3
+#define VIRTIO_NET_HDR_GSO_TCPV6	4
+#define VIRTIO_NET_HDR_GSO_ECN		0x80
+#endif
+
+/* *INDENT-OFF* */
+typedef CLIB_PACKED (struct {
+  u8 flags;
+  u8 gso_type;
+  u16 hdr_len;
+  u16 gso_size;
+  u16 csum_start;
+  u16 csum_offset;
+}) virtio_net_offload_hdr_t;
+/* *INDENT-ON* */
+
+/**
+ * @brief Apply the offload info of a received virtio-net header.
+ *
+ * The buffer must be positioned at the ethernet header. Checksums the
+ * sender left partial are flagged for offload, so they get computed on
+ * output only if the egress device cannot; GSO packets are flagged for
+ * segmentation the same way.
+ */
+static_always_inline void
+virtio_net_hdr_to_buffer (vlib_buffer_t * b, virtio_net_offload_hdr_t * hdr)
+{
+  ethernet_header_t *eh;
+  u16 ethertype, l2_hdr_sz;
+  u8 l4_proto;
+
+  if (hdr->flags & VIRTIO_NET_HDR_F_DATA_VALID)
+    b->flags |= VNET_BUFFER_F_L4_CHECKSUM_COMPUTED |
+      VNET_BUFFER_F_L4_CHECKSUM_CORRECT;
+
+  if (!(hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM))
+    return;
+
+  eh = vlib_buffer_get_current (b);
+  ethertype = clib_net_to_host_u16 (eh->type);
+  l2_hdr_sz = sizeof (ethernet_header_t);
+  if (ethertype == ETHERNET_TYPE_VLAN)
+    {
+      ethernet_vlan_header_t *vlan = (ethernet_vlan_header_t *) (eh + 1);
+      ethertype = clib_net_to_host_u16 (vlan->type);
+      l2_hdr_sz += sizeof (ethernet_vlan_header_t);
+    }
+
+  vnet_buffer (b)->l2_hdr_offset = b->current_data;
+  vnet_buffer (b)->l3_hdr_offset = b->current_data + l2_hdr_sz;
+  /* csum_start is where the sender wants checksumming to begin, which
+     is the l4 header for both TCP and UDP */
+  vnet_buffer (b)->l4_hdr_offset = b->current_data + hdr->csum_start;
+
+  if (ethertype == ETHERNET_TYPE_IP4)
+    {
+      ip4_header_t *ip4 = vlib_buffer_get_current (b) + l2_hdr_sz;
+      l4_proto = ip4->protocol;
+      b->flags |= VNET_BUFFER_F_IS_IP4;
+    }
+  else if (ethertype == ETHERNET_TYPE_IP6)
+    {
+      ip6_header_t *ip6 = vlib_buffer_get_current (b) + l2_hdr_sz;
+      l4_proto = ip6->protocol;
+      b->flags |= VNET_BUFFER_F_IS_IP6;
+    }
+  else
+    return;
+
+  b->flags |= VNET_BUFFER_F_L2_HDR_OFFSET_VALID |
+    VNET_BUFFER_F_L3_HDR_OFFSET_VALID | VNET_BUFFER_F_L4_HDR_OFFSET_VALID;
+
+  if (l4_proto == IP_PROTOCOL_TCP &&
+      hdr->csum_offset == STRUCT_OFFSET_OF (tcp_header_t, checksum))
+    {
+      tcp_header_t *tcp = vlib_buffer_get_current (b) + hdr->csum_start;
+      tcp->checksum = 0;
+      b->flags |= VNET_BUFFER_F_OFFLOAD_TCP_CKSUM;
+
+      if (hdr->gso_type == VIRTIO_NET_HDR_GSO_TCPV4 ||
+	  hdr->gso_type == VIRTIO_NET_HDR_GSO_TCPV6)
+	{
+	  b->flags |= VNET_BUFFER_F_GSO;
+	  vnet_buffer2 (b)->gso_size = hdr->gso_size;
+	  vnet_buffer2 (b)->gso_l4_hdr_sz = tcp_header_bytes (tcp);
+	}
+    }
+  else if (l4_proto == IP_PROTOCOL_UDP &&
+	   hdr->csum_offset == STRUCT_OFFSET_OF (udp_header_t, checksum))
+    {
+      udp_header_t *udp = vlib_buffer_get_current (b) + hdr->csum_start;
+      udp->checksum = 0;
+      b->flags |= VNET_BUFFER_F_OFFLOAD_UDP_CKSUM;
+    }
+  else
+    return;
+
+  /* the checksum will be computed before the packet leaves, local
+     delivery does not need to validate it */
+  b->flags |= VNET_BUFFER_F_L4_CHECKSUM_COMPUTED |
+    VNET_BUFFER_F_L4_CHECKSUM_CORRECT;
+}
+
+/**
+ * @brief Fill a virtio-net header from the buffer offload flags.
+ *
+ * Only valid when the receiver negotiated VIRTIO_NET_F_GUEST_CSUM (and
+ * the TSO features for GSO packets). The IPv4 header checksum is always
+ * computed here; the L4 checksum is left partial, seeded with the pseudo
+ * header sum as the receiver expects.
+ */
+static_always_inline void
+virtio_net_hdr_from_buffer (vlib_buffer_t * b,
+			    virtio_net_offload_hdr_t * hdr)
+{
+  u32 oflags = b->flags;
+  u16 l4_hdr_sz = 0;
+  ip_csum_t sum;
+  u16 *csum;
+
+  if (!(oflags & (VNET_BUFFER_F_OFFLOAD_IP_CKSUM |
+		  VNET_BUFFER_F_OFFLOAD_TCP_CKSUM |
+		  VNET_BUFFER_F_OFFLOAD_UDP_CKSUM)))
+    return;
+
+  ASSERT (oflags & VNET_BUFFER_F_L3_HDR_OFFSET_VALID);
+
+  if (oflags & VNET_BUFFER_F_IS_IP4)
+    {
+      ip4_header_t *ip4 = (ip4_header_t *) (b->data +
+					    vnet_buffer (b)->l3_hdr_offset);
+      if (oflags & VNET_BUFFER_F_OFFLOAD_IP_CKSUM)
+	ip4->checksum = ip4_header_checksum (ip4);
+      sum = clib_mem_unaligned (&ip4->src_address, u64);
+      sum = ip_csum_with_carry
+	(sum, clib_host_to_net_u32 (clib_net_to_host_u16 (ip4->length) -
+				    ip4_header_bytes (ip4) +
+				    (ip4->protocol << 16)));
+    }
+  else
+    {
+      ip6_header_t *ip6 = (ip6_header_t *) (b->data +
+					    vnet_buffer (b)->l3_hdr_offset);
+      int i;
+      sum = ip6->payload_length + clib_host_to_net_u16 (ip6->protocol);
+      for (i = 0; i < ARRAY_LEN (ip6->src_address.as_uword); i++)
+	{
+	  sum = ip_csum_with_carry (sum, ip6->src_address.as_uword[i]);
+	  sum = ip_csum_with_carry (sum, ip6->dst_address.as_uword[i]);
+	}
+    }
+
+  if (oflags & VNET_BUFFER_F_OFFLOAD_TCP_CKSUM)
+    {
+      tcp_header_t *tcp = (tcp_header_t *) (b->data +
+					    vnet_buffer (b)->l4_hdr_offset);
+      hdr->csum_offset = STRUCT_OFFSET_OF (tcp_header_t, checksum);
+      csum = &tcp->checksum;
+      l4_hdr_sz = tcp_header_bytes (tcp);
+    }
+  else if (oflags & VNET_BUFFER_F_OFFLOAD_UDP_CKSUM)
+    {
+      udp_header_t *udp = (udp_header_t *) (b->data +
+					    vnet_buffer (b)->l4_hdr_offset);
+      hdr->csum_offset = STRUCT_OFFSET_OF (udp_header_t, checksum);
+      csum = &udp->checksum;
+    }
+  else
+    return;
+
+  hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+  hdr->csum_start = vnet_buffer (b)->l4_hdr_offset - b->current_data;
+  *csum = ip_csum_fold (sum);
+
+  if ((oflags & VNET_BUFFER_F_GSO) && l4_hdr_sz)
+    {
+      hdr->gso_type = (oflags & VNET_BUFFER_F_IS_IP4) ?
+	VIRTIO_NET_HDR_GSO_TCPV4 : VIRTIO_NET_HDR_GSO_TCPV6;
+      hdr->gso_size = vnet_buffer2 (b)->gso_size;
+      hdr->hdr_len = hdr->csum_start + l4_hdr_sz;
+    }
+}
+
+#endif /* _VNET_DEVICES_VIRTIO_VIRTIO_OFFLOAD_H_ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
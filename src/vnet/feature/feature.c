@@ -18,6 +18,9 @@
 
 vnet_feature_main_t feature_main;
 
+static void vnet_feature_compile (vnet_feature_main_t * fm, u8 arc,
+				  u32 sw_if_index);
+
 static clib_error_t *
 vnet_feature_init (vlib_main_t * vm)
 {
@@ -25,6 +28,7 @@ vnet_feature_init (vlib_main_t * vm)
   vnet_feature_registration_t *freg;
   vnet_feature_arc_registration_t *areg;
   u32 arc_index = 0;
+  u32 sw_if_index, n_sw_if;
 
   fm->arc_index_by_name = hash_create_string (0, sizeof (uword));
   areg = fm->next_arc;
@@ -118,11 +122,76 @@ vnet_feature_init (vlib_main_t * vm)
       arc_index++;
     }
 
+  /* interfaces created before the arcs were known */
+  n_sw_if = pool_len (vnet_get_main ()->interface_main.sw_interfaces);
+  for (arc_index = 0; arc_index < vec_len (fm->feature_config_mains);
+       arc_index++)
+    for (sw_if_index = 0; sw_if_index < n_sw_if; sw_if_index++)
+      vnet_feature_compile (fm, arc_index, sw_if_index);
+
   return 0;
 }
 
 VLIB_INIT_FUNCTION (vnet_feature_init);
 
+/** Rebuild the compiled arc start of one interface */
+static void
+vnet_feature_compile (vnet_feature_main_t * fm, u8 arc, u32 sw_if_index)
+{
+  vnet_feature_config_main_t *cm = &fm->feature_config_mains[arc];
+  vnet_feature_compiled_arc_t *ca = &fm->compiled_arcs[arc];
+  vnet_feature_compiled_start_t *s, none = {.next_index = ~0,
+    .config_index = ~0
+  };
+  u32 ci;
+
+  /* adding a config may have moved the heap */
+  ca->config_string_heap = cm->config_main.config_string_heap;
+
+  vec_validate_init_empty (ca->start_by_sw_if_index, sw_if_index, none);
+  s = &ca->start_by_sw_if_index[sw_if_index];
+
+  if (!clib_bitmap_get (fm->sw_if_index_has_features[arc], sw_if_index))
+    {
+      *s = none;
+      return;
+    }
+
+  ci = vec_elt (cm->config_index_by_sw_if_index, sw_if_index);
+  s->config_index = ci;
+  vnet_get_config_data (&cm->config_main, &ci, &s->next_index, 0);
+}
+
+static clib_error_t *
+vnet_feature_sw_interface_add_del (vnet_main_t * vnm, u32 sw_if_index,
+				   u32 is_add)
+{
+  vnet_feature_main_t *fm = &feature_main;
+  u32 arc;
+
+  /* compiled arc lookups are not bounds checked */
+  if (is_add)
+    for (arc = 0; arc < vec_len (fm->feature_config_mains); arc++)
+      vnet_feature_compile (fm, arc, sw_if_index);
+
+  return 0;
+}
+
+VNET_SW_INTERFACE_ADD_DEL_FUNCTION (vnet_feature_sw_interface_add_del);
+
+void
+vnet_feature_compiled_arcs_enable_disable (int enable)
+{
+  vnet_feature_main_t *fm = &feature_main;
+
+  /* The compiled arcs are always kept up to date and share config
+     indices with the config mains, so buffers already on an arc follow
+     the same chain after a switch. */
+  vlib_worker_thread_barrier_sync (vlib_get_main ());
+  fm->compiled_arcs_enabled = (enable != 0);
+  vlib_worker_thread_barrier_release (vlib_get_main ());
+}
+
 u8
 vnet_get_feature_arc_index (const char *s)
 {
@@ -226,6 +295,7 @@ vnet_feature_enable_disable_with_index (u8 arc_index, u32 feature_index,
   adj_feature_update (sw_if_index, arc_index, (feature_count > 0));
 
   fm->feature_count_by_sw_if_index[arc_index][sw_if_index] = feature_count;
+  vnet_feature_compile (fm, arc_index, sw_if_index);
   return 0;
 }
 
@@ -263,7 +333,8 @@ show_features_command_fn (vlib_main_t * vm,
   vnet_feature_arc_registration_t *areg;
   vnet_feature_registration_t *freg;
 
-  vlib_cli_output (vm, "Available feature paths");
+  vlib_cli_output (vm, "Available feature paths%s",
+		   fm->compiled_arcs_enabled ? " (compiled)" : "");
 
   areg = fm->next_arc;
   while (areg)
@@ -451,6 +522,204 @@ VLIB_CLI_COMMAND (set_interface_feature_command, static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+set_feature_compiled_arcs_command_fn (vlib_main_t * vm,
+				      unformat_input_t * input,
+				      vlib_cli_command_t * cmd)
+{
+  int enable = 1;
+
+  if (unformat (input, "disable"))
+    enable = 0;
+  else if (unformat (input, "enable"))
+    ;
+  else if (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    return clib_error_return (0, "unknown input `%U'",
+			      format_unformat_error, input);
+
+  vnet_feature_compiled_arcs_enable_disable (enable);
+  return 0;
+}
+
+/*?
+ * Resolve the first feature of an arc through a per-interface table
+ * which is rebuilt whenever a feature is enabled or disabled, and the
+ * following ones through a cached pointer to the arc's config string
+ * heap, instead of going through the feature and config mains for every
+ * packet. The compiled tables are always maintained, so the mode can be
+ * switched at any time. The same
+ * mode is set at startup with '<em>feature { compiled-arcs }</em>'.
+ *
+ * @cliexpar
+ * Example:
+ * @cliexcmd{set feature compiled-arcs enable}
+ * @cliexend
+ * @endparblock
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_feature_compiled_arcs_command, static) = {
+  .path = "set feature compiled-arcs",
+  .short_help = "set feature compiled-arcs [enable|disable]",
+  .function = set_feature_compiled_arcs_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+vnet_feature_config (vlib_main_t * vm, unformat_input_t * input)
+{
+  vnet_feature_main_t *fm = &feature_main;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "compiled-arcs"))
+	fm->compiled_arcs_enabled = 1;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  return 0;
+}
+
+VLIB_CONFIG_FUNCTION (vnet_feature_config, "feature");
+
+/** Walk the feature chain of an arc as the feature nodes would */
+static_always_inline u64
+feature_arc_walk (u8 arc, u32 sw_if_index, vlib_buffer_t * b,
+		  u32 * data_bytes, u32 n_iter, u32 * next_sum)
+{
+  u32 i, j, next = 0, sum = 0;
+  u64 t0;
+
+  t0 = clib_cpu_time_now ();
+  for (i = 0; i < n_iter; i++)
+    {
+      vnet_feature_arc_start (arc, sw_if_index, &next, b);
+      sum += next;
+      for (j = 0; j < vec_len (data_bytes); j++)
+	{
+	  vnet_feature_next_with_data (sw_if_index, &next, b, data_bytes[j]);
+	  sum += next;
+	}
+    }
+  *next_sum += sum;
+  return clib_cpu_time_now () - t0;
+}
+
+static clib_error_t *
+test_feature_arc_command_fn (vlib_main_t * vm,
+			     unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  vnet_feature_main_t *fm = &feature_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0, n_iter = 1000000, next_sum = 0;
+  u8 *arc_name = 0, arc, compiled_arcs_enabled;
+  u32 *data_bytes = 0, n_lookups, ci;
+  vnet_feature_config_main_t *cm;
+  vnet_config_feature_t *f;
+  vnet_config_t *cfg;
+  vlib_buffer_t b;
+  u64 clocks[2];
+  int mode;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "%U", unformat_vnet_sw_interface, vnm,
+		    &sw_if_index))
+	;
+      else if (unformat (input, "arc %s", &arc_name))
+	;
+      else if (unformat (input, "iterations %u", &n_iter))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (sw_if_index == ~0 || arc_name == 0)
+    return clib_error_return (0, "interface and arc required");
+
+  arc = vnet_get_feature_arc_index ((char *) arc_name);
+  if (arc == (u8) ~ 0)
+    {
+      vec_free (arc_name);
+      return clib_error_return (0, "unknown feature arc");
+    }
+
+  if (!clib_bitmap_get (fm->sw_if_index_has_features[arc], sw_if_index))
+    {
+      vec_free (arc_name);
+      return clib_error_return (0, "no features enabled on %U",
+				format_vnet_sw_if_index_name, vnm,
+				sw_if_index);
+    }
+
+  /* every feature except the end node calls vnet_feature_next */
+  cm = &fm->feature_config_mains[arc];
+  ci = cm->config_index_by_sw_if_index[sw_if_index];
+  cfg = pool_elt_at_index (cm->config_main.config_pool,
+			   cm->config_main.config_pool_index_by_user_index
+			   [ci]);
+  vec_foreach (f, cfg->features)
+  {
+    if (f->node_index != cm->config_main.end_node_index)
+      vec_add1 (data_bytes, vec_len (f->feature_config) * sizeof (u32));
+  }
+  n_lookups = vec_len (data_bytes) + 1;
+
+  memset (&b, 0, sizeof (b));
+
+  /* the workers must not see the mode change */
+  vlib_worker_thread_barrier_sync (vm);
+  compiled_arcs_enabled = fm->compiled_arcs_enabled;
+  for (mode = 0; mode < 2; mode++)
+    {
+      fm->compiled_arcs_enabled = mode;
+      /* warm up */
+      feature_arc_walk (arc, sw_if_index, &b, data_bytes, 1000, &next_sum);
+      clocks[mode] = feature_arc_walk (arc, sw_if_index, &b, data_bytes,
+				       n_iter, &next_sum);
+    }
+  fm->compiled_arcs_enabled = compiled_arcs_enabled;
+  vlib_worker_thread_barrier_release (vm);
+
+  vlib_cli_output (vm, "%U arc %s: %u next lookups per packet",
+		   format_vnet_sw_if_index_name, vnm, sw_if_index,
+		   arc_name, n_lookups);
+  for (mode = 0; mode < 2; mode++)
+    vlib_cli_output (vm, "  %-10s %8.2f clocks/packet %8.2f clocks/lookup",
+		     mode ? "compiled" : "config",
+		     (f64) clocks[mode] / n_iter,
+		     (f64) clocks[mode] / n_iter / n_lookups);
+  /* keep the walk from being optimized away */
+  if (next_sum == ~0)
+    vlib_cli_output (vm, "");
+
+  vec_free (data_bytes);
+  vec_free (arc_name);
+  return 0;
+}
+
+/*?
+ * Measure the cost of resolving the next nodes of the feature chain
+ * enabled on an interface, with and without compiled arcs. Only the
+ * lookups are timed; no packets are processed.
+ *
+ * @cliexpar
+ * Example:
+ * @cliexcmd{test feature-arc pg0 arc ip4-unicast iterations 1000000}
+ * @cliexend
+ * @endparblock
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_feature_arc_command, static) = {
+  .path = "test feature-arc",
+  .short_help = "test feature-arc <intfc> arc <arc-name> [iterations <n>]",
+  .function = test_feature_arc_command_fn,
+};
+/* *INDENT-ON* */
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -66,6 +66,30 @@ typedef struct vnet_feature_config_main_t_
   u32 *config_index_by_sw_if_index;
 } vnet_feature_config_main_t;
 
+/** Start of a compiled feature arc on one interface */
+typedef struct
+{
+  /** Next index of the first feature, ~0 if no features are enabled */
+  u32 next_index;
+  /** Config index of the interface's feature chain */
+  u32 config_index;
+} vnet_feature_compiled_start_t;
+
+/** Compiled feature arc, rebuilt whenever a feature is enabled or
+    disabled. The start of the arc on each interface is resolved from a
+    flat table, the following next indices are still read from the
+    arc's config string heap, through a cached heap pointer. */
+typedef struct
+{
+  /** The arc's config string heap, tracked across reallocation */
+  u32 *config_string_heap;
+  /** Arc start by sw_if_index */
+  vnet_feature_compiled_start_t *start_by_sw_if_index;
+} vnet_feature_compiled_arc_t;
+
+/** Feature arc indices are u8 */
+#define VNET_FEATURE_MAX_ARCS 256
+
 typedef struct
 {
   /** feature arc configuration list */
@@ -92,6 +116,12 @@ typedef struct
   /** Feature arc index for device-input */
   u8 device_input_feature_arc_index;
 
+  /** Resolve next nodes through the compiled arcs */
+  u8 compiled_arcs_enabled;
+
+  /** Compiled arcs by arc index */
+  vnet_feature_compiled_arc_t compiled_arcs[VNET_FEATURE_MAX_ARCS];
+
   /** convenience */
   vlib_main_t *vlib_main;
   vnet_main_t *vnet_main;
@@ -183,6 +213,14 @@ static_always_inline int
 vnet_have_features (u8 arc, u32 sw_if_index)
 {
   vnet_feature_main_t *fm = &feature_main;
+  vnet_feature_compiled_arc_t *ca;
+
+  if (fm->compiled_arcs_enabled)
+    {
+      ca = &fm->compiled_arcs[arc];
+      return (vec_elt (ca->start_by_sw_if_index, sw_if_index).next_index
+	      != ~0);
+    }
   return clib_bitmap_get (fm->sw_if_index_has_features[arc], sw_if_index);
 }
 
@@ -194,21 +232,64 @@ vnet_get_feature_config_index (u8 arc, u32 sw_if_index)
   return vec_elt (cm->config_index_by_sw_if_index, sw_if_index);
 }
 
+/** Same as vnet_get_config_data () on the arc's config main. With
+    compiled arcs the config string heap is read through the cached
+    pointer, without going through the feature and config mains. */
 static_always_inline void *
-vnet_feature_arc_start_with_data (u8 arc, u32 sw_if_index, u32 * next,
-				  vlib_buffer_t * b, u32 n_data_bytes)
+vnet_feature_get_config_data (u8 arc, u32 * config_index, u32 * next_index,
+			      u32 n_data_bytes)
 {
   vnet_feature_main_t *fm = &feature_main;
   vnet_feature_config_main_t *cm;
-  cm = &fm->feature_config_mains[arc];
+  u32 i, n, *d;
+
+  if (!fm->compiled_arcs_enabled)
+    {
+      cm = &fm->feature_config_mains[arc];
+      return vnet_get_config_data (&cm->config_main, config_index,
+				   next_index, n_data_bytes);
+    }
+
+  i = *config_index;
+  d = fm->compiled_arcs[arc].config_string_heap + i;
+  n = round_pow2 (n_data_bytes, sizeof (d[0])) / sizeof (d[0]);
+  *next_index = d[n];
+  *config_index = i + n + 1;
+  return (void *) d;
+}
+
+/** Resolve the first feature of an arc enabled on sw_if_index */
+static_always_inline void
+vnet_feature_arc_first (u8 arc, u32 sw_if_index, u32 * config_index,
+			u32 * next0)
+{
+  vnet_feature_main_t *fm = &feature_main;
+  vnet_feature_compiled_start_t *s;
+
+  if (fm->compiled_arcs_enabled)
+    {
+      s = vec_elt_at_index (fm->compiled_arcs[arc].start_by_sw_if_index,
+			    sw_if_index);
+      *next0 = s->next_index;
+      *config_index = s->config_index + 1;
+      return;
+    }
 
+  *config_index = vnet_get_feature_config_index (arc, sw_if_index);
+  vnet_feature_get_config_data (arc, config_index, next0, 0);
+}
+
+static_always_inline void *
+vnet_feature_arc_start_with_data (u8 arc, u32 sw_if_index, u32 * next,
+				  vlib_buffer_t * b, u32 n_data_bytes)
+{
   if (PREDICT_FALSE (vnet_have_features (arc, sw_if_index)))
     {
       vnet_buffer (b)->feature_arc_index = arc;
       b->current_config_index =
-	vec_elt (cm->config_index_by_sw_if_index, sw_if_index);
-      return vnet_get_config_data (&cm->config_main, &b->current_config_index,
-				   next, n_data_bytes);
+	vnet_get_feature_config_index (arc, sw_if_index);
+      return vnet_feature_get_config_data (arc, &b->current_config_index,
+					   next, n_data_bytes);
     }
   return 0;
 }
@@ -217,20 +298,22 @@ static_always_inline void
 vnet_feature_arc_start (u8 arc, u32 sw_if_index, u32 * next0,
 			vlib_buffer_t * b0)
 {
-  vnet_feature_arc_start_with_data (arc, sw_if_index, next0, b0, 0);
+  if (PREDICT_FALSE (vnet_have_features (arc, sw_if_index)))
+    {
+      vnet_buffer (b0)->feature_arc_index = arc;
+      vnet_feature_arc_first (arc, sw_if_index, &b0->current_config_index,
+			      next0);
+    }
 }
 
 static_always_inline void *
 vnet_feature_next_with_data (u32 sw_if_index, u32 * next0,
 			     vlib_buffer_t * b0, u32 n_data_bytes)
 {
-  vnet_feature_main_t *fm = &feature_main;
   u8 arc = vnet_buffer (b0)->feature_arc_index;
-  vnet_feature_config_main_t *cm = &fm->feature_config_mains[arc];
 
-  return vnet_get_config_data (&cm->config_main,
-			       &b0->current_config_index, next0,
-			       n_data_bytes);
+  return vnet_feature_get_config_data (arc, &b0->current_config_index, next0,
+				       n_data_bytes);
 }
 
 static_always_inline void
@@ -246,35 +329,35 @@ vnet_device_input_have_features (u32 sw_if_index)
   return vnet_have_features (fm->device_input_feature_arc_index, sw_if_index);
 }
 
+/*
+ * Save next0 so that the last feature in the chain
+ * can skip ethernet-input if indicated...
+ */
+static_always_inline void
+vnet_feature_device_input_save_next (u32 next0, vlib_buffer_t * b0)
+{
+  u16 adv;
+
+  vnet_buffer (b0)->device_input_feat.saved_next_index = next0;
+  adv = device_input_next_node_advance[next0];
+  vnet_buffer (b0)->device_input_feat.buffer_advance = adv;
+  vlib_buffer_advance (b0, -adv);
+}
+
 static_always_inline void
 vnet_feature_start_device_input_x1 (u32 sw_if_index, u32 * next0,
 				    vlib_buffer_t * b0)
 {
   vnet_feature_main_t *fm = &feature_main;
-  vnet_feature_config_main_t *cm;
   u8 feature_arc_index = fm->device_input_feature_arc_index;
-  cm = &fm->feature_config_mains[feature_arc_index];
 
-  if (PREDICT_FALSE
-      (clib_bitmap_get
-       (fm->sw_if_index_has_features[feature_arc_index], sw_if_index)))
+  if (PREDICT_FALSE (vnet_have_features (feature_arc_index, sw_if_index)))
     {
-      /*
-       * Save next0 so that the last feature in the chain
-       * can skip ethernet-input if indicated...
-       */
-      u16 adv;
-
-      vnet_buffer (b0)->device_input_feat.saved_next_index = *next0;
-      adv = device_input_next_node_advance[*next0];
-      vnet_buffer (b0)->device_input_feat.buffer_advance = adv;
-      vlib_buffer_advance (b0, -adv);
+      vnet_feature_device_input_save_next (*next0, b0);
 
       vnet_buffer (b0)->feature_arc_index = feature_arc_index;
-      b0->current_config_index =
-	vec_elt (cm->config_index_by_sw_if_index, sw_if_index);
-      vnet_get_config_data (&cm->config_main, &b0->current_config_index,
-			    next0, /* # bytes of config data */ 0);
+      vnet_feature_arc_first (feature_arc_index, sw_if_index,
+			      &b0->current_config_index, next0);
     }
 }
 
@@ -285,39 +368,21 @@ vnet_feature_start_device_input_x2 (u32 sw_if_index,
 				    vlib_buffer_t * b0, vlib_buffer_t * b1)
 {
   vnet_feature_main_t *fm = &feature_main;
-  vnet_feature_config_main_t *cm;
   u8 feature_arc_index = fm->device_input_feature_arc_index;
-  cm = &fm->feature_config_mains[feature_arc_index];
 
-  if (PREDICT_FALSE
-      (clib_bitmap_get
-       (fm->sw_if_index_has_features[feature_arc_index], sw_if_index)))
+  if (PREDICT_FALSE (vnet_have_features (feature_arc_index, sw_if_index)))
     {
-      /*
-       * Save next0 so that the last feature in the chain
-       * can skip ethernet-input if indicated...
-       */
-      u16 adv;
-
-      vnet_buffer (b0)->device_input_feat.saved_next_index = *next0;
-      adv = device_input_next_node_advance[*next0];
-      vnet_buffer (b0)->device_input_feat.buffer_advance = adv;
-      vlib_buffer_advance (b0, -adv);
-
-      vnet_buffer (b1)->device_input_feat.saved_next_index = *next1;
-      adv = device_input_next_node_advance[*next1];
-      vnet_buffer (b1)->device_input_feat.buffer_advance = adv;
-      vlib_buffer_advance (b1, -adv);
+      vnet_feature_device_input_save_next (*next0, b0);
+      vnet_feature_device_input_save_next (*next1, b1);
 
       vnet_buffer (b0)->feature_arc_index = feature_arc_index;
       vnet_buffer (b1)->feature_arc_index = feature_arc_index;
-      b0->current_config_index =
-	vec_elt (cm->config_index_by_sw_if_index, sw_if_index);
+
+      /* same interface, same feature chain */
+      vnet_feature_arc_first (feature_arc_index, sw_if_index,
+			      &b0->current_config_index, next0);
       b1->current_config_index = b0->current_config_index;
-      vnet_get_config_data (&cm->config_main, &b0->current_config_index,
-			    next0, /* # bytes of config data */ 0);
-      vnet_get_config_data (&cm->config_main, &b1->current_config_index,
-			    next1, /* # bytes of config data */ 0);
+      *next1 = *next0;
     }
 }
 
@@ -332,59 +397,27 @@ vnet_feature_start_device_input_x4 (u32 sw_if_index,
 				    vlib_buffer_t * b2, vlib_buffer_t * b3)
 {
   vnet_feature_main_t *fm = &feature_main;
-  vnet_feature_config_main_t *cm;
   u8 feature_arc_index = fm->device_input_feature_arc_index;
-  cm = &fm->feature_config_mains[feature_arc_index];
 
-  if (PREDICT_FALSE
-      (clib_bitmap_get
-       (fm->sw_if_index_has_features[feature_arc_index], sw_if_index)))
+  if (PREDICT_FALSE (vnet_have_features (feature_arc_index, sw_if_index)))
     {
-      /*
-       * Save next0 so that the last feature in the chain
-       * can skip ethernet-input if indicated...
-       */
-      u16 adv;
-
-      vnet_buffer (b0)->device_input_feat.saved_next_index = *next0;
-      adv = device_input_next_node_advance[*next0];
-      vnet_buffer (b0)->device_input_feat.buffer_advance = adv;
-      vlib_buffer_advance (b0, -adv);
-
-      vnet_buffer (b1)->device_input_feat.saved_next_index = *next1;
-      adv = device_input_next_node_advance[*next1];
-      vnet_buffer (b1)->device_input_feat.buffer_advance = adv;
-      vlib_buffer_advance (b1, -adv);
-
-      vnet_buffer (b2)->device_input_feat.saved_next_index = *next2;
-      adv = device_input_next_node_advance[*next2];
-      vnet_buffer (b2)->device_input_feat.buffer_advance = adv;
-      vlib_buffer_advance (b2, -adv);
-
-      vnet_buffer (b3)->device_input_feat.saved_next_index = *next3;
-      adv = device_input_next_node_advance[*next3];
-      vnet_buffer (b3)->device_input_feat.buffer_advance = adv;
-      vlib_buffer_advance (b3, -adv);
+      vnet_feature_device_input_save_next (*next0, b0);
+      vnet_feature_device_input_save_next (*next1, b1);
+      vnet_feature_device_input_save_next (*next2, b2);
+      vnet_feature_device_input_save_next (*next3, b3);
 
       vnet_buffer (b0)->feature_arc_index = feature_arc_index;
       vnet_buffer (b1)->feature_arc_index = feature_arc_index;
       vnet_buffer (b2)->feature_arc_index = feature_arc_index;
       vnet_buffer (b3)->feature_arc_index = feature_arc_index;
 
-      b0->current_config_index =
-	vec_elt (cm->config_index_by_sw_if_index, sw_if_index);
+      /* same interface, same feature chain */
+      vnet_feature_arc_first (feature_arc_index, sw_if_index,
+			      &b0->current_config_index, next0);
       b1->current_config_index = b0->current_config_index;
       b2->current_config_index = b0->current_config_index;
       b3->current_config_index = b0->current_config_index;
-
-      vnet_get_config_data (&cm->config_main, &b0->current_config_index,
-			    next0, /* # bytes of config data */ 0);
-      vnet_get_config_data (&cm->config_main, &b1->current_config_index,
-			    next1, /* # bytes of config data */ 0);
-      vnet_get_config_data (&cm->config_main, &b2->current_config_index,
-			    next2, /* # bytes of config data */ 0);
-      vnet_get_config_data (&cm->config_main, &b3->current_config_index,
-			    next3, /* # bytes of config data */ 0);
+      *next1 = *next2 = *next3 = *next0;
     }
 }
 
@@ -399,6 +432,8 @@ clib_error_t *vnet_feature_arc_init (vlib_main_t * vm,
 
 void vnet_interface_features_show (vlib_main_t * vm, u32 sw_if_index);
 
+void vnet_feature_compiled_arcs_enable_disable (int enable);
+
 #endif /* included_feature_h */
 
 /*
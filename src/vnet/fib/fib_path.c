@@ -1239,6 +1239,33 @@ fib_path_route_flags_to_cfg_flags (const fib_route_path_t *rpath)
     return (cfg_flags);
 }
 
+static fib_route_path_flags_t
+fib_path_cfg_flags_to_route_flags (fib_path_cfg_flags_t cfg_flags)
+{
+    fib_route_path_flags_t flags = FIB_ROUTE_PATH_FLAG_NONE;
+
+    if (cfg_flags & FIB_PATH_CFG_FLAG_RESOLVE_HOST)
+	flags |= FIB_ROUTE_PATH_RESOLVE_VIA_HOST;
+    if (cfg_flags & FIB_PATH_CFG_FLAG_RESOLVE_ATTACHED)
+	flags |= FIB_ROUTE_PATH_RESOLVE_VIA_ATTACHED;
+    if (cfg_flags & FIB_PATH_CFG_FLAG_LOCAL)
+	flags |= FIB_ROUTE_PATH_LOCAL;
+    if (cfg_flags & FIB_PATH_CFG_FLAG_ATTACHED)
+	flags |= FIB_ROUTE_PATH_ATTACHED;
+    if (cfg_flags & FIB_PATH_CFG_FLAG_INTF_RX)
+	flags |= FIB_ROUTE_PATH_INTF_RX;
+    if (cfg_flags & FIB_PATH_CFG_FLAG_RPF_ID)
+	flags |= FIB_ROUTE_PATH_RPF_ID;
+    if (cfg_flags & FIB_PATH_CFG_FLAG_EXCLUSIVE)
+	flags |= FIB_ROUTE_PATH_EXCLUSIVE;
+    if (cfg_flags & FIB_PATH_CFG_FLAG_DROP)
+	flags |= FIB_ROUTE_PATH_DROP;
+    if (cfg_flags & FIB_PATH_CFG_FLAG_DEAG_SRC)
+	flags |= FIB_ROUTE_PATH_SOURCE_LOOKUP;
+
+    return (flags);
+}
+
 /*
  * fib_path_create
  *
@@ -2593,6 +2620,8 @@ fib_path_encode (fib_node_index_t path_list_index,
     api_rpath->rpath.frp_preference = path->fp_preference;
     api_rpath->rpath.frp_proto = path->fp_nh_proto;
     api_rpath->rpath.frp_sw_if_index = ~0;
+    api_rpath->rpath.frp_flags =
+        fib_path_cfg_flags_to_route_flags(path->fp_cfg_flags);
     api_rpath->dpo = path->fp_dpo;
 
     switch (path->fp_type)
@@ -2618,6 +2647,7 @@ fib_path_encode (fib_node_index_t path_list_index,
         break;
       case FIB_PATH_TYPE_RECURSIVE:
         api_rpath->rpath.frp_addr = path->recursive.fp_nh.fp_ip;
+        api_rpath->rpath.frp_fib_index = path->recursive.fp_tbl_id;
         break;
       case FIB_PATH_TYPE_DVR:
           api_rpath->rpath.frp_sw_if_index = path->dvr.fp_interface;
@@ -861,6 +861,7 @@ vnet_register_interface (vnet_main_t * vnm,
 	static char *e[] = {
 	  "interface is down",
 	  "interface is deleted",
+	  "unable to segment gso packet",
 	};
 
 	r.n_errors = ARRAY_LEN (e);
@@ -1256,6 +1257,9 @@ vnet_interface_init (vlib_main_t * vm)
 
   im->sw_if_counter_lock[0] = 0;
 
+  vec_validate (im->split_buffers_by_thread,
+		vlib_get_thread_main ()->n_vlib_mains - 1);
+
   im->device_class_by_name = hash_create_string ( /* size */ 0,
 						 sizeof (uword));
   {
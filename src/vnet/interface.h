@@ -496,6 +496,13 @@ typedef struct vnet_hw_interface_t
   /* tx checksum offload */
 #define VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD (1 << 17)
 
+  /* tx segmentation offload, packets flagged VNET_BUFFER_F_GSO */
+#define VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO (1 << 18)
+
+  /* input node has more work than the rx queues, and disables itself
+     once it runs out of it, e.g. pg-input with streams pinned to a thread */
+#define VNET_HW_INTERFACE_FLAG_INPUT_NODE_SELF_DISABLES (1 << 19)
+
   /* Hardware address as vector.  Zero (e.g. zero-length vector) if no
      address for this class (e.g. PPP). */
   u8 *hw_address;
@@ -792,6 +799,9 @@ typedef struct
 
   /* feature_arc_index */
   u8 output_feature_arc_index;
+
+  /* per-thread vector of buffers produced by software segmentation */
+  u32 **split_buffers_by_thread;
 } vnet_interface_main_t;
 
 static inline void
@@ -42,6 +42,7 @@
 #include <vnet/ip/ip4.h>
 #include <vnet/ip/ip6.h>
 #include <vnet/udp/udp_packet.h>
+#include <vnet/tcp/tcp_packet.h>
 #include <vnet/feature/feature.h>
 
 typedef struct
@@ -123,6 +124,7 @@ vnet_interface_output_trace (vlib_main_t * vm,
 	  t0->sw_if_index = vnet_buffer (b0)->sw_if_index[VLIB_TX];
 	  clib_memcpy (t0->data, vlib_buffer_get_current (b0),
 		       sizeof (t0->data));
+	  vlib_trace_buffer_done (vm, b0);
 	}
       if (b1->flags & VLIB_BUFFER_IS_TRACED)
 	{
@@ -130,6 +132,7 @@ vnet_interface_output_trace (vlib_main_t * vm,
 	  t1->sw_if_index = vnet_buffer (b1)->sw_if_index[VLIB_TX];
 	  clib_memcpy (t1->data, vlib_buffer_get_current (b1),
 		       sizeof (t1->data));
+	  vlib_trace_buffer_done (vm, b1);
 	}
       from += 2;
       n_left -= 2;
@@ -151,6 +154,7 @@ vnet_interface_output_trace (vlib_main_t * vm,
 	  t0->sw_if_index = vnet_buffer (b0)->sw_if_index[VLIB_TX];
 	  clib_memcpy (t0->data, vlib_buffer_get_current (b0),
 		       sizeof (t0->data));
+	  vlib_trace_buffer_done (vm, b0);
 	}
       from += 1;
       n_left -= 1;
@@ -199,12 +203,141 @@ calc_checksums (vlib_main_t * vm, vlib_buffer_t * b)
   b->flags &= ~VNET_BUFFER_F_OFFLOAD_IP_CKSUM;
 }
 
+/**
+ * @brief Software segmentation of a VNET_BUFFER_F_GSO TCP packet.
+ *
+ * The packet headers, up to and including the TCP header, must be in the
+ * first buffer and each segment must fit in a single buffer. The segments
+ * are left in split_buffers, with the IP/TCP checksums flagged for offload
+ * so they are computed by calc_checksums or by the device.
+ *
+ * @return number of segments, 0 if the packet cannot be segmented
+ */
+static_always_inline u32
+vnet_gso_segment_buffer (vlib_main_t * vm, u32 ** split_buffers,
+			 vlib_buffer_t * sb0, u32 n_bytes_b0)
+{
+  u16 gso_size = vnet_buffer2 (sb0)->gso_size;
+  int is_ip4 = (sb0->flags & VNET_BUFFER_F_IS_IP4) != 0;
+  i16 l3_hdr_offset = vnet_buffer (sb0)->l3_hdr_offset;
+  i16 l4_hdr_offset = vnet_buffer (sb0)->l4_hdr_offset;
+  u32 hdr_sz, n_segs, n_alloc, i, src_left, payload_left;
+  vlib_buffer_t *src_b;
+  tcp_header_t *tcp0;
+  u8 *src;
+  u32 seq;
+  u16 ip_id = 0;
+
+  hdr_sz = l4_hdr_offset + vnet_buffer2 (sb0)->gso_l4_hdr_sz -
+    sb0->current_data;
+
+  if (PREDICT_FALSE (gso_size == 0 || hdr_sz > sb0->current_length ||
+		     sb0->current_data + hdr_sz + gso_size >
+		     VLIB_BUFFER_DATA_SIZE ||
+		     n_bytes_b0 <= hdr_sz ||
+		     !(sb0->flags & (VNET_BUFFER_F_IS_IP4 |
+				     VNET_BUFFER_F_IS_IP6))))
+    return 0;
+
+  payload_left = n_bytes_b0 - hdr_sz;
+  n_segs = (payload_left + gso_size - 1) / gso_size;
+
+  vec_validate (*split_buffers, n_segs - 1);
+  n_alloc = vlib_buffer_alloc (vm, *split_buffers, n_segs);
+  if (PREDICT_FALSE (n_alloc != n_segs))
+    {
+      vlib_buffer_free (vm, *split_buffers, n_alloc);
+      return 0;
+    }
+
+  tcp0 = (tcp_header_t *) (sb0->data + l4_hdr_offset);
+  seq = clib_net_to_host_u32 (tcp0->seq_number);
+  if (is_ip4)
+    ip_id = clib_net_to_host_u16
+      (((ip4_header_t *) (sb0->data + l3_hdr_offset))->fragment_id);
+
+  /* payload cursor */
+  src_b = sb0;
+  src = vlib_buffer_get_current (sb0) + hdr_sz;
+  src_left = sb0->current_length - hdr_sz;
+
+  for (i = 0; i < n_segs; i++)
+    {
+      vlib_buffer_t *b = vlib_get_buffer (vm, (*split_buffers)[i]);
+      u16 seg_payload = clib_min (gso_size, payload_left);
+      u8 *dst;
+      tcp_header_t *tcp;
+
+      clib_memcpy (b->opaque, sb0->opaque, sizeof (sb0->opaque));
+      clib_memcpy (b->opaque2, sb0->opaque2, sizeof (sb0->opaque2));
+      b->current_data = sb0->current_data;
+      b->current_length = hdr_sz + seg_payload;
+      b->current_config_index = sb0->current_config_index;
+      b->error = sb0->error;
+      /* keep the vlib flags of the new buffer, copy the vnet (user) ones */
+      b->flags |= (sb0->flags & ~(VNET_BUFFER_F_GSO |
+				  (VLIB_BUFFER_FLAG_USER (24) - 1))) |
+	VNET_BUFFER_F_OFFLOAD_TCP_CKSUM |
+	(is_ip4 ? VNET_BUFFER_F_OFFLOAD_IP_CKSUM : 0);
+
+      dst = vlib_buffer_get_current (b);
+      clib_memcpy (dst, vlib_buffer_get_current (sb0), hdr_sz);
+      dst += hdr_sz;
+      payload_left -= seg_payload;
+
+      while (seg_payload)
+	{
+	  u16 n;
+	  while (src_left == 0)
+	    {
+	      /* chain length was checked, next_buffer is valid */
+	      src_b = vlib_get_buffer (vm, src_b->next_buffer);
+	      src = vlib_buffer_get_current (src_b);
+	      src_left = src_b->current_length;
+	    }
+	  n = clib_min (seg_payload, src_left);
+	  clib_memcpy (dst, src, n);
+	  dst += n;
+	  src += n;
+	  src_left -= n;
+	  seg_payload -= n;
+	}
+
+      if (is_ip4)
+	{
+	  ip4_header_t *ip4 = (ip4_header_t *) (b->data + l3_hdr_offset);
+	  ip4->length = clib_host_to_net_u16
+	    (b->current_length - (l3_hdr_offset - b->current_data));
+	  ip4->fragment_id = clib_host_to_net_u16 (ip_id + i);
+	  ip4->checksum = 0;
+	}
+      else
+	{
+	  ip6_header_t *ip6 = (ip6_header_t *) (b->data + l3_hdr_offset);
+	  ip6->payload_length = clib_host_to_net_u16
+	    (b->current_length - (l3_hdr_offset - b->current_data) -
+	     sizeof (ip6_header_t));
+	}
+
+      tcp = (tcp_header_t *) (b->data + l4_hdr_offset);
+      tcp->seq_number = clib_host_to_net_u32 (seq + i * gso_size);
+      tcp->checksum = 0;
+      if (i > 0)
+	tcp->flags &= ~TCP_FLAG_CWR;
+      if (i < n_segs - 1)
+	tcp->flags &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+    }
+
+  return n_segs;
+}
+
 static_always_inline uword
 vnet_interface_output_node_inline (vlib_main_t * vm,
 				   vlib_node_runtime_t * node,
 				   vlib_frame_t * frame, vnet_main_t * vnm,
 				   vnet_hw_interface_t * hi,
-				   int do_tx_offloads)
+				   int do_tx_offloads,
+				   int do_segmentation)
 {
   vnet_interface_output_runtime_t *rt = (void *) node->runtime_data;
   vnet_sw_interface_t *si;
@@ -276,160 +409,236 @@ vnet_interface_output_node_inline (vlib_main_t * vm,
          than VNET_FRAME_SIZE vectors in it. */
       vlib_get_new_next_frame (vm, node, next_index, to_tx, n_left_to_tx);
 
-      while (from + 8 <= from_end && n_left_to_tx >= 4)
-	{
-	  u32 bi0, bi1, bi2, bi3;
-	  vlib_buffer_t *b0, *b1, *b2, *b3;
-	  u32 tx_swif0, tx_swif1, tx_swif2, tx_swif3;
-	  u32 or_flags;
-
-	  /* Prefetch next iteration. */
-	  vlib_prefetch_buffer_with_index (vm, from[4], LOAD);
-	  vlib_prefetch_buffer_with_index (vm, from[5], LOAD);
-	  vlib_prefetch_buffer_with_index (vm, from[6], LOAD);
-	  vlib_prefetch_buffer_with_index (vm, from[7], LOAD);
-
-	  bi0 = from[0];
-	  bi1 = from[1];
-	  bi2 = from[2];
-	  bi3 = from[3];
-	  to_tx[0] = bi0;
-	  to_tx[1] = bi1;
-	  to_tx[2] = bi2;
-	  to_tx[3] = bi3;
-	  from += 4;
-	  to_tx += 4;
-	  n_left_to_tx -= 4;
-
-	  b0 = vlib_get_buffer (vm, bi0);
-	  b1 = vlib_get_buffer (vm, bi1);
-	  b2 = vlib_get_buffer (vm, bi2);
-	  b3 = vlib_get_buffer (vm, bi3);
-
-	  /* Be grumpy about zero length buffers for benefit of
-	     driver tx function. */
-	  ASSERT (b0->current_length > 0);
-	  ASSERT (b1->current_length > 0);
-	  ASSERT (b2->current_length > 0);
-	  ASSERT (b3->current_length > 0);
-
-	  n_bytes_b0 = vlib_buffer_length_in_chain (vm, b0);
-	  n_bytes_b1 = vlib_buffer_length_in_chain (vm, b1);
-	  n_bytes_b2 = vlib_buffer_length_in_chain (vm, b2);
-	  n_bytes_b3 = vlib_buffer_length_in_chain (vm, b3);
-	  tx_swif0 = vnet_buffer (b0)->sw_if_index[VLIB_TX];
-	  tx_swif1 = vnet_buffer (b1)->sw_if_index[VLIB_TX];
-	  tx_swif2 = vnet_buffer (b2)->sw_if_index[VLIB_TX];
-	  tx_swif3 = vnet_buffer (b3)->sw_if_index[VLIB_TX];
-
-	  n_bytes += n_bytes_b0 + n_bytes_b1;
-	  n_bytes += n_bytes_b2 + n_bytes_b3;
-	  n_packets += 4;
-
-	  if (PREDICT_FALSE (current_config_index != ~0))
-	    {
-	      vnet_buffer (b0)->feature_arc_index = arc;
-	      vnet_buffer (b1)->feature_arc_index = arc;
-	      vnet_buffer (b2)->feature_arc_index = arc;
-	      vnet_buffer (b3)->feature_arc_index = arc;
-	      b0->current_config_index = current_config_index;
-	      b1->current_config_index = current_config_index;
-	      b2->current_config_index = current_config_index;
-	      b3->current_config_index = current_config_index;
-	    }
-
-	  /* update vlan subif tx counts, if required */
-	  if (PREDICT_FALSE (tx_swif0 != rt->sw_if_index))
-	    {
-	      vlib_increment_combined_counter (im->combined_sw_if_counters +
-					       VNET_INTERFACE_COUNTER_TX,
-					       thread_index, tx_swif0, 1,
-					       n_bytes_b0);
-	    }
-
-	  if (PREDICT_FALSE (tx_swif1 != rt->sw_if_index))
-	    {
-
-	      vlib_increment_combined_counter (im->combined_sw_if_counters +
-					       VNET_INTERFACE_COUNTER_TX,
-					       thread_index, tx_swif1, 1,
-					       n_bytes_b1);
-	    }
-
-	  if (PREDICT_FALSE (tx_swif2 != rt->sw_if_index))
-	    {
-
-	      vlib_increment_combined_counter (im->combined_sw_if_counters +
-					       VNET_INTERFACE_COUNTER_TX,
-					       thread_index, tx_swif2, 1,
-					       n_bytes_b2);
-	    }
-	  if (PREDICT_FALSE (tx_swif3 != rt->sw_if_index))
-	    {
-
-	      vlib_increment_combined_counter (im->combined_sw_if_counters +
-					       VNET_INTERFACE_COUNTER_TX,
-					       thread_index, tx_swif3, 1,
-					       n_bytes_b3);
-	    }
-
-	  or_flags = b0->flags | b1->flags | b2->flags | b3->flags;
-
-	  if (do_tx_offloads)
-	    {
-	      if (or_flags &
-		  (VNET_BUFFER_F_OFFLOAD_TCP_CKSUM |
-		   VNET_BUFFER_F_OFFLOAD_UDP_CKSUM |
-		   VNET_BUFFER_F_OFFLOAD_IP_CKSUM))
-		{
-		  calc_checksums (vm, b0);
-		  calc_checksums (vm, b1);
-		  calc_checksums (vm, b2);
-		  calc_checksums (vm, b3);
-		}
-	    }
-	}
-
-      while (from + 1 <= from_end && n_left_to_tx >= 1)
+      /* GSO packets take the single loop, one at a time */
+      while (from < from_end && n_left_to_tx > 0)
 	{
-	  u32 bi0;
-	  vlib_buffer_t *b0;
-	  u32 tx_swif0;
-
-	  bi0 = from[0];
-	  to_tx[0] = bi0;
-	  from += 1;
-	  to_tx += 1;
-	  n_left_to_tx -= 1;
-
-	  b0 = vlib_get_buffer (vm, bi0);
-
-	  /* Be grumpy about zero length buffers for benefit of
-	     driver tx function. */
-	  ASSERT (b0->current_length > 0);
+	while (from + 8 <= from_end && n_left_to_tx >= 4)
+	  {
+	    u32 bi0, bi1, bi2, bi3;
+	    vlib_buffer_t *b0, *b1, *b2, *b3;
+	    u32 tx_swif0, tx_swif1, tx_swif2, tx_swif3;
+	    u32 or_flags;
+
+	    /* Prefetch next iteration. */
+	    vlib_prefetch_buffer_with_index (vm, from[4], LOAD);
+	    vlib_prefetch_buffer_with_index (vm, from[5], LOAD);
+	    vlib_prefetch_buffer_with_index (vm, from[6], LOAD);
+	    vlib_prefetch_buffer_with_index (vm, from[7], LOAD);
+
+	    bi0 = from[0];
+	    bi1 = from[1];
+	    bi2 = from[2];
+	    bi3 = from[3];
+
+	    b0 = vlib_get_buffer (vm, bi0);
+	    b1 = vlib_get_buffer (vm, bi1);
+	    b2 = vlib_get_buffer (vm, bi2);
+	    b3 = vlib_get_buffer (vm, bi3);
+
+	    /* Packets to segment are handled by the single loop */
+	    if (do_segmentation &&
+		((b0->flags | b1->flags | b2->flags | b3->flags) &
+		 VNET_BUFFER_F_GSO))
+	      break;
+
+	    to_tx[0] = bi0;
+	    to_tx[1] = bi1;
+	    to_tx[2] = bi2;
+	    to_tx[3] = bi3;
+	    from += 4;
+	    to_tx += 4;
+	    n_left_to_tx -= 4;
+
+	    /* Be grumpy about zero length buffers for benefit of
+	       driver tx function. */
+	    ASSERT (b0->current_length > 0);
+	    ASSERT (b1->current_length > 0);
+	    ASSERT (b2->current_length > 0);
+	    ASSERT (b3->current_length > 0);
+
+	    n_bytes_b0 = vlib_buffer_length_in_chain (vm, b0);
+	    n_bytes_b1 = vlib_buffer_length_in_chain (vm, b1);
+	    n_bytes_b2 = vlib_buffer_length_in_chain (vm, b2);
+	    n_bytes_b3 = vlib_buffer_length_in_chain (vm, b3);
+	    tx_swif0 = vnet_buffer (b0)->sw_if_index[VLIB_TX];
+	    tx_swif1 = vnet_buffer (b1)->sw_if_index[VLIB_TX];
+	    tx_swif2 = vnet_buffer (b2)->sw_if_index[VLIB_TX];
+	    tx_swif3 = vnet_buffer (b3)->sw_if_index[VLIB_TX];
+
+	    n_bytes += n_bytes_b0 + n_bytes_b1;
+	    n_bytes += n_bytes_b2 + n_bytes_b3;
+	    n_packets += 4;
+
+	    if (PREDICT_FALSE (current_config_index != ~0))
+	      {
+		vnet_buffer (b0)->feature_arc_index = arc;
+		vnet_buffer (b1)->feature_arc_index = arc;
+		vnet_buffer (b2)->feature_arc_index = arc;
+		vnet_buffer (b3)->feature_arc_index = arc;
+		b0->current_config_index = current_config_index;
+		b1->current_config_index = current_config_index;
+		b2->current_config_index = current_config_index;
+		b3->current_config_index = current_config_index;
+	      }
+
+	    /* update vlan subif tx counts, if required */
+	    if (PREDICT_FALSE (tx_swif0 != rt->sw_if_index))
+	      {
+		vlib_increment_combined_counter (im->combined_sw_if_counters +
+						 VNET_INTERFACE_COUNTER_TX,
+						 thread_index, tx_swif0, 1,
+						 n_bytes_b0);
+	      }
+
+	    if (PREDICT_FALSE (tx_swif1 != rt->sw_if_index))
+	      {
+
+		vlib_increment_combined_counter (im->combined_sw_if_counters +
+						 VNET_INTERFACE_COUNTER_TX,
+						 thread_index, tx_swif1, 1,
+						 n_bytes_b1);
+	      }
+
+	    if (PREDICT_FALSE (tx_swif2 != rt->sw_if_index))
+	      {
+
+		vlib_increment_combined_counter (im->combined_sw_if_counters +
+						 VNET_INTERFACE_COUNTER_TX,
+						 thread_index, tx_swif2, 1,
+						 n_bytes_b2);
+	      }
+	    if (PREDICT_FALSE (tx_swif3 != rt->sw_if_index))
+	      {
+
+		vlib_increment_combined_counter (im->combined_sw_if_counters +
+						 VNET_INTERFACE_COUNTER_TX,
+						 thread_index, tx_swif3, 1,
+						 n_bytes_b3);
+	      }
+
+	    or_flags = b0->flags | b1->flags | b2->flags | b3->flags;
+
+	    if (do_tx_offloads)
+	      {
+		if (or_flags &
+		    (VNET_BUFFER_F_OFFLOAD_TCP_CKSUM |
+		     VNET_BUFFER_F_OFFLOAD_UDP_CKSUM |
+		     VNET_BUFFER_F_OFFLOAD_IP_CKSUM))
+		  {
+		    calc_checksums (vm, b0);
+		    calc_checksums (vm, b1);
+		    calc_checksums (vm, b2);
+		    calc_checksums (vm, b3);
+		  }
+	      }
+	  }
+
+	while (from + 1 <= from_end && n_left_to_tx >= 1)
+	  {
+	    u32 bi0;
+	    vlib_buffer_t *b0;
+	    u32 tx_swif0;
+
+	    bi0 = from[0];
+	    from += 1;
+
+	    b0 = vlib_get_buffer (vm, bi0);
+
+	    /* Be grumpy about zero length buffers for benefit of
+	       driver tx function. */
+	    ASSERT (b0->current_length > 0);
+
+	    n_bytes_b0 = vlib_buffer_length_in_chain (vm, b0);
+	    tx_swif0 = vnet_buffer (b0)->sw_if_index[VLIB_TX];
+
+	    if (PREDICT_FALSE (do_segmentation &&
+			       (b0->flags & VNET_BUFFER_F_GSO)))
+	      {
+		u32 **split_buffers =
+		  vec_elt_at_index (im->split_buffers_by_thread, thread_index);
+		u32 n_segs, n_done = 0, n_bytes_segs = 0;
+
+		n_segs = vnet_gso_segment_buffer (vm, split_buffers, b0,
+						  n_bytes_b0);
+		if (PREDICT_FALSE (n_segs == 0))
+		  {
+		    vlib_error_count
+		      (vm, node->node_index,
+		       VNET_INTERFACE_OUTPUT_ERROR_UNHANDLED_GSO_TYPE, 1);
+		    vlib_increment_simple_counter
+		      (im->sw_if_counters + VNET_INTERFACE_COUNTER_TX_ERROR,
+		       thread_index, rt->sw_if_index, 1);
+		    vlib_buffer_free_one (vm, bi0);
+		    break;
+		  }
+
+		while (n_done < n_segs)
+		  {
+		    u32 n_copy, j;
+		    if (n_left_to_tx == 0)
+		      {
+			vlib_put_next_frame (vm, node, next_index, n_left_to_tx);
+			vlib_get_new_next_frame (vm, node, next_index, to_tx,
+						 n_left_to_tx);
+		      }
+		    n_copy = clib_min (n_segs - n_done, n_left_to_tx);
+		    clib_memcpy (to_tx, *split_buffers + n_done,
+				 n_copy * sizeof (u32));
+		    for (j = 0; j < n_copy; j++)
+		      {
+			vlib_buffer_t *sb = vlib_get_buffer (vm, to_tx[j]);
+			if (PREDICT_FALSE (current_config_index != ~0))
+			  {
+			    vnet_buffer (sb)->feature_arc_index = arc;
+			    sb->current_config_index = current_config_index;
+			  }
+			if (do_tx_offloads)
+			  calc_checksums (vm, sb);
+			n_bytes_segs += sb->current_length;
+		      }
+		    to_tx += n_copy;
+		    n_left_to_tx -= n_copy;
+		    n_done += n_copy;
+		  }
+
+		/* count the segments sent, each one single buffer */
+		n_bytes += n_bytes_segs;
+		n_packets += n_segs;
+		if (PREDICT_FALSE (tx_swif0 != rt->sw_if_index))
+		  vlib_increment_combined_counter (im->combined_sw_if_counters +
+						   VNET_INTERFACE_COUNTER_TX,
+						   thread_index, tx_swif0,
+						   n_segs, n_bytes_segs);
+		vlib_buffer_free_one (vm, bi0);
+		/* back to the quad loop */
+		break;
+	      }
+
+	    to_tx[0] = bi0;
+	    to_tx += 1;
+	    n_left_to_tx -= 1;
+	    n_bytes += n_bytes_b0;
+	    n_packets += 1;
+
+	    if (PREDICT_FALSE (current_config_index != ~0))
+	      {
+		vnet_buffer (b0)->feature_arc_index = arc;
+		b0->current_config_index = current_config_index;
+	      }
+
+	    if (PREDICT_FALSE (tx_swif0 != rt->sw_if_index))
+	      {
+
+		vlib_increment_combined_counter (im->combined_sw_if_counters +
+						 VNET_INTERFACE_COUNTER_TX,
+						 thread_index, tx_swif0, 1,
+						 n_bytes_b0);
+	      }
+
+	    if (do_tx_offloads)
+	      calc_checksums (vm, b0);
+	  }
 
-	  n_bytes_b0 = vlib_buffer_length_in_chain (vm, b0);
-	  tx_swif0 = vnet_buffer (b0)->sw_if_index[VLIB_TX];
-	  n_bytes += n_bytes_b0;
-	  n_packets += 1;
-
-	  if (PREDICT_FALSE (current_config_index != ~0))
-	    {
-	      vnet_buffer (b0)->feature_arc_index = arc;
-	      b0->current_config_index = current_config_index;
-	    }
-
-	  if (PREDICT_FALSE (tx_swif0 != rt->sw_if_index))
-	    {
-
-	      vlib_increment_combined_counter (im->combined_sw_if_counters +
-					       VNET_INTERFACE_COUNTER_TX,
-					       thread_index, tx_swif0, 1,
-					       n_bytes_b0);
-	    }
-
-	  if (do_tx_offloads)
-	    calc_checksums (vm, b0);
 	}
 
       vlib_put_next_frame (vm, node, next_index, n_left_to_tx);
@@ -452,12 +661,19 @@ vnet_interface_output_node (vlib_main_t * vm, vlib_node_runtime_t * node,
   vnet_interface_output_runtime_t *rt = (void *) node->runtime_data;
   hi = vnet_get_sup_hw_interface (vnm, rt->sw_if_index);
 
-  if (hi->flags & VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD)
+  /* A device that takes GSO packets also computes their checksums */
+  if (hi->flags & VNET_HW_INTERFACE_FLAG_SUPPORTS_GSO)
+    return vnet_interface_output_node_inline (vm, node, frame, vnm, hi,
+					      /* do_tx_offloads */ 0,
+					      /* do_segmentation */ 0);
+  else if (hi->flags & VNET_HW_INTERFACE_FLAG_SUPPORTS_TX_L4_CKSUM_OFFLOAD)
     return vnet_interface_output_node_inline (vm, node, frame, vnm, hi,
-					      /* do_tx_offloads */ 0);
+					      /* do_tx_offloads */ 0,
+					      /* do_segmentation */ 1);
   else
     return vnet_interface_output_node_inline (vm, node, frame, vnm, hi,
-					      /* do_tx_offloads */ 1);
+					      /* do_tx_offloads */ 1,
+					      /* do_segmentation */ 1);
 }
 
 VLIB_NODE_FUNCTION_MULTIARCH_CLONE (vnet_interface_output_node);
@@ -616,11 +832,13 @@ trace_errors_with_buffers (vlib_main_t * vm,
 	{
 	  t0 = vlib_add_trace (vm, node, b0, sizeof (t0[0]));
 	  t0[0] = b0->error;
+	  vlib_trace_buffer_done (vm, b0);
 	}
       if (b1->flags & VLIB_BUFFER_IS_TRACED)
 	{
 	  t1 = vlib_add_trace (vm, node, b1, sizeof (t1[0]));
 	  t1[0] = b1->error;
+	  vlib_trace_buffer_done (vm, b1);
 	}
       buffers += 2;
       n_left -= 2;
@@ -640,6 +858,7 @@ trace_errors_with_buffers (vlib_main_t * vm,
 	{
 	  t0 = vlib_add_trace (vm, node, b0, sizeof (t0[0]));
 	  t0[0] = b0->error;
+	  vlib_trace_buffer_done (vm, b0);
 	}
       buffers += 1;
       n_left -= 1;
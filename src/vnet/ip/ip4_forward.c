@@ -1967,6 +1967,13 @@ always_inline void
 ip4_mtu_check (vlib_buffer_t * b, u16 packet_len,
 	       u16 adj_packet_bytes, bool df, u32 * next, u32 * error)
 {
+  /* GSO packets are checked against the size of the segments they
+     will be split into on output */
+  if (PREDICT_FALSE (b->flags & VNET_BUFFER_F_GSO))
+    packet_len = vnet_buffer (b)->l4_hdr_offset -
+      vnet_buffer (b)->l3_hdr_offset + vnet_buffer2 (b)->gso_l4_hdr_sz +
+      vnet_buffer2 (b)->gso_size;
+
   if (packet_len > adj_packet_bytes)
     {
       *error = IP4_ERROR_MTU_EXCEEDED;
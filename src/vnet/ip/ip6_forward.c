@@ -1565,6 +1565,12 @@ always_inline void
 ip6_mtu_check (vlib_buffer_t * b, u16 packet_bytes,
 	       u16 adj_packet_bytes, u32 * next, u32 * error)
 {
+  /* GSO packets are checked against the size of their segments */
+  if (PREDICT_FALSE (b->flags & VNET_BUFFER_F_GSO))
+    packet_bytes = vnet_buffer (b)->l4_hdr_offset -
+      vnet_buffer (b)->l3_hdr_offset + vnet_buffer2 (b)->gso_l4_hdr_sz +
+      vnet_buffer2 (b)->gso_size;
+
   if (adj_packet_bytes >= 1280 && packet_bytes > adj_packet_bytes)
     {
       *error = IP6_ERROR_MTU_EXCEEDED;
@@ -610,7 +610,8 @@ flow_report_init (vlib_main_t * vm)
   return 0;
 }
 
-VLIB_INIT_FUNCTION (flow_report_init)
+VLIB_INIT_FUNCTION (flow_report_init);
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -255,6 +255,15 @@ show_l2fib (vlib_main_t * vm,
 			 msm->event_scan_delay, msm->max_macs_in_event);
     }
 
+  vlib_cli_output (vm, "Age scan bucket: %d/%d (%d per slice)  "
+		   "Last sweep: %.2fsec %d aged (%.2f/sec)  Total aged: %lld",
+		   msm->age_scan_cursor, h->nbuckets,
+		   msm->age_scan_buckets_per_slice,
+		   msm->age_last_sweep_time, msm->age_last_sweep_n_aged,
+		   msm->age_last_sweep_time > 0 ?
+		   msm->age_last_sweep_n_aged / msm->age_last_sweep_time :
+		   0.0, msm->age_n_aged);
+
   if (raw)
     vlib_cli_output (vm, "Raw Hash Table:\n%U\n",
 		     BV (format_bihash), h, 1 /* verbose */ );
@@ -293,6 +302,39 @@ VLIB_CLI_COMMAND (show_l2fib_cli, static) = {
 /* *INDENT-ON* */
 
 
+static clib_error_t *
+l2fib_set_age_scan (vlib_main_t * vm,
+		    unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  l2fib_main_t *fm = &l2fib_main;
+  u32 n_buckets;
+
+  if (!unformat (input, "buckets-per-slice %d", &n_buckets) || n_buckets == 0)
+    return clib_error_return (0, "expected buckets-per-slice <n>, got `%U'",
+			      format_unformat_error, input);
+
+  fm->age_scan_buckets_per_slice = n_buckets;
+  return 0;
+}
+
+/*?
+ * The MAC ager scans a bounded number of hash buckets each time it
+ * runs, spreading a sweep of the whole L2 FIB table over the one minute
+ * aging interval. Use this command to change how many buckets are
+ * scanned per run. 'show l2fib' displays the sweep progress and how many
+ * entries were aged in the last sweep.
+ *
+ * @cliexpar
+ * @cliexcmd{set l2fib age-scan buckets-per-slice 1024}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (l2fib_set_age_scan_cli, static) = {
+  .path = "set l2fib age-scan",
+  .short_help = "set l2fib age-scan buckets-per-slice <n>",
+  .function = l2fib_set_age_scan,
+};
+/* *INDENT-ON* */
+
 /* Remove all entries from the l2fib */
 void
 l2fib_clear_table (void)
@@ -946,19 +988,29 @@ allocate_mac_evt_buf (u32 client, u32 client_index)
   return mp;
 }
 
+/**
+    Scan n_buckets mac table buckets starting at first_bucket, sending MAC
+    events and, unless event_only, aging out stale MACs. The learned MAC
+    count is recomputed when the whole table is scanned, otherwise it is
+    decremented for each MAC aged out. Returns the time spent scanning.
+*/
 static_always_inline f64
-l2fib_scan (vlib_main_t * vm, f64 start_time, u8 event_only)
+l2fib_scan (vlib_main_t * vm, f64 start_time, u8 event_only,
+	    u32 first_bucket, u32 n_buckets, u32 * n_aged)
 {
   l2fib_main_t *fm = &l2fib_main;
   l2learn_main_t *lm = &l2learn_main;
 
   BVT (clib_bihash) * h = &fm->mac_table;
+  u32 last_bucket = first_bucket + n_buckets;
+  u8 full_scan = (first_bucket == 0 && last_bucket >= h->nbuckets);
   int i, j, k;
   f64 last_start = start_time;
   f64 accum_t = 0;
   f64 delta_t = 0;
   u32 evt_idx = 0;
   u32 learn_count = 0;
+  u32 aged = 0;
   u32 client = lm->client_pid;
   u32 cl_idx = lm->client_index;
   vl_api_l2_macs_event_t *mp = 0;
@@ -970,7 +1022,9 @@ l2fib_scan (vlib_main_t * vm, f64 start_time, u8 event_only)
       reg = vl_api_client_index_to_registration (lm->client_index);
     }
 
-  for (i = 0; i < h->nbuckets; i++)
+  last_bucket = clib_min (last_bucket, h->nbuckets);
+
+  for (i = first_bucket; i < last_bucket; i++)
     {
       /* allow no more than 20us without a pause */
       delta_t = vlib_time_now (vm) - last_start;
@@ -981,7 +1035,7 @@ l2fib_scan (vlib_main_t * vm, f64 start_time, u8 event_only)
 	  accum_t += delta_t;
 	}
 
-      if (i < (h->nbuckets - 3))
+      if (i < (last_bucket - 3))
 	{
 	  BVT (clib_bihash_bucket) * b = &h->buckets[i + 3];
 	  CLIB_PREFETCH (b, CLIB_CACHE_LINE_BYTES, LOAD);
@@ -1090,13 +1144,20 @@ l2fib_scan (vlib_main_t * vm, f64 start_time, u8 event_only)
 	      kv.key = key.raw;
 	      BV (clib_bihash_add_del) (&fm->mac_table, &kv, 0);
 	      learn_count--;
+	      aged++;
+	      if (!full_scan && lm->global_learn_count)
+		lm->global_learn_count--;
 	    }
 	  v++;
 	}
     }
 
   /* keep learn count consistent */
-  l2learn_main.global_learn_count = learn_count;
+  if (full_scan)
+    l2learn_main.global_learn_count = learn_count;
+
+  if (n_aged)
+    *n_aged = aged;
 
   if (mp)
     {
@@ -1122,6 +1183,68 @@ l2fib_scan (vlib_main_t * vm, f64 start_time, u8 event_only)
   return delta_t + accum_t;
 }
 
+/** Account a completed ager sweep */
+static void
+l2fib_age_sweep_done (l2fib_main_t * fm, f64 now)
+{
+  fm->age_scan_duration = fm->age_sweep_duration;
+  fm->age_last_sweep_time = now - fm->age_sweep_start_time;
+  fm->age_last_sweep_n_aged = fm->age_sweep_n_aged;
+  fm->age_scan_cursor = 0;
+}
+
+/** Age one slice of the mac table, continuing the current sweep */
+static void
+l2fib_age_scan_slice (vlib_main_t * vm, f64 start_time)
+{
+  l2fib_main_t *fm = &l2fib_main;
+  u32 n_buckets = fm->mac_table.nbuckets;
+  u32 n_aged = 0;
+
+  if (fm->age_scan_cursor == 0)
+    {
+      fm->age_sweep_start_time = start_time;
+      fm->age_sweep_duration = 0;
+      fm->age_sweep_n_aged = 0;
+    }
+
+  fm->age_sweep_duration += l2fib_scan (vm, start_time, 0,
+					fm->age_scan_cursor,
+					fm->age_scan_buckets_per_slice,
+					&n_aged);
+  fm->age_scan_cursor += fm->age_scan_buckets_per_slice;
+  fm->age_sweep_n_aged += n_aged;
+  fm->age_n_aged += n_aged;
+
+  if (fm->age_scan_cursor >= n_buckets)
+    l2fib_age_sweep_done (fm, vlib_time_now (vm));
+}
+
+/** Age the whole mac table now, e.g. after a flush */
+static void
+l2fib_age_scan_full (vlib_main_t * vm, f64 start_time)
+{
+  l2fib_main_t *fm = &l2fib_main;
+  u32 n_aged = 0;
+
+  fm->age_sweep_start_time = start_time;
+  fm->age_sweep_duration = l2fib_scan (vm, start_time, 0, 0,
+				       fm->mac_table.nbuckets, &n_aged);
+  fm->age_sweep_n_aged = n_aged;
+  fm->age_n_aged += n_aged;
+  l2fib_age_sweep_done (fm, vlib_time_now (vm));
+}
+
+/** Delay between ager slices so that a sweep takes one scan interval */
+static f64
+l2fib_age_slice_interval (l2fib_main_t * fm)
+{
+  u32 n_slices = (fm->mac_table.nbuckets + fm->age_scan_buckets_per_slice - 1)
+    / fm->age_scan_buckets_per_slice;
+
+  return L2FIB_AGE_SCAN_INTERVAL / n_slices;
+}
+
 static uword
 l2fib_mac_age_scanner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 			       vlib_frame_t * f)
@@ -1135,7 +1258,11 @@ l2fib_mac_age_scanner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
   while (1)
     {
       if (lm->client_pid)
-	vlib_process_wait_for_event_or_clock (vm, fm->event_scan_delay);
+	{
+	  f64 t = next_age_scan_time - vlib_time_now (vm);
+	  vlib_process_wait_for_event_or_clock (vm, clib_min
+						(t, fm->event_scan_delay));
+	}
       else if (enabled)
 	{
 	  f64 t = next_age_scan_time - vlib_time_now (vm);
@@ -1149,13 +1276,20 @@ l2fib_mac_age_scanner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 
       start_time = vlib_time_now (vm);
       enum
-      { SCAN_MAC_AGE, SCAN_MAC_EVENT, SCAN_DISABLE } scan = SCAN_MAC_AGE;
+      {
+	SCAN_MAC_AGE_SLICE,
+	SCAN_MAC_AGE,
+	SCAN_MAC_EVENT,
+	SCAN_DISABLE
+      } scan = SCAN_MAC_AGE;
 
       switch (event_type)
 	{
 	case ~0:		/* timer expired */
 	  if (lm->client_pid != 0 && start_time < next_age_scan_time)
 	    scan = SCAN_MAC_EVENT;
+	  else
+	    scan = SCAN_MAC_AGE_SLICE;
 	  break;
 
 	case L2_MAC_AGE_PROCESS_EVENT_START:
@@ -1175,19 +1309,23 @@ l2fib_mac_age_scanner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 	}
 
       if (scan == SCAN_MAC_EVENT)
-	l2fib_main.evt_scan_duration = l2fib_scan (vm, start_time, 1);
+	l2fib_main.evt_scan_duration =
+	  l2fib_scan (vm, start_time, 1, 0, fm->mac_table.nbuckets, 0);
       else
 	{
+	  if (scan == SCAN_MAC_AGE_SLICE)
+	    l2fib_age_scan_slice (vm, start_time);
 	  if (scan == SCAN_MAC_AGE)
-	    l2fib_main.age_scan_duration = l2fib_scan (vm, start_time, 0);
+	    l2fib_age_scan_full (vm, start_time);
 	  if (scan == SCAN_DISABLE)
 	    {
 	      l2fib_main.age_scan_duration = 0;
 	      l2fib_main.evt_scan_duration = 0;
+	      l2fib_main.age_scan_cursor = 0;
 	    }
 	  /* schedule next scan */
 	  if (enabled)
-	    next_age_scan_time = start_time + L2FIB_AGE_SCAN_INTERVAL;
+	    next_age_scan_time = start_time + l2fib_age_slice_interval (fm);
 	  else
 	    next_age_scan_time = CLIB_TIME_MAX;
 	}
@@ -1217,6 +1355,8 @@ l2fib_init (vlib_main_t * vm)
   BV (clib_bihash_init) (&mp->mac_table, "l2fib mac table",
 			 L2FIB_NUM_BUCKETS, L2FIB_MEMORY_SIZE);
 
+  mp->age_scan_buckets_per_slice = L2FIB_AGE_SCAN_BUCKETS_PER_SLICE_DEFAULT;
+
   /* verify the key constructor is good, since it is endian-sensitive */
   memset (test_mac, 0, sizeof (test_mac));
   test_mac[0] = 0x11;
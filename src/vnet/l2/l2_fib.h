@@ -30,6 +30,9 @@
 /* Ager scan interval is 1 minute for aging */
 #define L2FIB_AGE_SCAN_INTERVAL		(60.0)
 
+/* Hash buckets aged per ager wakeup, a sweep is spread over the interval */
+#define L2FIB_AGE_SCAN_BUCKETS_PER_SLICE_DEFAULT	(256)
+
 /* MAC event scan delay is 100 msec unless specified by MAC event client */
 #define L2FIB_EVENT_SCAN_DELAY_DEFAULT	(0.1)
 
@@ -52,6 +55,20 @@ typedef struct
   f64 evt_scan_duration;
   f64 age_scan_duration;
 
+  /* incremental ager: next bucket to scan and buckets per wakeup */
+  u32 age_scan_cursor;
+  u32 age_scan_buckets_per_slice;
+
+  /* current ager sweep */
+  f64 age_sweep_start_time;
+  f64 age_sweep_duration;
+  u32 age_sweep_n_aged;
+
+  /* last completed ager sweep */
+  f64 age_last_sweep_time;
+  u32 age_last_sweep_n_aged;
+  u64 age_n_aged;
+
   /* delay between event scans, default to 100 msec */
   f64 event_scan_delay;
 
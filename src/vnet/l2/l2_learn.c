@@ -28,6 +28,7 @@
 
 #include <vppinfra/error.h>
 #include <vppinfra/hash.h>
+#include <vppinfra/xxhash.h>
 
 l2learn_main_t l2learn_main;
 
@@ -45,6 +46,13 @@ l2learn_main_t l2learn_main;
  * differ in certain cases (mac move tests), but this not expected to cause
  * problems in real-world networks. It is much simpler to separate learning
  * and forwarding into separate nodes.
+ *
+ * Only the main thread writes the mac table. On worker threads, learn, move
+ * and refresh events are queued into a per-thread ring and applied in
+ * batches by the l2-learn-process node on the main thread, which re-checks
+ * them against the current table and applies the global, per bridge domain
+ * and per interface learn limits. This keeps bihash writer contention out of
+ * the forwarding path during mac move storms or mass learning.
  */
 
 
@@ -81,7 +89,8 @@ _(MAC_MOVE,          "L2 mac moves")			\
 _(MAC_MOVE_VIOLATE,  "L2 mac move violations")		\
 _(LIMIT,             "L2 not learned due to limit")	\
 _(HIT_UPDATE,        "L2 learn hit updates")		\
-_(FILTER_DROP,       "L2 filter mac drops")
+_(FILTER_DROP,       "L2 filter mac drops")		\
+_(QUEUE_FULL,        "L2 not learned due to queue full")
 
 typedef enum
 {
@@ -104,12 +113,105 @@ typedef enum
   L2LEARN_N_NEXT,
 } l2learn_next_t;
 
+/** Slow path of the per bridge domain and per interface learn rate limit.
+    Only called on the main thread. */
+static int
+l2learn_rate_limit_check (l2learn_main_t * msm, u32 bd_index,
+			  u32 sw_if_index)
+{
+  f64 now = vlib_time_now (msm->vlib_main);
+
+  if (now - msm->rate_window_start >= 1.0)
+    {
+      /* start a new one second window */
+      memset (msm->learns_per_bd, 0, vec_bytes (msm->learns_per_bd));
+      memset (msm->learns_per_sw_if_index, 0,
+	      vec_bytes (msm->learns_per_sw_if_index));
+      msm->rate_window_start = now;
+    }
+
+  vec_validate (msm->learns_per_bd, bd_index);
+  vec_validate (msm->learns_per_sw_if_index, sw_if_index);
+
+  if (msm->bd_learn_rate_limit &&
+      msm->learns_per_bd[bd_index] >= msm->bd_learn_rate_limit)
+    {
+      msm->n_bd_rate_limited++;
+      return 1;
+    }
+  if (msm->intf_learn_rate_limit &&
+      msm->learns_per_sw_if_index[sw_if_index] >=
+      msm->intf_learn_rate_limit)
+    {
+      msm->n_intf_rate_limited++;
+      return 1;
+    }
+
+  msm->learns_per_bd[bd_index]++;
+  msm->learns_per_sw_if_index[sw_if_index]++;
+  return 0;
+}
+
+/** Check if a new learn or mac move is over the configured rate limits. */
+static_always_inline int
+l2learn_rate_limited (l2learn_main_t * msm, u32 bd_index, u32 sw_if_index)
+{
+  if (PREDICT_TRUE (msm->bd_learn_rate_limit == 0 &&
+		    msm->intf_learn_rate_limit == 0))
+    return 0;
+  return l2learn_rate_limit_check (msm, bd_index, sw_if_index);
+}
+
+/** Queue a learn event on a worker thread for the main thread learner. */
+static_always_inline void
+l2learn_enqueue (l2learn_per_thread_data_t * ptd, u64 * counter_base,
+		 l2fib_entry_key_t * key0, u32 sw_if_index0, u16 sn,
+		 u8 timestamp)
+{
+  u32 head = ptd->head;
+  u32 tail = ptd->tail;
+  u32 size = vec_len (ptd->events);
+  l2learn_recent_t *r;
+  l2learn_event_t *e;
+
+  /* Drop duplicates of an event that the learner has not applied yet */
+  r = &ptd->recent[clib_xxhash (key0->raw) & (L2LEARN_RECENT_SIZE - 1)];
+  if (r->key == key0->raw && r->sw_if_index == sw_if_index0 &&
+      (u32) (r->seq - head) < (u32) (tail - head))
+    return;
+
+  if (PREDICT_FALSE (tail - head >= size))
+    {
+      counter_base[L2LEARN_ERROR_QUEUE_FULL] += 1;
+      ptd->n_queue_full++;
+      return;
+    }
+
+  e = &ptd->events[tail & (size - 1)];
+  e->key.raw = key0->raw;
+  e->sw_if_index = sw_if_index0;
+  e->sn.as_u16 = sn;
+  e->timestamp = timestamp;
+  e->enqueue_time = clib_cpu_time_now ();
+
+  r->key = key0->raw;
+  r->sw_if_index = sw_if_index0;
+  r->seq = tail;
+
+  /* publish the event to the learner */
+  CLIB_MEMORY_STORE_BARRIER ();
+  ptd->tail = tail + 1;
+  ptd->n_enqueued++;
+}
 
-/** Perform learning on one packet based on the mac table lookup result. */
+/** Perform learning on one packet based on the mac table lookup result.
+    On worker threads (ptd != 0) the mac table update is queued to the
+    main thread instead of being done in place. */
 
 static_always_inline void
 l2learn_process (vlib_node_runtime_t * node,
 		 l2learn_main_t * msm,
+		 l2learn_per_thread_data_t * ptd,
 		 u64 * counter_base,
 		 vlib_buffer_t * b0,
 		 u32 sw_if_index0,
@@ -145,6 +247,9 @@ l2learn_process (vlib_node_runtime_t * node,
 
       counter_base[L2LEARN_ERROR_HIT_UPDATE] += 1;
       *count += 1;
+
+      if (ptd)
+	goto enqueue;
     }
   else if (result0->raw == ~0)
     {
@@ -167,6 +272,18 @@ l2learn_process (vlib_node_runtime_t * node,
       if (key.raw == 0)
 	return;
 
+      if (ptd)
+	goto enqueue;
+
+      /* A previous packet in this vector may have learned it already */
+      BVT (clib_bihash_kv) kv;
+      kv.key = key0->raw;
+      if (BV (clib_bihash_search) (msm->mac_table, &kv, &kv) == 0)
+	return;
+
+      if (l2learn_rate_limited (msm, key0->fields.bd_index, sw_if_index0))
+	return;
+
       /* It is ok to learn */
       msm->global_learn_count++;
       result0->raw = 0;		/* clear all fields */
@@ -196,10 +313,14 @@ l2learn_process (vlib_node_runtime_t * node,
 	  return;
 	}
 
-      /*
-       * TODO: may want to rate limit mac moves
-       * TODO: check global/bridge domain/interface learn limits
-       */
+      counter_base[L2LEARN_ERROR_MAC_MOVE] += 1;
+
+      if (ptd)
+	goto enqueue;
+
+      if (l2learn_rate_limited (msm, key0->fields.bd_index, sw_if_index0))
+	return;
+
       result0->fields.sw_if_index = sw_if_index0;
       if (result0->fields.age_not)	/* The mac was provisioned */
 	{
@@ -208,7 +329,6 @@ l2learn_process (vlib_node_runtime_t * node,
 	}
       result0->fields.lrn_evt = (msm->client_pid != 0);
       result0->fields.lrn_mov = (msm->client_pid != 0);
-      counter_base[L2LEARN_ERROR_MAC_MOVE] += 1;
     }
 
   /* Update the entry */
@@ -222,6 +342,11 @@ l2learn_process (vlib_node_runtime_t * node,
 
   /* Invalidate the cache */
   cached_key->raw = ~0;
+  return;
+
+enqueue:
+  l2learn_enqueue (ptd, counter_base, key0, sw_if_index0,
+		   vnet_buffer (b0)->l2.l2fib_sn, timestamp);
 }
 
 
@@ -239,6 +364,11 @@ l2learn_node_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   l2fib_entry_result_t cached_result;
   u8 timestamp = (u8) (vlib_time_now (vm) / 60);
   u32 count = 0;
+  l2learn_per_thread_data_t *ptd = 0;
+
+  /* Workers hand mac table updates over to the main thread */
+  if (vm->thread_index != 0)
+    ptd = vec_elt_at_index (msm->per_thread_data, vm->thread_index);
 
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;	/* number of packets to process */
@@ -372,19 +502,23 @@ l2learn_node_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 			  &bucket0, &bucket1, &bucket2, &bucket3,
 			  &result0, &result1, &result2, &result3);
 
-	  l2learn_process (node, msm, &em->counters[node_counter_base_index],
+	  l2learn_process (node, msm, ptd,
+			   &em->counters[node_counter_base_index],
 			   b0, sw_if_index0, &key0, &cached_key,
 			   &count, &result0, &next0, timestamp);
 
-	  l2learn_process (node, msm, &em->counters[node_counter_base_index],
+	  l2learn_process (node, msm, ptd,
+			   &em->counters[node_counter_base_index],
 			   b1, sw_if_index1, &key1, &cached_key,
 			   &count, &result1, &next1, timestamp);
 
-	  l2learn_process (node, msm, &em->counters[node_counter_base_index],
+	  l2learn_process (node, msm, ptd,
+			   &em->counters[node_counter_base_index],
 			   b2, sw_if_index2, &key2, &cached_key,
 			   &count, &result2, &next2, timestamp);
 
-	  l2learn_process (node, msm, &em->counters[node_counter_base_index],
+	  l2learn_process (node, msm, ptd,
+			   &em->counters[node_counter_base_index],
 			   b3, sw_if_index3, &key3, &cached_key,
 			   &count, &result3, &next3, timestamp);
 
@@ -439,7 +573,8 @@ l2learn_node_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 			  h0->src_address, vnet_buffer (b0)->l2.bd_index,
 			  &key0, &bucket0, &result0);
 
-	  l2learn_process (node, msm, &em->counters[node_counter_base_index],
+	  l2learn_process (node, msm, ptd,
+			   &em->counters[node_counter_base_index],
 			   b0, sw_if_index0, &key0, &cached_key,
 			   &count, &result0, &next0, timestamp);
 
@@ -509,12 +644,154 @@ VLIB_NODE_FUNCTION_MULTIARCH (l2learn_node, l2learn_node_fn)
    */
   mp->global_learn_limit = L2LEARN_DEFAULT_LIMIT;
 
+  mp->learn_queue_size = L2LEARN_DEFAULT_QUEUE_SIZE;
+  mp->learn_batch_size = L2LEARN_DEFAULT_BATCH_SIZE;
+
   return 0;
 }
 
 VLIB_INIT_FUNCTION (l2learn_init);
 
 
+/** Apply one learn event queued by a worker. The worker's view of the
+    mac table may be stale, so the decision is made again here. */
+static void
+l2learn_apply_event (l2learn_main_t * msm, l2learn_event_t * e)
+{
+  BVT (clib_bihash_kv) kv;
+  l2fib_entry_result_t result;
+  u32 sw_if_index = e->sw_if_index;
+  u32 bd_index = e->key.fields.bd_index;
+
+  kv.key = e->key.raw;
+  if (BV (clib_bihash_search) (msm->mac_table, &kv, &kv))
+    {
+      /* Entry not in L2FIB - add it */
+      if (msm->global_learn_count >= msm->global_learn_limit)
+	{
+	  msm->n_limit_drops++;
+	  return;
+	}
+      if (l2learn_rate_limited (msm, bd_index, sw_if_index))
+	return;
+
+      msm->global_learn_count++;
+      msm->n_learned++;
+      result.raw = 0;
+      result.fields.sw_if_index = sw_if_index;
+      result.fields.lrn_evt = (msm->client_pid != 0);
+    }
+  else
+    {
+      result.raw = kv.value;
+
+      if (result.fields.sw_if_index == sw_if_index)
+	{
+	  /* Refresh - static or provisioned MACs are never updated */
+	  if (result.fields.age_not)
+	    return;
+	}
+      else
+	{
+	  /* Mac move - filter and static MACs stay put */
+	  if (result.fields.filter || result.fields.static_mac)
+	    return;
+	  if (l2learn_rate_limited (msm, bd_index, sw_if_index))
+	    return;
+
+	  result.fields.sw_if_index = sw_if_index;
+	  if (result.fields.age_not)	/* The mac was provisioned */
+	    {
+	      msm->global_learn_count++;
+	      result.fields.age_not = 0;
+	    }
+	  result.fields.lrn_evt = (msm->client_pid != 0);
+	  result.fields.lrn_mov = (msm->client_pid != 0);
+	  msm->n_moved++;
+	}
+    }
+
+  result.fields.timestamp = e->timestamp;
+  result.fields.sn.as_u16 = e->sn.as_u16;
+
+  kv.key = e->key.raw;
+  kv.value = result.raw;
+  BV (clib_bihash_add_del) (msm->mac_table, &kv, 1 /* is_add */ );
+}
+
+/** Apply up to learn_batch_size events from one worker's ring. */
+static u32
+l2learn_drain_thread (l2learn_main_t * msm, l2learn_per_thread_data_t * ptd)
+{
+  u32 head = ptd->head;
+  u32 size = vec_len (ptd->events);
+  u32 n, i;
+  u64 now, latency;
+
+  n = clib_min (ptd->tail - head, msm->learn_batch_size);
+  if (n == 0)
+    return 0;
+
+  /* read the events only after reading the tail */
+  CLIB_MEMORY_BARRIER ();
+
+  now = clib_cpu_time_now ();
+  for (i = 0; i < n; i++)
+    {
+      l2learn_event_t *e = &ptd->events[(head + i) & (size - 1)];
+
+      latency = now - e->enqueue_time;
+      msm->latency_sum += latency;
+      msm->latency_max = clib_max (msm->latency_max, latency);
+
+      l2learn_apply_event (msm, e);
+    }
+
+  /* hand the slots back to the worker */
+  CLIB_MEMORY_BARRIER ();
+  ptd->head = head + n;
+  msm->n_events_applied += n;
+
+  return n;
+}
+
+static uword
+l2learn_event_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+		       vlib_frame_t * f)
+{
+  l2learn_main_t *msm = &l2learn_main;
+  l2learn_per_thread_data_t *ptd;
+
+  while (1)
+    {
+      /* Nothing to drain unless there are worker threads */
+      if (vec_len (msm->per_thread_data) > 1)
+	vlib_process_wait_for_event_or_clock (vm, L2LEARN_DRAIN_INTERVAL);
+      else
+	vlib_process_wait_for_event (vm);
+
+      vlib_process_get_events (vm, 0);
+
+      /* *INDENT-OFF* */
+      vec_foreach (ptd, msm->per_thread_data)
+	{
+	  if (ptd->events)
+	    l2learn_drain_thread (msm, ptd);
+	}
+      /* *INDENT-ON* */
+    }
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (l2learn_event_process_node, static) = {
+    .function = l2learn_event_process,
+    .type = VLIB_NODE_TYPE_PROCESS,
+    .name = "l2-learn-process",
+};
+/* *INDENT-ON* */
+
+
 /**
  * Set subinterface learn enable/disable.
  * The CLI format is:
@@ -573,22 +850,106 @@ static clib_error_t *
 l2learn_config (vlib_main_t * vm, unformat_input_t * input)
 {
   l2learn_main_t *mp = &l2learn_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u32 i;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
       if (unformat (input, "limit %d", &mp->global_learn_limit))
 	;
 
+      else if (unformat (input, "queue-size %d", &mp->learn_queue_size))
+	;
+
+      else if (unformat (input, "batch-size %d", &mp->learn_batch_size))
+	;
+
+      else if (unformat (input, "bd-rate-limit %d",
+			 &mp->bd_learn_rate_limit))
+	;
+
+      else if (unformat (input, "interface-rate-limit %d",
+			 &mp->intf_learn_rate_limit))
+	;
+
       else
 	return clib_error_return (0, "unknown input `%U'",
 				  format_unformat_error, input);
     }
 
+  if (mp->learn_queue_size == 0 || mp->learn_batch_size == 0)
+    return clib_error_return (0, "queue-size and batch-size must be > 0");
+
+  /* Per-worker learn event rings, thread 0 updates the mac table itself */
+  mp->learn_queue_size = max_pow2 (mp->learn_queue_size);
+  vec_validate_aligned (mp->per_thread_data, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+  for (i = 1; i < tm->n_vlib_mains; i++)
+    {
+      l2learn_per_thread_data_t *ptd = &mp->per_thread_data[i];
+      vec_validate (ptd->events, mp->learn_queue_size - 1);
+      vec_validate (ptd->recent, L2LEARN_RECENT_SIZE - 1);
+    }
+
   return 0;
 }
 
 VLIB_CONFIG_FUNCTION (l2learn_config, "l2learn");
 
+static clib_error_t *
+show_l2learn (vlib_main_t * vm,
+	      unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  l2learn_main_t *mp = &l2learn_main;
+  l2learn_per_thread_data_t *ptd;
+  f64 clocks_per_usec = vm->clib_time.clocks_per_second * 1e-6;
+  u32 i;
+
+  vlib_cli_output (vm, "learned entries: %d limit: %d",
+		   mp->global_learn_count, mp->global_learn_limit);
+  vlib_cli_output (vm, "queue size: %d batch size: %d "
+		   "bd rate limit: %d/s interface rate limit: %d/s",
+		   mp->learn_queue_size, mp->learn_batch_size,
+		   mp->bd_learn_rate_limit, mp->intf_learn_rate_limit);
+  vlib_cli_output (vm, "events applied: %lld learned: %lld moved: %lld",
+		   mp->n_events_applied, mp->n_learned, mp->n_moved);
+  vlib_cli_output (vm, "dropped: limit %lld bd rate %lld interface rate %lld",
+		   mp->n_limit_drops, mp->n_bd_rate_limited,
+		   mp->n_intf_rate_limited);
+  if (mp->n_events_applied)
+    vlib_cli_output (vm, "learn latency: avg %.2fus max %.2fus",
+		     (f64) mp->latency_sum / mp->n_events_applied /
+		     clocks_per_usec, (f64) mp->latency_max / clocks_per_usec);
+
+  for (i = 1; i < vec_len (mp->per_thread_data); i++)
+    {
+      ptd = &mp->per_thread_data[i];
+      vlib_cli_output (vm, "  thread %d (%s): queued %d pending %d "
+		       "queue full %d", i, vlib_worker_threads[i].name,
+		       ptd->n_enqueued, ptd->tail - ptd->head,
+		       ptd->n_queue_full);
+    }
+
+  return 0;
+}
+
+/*?
+ * Show the state of the layer 2 learner: learn limits, the per worker
+ * learn event queues, and how many learn and move events were applied,
+ * dropped by the learn or rate limits and how long they waited in the
+ * queue before reaching the mac table.
+ *
+ * @cliexpar
+ * @cliexcmd{show l2learn}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_l2learn_cli, static) = {
+  .path = "show l2learn",
+  .short_help = "show l2learn",
+  .function = show_l2learn,
+};
+/* *INDENT-ON* */
+
 
 /*
  * fd.io coding-style-patch-verification: ON
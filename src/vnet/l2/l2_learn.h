@@ -20,6 +20,58 @@
 
 #include <vlib/vlib.h>
 #include <vnet/ethernet/ethernet.h>
+#include <vnet/l2/l2_fib.h>
+
+/*
+ * Learn and move events observed by a worker thread. Workers do not write
+ * the mac table; they queue what they saw and the learner process on the
+ * main thread re-validates it against the current table and applies it.
+ */
+typedef struct
+{
+  l2fib_entry_key_t key;
+  u32 sw_if_index;
+  l2fib_seq_num_t sn;
+  u8 timestamp;
+  u8 pad;
+  /* cpu clock at enqueue time, for learn latency accounting */
+  u64 enqueue_time;
+} l2learn_event_t;
+
+/* Size of the worker recently-queued filter, must be a power of 2 */
+#define L2LEARN_RECENT_SIZE 512
+
+typedef struct
+{
+  u64 key;
+  u32 sw_if_index;
+  u32 seq;
+} l2learn_recent_t;
+
+/*
+ * Single producer (worker) / single consumer (learner) ring of learn
+ * events. head and tail are free running, the ring size is a power of 2.
+ */
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /* written by the learner only */
+  volatile u32 head;
+
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+
+  /* written by the owning worker only */
+  volatile u32 tail;
+  u32 n_enqueued;
+  u32 n_queue_full;
+
+  /* ring storage, learn_queue_size entries */
+  l2learn_event_t *events;
+
+  /* keys queued but not yet applied, suppresses duplicate events */
+  l2learn_recent_t *recent;
+} l2learn_per_thread_data_t;
 
 
 typedef struct
@@ -38,6 +90,34 @@ typedef struct
   u32 client_pid;
   u32 client_index;
 
+  /* per-thread learn event rings, only used by worker threads */
+  l2learn_per_thread_data_t *per_thread_data;
+  u32 learn_queue_size;
+
+  /* max events applied by the learner per ring per wakeup */
+  u32 learn_batch_size;
+
+  /* max new learns or moves per second per bridge domain / interface,
+     0 is unlimited */
+  u32 bd_learn_rate_limit;
+  u32 intf_learn_rate_limit;
+
+  /* learns in the current rate limit window, indexed by bd_index and
+     sw_if_index */
+  u32 *learns_per_bd;
+  u32 *learns_per_sw_if_index;
+  f64 rate_window_start;
+
+  /* learner statistics */
+  u64 n_events_applied;
+  u64 n_learned;
+  u64 n_moved;
+  u64 n_bd_rate_limited;
+  u64 n_intf_rate_limited;
+  u64 n_limit_drops;
+  u64 latency_sum;		/* in cpu clocks */
+  u64 latency_max;
+
   /* Next nodes for each feature */
   u32 feat_next_node_index[32];
 
@@ -48,6 +128,15 @@ typedef struct
 
 #define L2LEARN_DEFAULT_LIMIT (L2FIB_NUM_BUCKETS * 64)
 
+/* Default per-worker learn event ring size, must be a power of 2 */
+#define L2LEARN_DEFAULT_QUEUE_SIZE (16 * 1024)
+
+/* Default max events drained from one ring per learner wakeup */
+#define L2LEARN_DEFAULT_BATCH_SIZE (4 * 1024)
+
+/* Learner process drain interval */
+#define L2LEARN_DRAIN_INTERVAL (1e-3)
+
 extern l2learn_main_t l2learn_main;
 
 extern vlib_node_registration_t l2fib_mac_age_scanner_process_node;
@@ -173,7 +173,14 @@ format_pg_stream (u8 * s, va_list * va)
 
   v = format (v, "buffer-size %d, ", t->buffer_bytes);
 
-  v = format (v, "worker %d, ", t->worker_index);
+  if (t->worker_index != ~0)
+    v = format (v, "worker %d, ", t->worker_index);
+
+  if (t->flags & PG_STREAM_FLAGS_TEMPLATES)
+    v = format (v, "templates %d, ", t->n_templates);
+
+  if (t->replay_speed > 0)
+    v = format (v, "replay speed %.2f, ", t->replay_speed);
 
   if (v)
     {
@@ -235,6 +242,17 @@ pg_pcap_read (pg_stream_t * s, char *file_name)
   /* For PCAP buffers we never re-use buffers. */
   s->flags |= PG_STREAM_FLAGS_DISABLE_BUFFER_RECYCLE;
 
+  /* Timed replay starts the next loop one average packet gap after
+     the last packet. */
+  if (vec_len (pm.timestamps) > 0)
+    {
+      u32 n = vec_len (pm.timestamps);
+      u64 d = pm.timestamps[n - 1] - pm.timestamps[0];
+      s->replay_loop_duration = d + (n > 1 ? d / (n - 1) : 0);
+      if (s->replay_loop_duration == 0)
+	s->replay_loop_duration = 1;
+    }
+
   if (s->n_packets_limit == 0)
     s->n_packets_limit = vec_len (pm.packets_read);
 
@@ -307,6 +325,7 @@ new_stream (vlib_main_t * vm,
   s.max_packet_bytes = s.min_packet_bytes = 64;
   s.buffer_bytes = VLIB_BUFFER_DEFAULT_FREE_LIST_BYTES;
   s.if_id = 0;
+  s.worker_index = ~0;
   pcap_file_name = 0;
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
@@ -354,6 +373,18 @@ new_stream (vlib_main_t * vm,
       else if (unformat (input, "no-recycle"))
 	s.flags |= PG_STREAM_FLAGS_DISABLE_BUFFER_RECYCLE;
 
+      else if (unformat (input, "fast %u", &s.n_templates))
+	s.flags |= PG_STREAM_FLAGS_TEMPLATES;
+
+      else if (unformat (input, "fast"))
+	s.flags |= PG_STREAM_FLAGS_TEMPLATES;
+
+      else if (unformat (input, "timed"))
+	s.replay_speed = 1;
+
+      else if (unformat (input, "speed %f", &s.replay_speed))
+	;
+
       else
 	{
 	  error = clib_error_create ("unknown input `%U'",
@@ -372,6 +403,25 @@ new_stream (vlib_main_t * vm,
       goto done;
     }
 
+  if (s.replay_speed != 0 && !pcap_file_name)
+    {
+      error = clib_error_create ("timed replay needs a pcap file");
+      goto done;
+    }
+
+  if (s.replay_speed < 0)
+    {
+      error = clib_error_create ("negative replay speed");
+      goto done;
+    }
+
+  if ((s.flags & PG_STREAM_FLAGS_TEMPLATES) && pcap_file_name)
+    {
+      error = clib_error_create ("pcap streams are always replayed "
+				 "from templates");
+      goto done;
+    }
+
   if (s.node_index == ~0)
     {
       if (pcap_file_name != 0)
@@ -395,7 +445,7 @@ new_stream (vlib_main_t * vm,
     else
       n = 0;
 
-    if (s.worker_index >= vlib_num_workers ())
+    if (s.worker_index != ~0 && s.worker_index >= vlib_num_workers ())
       s.worker_index = 0;
 
     if (pcap_file_name != 0)
@@ -442,7 +492,11 @@ VLIB_CLI_COMMAND (new_stream_cli, static) = {
   "interface STRING     interface for stream output \n"
   "node NODE-NAME       node for stream output\n"
   "data STRING          specifies packet data\n"
-  "pcap FILENAME        read packet data from pcap file\n",
+  "pcap FILENAME        read packet data from pcap file\n"
+  "fast [N]             pre-build N packets, by default enough to cover\n"
+  "                     all increments, and send copies of those\n"
+  "timed                send pcap packets at their capture times\n"
+  "speed FACTOR         timed replay sped up by FACTOR\n",
 };
 /* *INDENT-ON* */
 
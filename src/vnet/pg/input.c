@@ -1060,11 +1060,13 @@ init_replay_buffers_inline (vlib_main_t * vm,
 			    u32 n_buffers, u32 data_offset, u32 n_data)
 {
   u32 n_left, *b, i, l;
+  u64 time_offset;
 
   n_left = n_buffers;
   b = buffers;
   i = s->current_replay_packet_index;
   l = vec_len (s->replay_packet_templates);
+  time_offset = s->replay_time_offset;
 
   while (n_left >= 1)
     {
@@ -1083,7 +1085,8 @@ init_replay_buffers_inline (vlib_main_t * vm,
       vnet_buffer (b0)->sw_if_index[VLIB_TX] = (u32) ~ 0;
 
       d0 = vec_elt (s->replay_packet_templates, i);
-      vnet_buffer2 (b0)->pg_replay_timestamp = s->replay_packet_timestamps[i];
+      vnet_buffer2 (b0)->pg_replay_timestamp =
+	s->replay_packet_timestamps[i] + time_offset;
 
       n0 = n_data;
       if (data_offset + n_data >= vec_len (d0))
@@ -1092,7 +1095,11 @@ init_replay_buffers_inline (vlib_main_t * vm,
       b0->current_length = n0;
 
       clib_memcpy (b0->data, d0 + data_offset, n0);
-      i = i + 1 == l ? 0 : i + 1;
+      if (++i == l)
+	{
+	  i = 0;
+	  time_offset += s->replay_loop_duration;
+	}
     }
 }
 
@@ -1230,6 +1237,9 @@ pg_stream_fill_helper (pg_main_t * pg,
 					   vlib_get_thread_index (),
 					   si->sw_if_index, n_alloc, l);
 	  s->current_replay_packet_index += n_alloc;
+	  s->replay_time_offset += s->replay_loop_duration *
+	    (s->current_replay_packet_index /
+	     vec_len (s->replay_packet_templates));
 	  s->current_replay_packet_index %=
 	    vec_len (s->replay_packet_templates);
 	}
@@ -1329,6 +1339,109 @@ pg_stream_fill (pg_main_t * pg, pg_stream_t * s, u32 n_buffers)
   return n_in_fifo + n_added;
 }
 
+/* Upper bounds on the template ring of a stream. */
+#define PG_STREAM_MAX_TEMPLATES (64 << 10)
+#define PG_STREAM_MAX_TEMPLATE_BYTES (64 << 20)
+
+static u64
+pg_gcd (u64 a, u64 b)
+{
+  while (b)
+    {
+      u64 t = a % b;
+      a = b;
+      b = t;
+    }
+  return a;
+}
+
+/* Smallest number of packets after which the stream repeats itself,
+   bounded by max. Random edits never repeat. */
+static u32
+pg_stream_period (pg_stream_t * s, u32 max)
+{
+  pg_edit_t *e;
+  u64 period = 1, n;
+
+  if (s->packet_size_edit_type == PG_EDIT_RANDOM)
+    return max;
+  if (s->packet_size_edit_type == PG_EDIT_INCREMENT)
+    period = s->max_packet_bytes - s->min_packet_bytes + 1;
+
+  vec_foreach (e, s->non_fixed_edits)
+  {
+    if (e->type == PG_EDIT_RANDOM)
+      return max;
+    if (e->type != PG_EDIT_INCREMENT)
+      continue;
+    n = pg_edit_get_value (e, PG_EDIT_HI) - pg_edit_get_value (e, PG_EDIT_LO);
+    if (n >= max)
+      return max;
+    n += 1;
+    period = period / pg_gcd (period, n) * n;
+    if (period >= max)
+      return max;
+  }
+
+  return period;
+}
+
+void
+pg_stream_build_templates (pg_main_t * pg, pg_stream_t * s)
+{
+  vlib_main_t *vm = vlib_get_main ();
+  pg_buffer_index_t *bi;
+  u32 max, n_templates;
+  u8 **templates = 0;
+
+  max = PG_STREAM_MAX_TEMPLATE_BYTES / clib_max (s->max_packet_bytes, 1);
+  max = clib_min (max, PG_STREAM_MAX_TEMPLATES);
+  n_templates = s->n_templates ? s->n_templates : pg_stream_period (s, max);
+  n_templates = clib_max (clib_min (n_templates, max), 1);
+  if (s->n_packets_limit > 0)
+    n_templates = clib_min (n_templates, s->n_packets_limit);
+
+  /* run the regular generator a frame at a time and keep a copy of
+     every packet */
+  while (vec_len (templates) < n_templates)
+    {
+      u32 n = pg_stream_fill (pg, s, VLIB_FRAME_SIZE);
+      u32 bi0;
+
+      if (n == 0)
+	break;
+
+      while (clib_fifo_elts (s->buffer_indices[0].buffer_fifo))
+	{
+	  clib_fifo_sub1 (s->buffer_indices[0].buffer_fifo, bi0);
+	  if (vec_len (templates) < n_templates)
+	    {
+	      vlib_buffer_t *b = vlib_get_buffer (vm, bi0);
+	      u8 *t = 0;
+	      vec_validate (t, vlib_buffer_length_in_chain (vm, b) - 1);
+	      vlib_buffer_contents (vm, bi0, t);
+	      vec_add1 (templates, t);
+	    }
+	  vlib_buffer_free (vm, &bi0, 1);
+	}
+
+      /* the other fifos only hold the tails of the chains just freed */
+      vec_foreach (bi, s->buffer_indices) clib_fifo_reset (bi->buffer_fifo);
+    }
+
+  /* out of buffers, keep editing packets */
+  if (vec_len (templates) == 0)
+    {
+      s->flags &= ~PG_STREAM_FLAGS_TEMPLATES;
+      return;
+    }
+
+  s->n_templates = vec_len (templates);
+  s->replay_packet_templates = templates;
+  vec_validate (s->replay_packet_timestamps, vec_len (templates) - 1);
+  s->current_replay_packet_index = 0;
+}
+
 typedef struct
 {
   u32 stream_index;
@@ -1457,6 +1570,40 @@ pg_input_trace (pg_main_t * pg,
     }
 }
 
+/* Number of packets at the head of the fifo whose timestamp is due. */
+static u32
+pg_replay_n_due (vlib_main_t * vm, pg_stream_t * s, u32 n_packets)
+{
+  u32 *fifo = s->buffer_indices[0].buffer_fifo;
+  f64 time_now = vlib_time_now (vm);
+  u64 elapsed;
+  u32 i;
+
+  if (n_packets == 0)
+    return 0;
+
+  if (s->time_replay_start == 0)
+    {
+      vlib_buffer_t *b = vlib_get_buffer (vm, *clib_fifo_head (fifo));
+      s->time_replay_start = time_now;
+      s->replay_time_base = vnet_buffer2 (b)->pg_replay_timestamp;
+    }
+
+  /* in pcap timestamp units (microseconds) */
+  elapsed = (time_now - s->time_replay_start) * 1e6 * s->replay_speed;
+
+  for (i = 0; i < n_packets; i++)
+    {
+      vlib_buffer_t *b =
+	vlib_get_buffer (vm, *clib_fifo_elt_at_index (fifo, i));
+      if (vnet_buffer2 (b)->pg_replay_timestamp - s->replay_time_base >
+	  elapsed)
+	break;
+    }
+
+  return i;
+}
+
 static uword
 pg_generate_packets (vlib_node_runtime_t * node,
 		     pg_main_t * pg,
@@ -1478,6 +1625,8 @@ pg_generate_packets (vlib_node_runtime_t * node,
 
   n_packets_in_fifo = pg_stream_fill (pg, s, n_packets_to_generate);
   n_packets_to_generate = clib_min (n_packets_in_fifo, n_packets_to_generate);
+  if (s->replay_speed > 0)
+    n_packets_to_generate = pg_replay_n_due (vm, s, n_packets_to_generate);
   n_packets_generated = 0;
 
   if (PREDICT_FALSE
@@ -1564,7 +1713,7 @@ pg_input_stream (vlib_node_runtime_t * node, pg_main_t * pg, pg_stream_t * s)
   dt = time_now - s->time_last_generate;
   s->time_last_generate = time_now;
 
-  n_packets = VLIB_FRAME_SIZE;
+  n_packets = vm->frame_size;
   if (s->rate_packets_per_second > 0)
     {
       s->packet_accumulator += dt * s->rate_packets_per_second;
@@ -1580,8 +1729,8 @@ pg_input_stream (vlib_node_runtime_t * node, pg_main_t * pg, pg_stream_t * s)
     n_packets = s->n_packets_limit - s->n_packets_generated;
 
   /* Generate up to one frame's worth of packets. */
-  if (n_packets > VLIB_FRAME_SIZE)
-    n_packets = VLIB_FRAME_SIZE;
+  if (n_packets > vm->frame_size)
+    n_packets = vm->frame_size;
 
   if (n_packets > 0)
     n_packets = pg_generate_packets (node, pg, s, n_packets);
@@ -1596,19 +1745,39 @@ pg_input (vlib_main_t * vm, vlib_node_runtime_t * node, vlib_frame_t * frame)
 {
   uword i;
   pg_main_t *pg = &pg_main;
+  vnet_device_and_queue_t *dq;
+  vnet_device_input_runtime_t *rt = (void *) node->runtime_data;
   uword n_packets = 0;
+  uword n_streams = 0;
   u32 worker_index = 0;
 
   if (vlib_num_workers ())
     worker_index = vlib_get_current_worker_index ();
 
   /* *INDENT-OFF* */
-  clib_bitmap_foreach (i, pg->enabled_streams[worker_index], ({
-    pg_stream_t *s = vec_elt_at_index (pg->streams, i);
-    n_packets += pg_input_stream (node, pg, s);
-  }));
+  if (worker_index < vec_len (pg->enabled_streams))
+    clib_bitmap_foreach (i, pg->enabled_streams[worker_index], ({
+      pg_stream_t *s = vec_elt_at_index (pg->streams, i);
+      n_packets += pg_input_stream (node, pg, s);
+      n_streams++;
+    }));
+
+  foreach_device_and_queue (dq, rt->devices_and_queues)
+    {
+      pg_interface_t *pi = pool_elt_at_index (pg->interfaces,
+					      dq->dev_instance);
+      clib_bitmap_foreach (i, pi->enabled_streams, ({
+	pg_stream_t *s = vec_elt_at_index (pg->streams, i);
+	n_packets += pg_input_stream (node, pg, s);
+	n_streams++;
+      }));
+    }
   /* *INDENT-ON* */
 
+  /* Nothing left to generate on this thread. */
+  if (n_streams == 0)
+    vlib_node_set_state (vm, node->node_index, VLIB_NODE_STATE_DISABLED);
+
   return n_packets;
 }
 
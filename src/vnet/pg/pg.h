@@ -103,6 +103,9 @@ typedef struct pg_stream_t
   /* Stream is currently enabled. */
 #define PG_STREAM_FLAGS_IS_ENABLED (1 << 0)
 #define PG_STREAM_FLAGS_DISABLE_BUFFER_RECYCLE (1 << 1)
+  /* Packets are copied from a ring of templates built once with the
+     stream edits instead of being edited one by one. */
+#define PG_STREAM_FLAGS_TEMPLATES (1 << 2)
 
   /* Edit groups are created by each protocol level (e.g. ethernet,
      ip4, tcp, ...). */
@@ -143,7 +146,8 @@ typedef struct pg_stream_t
   /* Node where stream's buffers get put. */
   u32 node_index;
 
-  /* Worker thread index */
+  /* Worker the stream is pinned to, or ~0 to run wherever the rx queue
+     of its interface is placed. */
   u32 worker_index;
 
   /* Output next index to reach output node from stream input node. */
@@ -171,6 +175,21 @@ typedef struct pg_stream_t
   u8 **replay_packet_templates;
   u64 *replay_packet_timestamps;
   u32 current_replay_packet_index;
+
+  /* Number of templates for PG_STREAM_FLAGS_TEMPLATES streams,
+     zero means enough to cover all increment edits. */
+  u32 n_templates;
+
+  /* Timed replay: packets are sent at their pcap timestamps sped up by
+     this factor, zero means as fast as the rate allows. */
+  f64 replay_speed;
+  f64 time_replay_start;
+  u64 replay_time_base;
+
+  /* Added to the timestamps of each replay loop so that they keep
+     increasing when the templates wrap. */
+  u64 replay_time_offset;
+  u64 replay_loop_duration;
 } pg_stream_t;
 
 always_inline void
@@ -302,6 +321,9 @@ typedef struct
   /* Identifies stream for this interface. */
   u32 id;
 
+  /* Bitmap of enabled streams not pinned to a worker. */
+  uword *enabled_streams;
+
   pcap_main_t pcap_main;
   u8 *pcap_file_name;
 } pg_interface_t;
@@ -318,7 +340,7 @@ typedef struct pg_main_t
   /* Pool of streams. */
   pg_stream_t *streams;
 
-  /* Bitmap indicating which streams are currently enabled. */
+  /* Per worker bitmap of enabled streams pinned to that worker. */
   uword **enabled_streams;
 
   /* Hash mapping name -> stream index. */
@@ -345,6 +367,9 @@ vlib_node_function_t pg_input, pg_output;
 void pg_stream_del (pg_main_t * pg, uword index);
 void pg_stream_add (pg_main_t * pg, pg_stream_t * s_init);
 
+/* Replace stream edits with a ring of pre-built packets. */
+void pg_stream_build_templates (pg_main_t * pg, pg_stream_t * s);
+
 /* Enable/disable stream. */
 void pg_stream_enable_disable (pg_main_t * pg, pg_stream_t * s,
 			       int is_enable);
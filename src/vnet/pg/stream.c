@@ -66,10 +66,18 @@ pg_stream_enable_disable (pg_main_t * pg, pg_stream_t * s, int want_enabled)
 
   ASSERT (!pool_is_free (pg->streams, s));
 
-  vec_validate (pg->enabled_streams, s->worker_index);
-  pg->enabled_streams[s->worker_index] =
-    clib_bitmap_set (pg->enabled_streams[s->worker_index], s - pg->streams,
-		     want_enabled);
+  /* Streams pinned to a worker run there, all others follow the rx
+     queue placement of their interface. */
+  if (s->worker_index != ~0)
+    {
+      vec_validate (pg->enabled_streams, s->worker_index);
+      pg->enabled_streams[s->worker_index] =
+	clib_bitmap_set (pg->enabled_streams[s->worker_index],
+			 s - pg->streams, want_enabled);
+    }
+  else
+    pi->enabled_streams = clib_bitmap_set (pi->enabled_streams,
+					   s - pg->streams, want_enabled);
 
   if (want_enabled)
     {
@@ -78,20 +86,23 @@ pg_stream_enable_disable (pg_main_t * pg, pg_stream_t * s, int want_enabled)
 
       vnet_sw_interface_set_flags (vnm, pi->sw_if_index,
 				   VNET_SW_INTERFACE_FLAG_ADMIN_UP);
-    }
 
-  if (vlib_num_workers ())
-    vm = vlib_get_worker_vlib_main (s->worker_index);
-  else
-    vm = vlib_get_main ();
-
-  vlib_node_set_state (vm, pg_input_node.index,
-		       (clib_bitmap_is_zero
-			(pg->enabled_streams[s->worker_index]) ?
-			VLIB_NODE_STATE_DISABLED : VLIB_NODE_STATE_POLLING));
+      /* pg-input disables itself once it runs out of streams. */
+      if (s->worker_index == ~0)
+	vm = vlib_mains[vnet_get_device_input_thread_index
+			(vnm, pi->hw_if_index, 0)];
+      else if (vlib_num_workers ())
+	vm = vlib_get_worker_vlib_main (s->worker_index);
+      else
+	vm = vlib_get_main ();
+
+      vlib_node_set_state (vm, pg_input_node.index,
+			   VLIB_NODE_STATE_POLLING);
+    }
 
   s->packet_accumulator = 0;
   s->time_last_generate = 0;
+  s->time_replay_start = 0;
 }
 
 static u8 *
@@ -217,6 +228,18 @@ pg_interface_add_or_get (pg_main_t * pg, uword if_id)
 
       hash_set (pg->if_index_by_if_id, if_id, i);
 
+      /* Give the interface an rx queue so streams which are not pinned to
+         a worker can be moved with "set interface rx-placement". They
+         start on the first worker, like the pinned streams by default.
+         pg-input keeps running for the pinned streams when the queue
+         moves away, and disables itself once it has no streams left. */
+      hi->flags |= VNET_HW_INTERFACE_FLAG_INPUT_NODE_SELF_DISABLES;
+      vnet_hw_interface_set_input_node (vnm, pi->hw_if_index,
+					pg_input_node.index);
+      vnet_hw_interface_assign_rx_thread (vnm, pi->hw_if_index, 0,
+					  vnet_device_main.
+					  first_worker_thread_index);
+
       if (vlib_num_workers ())
 	{
 	  pi->lockp = clib_mem_alloc_aligned (CLIB_CACHE_LINE_BYTES,
@@ -465,6 +488,9 @@ pg_stream_add (pg_main_t * pg, pg_stream_t * s_init)
   /* Connect the graph. */
   s->next_index = vlib_node_add_next (vm, device_input_node.index,
 				      s->node_index);
+
+  if (s->flags & PG_STREAM_FLAGS_TEMPLATES)
+    pg_stream_build_templates (pg, s);
 }
 
 void
@@ -0,0 +1,688 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Forwarding state snapshots for warm restarts.
+ *
+ * Subsystems register named sections, each of which serializes its
+ * configuration with the vppinfra serializer. A snapshot file holds a
+ * fixed header, a directory of sections and the section data. Restoring
+ * maps the file and unserializes every section in place, in registration
+ * order, calling the subsystems' internal functions directly: there is no
+ * per-object message, no endian conversion and no per-object worker
+ * barrier, the whole restore runs under a single one.
+ *
+ * Interfaces are referenced by name and tables by table id, so a snapshot
+ * is independent of the indices of the instance which saved it. Sections
+ * the restoring instance does not know, e.g. of a plugin which is not
+ * loaded, are skipped.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <vnet/snapshot/snapshot.h>
+#include <vnet/fib/fib_table.h>
+#include <vnet/ip/ip.h>
+#include <vlib/log.h>
+
+vnet_snapshot_main_t vnet_snapshot_main;
+
+static int
+snapshot_section_cmp (void *a1, void *a2)
+{
+  vnet_snapshot_section_registration_t **r1 = a1, **r2 = a2;
+
+  if ((*r1)->order != (*r2)->order)
+    return (*r1)->order < (*r2)->order ? -1 : 1;
+  return strcmp ((*r1)->name, (*r2)->name);
+}
+
+static vnet_snapshot_section_registration_t **
+snapshot_sections (vnet_snapshot_main_t * snm)
+{
+  vnet_snapshot_section_registration_t *r;
+
+  if (snm->sections)
+    return snm->sections;
+
+  for (r = snm->next_section; r; r = r->next)
+    vec_add1 (snm->sections, r);
+  vec_sort_with_function (snm->sections, snapshot_section_cmp);
+
+  return snm->sections;
+}
+
+void
+vnet_snapshot_serialize_sw_if_index (serialize_main_t * m, u32 sw_if_index)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  u8 *name = 0;
+
+  if (sw_if_index != ~0)
+    name = format (0, "%U%c", format_vnet_sw_if_index_name,
+		   snm->vnet_main, sw_if_index, 0);
+  serialize_cstring (m, (char *) name);
+  vec_free (name);
+}
+
+int
+vnet_snapshot_unserialize_sw_if_index (serialize_main_t * m,
+				       u32 * sw_if_index)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  char *name;
+  uword *p;
+
+  *sw_if_index = ~0;
+  unserialize_cstring (m, &name);
+  if (!name)
+    return 0;
+
+  p = hash_get_mem (snm->sw_if_index_by_name, name);
+  vec_free (name);
+  if (!p)
+    return -1;
+
+  *sw_if_index = p[0];
+  return 0;
+}
+
+void
+vnet_snapshot_serialize_fib_index (serialize_main_t * m,
+				   fib_protocol_t proto, u32 fib_index)
+{
+  u32 table_id = ~0;
+
+  if (fib_index != ~0)
+    table_id = fib_table_get_table_id (fib_index, proto);
+  serialize_integer (m, table_id, sizeof (u32));
+}
+
+u32
+vnet_snapshot_unserialize_fib_index (serialize_main_t * m,
+				     fib_protocol_t proto)
+{
+  u32 table_id;
+
+  unserialize_integer (m, &table_id, sizeof (u32));
+  if (table_id == ~0)
+    return ~0;
+
+  ip_table_create (proto, table_id, 1 /* is_api */ , 0);
+  return fib_table_find (proto, table_id);
+}
+
+static void
+snapshot_build_interface_names (vnet_snapshot_main_t * snm)
+{
+  vnet_interface_main_t *im = &snm->vnet_main->interface_main;
+  vnet_sw_interface_t *si;
+  u8 *name;
+
+  /* *INDENT-OFF* */
+  pool_foreach (si, im->sw_interfaces,
+  ({
+    name = format (0, "%U%c", format_vnet_sw_interface_name,
+		   snm->vnet_main, si, 0);
+    hash_set_mem (snm->sw_if_index_by_name, name, si->sw_if_index);
+  }));
+  /* *INDENT-ON* */
+}
+
+static void
+snapshot_free_interface_names (vnet_snapshot_main_t * snm)
+{
+  hash_pair_t *p;
+  u8 *name;
+
+  /* *INDENT-OFF* */
+  hash_foreach_pair (p, snm->sw_if_index_by_name,
+  ({
+    name = (u8 *) p->key;
+    vec_free (name);
+  }));
+  /* *INDENT-ON* */
+  hash_free (snm->sw_if_index_by_name);
+}
+
+static clib_error_t *
+snapshot_write (int fd, void *data, uword n_bytes)
+{
+  ssize_t n;
+
+  while (n_bytes > 0)
+    {
+      n = write (fd, data, n_bytes);
+      if (n < 0)
+	return clib_error_return_unix (0, "write");
+      data += n;
+      n_bytes -= n;
+    }
+  return 0;
+}
+
+clib_error_t *
+vnet_snapshot_save (char *file, vnet_snapshot_section_result_t ** results)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  vnet_snapshot_section_registration_t **sections, *r;
+  vnet_snapshot_file_header_t h;
+  vnet_snapshot_file_section_t *dir = 0, *d;
+  vnet_snapshot_section_result_t *res;
+  clib_error_t *error = 0;
+  serialize_main_t m;
+  u8 **data = 0, *v, *tmp_file = 0;
+  u64 offset;
+  f64 t0;
+  int i, fd = -1;
+
+  sections = snapshot_sections (snm);
+  for (i = 0; i < vec_len (sections); i++)
+    {
+      r = sections[i];
+      t0 = vlib_time_now (snm->vlib_main);
+      snm->n_objects = snm->n_skipped = 0;
+
+      serialize_open_vector (&m, 0);
+      error = serialize (&m, r->save);
+      v = serialize_close_vector (&m);
+      if (error)
+	{
+	  vec_free (v);
+	  error = clib_error_return (error, "section `%s'", r->name);
+	  goto done;
+	}
+
+      vec_add2 (dir, d, 1);
+      strncpy (d->name, r->name, sizeof (d->name) - 1);
+      d->n_bytes = vec_len (v);
+      d->n_objects = snm->n_objects;
+      vec_add1 (data, v);
+
+      if (results)
+	{
+	  vec_add2 (*results, res, 1);
+	  res->name = r->name;
+	  res->n_objects = snm->n_objects;
+	  res->n_skipped = snm->n_skipped;
+	  res->n_bytes = vec_len (v);
+	  res->time = vlib_time_now (snm->vlib_main) - t0;
+	}
+    }
+
+  memset (&h, 0, sizeof (h));
+  h.magic = VNET_SNAPSHOT_MAGIC;
+  h.version = VNET_SNAPSHOT_VERSION;
+  h.n_sections = vec_len (dir);
+
+  offset = sizeof (h) + vec_bytes (dir);
+  vec_foreach (d, dir)
+  {
+    d->offset = offset;
+    offset += d->n_bytes;
+  }
+
+  /* Write a temporary file and rename it, so that a failed save never
+     leaves a truncated snapshot behind */
+  tmp_file = format (0, "%s.tmp%c", file, 0);
+  fd = open ((char *) tmp_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    {
+      error = clib_error_return_unix (0, "open `%s'", tmp_file);
+      goto done;
+    }
+
+  if ((error = snapshot_write (fd, &h, sizeof (h))))
+    goto done;
+  if ((error = snapshot_write (fd, dir, vec_bytes (dir))))
+    goto done;
+  for (i = 0; i < vec_len (data); i++)
+    if ((error = snapshot_write (fd, data[i], vec_len (data[i]))))
+      goto done;
+
+  close (fd);
+  fd = -1;
+  if (rename ((char *) tmp_file, file) < 0)
+    error = clib_error_return_unix (0, "rename `%s'", tmp_file);
+
+done:
+  if (fd >= 0)
+    close (fd);
+  if (error && tmp_file)
+    unlink ((char *) tmp_file);
+  for (i = 0; i < vec_len (data); i++)
+    vec_free (data[i]);
+  vec_free (data);
+  vec_free (dir);
+  vec_free (tmp_file);
+  return error;
+}
+
+static clib_error_t *
+snapshot_map (char *file, u8 ** base, uword * n_bytes)
+{
+  vnet_snapshot_file_header_t *h;
+  vnet_snapshot_file_section_t *dir;
+  struct stat st;
+  int fd, i;
+
+  fd = open (file, O_RDONLY);
+  if (fd < 0)
+    return clib_error_return_unix (0, "open `%s'", file);
+
+  if (fstat (fd, &st) < 0)
+    {
+      close (fd);
+      return clib_error_return_unix (0, "stat `%s'", file);
+    }
+
+  if (st.st_size < sizeof (*h))
+    {
+      close (fd);
+      return clib_error_return (0, "`%s' is not a snapshot", file);
+    }
+
+  *n_bytes = st.st_size;
+  *base = mmap (0, *n_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (*base == MAP_FAILED)
+    return clib_error_return_unix (0, "mmap `%s'", file);
+
+  /* The sections are read front to back */
+  madvise (*base, *n_bytes, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+  h = (vnet_snapshot_file_header_t *) * base;
+  dir = (vnet_snapshot_file_section_t *) (h + 1);
+  if (h->magic != VNET_SNAPSHOT_MAGIC)
+    goto bad;
+  if (h->version != VNET_SNAPSHOT_VERSION)
+    {
+      munmap (*base, *n_bytes);
+      return clib_error_return (0, "`%s': unsupported snapshot version %u",
+				file, h->version);
+    }
+  if (sizeof (*h) + (u64) h->n_sections * sizeof (dir[0]) > *n_bytes)
+    goto bad;
+  for (i = 0; i < h->n_sections; i++)
+    if (dir[i].offset > *n_bytes || dir[i].n_bytes > *n_bytes - dir[i].offset)
+      goto bad;
+
+  return 0;
+
+bad:
+  munmap (*base, *n_bytes);
+  return clib_error_return (0, "`%s' is not a snapshot or is truncated",
+			    file);
+}
+
+clib_error_t *
+vnet_snapshot_restore (char *file, vnet_snapshot_section_result_t ** results)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  vlib_main_t *vm = snm->vlib_main;
+  vnet_snapshot_section_registration_t **sections, *r;
+  vnet_snapshot_file_header_t *h;
+  vnet_snapshot_file_section_t *dir;
+  vnet_snapshot_section_result_t *res;
+  clib_error_t *error;
+  serialize_main_t m;
+  uword n_bytes;
+  u8 *base, *found;
+  f64 t0;
+  int i, j;
+
+  if ((error = snapshot_map (file, &base, &n_bytes)))
+    return error;
+
+  h = (vnet_snapshot_file_header_t *) base;
+  dir = (vnet_snapshot_file_section_t *) (h + 1);
+  found = 0;
+  vec_validate (found, h->n_sections);
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  snm->sw_if_index_by_name = hash_create_string (0, sizeof (uword));
+  snapshot_build_interface_names (snm);
+
+  sections = snapshot_sections (snm);
+  for (i = 0; i < vec_len (sections); i++)
+    {
+      r = sections[i];
+      for (j = 0; j < h->n_sections; j++)
+	if (!strncmp (dir[j].name, r->name, sizeof (dir[j].name)))
+	  break;
+      if (j == h->n_sections)
+	continue;
+      found[j] = 1;
+
+      t0 = vlib_time_now (vm);
+      snm->n_objects = snm->n_skipped = 0;
+
+      unserialize_open_data (&m, base + dir[j].offset, dir[j].n_bytes);
+      error = unserialize (&m, r->restore);
+      /* A data stream has no data function to close it with. A section
+         reading past its end gets zeros from the overflow buffer */
+      vec_free (m.stream.overflow_buffer);
+      if (error)
+	{
+	  error = clib_error_return (error, "section `%s'", r->name);
+	  break;
+	}
+
+      if (results)
+	{
+	  vec_add2 (*results, res, 1);
+	  res->name = r->name;
+	  res->n_objects = snm->n_objects;
+	  res->n_skipped = snm->n_skipped;
+	  res->n_bytes = dir[j].n_bytes;
+	  res->time = vlib_time_now (vm) - t0;
+	}
+    }
+
+  snapshot_free_interface_names (snm);
+
+  vlib_worker_thread_barrier_release (vm);
+
+  /* Sections nobody registered, report them as entirely skipped */
+  for (j = 0; !error && results && j < h->n_sections; j++)
+    if (!found[j])
+      {
+	vec_add2 (*results, res, 1);
+	res->name = 0;
+	res->unknown_name = format (0, "%.*s%c", sizeof (dir[j].name),
+				    dir[j].name, 0);
+	res->n_skipped = dir[j].n_objects;
+	res->n_bytes = dir[j].n_bytes;
+      }
+
+  vec_free (found);
+  munmap (base, n_bytes);
+  return error;
+}
+
+u8 *
+format_vnet_snapshot_results (u8 * s, va_list * args)
+{
+  vnet_snapshot_section_result_t *results =
+    va_arg (*args, vnet_snapshot_section_result_t *);
+  vnet_snapshot_section_result_t *res;
+  u32 n_objects = 0, n_skipped = 0;
+  f64 time = 0;
+  uword n_bytes = 0;
+
+  s = format (s, "%-16s%10s%10s%12s%12s", "section", "objects", "skipped",
+	      "bytes", "msec");
+  vec_foreach (res, results)
+  {
+    s = format (s, "\n%-16s%10u%10u%12U", res->name ? res->name :
+		(char *) res->unknown_name, res->n_objects, res->n_skipped,
+		format_memory_size, res->n_bytes);
+    if (res->name)
+      s = format (s, "%12.3f", res->time * 1e3);
+    else
+      s = format (s, "%12s", "unknown");
+    n_objects += res->n_objects;
+    n_skipped += res->n_skipped;
+    n_bytes += res->n_bytes;
+    time += res->time;
+  }
+  s = format (s, "\n%-16s%10u%10u%12U%12.3f", "total", n_objects,
+	      n_skipped, format_memory_size, n_bytes, time * 1e3);
+  return s;
+}
+
+void
+vnet_snapshot_results_free (vnet_snapshot_section_result_t * results)
+{
+  vnet_snapshot_section_result_t *res;
+
+  vec_foreach (res, results) vec_free (res->unknown_name);
+  vec_free (results);
+}
+
+static clib_error_t *
+snapshot_save_command_fn (vlib_main_t * vm,
+			  unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vnet_snapshot_section_result_t *results = 0;
+  clib_error_t *error;
+  u8 *file = 0;
+
+  if (!unformat (input, "%s", &file))
+    return clib_error_return (0, "snapshot file required");
+  vec_add1 (file, 0);
+
+  error = vnet_snapshot_save ((char *) file, &results);
+  if (!error)
+    vlib_cli_output (vm, "%U", format_vnet_snapshot_results, results);
+
+  vnet_snapshot_results_free (results);
+  vec_free (file);
+  return error;
+}
+
+/*?
+ * Save the interface, route, neighbor and feature configuration to a
+ * snapshot file, which '<em>snapshot restore</em>' applies in bulk after
+ * a restart. The file is written to a temporary name and renamed, so an
+ * existing snapshot is only replaced by a complete one.
+ *
+ * @cliexpar
+ * @cliexstart{snapshot save /tmp/vpp.snap}
+ * section            objects   skipped       bytes        msec
+ * interface                3         0        206       0.021
+ * ip-route            100000         0      2.49m     152.907
+ * ip-neighbor              1         0         27       0.004
+ * total               100004         0      2.49m     152.932
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (snapshot_save_command, static) = {
+  .path = "snapshot save",
+  .short_help = "snapshot save <file>",
+  .function = snapshot_save_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+snapshot_restore_command_fn (vlib_main_t * vm,
+			     unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  vnet_snapshot_section_result_t *results = 0;
+  clib_error_t *error;
+  u8 *file = 0;
+
+  if (!unformat (input, "%s", &file))
+    return clib_error_return (0, "snapshot file required");
+  vec_add1 (file, 0);
+
+  error = vnet_snapshot_restore ((char *) file, &results);
+  if (!error)
+    vlib_cli_output (vm, "%U", format_vnet_snapshot_results, results);
+
+  vnet_snapshot_results_free (results);
+  vec_free (file);
+  return error;
+}
+
+/*?
+ * Restore a snapshot written by '<em>snapshot save</em>'. The file is
+ * memory mapped and every section is applied directly, under a single
+ * worker barrier. Objects referring to interfaces which do not exist are
+ * skipped, so interfaces which are created by configuration, such as
+ * loopbacks, must be created before the restore. The same restore runs
+ * at startup with '<em>snapshot { restore <file> }</em>', once the
+ * devices have been initialized but before the unix startup-config file
+ * is executed. When the startup-config file creates interfaces, end it
+ * with '<em>snapshot restore <file></em>' instead.
+ *
+ * @cliexpar
+ * @cliexstart{snapshot restore /tmp/vpp.snap}
+ * section            objects   skipped       bytes        msec
+ * interface                3         0        206       0.094
+ * ip-route            100000         0      2.49m     390.135
+ * ip-neighbor              1         0         27       0.017
+ * total               100004         0      2.49m     390.246
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (snapshot_restore_command, static) = {
+  .path = "snapshot restore",
+  .short_help = "snapshot restore <file>",
+  .function = snapshot_restore_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_snapshot_command_fn (vlib_main_t * vm,
+			  unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vnet_snapshot_file_header_t *h;
+  vnet_snapshot_file_section_t *dir;
+  clib_error_t *error;
+  uword n_bytes;
+  u8 *file = 0, *base;
+  int i;
+
+  if (!unformat (input, "%s", &file))
+    return clib_error_return (0, "snapshot file required");
+  vec_add1 (file, 0);
+
+  error = snapshot_map ((char *) file, &base, &n_bytes);
+  vec_free (file);
+  if (error)
+    return error;
+
+  h = (vnet_snapshot_file_header_t *) base;
+  dir = (vnet_snapshot_file_section_t *) (h + 1);
+  vlib_cli_output (vm, "version %u, %u sections, %U", h->version,
+		   h->n_sections, format_memory_size, n_bytes);
+  vlib_cli_output (vm, "%-16s%10s%12s%12s", "section", "objects",
+		   "offset", "bytes");
+  for (i = 0; i < h->n_sections; i++)
+    vlib_cli_output (vm, "%-16.*s%10u%12lu%12U", sizeof (dir[i].name),
+		     dir[i].name, dir[i].n_objects, dir[i].offset,
+		     format_memory_size, dir[i].n_bytes);
+
+  munmap (base, n_bytes);
+  return 0;
+}
+
+/*?
+ * Display the sections of a snapshot file.
+ *
+ * @cliexpar
+ * @cliexstart{show snapshot /tmp/vpp.snap}
+ * version 1, 3 sections, 2.49m
+ * section            objects      offset       bytes
+ * interface                3         160         206
+ * ip-route            100000         366       2.49m
+ * ip-neighbor              1     2491174          27
+ * @cliexend
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_snapshot_command, static) = {
+  .path = "show snapshot",
+  .short_help = "show snapshot <file>",
+  .function = show_snapshot_command_fn,
+};
+/* *INDENT-ON* */
+
+static uword
+snapshot_restore_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+			  vlib_frame_t * f)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  vnet_snapshot_section_result_t *results = 0;
+  vlib_log_class_t log_class;
+  clib_error_t *error;
+  f64 t0;
+
+  if (!snm->startup_restore_file)
+    return 0;
+
+  /* Every process has run up to its first suspend once we resume, so
+     devices which are created from a process exist by now */
+  vlib_process_suspend (vm, 1e-3);
+
+  log_class = vlib_log_register_class ("snapshot", 0);
+  t0 = vlib_time_now (vm);
+  error = vnet_snapshot_restore ((char *) snm->startup_restore_file,
+				 &results);
+  if (error)
+    {
+      vlib_log_err (log_class, "%U", format_clib_error, error);
+      clib_error_free (error);
+    }
+  else
+    vlib_log_notice (log_class, "restored %s in %.3f msec\n%U",
+		     snm->startup_restore_file,
+		     (vlib_time_now (vm) - t0) * 1e3,
+		     format_vnet_snapshot_results, results);
+
+  vnet_snapshot_results_free (results);
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (snapshot_restore_process_node, static) = {
+  .function = snapshot_restore_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "snapshot-restore-process",
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+vnet_snapshot_config (vlib_main_t * vm, unformat_input_t * input)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "restore %s", &snm->startup_restore_file))
+	vec_add1 (snm->startup_restore_file, 0);
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  return 0;
+}
+
+VLIB_CONFIG_FUNCTION (vnet_snapshot_config, "snapshot");
+
+static clib_error_t *
+vnet_snapshot_init (vlib_main_t * vm)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+
+  snm->vlib_main = vm;
+  snm->vnet_main = vnet_get_main ();
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (vnet_snapshot_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef included_vnet_snapshot_h
+#define included_vnet_snapshot_h
+
+#include <vnet/vnet.h>
+#include <vnet/fib/fib_types.h>
+#include <vppinfra/serialize.h>
+
+/** Order in which the core sections are saved and restored. Interfaces
+    come first so that later sections find their addresses and tables */
+typedef enum
+{
+  VNET_SNAPSHOT_ORDER_INTERFACE = 10,
+  VNET_SNAPSHOT_ORDER_ROUTE = 20,
+  VNET_SNAPSHOT_ORDER_NEIGHBOR = 30,
+  VNET_SNAPSHOT_ORDER_FEATURE = 40,
+} vnet_snapshot_order_t;
+
+/** snapshot section registration object */
+typedef struct _vnet_snapshot_section_registration
+{
+  /** next registration in list of all registrations */
+  struct _vnet_snapshot_section_registration *next;
+  /** Section name, as stored in the snapshot file */
+  char *name;
+  /** Sections are saved and restored in ascending order */
+  u32 order;
+  /** Serialize the section's state */
+  serialize_function_t *save;
+  /** Unserialize and apply the section's state */
+  serialize_function_t *restore;
+} vnet_snapshot_section_registration_t;
+
+#define VNET_SNAPSHOT_MAGIC 0x76736e70	/* "vsnp" */
+#define VNET_SNAPSHOT_VERSION 1
+#define VNET_SNAPSHOT_SECTION_NAME_BYTES 32
+
+/** Snapshot file header. The file is written in host byte order and is
+    only meant to be read back on the same machine */
+typedef struct
+{
+  u32 magic;
+  u32 version;
+  u32 n_sections;
+  u32 pad;
+} vnet_snapshot_file_header_t;
+
+/** Snapshot file directory entry, one per section after the header */
+typedef struct
+{
+  char name[VNET_SNAPSHOT_SECTION_NAME_BYTES];
+  /** Offset of the section data from the start of the file */
+  u64 offset;
+  u64 n_bytes;
+  /** Objects saved */
+  u32 n_objects;
+  u32 pad;
+} vnet_snapshot_file_section_t;
+
+typedef struct
+{
+  /** Linked list of section registrations */
+  vnet_snapshot_section_registration_t *next_section;
+
+  /** Registrations sorted by order, built on first use */
+  vnet_snapshot_section_registration_t **sections;
+
+  /** Interface name to sw_if_index, valid while restoring */
+  uword *sw_if_index_by_name;
+
+  /** Objects saved or restored, and objects skipped, by the section
+      currently running */
+  u32 n_objects;
+  u32 n_skipped;
+
+  /** File restored at startup, once the devices exist */
+  u8 *startup_restore_file;
+
+  /** convenience */
+  vlib_main_t *vlib_main;
+  vnet_main_t *vnet_main;
+} vnet_snapshot_main_t;
+
+extern vnet_snapshot_main_t vnet_snapshot_main;
+
+#define VNET_SNAPSHOT_SECTION(x,...)					\
+  __VA_ARGS__ vnet_snapshot_section_registration_t vnet_snapshot_section_##x; \
+static void __vnet_add_snapshot_section_##x (void)			\
+  __attribute__((__constructor__)) ;					\
+static void __vnet_add_snapshot_section_##x (void)			\
+{									\
+  vnet_snapshot_main_t * snm = &vnet_snapshot_main;			\
+  vnet_snapshot_section_##x.next = snm->next_section;			\
+  snm->next_section = & vnet_snapshot_section_##x;			\
+}									\
+static void __vnet_rm_snapshot_section_##x (void)			\
+  __attribute__((__destructor__)) ;					\
+static void __vnet_rm_snapshot_section_##x (void)			\
+{									\
+  vnet_snapshot_main_t * snm = &vnet_snapshot_main;			\
+  vnet_snapshot_section_registration_t *r = &vnet_snapshot_section_##x; \
+  VLIB_REMOVE_FROM_LINKED_LIST (snm->next_section, r, next);		\
+  vec_free (snm->sections);						\
+}									\
+__VA_ARGS__ vnet_snapshot_section_registration_t vnet_snapshot_section_##x
+
+/** Per section outcome of a save or restore */
+typedef struct
+{
+  /** Section name, 0 for a section of the file nobody registered */
+  char *name;
+  u8 *unknown_name;
+  u32 n_objects;
+  u32 n_skipped;
+  uword n_bytes;
+  f64 time;
+} vnet_snapshot_section_result_t;
+
+clib_error_t *vnet_snapshot_save (char *file,
+				  vnet_snapshot_section_result_t ** results);
+clib_error_t *vnet_snapshot_restore (char *file,
+				     vnet_snapshot_section_result_t **
+				     results);
+format_function_t format_vnet_snapshot_results;
+void vnet_snapshot_results_free (vnet_snapshot_section_result_t * results);
+
+/** Interfaces are saved by name, their indices need not survive a
+    restart */
+void vnet_snapshot_serialize_sw_if_index (serialize_main_t * m,
+					  u32 sw_if_index);
+/** Returns -1 if the interface does not exist in the restoring instance.
+    An interface saved as ~0 is restored as ~0 */
+int vnet_snapshot_unserialize_sw_if_index (serialize_main_t * m,
+					   u32 * sw_if_index);
+
+/** Tables are saved by table id. Restoring a table id creates the table
+    if needed and returns its fib index */
+void vnet_snapshot_serialize_fib_index (serialize_main_t * m,
+					fib_protocol_t proto, u32 fib_index);
+u32 vnet_snapshot_unserialize_fib_index (serialize_main_t * m,
+					 fib_protocol_t proto);
+
+always_inline void
+vnet_snapshot_serialize_ip4_address (serialize_main_t * m,
+				     ip4_address_t * a)
+{
+  serialize_integer (m, a->as_u32, sizeof (a->as_u32));
+}
+
+always_inline void
+vnet_snapshot_unserialize_ip4_address (serialize_main_t * m,
+				       ip4_address_t * a)
+{
+  unserialize_integer (m, &a->as_u32, sizeof (a->as_u32));
+}
+
+always_inline void
+vnet_snapshot_serialize_ip46_address (serialize_main_t * m,
+				      ip46_address_t * a)
+{
+  serialize_integer (m, a->as_u64[0], sizeof (a->as_u64[0]));
+  serialize_integer (m, a->as_u64[1], sizeof (a->as_u64[1]));
+}
+
+always_inline void
+vnet_snapshot_unserialize_ip46_address (serialize_main_t * m,
+					ip46_address_t * a)
+{
+  unserialize_integer (m, &a->as_u64[0], sizeof (a->as_u64[0]));
+  unserialize_integer (m, &a->as_u64[1], sizeof (a->as_u64[1]));
+}
+
+#endif /* included_vnet_snapshot_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
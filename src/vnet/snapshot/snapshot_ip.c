@@ -0,0 +1,627 @@
+/*
+ * Copyright (c) 2018 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Snapshot sections of the core forwarding state: interface settings,
+ * API and CLI sourced IP routes, and static neighbors. Adjacencies are
+ * not saved, they are rebuilt from the neighbors and routes.
+ *
+ * Routes are saved with their paths, not their forwarding objects, so
+ * the FIB resolves them again on restore. Paths with MPLS label stacks,
+ * UDP encap, BIER, rx interface or RPF id, and exclusive routes other
+ * than drop, unreachable, prohibit and local, are not saved.
+ */
+
+#include <vnet/snapshot/snapshot.h>
+#include <vnet/ip/ip.h>
+#include <vnet/ip/ip6_neighbor.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/ethernet/arp_packet.h>
+#include <vnet/fib/fib_table.h>
+#include <vnet/fib/fib_entry.h>
+#include <vnet/dpo/ip_null_dpo.h>
+#include <vnet/dpo/receive_dpo.h>
+
+static void
+snapshot_serialize_interface_addresses (serialize_main_t * m,
+					ip_lookup_main_t * lm,
+					u32 sw_if_index)
+{
+  ip_interface_address_t *ia;
+  ip46_address_t *addrs = 0, *a;
+  u8 *lens = 0;
+  int i;
+
+  /* *INDENT-OFF* */
+  foreach_ip_interface_address (lm, ia, sw_if_index,
+				0 /* honor unnumbered */,
+  ({
+    vec_add2 (addrs, a, 1);
+    memset (a, 0, sizeof (*a));
+    if (lm == &ip4_main.lookup_main)
+      a->ip4 = *(ip4_address_t *) ip_interface_address_get_address (lm, ia);
+    else
+      a->ip6 = *(ip6_address_t *) ip_interface_address_get_address (lm, ia);
+    vec_add1 (lens, ia->address_length);
+  }));
+  /* *INDENT-ON* */
+
+  serialize_integer (m, vec_len (addrs), sizeof (u32));
+  for (i = 0; i < vec_len (addrs); i++)
+    {
+      vnet_snapshot_serialize_ip46_address (m, &addrs[i]);
+      serialize_integer (m, lens[i], sizeof (u8));
+    }
+
+  vec_free (addrs);
+  vec_free (lens);
+}
+
+static u32
+snapshot_interface_table_id (u32 * fib_index_by_sw_if_index,
+			     fib_protocol_t proto, u32 sw_if_index)
+{
+  if (sw_if_index >= vec_len (fib_index_by_sw_if_index))
+    return 0;
+  return fib_table_get_table_id (fib_index_by_sw_if_index[sw_if_index],
+				 proto);
+}
+
+static void
+snapshot_save_interfaces (serialize_main_t * m, va_list * va)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  vnet_main_t *vnm = snm->vnet_main;
+  vnet_interface_main_t *im = &vnm->interface_main;
+  vnet_sw_interface_t *si;
+  vnet_hw_interface_t *hi;
+  u32 mtu;
+
+  serialize_integer (m, pool_elts (im->sw_interfaces), sizeof (u32));
+
+  /* *INDENT-OFF* */
+  pool_foreach (si, im->sw_interfaces,
+  ({
+    mtu = 0;
+    if (si->type == VNET_SW_INTERFACE_TYPE_HARDWARE)
+      {
+	hi = vnet_get_hw_interface (vnm, si->hw_if_index);
+	mtu = hi->max_packet_bytes;
+      }
+
+    vnet_snapshot_serialize_sw_if_index (m, si->sw_if_index);
+    serialize_integer (m, (si->flags & VNET_SW_INTERFACE_FLAG_ADMIN_UP) != 0,
+		       sizeof (u8));
+    serialize_integer (m, mtu, sizeof (u32));
+    serialize_integer (m, snapshot_interface_table_id
+		       (ip4_main.fib_index_by_sw_if_index, FIB_PROTOCOL_IP4,
+			si->sw_if_index), sizeof (u32));
+    serialize_integer (m, snapshot_interface_table_id
+		       (ip6_main.fib_index_by_sw_if_index, FIB_PROTOCOL_IP6,
+			si->sw_if_index), sizeof (u32));
+    snapshot_serialize_interface_addresses (m, &ip4_main.lookup_main,
+					    si->sw_if_index);
+    snapshot_serialize_interface_addresses (m, &ip6_main.lookup_main,
+					    si->sw_if_index);
+    snm->n_objects++;
+  }));
+  /* *INDENT-ON* */
+}
+
+static void
+snapshot_restore_table_bind (fib_protocol_t proto,
+			     u32 * fib_index_by_sw_if_index,
+			     u32 sw_if_index, u32 table_id)
+{
+  if (table_id == snapshot_interface_table_id (fib_index_by_sw_if_index,
+					       proto, sw_if_index))
+    return;
+
+  ip_table_create (proto, table_id, 1 /* is_api */ , 0);
+  ip_table_bind (proto, sw_if_index, table_id, 1 /* is_api */ );
+}
+
+static void
+snapshot_restore_interfaces (serialize_main_t * m, va_list * va)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  vnet_main_t *vnm = snm->vnet_main;
+  vlib_main_t *vm = snm->vlib_main;
+  vnet_sw_interface_t *si;
+  clib_error_t *error;
+  ip46_address_t a;
+  u32 i, j, n, n_addrs, sw_if_index, mtu, table_id[2];
+  u8 admin_up, len;
+  int found, is_ip6;
+
+  unserialize_integer (m, &n, sizeof (u32));
+  for (i = 0; i < n; i++)
+    {
+      found = vnet_snapshot_unserialize_sw_if_index (m, &sw_if_index) == 0;
+      unserialize_integer (m, &admin_up, sizeof (u8));
+      unserialize_integer (m, &mtu, sizeof (u32));
+      unserialize_integer (m, &table_id[0], sizeof (u32));
+      unserialize_integer (m, &table_id[1], sizeof (u32));
+
+      if (found)
+	{
+	  si = vnet_get_sw_interface (vnm, sw_if_index);
+	  if (mtu && si->type == VNET_SW_INTERFACE_TYPE_HARDWARE)
+	    vnet_hw_interface_set_mtu (vnm, si->hw_if_index, mtu);
+
+	  /* Tables before addresses, an interface with addresses can not
+	     change its IPv6 table */
+	  snapshot_restore_table_bind (FIB_PROTOCOL_IP4,
+				       ip4_main.fib_index_by_sw_if_index,
+				       sw_if_index, table_id[0]);
+	  snapshot_restore_table_bind (FIB_PROTOCOL_IP6,
+				       ip6_main.fib_index_by_sw_if_index,
+				       sw_if_index, table_id[1]);
+	}
+
+      for (is_ip6 = 0; is_ip6 < 2; is_ip6++)
+	{
+	  unserialize_integer (m, &n_addrs, sizeof (u32));
+	  for (j = 0; j < n_addrs; j++)
+	    {
+	      vnet_snapshot_unserialize_ip46_address (m, &a);
+	      unserialize_integer (m, &len, sizeof (u8));
+	      if (!found)
+		continue;
+
+	      if (is_ip6)
+		error = ip6_add_del_interface_address (vm, sw_if_index,
+						       &a.ip6, len, 0);
+	      else
+		error = ip4_add_del_interface_address (vm, sw_if_index,
+						       &a.ip4, len, 0);
+	      if (error)
+		{
+		  clib_error_free (error);
+		  snm->n_skipped++;
+		}
+	    }
+	}
+
+      if (!found)
+	{
+	  snm->n_skipped++;
+	  continue;
+	}
+
+      if (admin_up)
+	{
+	  error = vnet_sw_interface_set_flags (vnm, sw_if_index,
+					       VNET_SW_INTERFACE_FLAG_ADMIN_UP);
+	  if (error)
+	    clib_error_free (error);
+	}
+      snm->n_objects++;
+    }
+}
+
+/* *INDENT-OFF* */
+VNET_SNAPSHOT_SECTION (interface) = {
+  .name = "interface",
+  .order = VNET_SNAPSHOT_ORDER_INTERFACE,
+  .save = snapshot_save_interfaces,
+  .restore = snapshot_restore_interfaces,
+};
+/* *INDENT-ON* */
+
+/** How a saved route forwards */
+typedef enum
+{
+  SNAPSHOT_ROUTE_PATHS,
+  SNAPSHOT_ROUTE_DROP,
+  SNAPSHOT_ROUTE_UNREACH,
+  SNAPSHOT_ROUTE_PROHIBIT,
+  SNAPSHOT_ROUTE_LOCAL,
+} snapshot_route_kind_t;
+
+#define SNAPSHOT_ROUTE_PATH_UNSUPPORTED					\
+  (FIB_ROUTE_PATH_INTF_RX | FIB_ROUTE_PATH_RPF_ID |			\
+   FIB_ROUTE_PATH_UDP_ENCAP | FIB_ROUTE_PATH_BIER_FMASK |		\
+   FIB_ROUTE_PATH_BIER_TABLE | FIB_ROUTE_PATH_BIER_IMP)
+
+/** Does the path resolve through a table, i.e. is it recursive or a
+    lookup in another table */
+always_inline int
+snapshot_route_path_has_table (fib_route_path_t * rpath)
+{
+  return (rpath->frp_sw_if_index == ~0 &&
+	  !(rpath->frp_flags & (FIB_ROUTE_PATH_LOCAL |
+				FIB_ROUTE_PATH_DROP |
+				FIB_ROUTE_PATH_EXCLUSIVE)));
+}
+
+static fib_table_walk_rc_t
+snapshot_route_collect (fib_node_index_t fei, void *arg)
+{
+  fib_node_index_t **feis = arg;
+  fib_source_t src = fib_entry_get_best_source (fei);
+
+  if (src == FIB_SOURCE_API || src == FIB_SOURCE_CLI)
+    vec_add1 (*feis, fei);
+  return (FIB_TABLE_WALK_CONTINUE);
+}
+
+/** Classify an entry's encoded paths, ~0 if it can not be saved */
+static u32
+snapshot_route_kind (fib_route_path_encode_t * rpaths)
+{
+  fib_route_path_encode_t *rp;
+
+  if (vec_len (rpaths) == 1
+      && (rpaths[0].rpath.frp_flags & FIB_ROUTE_PATH_EXCLUSIVE))
+    {
+      switch (rpaths[0].dpo.dpoi_type)
+	{
+	case DPO_DROP:
+	  return SNAPSHOT_ROUTE_DROP;
+	case DPO_RECEIVE:
+	  return SNAPSHOT_ROUTE_LOCAL;
+	case DPO_IP_NULL:
+	  switch (ip_null_dpo_get_action (rpaths[0].dpo.dpoi_index))
+	    {
+	    case IP_NULL_ACTION_NONE:
+	      return SNAPSHOT_ROUTE_DROP;
+	    case IP_NULL_ACTION_SEND_ICMP_UNREACH:
+	      return SNAPSHOT_ROUTE_UNREACH;
+	    case IP_NULL_ACTION_SEND_ICMP_PROHIBIT:
+	      return SNAPSHOT_ROUTE_PROHIBIT;
+	    }
+	  return ~0;
+	default:
+	  return ~0;
+	}
+    }
+
+  vec_foreach (rp, rpaths)
+  {
+    if (rp->rpath.frp_flags & (SNAPSHOT_ROUTE_PATH_UNSUPPORTED |
+			       FIB_ROUTE_PATH_EXCLUSIVE))
+      return ~0;
+    if (snapshot_route_path_has_table (&rp->rpath)
+	&& rp->rpath.frp_proto != DPO_PROTO_IP4
+	&& rp->rpath.frp_proto != DPO_PROTO_IP6)
+      return ~0;
+  }
+  return SNAPSHOT_ROUTE_PATHS;
+}
+
+static void
+snapshot_save_route (serialize_main_t * m, fib_node_index_t fei,
+		     fib_route_path_encode_t * rpaths, u32 kind)
+{
+  fib_route_path_encode_t *rp;
+  fib_route_path_t *rpath;
+  fib_prefix_t pfx;
+
+  fib_entry_get_prefix (fei, &pfx);
+  serialize_integer (m, fib_entry_get_best_source (fei) == FIB_SOURCE_CLI,
+		     sizeof (u8));
+  serialize_integer (m, pfx.fp_len, sizeof (u8));
+  vnet_snapshot_serialize_ip46_address (m, &pfx.fp_addr);
+  serialize_integer (m, kind, sizeof (u8));
+  if (kind != SNAPSHOT_ROUTE_PATHS)
+    return;
+
+  serialize_integer (m, vec_len (rpaths), sizeof (u32));
+  vec_foreach (rp, rpaths)
+  {
+    rpath = &rp->rpath;
+    serialize_integer (m, rpath->frp_proto, sizeof (u8));
+    serialize_integer (m, rpath->frp_flags, sizeof (u32));
+    vnet_snapshot_serialize_sw_if_index (m, rpath->frp_sw_if_index);
+    vnet_snapshot_serialize_ip46_address (m, &rpath->frp_addr);
+    vnet_snapshot_serialize_fib_index
+      (m, dpo_proto_to_fib (rpath->frp_proto),
+       snapshot_route_path_has_table (rpath) ? rpath->frp_fib_index : ~0);
+    serialize_integer (m, rpath->frp_weight, sizeof (u8));
+    serialize_integer (m, rpath->frp_preference, sizeof (u8));
+  }
+}
+
+static void
+snapshot_save_routes (serialize_main_t * m, va_list * va)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  fib_route_path_encode_t **rpaths = 0;
+  fib_node_index_t *feis = 0;
+  fib_table_t *fib_table, *fibs;
+  fib_protocol_t proto;
+  u32 *kinds = 0, n_routes;
+  int i;
+
+  for (proto = FIB_PROTOCOL_IP4; proto <= FIB_PROTOCOL_IP6; proto++)
+    {
+      fibs = (proto == FIB_PROTOCOL_IP4 ? ip4_main.fibs : ip6_main.fibs);
+      serialize_integer (m, pool_elts (fibs), sizeof (u32));
+
+      /* *INDENT-OFF* */
+      pool_foreach (fib_table, fibs,
+      ({
+	vec_reset_length (feis);
+	fib_table_walk (fib_table->ft_index, proto,
+			snapshot_route_collect, &feis);
+	/* In prefix order, restoring then inserts into the tables in
+	   order rather than in hash order */
+	vec_sort_with_function (feis, fib_entry_cmp_for_sort);
+
+	/* Which entries can be saved is only known once their paths are
+	   encoded, and the count comes first */
+	vec_validate (rpaths, vec_len (feis));
+	vec_validate (kinds, vec_len (feis));
+	n_routes = 0;
+	for (i = 0; i < vec_len (feis); i++)
+	  {
+	    fib_entry_encode (feis[i], &rpaths[i]);
+	    kinds[i] = snapshot_route_kind (rpaths[i]);
+	    n_routes += kinds[i] != ~0;
+	  }
+
+	serialize_integer (m, fib_table->ft_table_id, sizeof (u32));
+	serialize_integer (m, n_routes, sizeof (u32));
+	for (i = 0; i < vec_len (feis); i++)
+	  {
+	    if (kinds[i] == ~0)
+	      snm->n_skipped++;
+	    else
+	      {
+		snapshot_save_route (m, feis[i], rpaths[i], kinds[i]);
+		snm->n_objects++;
+	      }
+	    vec_free (rpaths[i]);
+	  }
+      }));
+      /* *INDENT-ON* */
+    }
+
+  vec_free (feis);
+  vec_free (kinds);
+  vec_free (rpaths);
+}
+
+static void
+snapshot_restore_special_route (u32 fib_index, fib_prefix_t * pfx,
+				fib_source_t src, u32 kind)
+{
+  dpo_id_t dpo = DPO_INVALID;
+  dpo_proto_t dproto = fib_proto_to_dpo (pfx->fp_proto);
+
+  switch (kind)
+    {
+    case SNAPSHOT_ROUTE_DROP:
+      ip_null_dpo_add_and_lock (dproto, IP_NULL_ACTION_NONE, &dpo);
+      break;
+    case SNAPSHOT_ROUTE_UNREACH:
+      ip_null_dpo_add_and_lock (dproto, IP_NULL_ACTION_SEND_ICMP_UNREACH,
+				&dpo);
+      break;
+    case SNAPSHOT_ROUTE_PROHIBIT:
+      ip_null_dpo_add_and_lock (dproto, IP_NULL_ACTION_SEND_ICMP_PROHIBIT,
+				&dpo);
+      break;
+    case SNAPSHOT_ROUTE_LOCAL:
+      receive_dpo_add_or_lock (dproto, ~0, NULL, &dpo);
+      break;
+    }
+
+  fib_table_entry_special_dpo_update (fib_index, pfx, src,
+				      FIB_ENTRY_FLAG_EXCLUSIVE, &dpo);
+  dpo_reset (&dpo);
+}
+
+static void
+snapshot_restore_routes (serialize_main_t * m, va_list * va)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  fib_route_path_t *paths = 0, *rpath;
+  fib_protocol_t proto;
+  fib_prefix_t pfx;
+  fib_source_t src;
+  u32 n_tables, table_id, fib_index, n_routes, n_paths, i, j, k;
+  u8 is_cli, kind, val;
+  int ok;
+
+  for (proto = FIB_PROTOCOL_IP4; proto <= FIB_PROTOCOL_IP6; proto++)
+    {
+      unserialize_integer (m, &n_tables, sizeof (u32));
+      for (i = 0; i < n_tables; i++)
+	{
+	  unserialize_integer (m, &table_id, sizeof (u32));
+	  unserialize_integer (m, &n_routes, sizeof (u32));
+	  ip_table_create (proto, table_id, 1 /* is_api */ , 0);
+	  fib_index = fib_table_find (proto, table_id);
+
+	  for (j = 0; j < n_routes; j++)
+	    {
+	      memset (&pfx, 0, sizeof (pfx));
+	      pfx.fp_proto = proto;
+	      unserialize_integer (m, &is_cli, sizeof (u8));
+	      unserialize_integer (m, &val, sizeof (u8));
+	      pfx.fp_len = val;
+	      vnet_snapshot_unserialize_ip46_address (m, &pfx.fp_addr);
+	      unserialize_integer (m, &kind, sizeof (u8));
+	      src = is_cli ? FIB_SOURCE_CLI : FIB_SOURCE_API;
+
+	      if (kind != SNAPSHOT_ROUTE_PATHS)
+		{
+		  snapshot_restore_special_route (fib_index, &pfx, src, kind);
+		  snm->n_objects++;
+		  continue;
+		}
+
+	      ok = 1;
+	      unserialize_integer (m, &n_paths, sizeof (u32));
+	      vec_reset_length (paths);
+	      for (k = 0; k < n_paths; k++)
+		{
+		  vec_add2 (paths, rpath, 1);
+		  memset (rpath, 0, sizeof (*rpath));
+		  unserialize_integer (m, &val, sizeof (u8));
+		  rpath->frp_proto = val;
+		  unserialize_integer (m, &rpath->frp_flags, sizeof (u32));
+		  if (vnet_snapshot_unserialize_sw_if_index
+		      (m, &rpath->frp_sw_if_index))
+		    ok = 0;
+		  vnet_snapshot_unserialize_ip46_address (m, &rpath->frp_addr);
+		  rpath->frp_fib_index = vnet_snapshot_unserialize_fib_index
+		    (m, dpo_proto_to_fib (rpath->frp_proto));
+		  unserialize_integer (m, &rpath->frp_weight, sizeof (u8));
+		  unserialize_integer (m, &rpath->frp_preference,
+				       sizeof (u8));
+		}
+
+	      /* A path through a missing interface would otherwise turn
+	         into a recursive one */
+	      if (!ok)
+		{
+		  snm->n_skipped++;
+		  continue;
+		}
+
+	      fib_table_entry_update (fib_index, &pfx, src,
+				      FIB_ENTRY_FLAG_NONE, paths);
+	      snm->n_objects++;
+	    }
+	}
+    }
+
+  vec_free (paths);
+}
+
+/* *INDENT-OFF* */
+VNET_SNAPSHOT_SECTION (ip_route) = {
+  .name = "ip-route",
+  .order = VNET_SNAPSHOT_ORDER_ROUTE,
+  .save = snapshot_save_routes,
+  .restore = snapshot_restore_routes,
+};
+/* *INDENT-ON* */
+
+static void
+snapshot_save_neighbors (serialize_main_t * m, va_list * va)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  ethernet_arp_ip4_entry_t *e4, *e4s = 0;
+  ip6_neighbor_t *n6, *n6s = 0;
+
+  /* *INDENT-OFF* */
+  pool_foreach (e4, ip4_neighbors_pool (),
+  ({
+    if (e4->flags & ETHERNET_ARP_IP4_ENTRY_FLAG_STATIC)
+      vec_add1 (e4s, *e4);
+  }));
+  pool_foreach (n6, ip6_neighbors_pool (),
+  ({
+    if (n6->flags & IP6_NEIGHBOR_FLAG_STATIC)
+      vec_add1 (n6s, *n6);
+  }));
+  /* *INDENT-ON* */
+
+  serialize_integer (m, vec_len (e4s), sizeof (u32));
+  vec_foreach (e4, e4s)
+  {
+    vnet_snapshot_serialize_sw_if_index (m, e4->sw_if_index);
+    vnet_snapshot_serialize_ip4_address (m, &e4->ip4_address);
+    serialize_multiple (m, e4->ethernet_address, sizeof (u8), sizeof (u8),
+			6);
+    serialize_integer (m, (e4->flags &
+			   ETHERNET_ARP_IP4_ENTRY_FLAG_NO_FIB_ENTRY) != 0,
+		       sizeof (u8));
+  }
+
+  serialize_integer (m, vec_len (n6s), sizeof (u32));
+  vec_foreach (n6, n6s)
+  {
+    vnet_snapshot_serialize_sw_if_index (m, n6->key.sw_if_index);
+    serialize_integer (m, n6->key.ip6_address.as_u64[0], sizeof (u64));
+    serialize_integer (m, n6->key.ip6_address.as_u64[1], sizeof (u64));
+    serialize_multiple (m, n6->link_layer_address, sizeof (u8), sizeof (u8),
+			6);
+    serialize_integer (m, (n6->flags & IP6_NEIGHBOR_FLAG_NO_FIB_ENTRY) != 0,
+		       sizeof (u8));
+  }
+
+  snm->n_objects = vec_len (e4s) + vec_len (n6s);
+  vec_free (e4s);
+  vec_free (n6s);
+}
+
+static void
+snapshot_restore_neighbors (serialize_main_t * m, va_list * va)
+{
+  vnet_snapshot_main_t *snm = &vnet_snapshot_main;
+  ethernet_arp_ip4_over_ethernet_address_t a4;
+  ip6_address_t a6;
+  u32 i, n, sw_if_index;
+  u8 mac[6], no_fib_entry;
+  int missing;
+
+  unserialize_integer (m, &n, sizeof (u32));
+  for (i = 0; i < n; i++)
+    {
+      missing = vnet_snapshot_unserialize_sw_if_index (m, &sw_if_index);
+      vnet_snapshot_unserialize_ip4_address (m, &a4.ip4);
+      unserialize_multiple (m, a4.ethernet, sizeof (u8), sizeof (u8), 6);
+      unserialize_integer (m, &no_fib_entry, sizeof (u8));
+      if (missing || sw_if_index == ~0)
+	{
+	  snm->n_skipped++;
+	  continue;
+	}
+      vnet_arp_set_ip4_over_ethernet (snm->vnet_main, sw_if_index, &a4,
+				      1 /* is_static */ , no_fib_entry);
+      snm->n_objects++;
+    }
+
+  unserialize_integer (m, &n, sizeof (u32));
+  for (i = 0; i < n; i++)
+    {
+      missing = vnet_snapshot_unserialize_sw_if_index (m, &sw_if_index);
+      unserialize_integer (m, &a6.as_u64[0], sizeof (u64));
+      unserialize_integer (m, &a6.as_u64[1], sizeof (u64));
+      unserialize_multiple (m, mac, sizeof (u8), sizeof (u8), 6);
+      unserialize_integer (m, &no_fib_entry, sizeof (u8));
+      if (missing || sw_if_index == ~0)
+	{
+	  snm->n_skipped++;
+	  continue;
+	}
+      vnet_set_ip6_ethernet_neighbor (snm->vlib_main, sw_if_index, &a6, mac,
+				      sizeof (mac), 1 /* is_static */ ,
+				      no_fib_entry);
+      snm->n_objects++;
+    }
+}
+
+/* *INDENT-OFF* */
+VNET_SNAPSHOT_SECTION (ip_neighbor) = {
+  .name = "ip-neighbor",
+  .order = VNET_SNAPSHOT_ORDER_NEIGHBOR,
+  .save = snapshot_save_neighbors,
+  .restore = snapshot_restore_neighbors,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -103,7 +103,7 @@ format_tapcli_rx_trace (u8 * s, va_list * va)
 typedef struct
 {
   /** Vector of VLIB rx buffers to use.  We allocate them in blocks
-     of VLIB_FRAME_SIZE (256). */
+     of the frame size, vm->frame_size. */
   u32 *rx_buffers;
 
   /** Vector of iovecs for readv/writev calls. */
@@ -300,7 +300,7 @@ tapcli_rx_iface (vlib_main_t * vm,
 	    vlib_buffer_alloc_from_free_list (vm,
 					      &tm->threads[thread_index].
 					      rx_buffers[len],
-					      VLIB_FRAME_SIZE - len,
+					      vm->frame_size - len,
 					      VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
 	  if (PREDICT_FALSE
 	      (vec_len (tm->threads[thread_index].rx_buffers) <
@@ -424,7 +424,7 @@ tapcli_rx_iface (vlib_main_t * vm,
   vlib_put_next_frame (vm, node, next, n_left_to_next);
   if (set_trace)
     vlib_set_trace_count (vm, node, n_trace);
-  return VLIB_FRAME_SIZE - n_left_to_next;
+  return vm->frame_size - n_left_to_next;
 }
 
 /**
@@ -1540,7 +1540,7 @@ tapcli_init (vlib_main_t * vm)
   {
     thread->iovecs = 0;
     thread->rx_buffers = 0;
-    vec_alloc (thread->rx_buffers, VLIB_FRAME_SIZE);
+    vec_alloc (thread->rx_buffers, vm->frame_size);
     vec_reset_length (thread->rx_buffers);
   }
 
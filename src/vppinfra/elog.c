@@ -42,24 +42,6 @@
 #include <vppinfra/hash.h>
 #include <vppinfra/math.h>
 
-static inline void
-elog_lock (elog_main_t * em)
-{
-  if (PREDICT_FALSE (em->lock != 0))
-    while (__sync_lock_test_and_set (em->lock, 1))
-      ;
-}
-
-static inline void
-elog_unlock (elog_main_t * em)
-{
-  if (PREDICT_FALSE (em->lock != 0))
-    {
-      CLIB_MEMORY_BARRIER ();
-      *em->lock = 0;
-    }
-}
-
 /* Non-inline version. */
 void *
 elog_event_data (elog_main_t * em,
@@ -483,6 +465,82 @@ elog_init (elog_main_t * em, u32 n_events)
   elog_time_now (&em->init_time);
 }
 
+void
+elog_thread_rings_enable (elog_main_t * em, uword n_threads, uword n_events)
+{
+  elog_thread_ring_t *r;
+
+  n_events = max_pow2 (n_events);
+  if (vec_len (em->thread_rings) != n_threads
+      || em->thread_ring_size != n_events)
+    {
+      vec_foreach (r, em->thread_rings) vec_free (r->events);
+      vec_free (em->thread_rings);
+      vec_validate_aligned (em->thread_rings, n_threads - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      vec_foreach (r, em->thread_rings)
+	vec_resize_aligned (r->events, n_events, CLIB_CACHE_LINE_BYTES);
+      em->thread_ring_size = n_events;
+    }
+
+  vec_foreach (r, em->thread_rings) r->head = r->tail = r->reset_head = 0;
+
+  /* The rings must be ready before a thread sees them enabled. */
+  CLIB_MEMORY_BARRIER ();
+  em->thread_rings_enabled = 1;
+}
+
+void
+elog_thread_rings_disable (elog_main_t * em)
+{
+  em->thread_rings_enabled = 0;
+}
+
+uword
+elog_thread_ring_read (elog_main_t * em, uword thread_index,
+		       elog_event_t * events, uword n_max, u64 * n_lost,
+		       int flush)
+{
+  elog_thread_ring_t *r = vec_elt_at_index (em->thread_rings, thread_index);
+  u64 size = em->thread_ring_size, head, tail = r->tail;
+  uword i, n, n_overwritten;
+
+  head = r->head;
+  if (!flush && head > tail)
+    head--;
+
+  /* The events must be read after the head. */
+  CLIB_MEMORY_BARRIER ();
+
+  if (head - tail > size)
+    {
+      *n_lost += head - size - tail;
+      tail = head - size;
+    }
+
+  n = clib_min (head - tail, n_max);
+  for (i = 0; i < n; i++)
+    events[i] = r->events[(tail + i) & (size - 1)];
+
+  /* Events the thread overwrote, or is overwriting, while they were
+     copied are lost too. The thread may be writing the event at head and
+     the data of the one before it. */
+  CLIB_MEMORY_BARRIER ();
+  head = r->head;
+  n_overwritten = 0;
+  if (head + 1 > tail + size)
+    n_overwritten = clib_min (head + 1 - size - tail, n);
+  if (n_overwritten)
+    {
+      memmove (events, events + n_overwritten,
+	       (n - n_overwritten) * sizeof (events[0]));
+      *n_lost += n_overwritten;
+    }
+
+  r->tail = tail + n;
+  return n - n_overwritten;
+}
+
 /* Returns number of events in ring and start index. */
 static uword
 elog_event_range (elog_main_t * em, uword * lo)
@@ -505,11 +563,15 @@ elog_event_range (elog_main_t * em, uword * lo)
     }
 }
 
+static int elog_cmp (void *a1, void *a2);
+
 elog_event_t *
 elog_peek_events (elog_main_t * em)
 {
   elog_event_t *e, *f, *es = 0;
+  elog_thread_ring_t *r;
   uword i, j, n;
+  u64 k, head;
 
   n = elog_event_range (em, &j);
   for (i = 0; i < n; i++)
@@ -518,14 +580,29 @@ elog_peek_events (elog_main_t * em)
       f = vec_elt_at_index (em->event_ring, j);
       e[0] = f[0];
 
-      /* Convert absolute time from cycles to seconds from start. */
-      e->time =
-	(e->time_cycles -
-	 em->init_time.cpu) * em->cpu_timer.seconds_per_clock;
-
       j = (j + 1) & (em->event_ring_size - 1);
     }
 
+  /* Thread rings keep their events after they are disabled, so the
+     events logged before are not lost. */
+  vec_foreach (r, em->thread_rings)
+  {
+    head = r->head;
+    k = r->reset_head;
+    if (head - k > em->thread_ring_size)
+      k = head - em->thread_ring_size;
+    for (; k < head; k++)
+      vec_add1 (es, r->events[k & (em->thread_ring_size - 1)]);
+  }
+
+  /* Convert absolute time from cycles to seconds from start. */
+  vec_foreach (e, es)
+    e->time = (e->time_cycles -
+	       em->init_time.cpu) * em->cpu_timer.seconds_per_clock;
+
+  if (vec_len (em->thread_rings))
+    vec_sort_with_function (es, elog_cmp);
+
   return es;
 }
 
@@ -536,6 +613,8 @@ elog_string (elog_main_t * em, char *fmt, ...)
   u32 offset;
   va_list va;
 
+  elog_lock (em);
+
   va_start (va, fmt);
   offset = vec_len (em->string_table);
   em->string_table = (char *) va_format ((u8 *) em->string_table, fmt, &va);
@@ -545,6 +624,8 @@ elog_string (elog_main_t * em, char *fmt, ...)
   if (vec_end (em->string_table)[-1] != 0)
     vec_add1 (em->string_table, 0);
 
+  elog_unlock (em);
+
   return offset;
 }
 
@@ -54,6 +54,7 @@
 #include <vppinfra/serialize.h>
 #include <vppinfra/time.h>	/* for clib_cpu_time_now */
 #include <vppinfra/mhash.h>
+#include <vppinfra/os.h>	/* for os_get_thread_index */
 
 typedef struct
 {
@@ -128,6 +129,28 @@ typedef struct
   u64 os_nsec;
 } elog_time_stamp_t;
 
+/** Per-thread event ring. Written by its own thread only and read by a
+    single consumer with elog_thread_ring_read, so neither side locks. */
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /** Number of events written. The next event goes to head modulo the
+      ring size. */
+  volatile u64 head;
+
+  /** Power of 2 sized vector of events. */
+  elog_event_t *events;
+
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+
+  /** Next event to be read by the consumer. */
+  u64 tail;
+
+  /** Head at the last elog_reset_buffer, older events are not shown. */
+  u64 reset_head;
+} elog_thread_ring_t;
+
 typedef struct
 {
   /** Total number of events in buffer. */
@@ -177,8 +200,37 @@ typedef struct
 
   /** Vector of events converted to generic form after collection. */
   elog_event_t *events;
+
+  /** Per-thread rings, indexed by thread index. While enabled, threads
+      with a ring log to it instead of event_ring. n_total_events only
+      counts the events of event_ring. */
+  elog_thread_ring_t *thread_rings;
+
+  /** Power of 2 number of events in each thread ring. */
+  uword thread_ring_size;
+
+  /** Set when threads log to their rings. */
+  volatile u32 thread_rings_enabled;
 } elog_main_t;
 
+always_inline void
+elog_lock (elog_main_t * em)
+{
+  if (PREDICT_FALSE (em->lock != 0))
+    while (__sync_lock_test_and_set (em->lock, 1))
+      ;
+}
+
+always_inline void
+elog_unlock (elog_main_t * em)
+{
+  if (PREDICT_FALSE (em->lock != 0))
+    {
+      CLIB_MEMORY_BARRIER ();
+      *em->lock = 0;
+    }
+}
+
 /** @brief Return number of events in the event-log buffer
     @param em elog_main_t *
     @return number of events in the buffer
@@ -206,8 +258,11 @@ elog_buffer_capacity (elog_main_t * em)
 always_inline void
 elog_reset_buffer (elog_main_t * em)
 {
+  elog_thread_ring_t *r;
+
   em->n_total_events = 0;
   em->n_total_events_disable_limit = ~0;
+  vec_foreach (r, em->thread_rings) r->reset_head = r->head;
 }
 
 /** @brief Enable or disable event logging
@@ -310,6 +365,29 @@ elog_event_data_inline (elog_main_t * em,
     }
 
   ASSERT (track_index < vec_len (em->tracks));
+
+  if (PREDICT_FALSE (em->thread_rings_enabled))
+    {
+      uword thread_index = os_get_thread_index ();
+      if (thread_index < vec_len (em->thread_rings))
+	{
+	  elog_thread_ring_t *r = em->thread_rings + thread_index;
+	  u64 head = r->head;
+
+	  e = r->events + (head & (em->thread_ring_size - 1));
+	  e->time_cycles = cpu_time;
+	  e->type = type_index;
+	  e->track = track_index;
+
+	  /* The consumer must see the event before the new head. The
+	     caller fills in the data after this, so the consumer leaves
+	     the newest event alone until the next one is logged. */
+	  CLIB_MEMORY_STORE_BARRIER ();
+	  r->head = head + 1;
+	  return e->data;
+	}
+    }
+
   ASSERT (is_pow2 (vec_len (em->event_ring)));
 
   if (em->lock)
@@ -523,6 +601,38 @@ void unserialize_elog_main (serialize_main_t * m, va_list * va);
 void elog_init (elog_main_t * em, u32 n_events);
 void elog_alloc (elog_main_t * em, u32 n_events);
 
+/** @brief Make threads log to per-thread rings instead of the shared
+    event ring, which saves the atomic increment of a shared counter per
+    event and lets a consumer stream the events out with
+    elog_thread_ring_read. Threads must not be logging while the rings
+    are enabled or disabled.
+    @param em elog_main_t *
+    @param n_threads uword threads 0 .. n_threads - 1 get a ring
+    @param n_events uword events per ring, rounded up to a power of 2
+*/
+void elog_thread_rings_enable (elog_main_t * em, uword n_threads,
+			       uword n_events);
+
+/** @brief Make threads log to the shared event ring again. The rings
+    are kept, their events can still be read. */
+void elog_thread_rings_disable (elog_main_t * em);
+
+/** @brief Read the events a thread logged since the last read
+    @param em elog_main_t *
+    @param thread_index uword
+    @param events elog_event_t * where to copy up to n_max events, with
+    their time in cpu clock cycles
+    @param n_max uword
+    @param n_lost u64 * incremented by the number of events overwritten
+    before they could be read
+    @param flush int also read the newest event. Its data may still be
+    being written unless the thread has stopped logging.
+    @return number of events read
+*/
+uword elog_thread_ring_read (elog_main_t * em, uword thread_index,
+			     elog_event_t * events, uword n_max,
+			     u64 * n_lost, int flush);
+
 #ifdef CLIB_UNIX
 always_inline clib_error_t *
 elog_write_file (elog_main_t * em, char *clib_file, int flush_ring)
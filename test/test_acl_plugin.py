@@ -4,6 +4,7 @@
 
 import unittest
 import random
+from socket import inet_pton, AF_INET
 
 from scapy.packet import Raw
 from scapy.layers.l2 import Ether
@@ -78,6 +79,12 @@ class TestACLplugin(VppTestCase):
     # Test variables
     bd_id = 1
 
+    # acl-plugin lookup schemes, the hash ones are picked when applying
+    lookup_schemes = [
+        ["use-hash-acl-matching 1", "use-tuple-merge 1"],
+        ["use-hash-acl-matching 1", "use-tuple-merge 0"],
+        ["use-hash-acl-matching 0"]]
+
     @classmethod
     def setUpClass(cls):
         """
@@ -1433,5 +1440,157 @@ class TestACLplugin(VppTestCase):
 
         self.logger.info("ACLP_TEST_FINISH_0315")
 
+    def run_lookup_schemes(self, rules, permit, tag):
+        """ apply rules with each lookup scheme and check the traffic """
+        # a small split threshold makes tuple merge spread colliding
+        # entries over several tables
+        self.vapi.cli("set acl-plugin tuple-merge-split-threshold 1")
+        try:
+            for scheme in self.lookup_schemes:
+                for cmd in scheme:
+                    self.vapi.cli("set acl-plugin %s" % cmd)
+                self.apply_rules(rules, tag)
+                self.logger.info(self.vapi.ppcli(
+                    "show acl-plugin tables applied"))
+                self.reset_packet_infos()
+                if permit:
+                    self.run_verify_test(self.IP, self.IPV4,
+                                         self.proto[self.IP][self.TCP])
+                else:
+                    self.run_verify_negat_test(self.IP, self.IPV4,
+                                               self.proto[self.IP][self.TCP])
+        finally:
+            self.vapi.cli("set acl-plugin use-hash-acl-matching 1")
+            self.vapi.cli("set acl-plugin use-tuple-merge 1")
+            self.vapi.cli("set acl-plugin tuple-merge-split-threshold 39")
+
+    def test_0400_tuple_merge_permit(self):
+        """ tuple merge: relaxed mask hits are checked exactly
+        """
+        self.logger.info("ACLP_TEST_START_0400")
+
+        # The deny rules collide with the traffic under the relaxed
+        # masks of tuple merge (/24, any port) but do not match it
+        rules = []
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL,
+                     self.proto[self.IP][self.TCP], 25,
+                     inet_pton(AF_INET, "172.17.101.128")))
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL,
+                     self.proto[self.IP][self.TCP], 26,
+                     inet_pton(AF_INET, "172.17.101.64")))
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL,
+                     self.proto[self.IP][self.TCP], 0, '\x00\x00\x00\x00',
+                     28, inet_pton(AF_INET, "172.17.102.16")))
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_RANGE_2,
+                     self.proto[self.IP][self.TCP]))
+        rules.append(self.create_rule(self.IPV4, self.PERMIT, self.PORTS_RANGE,
+                     self.proto[self.IP][self.TCP]))
+        # deny ip any any in the end
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL, 0))
+
+        # Traffic should pass with every lookup scheme
+        self.run_lookup_schemes(rules, True, "tuple merge permit")
+
+        self.logger.info("ACLP_TEST_FINISH_0400")
+
+    def test_0401_tuple_merge_deny(self):
+        """ tuple merge: non-octet prefix deny before a permit
+        """
+        self.logger.info("ACLP_TEST_START_0401")
+
+        rules = []
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL,
+                     self.proto[self.IP][self.TCP], 26,
+                     inet_pton(AF_INET, "172.17.101.64")))
+        # covers the source hosts
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL,
+                     self.proto[self.IP][self.TCP], 28,
+                     inet_pton(AF_INET, "172.17.101.0")))
+        rules.append(self.create_rule(self.IPV4, self.PERMIT, self.PORTS_RANGE,
+                     self.proto[self.IP][self.TCP]))
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL, 0))
+
+        # Traffic should be dropped with every lookup scheme
+        self.run_lookup_schemes(rules, False, "tuple merge deny")
+
+        self.logger.info("ACLP_TEST_FINISH_0401")
+
+    def test_0402_tuple_merge_lookup_perf(self):
+        """ tuple merge: lookup results match linear search
+        """
+        self.logger.info("ACLP_TEST_START_0402")
+
+        self.vapi.cli("set acl-plugin tuple-merge-split-threshold 1")
+        reply = self.vapi.cli("test acl-plugin lookup-perf rules 200 "
+                              "packets 2000 iterations 1 linear-check 2000")
+        self.vapi.cli("set acl-plugin tuple-merge-split-threshold 39")
+        self.logger.info(reply)
+        self.assertIn("result mismatches: 0 between the schemes, "
+                      "0 of 2000 vs. linear search", reply)
+
+        self.logger.info("ACLP_TEST_FINISH_0402")
+
+    def test_0410_replace_applied_acl(self):
+        """ replace an applied ACL in place
+        """
+        self.logger.info("ACLP_TEST_START_0410")
+
+        # deny tcp from the source hosts, permit the rest of tcp
+        rules = []
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL,
+                     self.proto[self.IP][self.TCP], 28,
+                     inet_pton(AF_INET, "172.17.101.0")))
+        rules.append(self.create_rule(self.IPV4, self.PERMIT, self.PORTS_RANGE,
+                     self.proto[self.IP][self.TCP]))
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL, 0))
+        reply = self.vapi.acl_add_replace(acl_index=4294967295, r=rules,
+                                          tag="replace")
+        acl_index = reply.acl_index
+        for i in self.pg_interfaces:
+            self.vapi.acl_interface_set_acl_list(sw_if_index=i.sw_if_index,
+                                                 n_input=1,
+                                                 acls=[acl_index])
+        self.run_verify_negat_test(self.IP, self.IPV4,
+                                   self.proto[self.IP][self.TCP])
+
+        # replacing the deny by a rule which does not match the traffic
+        # updates the applied hash entries
+        rules[0] = self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL,
+                                    self.proto[self.IP][self.TCP], 28,
+                                    inet_pton(AF_INET, "172.17.101.16"))
+        reply = self.vapi.acl_add_replace(acl_index=acl_index, r=rules,
+                                          tag="replace")
+        self.assertEqual(reply.acl_index, acl_index)
+        self.reset_packet_infos()
+        self.run_verify_test(self.IP, self.IPV4, self.proto[self.IP][self.TCP])
+
+        # and back, with a rule inserted in front which shifts the
+        # following entries
+        rules[0] = self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL,
+                                    self.proto[self.IP][self.TCP], 28,
+                                    inet_pton(AF_INET, "172.17.101.0"))
+        rules.insert(0, self.create_rule(self.IPV4, self.DENY,
+                                         self.PORTS_RANGE_2,
+                                         self.proto[self.IP][self.TCP]))
+        self.vapi.acl_add_replace(acl_index=acl_index, r=rules,
+                                  tag="replace")
+        self.run_verify_negat_test(self.IP, self.IPV4,
+                                   self.proto[self.IP][self.TCP])
+
+        self.logger.info("ACLP_TEST_FINISH_0410")
+
+    def test_0411_replace_update_perf(self):
+        """ incremental ACL update matches a full rebuild
+        """
+        self.logger.info("ACLP_TEST_START_0411")
+
+        reply = self.vapi.cli("test acl-plugin update-perf rules 200 "
+                              "contexts 4 updates 4 linear-check 500")
+        self.logger.info(reply)
+        self.assertIn("result mismatches: 0 between the contexts, "
+                      "0 of 1000 vs. linear search", reply)
+
+        self.logger.info("ACLP_TEST_FINISH_0411")
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -372,6 +372,69 @@ class Flowprobe(MethodHolder):
         ipfix.remove_vpp_config()
         self.logger.info("FFP_TEST_FINISH_0002")
 
+    def flowprobe_counters(self):
+        """ flowprobe error counters summed over the nodes """
+        counters = {}
+        for line in self.vapi.cli("show errors").split("\n"):
+            m = re.match(r"^\s*(\d+)\s+flowprobe-\S+\s+(.*\S)\s*$", line)
+            if m:
+                counters[m.group(2)] = (counters.get(m.group(2), 0) +
+                                        int(m.group(1)))
+        return counters
+
+    def test_0003(self):
+        """ many flows, one record each, passive expiry"""
+        self.logger.info("FFP_TEST_START_0003")
+        self.pg_enable_capture(self.pg_interfaces)
+
+        ipfix = VppCFLOW(test=self, intf='pg4', layer='l4', datapath='ip4',
+                         active=2)
+        ipfix.add_vpp_config()
+
+        ipfix_decoder = IPFIXDecoder()
+        # template packet should arrive immediately
+        templates = ipfix.verify_templates(ipfix_decoder, count=1)
+        before = self.flowprobe_counters()
+
+        # 20 flows of 3 packets each, interleaved
+        n_flows = 20
+        self.pkts = [(Ether(dst=self.pg3.local_mac,
+                            src=self.pg3.remote_mac) /
+                      IP(src=self.pg3.remote_ip4, dst=self.pg4.remote_ip4) /
+                      UDP(sport=2000 + n % n_flows, dport=4321) /
+                      Raw('\xa5' * 100))
+                     for n in range(3 * n_flows)]
+        self.send_packets(src_if=self.pg3, dst_if=self.pg4)
+
+        # the active timer exports every flow once with all its packets
+        records = {}
+        deadline = time.time() + 10
+        while len(records) < n_flows and time.time() < deadline:
+            cflow = self.wait_for_cflow_packet(self.collector, templates[0],
+                                               10)
+            for record in ipfix_decoder.decode_data_set(cflow.getlayer(Set)):
+                sport = int(record[7].encode('hex'), 16)
+                self.assertNotIn(sport, records)
+                records[sport] = int(record[2].encode('hex'), 16)
+        self.assertEqual(records,
+                         dict((2000 + n, 3) for n in range(n_flows)))
+
+        # then the passive timer deletes the idle flows
+        deadline = time.time() + 10
+        while time.time() < deadline:
+            after = self.flowprobe_counters()
+            if (after.get("Flows expired", 0) -
+                    before.get("Flows expired", 0) >= n_flows):
+                break
+            self.sleep(0.5, "waiting for passive expiry")
+        self.assertEqual(after.get("Flows created", 0) -
+                         before.get("Flows created", 0), n_flows)
+        self.assertGreaterEqual(after.get("Flows expired", 0) -
+                                before.get("Flows expired", 0), n_flows)
+
+        ipfix.remove_vpp_config()
+        self.logger.info("FFP_TEST_FINISH_0003")
+
     def test_cflow_packet(self):
         """verify cflow packet fields"""
         self.logger.info("FFP_TEST_START_0000")
@@ -0,0 +1,103 @@
+#!/usr/bin/env python
+""" worker handoff tests """
+
+import re
+import time
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestHandoff(VppTestCase):
+    """ Worker Handoff Test Case """
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestHandoff, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["cpu", "{", "workers", "2", "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestHandoff, cls).setUpClass()
+        try:
+            cls.create_pg_interfaces(range(1))
+            cls.pg0.admin_up()
+            cls.pg0.config_ip4()
+            cls.vapi.cli("set interface rx-placement pg0 worker 0")
+            cls.vapi.cli("set interface handoff pg0 workers 0-1")
+        except Exception:
+            super(TestHandoff, cls).tearDownClass()
+            raise
+
+    def tearDown(self):
+        super(TestHandoff, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.ppcli("show frame-queue stats"))
+            self.logger.info(self.vapi.ppcli("show buffers"))
+        self.vapi.cli("packet-generator delete pg0-flood")
+
+    def frame_queue_index(self):
+        """ index of the handoff-dispatch worker handoff queue """
+        m = re.search(r"Worker handoff queue index (\d+) "
+                      r"\(next node 'handoff-dispatch'\)",
+                      self.vapi.cli("show frame-queue stats"))
+        self.assertIsNotNone(m)
+        return int(m.group(1))
+
+    def buffers_in_use(self):
+        """ buffers taken from the pools and not on a free list """
+        n = 0
+        for line in self.vapi.cli("show buffers").split("\n"):
+            m = re.match(r"^\s*\d+\s+[A-Za-z].*\s(\d+)\s+(\d+)\s*$", line)
+            if m:
+                n += int(m.group(1)) - int(m.group(2))
+        return n
+
+    def congestion_drops(self):
+        n = 0
+        for line in self.vapi.cli("show errors").split("\n"):
+            m = re.match(r"^\s*(\d+)\s+worker-handoff\s+congestion drop",
+                         line)
+            if m:
+                n += int(m.group(1))
+        return n
+
+    def test_tail_drop(self):
+        """ tail-drop handoff drops and frees the excess buffers """
+        index = self.frame_queue_index()
+        self.vapi.cli("set frame-queue index %d tail-drop threshold 1" %
+                      index)
+        self.vapi.cli("clear frame-queue stats")
+        self.vapi.cli("clear errors")
+        in_use = self.buffers_in_use()
+
+        # unlimited stream, dropped by ip4-input on the workers
+        self.vapi.cli(
+            "packet-generator new { name pg0-flood limit 0 size 64-64 "
+            "node ethernet-input source pg0 data { IP4: %s -> %s "
+            "UDP: %s -> 192.0.2.1 UDP: 1234 -> 4321 incrementing 36 } }" %
+            (self.pg0.remote_mac, self.pg0.local_mac, self.pg0.remote_ip4))
+        self.vapi.cli("packet-generator enable-stream pg0-flood")
+
+        deadline = time.time() + 10
+        while time.time() < deadline:
+            if self.congestion_drops() > 0:
+                break
+            self.sleep(0.5, "waiting for a full handoff queue")
+        self.vapi.cli("packet-generator disable-stream pg0-flood")
+        self.assertGreater(self.congestion_drops(), 0)
+
+        stats = self.vapi.cli("show frame-queue stats")
+        drops = sum(int(x) for x in re.findall(r" drops (\d+) ", stats))
+        self.assertGreater(drops, 0)
+
+        # every dropped buffer went back to a free list
+        self.vapi.cli("packet-generator delete pg0-flood")
+        self.sleep(0.5, "handoff queues drain")
+        self.assertEqual(self.buffers_in_use(), in_use)
+
+        self.vapi.cli("set frame-queue index %d backpressure" % index)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
@@ -62,6 +62,8 @@
 
 import unittest
 import random
+import re
+import time
 
 from scapy.packet import Raw
 from scapy.layers.l2 import Ether
@@ -521,5 +523,147 @@ class TestL2fib(VppTestCase):
         self.assertEqual(len(learned_macs ^ macs), 0)
 
 
+class TestL2fibLearnWorkers(VppTestCase):
+    """ L2 FIB Learning on Workers Test Case """
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestL2fibLearnWorkers, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["cpu", "{", "workers", "1", "}",
+                                "l2learn", "{", "bd-rate-limit", "100", "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestL2fibLearnWorkers, cls).setUpClass()
+
+        try:
+            # pg0-pg2 in bd 1, pg3 alone in bd 2 for the rate limit
+            cls.create_pg_interfaces(range(4))
+            cls.bd_ifs = {1: cls.pg_interfaces[:3], 2: cls.pg_interfaces[3:]}
+            for bd_id, ifs in cls.bd_ifs.items():
+                cls.vapi.bridge_domain_add_del(bd_id=bd_id, uu_flood=0,
+                                               learn=1)
+                for pg_if in ifs:
+                    cls.vapi.sw_interface_set_l2_bridge(pg_if.sw_if_index,
+                                                        bd_id=bd_id)
+
+            # learning happens on the worker polling the interfaces
+            for i in cls.pg_interfaces:
+                i.admin_up()
+                cls.vapi.cli("set interface rx-placement %s worker 0" %
+                             i.name)
+        except Exception:
+            super(TestL2fibLearnWorkers, cls).tearDownClass()
+            raise
+
+    def tearDown(self):
+        super(TestL2fibLearnWorkers, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.ppcli("show l2learn"))
+            self.logger.info(self.vapi.ppcli("show l2fib verbose"))
+
+    def learn_stats(self):
+        """ counters of show l2learn """
+        reply = self.vapi.cli("show l2learn")
+        stats = {}
+        m = re.search(r"events applied: (\d+) learned: (\d+) moved: (\d+)",
+                      reply)
+        self.assertIsNotNone(m, reply)
+        stats["applied"], stats["learned"], stats["moved"] = \
+            [int(x) for x in m.groups()]
+        m = re.search(r"dropped: limit (\d+) bd rate (\d+) "
+                      r"interface rate (\d+)", reply)
+        self.assertIsNotNone(m, reply)
+        stats["limit"], stats["bd_rate"], stats["intf_rate"] = \
+            [int(x) for x in m.groups()]
+        stats["queued"] = sum(int(x) for x in
+                              re.findall(r"queued (\d+)", reply))
+        return stats
+
+    def wait_stats(self, counter, value):
+        """ wait for the main thread to apply the queued events """
+        deadline = time.time() + 5
+        while time.time() < deadline:
+            stats = self.learn_stats()
+            if stats[counter] >= value:
+                return stats
+            self.sleep(0.1, "waiting for the l2 learner")
+        self.assertGreaterEqual(self.learn_stats()[counter], value)
+
+    def send_learn(self, pg_if, macs):
+        """ broadcast one frame per mac from pg_if """
+        pg_if.add_stream([Ether(dst="ff:ff:ff:ff:ff:ff", src=mac) /
+                          IP(src="172.16.0.1", dst="172.16.0.2") /
+                          UDP(sport=1234, dport=1234)
+                          for mac in macs])
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+
+    def verify_forward(self, src_if, dst_if, macs):
+        """ frames to the learned macs reach dst_if only """
+        pkts = [Ether(dst=mac, src="00:00:00:00:0f:01") /
+                IP(src="172.16.0.1", dst="172.16.0.2") /
+                UDP(sport=1234, dport=1234) /
+                Raw('\xa5' * 64)
+                for mac in macs]
+        src_if.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = dst_if.get_capture(len(pkts))
+        self.assertEqual(sorted(p[Ether].dst for p in capture),
+                         sorted(macs))
+        for i in self.bd_ifs[1]:
+            if i not in (src_if, dst_if):
+                i.assert_nothing_captured(remark="unknown unicast flood")
+
+    def test_l2_learn_worker(self):
+        """ L2 FIB - worker learns are applied by the main thread
+        """
+        macs = ["00:00:00:01:01:%02x" % j for j in range(20)]
+        before = self.learn_stats()
+
+        self.send_learn(self.pg1, macs)
+        stats = self.wait_stats("learned", before["learned"] + len(macs))
+        self.assertEqual(stats["learned"] - before["learned"], len(macs))
+        self.assertGreaterEqual(stats["queued"] - before["queued"],
+                                len(macs))
+
+        # unknown unicast flooding is off, only learned macs go through
+        self.verify_forward(self.pg0, self.pg1, macs)
+
+    def test_l2_learn_worker_move(self):
+        """ L2 FIB - worker mac moves are applied by the main thread
+        """
+        macs = ["00:00:00:01:02:%02x" % j for j in range(10)]
+
+        self.send_learn(self.pg1, macs)
+        before = self.wait_stats("learned",
+                                 self.learn_stats()["learned"] + len(macs))
+        self.verify_forward(self.pg0, self.pg1, macs)
+
+        # the same macs now show up behind pg2
+        self.send_learn(self.pg2, macs)
+        stats = self.wait_stats("moved", before["moved"] + len(macs))
+        self.assertEqual(stats["moved"] - before["moved"], len(macs))
+        self.verify_forward(self.pg0, self.pg2, macs)
+
+    def test_l2_learn_worker_bd_rate(self):
+        """ L2 FIB - bridge domain learn rate limit
+        """
+        macs = ["00:00:00:02:%02x:%02x" % (j / 256, j % 256)
+                for j in range(300)]
+        before = self.learn_stats()
+
+        # 300 new macs in one burst, at most two one second windows of
+        # 100 learns each can take them
+        self.send_learn(self.pg3, macs)
+        self.sleep(1, "l2 learner")
+        stats = self.wait_stats("bd_rate", before["bd_rate"] + 1)
+        learned = stats["learned"] - before["learned"]
+        self.assertLessEqual(learned, 200)
+        self.assertEqual(learned + stats["bd_rate"] - before["bd_rate"],
+                         len(macs))
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
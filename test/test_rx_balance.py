@@ -0,0 +1,94 @@
+#!/usr/bin/env python
+""" rx-balance tests """
+
+import re
+import time
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestRxBalance(VppTestCase):
+    """ rx-balance Test Case """
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestRxBalance, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["cpu", "{", "workers", "2", "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestRxBalance, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+
+    def tearDown(self):
+        super(TestRxBalance, self).tearDown()
+        self.vapi.cli("set rx-balance disable")
+        for i in self.pg_interfaces:
+            self.vapi.cli("packet-generator delete %s-flood" % i.name)
+
+    def rx_placement(self):
+        """ map interface name -> thread index """
+        placement = {}
+        thread = None
+        for line in self.vapi.cli("show interface rx-placement").split("\n"):
+            m = re.match(r"^Thread (\d+)", line)
+            if m:
+                thread = int(m.group(1))
+                continue
+            m = re.match(r"^\s+(pg\d+) queue 0", line)
+            if m:
+                placement[m.group(1)] = thread
+        return placement
+
+    def add_flood(self, intf):
+        """ unlimited stream received on intf, dropped by ip4-input """
+        self.vapi.cli(
+            "packet-generator new { name %s-flood limit 0 size 64-64 "
+            "node ip4-input source %s data { UDP: %s -> 192.0.2.1 "
+            "UDP: 1234 -> 4321 incrementing 36 } }" %
+            (intf.name, intf.name, intf.remote_ip4))
+
+    def test_converge(self):
+        """ hot queues are spread over idle workers """
+        # both interfaces start on the first worker
+        for i in self.pg_interfaces:
+            self.vapi.cli("set interface rx-placement %s worker 0" % i.name)
+            self.add_flood(i)
+        placement = self.rx_placement()
+        self.assertEqual(placement["pg0"], placement["pg1"])
+
+        self.vapi.cli("set rx-balance enable interval 0.2 threshold 25 "
+                      "hold-time 2 min-rate 1000")
+
+        # first only pg0 is busy, a lone hot queue has nowhere better to go
+        self.vapi.cli("packet-generator enable-stream pg0-flood")
+        self.sleep(2, "single hot queue")
+        self.assertEqual(self.rx_placement()["pg0"], placement["pg0"])
+        self.assertIn("moves 0", self.vapi.cli("show rx-balance"))
+
+        # load shift: pg1 becomes busy on the same worker
+        self.vapi.cli("packet-generator enable-stream pg1-flood")
+        deadline = time.time() + 10
+        while time.time() < deadline:
+            placement = self.rx_placement()
+            if placement["pg0"] != placement["pg1"]:
+                break
+            self.sleep(0.5, "waiting for rx-balance")
+        self.logger.info(self.vapi.cli("show rx-balance"))
+        self.assertNotEqual(placement["pg0"], placement["pg1"])
+
+        # converged, no further moves while the load stays the same
+        self.sleep(3, "steady state")
+        self.assertEqual(self.rx_placement(), placement)
+        self.assertIn("moves 1", self.vapi.cli("show rx-balance"))
+        self.assertIn("moved from thread", self.vapi.cli("show logging"))
+
+        self.vapi.cli("packet-generator disable-stream")
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
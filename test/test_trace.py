@@ -0,0 +1,132 @@
+#!/usr/bin/env python
+""" sampled packet trace tests """
+
+import re
+import unittest
+
+from scapy.packet import Raw
+from scapy.layers.l2 import Ether
+from scapy.layers.inet import IP, UDP
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestTraceSample(VppTestCase):
+    """ Sampled Trace Test Case """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestTraceSample, cls).setUpClass()
+        try:
+            cls.create_pg_interfaces(range(2))
+            for i in cls.pg_interfaces:
+                i.admin_up()
+                i.config_ip4()
+                i.resolve_arp()
+        except Exception:
+            super(TestTraceSample, cls).tearDownClass()
+            raise
+
+    def tearDown(self):
+        super(TestTraceSample, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.ppcli("show trace sample max 5"))
+        self.vapi.cli("trace sample disable")
+        self.vapi.cli("clear trace")
+
+    def create_stream(self, count, dst):
+        """ count UDP packets from pg0 to dst """
+        pkts = []
+        for n in range(count):
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=dst) /
+                 UDP(sport=1234, dport=1000 + n) /
+                 Raw('\xa5' * 100))
+            pkts.append(p)
+        return pkts
+
+    def show_sample(self):
+        """ counters of the main thread and its kept traces """
+        reply = self.vapi.cli("show trace sample max 1000")
+        m = re.search(r"packets (\d+) filtered (\d+) sampled (\d+) "
+                      r"discarded (\d+) kept (\d+)", reply)
+        self.assertIsNotNone(m, reply)
+        counters = dict(zip(("packets", "filtered", "sampled",
+                             "discarded", "kept"),
+                            [int(x) for x in m.groups()]))
+        traces = re.split(r"^Packet \d+\s*$", reply, flags=re.M)[1:]
+        return counters, traces
+
+    def test_interval(self):
+        """ one in interval packets is traced to its end """
+        self.vapi.cli("trace sample pg-input interval 10 ring-size 1024")
+
+        self.pg0.add_stream(self.create_stream(100, self.pg1.remote_ip4))
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(100)
+
+        counters, traces = self.show_sample()
+        self.assertEqual(counters["packets"], 100)
+        self.assertEqual(counters["filtered"], 0)
+        self.assertEqual(counters["sampled"], 10)
+        self.assertEqual(counters["discarded"], 0)
+        self.assertEqual(counters["kept"], 10)
+        self.assertEqual(len(traces), 10)
+
+        # only finished buffers are moved to the ring: each trace runs
+        # from pg-input to the transmit of pg1
+        for t in traces:
+            self.assertIn("pg-input", t)
+            self.assertIn("pg1-output", t)
+
+    def test_drops_only(self):
+        """ drops-only keeps the traces of dropped packets """
+        self.vapi.cli("trace sample pg-input interval 2 ring-size 64 "
+                      "drops-only")
+
+        # no route to 203.0.113.1, those packets go to error-drop
+        pkts = (self.create_stream(20, self.pg1.remote_ip4) +
+                self.create_stream(20, "203.0.113.1"))
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(20)
+
+        counters, traces = self.show_sample()
+        self.assertEqual(counters["packets"], 40)
+        self.assertEqual(counters["sampled"], 20)
+        self.assertEqual(counters["discarded"], 10)
+        self.assertEqual(counters["kept"], 10)
+        for t in traces:
+            self.assertIn("error-drop", t)
+            self.assertNotIn("pg1-output", t)
+
+    def test_ring_wrap(self):
+        """ the ring keeps the most recent traces """
+        self.vapi.cli("trace sample pg-input interval 1 ring-size 16")
+
+        self.pg0.add_stream(self.create_stream(40, self.pg1.remote_ip4))
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(40)
+
+        counters, traces = self.show_sample()
+        self.assertEqual(counters["sampled"], 40)
+        self.assertEqual(counters["kept"], 40)
+        self.assertEqual(len(traces), 16)
+        reply = self.vapi.cli("show trace sample max 1000")
+        self.assertIn("Packet 40", reply)
+        self.assertNotIn("Packet 24\n", reply)
+
+        # clear trace empties the ring but sampling goes on
+        self.vapi.cli("clear trace")
+        counters, traces = self.show_sample()
+        self.assertEqual(counters["kept"], 0)
+        self.assertEqual(len(traces), 0)
+        self.assertIn("sampling pg-input 1/1",
+                      self.vapi.cli("show trace sample"))
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)